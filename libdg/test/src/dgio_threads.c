@@ -0,0 +1,191 @@
+/*
+ * dgio_threads.c -- stress test for the context based dg reader/writer
+ * (DG_IO_CTX).  Several threads at once record groups with their own
+ * contexts, read them back from memory and from gzip files, and record
+ * what they read again.  Every buffer must match, byte for byte, the one
+ * recorded for the same group before any thread started; a shared
+ * buffer, struct stack or read state would show up as a mismatch or a
+ * failed read.  Each group holds a list nested deeper than the struct
+ * stack's first allocation.
+ *
+ * Exit 0 = all threads agreed; nonzero = mismatch/error (suitable for ctest).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <df.h>
+#include <dynio.h>
+
+#define NTHREADS   8
+#define NROUNDS    200
+#define DEPTH      16		/* levels of the nested list */
+
+typedef struct {
+  int id;
+  unsigned char *expected;	/* recorded before the threads start */
+  DL_SIZE nexpected;
+  int failures;
+} THREAD_ARGS;
+
+/* a group whose contents (and size) depend on seed */
+static DYN_GROUP *make_group(int seed)
+{
+  DYN_GROUP *dg = dfuCreateDynGroup(8);
+  DYN_LIST *longs, *shorts, *floats, *chars, *strings, *nested, *inner;
+  char name[32];
+  int i, n = 50 + seed * 37;
+
+  snprintf(DYN_GROUP_NAME(dg), DYN_GROUP_NAME_SIZE, "group%d", seed);
+  longs = dfuCreateDynList(DF_LONG, 10);
+  shorts = dfuCreateDynList(DF_SHORT, 10);
+  floats = dfuCreateDynList(DF_FLOAT, 10);
+  chars = dfuCreateDynList(DF_CHAR, 10);
+  strings = dfuCreateDynList(DF_STRING, 10);
+  for (i = 0; i < n; i++) {
+    dfuAddDynListLong(longs, i * seed - 1000);
+    dfuAddDynListShort(shorts, (short) (i - seed));
+    dfuAddDynListFloat(floats, i / (seed + 1.5f));
+    dfuAddDynListChar(chars, (unsigned char) (i + seed));
+    snprintf(name, sizeof(name), "s%d_%d", seed, i);
+    dfuAddDynListString(strings, i % 7 ? name : "");
+  }
+
+  /* DEPTH lists, each holding the one inside it (some twice) */
+  nested = dfuCreateDynList(DF_FLOAT, 10);
+  for (i = 0; i < 3; i++) dfuAddDynListFloat(nested, seed + i * 0.5f);
+  for (i = 1; i < DEPTH; i++) {
+    inner = nested;
+    nested = dfuCreateDynList(DF_LIST, 10);
+    dfuAddDynListList(nested, inner);
+    if (i % 3 == 0) dfuAddDynListList(nested, inner);
+    dfuFreeDynList(inner);
+  }
+
+  dfuAddDynGroupExistingList(dg, "longs", longs);
+  dfuAddDynGroupExistingList(dg, "shorts", shorts);
+  dfuAddDynGroupExistingList(dg, "floats", floats);
+  dfuAddDynGroupExistingList(dg, "chars", chars);
+  dfuAddDynGroupExistingList(dg, "strings", strings);
+  dfuAddDynGroupExistingList(dg, "nested", nested);
+  return dg;
+}
+
+/* record dg into ctx, leaving the bytes in its buffer */
+static void record(DG_IO_CTX *ctx, DYN_GROUP *dg)
+{
+  dgInitBufferCtx(ctx);
+  dgRecordDynGroupCtx(ctx, dg);
+}
+
+static int same(DG_IO_CTX *ctx, THREAD_ARGS *args, const char *what)
+{
+  if (dgGetBufferSizeCtx(ctx) == args->nexpected &&
+      !memcmp(dgGetBufferCtx(ctx), args->expected, args->nexpected))
+    return 1;
+  fprintf(stderr, "dgio_threads: thread %d: %s differs "
+	  "(%lld vs %lld bytes)\n", args->id, what,
+	  (long long) dgGetBufferSizeCtx(ctx), (long long) args->nexpected);
+  return 0;
+}
+
+static void *run(void *data)
+{
+  THREAD_ARGS *args = (THREAD_ARGS *) data;
+  DG_IO_CTX *writer = dgCreateIOCtx(), *reader = dgCreateIOCtx();
+  DYN_GROUP *dg, *back;
+  char filename[64];
+  int round;
+
+  snprintf(filename, sizeof(filename), "dgio_threads_%d.dgz", args->id);
+  for (round = 0; round < NROUNDS && !args->failures; round++) {
+    dg = make_group(args->id);
+    record(writer, dg);
+    if (!same(writer, args, "recording")) args->failures++;
+
+    /* read from memory with a context, record what was read */
+    back = dfuCreateDynGroup(8);
+    if (round % 2) dfuEnableDynGroupArena(back);
+    if (dguBufferToStructCtx(reader, dgGetBufferCtx(writer),
+			     dgGetBufferSizeCtx(writer), back) != DF_OK) {
+      fprintf(stderr, "dgio_threads: thread %d: buffer read failed\n",
+	      args->id);
+      args->failures++;
+    }
+    else {
+      record(reader, back);
+      if (!same(reader, args, "buffer round trip")) args->failures++;
+    }
+    dfuFreeDynGroup(back);
+
+    /* every few rounds, through a gzip file and the plain reader */
+    if (round % 10 == 0) {
+      back = dfuCreateDynGroup(8);
+      if (!dgWriteBufferCompressedCtx(writer, filename) ||
+	  dguGzipFileToStruct(filename, back) != DF_OK) {
+	fprintf(stderr, "dgio_threads: thread %d: gzip round trip failed\n",
+		args->id);
+	args->failures++;
+      }
+      else {
+	record(reader, back);
+	if (!same(reader, args, "gzip round trip")) args->failures++;
+      }
+      dfuFreeDynGroup(back);
+    }
+    dfuFreeDynGroup(dg);
+  }
+  remove(filename);
+  dgFreeIOCtx(writer);
+  dgFreeIOCtx(reader);
+  return NULL;
+}
+
+int main(void)
+{
+  pthread_t threads[NTHREADS];
+  THREAD_ARGS args[NTHREADS];
+  DG_IO_CTX *ctx;
+  DYN_GROUP *dg;
+  int i, failures = 0;
+
+  /* what each thread's group must record as, made one at a time */
+  for (i = 0; i < NTHREADS; i++) {
+    ctx = dgCreateIOCtx();
+    dg = make_group(i);
+    record(ctx, dg);
+    args[i].id = i;
+    args[i].nexpected = dgGetBufferSizeCtx(ctx);
+    args[i].expected = (unsigned char *) malloc(args[i].nexpected);
+    memcpy(args[i].expected, dgGetBufferCtx(ctx), args[i].nexpected);
+    args[i].failures = 0;
+    dfuFreeDynGroup(dg);
+    dgFreeIOCtx(ctx);
+  }
+
+  /* the default context wrappers must still record the same bytes */
+  dg = make_group(0);
+  dgInitBuffer();
+  dgRecordDynGroup(dg);
+  if (dgGetBufferSize() != args[0].nexpected ||
+      memcmp(dgGetBuffer(), args[0].expected, args[0].nexpected)) {
+    fprintf(stderr, "dgio_threads: default context recording differs\n");
+    failures++;
+  }
+  dgCloseBuffer();
+  dfuFreeDynGroup(dg);
+
+  for (i = 0; i < NTHREADS; i++)
+    pthread_create(&threads[i], NULL, run, &args[i]);
+  for (i = 0; i < NTHREADS; i++) {
+    pthread_join(threads[i], NULL);
+    failures += args[i].failures;
+    free(args[i].expected);
+  }
+
+  if (failures) { fprintf(stderr, "dgio_threads: FAILED\n"); return 1; }
+  printf("dgio_threads: OK (%d threads x %d rounds, lists nested %d deep)\n",
+	 NTHREADS, NROUNDS, DEPTH);
+  return 0;
+}
@@ -16,7 +16,7 @@
 
 extern DYN_GROUP *dfuCreateDynGroup(int);
 extern void       dfuFreeDynGroup(DYN_GROUP *);
-extern DYN_LIST  *dfuCreateDynListWithVals(int datatype, int n, void *vals);
+extern DYN_LIST  *dfuCreateDynListWithVals(int datatype, DL_SIZE n, void *vals);
 extern int        dfuAddDynGroupExistingList(DYN_GROUP *, char *name, DYN_LIST *);
 extern void       dgInitBuffer(void);
 extern void       dgCloseBuffer(void);
@@ -35,8 +35,8 @@ static int cmp_list(DYN_LIST *a, DYN_LIST *b)
 	    DYN_LIST_NAME(a), DYN_LIST_DATATYPE(a), DYN_LIST_DATATYPE(b)); return 1;
   }
   if (DYN_LIST_N(a) != DYN_LIST_N(b)) {
-    fprintf(stderr, "  '%s' length %d vs %d\n",
-	    DYN_LIST_NAME(a), DYN_LIST_N(a), DYN_LIST_N(b)); return 1;
+    fprintf(stderr, "  '%s' length %lld vs %lld\n", DYN_LIST_NAME(a),
+	    (long long) DYN_LIST_N(a), (long long) DYN_LIST_N(b)); return 1;
   }
   n = DYN_LIST_N(a);
   switch (DYN_LIST_DATATYPE(a)) {
@@ -2684,7 +2684,8 @@ static int tclFindImageData(Tcl_Interp *interp, char *name,
   case 4:
     if ((temp*(*w)*(*h)) != DYN_LIST_N(sublists[1])) {
       char sizes[64];
-      sprintf(sizes, "[%dx%dx%d != %d]", *w, *h, temp,DYN_LIST_N(sublists[1]));
+      sprintf(sizes, "[%dx%dx%d != %lld]", *w, *h, temp,
+	      (long long) DYN_LIST_N(sublists[1]));
       Tcl_AppendResult(interp, "image data size mismatch ", sizes, NULL);
       return TCL_ERROR;
     }
@@ -2695,7 +2696,8 @@ static int tclFindImageData(Tcl_Interp *interp, char *name,
   default:
     {
       char sizes[64];
-      sprintf(sizes, "[w=%d, h=%d, n=%d]", *w, *h, DYN_LIST_N(sublists[1]));
+      sprintf(sizes, "[w=%d, h=%d, n=%lld]", *w, *h,
+	      (long long) DYN_LIST_N(sublists[1]));
       Tcl_AppendResult(interp, "image data size mismatch ", sizes, NULL);
       return TCL_ERROR;
     }
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <math.h>
 #include <stdint.h>
+#include <limits.h>
 
 #if defined(SGI)
 #include <ieeefp.h>
@@ -23,6 +24,15 @@
 
 #include <df.h>
 #include "dfana.h"
+#include "dlsimd.h"
+#include "dlthread.h"
+#include "dlsort.h"
+#include "dlgroup.h"
+#include "dlhist.h"
+#include "dlsdf.h"
+#include "dlfft.h"
+#include "dlspec.h"
+#include "dlrng.h"
 
 #include <utilc.h>
 
@@ -100,29 +110,9 @@ double lgamma(double xx)
 
 
 /*
- * Structures used for sorting and keeping track of the permuted
- * indices 
+ * Structure used for sorting strings and keeping track of the permuted
+ * indices (numeric lists are radix sorted, see dlsort.c)
  */
-typedef struct _longi {
-  int  i;
-  int val;
-} LONG_I;
-
-typedef struct _shorti {
-  int  i;
-  short val;
-} SHORT_I;
-
-typedef struct _floati {
-  int  i;
-  float val;
-} FLOAT_I;
-
-typedef struct _chari {
-  int  i;
-  char val;
-} CHAR_I;
-
 typedef struct _stringi {
   int  i;
   char *val;
@@ -392,6 +382,11 @@ int dynListSetMatherrCheck(int new)
   return(old);
 }
 
+int dynListGetMatherrCheck(void)
+{
+  return(DLCheckMatherr);
+}
+
 
 int dynListIncrementCounter(DYN_LIST *dl)
 {
@@ -1672,34 +1667,40 @@ DYN_LIST *dynListOnesInt(int size)
   return(list);
 }
 
+/*
+ * The random fills each take a fresh stream of the calling thread's
+ * generator (see dlrng.h), so they split across threads and give the
+ * same values for a given dl_srand seed whatever dl_threads is.
+ */
+
 DYN_LIST *dynListUniformRandsInt(int size)
 {
-  int i;
-  DYN_LIST *list;
+  DL_RNG rng;
   float *newvals = (float *) calloc(size, sizeof(float));
-  for (i = 0; i < size; i++) newvals[i] = frand();
-  list = dfuCreateDynListWithVals(DF_FLOAT, size, newvals);
-  return(list);
+  if (!newvals) return NULL;
+  dlRngNext(&rng);
+  dlRngUniform(&rng, size, newvals);
+  return(dfuCreateDynListWithVals(DF_FLOAT, size, newvals));
 }
 
 DYN_LIST *dynListUniformIRandsInt(int size, int max)
 {
-  int i;
-  DYN_LIST *list;
+  DL_RNG rng;
   int *newvals = (int *) calloc(size, sizeof(int));
-  for (i = 0; i < size; i++) newvals[i] = ran(max);
-  list = dfuCreateDynListWithVals(DF_LONG, size, newvals);
-  return(list);
+  if (!newvals) return NULL;
+  dlRngNext(&rng);
+  dlRngInts(&rng, size, max > 0 ? (uint32_t) max : 0, newvals);
+  return(dfuCreateDynListWithVals(DF_LONG, size, newvals));
 }
 
 DYN_LIST *dynListNormalRandsInt(int size)
 {
-  int i;
-  DYN_LIST *list;
+  DL_RNG rng;
   float *newvals = (float *) calloc(size, sizeof(float));
-  for (i = 0; i < size; i++) newvals[i] = zrand();
-  list = dfuCreateDynListWithVals(DF_FLOAT, size, newvals);
-  return(list);
+  if (!newvals) return NULL;
+  dlRngNext(&rng);
+  dlRngNormal(&rng, size, newvals);
+  return(dfuCreateDynListWithVals(DF_FLOAT, size, newvals));
 }
 
 DYN_LIST *dynListShuffleList(DYN_LIST *dl)
@@ -1725,8 +1726,10 @@ DYN_LIST *dynListRandFillInt(int size)
 {
   int *rands;
   DYN_LIST *list;
+  DL_RNG rng;
   if (!(rands = (int *) calloc(size, sizeof(int)))) return NULL;
-  rand_fill(size, rands);
+  dlRngNext(&rng);
+  dlRngPermutation(&rng, size, rands);
   list = dfuCreateDynListWithVals(DF_LONG, size, rands);
   return(list);
 }
@@ -1795,10 +1798,16 @@ DYN_LIST *dynListRandChooseInt(int m, int n)
   int *rands;
   DYN_LIST *list;
   
+  DL_RNG rng;
+
   if (!(rands = (int *) calloc(n, sizeof(int))))
     return NULL;
 
-  rand_choose(m, n, rands);
+  dlRngNext(&rng);
+  if (dlRngChoose(&rng, m, n, rands) < 0) {
+    free(rands);
+    return NULL;
+  }
   list = dfuCreateDynListWithVals(DF_LONG, n, rands);
   return(list);
 }
@@ -3534,33 +3543,33 @@ int dynListMinListLength(DYN_LIST *dl)
 
 
 
+struct MathFunc1 Math1Table[] = {
+  { "ABS",    (MATH_FUNC1) fabs },
+  { "ACOS",   (MATH_FUNC1) acos },
+  { "ASIN",   (MATH_FUNC1) asin },
+  { "ATAN",   (MATH_FUNC1) atan },
+  { "CEIL",   (MATH_FUNC1) ceil },
+  { "COS",    (MATH_FUNC1) cos },
+  { "COSH",   (MATH_FUNC1) cosh },
+  { "EXP",    (MATH_FUNC1) exp },
+  { "FLOOR",  (MATH_FUNC1) floor },
+  { "LOG",    (MATH_FUNC1) log },
+  { "LOG10",  (MATH_FUNC1) log10 },
+  { "ROUND",  (MATH_FUNC1) round },
+  { "SIN",    (MATH_FUNC1) sin },
+  { "SINH",   (MATH_FUNC1) sinh },
+  { "SQRT",   (MATH_FUNC1) sqrt },
+  { "TAN",    (MATH_FUNC1) tan },
+  { "TANH",   (MATH_FUNC1) tanh },
+  { "LGAMMA", (MATH_FUNC1) lgamma },
+};
+
+
 DYN_LIST *dynListMathOneArg(DYN_LIST *dl, int func_id)
 {
   int i;
   DYN_LIST *list;
   MATH_FUNC1 func;
-
-
-  struct MathFunc1 Math1Table[] = {
-    { "ABS",    (MATH_FUNC1) fabs },
-    { "ACOS",   (MATH_FUNC1) acos },
-    { "ASIN",   (MATH_FUNC1) asin },
-    { "ATAN",   (MATH_FUNC1) atan },
-    { "CEIL",   (MATH_FUNC1) ceil },
-    { "COS",    (MATH_FUNC1) cos },
-    { "COSH",   (MATH_FUNC1) cosh },
-    { "EXP",    (MATH_FUNC1) exp },
-    { "FLOOR",  (MATH_FUNC1) floor },
-    { "LOG",    (MATH_FUNC1) log },
-    { "LOG10",  (MATH_FUNC1) log10 },
-    { "ROUND",  (MATH_FUNC1) round },
-    { "SIN",    (MATH_FUNC1) sin },
-    { "SINH",   (MATH_FUNC1) sinh },
-    { "SQRT",   (MATH_FUNC1) sqrt },
-    { "TAN",    (MATH_FUNC1) tan },
-    { "TANH",   (MATH_FUNC1) tanh },
-    { "LGAMMA", (MATH_FUNC1) lgamma },
-  };
   
   
   if (func_id >= DL_N_MATHFUNC1) {
@@ -3736,9 +3745,10 @@ DYN_LIST *dynListMathOneArg(DYN_LIST *dl, int func_id)
 	  if (num_elements <= SIZE_MAX/sizeof(long)) {
 	    float *newvals = (float *) calloc(num_elements, sizeof(float));
 	    if (newvals) {
-	      for (i = 0; i < DYN_LIST_N(dl); i++) {
-		newvals[i] = (*func)((double)vals[i]);
-	      }
+	      if (!dlSimdMath1(func_id, DYN_LIST_N(dl), vals, newvals))
+		for (i = 0; i < DYN_LIST_N(dl); i++) {
+		  newvals[i] = (*func)((double)vals[i]);
+		}
 	      list = dfuCreateDynListWithVals(DF_FLOAT, DYN_LIST_N(dl), newvals);
 	    }
 	    else list = NULL;
@@ -3829,6 +3839,128 @@ DYN_LIST *dynListMathOneArg(DYN_LIST *dl, int func_id)
   return(list);
 }
 
+/*
+ * In place forms of dynListMathOneArg, which only apply when the
+ * result keeps the list's datatype: any function of a float list
+ * other than ceil / floor / round (which give ints), abs of an int,
+ * short or char list and ceil / floor / round of an int list.
+ */
+
+static int dynListMathInPlaceCheck(DYN_LIST *dl, int func_id)
+{
+  DL_SIZE i;
+  int status;
+
+  if (DYN_LIST_DATATYPE(dl) == DF_STRING) return 0;
+
+  if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
+    DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+    for (i = 0; i < DYN_LIST_N(dl); i++)
+      if ((status = dynListMathInPlaceCheck(vals[i], func_id)) != 1)
+	return status;
+    return 1;
+  }
+
+  if (!DYN_LIST_N(dl)) return 1;
+
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_FLOAT:
+    if (func_id == DL_CEIL || func_id == DL_FLOOR || func_id == DL_ROUND)
+      return 0;
+    break;
+  case DF_LONG:
+    if (func_id == DL_ABS || func_id == DL_CEIL || func_id == DL_FLOOR ||
+	func_id == DL_ROUND) return 1;
+    return 0;
+  default:
+    return (func_id == DL_ABS);
+  }
+
+  if (DLCheckMatherr) {
+    float *vals = (float *) DYN_LIST_VALS(dl);
+    switch (func_id) {
+    case DL_SQRT:
+      for (i = 0;  i < DYN_LIST_N(dl); i++)
+	if (vals[i] < 0.0) return -1;
+      break;
+    case DL_LOG:
+    case DL_LOG10:
+      for (i = 0;  i < DYN_LIST_N(dl); i++)
+	if (vals[i] <= 0.0) return -1;
+      break;
+    case DL_ACOS:
+    case DL_ASIN:
+    case DL_ATAN:
+      for (i = 0;  i < DYN_LIST_N(dl); i++)
+	if (vals[i] < -1.0 || vals[i] > 1.0) return -1;
+      break;
+    }
+  }
+  return 1;
+}
+
+static int dynListMathInPlaceApply(DYN_LIST *dl, int func_id)
+{
+  DL_SIZE i, n = DYN_LIST_N(dl);
+  MATH_FUNC1 func = Math1Table[func_id].mfunc;
+
+  if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
+    DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+    for (i = 0; i < n; i++)
+      if (!dynListMathInPlaceApply(vals[i], func_id)) return 0;
+    return 1;
+  }
+
+  if (!n) return 1;
+  if (!dfuUnshareDynList(dl)) return 0;
+
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_FLOAT:
+    {
+      float *vals = (float *) DYN_LIST_VALS(dl);
+      if (!dlSimdMath1(func_id, n, vals, vals))
+	for (i = 0; i < n; i++) vals[i] = (*func)((double)vals[i]);
+    }
+    break;
+  case DF_LONG:
+    {
+      int *vals = (int *) DYN_LIST_VALS(dl);
+      if (func_id == DL_ABS) {
+	for (i = 0; i < n; i++) if (vals[i] < 0) vals[i] = -vals[i];
+      }
+      else {
+	for (i = 0; i < n; i++) vals[i] = (int) (*func)((double)vals[i]);
+      }
+    }
+    break;
+  case DF_SHORT:
+    {
+      short *vals = (short *) DYN_LIST_VALS(dl);
+      for (i = 0; i < n; i++) if (vals[i] < 0) vals[i] = -vals[i];
+    }
+    break;
+  case DF_CHAR:			/* dl_abs leaves chars as they are */
+    break;
+  }
+  return 1;
+}
+
+/*
+ * dynListMathOneArgInPlace - returns 1 on success, 0 if the result
+ * would not have dl's datatype and -1 if an element is outside the
+ * function's domain (only checked when DLCheckMatherr is set).  dl is
+ * unchanged unless 1 is returned.
+ */
+
+int dynListMathOneArgInPlace(DYN_LIST *dl, int func_id)
+{
+  int status;
+
+  if (!dl || func_id < 0 || func_id >= DL_N_MATHFUNC1) return 0;
+  if ((status = dynListMathInPlaceCheck(dl, func_id)) != 1) return status;
+  return dynListMathInPlaceApply(dl, func_id);
+}
+
 float dynListMaxList(DYN_LIST *dl)
 {
   int i;
@@ -4134,7 +4266,7 @@ DYN_LIST *dynListMinMaxLists(DYN_LIST *dl, int op)
 {
   int i, need_float = 0;
   DYN_LIST *list, *working, *curlist, *emptylist;
-  DYN_LIST **vals;
+  DYN_LIST **vals, **results;
 
   if (!dl) return(NULL);
 
@@ -4142,14 +4274,20 @@ DYN_LIST *dynListMinMaxLists(DYN_LIST *dl, int op)
   working = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
   emptylist = dfuCreateDynList(DF_LONG, 1);
 
-  vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+  results = dynListApplyLists(dl, dynListMinMaxList, op);
+  if (!results) {
+    dfuFreeDynList(emptylist);
+    dfuFreeDynList(working);
+    return(NULL);
+  }
   for (i = 0; i < DYN_LIST_N(dl); i++) {
-    curlist = dynListMinMaxList(vals[i], op);
+    curlist = results[i];
     if (curlist) {
       dfuMoveDynListList(working, curlist);
     }
     else dfuAddDynListList(working, emptylist);	/* placeholder */
   }
+  free(results);
   dfuFreeDynList(emptylist);
   
   /* determine if we need a float list, or if ints will do */
@@ -4918,6 +5056,9 @@ DYN_LIST *dynListFindIndices(DYN_LIST *source_values, DYN_LIST *search_values)
 }
 
 
+/* number of scalar patterns from which dl_countOccurences hashes */
+#define DL_COUNT_HASH_MIN 4
+
 DYN_LIST *dynListCountOccurences(DYN_LIST *source, DYN_LIST *pattern)
 {
   DYN_LIST *find_result, *trans_result, *hist_result, *range, **vals;
@@ -4959,6 +5100,27 @@ DYN_LIST *dynListCountOccurences(DYN_LIST *source, DYN_LIST *pattern)
   }
   
   
+  /*
+   * Counting many scalar patterns: hash the source once and look each
+   * pattern up in it (dynListCompareElements only matches the same
+   * datatype, and never matches NaN, as dlGroupFind)
+   */
+  if (DYN_LIST_DATATYPE(pattern) != DF_LIST &&
+      DYN_LIST_DATATYPE(pattern) == DYN_LIST_DATATYPE(source) &&
+      DYN_LIST_N(pattern) >= DL_COUNT_HASH_MIN) {
+    DL_GROUPING *g;
+    int *ids;
+    if ((g = dlGroupRows(1, &source))) {
+      if ((ids = dlGroupFind(g, pattern))) {
+	for (i = 0; i < DYN_LIST_N(pattern); i++)
+	  ids[i] = ids[i] < 0 ? 0 : g->offsets[ids[i]+1]-g->offsets[ids[i]];
+	dlGroupFree(g);
+	return(dfuCreateDynListWithVals(DF_LONG, DYN_LIST_N(pattern), ids));
+      }
+      dlGroupFree(g);
+    }
+  }
+
   /* 
    * Here's the approach:
    *    Do a findAll, followed by a transpose and then grab the list of
@@ -5210,6 +5372,107 @@ DYN_LIST *dynListStringMatch(DYN_LIST *dl, DYN_LIST *plist, int options)
 }
 
 
+/*
+ * Per sublist reductions.  Each sublist's result goes to its own slot,
+ * computed over the worker pool (see dlthread.c) when the sublists hold
+ * enough elements between them, so results do not depend on the number
+ * of threads.
+ */
+
+typedef struct {
+  DYN_LIST **sublists;
+  float (*ffunc)(DYN_LIST *);
+  float *fvals;
+  int (*ifunc)(DYN_LIST *);
+  int *ivals;
+  DYN_LIST *(*lfunc)(DYN_LIST *, int);
+  int op;
+  DYN_LIST **lists;
+} DL_REDUCE_JOB;
+
+static void dynListReduceRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_REDUCE_JOB *job = (DL_REDUCE_JOB *) cd;
+  DL_SIZE i;
+
+  if (job->ffunc) {
+    for (i = start; i < stop; i++)
+      job->fvals[i] = job->ffunc(job->sublists[i]);
+  }
+  else if (job->ifunc) {
+    for (i = start; i < stop; i++)
+      job->ivals[i] = job->ifunc(job->sublists[i]);
+  }
+  else {
+    for (i = start; i < stop; i++)
+      job->lists[i] = job->lfunc(job->sublists[i], job->op);
+  }
+}
+
+static DL_SIZE dynListSublistElements(DYN_LIST *dl)
+{
+  DL_SIZE i, n = 0;
+  DYN_LIST **sublists = (DYN_LIST **) DYN_LIST_VALS(dl);
+  for (i = 0; i < DYN_LIST_N(dl); i++) n += DYN_LIST_N(sublists[i]);
+  return n;
+}
+
+static DYN_LIST *dynListReduceFloatLists(DYN_LIST *dl,
+					 float (*func)(DYN_LIST *))
+{
+  DL_REDUCE_JOB job;
+  DL_SIZE n = DYN_LIST_N(dl);
+
+  if (!n) return dfuCreateDynList(DF_FLOAT, 1);
+
+  memset(&job, 0, sizeof(job));
+  job.sublists = (DYN_LIST **) DYN_LIST_VALS(dl);
+  job.ffunc = func;
+  job.fvals = (float *) malloc(n*sizeof(float));
+  if (!job.fvals) return NULL;
+  dlParallelFor(n, dynListSublistElements(dl), dynListReduceRange, &job);
+  return dfuCreateDynListWithVals(DF_FLOAT, n, job.fvals);
+}
+
+static DYN_LIST *dynListReduceLongLists(DYN_LIST *dl,
+					int (*func)(DYN_LIST *))
+{
+  DL_REDUCE_JOB job;
+  DL_SIZE n = DYN_LIST_N(dl);
+
+  if (!n) return dfuCreateDynList(DF_LONG, 1);
+
+  memset(&job, 0, sizeof(job));
+  job.sublists = (DYN_LIST **) DYN_LIST_VALS(dl);
+  job.ifunc = func;
+  job.ivals = (int *) malloc(n*sizeof(int));
+  if (!job.ivals) return NULL;
+  dlParallelFor(n, dynListSublistElements(dl), dynListReduceRange, &job);
+  return dfuCreateDynListWithVals(DF_LONG, n, job.ivals);
+}
+
+/*
+ * dynListApplyLists - return an array holding func(sublist, op) for
+ * each sublist of dl (entries may be NULL); the caller frees the array
+ */
+
+DYN_LIST **dynListApplyLists(DYN_LIST *dl,
+			     DYN_LIST *(*func)(DYN_LIST *, int), int op)
+{
+  DL_REDUCE_JOB job;
+  DL_SIZE n = DYN_LIST_N(dl);
+
+  memset(&job, 0, sizeof(job));
+  job.sublists = (DYN_LIST **) DYN_LIST_VALS(dl);
+  job.lfunc = func;
+  job.op = op;
+  job.lists = (DYN_LIST **) calloc(n ? n : 1, sizeof(DYN_LIST *));
+  if (!job.lists) return NULL;
+  dlParallelFor(n, dynListSublistElements(dl), dynListReduceRange, &job);
+  return job.lists;
+}
+
+
 DYN_LIST *dynListMeanLists(DYN_LIST *dl)
 {
   int i, type = DF_FLOAT;
@@ -5253,10 +5516,7 @@ DYN_LIST *dynListMeanLists(DYN_LIST *dl)
     }
     break;
   default:
-    list = dfuCreateDynList(DF_FLOAT, DYN_LIST_N(dl));
-    for (i = 0; i < DYN_LIST_N(dl); i++) {
-      dfuAddDynListFloat(list, dynListMeanList(sublists[i]));
-    }
+    list = dynListReduceFloatLists(dl, dynListMeanList);
     break;
   }
 
@@ -5350,10 +5610,7 @@ DYN_LIST *dynListHMeanLists(DYN_LIST *dl)
     }
     break;
   default:
-    list = dfuCreateDynList(DF_FLOAT, DYN_LIST_N(dl));
-    for (i = 0; i < DYN_LIST_N(dl); i++) {
-      dfuAddDynListFloat(list, dynListMeanList(sublists[i]));
-    }
+    list = dynListReduceFloatLists(dl, dynListMeanList);
     break;
   }
 
@@ -5598,10 +5855,7 @@ DYN_LIST *dynListHVarLists(DYN_LIST *dl)
     }
     break;
   default:
-    list = dfuCreateDynList(DF_FLOAT, DYN_LIST_N(dl));
-    for (i = 0; i < DYN_LIST_N(dl); i++) {
-      dfuAddDynListFloat(list, dynListVarList(sublists[i]));
-    }
+    list = dynListReduceFloatLists(dl, dynListVarList);
     break;
   }
   return(list);
@@ -5643,10 +5897,7 @@ DYN_LIST *dynListVarLists(DYN_LIST *dl)
     }
     break;
   default:
-    list = dfuCreateDynList(DF_FLOAT, DYN_LIST_N(dl));
-    for (i = 0; i < DYN_LIST_N(dl); i++) {
-      dfuAddDynListFloat(list, dynListVarList(sublists[i]));
-    }
+    list = dynListReduceFloatLists(dl, dynListVarList);
     break;
   }
   return(list);
@@ -5783,10 +6034,7 @@ DYN_LIST *dynListHStdLists(DYN_LIST *dl)
     }
     break;
   default:
-    list = dfuCreateDynList(DF_FLOAT, DYN_LIST_N(dl));
-    for (i = 0; i < DYN_LIST_N(dl); i++) {
-      dfuAddDynListFloat(list, dynListStdList(sublists[i]));
-    }
+    list = dynListReduceFloatLists(dl, dynListStdList);
     break;
   }
   return(list);
@@ -5828,10 +6076,7 @@ DYN_LIST *dynListStdLists(DYN_LIST *dl)
     }
     break;
   default:
-    list = dfuCreateDynList(DF_FLOAT, DYN_LIST_N(dl));
-    for (i = 0; i < DYN_LIST_N(dl); i++) {
-      dfuAddDynListFloat(list, dynListStdList(sublists[i]));
-    }
+    list = dynListReduceFloatLists(dl, dynListStdList);
     break;
   }
   return(list);
@@ -6153,153 +6398,110 @@ long dynListCountList(DYN_LIST *dl, DYN_LIST *range)
 }
 
 
+typedef struct {
+  DYN_LIST **sublists;
+  DYN_LIST **hists;
+  DYN_LIST *range;
+  int nbins;
+} DL_HIST_LISTS_JOB;
+
+static void dynListHistRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_HIST_LISTS_JOB *job = (DL_HIST_LISTS_JOB *) cd;
+  DL_SIZE i;
+  for (i = start; i < stop; i++)
+    job->hists[i] = dynListHistList(job->sublists[i], job->range, job->nbins);
+}
+
+/*
+ * dynListHistLists - one histogram per sublist, the sublists shared
+ * out between threads
+ */
+
 DYN_LIST *dynListHistLists(DYN_LIST *dl, DYN_LIST *range, int nbins)
 {
-  int i;
-  DYN_LIST *list, *newlist;
-  DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+  DL_SIZE i, n;
+  DYN_LIST *list = NULL;
+  DL_HIST_LISTS_JOB job;
 
   if (DYN_LIST_DATATYPE(dl) != DF_LIST) return(NULL);
   if (nbins <= 0) return(NULL);
 
-  list = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
-  for (i = 0; i < DYN_LIST_N(dl); i++) {
-    newlist = dynListHistList(vals[i], range, nbins);
-    dfuMoveDynListList(list, newlist);
+  n = DYN_LIST_N(dl);
+  job.sublists = (DYN_LIST **) DYN_LIST_VALS(dl);
+  job.range = range;
+  job.nbins = nbins;
+  job.hists = (DYN_LIST **) calloc(n ? n : 1, sizeof(DYN_LIST *));
+  if (!job.hists) return(NULL);
+  dlParallelFor(n, dynListSublistElements(dl), dynListHistRange, &job);
+
+  for (i = 0; i < n; i++) if (!job.hists[i]) break;
+  if (i == n) {
+    list = dfuCreateDynList(DF_LIST, n ? n : 1);
+    for (i = 0; i < n; i++) dfuMoveDynListList(list, job.hists[i]);
   }
-  
+  else {
+    for (i = 0; i < n; i++) if (job.hists[i]) dfuFreeDynList(job.hists[i]);
+  }
+  free(job.hists);
   return(list);
 }
 
+/*
+ * dynListHistList - counts of the values of dl (of all its sublists,
+ * for a list of lists) in nbins equal bins over range (start, stop)
+ */
+
 DYN_LIST *dynListHistList(DYN_LIST *dl, DYN_LIST *range, int nbins)
 {
-  int i,index;
-  double bwidth, start, stop;
-  DYN_LIST *hist;
-
-  if (nbins <= 0 || !dl || !range) return(NULL);
-  
-  switch (DYN_LIST_DATATYPE(range)) {
-  case DF_LONG: 
-    {
-      int *vals = (int *) DYN_LIST_VALS(range);
-      start = vals[0];
-      stop = vals[1];
-    }
-    break;
-  case DF_FLOAT:
-    {
-      float *vals = (float *) DYN_LIST_VALS(range);
-      start = vals[0];
-      stop = vals[1];
-    }
-    break;
-  default:
-    return NULL;
-  }
-
-  hist = dfuCreateDynList(DF_LONG, nbins);
+  DL_HIST_AXIS axis;
+  int *counts;
 
-  bwidth = (stop-start)/nbins;
+  if (!dl || !dlHistAxis(&axis, range, nbins)) return(NULL);
 
-  switch (DYN_LIST_DATATYPE(dl)) {
-  case DF_LONG:
-    {
-      int *vals = (int *) DYN_LIST_VALS(dl);
-      int *counts = (int *) calloc(nbins, sizeof(int));
-      
-      for (i = 0; i < DYN_LIST_N(dl); i++)
-	{
-	  if(vals[i]<start || vals[i]>=stop) continue;
-	  index = (vals[i]-start) / bwidth;
-	  counts[index]++;
-	}      
-      for (i = 0; i < nbins; i++) 
-	dfuAddDynListLong(hist, counts[i]);
-      free(counts);
-    }
-    break;
-  case DF_SHORT:
-    {
-      short *vals = (short *) DYN_LIST_VALS(dl);
-      int *counts = (int *) calloc(nbins, sizeof(int));
-      
-      for (i = 0; i < DYN_LIST_N(dl); i++)
-	{
-	  if(vals[i]<start || vals[i]>=stop) continue;
-	  index = (vals[i]-start) / bwidth;
-	  counts[index]++;
-	}      
+  /* one extra slot for the values out of range */
+  counts = (int *) calloc(nbins+1, sizeof(int));
+  if (!counts) return(NULL);
+  if (!dlHistAdd(&axis, dl, counts)) {
+    free(counts);
+    return(NULL);
+  }
+  return(dfuCreateDynListWithVals(DF_LONG, nbins, counts));
+}
 
-      for (i = 0; i < nbins; i++) 
-	dfuAddDynListLong(hist, counts[i]);
-      free(counts);
-    }
-    break;
-  case DF_FLOAT:
-    {
-      float *vals = (float *) DYN_LIST_VALS(dl);
-      int *counts = (int *) calloc(nbins, sizeof(int));
-      
-      for (i = 0; i < DYN_LIST_N(dl); i++)
-	{
-	  if(vals[i]<start || vals[i]>=stop) continue;
-	  index = (vals[i]-start) / bwidth;
-	  counts[index]++;
-	}      
+/*
+ * dynListHist2D - counts of the (x, y) pairs of two lists in nxbins by
+ * nybins bins, as nybins rows of nxbins counts
+ */
 
-      for (i = 0; i < nbins; i++) 
-	dfuAddDynListLong(hist, counts[i]);
-      free(counts);
-    }
-    break;
-  case DF_CHAR:
-    {
-      char *vals = (char *) DYN_LIST_VALS(dl);
-      int *counts = (int *) calloc(nbins, sizeof(int));
-      
-      for (i = 0; i < DYN_LIST_N(dl); i++)
-	{
-	  if(vals[i]<start || vals[i]>=stop) continue;
-	  index = (vals[i]-start) / bwidth;
-	  counts[index]++;
-	}      
-      for (i = 0; i < nbins; i++) 
-	dfuAddDynListLong(hist, counts[i]);
-      free(counts);
-    }
-    break;
-  case DF_LIST:
-    {
-      DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-      DYN_LIST *curhist = NULL;
-      DYN_LIST *counts, *newcounts;
+DYN_LIST *dynListHist2D(DYN_LIST *x, DYN_LIST *y,
+			DYN_LIST *xrange, int nxbins,
+			DYN_LIST *yrange, int nybins)
+{
+  DL_HIST_AXIS xaxis, yaxis;
+  DYN_LIST *rows;
+  int i, *counts, *row;
 
-      if (!DYN_LIST_N(dl)) {
-	return dynListZerosInt(nbins);
-      }
+  if (!x || !y) return(NULL);
+  if (!dlHistAxis(&xaxis, xrange, nxbins)) return(NULL);
+  if (!dlHistAxis(&yaxis, yrange, nybins)) return(NULL);
+  if ((DL_SIZE) nxbins * nybins >= INT_MAX) return(NULL);
 
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	counts = dynListHistList(vals[i], range, nbins);
-	if (i) {
-	  newcounts = dynListArithListList(counts, curhist, DL_MATH_ADD);
-	  dfuFreeDynList(counts);
-	  dfuFreeDynList(curhist);
-	  curhist = newcounts;
-	}
-	else {
-	  curhist = counts;
-	}
-      }
-      hist = curhist;
-    }
-    break;
-  default:
+  counts = (int *) calloc((size_t) nxbins*nybins+1, sizeof(int));
+  if (!counts) return(NULL);
+  if (!dlHistAdd2D(&xaxis, &yaxis, x, y, counts)) {
+    free(counts);
     return(NULL);
   }
-
-  return(hist);
-}
+  rows = dfuCreateDynList(DF_LIST, nybins);
+  for (i = 0; i < nybins; i++) {
+    row = (int *) malloc(nxbins*sizeof(int));
+    memcpy(row, counts + (size_t) i*nxbins, nxbins*sizeof(int));
+    dfuMoveDynListList(rows, dfuCreateDynListWithVals(DF_LONG, nxbins, row));
+  }
+  free(counts);
+  return(rows);
+}
 
 DYN_LIST *dynListGaussian2D(int w, int h, float sd)
 {
@@ -6380,16 +6582,66 @@ DYN_LIST *dynListSdfLists(DYN_LIST *dl, float start, float stop, float ksd,
 }
 #endif
 
-DYN_LIST *dynListSdfLists(DYN_LIST *dl, DYN_LIST *starts, 
-			  DYN_LIST *stops, float ksd,
-			  float nsd, int resolution)
+/*
+ * Sdfs of each trial of a list of lists, for dynListSdfLists (each
+ * trial's sublists averaged), dynListSdfListsR (sublists kept) and
+ * dynListParzenLists.  The trials are computed in parallel, all with
+ * the one cached kernel.
+ */
+
+enum DL_SDF_MODES { DL_SDF_AVERAGE, DL_SDF_NESTED, DL_SDF_PARZEN };
+
+typedef struct {
+  DYN_LIST **trials;
+  float *starts, *stops;
+  float ksd, nsd;
+  int resol;
+  int mode;
+  DL_SDF_KERNEL *kernel;
+  DYN_LIST **results;
+} DL_SDF_JOB;
+
+static DYN_LIST *dynListSdfKernelList(DYN_LIST *dl, float start, float stop,
+				      DL_SDF_KERNEL *kernel, int resol,
+				      int nested);
+
+static DYN_LIST *dynListSdfZeros(float start, float stop, int resolution)
+{
+  int i, length = (stop - start) / resolution + 1;
+  DYN_LIST *newlist = dfuCreateDynList(DF_FLOAT, length > 0 ? length : 1);
+  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
+  return newlist;
+}
+
+static void dynListSdfTrials(void *cd, DL_SIZE start, DL_SIZE stop)
 {
-  int i, i1, i2;
-  DYN_LIST *list, *newlist;
-  DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-  float *fstarts, *fstops;
-  int *lstarts, *lstops;
-  int repstarts = 0, repstops = 0;
+  DL_SDF_JOB *job = (DL_SDF_JOB *) cd;
+  DYN_LIST *newlist;
+  DL_SIZE i;
+
+  for (i = start; i < stop; i++) {
+    if (job->mode == DL_SDF_PARZEN)
+      newlist = dynListParzenList(job->trials[i], job->starts[i],
+				  job->stops[i], job->ksd, job->nsd,
+				  job->resol);
+    else
+      newlist = dynListSdfKernelList(job->trials[i], job->starts[i],
+				     job->stops[i], job->kernel, job->resol,
+				     job->mode == DL_SDF_NESTED);
+    if (!newlist)
+      newlist = dynListSdfZeros(job->starts[i], job->stops[i], job->resol);
+    job->results[i] = newlist;
+  }
+}
+
+static DYN_LIST *dynListSdfTrialLists(DYN_LIST *dl, DYN_LIST *starts,
+				      DYN_LIST *stops, float ksd, float nsd,
+				      int resolution, int mode)
+{
+  int i, n, ok = 1;
+  DYN_LIST *list = NULL;
+  DL_SDF_JOB job;
+  DL_SIZE work = 0;
 
   if (DYN_LIST_DATATYPE(dl) != DF_LIST) return(NULL);
   if ((DYN_LIST_DATATYPE(starts) != DF_LONG &&
@@ -6402,105 +6654,225 @@ DYN_LIST *dynListSdfLists(DYN_LIST *dl, DYN_LIST *starts,
       (DYN_LIST_N(stops) != 1 && DYN_LIST_N(stops) != DYN_LIST_N(dl))) {
     return(NULL);
   }
-  if (DYN_LIST_N(starts) == 1) repstarts = 1;
-  if (DYN_LIST_N(stops) == 1) repstops = 1;
+  if (resolution < 1) return(NULL);
+
+  n = DYN_LIST_N(dl);
+  memset(&job, 0, sizeof(job));
+  job.trials = (DYN_LIST **) DYN_LIST_VALS(dl);
+  job.ksd = ksd;
+  job.nsd = nsd;
+  job.resol = resolution;
+  job.mode = mode;
+  job.starts = (float *) calloc(n+1, sizeof(float));
+  job.stops = (float *) calloc(n+1, sizeof(float));
+  job.results = (DYN_LIST **) calloc(n+1, sizeof(DYN_LIST *));
+  if (mode != DL_SDF_PARZEN) job.kernel = dlSdfKernelGet(ksd, nsd);
+  if (!job.starts || !job.stops || !job.results ||
+      (mode != DL_SDF_PARZEN && !job.kernel)) goto done;
 
-  list = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
-  
-  switch(DYN_LIST_DATATYPE(starts)) {
+  for (i = 0; i < n; i++) {
+    int i1 = (DYN_LIST_N(starts) == 1) ? 0 : i;
+    int i2 = (DYN_LIST_N(stops) == 1) ? 0 : i;
+    if (DYN_LIST_DATATYPE(starts) == DF_FLOAT)
+      job.starts[i] = ((float *) DYN_LIST_VALS(starts))[i1];
+    else job.starts[i] = ((int *) DYN_LIST_VALS(starts))[i1];
+    if (DYN_LIST_DATATYPE(stops) == DF_FLOAT)
+      job.stops[i] = ((float *) DYN_LIST_VALS(stops))[i2];
+    else job.stops[i] = ((int *) DYN_LIST_VALS(stops))[i2];
+    if (job.stops[i] > job.starts[i])
+      work += (DL_SIZE) (job.stops[i] - job.starts[i]);
+  }
+
+  dlParallelFor(n, work, dynListSdfTrials, &job);
+
+  for (i = 0; i < n; i++) if (!job.results[i]) ok = 0;
+  if (ok) {
+    list = dfuCreateDynList(DF_LIST, n > 0 ? n : 1);
+    for (i = 0; i < n; i++) dfuMoveDynListList(list, job.results[i]);
+  }
+  else {
+    for (i = 0; i < n; i++)
+      if (job.results[i]) dfuFreeDynList(job.results[i]);
+  }
+
+ done:
+  if (job.kernel) dlSdfKernelRelease(job.kernel);
+  if (job.starts) free(job.starts);
+  if (job.stops) free(job.stops);
+  if (job.results) free(job.results);
+  return(list);
+}
+
+DYN_LIST *dynListSdfLists(DYN_LIST *dl, DYN_LIST *starts, 
+			  DYN_LIST *stops, float ksd,
+			  float nsd, int resolution)
+{
+  return dynListSdfTrialLists(dl, starts, stops, ksd, nsd, resolution,
+			      DL_SDF_AVERAGE);
+}
+
+/*
+ * dynListSdfKernelList - sdf of the spike times in dl from start to
+ * stop (inclusive), every resol ms.  A list of lists gives the average
+ * of the sdfs of its sublists, or with nested set, the list of them.
+ */
+
+static DYN_LIST *dynListSdfKernelList(DYN_LIST *dl, float start, float stop,
+				      DL_SDF_KERNEL *kernel, int resol,
+				      int nested)
+{
+  int i, j, n, duration, span, nsub;
+  DYN_LIST *sdf, *sub, **sublists;
+  float *out, *vals;
+
+  if (resol < 1) return(NULL);
+
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG:
+  case DF_SHORT:
+  case DF_CHAR:
   case DF_FLOAT:
-    fstarts = (float *) DYN_LIST_VALS(starts);
-    switch(DYN_LIST_DATATYPE(stops)) {
-    case DF_FLOAT:
-      fstops = (float *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListSdfList(vals[i], fstarts[i1], fstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (fstops[i2] - fstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
-    case DF_LONG:
-      lstops = (int *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0; else i1 = i;
-	if (repstops) i2 = 0; else i2 = i;
-	newlist = 
-	  dynListSdfList(vals[i], fstarts[i1], lstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (lstops[i2] - fstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
+    /* sdfMakeSdf was handed stop-start for floats, stop-start+1 otherwise */
+    duration = stop-start+1;
+    if (DYN_LIST_DATATYPE(dl) == DF_FLOAT) span = stop-start;
+    else span = duration;
+    if (duration <= 0) return dfuCreateDynList(DF_FLOAT, 1);
+
+    n = (duration-1)/resol+1;
+    if (!(out = (float *) calloc(duration, sizeof(float)))) return(NULL);
+    if (span && DYN_LIST_N(dl) &&
+	!dlSdfTrial(kernel, DYN_LIST_DATATYPE(dl), DYN_LIST_VALS(dl),
+		    DYN_LIST_N(dl), start, span, out, duration)) {
+      free(out);
+      return(NULL);
+    }
+    if (resol > 1) {
+      for (i = 0; i < n; i++) out[i] = out[i*resol];
+    }
+    return dfuCreateDynListWithVals(DF_FLOAT, n, out);
+  case DF_LIST:
+    sublists = (DYN_LIST **) DYN_LIST_VALS(dl);
+    nsub = DYN_LIST_N(dl);
+    if (nested) {
+      sdf = dfuCreateDynList(DF_LIST, nsub > 0 ? nsub : 1);
+      for (i = 0; i < nsub; i++) {
+	if (!(sub = dynListSdfKernelList(sublists[i], start, stop, kernel,
+					 resol, 1))) {
+	  dfuFreeDynList(sdf);
+	  return(NULL);
 	}
-	dfuMoveDynListList(list, newlist);
+	dfuMoveDynListList(sdf, sub);
       }
-      break;
+      return(sdf);
     }
-    break;
-  case DF_LONG:
-    lstarts = (int *) DYN_LIST_VALS(starts);
-    switch(DYN_LIST_DATATYPE(stops)) {
-    case DF_FLOAT:
-      fstops = (float *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListSdfList(vals[i], lstarts[i1], fstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (fstops[i2] - lstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
+
+    /* the average of the sublists' sdfs */
+    if (!nsub) return(NULL);
+    sdf = NULL;
+    for (i = 0; i < nsub; i++) {
+      if (!(sub = dynListSdfKernelList(sublists[i], start, stop, kernel,
+				       resol, 0))) {
+	if (sdf) dfuFreeDynList(sdf);
+	return(NULL);
       }
-      break;
-    case DF_LONG:
-      lstops = (int *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListSdfList(vals[i], lstarts[i1], lstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (lstops[i2] - lstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
+      if (!sdf) sdf = sub;
+      else {
+	vals = (float *) DYN_LIST_VALS(sdf);
+	out = (float *) DYN_LIST_VALS(sub);
+	for (j = 0; j < DYN_LIST_N(sdf); j++) vals[j] += out[j];
+	dfuFreeDynList(sub);
       }
-      break;
     }
+    vals = (float *) DYN_LIST_VALS(sdf);
+    for (j = 0; j < DYN_LIST_N(sdf); j++) vals[j] /= (float) nsub;
+    return(sdf);
+  default:
+    return(NULL);
   }
-  return(list);
 }
 
 DYN_LIST *dynListSdfList(DYN_LIST *dl, float start, float stop, float ksd, 
 			 float knsd, int resol)
 {
-  int i,length;
+  DL_SDF_KERNEL *kernel;
+  DYN_LIST *sdf;
+
+  if (!(kernel = dlSdfKernelGet(ksd, knsd))) return(NULL);
+  sdf = dynListSdfKernelList(dl, start, stop, kernel, resol, 0);
+  dlSdfKernelRelease(kernel);
+  return(sdf);
+}
+
+/* Recurse all the way down and don't do any averaging */
+DYN_LIST *dynListSdfListsR(DYN_LIST *dl, DYN_LIST *starts, 
+			   DYN_LIST *stops, float ksd,
+			   float nsd, int resolution)
+{
+  return dynListSdfTrialLists(dl, starts, stops, ksd, nsd, resolution,
+			      DL_SDF_NESTED);
+}
+
+DYN_LIST *dynListSdfListR(DYN_LIST *dl, float start, float stop, float ksd, 
+			  float knsd, int resol)
+{
+  DL_SDF_KERNEL *kernel;
   DYN_LIST *sdf;
-  float *kvals;
-  int ksize;
 
-  kvals = sdfMakeKernel (ksd, knsd, &ksize);
+  if (!(kernel = dlSdfKernelGet(ksd, knsd))) return(NULL);
+  sdf = dynListSdfKernelList(dl, start, stop, kernel, resol, 1);
+  dlSdfKernelRelease(kernel);
+  return(sdf);
+}
+
+DYN_LIST *dynListParzenLists(DYN_LIST *dl, DYN_LIST *starts, 
+			     DYN_LIST *stops, float ksd,
+			     float nsd, int resolution)
+{
+  return dynListSdfTrialLists(dl, starts, stops, ksd, nsd, resolution,
+			      DL_SDF_PARZEN);
+}
+
+/*
+ * dynListSdfAligned - sdfs (or adaptive sdfs, with parzen set) of each
+ * trial of spike times from pre to post around that trial's align time
+ */
 
+DYN_LIST *dynListSdfAligned(DYN_LIST *dl, DYN_LIST *aligns, float pre,
+			    float post, float ksd, float nsd, int resolution,
+			    int parzen)
+{
+  DYN_LIST *starts, *stops, *sdfs;
+  double t;
+  int i, n;
+
+  if (DYN_LIST_DATATYPE(aligns) != DF_LONG &&
+      DYN_LIST_DATATYPE(aligns) != DF_FLOAT) return(NULL);
+
+  n = DYN_LIST_N(aligns);
+  starts = dfuCreateDynList(DF_FLOAT, n ? n : 1);
+  stops = dfuCreateDynList(DF_FLOAT, n ? n : 1);
+  for (i = 0; i < n; i++) {
+    if (DYN_LIST_DATATYPE(aligns) == DF_FLOAT)
+      t = ((float *) DYN_LIST_VALS(aligns))[i];
+    else t = ((int *) DYN_LIST_VALS(aligns))[i];
+    dfuAddDynListFloat(starts, (float) (t+pre));
+    dfuAddDynListFloat(stops, (float) (t+post));
+  }
+  sdfs = dynListSdfTrialLists(dl, starts, stops, ksd, nsd, resolution,
+			      parzen ? DL_SDF_PARZEN : DL_SDF_AVERAGE);
+  dfuFreeDynList(starts);
+  dfuFreeDynList(stops);
+  return(sdfs);
+}
+
+DYN_LIST *dynListParzenList(DYN_LIST *dl, float start, float stop, float ksd, 
+			    float nsd, int resol)
+{
+  int i,length;
+  DYN_LIST *sdf;
+
+  if (resol < 1) return(NULL);
   length = ( stop - start) / resol + 1;
-  sdf = dfuCreateDynList(DF_FLOAT, length);
 
   switch (DYN_LIST_DATATYPE(dl)) {
   case DF_LONG:
@@ -6510,10 +6882,12 @@ DYN_LIST *dynListSdfList(DYN_LIST *dl, float start, float stop, float ksd,
       float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
       float *counts;      
 
+      sdf = dfuCreateDynList(DF_FLOAT, length);
       for (i = 0; i < DYN_LIST_N(dl); i++) 
 	data[i] = vals[i];
 
-      counts = sdfMakeSdf(start, duration, data, DYN_LIST_N(dl), kvals, ksize);
+      counts = sdfMakeAdaptiveSdf(start, duration, data, DYN_LIST_N(dl), 
+				  ksd, nsd);
       if (counts) {
 	for (i = 0; i < duration; i+= resol) 
 	  dfuAddDynListFloat(sdf, counts[i]);
@@ -6531,11 +6905,13 @@ DYN_LIST *dynListSdfList(DYN_LIST *dl, float start, float stop, float ksd,
       short *vals = (short *) DYN_LIST_VALS(dl);
       float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
       float *counts;      
+      sdf = dfuCreateDynList(DF_FLOAT, length);
 
       for (i = 0; i < DYN_LIST_N(dl); i++) 
 	data[i] = vals[i];
 
-      counts = sdfMakeSdf(start, duration, data, DYN_LIST_N(dl), kvals, ksize);
+      counts = sdfMakeAdaptiveSdf(start, duration, data, DYN_LIST_N(dl), 
+				  ksd, nsd);
       if (counts) {
 	for (i = 0; i < duration; i+=resol) 
 	  dfuAddDynListFloat(sdf, counts[i]);
@@ -6552,10 +6928,10 @@ DYN_LIST *dynListSdfList(DYN_LIST *dl, float start, float stop, float ksd,
       int duration = stop-start+1;
       float *vals = (float *) DYN_LIST_VALS(dl);
       float *counts;      
+      sdf = dfuCreateDynList(DF_FLOAT, length);
 
-      counts = sdfMakeSdf (start, stop-start, 
-			   vals,  DYN_LIST_N(dl), kvals, ksize);
-      
+      counts = sdfMakeAdaptiveSdf(start, duration, vals, DYN_LIST_N(dl), 
+				  ksd, nsd);
       if (counts) {
 	for (i = 0; i < duration; i+=resol) 
 	  dfuAddDynListFloat(sdf, counts[i]);
@@ -6572,11 +6948,13 @@ DYN_LIST *dynListSdfList(DYN_LIST *dl, float start, float stop, float ksd,
       char *vals = (char *) DYN_LIST_VALS(dl);
       float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
       float *counts;      
+      sdf = dfuCreateDynList(DF_FLOAT, length);
 
       for (i = 0; i < DYN_LIST_N(dl); i++) 
 	data[i] = vals[i];
 
-      counts = sdfMakeSdf(start, duration, data, DYN_LIST_N(dl), kvals, ksize);
+      counts = sdfMakeAdaptiveSdf(start, duration, data, DYN_LIST_N(dl), 
+				  ksd, nsd);
       if (counts) {
 	for (i = 0; i < duration; i+=resol) 
 	  dfuAddDynListFloat(sdf, counts[i]);
@@ -6595,7 +6973,7 @@ DYN_LIST *dynListSdfList(DYN_LIST *dl, float start, float stop, float ksd,
       DYN_LIST *counts, *newcounts, *div;
 
       for (i = 0; i < DYN_LIST_N(dl); i++) {
-	counts = dynListSdfList(vals[i], start, stop,  ksd, knsd, resol);
+	counts = dynListParzenList(vals[i], start, stop, ksd, nsd, resol);
 	if (i) {
 	  newcounts = dynListArithListList(counts, cursdf, DL_MATH_ADD);
 	  dfuFreeDynList(cursdf);
@@ -6614,490 +6992,802 @@ DYN_LIST *dynListSdfList(DYN_LIST *dl, float start, float stop, float ksd,
     }
     break;
   default:
-    free(kvals);
     return(NULL);
   }
 
-  free(kvals);
   return(sdf);
 }
 
-/* Recurse all the way down and don't do any averaging */
-DYN_LIST *dynListSdfListsR(DYN_LIST *dl, DYN_LIST *starts, 
-			   DYN_LIST *stops, float ksd,
-			   float nsd, int resolution)
+/*****************************************************************************
+ *
+ * Spectral analysis: FFTs of lists and multitaper estimates over trials
+ * (see dlfft.c and dlspec.c)
+ *
+ *****************************************************************************/
+
+#define DL_SPEC_COPY(TYPE)						\
+  {									\
+    TYPE *v = (TYPE *) DYN_LIST_VALS(dl);				\
+    for (i = 0; i < n; i++) x[i] = v[i];				\
+  }
+
+/*
+ * dynListSpecVals - the first n numbers of dl as doubles, zero padded
+ * to pad points (NULL if dl is not a list of numbers)
+ */
+
+static double *dynListSpecVals(DYN_LIST *dl, int pad)
 {
-  int i, i1, i2;
-  DYN_LIST *list, *newlist;
-  DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-  float *fstarts, *fstops;
-  int *lstarts, *lstops;
-  int repstarts = 0, repstops = 0;
+  double *x;
+  int i, n = DYN_LIST_N(dl);
 
-  if (DYN_LIST_DATATYPE(dl) != DF_LIST) return(NULL);
-  if ((DYN_LIST_DATATYPE(starts) != DF_LONG &&
-       DYN_LIST_DATATYPE(starts) != DF_FLOAT) ||
-      (DYN_LIST_DATATYPE(stops) != DF_LONG &&
-       DYN_LIST_DATATYPE(stops) != DF_FLOAT)) {
-    return(NULL);
+  if (n > pad) n = pad;
+  if (!(x = (double *) calloc(pad > 0 ? pad : 1, sizeof(double)))) return NULL;
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_FLOAT: DL_SPEC_COPY(float); break;
+  case DF_LONG:  DL_SPEC_COPY(int);   break;
+  case DF_SHORT: DL_SPEC_COPY(short); break;
+  case DF_CHAR:  DL_SPEC_COPY(char);  break;
+  default:
+    free(x);
+    return NULL;
   }
-  if ((DYN_LIST_N(starts) != 1 && DYN_LIST_N(starts) != DYN_LIST_N(dl)) ||
-      (DYN_LIST_N(stops) != 1 && DYN_LIST_N(stops) != DYN_LIST_N(dl))) {
-    return(NULL);
+  return x;
+}
+
+/*
+ * dynListSpecComplex - list of the real and the imaginary parts of the
+ * n complex points z
+ */
+
+static DYN_LIST *dynListSpecComplex(const double *z, int n)
+{
+  DYN_LIST *list;
+  float *re, *im;
+  int i;
+
+  re = (float *) malloc((n > 0 ? n : 1)*sizeof(float));
+  im = (float *) malloc((n > 0 ? n : 1)*sizeof(float));
+  if (!re || !im) {
+    if (re) free(re);
+    if (im) free(im);
+    return NULL;
   }
-  if (DYN_LIST_N(starts) == 1) repstarts = 1;
-  if (DYN_LIST_N(stops) == 1) repstops = 1;
+  for (i = 0; i < n; i++) {
+    re[i] = z[2*i];
+    im[i] = z[2*i+1];
+  }
+  list = dfuCreateDynList(DF_LIST, 2);
+  dfuMoveDynListList(list, dfuCreateDynListWithVals(DF_FLOAT, n, re));
+  dfuMoveDynListList(list, dfuCreateDynListWithVals(DF_FLOAT, n, im));
+  return list;
+}
 
-  list = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
-  
-  switch(DYN_LIST_DATATYPE(starts)) {
-  case DF_FLOAT:
-    fstarts = (float *) DYN_LIST_VALS(starts);
-    switch(DYN_LIST_DATATYPE(stops)) {
-    case DF_FLOAT:
-      fstops = (float *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListSdfListR(vals[i], fstarts[i1], fstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (fstops[i2] - fstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
-    case DF_LONG:
-      lstops = (int *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0; else i1 = i;
-	if (repstops) i2 = 0; else i2 = i;
-	newlist = 
-	  dynListSdfListR(vals[i], fstarts[i1], lstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (lstops[i2] - fstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
+static DYN_LIST *dynListSpecFloats(const double *v, int n)
+{
+  float *vals;
+  int i;
+
+  if (!(vals = (float *) malloc((n > 0 ? n : 1)*sizeof(float)))) return NULL;
+  for (i = 0; i < n; i++) vals[i] = v[i];
+  return dfuCreateDynListWithVals(DF_FLOAT, n, vals);
+}
+
+/*
+ * dynListSpecTransform - the FFT of one list (with im, of the complex
+ * list re + i im), over all nfft frequencies.  Inverse transforms are
+ * scaled by 1/nfft.
+ */
+
+static DYN_LIST *dynListSpecTransform(DYN_LIST *re, DYN_LIST *im, int nfft,
+				      int inverse)
+{
+  DYN_LIST *list = NULL;
+  double *x, *y = NULL, *z;
+  int i, ok;
+
+  if (nfft <= 0) nfft = DYN_LIST_N(re);
+  if (nfft <= 0 || (im && DYN_LIST_N(im) != DYN_LIST_N(re))) return NULL;
+  if (!(x = dynListSpecVals(re, nfft))) return NULL;
+  if (im && !(y = dynListSpecVals(im, nfft))) {
+    free(x);
+    return NULL;
+  }
+  if (!(z = (double *) malloc((2*nfft+2)*sizeof(double)))) goto done;
+
+  if (!im) {
+    /* real data: the negative frequencies are conjugates */
+    memcpy(z, x, nfft*sizeof(double));
+    if (!(ok = dlFftReal(nfft, z, 0))) goto done;
+    for (i = nfft/2+1; i < nfft; i++) {
+      z[2*i] = z[2*(nfft-i)];
+      z[2*i+1] = -z[2*(nfft-i)+1];
     }
-    break;
-  case DF_LONG:
-    lstarts = (int *) DYN_LIST_VALS(starts);
-    switch(DYN_LIST_DATATYPE(stops)) {
-    case DF_FLOAT:
-      fstops = (float *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListSdfListR(vals[i], lstarts[i1], fstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (fstops[i2] - lstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
-    case DF_LONG:
-      lstops = (int *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListSdfListR(vals[i], lstarts[i1], lstops[i2], 
-			 ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (lstops[i2] - lstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
+    /* and the inverse is the conjugate of the forward transform */
+    if (inverse) for (i = 0; i < nfft; i++) {
+      z[2*i] /= nfft;
+      z[2*i+1] /= -nfft;
     }
   }
-  return(list);
+  else {
+    for (i = 0; i < nfft; i++) {
+      z[2*i] = x[i];
+      z[2*i+1] = y[i];
+    }
+    if (!(ok = dlFftComplex(nfft, z, inverse))) goto done;
+    if (inverse) for (i = 0; i < 2*nfft; i++) z[i] /= nfft;
+  }
+  list = dynListSpecComplex(z, nfft);
+
+ done:
+  if (z) free(z);
+  free(x);
+  if (y) free(y);
+  return list;
 }
 
-DYN_LIST *dynListSdfListR(DYN_LIST *dl, float start, float stop, float ksd, 
-			  float knsd, int resol)
+typedef struct {
+  DYN_LIST **re, **im;
+  int nfft, inverse;
+  DYN_LIST **results;
+} DL_FFT_JOB;
+
+static void dynListFftRange(void *cd, DL_SIZE start, DL_SIZE stop)
 {
-  int i,length;
-  DYN_LIST *sdf;
-  float *kvals;
-  int ksize;
+  DL_FFT_JOB *job = (DL_FFT_JOB *) cd;
+  DL_SIZE i;
 
-  kvals = sdfMakeKernel (ksd, knsd, &ksize);
+  for (i = start; i < stop; i++)
+    job->results[i] = dynListFft(job->re[i], job->im ? job->im[i] : NULL,
+				 job->nfft, job->inverse);
+}
 
-  length = ( stop - start) / resol + 1;
-  sdf = dfuCreateDynList(DF_FLOAT, length);
+/*
+ * dynListFft - FFT of a list of numbers (with im, of the complex list
+ * re + i im) as a list of real and imaginary parts, zero padded or
+ * cut to nfft points (nfft 0 for the list's own length).  Lists of
+ * lists give a list of transforms, done in parallel.
+ */
 
-  switch (DYN_LIST_DATATYPE(dl)) {
-  case DF_LONG:
-    {
-      int duration = stop-start+1;
-      int *vals = (int *) DYN_LIST_VALS(dl);
-      float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
-      float *counts;      
+DYN_LIST *dynListFft(DYN_LIST *re, DYN_LIST *im, int nfft, int inverse)
+{
+  DL_FFT_JOB job;
+  DYN_LIST *list = NULL;
+  DL_SIZE work = 0;
+  int i, n, ok = 1;
+
+  if (DYN_LIST_DATATYPE(re) != DF_LIST) {
+    if (im && DYN_LIST_DATATYPE(im) == DF_LIST) return NULL;
+    return dynListSpecTransform(re, im, nfft, inverse);
+  }
+  if (im && (DYN_LIST_DATATYPE(im) != DF_LIST ||
+	     DYN_LIST_N(im) != DYN_LIST_N(re))) return NULL;
+
+  n = DYN_LIST_N(re);
+  memset(&job, 0, sizeof(job));
+  job.re = (DYN_LIST **) DYN_LIST_VALS(re);
+  job.im = im ? (DYN_LIST **) DYN_LIST_VALS(im) : NULL;
+  job.nfft = nfft;
+  job.inverse = inverse;
+  if (!(job.results = (DYN_LIST **) calloc(n+1, sizeof(DYN_LIST *))))
+    return NULL;
+  for (i = 0; i < n; i++) work += DYN_LIST_N(job.re[i]);
 
-      for (i = 0; i < DYN_LIST_N(dl); i++) 
-	data[i] = vals[i];
+  dlParallelFor(n, work, dynListFftRange, &job);
 
-      counts = sdfMakeSdf(start, duration, data, DYN_LIST_N(dl), kvals, ksize);
-      if (counts) {
-	for (i = 0; i < duration; i+= resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(data);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+= resol) dfuAddDynListFloat(sdf, 0.0);
-      }
+  for (i = 0; i < n; i++) if (!job.results[i]) ok = 0;
+  if (ok) {
+    list = dfuCreateDynList(DF_LIST, n > 0 ? n : 1);
+    for (i = 0; i < n; i++) dfuMoveDynListList(list, job.results[i]);
+  }
+  else {
+    for (i = 0; i < n; i++)
+      if (job.results[i]) dfuFreeDynList(job.results[i]);
+  }
+  free(job.results);
+  return list;
+}
+
+/*
+ * dynListDpss - the first ntapers discrete prolate spheroidal sequences
+ * of n points with time-bandwidth product nw, one list per taper
+ */
+
+DYN_LIST *dynListDpss(int n, double nw, int ntapers)
+{
+  DL_DPSS *dpss;
+  DYN_LIST *list;
+  int k;
+
+  if (!(dpss = dlDpssGet(n, nw, ntapers))) return NULL;
+  list = dfuCreateDynList(DF_LIST, ntapers);
+  for (k = 0; k < ntapers; k++)
+    dfuMoveDynListList(list, dynListSpecFloats(dlDpssTaper(dpss, k), n));
+  dlDpssRelease(dpss);
+  return list;
+}
+
+enum DL_MT_MODES { DL_MT_FFT, DL_MT_SPECTRUM, DL_MT_SPECGRAM,
+		   DL_MT_COHERENCE };
+
+/* results per trial in each mode */
+static int MtResults[] = { 1, 2, 1, 8 };
+
+typedef struct {
+  int mode;
+  DYN_LIST **trials1, **trials2;
+  DL_DPSS *dpss;
+  int ntapers;
+  int n;			/* points per trial                     */
+  int win, step;		/* points per window and between them   */
+  int nfft, nf;			/* nf = nfft/2+1 frequencies kept       */
+  double fs;
+  int point1, point2;
+  DYN_LIST **results;		/* MtResults[mode] per trial            */
+} DL_MT_JOB;
+
+/*
+ * dynListMtTapers - the tapered transforms J of one trial, as a list
+ * of real and imaginary parts per taper
+ */
+
+static DYN_LIST *dynListMtTapers(DL_MT_JOB *job, const double *J)
+{
+  DYN_LIST *list = dfuCreateDynList(DF_LIST, job->ntapers);
+  int k;
+
+  for (k = 0; k < job->ntapers; k++)
+    dfuMoveDynListList(list, dynListSpecComplex(J+k*2*job->nf, job->nf));
+  return list;
+}
+
+/*
+ * dynListMtPower - the spectrum of one trial or window: |J|^2
+ * averaged over the tapers
+ */
+
+static void dynListMtPower(DL_MT_JOB *job, const double *J, double *S)
+{
+  int f, k;
+  const double *z;
+
+  for (f = 0; f < job->nf; f++) {
+    S[f] = 0.0;
+    for (k = 0; k < job->ntapers; k++) {
+      z = J+k*2*job->nf+2*f;
+      S[f] += z[0]*z[0]+z[1]*z[1];
     }
-    break;
-  case DF_SHORT:
-    {
-      int duration = stop-start+1;
-      short *vals = (short *) DYN_LIST_VALS(dl);
-      float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
-      float *counts;      
+    S[f] /= job->ntapers;
+  }
+}
 
-      for (i = 0; i < DYN_LIST_N(dl); i++) 
-	data[i] = vals[i];
+/*
+ * dynListMtCross - the coherence, cross spectrum and power spectra of
+ * two signals' J: cohmag cohphase S12r S12i S1 S2 into results
+ */
 
-      counts = sdfMakeSdf(start, duration, data, DYN_LIST_N(dl), kvals, ksize);
-      if (counts) {
-	for (i = 0; i < duration; i+=resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(data);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+=resol) dfuAddDynListFloat(sdf, 0.0);
+static int dynListMtCross(DL_MT_JOB *job, const double *J1, const double *J2,
+			  DYN_LIST **results)
+{
+  double *out, *s12r, *s12i, *s1, *s2, *mag, *phase;
+  const double *a, *b;
+  int f, k, nf = job->nf, ntapers = job->ntapers;
+
+  if (!(out = (double *) calloc(6*nf, sizeof(double)))) return 0;
+  mag = out; phase = out+nf; s12r = out+2*nf; s12i = out+3*nf;
+  s1 = out+4*nf; s2 = out+5*nf;
+  for (f = 0; f < nf; f++) {
+    for (k = 0; k < ntapers; k++) {
+      a = J1+k*2*nf+2*f;
+      b = J2+k*2*nf+2*f;
+      s12r[f] += a[0]*b[0]+a[1]*b[1];
+      s12i[f] += a[0]*b[1]-a[1]*b[0];
+      s1[f] += a[0]*a[0]+a[1]*a[1];
+      s2[f] += b[0]*b[0]+b[1]*b[1];
+    }
+    s12r[f] /= ntapers; s12i[f] /= ntapers;
+    s1[f] /= ntapers; s2[f] /= ntapers;
+    mag[f] = sqrt(s12r[f]*s12r[f]+s12i[f]*s12i[f])/sqrt(s1[f]*s2[f]);
+    phase[f] = atan(s12i[f]/s12r[f]);
+  }
+  for (k = 0; k < 6; k++) results[k] = dynListSpecFloats(out+k*nf, nf);
+  free(out);
+  return 1;
+}
+
+/*
+ * dynListMtTrial - the results of trial i for the job's mode
+ */
+
+static void dynListMtTrial(DL_MT_JOB *job, int i)
+{
+  DYN_LIST **results = job->results+i*MtResults[job->mode];
+  double *x1 = NULL, *x2 = NULL, *J1 = NULL, *J2 = NULL, *S = NULL;
+  int w, nwins, size = job->ntapers*2*job->nf;
+
+  if (!(x1 = dynListSpecVals(job->trials1[i], job->n))) goto done;
+  if (job->trials2 && !(x2 = dynListSpecVals(job->trials2[i], job->n)))
+    goto done;
+  if (!(J1 = (double *) malloc(size*sizeof(double)))) goto done;
+  if (x2 && !(J2 = (double *) malloc(size*sizeof(double)))) goto done;
+  if (!(S = (double *) malloc(job->nf*sizeof(double)))) goto done;
+
+  switch (job->mode) {
+  case DL_MT_FFT:
+    if (dlMtFft(job->dpss, x1, job->n, job->nfft, job->fs, job->point1, J1))
+      results[0] = dynListMtTapers(job, J1);
+    break;
+  case DL_MT_SPECTRUM:
+    if (dlMtFft(job->dpss, x1, job->n, job->nfft, job->fs, job->point1, J1)) {
+      dynListMtPower(job, J1, S);
+      results[0] = dynListSpecFloats(S, job->nf);
+      results[1] = dynListMtTapers(job, J1);
+    }
+    break;
+  case DL_MT_SPECGRAM:
+    nwins = (job->n-job->win)/job->step+1;
+    results[0] = dfuCreateDynList(DF_LIST, nwins);
+    for (w = 0; w < nwins; w++) {
+      if (!dlMtFft(job->dpss, x1+w*job->step, job->win, job->nfft, job->fs,
+		   job->point1, J1)) {
+	dfuFreeDynList(results[0]);
+	results[0] = NULL;
+	break;
       }
+      dynListMtPower(job, J1, S);
+      dfuMoveDynListList(results[0], dynListSpecFloats(S, job->nf));
     }
     break;
-  case DF_FLOAT:
-    {
-      int duration = stop-start+1;
-      float *vals = (float *) DYN_LIST_VALS(dl);
-      float *counts;      
-
-      counts = sdfMakeSdf (start, stop-start, 
-			   vals,  DYN_LIST_N(dl), kvals, ksize);
-      
-      if (counts) {
-	for (i = 0; i < duration; i+=resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+=resol) dfuAddDynListFloat(sdf, 0.0);
-      }
+  case DL_MT_COHERENCE:
+    if (dlMtFft(job->dpss, x1, job->n, job->nfft, job->fs, job->point1, J1) &&
+	dlMtFft(job->dpss, x2, job->n, job->nfft, job->fs, job->point2, J2) &&
+	dynListMtCross(job, J1, J2, results)) {
+      results[6] = dynListMtTapers(job, J1);
+      results[7] = dynListMtTapers(job, J2);
     }
     break;
-  case DF_CHAR:
-    {
-      int duration = stop-start+1;
-      char *vals = (char *) DYN_LIST_VALS(dl);
-      float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
-      float *counts;      
+  }
 
-      for (i = 0; i < DYN_LIST_N(dl); i++) 
-	data[i] = vals[i];
+ done:
+  if (x1) free(x1);
+  if (x2) free(x2);
+  if (J1) free(J1);
+  if (J2) free(J2);
+  if (S) free(S);
+}
 
-      counts = sdfMakeSdf(start, duration, data, DYN_LIST_N(dl), kvals, ksize);
-      if (counts) {
-	for (i = 0; i < duration; i+=resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(data);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+=resol) dfuAddDynListFloat(sdf, 0.0);
-      }
-    }
-    break;
-  case DF_LIST:
-    {
-      DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-      DYN_LIST *cursdf = NULL;
+static void dynListMtTrials(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_MT_JOB *job = (DL_MT_JOB *) cd;
+  DL_SIZE i;
 
-      sdf = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	cursdf = dynListSdfListR(vals[i], start, stop,  ksd, knsd, resol);
-	if (!cursdf) {
-	  dfuFreeDynList(sdf);
-	  free(kvals);
-	  return NULL;
-	}
-	dfuMoveDynListList(sdf, cursdf);
-      }
+  for (i = start; i < stop; i++) dynListMtTrial(job, i);
+}
+
+/*
+ * dynListMtTrialLists - run a multitaper job over the trials of dl1
+ * (and dl2), which must all have the same length.  Returns one list
+ * per result, each with an entry per trial, followed by the
+ * frequencies (except for DL_MT_FFT, which returns the J of each
+ * trial).
+ */
+
+static DYN_LIST *dynListMtTrialLists(DYN_LIST *dl1, DYN_LIST *dl2, int mode,
+				     int win, int step, double nw,
+				     int ntapers, int pad, double fs,
+				     int point1, int point2)
+{
+  DL_MT_JOB job;
+  DYN_LIST *list = NULL, *col;
+  int i, j, n, nres = MtResults[mode], ok = 1;
+  float *freqs;
+
+  if (DYN_LIST_DATATYPE(dl1) != DF_LIST || !DYN_LIST_N(dl1)) return NULL;
+  if (dl2 && (DYN_LIST_DATATYPE(dl2) != DF_LIST ||
+	      DYN_LIST_N(dl2) != DYN_LIST_N(dl1))) return NULL;
+  if (!(fs > 0.0)) return NULL;
+
+  memset(&job, 0, sizeof(job));
+  job.mode = mode;
+  job.trials1 = (DYN_LIST **) DYN_LIST_VALS(dl1);
+  job.trials2 = dl2 ? (DYN_LIST **) DYN_LIST_VALS(dl2) : NULL;
+  job.n = DYN_LIST_N(job.trials1[0]);
+  n = DYN_LIST_N(dl1);
+  for (i = 0; i < n; i++) {
+    if (DYN_LIST_N(job.trials1[i]) != job.n) return NULL;
+    if (dl2 && DYN_LIST_N(job.trials2[i]) != job.n) return NULL;
+  }
+  if (mode == DL_MT_SPECGRAM) {
+    if (win < 1 || win > job.n || step < 1) return NULL;
+    job.win = win;
+    job.step = step;
+  }
+  else job.win = job.n;
+  job.ntapers = ntapers;
+  job.fs = fs;
+  job.point1 = point1;
+  job.point2 = point2;
+  if (!(job.nfft = dlSpecNfft(job.win, pad))) return NULL;
+  job.nf = job.nfft/2+1;
+  if (!(job.dpss = dlDpssGet(job.win, nw, ntapers))) return NULL;
+  job.results = (DYN_LIST **) calloc(n*nres+1, sizeof(DYN_LIST *));
+  if (!job.results) {
+    dlDpssRelease(job.dpss);
+    return NULL;
+  }
+
+  dlParallelFor(n, (DL_SIZE) n*ntapers*job.nfft*(dl2 ? 2 : 1),
+		dynListMtTrials, &job);
+  dlDpssRelease(job.dpss);
+
+  for (i = 0; i < n*nres; i++) if (!job.results[i]) ok = 0;
+  if (!ok) {
+    for (i = 0; i < n*nres; i++)
+      if (job.results[i]) dfuFreeDynList(job.results[i]);
+    free(job.results);
+    return NULL;
+  }
+
+  if (mode == DL_MT_FFT) {
+    list = dfuCreateDynList(DF_LIST, n);
+    for (i = 0; i < n; i++) dfuMoveDynListList(list, job.results[i]);
+  }
+  else {
+    list = dfuCreateDynList(DF_LIST, nres+1);
+    for (j = 0; j < nres; j++) {
+      col = dfuCreateDynList(DF_LIST, n);
+      for (i = 0; i < n; i++) dfuMoveDynListList(col, job.results[i*nres+j]);
+      dfuMoveDynListList(list, col);
     }
-    break;
-  default:
-    free(kvals);
-    return(NULL);
+    if (!(freqs = (float *) malloc(job.nf*sizeof(float)))) {
+      dfuFreeDynList(list);
+      free(job.results);
+      return NULL;
+    }
+    for (i = 0; i < job.nf; i++) freqs[i] = i*fs/job.nfft;
+    dfuMoveDynListList(list, dfuCreateDynListWithVals(DF_FLOAT, job.nf, freqs));
   }
+  free(job.results);
+  return list;
+}
+
+/*
+ * dynListMtFft - tapered transforms of each trial of dl: a list per
+ * trial of a list per taper of the real and imaginary parts over the
+ * non-negative frequencies
+ */
 
-  free(kvals);
-  return(sdf);
+DYN_LIST *dynListMtFft(DYN_LIST *dl, double nw, int ntapers, int pad,
+		       double fs, int point)
+{
+  return dynListMtTrialLists(dl, NULL, DL_MT_FFT, 0, 0, nw, ntapers, pad,
+			     fs, point, 0);
 }
 
+/*
+ * dynListMtSpectrum - multitaper spectrum of each trial of dl: the
+ * list of spectra, the list of each trial's tapered transforms, and
+ * the frequencies
+ */
 
-DYN_LIST *dynListParzenLists(DYN_LIST *dl, DYN_LIST *starts, 
-			     DYN_LIST *stops, float ksd,
-			     float nsd, int resolution)
+DYN_LIST *dynListMtSpectrum(DYN_LIST *dl, double nw, int ntapers, int pad,
+			    double fs, int point)
 {
-  int i, i1, i2;
-  DYN_LIST *list, *newlist;
-  DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-  float *fstarts, *fstops;
-  int *lstarts, *lstops;
-  int repstarts = 0, repstops = 0;
+  return dynListMtTrialLists(dl, NULL, DL_MT_SPECTRUM, 0, 0, nw, ntapers,
+			     pad, fs, point, 0);
+}
 
-  if (DYN_LIST_DATATYPE(dl) != DF_LIST) return(NULL);
-  if ((DYN_LIST_DATATYPE(starts) != DF_LONG &&
-       DYN_LIST_DATATYPE(starts) != DF_FLOAT) ||
-      (DYN_LIST_DATATYPE(stops) != DF_LONG &&
-       DYN_LIST_DATATYPE(stops) != DF_FLOAT)) {
-    return(NULL);
-  }
-  if ((DYN_LIST_N(starts) != 1 && DYN_LIST_N(starts) != DYN_LIST_N(dl)) ||
-      (DYN_LIST_N(stops) != 1 && DYN_LIST_N(stops) != DYN_LIST_N(dl))) {
-    return(NULL);
-  }
-  if (DYN_LIST_N(starts) == 1) repstarts = 1;
-  if (DYN_LIST_N(stops) == 1) repstops = 1;
+/*
+ * dynListMtSpecgram - spectra of windows of win points every step
+ * points through each trial of dl: a list per trial of the spectrum
+ * of each window, and the frequencies
+ */
 
-  list = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
-  
-  switch(DYN_LIST_DATATYPE(starts)) {
-  case DF_FLOAT:
-    fstarts = (float *) DYN_LIST_VALS(starts);
-    switch(DYN_LIST_DATATYPE(stops)) {
-    case DF_FLOAT:
-      fstops = (float *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListParzenList(vals[i], fstarts[i1], fstops[i2], 
-			    ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (fstops[i2] - fstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
-    case DF_LONG:
-      lstops = (int *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0; else i1 = i;
-	if (repstops) i2 = 0; else i2 = i;
-	newlist = 
-	  dynListParzenList(vals[i], fstarts[i1], lstops[i2], 
-			    ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (lstops[i2] - fstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
-    }
-    break;
-  case DF_LONG:
-    lstarts = (int *) DYN_LIST_VALS(starts);
-    switch(DYN_LIST_DATATYPE(stops)) {
-    case DF_FLOAT:
-      fstops = (float *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListParzenList(vals[i], lstarts[i1], fstops[i2], 
-			    ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (fstops[i2] - lstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
-    case DF_LONG:
-      lstops = (int *) DYN_LIST_VALS(stops);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (repstarts) i1 = 0;  else i1 = i;
-	if (repstops) i2 = 0;  else i2 = i;
-	newlist = 
-	  dynListParzenList(vals[i], lstarts[i1], lstops[i2], 
-			    ksd, nsd, resolution);
-	if (!newlist) {
-	  int i;
-	  int length = (lstops[i2] - lstarts[i1]) / resolution + 1;
-	  newlist = dfuCreateDynList(DF_FLOAT, length);
-	  for (i = 0; i < length; i++) dfuAddDynListFloat(newlist, 0.0);
-	}
-	dfuMoveDynListList(list, newlist);
-      }
-      break;
-    }
-  }
-  return(list);
+DYN_LIST *dynListMtSpecgram(DYN_LIST *dl, int win, int step, double nw,
+			    int ntapers, int pad, double fs, int point)
+{
+  return dynListMtTrialLists(dl, NULL, DL_MT_SPECGRAM, win, step, nw,
+			     ntapers, pad, fs, point, 0);
 }
 
+/*
+ * dynListMtCoherence - coherence of each pair of trials of dl1 and
+ * dl2: the lists cohmag cohphase S12r S12i S1 S2 J1 J2 (an entry per
+ * trial) and the frequencies
+ */
 
-DYN_LIST *dynListParzenList(DYN_LIST *dl, float start, float stop, float ksd, 
-			    float nsd, int resol)
+DYN_LIST *dynListMtCoherence(DYN_LIST *dl1, DYN_LIST *dl2, double nw,
+			     int ntapers, int pad, double fs, int point1,
+			     int point2)
 {
-  int i,length;
-  DYN_LIST *sdf;
+  return dynListMtTrialLists(dl1, dl2, DL_MT_COHERENCE, 0, 0, nw, ntapers,
+			     pad, fs, point1, point2);
+}
 
-  length = ( stop - start) / resol + 1;
+/*
+ * dynListSpecCounts - trials and tapers in J (a list of trials, each a
+ * list per taper of real and imaginary parts)
+ */
 
-  switch (DYN_LIST_DATATYPE(dl)) {
-  case DF_LONG:
-    {
-      int duration = stop-start+1;
-      int *vals = (int *) DYN_LIST_VALS(dl);
-      float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
-      float *counts;      
+static int dynListSpecCounts(DYN_LIST *J, int *ntrials, int *ntapers)
+{
+  DYN_LIST **trials;
 
-      sdf = dfuCreateDynList(DF_FLOAT, length);
-      for (i = 0; i < DYN_LIST_N(dl); i++) 
-	data[i] = vals[i];
+  if (DYN_LIST_DATATYPE(J) != DF_LIST || !DYN_LIST_N(J)) return 0;
+  trials = (DYN_LIST **) DYN_LIST_VALS(J);
+  if (DYN_LIST_DATATYPE(trials[0]) != DF_LIST || !DYN_LIST_N(trials[0]))
+    return 0;
+  *ntrials = DYN_LIST_N(J);
+  *ntapers = DYN_LIST_N(trials[0]);
+  return 1;
+}
 
-      counts = sdfMakeAdaptiveSdf(start, duration, data, DYN_LIST_N(dl), 
-				  ksd, nsd);
-      if (counts) {
-	for (i = 0; i < duration; i+= resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(data);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+= resol) dfuAddDynListFloat(sdf, 0.0);
-      }
-    }
-    break;
-  case DF_SHORT:
-    {
-      int duration = stop-start+1;
-      short *vals = (short *) DYN_LIST_VALS(dl);
-      float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
-      float *counts;      
-      sdf = dfuCreateDynList(DF_FLOAT, length);
+/*
+ * dynListSpecGather - the tapered transforms of all trials of J, one
+ * after another, as nf complex points each (NULL if J is not shaped
+ * that way)
+ */
 
-      for (i = 0; i < DYN_LIST_N(dl); i++) 
-	data[i] = vals[i];
+static double *dynListSpecGather(DYN_LIST *J, int nf)
+{
+  DYN_LIST **trials, **tapers, **parts;
+  double *z, *out;
+  float *re, *im;
+  int t, k, f, ntrials, ntapers;
+
+  if (!dynListSpecCounts(J, &ntrials, &ntapers)) return NULL;
+  z = out = (double *) malloc((DL_SIZE) ntrials*ntapers*2*nf*sizeof(double));
+  if (!z) return NULL;
+  trials = (DYN_LIST **) DYN_LIST_VALS(J);
+  for (t = 0; t < ntrials; t++) {
+    if (DYN_LIST_DATATYPE(trials[t]) != DF_LIST ||
+	DYN_LIST_N(trials[t]) != ntapers) goto bad;
+    tapers = (DYN_LIST **) DYN_LIST_VALS(trials[t]);
+    for (k = 0; k < ntapers; k++) {
+      if (DYN_LIST_DATATYPE(tapers[k]) != DF_LIST ||
+	  DYN_LIST_N(tapers[k]) != 2) goto bad;
+      parts = (DYN_LIST **) DYN_LIST_VALS(tapers[k]);
+      if (DYN_LIST_DATATYPE(parts[0]) != DF_FLOAT ||
+	  DYN_LIST_DATATYPE(parts[1]) != DF_FLOAT ||
+	  DYN_LIST_N(parts[0]) != nf || DYN_LIST_N(parts[1]) != nf) goto bad;
+      re = (float *) DYN_LIST_VALS(parts[0]);
+      im = (float *) DYN_LIST_VALS(parts[1]);
+      for (f = 0; f < nf; f++) {
+	*z++ = re[f];
+	*z++ = im[f];
+      }
+    }
+  }
+  return out;
+
+ bad:
+  free(out);
+  return NULL;
+}
 
-      counts = sdfMakeAdaptiveSdf(start, duration, data, DYN_LIST_N(dl), 
-				  ksd, nsd);
-      if (counts) {
-	for (i = 0; i < duration; i+=resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(data);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+=resol) dfuAddDynListFloat(sdf, 0.0);
-      }
-    }
-    break;
-  case DF_FLOAT:
-    {
-      int duration = stop-start+1;
-      float *vals = (float *) DYN_LIST_VALS(dl);
-      float *counts;      
-      sdf = dfuCreateDynList(DF_FLOAT, length);
+/*
+ * dynListSpecErr - lower and upper confidence limits at level p for
+ * the mean spectra S of each condition, from the tapered transforms J
+ * of the condition's trials: from the chi-square distribution of the
+ * spectrum (method 1, with the degrees of freedom corrected for the
+ * spike counts in numspks if given) or by jackknife (method 2)
+ */
 
-      counts = sdfMakeAdaptiveSdf(start, duration, vals, DYN_LIST_N(dl), 
-				  ksd, nsd);
-      if (counts) {
-	for (i = 0; i < duration; i+=resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+=resol) dfuAddDynListFloat(sdf, 0.0);
+DYN_LIST *dynListSpecErr(DYN_LIST *S, DYN_LIST *J, double p, int method,
+			 DYN_LIST *numspks)
+{
+  DYN_LIST **spectra, **conds, *lower, *upper, *list;
+  double *s = NULL, *lo = NULL, *hi = NULL, *nsp = NULL, *z, dof, ql, qu;
+  int c, f, nf, ncond, ntrials, ntapers;
+
+  if (DYN_LIST_DATATYPE(S) != DF_LIST || DYN_LIST_DATATYPE(J) != DF_LIST ||
+      DYN_LIST_N(S) != DYN_LIST_N(J)) return NULL;
+  if (!(p > 0.0 && p < 1.0) || (method != 1 && method != 2)) return NULL;
+  ncond = DYN_LIST_N(S);
+  if (numspks && (DYN_LIST_N(numspks) != ncond ||
+		  !(nsp = dynListSpecVals(numspks, ncond)))) return NULL;
+
+  spectra = (DYN_LIST **) DYN_LIST_VALS(S);
+  conds = (DYN_LIST **) DYN_LIST_VALS(J);
+  lower = dfuCreateDynList(DF_LIST, ncond ? ncond : 1);
+  upper = dfuCreateDynList(DF_LIST, ncond ? ncond : 1);
+  for (c = 0; c < ncond; c++) {
+    nf = DYN_LIST_N(spectra[c]);
+    if (!(s = dynListSpecVals(spectra[c], nf)) ||
+	!dynListSpecCounts(conds[c], &ntrials, &ntapers)) goto bad;
+    lo = (double *) malloc((nf ? nf : 1)*sizeof(double));
+    hi = (double *) malloc((nf ? nf : 1)*sizeof(double));
+    if (!lo || !hi) goto bad;
+    if (method == 1) {
+      dof = 2.0*ntrials*ntapers;
+      if (nsp) dof = floor(1.0/(1.0/dof + 1.0/(2.0*nsp[c])));
+      ql = dlChi2Inv(1.0-p/2.0, dof);
+      qu = dlChi2Inv(p/2.0, dof);
+      for (f = 0; f < nf; f++) {
+	lo[f] = s[f]*dof/ql;
+	hi[f] = s[f]*dof/qu;
       }
     }
-    break;
-  case DF_CHAR:
-    {
-      int duration = stop-start+1;
-      char *vals = (char *) DYN_LIST_VALS(dl);
-      float *data = (float *) calloc(DYN_LIST_N(dl),sizeof(float));
-      float *counts;      
-      sdf = dfuCreateDynList(DF_FLOAT, length);
+    else {
+      int n = ntrials*ntapers;
+      if (n < 2 || !(z = dynListSpecGather(conds[c], nf))) goto bad;
+      dlSpecJackknife(z, n, nf, s, dlTInv(1.0-p/2.0, n-1.0), lo, hi);
+      free(z);
+    }
+    dfuMoveDynListList(lower, dynListSpecFloats(lo, nf));
+    dfuMoveDynListList(upper, dynListSpecFloats(hi, nf));
+    free(s); free(lo); free(hi);
+    s = lo = hi = NULL;
+  }
+  if (nsp) free(nsp);
 
-      for (i = 0; i < DYN_LIST_N(dl); i++) 
-	data[i] = vals[i];
+  list = dfuCreateDynList(DF_LIST, 2);
+  dfuMoveDynListList(list, lower);
+  dfuMoveDynListList(list, upper);
+  return list;
 
-      counts = sdfMakeAdaptiveSdf(start, duration, data, DYN_LIST_N(dl), 
-				  ksd, nsd);
-      if (counts) {
-	for (i = 0; i < duration; i+=resol) 
-	  dfuAddDynListFloat(sdf, counts[i]);
-	free(data);
-	free(counts);
-      }
-      else {
-	for (i = 0; i < duration; i+=resol) dfuAddDynListFloat(sdf, 0.0);
-      }
-    }
-    break;
-  case DF_LIST:
-    {
-      DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-      DYN_LIST *cursdf = NULL;
-      DYN_LIST *counts, *newcounts, *div;
+ bad:
+  if (s) free(s);
+  if (lo) free(lo);
+  if (hi) free(hi);
+  if (nsp) free(nsp);
+  dfuFreeDynList(lower);
+  dfuFreeDynList(upper);
+  return NULL;
+}
 
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	counts = dynListParzenList(vals[i], start, stop, ksd, nsd, resol);
-	if (i) {
-	  newcounts = dynListArithListList(counts, cursdf, DL_MATH_ADD);
-	  dfuFreeDynList(cursdf);
-	  dfuFreeDynList(counts);
-	  cursdf = newcounts;
-	}
-	else {
-	  cursdf = counts;
-	}
+/*
+ * dynListCohErr - statistics at level p for the coherence magnitudes C
+ * of each condition, from the tapered transforms J1 and J2 of the
+ * condition's trials: the magnitude above which coherence is
+ * significant, lower and upper limits for the magnitude and the
+ * standard deviation of the phase.  Method 1 gives the asymptotic
+ * phase deviation and no limits; method 2 gives jackknife estimates.
+ * The degrees of freedom are corrected for the spike counts in
+ * numspks1 and numspks2 if given.
+ */
+
+DYN_LIST *dynListCohErr(DYN_LIST *C, DYN_LIST *J1, DYN_LIST *J2, double p,
+			int method, DYN_LIST *numspks1, DYN_LIST *numspks2)
+{
+  DYN_LIST **cohs, **conds1, **conds2, *conf, *lower, *upper, *phis;
+  DYN_LIST *list, *limits;
+  double *cm = NULL, *lo = NULL, *hi = NULL, *ph = NULL;
+  double *nsp1 = NULL, *nsp2 = NULL, *z1, *z2, dof, dof1, dof2;
+  int c, f, nf, ncond, ntrials, ntapers, n, ok = 0;
+
+  if (DYN_LIST_DATATYPE(C) != DF_LIST || DYN_LIST_DATATYPE(J1) != DF_LIST ||
+      DYN_LIST_DATATYPE(J2) != DF_LIST || DYN_LIST_N(C) != DYN_LIST_N(J1) ||
+      DYN_LIST_N(C) != DYN_LIST_N(J2)) return NULL;
+  if (!(p > 0.0 && p < 1.0) || (method != 1 && method != 2)) return NULL;
+  ncond = DYN_LIST_N(C);
+  if (numspks1 && (DYN_LIST_N(numspks1) != ncond ||
+		   !(nsp1 = dynListSpecVals(numspks1, ncond)))) return NULL;
+  if (numspks2 && (DYN_LIST_N(numspks2) != ncond ||
+		   !(nsp2 = dynListSpecVals(numspks2, ncond)))) {
+    if (nsp1) free(nsp1);
+    return NULL;
+  }
+
+  cohs = (DYN_LIST **) DYN_LIST_VALS(C);
+  conds1 = (DYN_LIST **) DYN_LIST_VALS(J1);
+  conds2 = (DYN_LIST **) DYN_LIST_VALS(J2);
+  conf = dfuCreateDynList(DF_FLOAT, ncond ? ncond : 1);
+  lower = dfuCreateDynList(DF_LIST, ncond ? ncond : 1);
+  upper = dfuCreateDynList(DF_LIST, ncond ? ncond : 1);
+  phis = dfuCreateDynList(DF_LIST, ncond ? ncond : 1);
+  for (c = 0; c < ncond; c++) {
+    nf = DYN_LIST_N(cohs[c]);
+    if (!(cm = dynListSpecVals(cohs[c], nf)) ||
+	!dynListSpecCounts(conds1[c], &ntrials, &ntapers)) goto done;
+    lo = (double *) malloc((nf ? nf : 1)*sizeof(double));
+    hi = (double *) malloc((nf ? nf : 1)*sizeof(double));
+    ph = (double *) malloc((nf ? nf : 1)*sizeof(double));
+    if (!lo || !hi || !ph) goto done;
+
+    dof = dof1 = dof2 = 2.0*ntrials*ntapers;
+    if (nsp1) dof1 = floor(2.0*nsp1[c]*dof/(2.0*nsp1[c]+dof));
+    if (nsp2) dof2 = floor(2.0*nsp2[c]*dof/(2.0*nsp2[c]+dof));
+    dof = (dof1 < dof2) ? dof1 : dof2;
+    dfuAddDynListFloat(conf, (float) sqrt(1.0-pow(p, 1.0/(dof/2.0-1.0))));
+
+    if (method == 1) {
+      for (f = 0; f < nf; f++) {
+	if (fabs(cm[f]-1.0) >= 1.0e-16)
+	  ph[f] = sqrt((2.0/dof)*(1.0/(cm[f]*cm[f]) - 1.0));
+	else ph[f] = 0.0;
       }
-      div = dfuCreateDynList(DF_FLOAT, 1);
-      dfuAddDynListFloat(div, (float) DYN_LIST_N(dl));
-      sdf = dynListArithListList(cursdf, div, DL_MATH_DIV);
-      dfuFreeDynList(div);      
-      dfuFreeDynList(cursdf);
     }
-    break;
-  default:
-    return(NULL);
+    else {
+      n = ntrials*ntapers;
+      z1 = dynListSpecGather(conds1[c], nf);
+      z2 = dynListSpecGather(conds2[c], nf);
+      if (n < 2 || !z1 || !z2 || DYN_LIST_N(conds2[c]) != ntrials) {
+	if (z1) free(z1);
+	if (z2) free(z2);
+	goto done;
+      }
+      dlCohJackknife(z1, z2, n, nf, cm, dlTInv(1.0-p/2.0, dof-1.0),
+		     lo, hi, ph);
+      free(z1);
+      free(z2);
+      dfuMoveDynListList(lower, dynListSpecFloats(lo, nf));
+      dfuMoveDynListList(upper, dynListSpecFloats(hi, nf));
+    }
+    dfuMoveDynListList(phis, dynListSpecFloats(ph, nf));
+    free(cm); free(lo); free(hi); free(ph);
+    cm = lo = hi = ph = NULL;
+  }
+  ok = 1;
+
+ done:
+  if (cm) free(cm);
+  if (lo) free(lo);
+  if (hi) free(hi);
+  if (ph) free(ph);
+  if (nsp1) free(nsp1);
+  if (nsp2) free(nsp2);
+  if (!ok) {
+    dfuFreeDynList(conf);
+    dfuFreeDynList(lower);
+    dfuFreeDynList(upper);
+    dfuFreeDynList(phis);
+    return NULL;
   }
 
-  return(sdf);
+  limits = dfuCreateDynList(DF_LIST, 2);
+  if (method == 1) {
+    /* only the jackknife gives limits for the magnitude */
+    dfuFreeDynList(lower);
+    dfuFreeDynList(upper);
+    lower = dfuCreateDynList(DF_STRING, 1);
+    dfuAddDynListString(lower, "specify jackknife");
+    upper = dfuCopyDynList(lower);
+  }
+  dfuMoveDynListList(limits, lower);
+  dfuMoveDynListList(limits, upper);
+  list = dfuCreateDynList(DF_LIST, 3);
+  dfuMoveDynListList(list, conf);
+  dfuMoveDynListList(list, limits);
+  dfuMoveDynListList(list, phis);
+  return list;
+}
+
+/*
+ * dynListSpecQuantile - chi-square (or, with tdist, Student's t)
+ * quantiles of the probabilities p on df degrees of freedom; either
+ * list may have one element
+ */
+
+DYN_LIST *dynListSpecQuantile(DYN_LIST *p, DYN_LIST *df, int tdist)
+{
+  double *pv, *dv, *q;
+  DYN_LIST *list;
+  int i, n;
+
+  if (DYN_LIST_N(p) != DYN_LIST_N(df) && DYN_LIST_N(p) != 1 &&
+      DYN_LIST_N(df) != 1) return NULL;
+  n = (DYN_LIST_N(p) > DYN_LIST_N(df)) ? DYN_LIST_N(p) : DYN_LIST_N(df);
+  if (DYN_LIST_N(p) == 0 || DYN_LIST_N(df) == 0) n = 0;
+  pv = dynListSpecVals(p, DYN_LIST_N(p));
+  dv = dynListSpecVals(df, DYN_LIST_N(df));
+  q = (double *) malloc((n ? n : 1)*sizeof(double));
+  if (!pv || !dv || !q) {
+    if (pv) free(pv);
+    if (dv) free(dv);
+    if (q) free(q);
+    return NULL;
+  }
+  for (i = 0; i < n; i++) {
+    double pi = pv[DYN_LIST_N(p) == 1 ? 0 : i];
+    double di = dv[DYN_LIST_N(df) == 1 ? 0 : i];
+    q[i] = tdist ? dlTInv(pi, di) : dlChi2Inv(pi, di);
+  }
+  list = dynListSpecFloats(q, n);
+  free(pv);
+  free(dv);
+  free(q);
+  return list;
 }
 
 DYN_LIST *dynListDiffList(DYN_LIST *dl, int lag)
@@ -8369,13 +9059,7 @@ DYN_LIST *dynListAnyLists(DYN_LIST *dl)
     
     if (all_scalars) {
       /* All children are flat - return flat DF_LONG list */
-      retlist = dfuCreateDynList(DF_LONG, DYN_LIST_N(dl));
-      if (!retlist) return NULL;
-      
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-        dfuAddDynListLong(retlist, dynListAnyFlat(vals[i]));
-      }
-      return retlist;
+      return dynListReduceLongLists(dl, dynListAnyFlat);
     }
     else {
       /* Mixed or nested - recurse and build list of lists */
@@ -8431,13 +9115,7 @@ DYN_LIST *dynListAllLists(DYN_LIST *dl)
     
     if (all_scalars) {
       /* All children are flat - return flat DF_LONG list */
-      retlist = dfuCreateDynList(DF_LONG, DYN_LIST_N(dl));
-      if (!retlist) return NULL;
-      
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-        dfuAddDynListLong(retlist, dynListAllFlat(vals[i]));
-      }
-      return retlist;
+      return dynListReduceLongLists(dl, dynListAllFlat);
     }
     else {
       /* Mixed or nested - recurse and build list of lists */
@@ -9065,6 +9743,7 @@ int dynListSetValLong(DYN_LIST *dl, int i, int val)
 {
   if (!dl) return(0);
   if (i < 0 || DYN_LIST_N(dl) <= i) return(0);
+  if (!dfuUnshareDynList(dl)) return(0);
 
   switch (DYN_LIST_DATATYPE(dl)) {
   case DF_LONG:
@@ -9196,7 +9875,7 @@ int dynListPrintVal(DYN_LIST *dl, int i, FILE *stream)
     {
       DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
       fprintf(stream,DLFormatTable[FMT_LIST], DYN_LIST_DATATYPE(vals[i]), 
-	      DYN_LIST_N(vals[i]));
+	      (int) DYN_LIST_N(vals[i]));
     }
     break;
   case DF_STRING:
@@ -9248,77 +9927,126 @@ static int dynListLessThanString(const void *a, const void *b)
 }
 
 
-static int dynListLessThanFloatI(const void *a, const void *b)
+static int dynListLessThanStringI(const void *a, const void *b)
 { 
-  const FLOAT_I *x = a;
-  const FLOAT_I *y = b;
-  if (x->val > y->val) return 1;
-  if (x->val == y->val) return 0;
-  return -1;
+  const STRING_I *x = a;
+  const STRING_I *y = b;
+  int r = strcmp(x->val,y->val);
+  /* ties keep their order, like the numeric index sorts */
+  if (!r) return(x->i - y->i);
+  return(r);
 }
 
-static int dynListLessThanCharI(const void *a, const void *b)
-{ 
-  const CHAR_I *x = a;
-  const CHAR_I *y = b;
-  return(x->val - y->val);
+
+/*
+ * Dictionary encoded string lists keep their string table in sorted
+ * order, so sorting, ranking and finding uniques can be done with
+ * counts over the codes, and the results share the table.
+ */
+
+static int *dynListDictCounts(DYN_LIST *dl)
+{
+  int i, *codes = DYN_LIST_CODES(dl);
+  int *counts = (int *) calloc(DYN_LIST_DICT(dl)->nstrings+1, sizeof(int));
+  if (!counts) return NULL;
+  for (i = 0; i < DYN_LIST_N(dl); i++) counts[codes[i]]++;
+  return counts;
+}
+
+static DYN_LIST *dynListSortDictList(DYN_LIST *dl)
+{
+  int i, j, k = 0, *counts, *sorted;
+  DYN_LIST *result;
+
+  if (!(counts = dynListDictCounts(dl))) return NULL;
+  sorted = (int *) malloc((DYN_LIST_N(dl)+1)*sizeof(int));
+  if (!sorted) {
+    free(counts);
+    return NULL;
+  }
+  for (i = 0; i < DYN_LIST_DICT(dl)->nstrings; i++)
+    for (j = 0; j < counts[i]; j++) sorted[k++] = i;
+  result = dfuCreateDictDynList("", DYN_LIST_DICT(dl), k, sorted);
+  free(sorted);
+  free(counts);
+  return result;
+}
+
+static DYN_LIST *dynListSortDictListIndices(DYN_LIST *dl)
+{
+  int i, n = DYN_LIST_DICT(dl)->nstrings, offset = 0, count;
+  int *counts, *indices, *codes = DYN_LIST_CODES(dl);
+
+  if (!(counts = dynListDictCounts(dl))) return NULL;
+  indices = (int *) malloc((DYN_LIST_N(dl)+1)*sizeof(int));
+  if (!indices) {
+    free(counts);
+    return NULL;
+  }
+  for (i = 0; i < n; i++) {
+    count = counts[i];
+    counts[i] = offset;
+    offset += count;
+  }
+  /* stable, like the qsort of string/index pairs */
+  for (i = 0; i < DYN_LIST_N(dl); i++) indices[counts[codes[i]]++] = i;
+  free(counts);
+  return dfuCreateDynListWithVals(DF_LONG, DYN_LIST_N(dl), indices);
 }
 
-static int dynListLessThanLongI(const void *a, const void *b)
-{ 
-  const LONG_I *x = a;
-  const LONG_I *y = b;
-  return(x->val - y->val);
+static DYN_LIST *dynListUniqueDictList(DYN_LIST *dl)
+{
+  int i, k = 0, *counts;
+  DYN_LIST *result;
+
+  if (!(counts = dynListDictCounts(dl))) return NULL;
+  for (i = 0; i < DYN_LIST_DICT(dl)->nstrings; i++)
+    if (counts[i]) counts[k++] = i;
+  result = dfuCreateDictDynList("", DYN_LIST_DICT(dl), k, counts);
+  free(counts);
+  return result;
 }
 
-static int dynListLessThanShortI(const void *a, const void *b)
-{ 
-  const SHORT_I *x = a;
-  const SHORT_I *y = b;
-  return(x->val - y->val);
-}
+static DYN_LIST *dynListUniqueNoSortDictList(DYN_LIST *dl)
+{
+  int i, k = 0, *codes = DYN_LIST_CODES(dl), *uniques;
+  DYN_LIST *result;
 
-static int dynListLessThanStringI(const void *a, const void *b)
-{ 
-  const STRING_I *x = a;
-  const STRING_I *y = b;
-  return(strcmp(x->val,y->val));
+  uniques = (int *) malloc((DYN_LIST_N(dl)+1)*sizeof(int));
+  if (!uniques) return NULL;
+  for (i = 0; i < DYN_LIST_N(dl); i++)
+    if (!i || codes[i] != codes[i-1]) uniques[k++] = codes[i];
+  result = dfuCreateDictDynList("", DYN_LIST_DICT(dl), k, uniques);
+  free(uniques);
+  return result;
 }
 
-
 DYN_LIST *dynListSortList(DYN_LIST *d1)
 {
   DYN_LIST *dl;
   if (!d1) return(NULL);
+
+  if (DYN_LIST_FLAGS(d1) & DL_DICT) return(dynListSortDictList(d1));
   
-  if (DYN_LIST_DATATYPE(d1) != DF_LIST)
+  if (DYN_LIST_DATATYPE(d1) != DF_LIST) {
     dl = dfuCopyDynList(d1);	/* Will sort in place */
+    if (!dfuUnshareDynList(dl)) {
+      dfuFreeDynList(dl);
+      return(NULL);
+    }
+  }
   else
     dl = dfuCreateDynList(DF_LIST, DYN_LIST_N(d1));
 
   switch (DYN_LIST_DATATYPE(dl)) {
   case DF_LONG:
-    {
-      int *vals = (int *) DYN_LIST_VALS(dl);
-      qsort(vals, DYN_LIST_N(dl), sizeof(int), dynListLessThanLong);
-    }
-  break;
   case DF_SHORT:
-    {
-      short *vals = (short *) DYN_LIST_VALS(dl);
-      qsort(vals, DYN_LIST_N(dl), sizeof(short), dynListLessThanShort);
-    }
-  break;
   case DF_FLOAT:
-    { 
-      float *vals = (float *) DYN_LIST_VALS(dl);
-      qsort(vals, DYN_LIST_N(dl), sizeof(float), dynListLessThanFloat);
-    }
-  break;
   case DF_CHAR:
-    {
-      char *vals = (char *) DYN_LIST_VALS(dl);
-      qsort(vals, DYN_LIST_N(dl), sizeof(char), dynListLessThanChar);
+    if (!dlSortValues(DYN_LIST_DATATYPE(dl), DYN_LIST_N(dl),
+		      DYN_LIST_VALS(dl))) {
+      dfuFreeDynList(dl);
+      return(NULL);
     }
   break;
   case DF_STRING:
@@ -9351,6 +10079,8 @@ DYN_LIST *dynListSortListIndices(DYN_LIST *dl)
   DYN_LIST *indices;
   if (!dl) return(NULL);
 
+  if (DYN_LIST_FLAGS(dl) & DL_DICT) return(dynListSortDictListIndices(dl));
+
   if (DYN_LIST_DATATYPE(dl) == DF_LIST) 
     indices = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
   else 
@@ -9360,67 +10090,19 @@ DYN_LIST *dynListSortListIndices(DYN_LIST *dl)
   
   switch (DYN_LIST_DATATYPE(dl)) {
   case DF_LONG:
-    {
-      int i;
-      int *vals = (int *) DYN_LIST_VALS(dl);
-      LONG_I *li = (LONG_I *) calloc(DYN_LIST_N(dl), sizeof(LONG_I));
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	li[i].i = i; 
-	li[i].val = vals[i];
-      }
-      qsort(li, DYN_LIST_N(dl), sizeof(LONG_I), dynListLessThanLongI);
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	dfuAddDynListLong(indices, li[i].i);
-      }
-      free((void *) li);
-    }
-  break;
   case DF_SHORT:
-    {
-      int i;
-      short *vals = (short *) DYN_LIST_VALS(dl);
-      SHORT_I *li = (SHORT_I *) calloc(DYN_LIST_N(dl), sizeof(SHORT_I));
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	li[i].i = i; 
-	li[i].val = vals[i];
-      }
-      qsort(li, DYN_LIST_N(dl), sizeof(SHORT_I), dynListLessThanShortI);
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	dfuAddDynListLong(indices, li[i].i);
-      }
-      free((void *) li);
-    }
-  break;
   case DF_FLOAT:
-    {
-      int i;
-      float *vals = (float *) DYN_LIST_VALS(dl);
-      FLOAT_I *li = (FLOAT_I *) calloc(DYN_LIST_N(dl), sizeof(FLOAT_I));
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	li[i].i = i; 
-	li[i].val = vals[i];
-      }
-      qsort(li, DYN_LIST_N(dl), sizeof(FLOAT_I), dynListLessThanFloatI);
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	dfuAddDynListLong(indices, li[i].i);
-      }
-      free((void *) li);
-    }
-  break;
   case DF_CHAR:
     {
-      int i;
-      char *vals = (char *) DYN_LIST_VALS(dl);
-      CHAR_I *li = (CHAR_I *) calloc(DYN_LIST_N(dl), sizeof(CHAR_I));
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	li[i].i = i; 
-	li[i].val = vals[i];
-      }
-      qsort(li, DYN_LIST_N(dl), sizeof(CHAR_I), dynListLessThanCharI);
-      for (i = 0; i < DYN_LIST_N(dl); i++) { 
-	dfuAddDynListLong(indices, li[i].i);
+      int *order = (int *) malloc((DYN_LIST_N(dl)+1)*sizeof(int));
+      if (!order || !dlSortIndices(DYN_LIST_DATATYPE(dl), DYN_LIST_N(dl),
+				   DYN_LIST_VALS(dl), order) ||
+	  dfuAppendDynListN(indices, order, DYN_LIST_N(dl)) < 0) {
+	if (order) free(order);
+	dfuFreeDynList(indices);
+	return NULL;
       }
-      free((void *) li);
+      free(order);
     }
   break;
   case DF_STRING:
@@ -9635,6 +10317,7 @@ int dynListCompareElements(DYN_LIST *l1, int i1, DYN_LIST *l2, int i2)
     {
       char **v1 = (char **) DYN_LIST_VALS(l1);
       char **v2 = (char **) DYN_LIST_VALS(l2);
+      if (v1[i1] == v2[i2]) return(0); /* same dictionary string */
       return(dynListLessThanString(&v1[i1], &v2[i2]));
     }
     break;
@@ -9699,6 +10382,9 @@ static DYN_LIST *dynListDoUniqueNoSortList(DYN_LIST *sortlist)
 
   if (DYN_LIST_DATATYPE(sortlist) == DF_LIST) 
     return(NULL);
+
+  if (DYN_LIST_FLAGS(sortlist) & DL_DICT)
+    return(dynListUniqueNoSortDictList(sortlist));
   
   uniques = dfuCreateDynList(DYN_LIST_DATATYPE(sortlist), 
 			     DYN_LIST_N(sortlist)/2+1);
@@ -9753,6 +10439,55 @@ static DYN_LIST *dynListDoUniqueNoSortList(DYN_LIST *sortlist)
   return(uniques);
 }
 
+/*
+ * dl_unique hashes lists of at least DL_UNIQUE_HASH_MIN elements.
+ * Numeric lists already radix sort in linear time, so hashing only
+ * pays while there are few distinct values: past one per
+ * DL_UNIQUE_HASH_RATIO elements it gives up and the list is sorted.
+ */
+#define DL_UNIQUE_HASH_MIN   16
+#define DL_UNIQUE_HASH_RATIO 32
+
+/*
+ * dynListHashUniqueList - sorted uniques of a flat list by hashing its
+ * values once and sorting only the distinct ones (NULL to fall back to
+ * sorting the list).  The result is the same as sorting the whole list
+ * and dropping repeats: the first of equal values (e.g. 0 and -0) is
+ * kept and every NaN is kept.
+ */
+
+static DYN_LIST *dynListHashUniqueList(DYN_LIST *dl)
+{
+  int i, nan = -1, limit = DYN_LIST_N(dl);
+  DL_GROUPING *g;
+  DYN_LIST *uniques, *sorted;
+
+  if (DYN_LIST_DATATYPE(dl) != DF_STRING) limit /= DL_UNIQUE_HASH_RATIO;
+  if (!(g = dlGroupRowsMax(1, &dl, limit))) return(NULL);
+  uniques = dlGroupKeyList(g, 0);
+
+  if (DYN_LIST_DATATYPE(dl) == DF_STRING) {
+    sorted = dynListSortList(uniques);
+    dfuFreeDynList(uniques);
+    uniques = sorted;
+  }
+  else if (uniques) {
+    dlSortValues(DYN_LIST_DATATYPE(dl), DYN_LIST_N(uniques),
+		 DYN_LIST_VALS(uniques));
+    if (DYN_LIST_DATATYPE(dl) == DF_FLOAT) {
+      float *vals = (float *) DYN_LIST_VALS(dl);
+      for (i = 0; i < g->ngroups; i++)
+	if (isnan(vals[g->first[i]])) nan = g->first[i];
+      if (nan >= 0) {
+	for (i = nan+1; i < DYN_LIST_N(dl); i++)
+	  if (isnan(vals[i])) dfuAddDynListFloat(uniques, vals[i]);
+      }
+    }
+  }
+  dlGroupFree(g);
+  return(uniques);
+}
+
 DYN_LIST *dynListUniqueList(DYN_LIST *dl)
 {
   DYN_LIST *newlist, *d;
@@ -9770,7 +10505,13 @@ DYN_LIST *dynListUniqueList(DYN_LIST *dl)
       if (!dl) return(NULL);
       if (DYN_LIST_N(dl) == 0) 
 	return dfuCreateDynList(DYN_LIST_DATATYPE(dl), 1);
+      if (DYN_LIST_FLAGS(dl) & DL_DICT)
+	return(dynListUniqueDictList(dl));
       
+      if (DYN_LIST_N(dl) >= DL_UNIQUE_HASH_MIN &&
+	  (uniques = dynListHashUniqueList(dl)))
+	return(uniques);
+
       l = dfuCopyDynList(dl);
       sortlist = dynListSortList(l);
       uniques = dynListDoUniqueNoSortList(sortlist);
@@ -9844,6 +10585,108 @@ DYN_LIST *dynListUniqueNoSortList(DYN_LIST *dl)
 }
 
 
+/*
+ * dynListUniqueOrderedList - unique elements in order of first
+ * appearance (NaNs count as one value)
+ */
+
+DYN_LIST *dynListUniqueOrderedList(DYN_LIST *dl)
+{
+  DYN_LIST *newlist, *d;
+  DL_GROUPING *g;
+  int i;
+
+  if (!dl) return(NULL);
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG:
+  case DF_SHORT:
+  case DF_FLOAT:
+  case DF_CHAR:
+  case DF_STRING:
+    if (DYN_LIST_N(dl) == 0) 
+      return dfuCreateDynList(DYN_LIST_DATATYPE(dl), 1);
+    if (!(g = dlGroupRows(1, &dl))) return(NULL);
+    newlist = dlGroupKeyList(g, 0);
+    dlGroupFree(g);
+    return(newlist);
+  case DF_LIST:
+    {
+      DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+      newlist = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
+      for (i = 0; i < DYN_LIST_N(dl); i++) {
+	d = dynListUniqueOrderedList(vals[i]);
+	if (d) dfuMoveDynListList(newlist, d);
+	else { 
+	  dfuFreeDynList(newlist);
+	  return NULL;
+	}
+      }
+      return(newlist);
+    }
+  }
+  return(NULL);
+}
+
+/*
+ * dynListValueCounts - a list holding the sorted unique values of dl
+ * and the number of times each occurs, found in one hashing pass
+ * (NaNs count as one value)
+ */
+
+DYN_LIST *dynListValueCounts(DYN_LIST *dl)
+{
+  DYN_LIST *newlist, *d;
+  DL_GROUPING *g;
+  int i, *counts;
+
+  if (!dl) return(NULL);
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG:
+  case DF_SHORT:
+  case DF_FLOAT:
+  case DF_CHAR:
+  case DF_STRING:
+    if (!(g = dlGroupRows(1, &dl))) return(NULL);
+    if (!dlGroupSortGroups(g)) {
+      dlGroupFree(g);
+      return(NULL);
+    }
+    newlist = dfuCreateDynList(DF_LIST, 2);
+    dfuMoveDynListList(newlist, dlGroupKeyList(g, 0));
+    if (!g->ngroups) 
+      dfuMoveDynListList(newlist, dfuCreateDynList(DF_LONG, 1));
+    else {
+      counts = (int *) malloc(g->ngroups*sizeof(int));
+      for (i = 0; i < g->ngroups; i++)
+	counts[i] = g->offsets[i+1]-g->offsets[i];
+      dfuMoveDynListList(newlist, 
+			 dfuCreateDynListWithVals(DF_LONG, g->ngroups, counts));
+    }
+    dlGroupFree(g);
+    if (DYN_LIST_N(newlist) != 2) {
+      dfuFreeDynList(newlist);
+      return(NULL);
+    }
+    return(newlist);
+  case DF_LIST:
+    {
+      DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+      newlist = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
+      for (i = 0; i < DYN_LIST_N(dl); i++) {
+	d = dynListValueCounts(vals[i]);
+	if (d) dfuMoveDynListList(newlist, d);
+	else { 
+	  dfuFreeDynList(newlist);
+	  return NULL;
+	}
+      }
+      return(newlist);
+    }
+  }
+  return(NULL);
+}
+
+
 
 
 DYN_LIST *dynListRankOrderedList(DYN_LIST *dl)
@@ -10329,6 +11172,28 @@ DYN_LIST *dynListSortListByList(DYN_LIST *data, DYN_LIST *categories)
   uniques = dynListUniqueList(categories);
   if (!uniques) return NULL;
   sorted = dfuCreateDynList(DF_LIST, DYN_LIST_N(uniques));
+
+  /* dictionary encoded categories are binned by code in one pass */
+  if (dfuGetDynListDict(categories) &&
+      dfuGetDynListDict(uniques) == dfuGetDynListDict(categories)) {
+    int *slots, *codes = DYN_LIST_CODES(categories);
+    int *ucodes = DYN_LIST_CODES(uniques);
+    DYN_LIST **lists;
+    int n = DYN_LIST_N(data) < DYN_LIST_N(categories) ?
+      DYN_LIST_N(data) : DYN_LIST_N(categories);
+    slots = (int *) calloc(DYN_LIST_DICT(uniques)->nstrings, sizeof(int));
+    for (i = 0; i < DYN_LIST_N(uniques); i++) {
+      dfuMoveDynListList(sorted, dfuCreateDynList(DYN_LIST_DATATYPE(data), 10));
+      slots[ucodes[i]] = i;
+    }
+    lists = (DYN_LIST **) DYN_LIST_VALS(sorted);
+    for (j = 0; j < n; j++)
+      dynListCopyElement(data, j, lists[slots[codes[j]]]);
+    free(slots);
+    dfuFreeDynList(uniques);
+    return(sorted);
+  }
+
   newlist = dfuCreateDynList(DYN_LIST_DATATYPE(data), 10);
 
   for (i = 0; i < DYN_LIST_N(uniques); i++) {
@@ -10348,12 +11213,41 @@ DYN_LIST *dynListSortListByList(DYN_LIST *data, DYN_LIST *categories)
 }
 
 
+/*
+ * Find element i of dl in the sorted unique list uniques; -1 if absent
+ */
+
+static int dynListFindUnique(DYN_LIST *uniques, DYN_LIST *dl, int i)
+{
+  int lo = 0, hi = DYN_LIST_N(uniques)-1, mid, c;
+  while (lo <= hi) {
+    mid = (lo+hi)/2;
+    c = dynListCompareElements(dl, i, uniques, mid);
+    if (!c) return mid;
+    if (c < 0) hi = mid-1;
+    else lo = mid+1;
+  }
+  return -1;
+}
+
+/*
+ * dynListSortListByLists - split data into one list for every crossing
+ * of the unique values of the selection lists (first list varying
+ * fastest, as dl_uniqueCross), holding the rows whose categories match.
+ *
+ * Rows are grouped by hashing their category values once; each group
+ * is then looked up in the selection uniques and its rows copied to
+ * the matching crossing, so the cost is linear in the number of rows
+ * rather than rows times crossings.
+ */
+
 DYN_LIST *dynListSortListByLists(DYN_LIST *data, DYN_LIST *categories, 
 				 DYN_LIST *selections)
 {
-  int i, j, k, ntypes, match;
-  DYN_LIST *uniques, *sorted, **newlists, *list;
+  int i, k, ncats, ncross, stride, pos, *cross = NULL, *counts = NULL;
+  DYN_LIST *sorted = NULL, **newlists;
   DYN_LIST **catlists, **uniqlists, **selectlists;
+  DL_GROUPING *g = NULL;
   
   if (!data || !categories || !selections) return(NULL);
 
@@ -10371,87 +11265,62 @@ DYN_LIST *dynListSortListByLists(DYN_LIST *data, DYN_LIST *categories,
       return(NULL);
   }
 
-  uniques  = dynListUniqueCrossLists(selections);
-  if (!uniques) return NULL;
-  uniqlists = (DYN_LIST **) DYN_LIST_VALS(uniques);
+  ncats = DYN_LIST_N(categories);
+  if (!ncats || DYN_LIST_N(selections) < ncats) return(NULL);
 
-  if (!uniqlists || !DYN_LIST_N(uniqlists[0])) {
-    dfuFreeDynList(uniques);
-    return NULL;
+  uniqlists = (DYN_LIST **) calloc(ncats, sizeof(DYN_LIST *));
+  for (k = 0, ncross = 1; k < ncats; k++) {
+    uniqlists[k] = dynListUniqueList(selectlists[k]);
+    if (!uniqlists[k] || !DYN_LIST_N(uniqlists[k])) goto done;
+    ncross *= DYN_LIST_N(uniqlists[k]);
   }
 
-  ntypes   = DYN_LIST_N(uniqlists[0]);
-  sorted   = dfuCreateDynList(DF_LIST, DYN_LIST_N(uniques));
-  
-  for (i = 0; i < ntypes; i++) {
-    list = dfuCreateDynList(DYN_LIST_DATATYPE(data), 10);
-    dfuMoveDynListList(sorted, list);
-  }
-  newlists = (DYN_LIST **) DYN_LIST_VALS(sorted);
+  if (!(g = dlGroupRows(ncats, catlists))) goto done;
 
-  for (i = 0; i < DYN_LIST_N(data); i++) {
-    for (j = 0, match = 0; j < ntypes && !match; j++) {
-      for (k = 0, match = 1; k < DYN_LIST_N(categories) && match; k++) {
-	if (dynListCompareElements(catlists[k], i, uniqlists[k], j)) {
-	  match = 0;
-	}
+  /* crossing of each group (-1 if not among the selections) */
+  cross = (int *) malloc((g->ngroups+1)*sizeof(int));
+  counts = (int *) calloc(ncross, sizeof(int));
+  for (i = 0; i < g->ngroups; i++) {
+    for (k = 0, stride = 1, cross[i] = 0; k < ncats; k++) {
+      if ((pos = dynListFindUnique(uniqlists[k], catlists[k], 
+				   g->first[i])) < 0) {
+	cross[i] = -1;
+	break;
       }
-      if (match) dynListCopyElement(data, i, newlists[j]);
+      cross[i] += pos*stride;
+      stride *= DYN_LIST_N(uniqlists[k]);
     }
-  }
-  
-  dfuFreeDynList(uniques);
-  
-  return(sorted);
-}
-
-DYN_LIST *dynListGroupListByLists(DYN_LIST *data, DYN_LIST *categories)
-{
-  int i, j, k, ntypes, match;
-  DYN_LIST *uniques, *sorted, **newlists, *list;
-  DYN_LIST **catlists, **uniqlists;
-  
-  if (!data || !categories) return(NULL);
-
-  if (DYN_LIST_DATATYPE(categories) != DF_LIST) return(NULL);
-  catlists = (DYN_LIST **) DYN_LIST_VALS(categories);
-  for (i = 0; i < DYN_LIST_N(categories); i++) {
-    if (DYN_LIST_N(catlists[i]) != DYN_LIST_N(data)) return(NULL);
-  }
-  
-  uniques  = dynListUniqueCrossLists(categories);
-  uniqlists = (DYN_LIST **) DYN_LIST_VALS(uniques);
-
-  if (!uniqlists || !DYN_LIST_N(uniqlists[0])) {
-    dfuFreeDynList(uniques);
-    return NULL;
+    if (cross[i] >= 0) counts[cross[i]] += g->offsets[i+1]-g->offsets[i];
   }
 
-  ntypes   = DYN_LIST_N(uniqlists[0]);
-  sorted   = dfuCreateDynList(DF_LIST, DYN_LIST_N(uniques));
-  
-  for (i = 0; i < ntypes; i++) {
-    list = dfuCreateDynList(DYN_LIST_DATATYPE(data), 10);
-    dfuMoveDynListList(sorted, list);
+  sorted = dfuCreateDynList(DF_LIST, ncross);
+  for (i = 0; i < ncross; i++) {
+    dfuMoveDynListList(sorted, dfuCreateDynList(DYN_LIST_DATATYPE(data),
+						counts[i] ? counts[i] : 10));
   }
   newlists = (DYN_LIST **) DYN_LIST_VALS(sorted);
 
   for (i = 0; i < DYN_LIST_N(data); i++) {
-    for (j = 0, match = 0; j < ntypes && !match; j++) {
-      for (k = 0, match = 1; k < DYN_LIST_N(categories) && match; k++) {
-	if (dynListCompareElements(catlists[k], i, uniqlists[k], j)) {
-	  match = 0;
-	}
-      }
-      if (match) dynListCopyElement(data, i, newlists[j]);
-    }
+    if ((pos = cross[g->group[i]]) >= 0)
+      dynListCopyElement(data, i, newlists[pos]);
   }
-  
-  dfuFreeDynList(uniques);
+
+ done:
+  for (k = 0; k < ncats; k++)
+    if (uniqlists[k]) dfuFreeDynList(uniqlists[k]);
+  free(uniqlists);
+  if (cross) free(cross);
+  if (counts) free(counts);
+  dlGroupFree(g);
   
   return(sorted);
 }
 
+DYN_LIST *dynListGroupListByLists(DYN_LIST *data, DYN_LIST *categories)
+{
+  return(dynListSortListByLists(data, categories, categories));
+}
+
 
 
 DYN_LIST *dynListUniqueCrossLists(DYN_LIST *categories)
@@ -10665,10 +11534,26 @@ DYN_LIST *dynListCopyElementList(DYN_LIST *source, int i)
   return(dfuCopyDynList(element));
 }
 
+/*
+ * SDF_ADD_KERNEL - add the kernel (ksize taps from its centre out)
+ * around point s of fp, for the points inside 0..duration-1
+ */
+
+#define SDF_ADD_KERNEL(fp, duration, s, kernel, ksize)			\
+  {									\
+    int lo_ = ((s) < (ksize)-1) ? 0 : (s)-(ksize)+1;			\
+    int hi_ = ((s) > (duration)-(ksize)) ? (duration) : (s)+(ksize);	\
+    int t_;								\
+    for (t_ = lo_; t_ < hi_ && t_ < (s); t_++)				\
+      (fp)[t_] += (kernel)[(s)-t_];					\
+    for (t_ = ((s) > lo_) ? (s) : lo_; t_ < hi_; t_++)			\
+      (fp)[t_] += (kernel)[t_-(s)];					\
+  }
+
 float *sdfMakeSdf (float start, int duration, float *spikes, int nspikes,
 		   float *kernel, int ksize)
 {
-  int i, j, s, t;
+  int j, s;
   float *fp;
   int low=0, high=0, limit;
 
@@ -10698,32 +11583,31 @@ float *sdfMakeSdf (float start, int duration, float *spikes, int nspikes,
   }
   for (j = low; j <= high; j++) {
     s = spikes[j] - start;
-    if (s >= 0 && s < duration) fp[s] += kernel[0];
-    for (i = 1; i < ksize; i++) {
-      t = s+i; 
-      if (t < duration && t >= 0) fp[t] += kernel[i];
-      t = s-i;
-      if (t < duration && t >= 0) fp[t] += kernel[i];
-    }
+    SDF_ADD_KERNEL(fp, duration, s, kernel, ksize);
   }
   return fp;
 }
 
 
-float *sdfMakeKernel (float ksd, float nsd, int *ksize)
+static int sdfKernelSize (float ksd, float nsd)
 {
-  int i, ks;
-  float sum, denom, width;
-  float *kernel;
-  
+  int ks;
+  float width;
+
   width = nsd * ksd;
   ks = width + 0.5;
   if (!(ks & 1)) ++ks;
+  return ks;
+}
+
+static void sdfFillKernel (float ksd, int ks, float *kernel)
+{
+  int i;
+  float sum, denom;
+
   sum = 0.0;
   denom = - ksd * ksd;
   
-  if (!(kernel = (float *)calloc(ks, sizeof(float)))) return (NULL);
-  
   for (i = 0; i < ks; i++) {
     kernel[i] = (float) exp((i*i) / denom);
     sum += kernel[i];
@@ -10731,6 +11615,16 @@ float *sdfMakeKernel (float ksd, float nsd, int *ksize)
   
   for (i = 0; i < ks; i++)
     kernel[i] /= (2.0 * sum);
+}
+
+float *sdfMakeKernel (float ksd, float nsd, int *ksize)
+{
+  int ks;
+  float *kernel;
+  
+  ks = sdfKernelSize(ksd, nsd);
+  if (!(kernel = (float *)calloc(ks, sizeof(float)))) return (NULL);
+  sdfFillKernel(ksd, ks, kernel);
   
   *ksize = ks;
   return (kernel);
@@ -10740,7 +11634,7 @@ float *sdfMakeKernel (float ksd, float nsd, int *ksize)
 float *sdfMakeAdaptiveSdf (int start, int duration, float *spikes, 
 			   int nspikes, float pilot_sd, float nsd)
 {
-  int i, j, s, t, kindex;
+  int i, j, s, kindex;
   float *fp;
   int low=0, high=0, limit;
   
@@ -10754,6 +11648,7 @@ float *sdfMakeAdaptiveSdf (int start, int duration, float *spikes,
   int ksize, ksize_max;
 
   float *kernel = NULL;		/* These are for managing the variable */
+  int kalloc = 0;
 #ifdef KERNEL_TABLE
   float **kernels;		/* Kernel sizes                        */
   int   *ksizes;
@@ -10820,18 +11715,16 @@ float *sdfMakeAdaptiveSdf (int start, int duration, float *spikes,
     kindex = s = spikes[j] - start;
     if (kindex < 0) kindex = 0;
     if (kindex >= duration) kindex = duration-1;
-    if (kernel) free((void *) kernel);
-    
-    /* This should probably be done using a table... */
-    kernel = sdfMakeKernel (adapt_sd[kindex], nsd, &ksize);
 
-    if (s >= 0 && s < duration) fp[s] += kernel[0];
-    for (i = 1; i < ksize; i++) {
-      t = s+i; 
-      if (t < duration && t >= 0) fp[t] += kernel[i];
-      t = s-i;
-      if (t < duration && t >= 0) fp[t] += kernel[i];
+    /* each spike's kernel is built in one buffer, grown as needed */
+    ksize = sdfKernelSize(adapt_sd[kindex], nsd);
+    if (ksize > kalloc) {
+      if (kernel) free((void *) kernel);
+      kalloc = ksize;
+      if (!(kernel = (float *) malloc(kalloc*sizeof(float)))) break;
     }
+    sdfFillKernel(adapt_sd[kindex], ksize, kernel);
+    SDF_ADD_KERNEL(fp, duration, s, kernel, ksize);
   }
   
   if (kernel) free((void *) kernel);
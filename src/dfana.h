@@ -40,6 +40,7 @@ extern "C" {
 #endif
   
 int dynListSetMatherrCheck(int);
+int dynListGetMatherrCheck(void);
 
 int dynGetDatatypeID(char *tname, int *tid);
 char *dynGetDatatypeName(int tid);
@@ -135,6 +136,7 @@ int dynListIncrementCounter(DYN_LIST *dl);
 int dynListAddNullElement(DYN_LIST *newlist);
 
 DYN_LIST *dynListArithListList(DYN_LIST *l1, DYN_LIST *l2, int func);
+int dynListArithListListInPlace(DYN_LIST *l1, DYN_LIST *l2, int func);
 DYN_LIST *dynListAddListList(DYN_LIST *d1, DYN_LIST *d2);
 DYN_LIST *dynListSubListList(DYN_LIST *d1, DYN_LIST *d2);
 DYN_LIST *dynListMultListList(DYN_LIST *l1, DYN_LIST *l2);
@@ -165,6 +167,7 @@ DYN_LIST *dynMatrixColSums(DYN_LIST *M);
 DYN_LIST *dynMatrixRowSums(DYN_LIST *M);
 DYN_LIST *dynMatrixCenterRows(DYN_LIST *m, DYN_LIST *v);
 DYN_LIST *dynMatrixCenterCols(DYN_LIST *m, DYN_LIST *v);
+DYN_LIST *dynMatrixTranspose(DYN_LIST *m);
 
 DYN_LIST *dynMatrixAddFloat(DYN_LIST *m1, float);
 DYN_LIST *dynMatrixSubFloat(DYN_LIST *m1, float);
@@ -172,7 +175,15 @@ DYN_LIST *dynMatrixMultFloat(DYN_LIST *m1, float);
 DYN_LIST *dynMatrixDivFloat(DYN_LIST *m1, float);
 DYN_LIST *dynMatrixAdd(DYN_LIST *m1, DYN_LIST *m2);
 DYN_LIST *dynMatrixSubtract(DYN_LIST *m1, DYN_LIST *m2);
+int dynMatrixArithFloatInPlace(DYN_LIST *m, float k, int func);
+int dynMatrixArithInPlace(DYN_LIST *m, DYN_LIST *l, int func);
 DYN_LIST *dynMatrixMultiply(DYN_LIST *m1, DYN_LIST *m2);
+DYN_LIST *dynMatrixQR(DYN_LIST *m);
+DYN_LIST *dynMatrixCholesky(DYN_LIST *m);
+DYN_LIST *dynMatrixEigen(DYN_LIST *m);
+DYN_LIST *dynMatrixSVD(DYN_LIST *m);
+DYN_LIST *dynMatrixLstsq(DYN_LIST *x, DYN_LIST *y);
+DYN_LIST *dynMatrixPCA(DYN_LIST *m, int ncomps);
 
 int dynListDump(DYN_LIST *dl, FILE *stream);
 int dynListDumpAsRow(DYN_LIST *dl, FILE *stream, char separator);
@@ -219,6 +230,8 @@ DYN_LIST *dynListSortListIndices(DYN_LIST *dl);
 DYN_LIST *dynListBSortListIndices(DYN_LIST *dl);
 DYN_LIST *dynListUniqueList(DYN_LIST *dl);
 DYN_LIST *dynListUniqueNoSortList(DYN_LIST *dl);
+DYN_LIST *dynListUniqueOrderedList(DYN_LIST *dl);
+DYN_LIST *dynListValueCounts(DYN_LIST *dl);
 DYN_LIST *dynListTransposeList(DYN_LIST *dl);
 DYN_LIST *dynListTransposeListAt(DYN_LIST *dl, int level);
 DYN_LIST *dynListUniqueCrossLists(DYN_LIST *categories);
@@ -237,6 +250,8 @@ DYN_LIST *dynListCutList(DYN_LIST *dl, DYN_LIST *breaks);
 DYN_LIST *dynListRankOrderedList(DYN_LIST *dl);
 
 DYN_LIST *dynListMinMaxList(DYN_LIST *dl, int op);
+DYN_LIST **dynListApplyLists(DYN_LIST *dl,
+			     DYN_LIST *(*func)(DYN_LIST *, int), int op);
 DYN_LIST *dynListMinMaxPositions(DYN_LIST *dl, int op);
 
 DYN_LIST *dynListMaxLists(DYN_LIST *dl);
@@ -270,6 +285,8 @@ DYN_LIST *dynListSumColsList(DYN_LIST *dl);
 
 DYN_LIST *dynListHistLists(DYN_LIST *dl, DYN_LIST *range, int);
 DYN_LIST *dynListHistList(DYN_LIST *dl, DYN_LIST *range, int);
+DYN_LIST *dynListHist2D(DYN_LIST *x, DYN_LIST *y, DYN_LIST *xrange, int,
+			DYN_LIST *yrange, int);
 
 DYN_LIST *dynListStdLists(DYN_LIST *dl);
 DYN_LIST *dynListHStdLists(DYN_LIST *dl);
@@ -305,6 +322,26 @@ DYN_LIST *dynListParzenLists(DYN_LIST *dl, DYN_LIST *start, DYN_LIST *stop,
 			     float ksd, float nsd, int resolution);
 DYN_LIST *dynListParzenList(DYN_LIST *dl, float start, float stop, float ksd, 
 			    float nsd, int resol);
+DYN_LIST *dynListSdfAligned(DYN_LIST *dl, DYN_LIST *aligns, float pre,
+			    float post, float ksd, float nsd, int resolution,
+			    int parzen);
+
+DYN_LIST *dynListFft(DYN_LIST *re, DYN_LIST *im, int nfft, int inverse);
+DYN_LIST *dynListDpss(int n, double nw, int ntapers);
+DYN_LIST *dynListMtFft(DYN_LIST *dl, double nw, int ntapers, int pad,
+		       double fs, int point);
+DYN_LIST *dynListMtSpectrum(DYN_LIST *dl, double nw, int ntapers, int pad,
+			    double fs, int point);
+DYN_LIST *dynListMtSpecgram(DYN_LIST *dl, int win, int step, double nw,
+			    int ntapers, int pad, double fs, int point);
+DYN_LIST *dynListMtCoherence(DYN_LIST *dl1, DYN_LIST *dl2, double nw,
+			     int ntapers, int pad, double fs, int point1,
+			     int point2);
+DYN_LIST *dynListSpecErr(DYN_LIST *S, DYN_LIST *J, double p, int method,
+			 DYN_LIST *numspks);
+DYN_LIST *dynListCohErr(DYN_LIST *C, DYN_LIST *J1, DYN_LIST *J2, double p,
+			int method, DYN_LIST *numspks1, DYN_LIST *numspks2);
+DYN_LIST *dynListSpecQuantile(DYN_LIST *p, DYN_LIST *df, int tdist);
 
 
 int dynListMaxListLength(DYN_LIST *dl);
@@ -336,6 +373,7 @@ struct MathFunc1 {
 extern struct MathFunc1 Math1Table[];
 
 DYN_LIST *dynListMathOneArg(DYN_LIST *dl, int func_id);
+int dynListMathOneArgInPlace(DYN_LIST *dl, int func_id);
 
 EV_LIST *evGetList(OBS_P *obsp, int tag, int *np);
 int evGetTagID(char *tagName, int *tag);
@@ -22,6 +22,11 @@
 // Always print errors to stderr
 #define ERROR_PRINT(...) fprintf(stderr, __VA_ARGS__)
 
+// Field metadata marking a string column that was dictionary encoded.
+// The nanoarrow IPC writer cannot encode dictionary arrays, so such
+// columns are written as plain strings and re-encoded on reading.
+#define DG_ARROW_DICT_KEY "dlsh.dictionary"
+
 /*************************************************************************************/
 /********************************* SERIALIZATION *************************************/
 /*************************************************************************************/
@@ -60,9 +65,9 @@ static enum ArrowType get_ultimate_child_type(DYN_LIST* dl) {
     }
     
     // Look for first non-empty sublist to determine type
-    for (int i = 0; i < DYN_LIST_N(dl); i++) {
+    for (DL_SIZE i = 0; i < DYN_LIST_N(dl); i++) {
         if (!vals[i]) {
-            ERROR_PRINT("ERROR: NULL sublist at index %d\n", i);
+            ERROR_PRINT("ERROR: NULL sublist at index %lld\n", (long long) i);
             return NANOARROW_TYPE_NA;
         }
         
@@ -192,11 +197,11 @@ static int append_dynlist_data(DYN_LIST* dl, struct ArrowArray* array) {
     if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
         // List of lists - process each sublist
         DYN_LIST** vals = (DYN_LIST**)DYN_LIST_VALS(dl);
-        int n = DYN_LIST_N(dl);
+        DL_SIZE n = DYN_LIST_N(dl);
         
-        for (int i = 0; i < n; i++) {
+        for (DL_SIZE i = 0; i < n; i++) {
             if (!vals[i]) {
-                ERROR_PRINT("ERROR: NULL sublist at index %d\n", i);
+                ERROR_PRINT("ERROR: NULL sublist at index %lld\n", (long long) i);
                 return -1;
             }
             
@@ -212,42 +217,42 @@ static int append_dynlist_data(DYN_LIST* dl, struct ArrowArray* array) {
         }
     } else {
         // Primitive list - append all values
-        int n = DYN_LIST_N(dl);
+        DL_SIZE n = DYN_LIST_N(dl);
         
         switch (DYN_LIST_DATATYPE(dl)) {
             case DF_LONG: {
                 int* vals = (int*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendInt(array, vals[i]) != NANOARROW_OK) return -1;
                 }
                 break;
             }
             case DF_SHORT: {
                 short* vals = (short*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendInt(array, vals[i]) != NANOARROW_OK) return -1;
                 }
                 break;
             }
             case DF_CHAR: {
                 char* vals = (char*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendUInt(array, (uint64_t)(unsigned char)vals[i]) != NANOARROW_OK) return -1;
                 }
                 break;
             }
             case DF_FLOAT: {
                 float* vals = (float*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendDouble(array, (double)vals[i]) != NANOARROW_OK) return -1;
                 }
                 break;
             }
             case DF_STRING: {
                 char** vals = (char**)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (!vals[i]) {
-                        ERROR_PRINT("ERROR: NULL string at index %d\n", i);
+                        ERROR_PRINT("ERROR: NULL string at index %lld\n", (long long) i);
                         return -1;
                     }
                     struct ArrowStringView sv = { .data = vals[i], .size_bytes = strlen(vals[i]) };
@@ -288,8 +293,8 @@ static int dynlist_to_nanoarrow_array(DYN_LIST* dl, struct ArrowArray* array,
                                       struct ArrowSchema* schema) {
     if (!dl || !array || !schema) return -1;
     
-    DEBUG_PRINT("DEBUG: Converting DYN_LIST '%s', type=%d, n=%d\n", 
-                DYN_LIST_NAME(dl), DYN_LIST_DATATYPE(dl), DYN_LIST_N(dl));
+    DEBUG_PRINT("DEBUG: Converting DYN_LIST '%s', type=%d, n=%lld\n", 
+                DYN_LIST_NAME(dl), DYN_LIST_DATATYPE(dl), (long long) DYN_LIST_N(dl));
     
     // For non-list types (plain columns), use the simpler direct approach
     if (DYN_LIST_DATATYPE(dl) != DF_LIST) {
@@ -303,6 +308,22 @@ static int dynlist_to_nanoarrow_array(DYN_LIST* dl, struct ArrowArray* array,
             ArrowSchemaRelease(schema);
             return -1;
         }
+
+        if (DYN_LIST_FLAGS(dl) & DL_DICT) {
+            struct ArrowBuffer metadata;
+            int status = ArrowMetadataBuilderInit(&metadata, NULL);
+            if (status == NANOARROW_OK)
+                status = ArrowMetadataBuilderAppend(&metadata,
+                                                    ArrowCharView(DG_ARROW_DICT_KEY),
+                                                    ArrowCharView("1"));
+            if (status == NANOARROW_OK)
+                status = ArrowSchemaSetMetadata(schema, (const char*)metadata.data);
+            ArrowBufferReset(&metadata);
+            if (status != NANOARROW_OK) {
+                ArrowSchemaRelease(schema);
+                return -1;
+            }
+        }
         
         // Initialize array
         if (ArrowArrayInitFromType(array, type) != NANOARROW_OK) {
@@ -315,11 +336,11 @@ static int dynlist_to_nanoarrow_array(DYN_LIST* dl, struct ArrowArray* array,
         }
         
         // Append data directly
-        int n = DYN_LIST_N(dl);
+        DL_SIZE n = DYN_LIST_N(dl);
         switch (DYN_LIST_DATATYPE(dl)) {
             case DF_LONG: {
                 int* vals = (int*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendInt(array, vals[i]) != NANOARROW_OK) {
                         ArrowArrayRelease(array);
                         return -1;
@@ -329,7 +350,7 @@ static int dynlist_to_nanoarrow_array(DYN_LIST* dl, struct ArrowArray* array,
             }
             case DF_SHORT: {
                 short* vals = (short*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendInt(array, vals[i]) != NANOARROW_OK) {
                         ArrowArrayRelease(array);
                         return -1;
@@ -339,7 +360,7 @@ static int dynlist_to_nanoarrow_array(DYN_LIST* dl, struct ArrowArray* array,
             }
             case DF_CHAR: {
                 char* vals = (char*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendUInt(array, (uint64_t)(unsigned char)vals[i]) != NANOARROW_OK) {
                         ArrowArrayRelease(array);
                         return -1;
@@ -349,7 +370,7 @@ static int dynlist_to_nanoarrow_array(DYN_LIST* dl, struct ArrowArray* array,
             }
             case DF_FLOAT: {
                 float* vals = (float*)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (ArrowArrayAppendDouble(array, (double)vals[i]) != NANOARROW_OK) {
                         ArrowArrayRelease(array);
                         return -1;
@@ -359,9 +380,9 @@ static int dynlist_to_nanoarrow_array(DYN_LIST* dl, struct ArrowArray* array,
             }
             case DF_STRING: {
                 char** vals = (char**)DYN_LIST_VALS(dl);
-                for (int i = 0; i < n; i++) {
+                for (DL_SIZE i = 0; i < n; i++) {
                     if (!vals[i]) {
-                        ERROR_PRINT("ERROR: NULL string at index %d\n", i);
+                        ERROR_PRINT("ERROR: NULL string at index %lld\n", (long long) i);
                         ArrowArrayRelease(array);
                         return -1;
                     }
@@ -424,7 +445,7 @@ static int validate_dyn_group_for_arrow(DYN_GROUP* dg) {
         return -1;
     }
     
-    int expected_length = -1;
+    DL_SIZE expected_length = -1;
     
     // Check each top-level list
     for (int i = 0; i < DYN_GROUP_NLISTS(dg); i++) {
@@ -438,8 +459,8 @@ static int validate_dyn_group_for_arrow(DYN_GROUP* dg) {
         if (expected_length == -1) {
             expected_length = DYN_LIST_N(dl);
         } else if (DYN_LIST_N(dl) != expected_length) {
-            DEBUG_PRINT("DEBUG: Non-rectangular data: column %d has %d elements, expected %d\n",
-                        i, DYN_LIST_N(dl), expected_length);
+            DEBUG_PRINT("DEBUG: Non-rectangular data: column %d has %lld elements, expected %lld\n",
+                        i, (long long) DYN_LIST_N(dl), (long long) expected_length);
             return -1;
         }
         
@@ -468,8 +489,8 @@ static int validate_dyn_group_for_arrow(DYN_GROUP* dg) {
         }
     }
     
-    DEBUG_PRINT("DEBUG: DYN_GROUP validation passed: %d columns, %d rows\n", 
-                DYN_GROUP_NLISTS(dg), expected_length);
+    DEBUG_PRINT("DEBUG: DYN_GROUP validation passed: %d columns, %lld rows\n", 
+                DYN_GROUP_NLISTS(dg), (long long) expected_length);
     return 0;
 }
 
@@ -483,7 +504,7 @@ int dg_to_arrow_buffer(DYN_GROUP* dg, uint8_t** data, size_t* size) {
         return -1;
     }
     
-    int expected_length = DYN_LIST_N(DYN_GROUP_LIST(dg, 0)); // We know this exists from validation
+    DL_SIZE expected_length = DYN_LIST_N(DYN_GROUP_LIST(dg, 0)); // We know this exists from validation
 
     struct ArrowError error;
     struct ArrowBuffer buffer;
@@ -518,8 +539,8 @@ int dg_to_arrow_buffer(DYN_GROUP* dg, uint8_t** data, size_t* size) {
         DYN_LIST* dl = DYN_GROUP_LIST(dg, i);
         if (!dl) continue;
         
-        DEBUG_PRINT("DEBUG: About to convert column %d ('%s'), type=%d, length=%d\n", 
-                    i, DYN_LIST_NAME(dl), DYN_LIST_DATATYPE(dl), DYN_LIST_N(dl));
+        DEBUG_PRINT("DEBUG: About to convert column %d ('%s'), type=%d, length=%lld\n", 
+                    i, DYN_LIST_NAME(dl), DYN_LIST_DATATYPE(dl), (long long) DYN_LIST_N(dl));
         
         if (dynlist_to_nanoarrow_array(dl, array.children[i], schema.children[i]) != 0) {
             DEBUG_PRINT("DEBUG: Failed to convert column %d ('%s')\n", i, DYN_LIST_NAME(dl));
@@ -533,8 +554,8 @@ int dg_to_arrow_buffer(DYN_GROUP* dg, uint8_t** data, size_t* size) {
         
         // Verify length consistency
         if (array.children[i]->length != expected_length) {
-            ERROR_PRINT("Length mismatch: expected %d, got %lld for column %d\n", 
-                        expected_length, array.children[i]->length, i);
+            ERROR_PRINT("Length mismatch: expected %lld, got %lld for column %d\n", 
+                        (long long) expected_length, array.children[i]->length, i);
             ArrowArrayRelease(&array);
             ArrowSchemaRelease(&schema);
             return -1;
@@ -720,6 +741,46 @@ static int arrow_type_to_df_type(const char* format) {
     else return -1; // Unsupported type
 }
 
+// Dictionary arrays of strings become dictionary encoded string lists
+static DYN_LIST* dictionary_array_to_dynlist(const struct ArrowArrayView* array_view,
+                                             const char* name) {
+    const struct ArrowArrayView* dict_view = array_view->dictionary;
+    int64_t n = array_view->length;
+    DYN_LIST* dl = dfuCreateNamedDynList((char*)(name ? name : "column"),
+                                         DF_STRING, n > 0 ? n : 1);
+    if (!dl) return NULL;
+
+    for (int64_t i = 0; i < n; i++) {
+        if (ArrowArrayViewIsNull(array_view, i)) {
+            dfuAddDynListString(dl, "");
+            continue;
+        }
+        int64_t code = ArrowArrayViewGetIntUnsafe(array_view, i);
+        if (code < 0 || code >= dict_view->length) {
+            ERROR_PRINT("ERROR: Dictionary index %lld out of range\n", (long long) code);
+            dfuFreeDynList(dl);
+            return NULL;
+        }
+        struct ArrowStringView sv = ArrowArrayViewGetStringUnsafe(dict_view, code);
+        char* val = (char*)malloc(sv.size_bytes + 1);
+        if (!val) {
+            dfuFreeDynList(dl);
+            return NULL;
+        }
+        memcpy(val, sv.data, sv.size_bytes);
+        val[sv.size_bytes] = '\0';
+        dfuAddDynListString(dl, val);
+        free(val);
+    }
+
+    // sorts and dedups the table, which arrow does not require
+    if (!dfuDictEncodeDynList(dl)) {
+        dfuFreeDynList(dl);
+        return NULL;
+    }
+    return dl;
+}
+
 // Recursively convert Arrow array view to DYN_LIST
 static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_view, 
                                              const struct ArrowSchema* schema, 
@@ -730,11 +791,38 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
     
     DEBUG_PRINT("DEBUG: Converting array: name='%s', format='%s', length=%lld, offset=%lld\n", 
                 name ? name : "unnamed", schema->format, n, array_view->offset);
+
+    if (schema->dictionary && array_view->dictionary &&
+        schema->dictionary->format && strcmp(schema->dictionary->format, "u") == 0) {
+        return dictionary_array_to_dynlist(array_view, name);
+    }
+    
+    // Lists of null-free fixed-width values map directly onto packed
+    // (values + offsets) storage, avoiding one DYN_LIST per element
+    if (schema->format && strcmp(schema->format, "+l") == 0 && n > 0 &&
+        array_view->null_count == 0 &&
+        array_view->children && array_view->n_children == 1 &&
+        array_view->children[0]->null_count == 0 &&
+        schema->children[0]->format &&
+        strcmp(schema->children[0]->format, "g") != 0) {
+        int child_type = arrow_type_to_df_type(schema->children[0]->format);
+        const int32_t* offsets = array_view->buffer_views[1].data.as_int32;
+        const void* child_vals = array_view->children[0]->buffer_views[1].data.data;
+        if (offsets && child_vals &&
+            (child_type == DF_LONG || child_type == DF_SHORT ||
+             child_type == DF_CHAR || child_type == DF_FLOAT)) {
+            DYN_LIST* dl = dfuCreatePackedDynList((char*)(name ? name : "list"),
+                                                  child_type, (int)n,
+                                                  (int*)(offsets + array_view->offset),
+                                                  (void*)child_vals);
+            if (dl) return dl;
+        }
+    }
     
     // Handle LIST type recursively  
     if (schema->format && strcmp(schema->format, "+l") == 0) {
         char* list_name = strdup(name ? name : "list");
-        DYN_LIST* dl = dfuCreateNamedDynList(list_name, DF_LIST, (int)n);
+        DYN_LIST* dl = dfuCreateNamedDynList(list_name, DF_LIST, n);
         free(list_name);
         if (!dl) {
             ERROR_PRINT("ERROR: Failed to create list DYN_LIST\n");
@@ -803,13 +891,13 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
                 return NULL;
             }
             
-            DEBUG_PRINT("DEBUG: Created sublist with %d elements\n", DYN_LIST_N(nested_list));
+            DEBUG_PRINT("DEBUG: Created sublist with %lld elements\n", (long long) DYN_LIST_N(nested_list));
             
             // Move the nested list into our list of lists
             dfuMoveDynListList(dl, nested_list);
         }
         
-        DEBUG_PRINT("DEBUG: Successfully created list with %d sublists\n", DYN_LIST_N(dl));
+        DEBUG_PRINT("DEBUG: Successfully created list with %lld sublists\n", (long long) DYN_LIST_N(dl));
         return dl;
     }
     
@@ -821,7 +909,7 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
     }
     
     char* col_name = strdup(name ? name : "column");
-    DYN_LIST* dl = dfuCreateNamedDynList(col_name, df_type, (int)n);
+    DYN_LIST* dl = dfuCreateNamedDynList(col_name, df_type, n);
     free(col_name);
     if (!dl) return NULL;
     
@@ -836,6 +924,10 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
                 dfuFreeDynList(dl);
                 return NULL;
             }
+            if (array_view->null_count == 0) {
+                dfuAppendDynListN(dl, (void*)(src + offset), n);
+                break;
+            }
             for (int64_t i = 0; i < n; i++) {
                 int val = ArrowArrayViewIsNull(array_view, i) ? 0 : (int)src[offset + i];
                 dfuAddDynListLong(dl, val);
@@ -850,6 +942,10 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
                 dfuFreeDynList(dl);
                 return NULL;
             }
+            if (array_view->null_count == 0) {
+                dfuAppendDynListN(dl, (void*)(src + offset), n);
+                break;
+            }
             for (int64_t i = 0; i < n; i++) {
                 short val = ArrowArrayViewIsNull(array_view, i) ? 0 : (short)src[offset + i];
                 dfuAddDynListShort(dl, val);
@@ -864,6 +960,10 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
                 dfuFreeDynList(dl);
                 return NULL;
             }
+            if (array_view->null_count == 0) {
+                dfuAppendDynListN(dl, (void*)(src + offset), n);
+                break;
+            }
             for (int64_t i = 0; i < n; i++) {
                 char val = ArrowArrayViewIsNull(array_view, i) ? 0 : (char)src[offset + i];
                 dfuAddDynListChar(dl, val);
@@ -878,6 +978,10 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
                     dfuFreeDynList(dl);
                     return NULL;
                 }
+                if (array_view->null_count == 0) {
+                    dfuAppendDynListN(dl, (void*)(src + offset), n);
+                    break;
+                }
                 for (int64_t i = 0; i < n; i++) {
                     float val = ArrowArrayViewIsNull(array_view, i) ? 0.0f : src[offset + i];
                     dfuAddDynListFloat(dl, val);
@@ -928,7 +1032,16 @@ static DYN_LIST* nanoarrow_array_to_dynlist(const struct ArrowArrayView* array_v
         }
     }
     
-    DEBUG_PRINT("DEBUG: Created DYN_LIST '%s' with %d elements\n", DYN_LIST_NAME(dl), DYN_LIST_N(dl));
+    // Restore the encoding of columns written from dictionary encoded lists
+    if (DYN_LIST_DATATYPE(dl) == DF_STRING && schema->metadata) {
+        struct ArrowStringView value = { NULL, 0 };
+        if (ArrowMetadataGetValue(schema->metadata, ArrowCharView(DG_ARROW_DICT_KEY),
+                                  &value) == NANOARROW_OK && value.data) {
+            dfuDictEncodeDynList(dl);
+        }
+    }
+
+    DEBUG_PRINT("DEBUG: Created DYN_LIST '%s' with %lld elements\n", DYN_LIST_NAME(dl), (long long) DYN_LIST_N(dl));
     return dl;
 }
 
@@ -12,11 +12,16 @@
 
 #include <msgpack.h>
 
+/* msgpack arrays hold at most 2^32-1 elements */
+#define MSGPACK_MAX_ARRAY 0xffffffffLL
+
 // Pack DYN_LIST to MessagePack (equivalent to dl_to_json)
 int dl_to_msgpack(DYN_LIST *dl, msgpack_packer *pk)
 {
-    int i;
+    DL_SIZE i;
     
+    if (DYN_LIST_N(dl) > MSGPACK_MAX_ARRAY) return -1;
+
     if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
         // Pack array header
         if (msgpack_pack_array(pk, DYN_LIST_N(dl)) != 0) return -1;
@@ -144,7 +149,8 @@ int dg_to_msgpack_buffer(DYN_GROUP *dg, char **buffer, size_t *buffer_size)
 // Hybrid format (equivalent to dg_to_hybrid_json)
 int dg_to_hybrid_msgpack_buffer(DYN_GROUP *dg, char **buffer, size_t *buffer_size)
 {
-    int i, j, max_rows = 0;
+    int j;
+    DL_SIZE i, max_rows = 0;
     msgpack_sbuffer sbuf;
     msgpack_packer pk;
     
@@ -160,6 +166,7 @@ int dg_to_hybrid_msgpack_buffer(DYN_GROUP *dg, char **buffer, size_t *buffer_siz
             max_rows = DYN_LIST_N(dl);
         }
     }
+    if (max_rows > MSGPACK_MAX_ARRAY) return -1;
     
     // Pack root object with 3 fields: name, rows, arrays
     if (msgpack_pack_map(&pk, 3) != 0) goto error;
@@ -13,9 +13,13 @@
 #       ternary [x if x>4 else -1 ...]       -> dl_where [dl_gt $xs 4] $xs -1
 #       reduce  sum/mean/max per row         -> dl_sums / dl_means / dl_maxs
 #
-#   All builders return a dynlist via dl_return (a ">N<" return-list), so the
-#   result lives in the CALLER's frame -- the standard dlsh contract. How you
-#   take the result matters:
+#   dl_map, dl_filter and dl_reduce are commands in tcl_dl.c (evaluating
+#   the body as compiled bytecode, one loop value reused per element and
+#   results written straight into the new list); dl_comp, here, is built
+#   on dl_foreach and returns its list via dl_return (a ">N<" return-list),
+#   so the result lives in the CALLER's frame -- the standard dlsh
+#   contract. dl_map and dl_filter return ordinary temporary lists, like
+#   any dl_* command. Either way, how you take the result matters:
 #
 #     * Consumed immediately -- no binding needed:
 #           dl_tcllist [dl_filter x $xs {expr {$x > 5}}]
@@ -23,21 +27,22 @@
 #     * Kept in a variable for later use -- bind with dl_local, NOT plain set.
 #       dl_local ties the list's lifetime to YOUR variable (freed on unset, on
 #       reassignment, at proc exit -- and correctly at the top level too), and
-#       it just renames the return-list, so there's no data copy:
+#       it just renames the list, so there's no data copy:
 #           dl_local big [dl_filter x $xs {expr {$x > 5}}]
 #           dl_local mus [dl_map r $big {dl_mean $r}]
-#       (Plain `set v [dl_filter ...]` leaves the list owned by a hidden
+#       (Plain `set v [dl_comp ...]` leaves the list owned by a hidden
 #        return-list guard: it survives in-scope, but `unset v` won't free it,
 #        and at the top level it is never reclaimed.)
 #
 #     * Returned UP through a proc of your own -- re-protect with dl_return:
 #           proc mk {} { return [dl_return [dl_map x $xs {expr {$x*2}}]] }
 #
-#   Built on: dl_foreach, dl_select, dl_create, dl_ilist, dl_return, dl_local.
+#   Built on: dl_foreach, dl_create, dl_return, dl_local.
 
 namespace eval ::dl {}
 
-# Infer a dl datatype name (int|float|string) from collected Tcl scalars.
+# Infer a dl datatype name (int|float|string) from collected Tcl scalars,
+# the way dl_map types its results.
 proc ::dl::_infer_type {vals} {
     if {[llength $vals] == 0} { return float }
     set allint 1
@@ -48,47 +53,6 @@ proc ::dl::_infer_type {vals} {
     return [expr {$allint ? "int" : "float"}]
 }
 
-# dl_map var listname body ?type?
-#   Apply body once per element, collecting the (scalar) results into a new
-#   dynlist. var is bound to each element value; for a list-of-lists it is
-#   bound to each sublist as a dynlist (so the body can use dl_* ops on it).
-#   type: auto (default, inferred int/float/string) | int | float | string.
-#
-#       dl_map x $xs {expr {$x*$x+1}}        ;# per-element transform
-#       dl_map r $rows {dl_sum $r}           ;# per-row reduce -> flat list
-proc dl_map {var listname body {type auto}} {
-    upvar 1 $var v
-    set out {}
-    dl_foreach v $listname { lappend out [uplevel 1 $body] }
-    if {$type eq "auto"} { set type [::dl::_infer_type $out] }
-    return [dl_return [dl_create $type {*}$out]]
-}
-
-# dl_filter var listname pred
-#   Keep the elements (or sublists) for which pred -- a command returning a
-#   boolean -- is true. Returns a new list of the kept elements.
-#
-#       dl_filter x $xs {expr {$x > 5 && $x % 3 == 0}}
-proc dl_filter {var listname pred} {
-    upvar 1 $var v
-    set mask {}
-    dl_foreach v $listname { lappend mask [expr {[uplevel 1 $pred] ? 1 : 0}] }
-    return [dl_return [dl_select $listname [dl_ilist {*}$mask]]]
-}
-
-# dl_reduce accVar elemVar listname body init
-#   Left fold. acc starts at init; each element updates acc <- body. Returns
-#   the final acc (a Tcl scalar, not a dynlist).
-#
-#       dl_reduce a x $xs {expr {$a + $x}} 0        ;# sum
-#       dl_reduce a x $xs {expr {max($a,$x)}} -1e30 ;# max
-proc dl_reduce {accVar elemVar listname body init} {
-    upvar 1 $accVar acc $elemVar v
-    set acc $init
-    dl_foreach v $listname { set acc [uplevel 1 $body] }
-    return $acc
-}
-
 # dl_comp var listname ?-where pred? ?-map body? ?-type t?
 #   Comprehension: [body for var in listname if pred]. Both -where (a boolean
 #   command) and -map (a value command) are optional; -map defaults to the
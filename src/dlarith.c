@@ -14,6 +14,9 @@
  *    DL_MATH_MIN
  *    DL_MATH_MAX
  *
+ *    and convolution (dl_conv, dl_conv2), by overlap-add FFTs when
+ *    the kernel is long enough for them to pay off
+ *
  *  AUTHOR
  *    DLS
  *
@@ -26,6 +29,10 @@
 
 #include "df.h"
 #include "dfana.h"
+#include "dlsimd.h"
+#include "dlgroup.h"
+#include "dlthread.h"
+#include "dlfft.h"
 
 #include <utilc.h>
 
@@ -209,6 +216,17 @@ DYN_LIST *dynListArithListList(DYN_LIST *l1, DYN_LIST *l2, int func)
     }
   }
 
+  /* vector kernels cover the common type / operation combinations */
+  if (length >= 4) {
+    int newtype = sametype ? DYN_LIST_DATATYPE(l1) : DF_FLOAT;
+    void *newvals = malloc((size_t) length * dfuDynListElementSize(newtype));
+    if (dlSimdArith(func, copymode, length,
+		    DYN_LIST_DATATYPE(l1), DYN_LIST_VALS(l1),
+		    DYN_LIST_DATATYPE(l2), DYN_LIST_VALS(l2), newvals))
+      return dfuCreateDynListWithVals(newtype, length, newvals);
+    free(newvals);
+  }
+
   if (sametype) {
     switch (DYN_LIST_DATATYPE(l1)) {
     case DF_LONG:
@@ -1330,6 +1348,219 @@ DYN_LIST *dynListArithListList(DYN_LIST *l1, DYN_LIST *l2, int func)
   return(list);
 }
 
+
+/*
+ * In place arithmetic: l1 = l1 func l2, storing into l1's own values.
+ * This is only possible when the result dynListArithListList would
+ * give has the datatype and shape of l1, so the whole of l1 is checked
+ * before any of it is changed.
+ */
+
+static void dynListInPlaceElement(DYN_LIST *l, DL_SIZE i, DYN_LIST *elt)
+{
+  memset(elt, 0, sizeof(DYN_LIST));
+  DYN_LIST_DATATYPE(elt) = DYN_LIST_DATATYPE(l);
+  DYN_LIST_N(elt) = DYN_LIST_MAX(elt) = 1;
+  DYN_LIST_FLAGS(elt) = DL_VIEW;
+  DYN_LIST_VALS(elt) = (char *) DYN_LIST_VALS(l) +
+    i * dfuDynListElementSize(DYN_LIST_DATATYPE(l));
+}
+
+static int dynListArithInPlaceCheck(DYN_LIST *l1, DYN_LIST *l2)
+{
+  DL_SIZE i, n1 = DYN_LIST_N(l1), n2 = DYN_LIST_N(l2);
+  int t1 = DYN_LIST_DATATYPE(l1), t2 = DYN_LIST_DATATYPE(l2);
+  DYN_LIST **vals1, **vals2, elt;
+
+  if (t1 == DF_STRING || t2 == DF_STRING) return 0;
+
+  if (t1 != DF_LIST) {
+    if (t2 == DF_LIST) return 0;
+    if (t1 != t2 && t1 != DF_FLOAT) return 0;
+    if (!n1) return 1;
+    return (n2 == n1 || n2 == 1);
+  }
+
+  vals1 = (DYN_LIST **) DYN_LIST_VALS(l1);
+  if (t2 == DF_LIST) {
+    vals2 = (DYN_LIST **) DYN_LIST_VALS(l2);
+    if (n2 != n1 && n2 != 1) return 0;
+    for (i = 0; i < n1; i++)
+      if (!dynListArithInPlaceCheck(vals1[i], vals2[n2 == n1 ? i : 0]))
+	return 0;
+    return 1;
+  }
+
+  if (!n2) return 0;
+  if (n1 == n2) {		/* one element of l2 per sublist */
+    for (i = 0; i < n1; i++) {
+      dynListInPlaceElement(l2, i, &elt);
+      if (!dynListArithInPlaceCheck(vals1[i], &elt)) return 0;
+    }
+    return 1;
+  }
+  if (n1 != 1 && n2 != 1) return 0;
+  for (i = 0; i < n1; i++)
+    if (!dynListArithInPlaceCheck(vals1[i], l2)) return 0;
+  return 1;
+}
+
+#define DL_INPLACE_ARITH(T, Y, ACAST, FCAST, j)			\
+  {									\
+    T *x = (T *) DYN_LIST_VALS(l1);					\
+    switch (func) {							\
+    case DL_MATH_ADD:							\
+      for (i = 0; i < n; i++) x[i] = x[i] + ACAST Y[j];			\
+      break;								\
+    case DL_MATH_SUB:							\
+      for (i = 0; i < n; i++) x[i] = x[i] - ACAST Y[j];			\
+      break;								\
+    case DL_MATH_MUL:							\
+      for (i = 0; i < n; i++) x[i] = x[i] * ACAST Y[j];			\
+      break;								\
+    case DL_MATH_DIV:							\
+      for (i = 0; i < n; i++) {						\
+	if (Y[j]) x[i] = x[i] / ACAST Y[j];				\
+	else x[i] = 0;							\
+      }									\
+      break;								\
+    case DL_MATH_MIN:							\
+      for (i = 0; i < n; i++) x[i] = x[i] < Y[j] ? x[i] : Y[j];		\
+      break;								\
+    case DL_MATH_MAX:							\
+      for (i = 0; i < n; i++) x[i] = x[i] > Y[j] ? x[i] : Y[j];		\
+      break;								\
+    case DL_MATH_POW:							\
+      for (i = 0; i < n; i++) x[i] = (T) pow(x[i], FCAST Y[j]);		\
+      break;								\
+    case DL_MATH_ATAN2:							\
+      for (i = 0; i < n; i++) x[i] = (T) atan2(x[i], FCAST Y[j]);	\
+      break;								\
+    case DL_MATH_FMOD:							\
+      for (i = 0; i < n; i++) x[i] = (T) fmod(x[i], FCAST Y[j]);	\
+      break;								\
+    }									\
+  }
+
+/* float target, integer operand, converted as dynListArithListList does */
+#define DL_INPLACE_ARITH_FLOAT(TY)					\
+  {									\
+    TY *y = (TY *) DYN_LIST_VALS(l2);					\
+    if (bcast) DL_INPLACE_ARITH(float, y, (float), (float), 0)		\
+    else DL_INPLACE_ARITH(float, y, (float), (double), i)		\
+  }
+
+#define DL_INPLACE_ARITH_SAME(T)					\
+  {									\
+    T *y = (T *) DYN_LIST_VALS(l2);					\
+    if (bcast) DL_INPLACE_ARITH(T, y, , , 0)				\
+    else DL_INPLACE_ARITH(T, y, , , i)					\
+  }
+
+static int dynListArithInPlaceApply(DYN_LIST *l1, DYN_LIST *l2, int func)
+{
+  DL_SIZE i, n = DYN_LIST_N(l1), n2 = DYN_LIST_N(l2);
+  int t1 = DYN_LIST_DATATYPE(l1), t2 = DYN_LIST_DATATYPE(l2), bcast;
+  DYN_LIST **vals1, **vals2, elt;
+
+  if (t1 == DF_LIST) {
+    vals1 = (DYN_LIST **) DYN_LIST_VALS(l1);
+    if (t2 == DF_LIST) {
+      vals2 = (DYN_LIST **) DYN_LIST_VALS(l2);
+      for (i = 0; i < n; i++)
+	if (!dynListArithInPlaceApply(vals1[i], vals2[n2 == n ? i : 0], func))
+	  return 0;
+    }
+    else if (n == n2) {
+      for (i = 0; i < n; i++) {
+	dynListInPlaceElement(l2, i, &elt);
+	if (!dynListArithInPlaceApply(vals1[i], &elt, func)) return 0;
+      }
+    }
+    else {
+      for (i = 0; i < n; i++)
+	if (!dynListArithInPlaceApply(vals1[i], l2, func)) return 0;
+    }
+    return 1;
+  }
+
+  if (!n) return 1;
+  if (!dfuUnshareDynList(l1)) return 0;
+
+  bcast = (n2 != n);
+  if (dlSimdArith(func, bcast ? 2 : 0, n, t1, DYN_LIST_VALS(l1),
+		  t2, DYN_LIST_VALS(l2), DYN_LIST_VALS(l1)))
+    return 1;
+
+  if (t1 == t2) {
+    switch (t1) {
+    case DF_LONG:  DL_INPLACE_ARITH_SAME(int);   break;
+    case DF_SHORT: DL_INPLACE_ARITH_SAME(short); break;
+    case DF_CHAR:  DL_INPLACE_ARITH_SAME(char);  break;
+    case DF_FLOAT: DL_INPLACE_ARITH_SAME(float); break;
+    }
+  }
+  else {
+    switch (t2) {
+    case DF_LONG:  DL_INPLACE_ARITH_FLOAT(int);   break;
+    case DF_SHORT: DL_INPLACE_ARITH_FLOAT(short); break;
+    case DF_CHAR:  DL_INPLACE_ARITH_FLOAT(char);  break;
+    }
+  }
+  return 1;
+}
+
+/*
+ * dynListArithListListInPlace - l1 func l2 stored into l1.  Returns 1
+ * on success and 0 (leaving l1 unchanged) if the result would not have
+ * the datatype and shape of l1, e.g. an int list times a float.
+ */
+
+int dynListArithListListInPlace(DYN_LIST *l1, DYN_LIST *l2, int func)
+{
+  if (!l1 || !l2) return 0;
+  if (!dynListArithInPlaceCheck(l1, l2)) return 0;
+  return dynListArithInPlaceApply(l1, l2, func);
+}
+
+/* number of candidates from which dl_oneof hashes rather than
+   or'ing one dl_eq per candidate */
+#define DL_ONEOF_HASH_MIN 16
+
+/*
+ * dynListOneOfHash - for each element of l1, the group of its value
+ * among the values of l2 (-1 if absent).  A float list against an
+ * integer list compares as floats, like dl_eq; other mixes return NULL.
+ */
+
+static int *dynListOneOfHash(DYN_LIST *l1, DYN_LIST *l2)
+{
+  DYN_LIST *c1 = NULL, *c2 = NULL;
+  DL_GROUPING *g;
+  int *ids = NULL;
+
+  if (DYN_LIST_DATATYPE(l1) != DYN_LIST_DATATYPE(l2)) {
+    if (DYN_LIST_DATATYPE(l1) == DF_STRING ||
+	DYN_LIST_DATATYPE(l2) == DF_STRING) return NULL;
+    if (DYN_LIST_DATATYPE(l1) == DF_FLOAT)
+      l2 = c2 = dynListConvertList(l2, DF_FLOAT);
+    else if (DYN_LIST_DATATYPE(l2) == DF_FLOAT)
+      l1 = c1 = dynListConvertList(l1, DF_FLOAT);
+    else return NULL;
+    if (!l1 || !l2) goto done;
+  }
+
+  if ((g = dlGroupRows(1, &l2))) {
+    ids = dlGroupFind(g, l1);
+    dlGroupFree(g);
+  }
+
+ done:
+  if (c1) dfuFreeDynList(c1);
+  if (c2) dfuFreeDynList(c2);
+  return ids;
+}
+
 DYN_LIST *dynListOneOf(DYN_LIST *l1, DYN_LIST *l2)
 {
   DYN_LIST *result, *list, *intermed, *compare, *orred;
@@ -1476,6 +1707,14 @@ DYN_LIST *dynListOneOf(DYN_LIST *l1, DYN_LIST *l2)
     return result;
   }
 
+  if (DYN_LIST_N(l2) >= DL_ONEOF_HASH_MIN) {
+    int *ids = dynListOneOfHash(l1, l2);
+    if (ids) {
+      for (i = 0; i < DYN_LIST_N(l1); i++) ids[i] = ids[i] >= 0;
+      return dfuCreateDynListWithVals(DF_LONG, DYN_LIST_N(l1), ids);
+    }
+  }
+
   /* compare will hold the single element list for the successive dl_eq's */
   compare = dfuCreateDynList(DYN_LIST_DATATYPE(l2), 1);
   
@@ -1640,6 +1879,18 @@ DYN_LIST *dynListOneOfIndices(DYN_LIST *l1, DYN_LIST *l2)
     return result;
   }
 
+  if (DYN_LIST_N(l2) >= DL_ONEOF_HASH_MIN) {
+    int j, *ids = dynListOneOfHash(l1, l2);
+    if (ids) {
+      for (i = 0, j = 0; i < DYN_LIST_N(l1); i++) if (ids[i] >= 0) ids[j++] = i;
+      if (!j) {
+	free(ids);
+	return dfuCreateDynList(DF_LONG, 10);
+      }
+      return dfuCreateDynListWithVals(DF_LONG, j, ids);
+    }
+  }
+
   /* compare will hold the single element list for the successive dl_eq's */
   compare = dfuCreateDynList(DYN_LIST_DATATYPE(l2), 1);
   
@@ -1669,10 +1920,80 @@ DYN_LIST *dynListOneOfIndices(DYN_LIST *l1, DYN_LIST *l2)
   retlist = dynListIndices(result);
   dfuFreeDynList(result);
 
-  return result;
+  return retlist;
 }
 
 
+/*
+ * dynListRelationDictCmp / dynListRelationDictStrings
+ *   String relations where one side is dictionary encoded are
+ *   evaluated once per distinct string and then looked up by code.
+ *   Two lists sharing the same (sorted) table compare their codes
+ *   directly.  The mapping from strcmp() to op matches the plain
+ *   string loops below exactly.
+ */
+
+static int dynListRelationDictCmp(int op, int cmp)
+{
+  switch (op) {
+  case DL_RELATION_EQ:  return cmp == 0;
+  case DL_RELATION_NE:  return cmp != 0;
+  case DL_RELATION_LT:  return cmp < 0;
+  case DL_RELATION_LTE: return cmp <= 0;
+  case DL_RELATION_GT:  return cmp > 0;
+  case DL_RELATION_GTE: return cmp <= 0;
+  }
+  return 0;
+}
+
+static int dynListRelationDictStrings(DYN_LIST *l1, DYN_LIST *l2, int op,
+				      int copymode, int length, int *newvals)
+{
+  int i, *table, *codes;
+  DYN_DICT *dict;
+  char *s;
+
+  if (op == DL_RELATION_AND || op == DL_RELATION_OR) return 0;
+
+  switch (copymode) {
+  case 0:
+    if (!(DYN_LIST_FLAGS(l1) & DL_DICT) || !(DYN_LIST_FLAGS(l2) & DL_DICT) ||
+	DYN_LIST_DICT(l1) != DYN_LIST_DICT(l2)) return 0;
+    {
+      int *c1 = DYN_LIST_CODES(l1), *c2 = DYN_LIST_CODES(l2);
+      for (i = 0; i < length; i++)
+	newvals[i] = dynListRelationDictCmp(op, (c1[i] > c2[i])-(c1[i] < c2[i]));
+    }
+    return 1;
+  case 1:
+    if (!(DYN_LIST_FLAGS(l2) & DL_DICT)) return 0;
+    dict = DYN_LIST_DICT(l2);
+    codes = DYN_LIST_CODES(l2);
+    s = ((char **) DYN_LIST_VALS(l1))[0];
+    table = (int *) malloc(dict->nstrings*sizeof(int));
+    if (!table) return 0;
+    for (i = 0; i < dict->nstrings; i++)
+      table[i] = dynListRelationDictCmp(op, strcmp(s, dict->strings[i]));
+    break;
+  case 2:
+    if (!(DYN_LIST_FLAGS(l1) & DL_DICT)) return 0;
+    dict = DYN_LIST_DICT(l1);
+    codes = DYN_LIST_CODES(l1);
+    s = ((char **) DYN_LIST_VALS(l2))[0];
+    table = (int *) malloc(dict->nstrings*sizeof(int));
+    if (!table) return 0;
+    for (i = 0; i < dict->nstrings; i++)
+      table[i] = dynListRelationDictCmp(op, strcmp(dict->strings[i], s));
+    break;
+  default:
+    return 0;
+  }
+
+  for (i = 0; i < length; i++) newvals[i] = table[codes[i]];
+  free(table);
+  return 1;
+}
+
 DYN_LIST *dynListRelationListList(DYN_LIST *l1, DYN_LIST *l2, int op)
 {
   int i;
@@ -1848,6 +2169,7 @@ DYN_LIST *dynListRelationListList(DYN_LIST *l1, DYN_LIST *l2, int op)
     vals1 = (char **) DYN_LIST_VALS(l1);
     vals2 = (char **) DYN_LIST_VALS(l2);
 
+    if (!dynListRelationDictStrings(l1, l2, op, copymode, length, newvals))
     switch (copymode) {
     case 0:
       switch (op) {
@@ -1950,6 +2272,9 @@ DYN_LIST *dynListRelationListList(DYN_LIST *l1, DYN_LIST *l2, int op)
     return(list);
   }
 
+  if (!dlSimdRelation(op, copymode, length,
+		      DYN_LIST_DATATYPE(l1), DYN_LIST_VALS(l1),
+		      DYN_LIST_DATATYPE(l2), DYN_LIST_VALS(l2), newvals)) {
   if (sametype) {
     switch (DYN_LIST_DATATYPE(l1)) {
     case DF_LONG:
@@ -3011,6 +3336,7 @@ DYN_LIST *dynListRelationListList(DYN_LIST *l1, DYN_LIST *l2, int op)
       break;
     }
   }
+  }				/* scalar fallback */
   list = dfuCreateDynListWithVals(DF_LONG, length, newvals);
   return(list);
 }
@@ -3192,6 +3518,7 @@ DYN_LIST *dynListRelationListListIndices(DYN_LIST *l1, DYN_LIST *l2, int op)
     vals1 = (char **) DYN_LIST_VALS(l1);
     vals2 = (char **) DYN_LIST_VALS(l2);
 
+    if (!dynListRelationDictStrings(l1, l2, op, copymode, length, newvals))
     switch (copymode) {
     case 0:
       switch (op) {
@@ -3300,6 +3627,9 @@ DYN_LIST *dynListRelationListListIndices(DYN_LIST *l1, DYN_LIST *l2, int op)
     return(list);
   }
 
+  if (!dlSimdRelation(op, copymode, length,
+		      DYN_LIST_DATATYPE(l1), DYN_LIST_VALS(l1),
+		      DYN_LIST_DATATYPE(l2), DYN_LIST_VALS(l2), newvals)) {
   if (sametype) {
     switch (DYN_LIST_DATATYPE(l1)) {
     case DF_LONG:
@@ -4361,6 +4691,7 @@ DYN_LIST *dynListRelationListListIndices(DYN_LIST *l1, DYN_LIST *l2, int op)
       break;
     }
   }
+  }				/* scalar fallback */
 
   for (i = 0; i < length; i++)
     if (newvals[i]) match_count++;
@@ -4480,7 +4811,7 @@ DYN_LIST *dynListSumProdLists(DYN_LIST *dl, int op)
 {
   int i, need_float = 0;
   DYN_LIST *list, *working, *curlist, *emptylist;
-  DYN_LIST **vals;
+  DYN_LIST **vals, **results;
 
   if (!dl) return(NULL);
 
@@ -4488,14 +4819,20 @@ DYN_LIST *dynListSumProdLists(DYN_LIST *dl, int op)
   working = dfuCreateDynList(DF_LIST, DYN_LIST_N(dl));
   emptylist = dfuCreateDynList(DF_LONG, 1);
 
-  vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+  results = dynListApplyLists(dl, dynListSumProdList, op);
+  if (!results) {
+    dfuFreeDynList(emptylist);
+    dfuFreeDynList(working);
+    return(NULL);
+  }
   for (i = 0; i < DYN_LIST_N(dl); i++) {
-    curlist = dynListSumProdList(vals[i], op);
+    curlist = results[i];
     if (curlist) {
       dfuMoveDynListList(working, curlist);
     }
     else dfuAddDynListList(working, emptylist);	/* placeholder */
   }
+  free(results);
   dfuFreeDynList(emptylist);
   
   /* determine if we need a float list, or if ints will do */
@@ -5045,123 +5382,165 @@ DYN_LIST *dynListNegateList(DYN_LIST *dl)
   return(negs);
 }
 
-static DYN_LIST *dynListConvModeList(DYN_LIST *dl, DYN_LIST *kernel, int mode)
+/*
+ * Convolution (dl_conv, dl_conv2).  Each point is the sum of the data
+ * around it weighted by the kernel (centred on the point; data beyond
+ * either end counts as 0), so the result has the length of the data.
+ * Long kernels are done by overlap-add FFT: the data is cut into
+ * blocks, each block convolved by FFT with the kernel and the blocks'
+ * results added up.  The kernel is transformed once per call, and
+ * shared by all the sublists it is applied to.
+ */
+
+#define DL_CONV_FFT_MIN   32	/* shortest kernel to consider FFTs for */
+#define DL_CONV_FFT_COST   5	/* kernel taps per FFT point and level  */
+#define DL_CONV_FFT_TOL 1e-12	/* relative size of rounding noise      */
+
+typedef struct {
+  DYN_LIST *kernel;		/* the kernel this plan is for          */
+  int kwidth;
+  int nfft;
+  int block;			/* data points per FFT                  */
+  double scale;			/* sum of |kernel|                      */
+  double *spectrum;		/* transform of the reversed kernel     */
+} DL_CONV_PLAN;
+
+/*
+ * dlConvFftSize - transform size for kwidth taps and at most n points
+ * (0 if the FFT would not be faster than the sums)
+ */
+
+static int dlConvFftSize(DL_SIZE n, int kwidth)
 {
-  int i, j, kwidth, hwidth, length, stop;
-  DYN_LIST *result, *dlf = NULL, *kernelf = NULL, **subkernels;
-  double sum;
-  float *v, *vcur, *k, *kcenter;
-  
+  int nfft, best = 0, block;
+  double cost, bestcost = 0;
 
-  /* The original convolve func is mode 0, and doesn't recurse deep kernels */
-  if (mode == 0) { 
-    if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
-      DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-      DYN_LIST *curconv;
-      result = dfuCreateDynList(DYN_LIST_DATATYPE(dl), DYN_LIST_N(dl));
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (DYN_LIST_DATATYPE(vals[i]) != DF_LIST &&
-	    DYN_LIST_DATATYPE(kernel) == DF_LIST) {
-	  subkernels = DYN_LIST_VALS(kernel);
-	  if (DYN_LIST_N(kernel) == 1) 
-	    curconv = dynListConvList(vals[i], subkernels[0]);
-	  else if (DYN_LIST_N(kernel) == DYN_LIST_N(dl))
-	    curconv = dynListConvList(vals[i], subkernels[i]);
-	  else { 
-	    dfuFreeDynList(result);
-	    return NULL;
-	  }
-	}
-	else {
-	  curconv = dynListConvList(vals[i], kernel);
-	}
-	if (!curconv) {
-	  dfuFreeDynList(result);
-	  return NULL;
-	}
-	dfuMoveDynListList(result, curconv);
-      }
-      return(result);
+  if (kwidth < DL_CONV_FFT_MIN) return 0;
+  for (nfft = dlFftSize(2*kwidth); nfft > 0 && nfft <= (1<<24); nfft *= 2) {
+    block = nfft-kwidth+1;
+    cost = (double) ((n+block-1)/block)*nfft*log2((double) nfft);
+    if (!best || cost < bestcost) {
+      best = nfft;
+      bestcost = cost;
     }
+    if (block >= n) break;
   }
-  /* New, deeper recursion */
-  else {
-    if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
-      DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
-      DYN_LIST *curconv;
-      result = dfuCreateDynList(DYN_LIST_DATATYPE(dl), DYN_LIST_N(dl));
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	if (DYN_LIST_DATATYPE(vals[i]) != DF_LIST &&
-	    DYN_LIST_DATATYPE(kernel) == DF_LIST) {
-	  subkernels = DYN_LIST_VALS(kernel);
-	  if (DYN_LIST_N(kernel) == 1) 
-	    curconv = dynListConvList(vals[i], subkernels[0]);
-	  else if (DYN_LIST_N(kernel) == DYN_LIST_N(dl))
-	    curconv = dynListConvList(vals[i], subkernels[i]);
-	  else { 
-	    dfuFreeDynList(result);
-	    return NULL;
-	  }
-	}
-	else if (DYN_LIST_DATATYPE(vals[i]) == DF_LIST &&
-		 DYN_LIST_DATATYPE(kernel) == DF_LIST) {
-	  subkernels = DYN_LIST_VALS(kernel);
-	  if (DYN_LIST_N(kernel) == 1) 
-	    curconv = dynListConvList(vals[i], subkernels[0]);
-	  else if (DYN_LIST_N(kernel) == DYN_LIST_N(dl))
-	    curconv = dynListConvList(vals[i], subkernels[i]);
-	  else { 
-	    dfuFreeDynList(result);
-	    return NULL;
-	  }
-	}
-	else {
-	  curconv = dynListConvList(vals[i], kernel);
-	}
-	if (!curconv) {
-	  dfuFreeDynList(result);
-	  return NULL;
-	}
-	dfuMoveDynListList(result, curconv);
-      }
-      return(result);
-    }
+  if (!best || DL_CONV_FFT_COST*bestcost >= (double) n*kwidth) return 0;
+  return best;
+}
+
+static void dlConvPlanFree(DL_CONV_PLAN *plan)
+{
+  if (!plan) return;
+  if (plan->spectrum) free(plan->spectrum);
+  free(plan);
+}
+
+/*
+ * dlConvPlanCreate - transform kernel for data up to n points long.
+ * Returns NULL if the kernel is unsuitable or the FFT is not worth it.
+ */
+
+static DL_CONV_PLAN *dlConvPlanCreate(DYN_LIST *kernel, DL_SIZE n)
+{
+  DL_CONV_PLAN *plan;
+  DYN_LIST *kf = NULL;
+  float *k;
+  int i, kwidth = DYN_LIST_N(kernel), nfft;
+
+  if (!kwidth || !(kwidth % 2) || n <= kwidth) return NULL;
+  if (DYN_LIST_DATATYPE(kernel) != DF_FLOAT &&
+      DYN_LIST_DATATYPE(kernel) != DF_LONG &&
+      DYN_LIST_DATATYPE(kernel) != DF_SHORT &&
+      DYN_LIST_DATATYPE(kernel) != DF_CHAR) return NULL;
+  if (!(nfft = dlConvFftSize(n, kwidth))) return NULL;
+
+  if (DYN_LIST_DATATYPE(kernel) != DF_FLOAT) {
+    if (!(kf = dynListConvertList(kernel, DF_FLOAT))) return NULL;
+    k = (float *) DYN_LIST_VALS(kf);
   }
+  else k = (float *) DYN_LIST_VALS(kernel);
 
-  /* Return original list, if kernel is empty list */
-  if (DYN_LIST_N(kernel) == 0) {
-    return dfuCopyDynList(dl);
+  plan = (DL_CONV_PLAN *) calloc(1, sizeof(DL_CONV_PLAN));
+  if (plan) plan->spectrum = (double *) calloc(nfft+2, sizeof(double));
+  if (!plan || !plan->spectrum) {
+    dlConvPlanFree(plan);
+    if (kf) dfuFreeDynList(kf);
+    return NULL;
+  }
+  plan->kernel = kernel;
+  plan->kwidth = kwidth;
+  plan->nfft = nfft;
+  plan->block = nfft-kwidth+1;
+  for (i = 0; i < kwidth; i++) {
+    plan->spectrum[i] = k[kwidth-1-i];
+    plan->scale += fabs(k[i]);
   }
+  dlFftReal(nfft, plan->spectrum, 0);
+  if (kf) dfuFreeDynList(kf);
+  return plan;
+}
 
-  if (DYN_LIST_DATATYPE(dl) != DF_FLOAT) {
-    dlf = dynListConvertList(dl, DF_FLOAT);
+/*
+ * dlConvFft - out[i] = sum of k[j] v[i+j-kwidth/2], by overlap-add.
+ * Results within rounding noise of 0 are set to 0, so stretches of
+ * zeros in the data stay exactly 0.  Returns 0 if out of memory.
+ */
+
+static int dlConvFft(DL_CONV_PLAN *plan, float *v, int n, float *out)
+{
+  int nfft = plan->nfft, kwidth = plan->kwidth, hwidth = kwidth/2;
+  int b, i, len, ny = n+kwidth-1;
+  double *buf, *y, *s = plan->spectrum, re, im, vmax = 0.0, tol;
+
+  buf = (double *) malloc((nfft+2)*sizeof(double));
+  y = (double *) calloc(ny, sizeof(double));
+  if (!buf || !y) {
+    if (buf) free(buf);
+    if (y) free(y);
+    return 0;
   }
-  if (DYN_LIST_DATATYPE(kernel) != DF_FLOAT) {
-    kernelf = dynListConvertList(kernel, DF_FLOAT);
+
+  for (b = 0; b < n; b += plan->block) {
+    len = (n-b < plan->block) ? n-b : plan->block;
+    for (i = 0; i < len; i++) {
+      buf[i] = v[b+i];
+      if (fabs(buf[i]) > vmax) vmax = fabs(buf[i]);
+    }
+    for (; i < nfft+2; i++) buf[i] = 0.0;
+    dlFftReal(nfft, buf, 0);
+    for (i = 0; i <= nfft/2; i++) {
+      re = buf[2*i]*s[2*i] - buf[2*i+1]*s[2*i+1];
+      im = buf[2*i]*s[2*i+1] + buf[2*i+1]*s[2*i];
+      buf[2*i] = re;
+      buf[2*i+1] = im;
+    }
+    dlFftReal(nfft, buf, 1);
+    len += kwidth-1;
+    if (b+len > ny) len = ny-b;
+    for (i = 0; i < len; i++) y[b+i] += buf[i];
   }
-  
-  /* Make sure the data is as long or longer than the kernel */
-  if (DYN_LIST_N(dl) <= DYN_LIST_N(kernel)) return NULL;
-  
-  /* For now, insist that kernel length is odd */
-  if (!(DYN_LIST_N(kernel) % 2)) return NULL;
 
-  result = dfuCreateDynList(DF_FLOAT, DYN_LIST_N(dl));
-  length = DYN_LIST_N(dl);
+  tol = DL_CONV_FFT_TOL*vmax*plan->scale;
+  for (i = 0; i < n; i++)
+    out[i] = (fabs(y[i+hwidth]) <= tol) ? 0.0 : (float) y[i+hwidth];
 
-  if (dlf)
-    v = (float *) DYN_LIST_VALS(dlf);
-  else
-    v = (float *) DYN_LIST_VALS(dl);
+  free(buf);
+  free(y);
+  return 1;
+}
 
-  if (kernelf) 
-    k = (float *) DYN_LIST_VALS(kernelf);
-  else 
-    k = (float *) DYN_LIST_VALS(kernel);
+/*
+ * dlConvDirect - the same sums, term by term
+ */
 
-  kwidth = DYN_LIST_N(kernel);
-  hwidth = kwidth/2;
-  kcenter = k + hwidth;		/* so kernel can be indexed with neg numbers */
+static void dlConvDirect(float *v, int length, float *k, int kwidth,
+			 float *out)
+{
+  int i, j, hwidth = kwidth/2, stop;
+  float *vcur, *kcenter = k + hwidth; /* so kernel can be indexed with
+					 neg numbers */
+  double sum;
 
   /* The beginning of the loop, which will check for lower bound conditions */
   for (i = 0; i < hwidth; i++) {
@@ -5170,7 +5549,7 @@ static DYN_LIST *dynListConvModeList(DYN_LIST *dl, DYN_LIST *kernel, int mode)
     for (j = -hwidth; j <= hwidth; j++) {
       if ((j+i) >= 0) sum += kcenter[j]*vcur[j];
     }
-    dfuAddDynListFloat(result, (float) sum);
+    out[i] = (float) sum;
   }
 
   /* The middle of the loop which doesn't need to check */
@@ -5180,7 +5559,7 @@ static DYN_LIST *dynListConvModeList(DYN_LIST *dl, DYN_LIST *kernel, int mode)
     vcur = v+i;			/* current data center */
     for (j = -hwidth; j <= hwidth; j++) 
       sum += kcenter[j]*vcur[j];
-    dfuAddDynListFloat(result, (float) sum);
+    out[i] = (float) sum;
   }
 
   /* The end of the loop which checks upper boundary conditions */
@@ -5190,22 +5569,196 @@ static DYN_LIST *dynListConvModeList(DYN_LIST *dl, DYN_LIST *kernel, int mode)
     for (j = -hwidth; j <= hwidth; j++) {
       if ((j+i) < length) sum += kcenter[j]*vcur[j];
     }
-    dfuAddDynListFloat(result, (float) sum);
+    out[i] = (float) sum;
+  }
+}
+
+/*
+ * dynListConvVals - convolve one list of numbers, using plan if it
+ * was made for this kernel
+ */
+
+static DYN_LIST *dynListConvVals(DYN_LIST *dl, DYN_LIST *kernel,
+				 DL_CONV_PLAN *plan)
+{
+  DYN_LIST *dlf = NULL, *kernelf = NULL;
+  DL_CONV_PLAN *ownplan = NULL;
+  float *v, *k, *out;
+  int length, kwidth, ok = 1;
+
+  /* Return original list, if kernel is empty list */
+  if (DYN_LIST_N(kernel) == 0) {
+    return dfuCopyDynList(dl);
+  }
+
+  if (DYN_LIST_DATATYPE(dl) == DF_STRING || DYN_LIST_DATATYPE(dl) == DF_LIST ||
+      DYN_LIST_DATATYPE(kernel) == DF_STRING ||
+      DYN_LIST_DATATYPE(kernel) == DF_LIST) return NULL;
+
+  /* Make sure the data is as long or longer than the kernel */
+  if (DYN_LIST_N(dl) <= DYN_LIST_N(kernel)) return NULL;
+  
+  /* For now, insist that kernel length is odd */
+  if (!(DYN_LIST_N(kernel) % 2)) return NULL;
+
+  length = DYN_LIST_N(dl);
+  kwidth = DYN_LIST_N(kernel);
+  if (!(out = (float *) malloc(length*sizeof(float)))) return NULL;
+
+  if (DYN_LIST_DATATYPE(dl) != DF_FLOAT) {
+    dlf = dynListConvertList(dl, DF_FLOAT);
+    v = (float *) DYN_LIST_VALS(dlf);
+  }
+  else v = (float *) DYN_LIST_VALS(dl);
+
+  /* a shared plan made for much longer lists would waste time here */
+  if (!dlConvFftSize(length, kwidth)) plan = NULL;
+  else if (!plan || plan->kernel != kernel ||
+	   (length+kwidth-1)*2 <= plan->nfft) {
+    plan = ownplan = dlConvPlanCreate(kernel, length);
+  }
+
+  if (plan) {
+    ok = dlConvFft(plan, v, length, out);
+  }
+  else {
+    if (DYN_LIST_DATATYPE(kernel) != DF_FLOAT) {
+      kernelf = dynListConvertList(kernel, DF_FLOAT);
+      k = (float *) DYN_LIST_VALS(kernelf);
+    }
+    else k = (float *) DYN_LIST_VALS(kernel);
+    dlConvDirect(v, length, k, kwidth, out);
   }
 
+  if (ownplan) dlConvPlanFree(ownplan);
   if (kernelf) dfuFreeDynList(kernelf);
   if (dlf) dfuFreeDynList(dlf);
+  if (!ok) {
+    free(out);
+    return NULL;
+  }
+  return dfuCreateDynListWithVals(DF_FLOAT, length, out);
+}
+
+/*
+ * dynListConvElements - numbers in dl and its sublists, and the length
+ * of the longest list of numbers among them
+ */
+
+static DL_SIZE dynListConvElements(DYN_LIST *dl, int *maxn)
+{
+  DL_SIZE i, n = 0;
+  DYN_LIST **vals;
+
+  if (DYN_LIST_DATATYPE(dl) != DF_LIST) {
+    if (DYN_LIST_N(dl) > *maxn) *maxn = DYN_LIST_N(dl);
+    return DYN_LIST_N(dl);
+  }
+  vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+  for (i = 0; i < DYN_LIST_N(dl); i++) n += dynListConvElements(vals[i], maxn);
+  return n;
+}
+
+typedef struct {
+  DYN_LIST **lists;
+  DYN_LIST **kernels;
+  DL_CONV_PLAN *plan;
+  DYN_LIST **results;
+} DL_CONV_JOB;
+
+static DYN_LIST *dynListConvPlanList(DYN_LIST *dl, DYN_LIST *kernel,
+				     int mode, DL_CONV_PLAN *plan);
+
+static void dynListConvRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_CONV_JOB *job = (DL_CONV_JOB *) cd;
+  DL_SIZE i;
+
+  /* sublists are convolved as dl_conv would, at any depth */
+  for (i = start; i < stop; i++)
+    job->results[i] = dynListConvPlanList(job->lists[i], job->kernels[i],
+					  0, job->plan);
+}
+
+/*
+ * dynListConvPlanList - convolve dl, or each of its sublists, with
+ * kernel.  A kernel that is a list of lists gives one kernel per
+ * sublist (or one for all if it has a single sublist); the original
+ * convolve (mode 0) only does so for sublists of numbers, while the
+ * deeper recursion (mode 1) does for any sublist.  The kernel used
+ * for every sublist is transformed once, up front, and the sublists
+ * are done in parallel.
+ */
+
+static DYN_LIST *dynListConvPlanList(DYN_LIST *dl, DYN_LIST *kernel,
+				     int mode, DL_CONV_PLAN *plan)
+{
+  int i, n, ok = 1, maxn = 0;
+  DYN_LIST *result = NULL, *shared = NULL, **vals, **subkernels;
+  DL_CONV_PLAN *ownplan = NULL;
+  DL_CONV_JOB job;
+  DL_SIZE work;
+
+  if (DYN_LIST_DATATYPE(dl) != DF_LIST)
+    return dynListConvVals(dl, kernel, plan);
+
+  n = DYN_LIST_N(dl);
+  vals = (DYN_LIST **) DYN_LIST_VALS(dl);
+  memset(&job, 0, sizeof(job));
+  job.lists = vals;
+  job.kernels = (DYN_LIST **) calloc(n+1, sizeof(DYN_LIST *));
+  job.results = (DYN_LIST **) calloc(n+1, sizeof(DYN_LIST *));
+  if (!job.kernels || !job.results) goto done;
+
+  for (i = 0; i < n; i++) {
+    if (DYN_LIST_DATATYPE(kernel) == DF_LIST &&
+	(mode || DYN_LIST_DATATYPE(vals[i]) != DF_LIST)) {
+      subkernels = (DYN_LIST **) DYN_LIST_VALS(kernel);
+      if (DYN_LIST_N(kernel) == 1) job.kernels[i] = subkernels[0];
+      else if (DYN_LIST_N(kernel) == DYN_LIST_N(dl))
+	job.kernels[i] = subkernels[i];
+      else goto done;
+    }
+    else job.kernels[i] = kernel;
+  }
+
+  if (DYN_LIST_DATATYPE(kernel) != DF_LIST) shared = kernel;
+  else if (DYN_LIST_N(kernel) == 1) 
+    shared = ((DYN_LIST **) DYN_LIST_VALS(kernel))[0];
+  work = dynListConvElements(dl, &maxn);
+  if (shared && DYN_LIST_DATATYPE(shared) != DF_LIST) {
+    if (!plan || plan->kernel != shared) 
+      plan = ownplan = dlConvPlanCreate(shared, maxn);
+    work *= DYN_LIST_N(shared);
+  }
+  job.plan = plan;
+
+  dlParallelFor(n, work, dynListConvRange, &job);
+
+  for (i = 0; i < n; i++) if (!job.results[i]) ok = 0;
+  if (ok) {
+    result = dfuCreateDynList(DF_LIST, n > 0 ? n : 1);
+    for (i = 0; i < n; i++) dfuMoveDynListList(result, job.results[i]);
+  }
+  else {
+    for (i = 0; i < n; i++)
+      if (job.results[i]) dfuFreeDynList(job.results[i]);
+  }
 
+ done:
+  if (ownplan) dlConvPlanFree(ownplan);
+  if (job.kernels) free(job.kernels);
+  if (job.results) free(job.results);
   return(result);
 }
 
 DYN_LIST *dynListConvList(DYN_LIST *dl, DYN_LIST *kernel)
 {
-  return dynListConvModeList(dl, kernel, 0);
+  return dynListConvPlanList(dl, kernel, 0, NULL);
 }
 
 DYN_LIST *dynListConvList2(DYN_LIST *dl, DYN_LIST *kernel)
 {
-  return dynListConvModeList(dl, kernel, 1);
+  return dynListConvPlanList(dl, kernel, 1, NULL);
 }
 
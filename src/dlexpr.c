@@ -0,0 +1,1115 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlexpr.c
+ *
+ *  DESCRIPTION
+ *    Fused evaluation of elementwise dynlist expressions.
+ *
+ *    dl_expr expression
+ *
+ *    e.g. dl_expr {a * b + c / 2.0 > thresh && !(g:x == 0)}
+ *
+ *    The expression is compiled once (and cached by its source string)
+ *    into a list of nodes, which is then evaluated a block of elements
+ *    at a time: every operator works on small buffers that stay in
+ *    cache, and the only full length allocation is the result.  The
+ *    same expression written as nested dl_add / dl_mult ... calls makes
+ *    (and registers as a temporary) one full list per operator.
+ *
+ *    Operands are dynlist names (anything tclFindDynList accepts,
+ *    including group:list), $name for a Tcl variable holding a list
+ *    name, and numbers.  Operators, loosest binding first:
+ *
+ *      ||   &&   == !=   < <= > >=   + -   * / %   unary - + !
+ *
+ *    and the functions abs acos asin atan ceil cos cosh exp floor log
+ *    log10 round sin sinh sqrt tan tanh lgamma (one argument) and min
+ *    max pow atan2 fmod (two arguments).
+ *
+ *    Result types, broadcasting of length 1 lists and recursion into
+ *    lists of lists follow dl_add, dl_lt, dl_sqrt, etc., so dl_expr
+ *    gives the same list as the equivalent nested commands.  x % y is
+ *    0 where y is 0.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+
+#include <tcl.h>
+
+#include "df.h"
+#include "dfana.h"
+#include "tcl_dl.h"
+#include "dlsimd.h"
+
+#define DL_EXPR_BLOCK      1024	/* elements evaluated per pass        */
+#define DL_EXPR_MAX_CACHE  512	/* compiled expressions kept per interp */
+#define DL_EXPR_ASSOC_KEY  "dlexpr"
+
+enum DL_EXPR_KINDS { DL_EXPR_CONST, DL_EXPR_VAR, DL_EXPR_NEG, DL_EXPR_NOT,
+		     DL_EXPR_FUNC1, DL_EXPR_ARITH, DL_EXPR_RELATION };
+
+typedef struct {
+  int kind;
+  int op;			/* DL_MATH_*, DL_RELATION_*, DL_MATHFUNC1 */
+  int a, b;			/* operand nodes                      */
+  int var;			/* DL_EXPR_VAR: index into vars       */
+  int type;			/* DL_EXPR_CONST: DF_LONG or DF_FLOAT */
+  int ival;
+  float fval;
+} DL_EXPR_NODE;
+
+typedef struct {
+  int nnodes, maxnodes;
+  DL_EXPR_NODE *nodes;		/* operands always precede operators */
+  int nvars, maxvars;
+  char **vars;			/* names, "$name" for Tcl variables  */
+  int root;
+  char *scratch;		/* per node block buffers            */
+  int nscratch;
+} DL_EXPR;
+
+/* state of one node while an expression is evaluated */
+typedef struct {
+  int type;
+  int bcast;			/* same value for every element     */
+  void *vals;			/* values for the current block     */
+  char *buf;			/* node result                      */
+  char *cbuf[2];		/* operands converted to float      */
+} DL_EXPR_STATE;
+
+/* one variable: a whole list, or a sublist / element of one */
+typedef struct {
+  int type;
+  DL_SIZE n;
+  void *vals;
+} DL_EXPR_LEAF;
+
+typedef struct {
+  Tcl_HashTable table;
+  int count;
+} DL_EXPR_CACHE;
+
+typedef struct {
+  char *s;
+  DL_EXPR *e;
+  char err[128];
+} DL_EXPR_PARSER;
+
+static struct {
+  char *name;
+  int id;
+  MATH_FUNC1 func;
+} DLExprFuncs1[] = {
+  { "abs",    DL_ABS,    (MATH_FUNC1) fabs },
+  { "acos",   DL_ACOS,   (MATH_FUNC1) acos },
+  { "asin",   DL_ASIN,   (MATH_FUNC1) asin },
+  { "atan",   DL_ATAN,   (MATH_FUNC1) atan },
+  { "ceil",   DL_CEIL,   (MATH_FUNC1) ceil },
+  { "cos",    DL_COS,    (MATH_FUNC1) cos },
+  { "cosh",   DL_COSH,   (MATH_FUNC1) cosh },
+  { "exp",    DL_EXP,    (MATH_FUNC1) exp },
+  { "floor",  DL_FLOOR,  (MATH_FUNC1) floor },
+  { "log",    DL_LOG,    (MATH_FUNC1) log },
+  { "log10",  DL_LOG10,  (MATH_FUNC1) log10 },
+  { "round",  DL_ROUND,  (MATH_FUNC1) round },
+  { "sin",    DL_SIN,    (MATH_FUNC1) sin },
+  { "sinh",   DL_SINH,   (MATH_FUNC1) sinh },
+  { "sqrt",   DL_SQRT,   (MATH_FUNC1) sqrt },
+  { "tan",    DL_TAN,    (MATH_FUNC1) tan },
+  { "tanh",   DL_TANH,   (MATH_FUNC1) tanh },
+  { "lgamma", DL_LGAMMA, (MATH_FUNC1) lgamma },
+  { NULL, 0, NULL }
+};
+
+static struct {
+  char *name;
+  int op;
+} DLExprFuncs2[] = {
+  { "min",   DL_MATH_MIN },
+  { "max",   DL_MATH_MAX },
+  { "pow",   DL_MATH_POW },
+  { "atan2", DL_MATH_ATAN2 },
+  { "fmod",  DL_MATH_FMOD },
+  { NULL, 0 }
+};
+
+static MATH_FUNC1 dlExprFunc1(int id)
+{
+  int i;
+  for (i = 0; DLExprFuncs1[i].name; i++)
+    if (DLExprFuncs1[i].id == id) return DLExprFuncs1[i].func;
+  return NULL;
+}
+
+static int dlExprElementSize(int type)
+{
+  return dfuDynListElementSize(type);
+}
+
+/*****************************************************************************
+ *
+ * Compiling
+ *
+ *****************************************************************************/
+
+static void dlExprFree(DL_EXPR *e)
+{
+  int i;
+  if (!e) return;
+  for (i = 0; i < e->nvars; i++) free(e->vars[i]);
+  if (e->vars) free(e->vars);
+  if (e->nodes) free(e->nodes);
+  if (e->scratch) free(e->scratch);
+  free(e);
+}
+
+static int dlExprAddNode(DL_EXPR_PARSER *p, int kind, int op, int a, int b)
+{
+  DL_EXPR *e = p->e;
+  DL_EXPR_NODE *nd;
+  if (e->nnodes == e->maxnodes) {
+    e->maxnodes = e->maxnodes ? 2 * e->maxnodes : 16;
+    e->nodes = (DL_EXPR_NODE *) realloc(e->nodes,
+					e->maxnodes * sizeof(DL_EXPR_NODE));
+  }
+  nd = &e->nodes[e->nnodes];
+  memset(nd, 0, sizeof(DL_EXPR_NODE));
+  nd->kind = kind;
+  nd->op = op;
+  nd->a = a;
+  nd->b = b;
+  return e->nnodes++;
+}
+
+static int dlExprAddVar(DL_EXPR_PARSER *p, char *name, int len)
+{
+  DL_EXPR *e = p->e;
+  int i, node;
+  for (i = 0; i < e->nvars; i++)
+    if ((int) strlen(e->vars[i]) == len && !strncmp(e->vars[i], name, len))
+      break;
+  if (i == e->nvars) {
+    if (e->nvars == e->maxvars) {
+      e->maxvars = e->maxvars ? 2 * e->maxvars : 8;
+      e->vars = (char **) realloc(e->vars, e->maxvars * sizeof(char *));
+    }
+    e->vars[i] = (char *) malloc(len + 1);
+    memcpy(e->vars[i], name, len);
+    e->vars[i][len] = 0;
+    e->nvars++;
+  }
+  node = dlExprAddNode(p, DL_EXPR_VAR, 0, -1, -1);
+  e->nodes[node].var = i;
+  return node;
+}
+
+static void dlExprSkip(DL_EXPR_PARSER *p)
+{
+  while (isspace((unsigned char) *p->s)) p->s++;
+}
+
+/* consume tok if it is next (and not the start of a longer operator) */
+static int dlExprAccept(DL_EXPR_PARSER *p, char *tok)
+{
+  int len = strlen(tok);
+  dlExprSkip(p);
+  if (strncmp(p->s, tok, len)) return 0;
+  if (len == 1 && (tok[0] == '<' || tok[0] == '>' || tok[0] == '!') &&
+      p->s[1] == '=') return 0;
+  p->s += len;
+  return 1;
+}
+
+static int dlExprError(DL_EXPR_PARSER *p, char *msg)
+{
+  if (!p->err[0]) {
+    if (*p->s) snprintf(p->err, sizeof(p->err), "%s at \"%.20s\"", msg, p->s);
+    else snprintf(p->err, sizeof(p->err), "%s at end of expression", msg);
+  }
+  return -1;
+}
+
+static int dlExprIsNameStart(char c)
+{
+  return isalpha((unsigned char) c) || c == '_' || c == '%';
+}
+
+static int dlExprIsNameChar(char c)
+{
+  return isalnum((unsigned char) c) || c == '_' || c == '%' ||
+    c == ':' || c == '.';
+}
+
+static int dlExprParseOr(DL_EXPR_PARSER *p);
+
+static int dlExprParsePrimary(DL_EXPR_PARSER *p)
+{
+  int node, a, b, i, len;
+  char *start;
+
+  dlExprSkip(p);
+  start = p->s;
+
+  if (dlExprAccept(p, "(")) {
+    if ((node = dlExprParseOr(p)) < 0) return -1;
+    if (!dlExprAccept(p, ")")) return dlExprError(p, "missing \")\"");
+    return node;
+  }
+
+  /* numbers: integer literals are ints, anything else float */
+  if (isdigit((unsigned char) *start) ||
+      (*start == '.' && isdigit((unsigned char) start[1]))) {
+    char *end;
+    double d = strtod(start, &end);
+    int isint = 1;
+    for (i = 0; start + i < end; i++)
+      if (!isdigit((unsigned char) start[i])) isint = 0;
+    if (dlExprIsNameChar(*end)) return dlExprError(p, "invalid number");
+    node = dlExprAddNode(p, DL_EXPR_CONST, 0, -1, -1);
+    if (isint && d <= INT_MAX) {
+      p->e->nodes[node].type = DF_LONG;
+      p->e->nodes[node].ival = (int) d;
+    }
+    else {
+      p->e->nodes[node].type = DF_FLOAT;
+      p->e->nodes[node].fval = (float) d;
+    }
+    p->s = end;
+    return node;
+  }
+
+  if (*start == '$') {
+    p->s++;
+    while (dlExprIsNameChar(*p->s)) p->s++;
+    if (p->s == start + 1) return dlExprError(p, "missing variable name");
+    return dlExprAddVar(p, start, p->s - start);
+  }
+
+  if (dlExprIsNameStart(*start)) {
+    while (dlExprIsNameChar(*p->s)) p->s++;
+    len = p->s - start;
+    dlExprSkip(p);
+    if (*p->s != '(') return dlExprAddVar(p, start, len);
+
+    /* function call */
+    for (i = 0; DLExprFuncs1[i].name; i++) {
+      if ((int) strlen(DLExprFuncs1[i].name) == len &&
+	  !strncmp(DLExprFuncs1[i].name, start, len)) {
+	p->s++;
+	if ((a = dlExprParseOr(p)) < 0) return -1;
+	if (!dlExprAccept(p, ")")) return dlExprError(p, "missing \")\"");
+	return dlExprAddNode(p, DL_EXPR_FUNC1, DLExprFuncs1[i].id, a, -1);
+      }
+    }
+    for (i = 0; DLExprFuncs2[i].name; i++) {
+      if ((int) strlen(DLExprFuncs2[i].name) == len &&
+	  !strncmp(DLExprFuncs2[i].name, start, len)) {
+	p->s++;
+	if ((a = dlExprParseOr(p)) < 0) return -1;
+	if (!dlExprAccept(p, ",")) return dlExprError(p, "expected \",\"");
+	if ((b = dlExprParseOr(p)) < 0) return -1;
+	if (!dlExprAccept(p, ")")) return dlExprError(p, "missing \")\"");
+	return dlExprAddNode(p, DL_EXPR_ARITH, DLExprFuncs2[i].op, a, b);
+      }
+    }
+    p->s = start;
+    return dlExprError(p, "unknown function");
+  }
+  return dlExprError(p, "syntax error");
+}
+
+static int dlExprParseUnary(DL_EXPR_PARSER *p)
+{
+  int a;
+  if (dlExprAccept(p, "-")) {
+    if ((a = dlExprParseUnary(p)) < 0) return -1;
+    return dlExprAddNode(p, DL_EXPR_NEG, 0, a, -1);
+  }
+  if (dlExprAccept(p, "!")) {
+    if ((a = dlExprParseUnary(p)) < 0) return -1;
+    return dlExprAddNode(p, DL_EXPR_NOT, 0, a, -1);
+  }
+  if (dlExprAccept(p, "+")) return dlExprParseUnary(p);
+  return dlExprParsePrimary(p);
+}
+
+static int dlExprParseMul(DL_EXPR_PARSER *p)
+{
+  int a, b, kind, op;
+  if ((a = dlExprParseUnary(p)) < 0) return -1;
+  for (;;) {
+    if (dlExprAccept(p, "*")) { kind = DL_EXPR_ARITH; op = DL_MATH_MUL; }
+    else if (dlExprAccept(p, "/")) { kind = DL_EXPR_ARITH; op = DL_MATH_DIV; }
+    else if (dlExprAccept(p, "%"))
+      { kind = DL_EXPR_RELATION; op = DL_RELATION_MOD; }
+    else return a;
+    if ((b = dlExprParseUnary(p)) < 0) return -1;
+    a = dlExprAddNode(p, kind, op, a, b);
+  }
+}
+
+static int dlExprParseAdd(DL_EXPR_PARSER *p)
+{
+  int a, b, op;
+  if ((a = dlExprParseMul(p)) < 0) return -1;
+  for (;;) {
+    if (dlExprAccept(p, "+")) op = DL_MATH_ADD;
+    else if (dlExprAccept(p, "-")) op = DL_MATH_SUB;
+    else return a;
+    if ((b = dlExprParseMul(p)) < 0) return -1;
+    a = dlExprAddNode(p, DL_EXPR_ARITH, op, a, b);
+  }
+}
+
+static int dlExprParseCompare(DL_EXPR_PARSER *p)
+{
+  int a, b, op;
+  if ((a = dlExprParseAdd(p)) < 0) return -1;
+  for (;;) {
+    if (dlExprAccept(p, "<=")) op = DL_RELATION_LTE;
+    else if (dlExprAccept(p, ">=")) op = DL_RELATION_GTE;
+    else if (dlExprAccept(p, "<")) op = DL_RELATION_LT;
+    else if (dlExprAccept(p, ">")) op = DL_RELATION_GT;
+    else return a;
+    if ((b = dlExprParseAdd(p)) < 0) return -1;
+    a = dlExprAddNode(p, DL_EXPR_RELATION, op, a, b);
+  }
+}
+
+static int dlExprParseEquality(DL_EXPR_PARSER *p)
+{
+  int a, b, op;
+  if ((a = dlExprParseCompare(p)) < 0) return -1;
+  for (;;) {
+    if (dlExprAccept(p, "==")) op = DL_RELATION_EQ;
+    else if (dlExprAccept(p, "!=")) op = DL_RELATION_NE;
+    else return a;
+    if ((b = dlExprParseCompare(p)) < 0) return -1;
+    a = dlExprAddNode(p, DL_EXPR_RELATION, op, a, b);
+  }
+}
+
+static int dlExprParseAnd(DL_EXPR_PARSER *p)
+{
+  int a, b;
+  if ((a = dlExprParseEquality(p)) < 0) return -1;
+  while (dlExprAccept(p, "&&")) {
+    if ((b = dlExprParseEquality(p)) < 0) return -1;
+    a = dlExprAddNode(p, DL_EXPR_RELATION, DL_RELATION_AND, a, b);
+  }
+  return a;
+}
+
+static int dlExprParseOr(DL_EXPR_PARSER *p)
+{
+  int a, b;
+  if ((a = dlExprParseAnd(p)) < 0) return -1;
+  while (dlExprAccept(p, "||")) {
+    if ((b = dlExprParseAnd(p)) < 0) return -1;
+    a = dlExprAddNode(p, DL_EXPR_RELATION, DL_RELATION_OR, a, b);
+  }
+  return a;
+}
+
+/*
+ * dlExprCompile - parse source into a new DL_EXPR, or return NULL and
+ * leave a message in err
+ */
+
+static DL_EXPR *dlExprCompile(char *source, char *err, int errsize)
+{
+  DL_EXPR_PARSER p;
+  DL_EXPR *e = (DL_EXPR *) calloc(1, sizeof(DL_EXPR));
+
+  p.s = source;
+  p.e = e;
+  p.err[0] = 0;
+  e->root = dlExprParseOr(&p);
+  if (e->root >= 0) {
+    dlExprSkip(&p);
+    if (*p.s) e->root = dlExprError(&p, "syntax error");
+  }
+  if (e->root < 0) {
+    strncpy(err, p.err, errsize-1);
+    err[errsize-1] = 0;
+    dlExprFree(e);
+    return NULL;
+  }
+  return e;
+}
+
+/*****************************************************************************
+ *
+ * Evaluation
+ *
+ *****************************************************************************/
+
+static double dlExprGetD(int type, void *vals, int i)
+{
+  switch (type) {
+  case DF_FLOAT: return ((float *) vals)[i];
+  case DF_LONG:  return ((int *) vals)[i];
+  case DF_SHORT: return ((short *) vals)[i];
+  default:       return ((char *) vals)[i];
+  }
+}
+
+/* operand as floats: the values themselves, or converted into cbuf */
+static float *dlExprAsFloat(DL_EXPR_STATE *s, int len, char *cbuf)
+{
+  int i;
+  float *f = (float *) cbuf;
+  switch (s->type) {
+  case DF_FLOAT:
+    return (float *) s->vals;
+  case DF_LONG:
+    for (i = 0; i < len; i++) f[i] = ((int *) s->vals)[i];
+    break;
+  case DF_SHORT:
+    for (i = 0; i < len; i++) f[i] = ((short *) s->vals)[i];
+    break;
+  default:
+    for (i = 0; i < len; i++) f[i] = ((char *) s->vals)[i];
+    break;
+  }
+  return f;
+}
+
+#define DL_EXPR_ARITH_LOOP(T, op, x, y, r, len)				\
+  {									\
+    T *X = (T *) (x), *Y = (T *) (y), *R = (T *) (r);			\
+    switch (op) {							\
+    case DL_MATH_ADD:							\
+      for (i = 0; i < len; i++) R[i] = X[i] + Y[i];                     \
+      break;                                                            \
+    case DL_MATH_SUB:							\
+      for (i = 0; i < len; i++) R[i] = X[i] - Y[i];                     \
+      break;                                                            \
+    case DL_MATH_MUL:							\
+      for (i = 0; i < len; i++) R[i] = X[i] * Y[i];                     \
+      break;                                                            \
+    case DL_MATH_DIV:							\
+      for (i = 0; i < len; i++) {					\
+	if (Y[i]) R[i] = X[i] / Y[i];					\
+	else R[i] = 0;							\
+      }									\
+      break;								\
+    case DL_MATH_MIN:							\
+      for (i = 0; i < len; i++) R[i] = X[i] < Y[i] ? X[i] : Y[i];       \
+      break;                                                            \
+    case DL_MATH_MAX:							\
+      for (i = 0; i < len; i++) R[i] = X[i] > Y[i] ? X[i] : Y[i];       \
+      break;                                                            \
+    case DL_MATH_POW:							\
+      for (i = 0; i < len; i++) R[i] = (T) pow(X[i], Y[i]);             \
+      break;                                                            \
+    case DL_MATH_ATAN2:							\
+      for (i = 0; i < len; i++) R[i] = (T) atan2(X[i], Y[i]);           \
+      break;                                                            \
+    case DL_MATH_FMOD:							\
+      for (i = 0; i < len; i++) R[i] = (T) fmod(X[i], Y[i]);            \
+      break;                                                            \
+    }									\
+  }
+
+#define DL_EXPR_RELATION_LOOP(T, op, x, y, r, len)			\
+  {									\
+    T *X = (T *) (x), *Y = (T *) (y);					\
+    int *R = (int *) (r);						\
+    switch (op) {							\
+    case DL_RELATION_OR:						\
+      for (i = 0; i < len; i++) R[i] = X[i] || Y[i];                    \
+      break;                                                            \
+    case DL_RELATION_AND:						\
+      for (i = 0; i < len; i++) R[i] = X[i] && Y[i];                    \
+      break;                                                            \
+    case DL_RELATION_EQ:						\
+      for (i = 0; i < len; i++) R[i] = X[i] == Y[i];                    \
+      break;                                                            \
+    case DL_RELATION_NE:						\
+      for (i = 0; i < len; i++) R[i] = X[i] != Y[i];                    \
+      break;                                                            \
+    case DL_RELATION_LT:						\
+      for (i = 0; i < len; i++) R[i] = X[i] < Y[i];                     \
+      break;                                                            \
+    case DL_RELATION_LTE:						\
+      for (i = 0; i < len; i++) R[i] = X[i] <= Y[i];                    \
+      break;                                                            \
+    case DL_RELATION_GT:						\
+      for (i = 0; i < len; i++) R[i] = X[i] > Y[i];                     \
+      break;                                                            \
+    case DL_RELATION_GTE:						\
+      for (i = 0; i < len; i++) R[i] = X[i] >= Y[i];                    \
+      break;                                                            \
+    }									\
+  }
+
+#define DL_EXPR_MAP_LOOP(TI, TO, x, r, len, EXPR)			\
+  {									\
+    TI *X = (TI *) (x);							\
+    TO *R = (TO *) (r);							\
+    for (i = 0; i < len; i++) R[i] = EXPR;				\
+  }
+
+static int dlExprArith(int op, DL_EXPR_STATE *sa, DL_EXPR_STATE *sb,
+		       DL_EXPR_STATE *st, int len, void *out)
+{
+  int i;
+
+  if (dlSimdArith(op, 0, len, sa->type, sa->vals, sb->type, sb->vals, out))
+    return 1;
+
+  if (sa->type == sb->type) {
+    switch (sa->type) {
+    case DF_LONG:  DL_EXPR_ARITH_LOOP(int, op, sa->vals, sb->vals, out, len);
+      break;
+    case DF_SHORT: DL_EXPR_ARITH_LOOP(short, op, sa->vals, sb->vals, out, len);
+      break;
+    case DF_CHAR:  DL_EXPR_ARITH_LOOP(char, op, sa->vals, sb->vals, out, len);
+      break;
+    case DF_FLOAT: DL_EXPR_ARITH_LOOP(float, op, sa->vals, sb->vals, out, len);
+      break;
+    }
+  }
+  else if (op == DL_MATH_POW || op == DL_MATH_ATAN2 || op == DL_MATH_FMOD) {
+    /* these take each operand to double directly */
+    float *r = (float *) out;
+    double x, y;
+    for (i = 0; i < len; i++) {
+      x = dlExprGetD(sa->type, sa->vals, i);
+      y = dlExprGetD(sb->type, sb->vals, i);
+      switch (op) {
+      case DL_MATH_POW:   r[i] = (float) pow(x, y);   break;
+      case DL_MATH_ATAN2: r[i] = (float) atan2(x, y); break;
+      default:            r[i] = (float) fmod(x, y);  break;
+      }
+    }
+  }
+  else {
+    float *x = dlExprAsFloat(sa, len, st->cbuf[0]);
+    float *y = dlExprAsFloat(sb, len, st->cbuf[1]);
+    DL_EXPR_ARITH_LOOP(float, op, x, y, out, len);
+  }
+  return 1;
+}
+
+static int dlExprRelation(int op, DL_EXPR_STATE *sa, DL_EXPR_STATE *sb,
+			  DL_EXPR_STATE *st, int len, void *out)
+{
+  int i, *r = (int *) out;
+
+  if (op == DL_RELATION_MOD) {
+    int x, y;
+    for (i = 0; i < len; i++) {
+      x = (int) dlExprGetD(sa->type, sa->vals, i);
+      y = (int) dlExprGetD(sb->type, sb->vals, i);
+      r[i] = y ? x % y : 0;
+    }
+    return 1;
+  }
+
+  if (dlSimdRelation(op, 0, len, sa->type, sa->vals, sb->type, sb->vals, r))
+    return 1;
+
+  if (sa->type == sb->type) {
+    switch (sa->type) {
+    case DF_LONG:  DL_EXPR_RELATION_LOOP(int, op, sa->vals, sb->vals, r, len);
+      break;
+    case DF_SHORT: DL_EXPR_RELATION_LOOP(short, op, sa->vals, sb->vals, r, len);
+      break;
+    case DF_CHAR:  DL_EXPR_RELATION_LOOP(char, op, sa->vals, sb->vals, r, len);
+      break;
+    case DF_FLOAT: DL_EXPR_RELATION_LOOP(float, op, sa->vals, sb->vals, r, len);
+      break;
+    }
+  }
+  else {
+    float *x = dlExprAsFloat(sa, len, st->cbuf[0]);
+    float *y = dlExprAsFloat(sb, len, st->cbuf[1]);
+    DL_EXPR_RELATION_LOOP(float, op, x, y, r, len);
+  }
+  return 1;
+}
+
+/* domain checks made by dynListMathOneArg when dl_setMatherr is on */
+static int dlExprMathDomain(int id, DL_EXPR_STATE *sa, int len)
+{
+  int i;
+  double v;
+  if (!dynListGetMatherrCheck()) return 1;
+  for (i = 0; i < len; i++) {
+    v = dlExprGetD(sa->type, sa->vals, i);
+    switch (id) {
+    case DL_SQRT:
+      if (v < 0.0) return 0;
+      break;
+    case DL_LOG:
+    case DL_LOG10:
+      if (v <= 0.0) return 0;
+      break;
+    case DL_ACOS:
+    case DL_ASIN:
+    case DL_ATAN:
+      if (v < -1.0 || v > 1.0) return 0;
+      break;
+    }
+  }
+  return 1;
+}
+
+static int dlExprFunc1Type(int id, int type)
+{
+  if (id == DL_CEIL || id == DL_FLOOR || id == DL_ROUND) return DF_LONG;
+  if (id == DL_ABS && type != DF_FLOAT) return type;
+  return DF_FLOAT;
+}
+
+static int dlExprMath(int id, DL_EXPR_STATE *sa, int len, void *out)
+{
+  int i;
+  MATH_FUNC1 f = dlExprFunc1(id);
+
+  if (!dlExprMathDomain(id, sa, len)) return 0;
+
+  switch (dlExprFunc1Type(id, sa->type)) {
+  case DF_LONG:
+    if (id != DL_ABS) {
+      int *r = (int *) out;
+      for (i = 0; i < len; i++)
+	r[i] = (int) (*f)(dlExprGetD(sa->type, sa->vals, i));
+    }
+    else DL_EXPR_MAP_LOOP(int, int, sa->vals, out, len,
+			  X[i] >= 0 ? X[i] : -X[i]);
+    break;
+  case DF_SHORT:
+    DL_EXPR_MAP_LOOP(short, short, sa->vals, out, len,
+		     X[i] >= 0 ? X[i] : (short) -X[i]);
+    break;
+  case DF_CHAR:			/* as dl_abs, chars are left alone */
+    memcpy(out, sa->vals, len);
+    break;
+  case DF_FLOAT:
+    if (sa->type == DF_FLOAT &&
+	dlSimdMath1(id, len, (float *) sa->vals, (float *) out)) break;
+    {
+      float *r = (float *) out;
+      for (i = 0; i < len; i++)
+	r[i] = (*f)(dlExprGetD(sa->type, sa->vals, i));
+    }
+    break;
+  }
+  return 1;
+}
+
+/*
+ * dlExprTypes - result type of every node, and whether it is the same
+ * for every element (only depends on constants and length 1 lists)
+ */
+
+static int dlExprTypes(DL_EXPR *e, DL_EXPR_STATE *st, DL_EXPR_LEAF *leaves,
+		       char **err)
+{
+  int k, ta, tb;
+  DL_EXPR_NODE *nd;
+
+  for (k = 0; k < e->nnodes; k++) {
+    nd = &e->nodes[k];
+    switch (nd->kind) {
+    case DL_EXPR_CONST:
+      st[k].type = nd->type;
+      st[k].bcast = 1;
+      break;
+    case DL_EXPR_VAR:
+      st[k].type = leaves[nd->var].type;
+      st[k].bcast = (leaves[nd->var].n == 1);
+      break;
+    case DL_EXPR_NEG:
+      st[k].type = st[nd->a].type;
+      st[k].bcast = st[nd->a].bcast;
+      break;
+    case DL_EXPR_NOT:
+      st[k].type = DF_LONG;
+      st[k].bcast = st[nd->a].bcast;
+      break;
+    case DL_EXPR_FUNC1:
+      st[k].type = dlExprFunc1Type(nd->op, st[nd->a].type);
+      st[k].bcast = st[nd->a].bcast;
+      break;
+    default:
+      ta = st[nd->a].type;
+      tb = st[nd->b].type;
+      if (ta != tb && ta != DF_FLOAT && tb != DF_FLOAT) {
+	*err = "unable to combine lists of different types";
+	return 0;
+      }
+      if (nd->kind == DL_EXPR_RELATION) st[k].type = DF_LONG;
+      else st[k].type = (ta == tb) ? ta : DF_FLOAT;
+      st[k].bcast = st[nd->a].bcast && st[nd->b].bcast;
+      break;
+    }
+  }
+  return 1;
+}
+
+/* compute node k for len elements into out */
+static int dlExprNode(DL_EXPR *e, DL_EXPR_STATE *st, DL_EXPR_LEAF *leaves,
+		      int k, int len, void *out, char **err)
+{
+  int i;
+  DL_EXPR_NODE *nd = &e->nodes[k];
+  DL_EXPR_STATE *sa = nd->a >= 0 ? &st[nd->a] : NULL;
+  DL_EXPR_STATE *sb = nd->b >= 0 ? &st[nd->b] : NULL;
+
+  switch (nd->kind) {
+  case DL_EXPR_CONST:
+    if (nd->type == DF_LONG)
+      for (i = 0; i < len; i++) ((int *) out)[i] = nd->ival;
+    else
+      for (i = 0; i < len; i++) ((float *) out)[i] = nd->fval;
+    break;
+  case DL_EXPR_VAR:		/* a length 1 list spread over a block */
+    {
+      int size = dlExprElementSize(st[k].type);
+      for (i = 0; i < len; i++)
+	memcpy((char *) out + i * size, leaves[nd->var].vals, size);
+    }
+    break;
+  case DL_EXPR_NEG:
+    switch (sa->type) {
+    case DF_LONG:  DL_EXPR_MAP_LOOP(int, int, sa->vals, out, len, -X[i]);
+      break;
+    case DF_SHORT: DL_EXPR_MAP_LOOP(short, short, sa->vals, out, len,
+				    (short) -X[i]);
+      break;
+    case DF_CHAR:  DL_EXPR_MAP_LOOP(char, char, sa->vals, out, len,
+				    (char) -X[i]);
+      break;
+    case DF_FLOAT: DL_EXPR_MAP_LOOP(float, float, sa->vals, out, len, -X[i]);
+      break;
+    }
+    break;
+  case DL_EXPR_NOT:
+    switch (sa->type) {
+    case DF_LONG:  DL_EXPR_MAP_LOOP(int, int, sa->vals, out, len, !X[i]);
+      break;
+    case DF_SHORT: DL_EXPR_MAP_LOOP(short, int, sa->vals, out, len, !X[i]);
+      break;
+    case DF_CHAR:  DL_EXPR_MAP_LOOP(char, int, sa->vals, out, len, !X[i]);
+      break;
+    case DF_FLOAT: DL_EXPR_MAP_LOOP(float, int, sa->vals, out, len, !X[i]);
+      break;
+    }
+    break;
+  case DL_EXPR_FUNC1:
+    if (!dlExprMath(nd->op, sa, len, out)) {
+      *err = "argument out of domain";
+      return 0;
+    }
+    break;
+  case DL_EXPR_ARITH:
+    return dlExprArith(nd->op, sa, sb, &st[k], len, out);
+  case DL_EXPR_RELATION:
+    return dlExprRelation(nd->op, sa, sb, &st[k], len, out);
+  }
+  return 1;
+}
+
+/* evaluate over lists that are all flat (numeric) */
+static DYN_LIST *dlExprEvalFlat(DL_EXPR *e, DL_EXPR_LEAF *leaves, char **err)
+{
+  int k, v, len, size, block, empty = 0;
+  DL_SIZE n = 1, off;
+  DL_EXPR_STATE *st;
+  char *outvals;
+  DYN_LIST *result = NULL;
+
+  for (v = 0; v < e->nvars; v++) {
+    if (leaves[v].type == DF_STRING) {
+      *err = "string lists are not supported";
+      return NULL;
+    }
+    if (leaves[v].n == 0) empty = 1;
+    else if (leaves[v].n != 1) {
+      if (n == 1) n = leaves[v].n;
+      else if (leaves[v].n != n) {
+	*err = "list lengths do not match";
+	return NULL;
+      }
+    }
+  }
+  block = (n < DL_EXPR_BLOCK) ? (int) n : DL_EXPR_BLOCK;
+
+  /* node states, then three block buffers per node */
+  size = e->nnodes * (sizeof(DL_EXPR_STATE) + 3 * block * sizeof(float));
+  if (size > e->nscratch) {
+    if (e->scratch) free(e->scratch);
+    e->scratch = (char *) malloc(size);
+    e->nscratch = size;
+  }
+  st = (DL_EXPR_STATE *) e->scratch;
+  for (k = 0; k < e->nnodes; k++) {
+    char *b = e->scratch + e->nnodes * sizeof(DL_EXPR_STATE) +
+      3 * k * block * sizeof(float);
+    st[k].buf = b;
+    st[k].cbuf[0] = b + block * sizeof(float);
+    st[k].cbuf[1] = b + 2 * block * sizeof(float);
+  }
+
+  if (!dlExprTypes(e, st, leaves, err)) return NULL;
+  size = dlExprElementSize(st[e->root].type);
+  if (empty) return dfuCreateDynList(st[e->root].type, 1);
+
+  /* nodes that are the same everywhere are done once, a block wide */
+  for (k = 0; k < e->nnodes; k++) {
+    if (!st[k].bcast) continue;
+    if (!dlExprNode(e, st, leaves, k, block, st[k].buf, err)) return NULL;
+    st[k].vals = st[k].buf;
+  }
+
+  if (!(outvals = (char *) malloc(n * size))) {
+    *err = "out of memory";
+    return NULL;
+  }
+  for (off = 0; off < n; off += len) {
+    len = (n - off < block) ? (int) (n - off) : block;
+    for (k = 0; k < e->nnodes; k++) {
+      DL_EXPR_NODE *nd = &e->nodes[k];
+      void *out;
+      if (st[k].bcast) continue;
+      if (nd->kind == DL_EXPR_VAR) {	/* no copy, read in place */
+	st[k].vals = (char *) leaves[nd->var].vals +
+	  off * dlExprElementSize(st[k].type);
+	continue;
+      }
+      out = (k == e->root) ? outvals + off * size : st[k].buf;
+      if (!dlExprNode(e, st, leaves, k, len, out, err)) {
+	free(outvals);
+	return NULL;
+      }
+      st[k].vals = out;
+    }
+    if (st[e->root].bcast || e->nodes[e->root].kind == DL_EXPR_VAR)
+      memcpy(outvals + off * size, st[e->root].vals, len * size);
+  }
+  result = dfuCreateDynListWithVals(st[e->root].type, n, outvals);
+  return result;
+}
+
+/*
+ * dlExprEval - evaluate e with its variables bound to leaves.  If any
+ * is a list of lists the expression is applied row by row, pairing
+ * sublists as dl_add does: a list of lists of length 1 is used for
+ * every row, and a flat list as long as the number of rows gives one
+ * element per row (otherwise it is used whole in every row).
+ */
+
+static DYN_LIST *dlExprEval(DL_EXPR *e, DL_EXPR_LEAF *leaves, char **err)
+{
+  int v;
+  DL_SIZE r, rows = -1;
+  DL_EXPR_LEAF *sub;
+  DYN_LIST *result, *cur;
+
+  for (v = 0; v < e->nvars; v++) {
+    if (leaves[v].type != DF_LIST) continue;
+    if (rows < 0 || rows == 1) rows = leaves[v].n;
+    else if (leaves[v].n != 1 && leaves[v].n != rows) {
+      *err = "list lengths do not match";
+      return NULL;
+    }
+  }
+  if (rows < 0) return dlExprEvalFlat(e, leaves, err);
+
+  sub = (DL_EXPR_LEAF *) malloc(e->nvars * sizeof(DL_EXPR_LEAF));
+  result = dfuCreateDynList(DF_LIST, rows ? rows : 1);
+  for (r = 0; r < rows; r++) {
+    for (v = 0; v < e->nvars; v++) {
+      if (leaves[v].type == DF_LIST) {
+	DYN_LIST *s = ((DYN_LIST **) leaves[v].vals)[leaves[v].n == 1 ? 0 : r];
+	sub[v].type = DYN_LIST_DATATYPE(s);
+	sub[v].n = DYN_LIST_N(s);
+	sub[v].vals = DYN_LIST_VALS(s);
+      }
+      else if (leaves[v].n == rows) {
+	sub[v].type = leaves[v].type;
+	sub[v].n = 1;
+	sub[v].vals = (char *) leaves[v].vals +
+	  r * dlExprElementSize(leaves[v].type);
+      }
+      else sub[v] = leaves[v];
+    }
+    if (!(cur = dlExprEval(e, sub, err))) {
+      dfuFreeDynList(result);
+      free(sub);
+      return NULL;
+    }
+    dfuMoveDynListList(result, cur);
+  }
+  free(sub);
+  return result;
+}
+
+/*****************************************************************************
+ *
+ * Tcl interface
+ *
+ *****************************************************************************/
+
+static void dlExprClearCache(DL_EXPR_CACHE *cache)
+{
+  Tcl_HashEntry *entryPtr;
+  Tcl_HashSearch search;
+  for (entryPtr = Tcl_FirstHashEntry(&cache->table, &search);
+       entryPtr != NULL; entryPtr = Tcl_NextHashEntry(&search)) {
+    dlExprFree((DL_EXPR *) Tcl_GetHashValue(entryPtr));
+  }
+  Tcl_DeleteHashTable(&cache->table);
+  Tcl_InitHashTable(&cache->table, TCL_STRING_KEYS);
+  cache->count = 0;
+}
+
+static void dlExprDeleteCache(ClientData data, Tcl_Interp *interp)
+{
+  DL_EXPR_CACHE *cache = (DL_EXPR_CACHE *) data;
+  dlExprClearCache(cache);
+  Tcl_DeleteHashTable(&cache->table);
+  free(cache);
+}
+
+static DL_EXPR *dlExprGet(Tcl_Interp *interp, DL_EXPR_CACHE *cache,
+			  char *source, char *cmd)
+{
+  Tcl_HashEntry *entryPtr;
+  DL_EXPR *e;
+  char err[128];
+  int newentry;
+
+  if ((entryPtr = Tcl_FindHashEntry(&cache->table, source)))
+    return (DL_EXPR *) Tcl_GetHashValue(entryPtr);
+
+  if (!(e = dlExprCompile(source, err, sizeof(err)))) {
+    Tcl_AppendResult(interp, cmd, ": ", err, (char *) NULL);
+    return NULL;
+  }
+  if (cache->count >= DL_EXPR_MAX_CACHE) dlExprClearCache(cache);
+  entryPtr = Tcl_CreateHashEntry(&cache->table, source, &newentry);
+  Tcl_SetHashValue(entryPtr, e);
+  cache->count++;
+  return e;
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclExprDynList
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_expr
+ *
+ * DESCRIPTION
+ *    Evaluate an elementwise expression over dynlists in one pass.
+ * Arguments are joined with spaces, as for expr.
+ *
+ *****************************************************************************/
+
+static int tclExprDynList(ClientData data, Tcl_Interp *interp,
+			  int argc, char *argv[])
+{
+  DL_EXPR_CACHE *cache = (DL_EXPR_CACHE *) data;
+  DL_EXPR *e;
+  DL_EXPR_LEAF *leaves;
+  DYN_LIST *dl, *result;
+  char *source, *err = NULL, *name;
+  int v;
+
+  if (argc < 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " expression",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (argc == 2) source = argv[1];
+  else source = Tcl_Concat(argc-1, (const char * const *) argv+1);
+  e = dlExprGet(interp, cache, source, argv[0]);
+  if (source != argv[1]) Tcl_Free(source);
+  if (!e) return TCL_ERROR;
+
+  leaves = (DL_EXPR_LEAF *) malloc((e->nvars ? e->nvars : 1) *
+				   sizeof(DL_EXPR_LEAF));
+  for (v = 0; v < e->nvars; v++) {
+    name = e->vars[v];
+    if (name[0] == '$' &&
+	!(name = (char *) Tcl_GetVar(interp, name+1, TCL_LEAVE_ERR_MSG))) {
+      free(leaves);
+      return TCL_ERROR;
+    }
+    if (tclFindDynList(interp, name, &dl) != TCL_OK) {
+      free(leaves);
+      return TCL_ERROR;
+    }
+    leaves[v].type = DYN_LIST_DATATYPE(dl);
+    leaves[v].n = DYN_LIST_N(dl);
+    leaves[v].vals = DYN_LIST_VALS(dl);
+  }
+
+  result = dlExprEval(e, leaves, &err);
+  free(leaves);
+  if (!result) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": ", err ? err : "evaluation failed",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+  return tclPutList(interp, result);
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclExprCache
+ *
+ * TCL FUNCTION
+ *    dl_exprCache ?clear?
+ *
+ * DESCRIPTION
+ *    Return the number of compiled expressions cached, after emptying
+ * the cache if "clear" is given.
+ *
+ *****************************************************************************/
+
+static int tclExprCache(ClientData data, Tcl_Interp *interp,
+			int argc, char *argv[])
+{
+  DL_EXPR_CACHE *cache = (DL_EXPR_CACHE *) data;
+
+  if (argc > 2 || (argc == 2 && strcmp(argv[1], "clear"))) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " ?clear?", (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (argc == 2) dlExprClearCache(cache);
+  Tcl_SetObjResult(interp, Tcl_NewIntObj(cache->count));
+  return TCL_OK;
+}
+
+int DlExpr_Init(Tcl_Interp *interp)
+{
+  DL_EXPR_CACHE *cache = (DL_EXPR_CACHE *) calloc(1, sizeof(DL_EXPR_CACHE));
+  Tcl_InitHashTable(&cache->table, TCL_STRING_KEYS);
+  Tcl_SetAssocData(interp, DL_EXPR_ASSOC_KEY, dlExprDeleteCache, cache);
+
+  Tcl_CreateCommand(interp, "dl_expr", (Tcl_CmdProc *) tclExprDynList,
+		    (ClientData) cache, (Tcl_CmdDeleteProc *) NULL);
+  Tcl_CreateCommand(interp, "dl_exprCache", (Tcl_CmdProc *) tclExprCache,
+		    (ClientData) cache, (Tcl_CmdDeleteProc *) NULL);
+  return TCL_OK;
+}
@@ -0,0 +1,420 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlfft.c
+ *
+ *  DESCRIPTION
+ *    Iterative radix 2 FFTs for the convolutions in dlsdf.c and
+ *  dlarith.c and the spectra of dlspec.c.  A real transform of n points
+ *  is done as a complex transform of n/2 points (even samples in the
+ *  real parts, odd in the imaginary parts) followed by one pass that
+ *  separates the two halves.  Other sizes are done by Bluestein's
+ *  method: the transform is written as a convolution with a chirp,
+ *  which is done with power of two transforms.
+ *
+ *  The bit reversal and twiddle tables for a size, and the chirps for
+ *  the first sizes that need them, are built on first use under a lock
+ *  and never freed, so once built they can be read from any thread
+ *  without locking.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "df.h"
+#include "dlfft.h"
+
+#if !defined(_WIN32)
+#define DL_FFT_PTHREAD 1
+#include <pthread.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DL_FFT_MAX_LOG2 30	/* largest transform is 2^30 points     */
+#define DL_FFT_CHIRPS   16	/* chirps kept for other sizes          */
+
+typedef struct {
+  int m;			/* complex points                       */
+  int *rev;			/* bit reversed index of each point     */
+  double *tw;			/* e^(-2 pi i k/m), k < m/2             */
+  double *rtw;			/* e^(-2 pi i k/2m), k <= m/2           */
+} DL_FFT_PLAN;
+
+typedef struct {
+  int n;			/* points transformed                   */
+  int m;			/* power of two size of the convolution */
+  double *w;			/* e^(-pi i k^2/n), k < n               */
+  double *b;			/* transform of the conjugate chirp     */
+} DL_FFT_CHIRP;
+
+static DL_FFT_PLAN *FftPlans[DL_FFT_MAX_LOG2+1];
+static DL_FFT_CHIRP *FftChirps[DL_FFT_CHIRPS];
+#ifdef DL_FFT_PTHREAD
+static pthread_mutex_t FftPlanMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*
+ * dlFftSize - smallest power of two of at least n points (0 if that
+ * is more than the largest transform)
+ */
+
+int dlFftSize(DL_SIZE n)
+{
+  int size = 1, log2n = 0;
+  while (size < n) {
+    if (++log2n > DL_FFT_MAX_LOG2) return 0;
+    size <<= 1;
+  }
+  return size;
+}
+
+static DL_FFT_PLAN *dlFftMakePlan(int log2m)
+{
+  DL_FFT_PLAN *p;
+  int m = 1 << log2m, k, b, r;
+
+  if (!(p = (DL_FFT_PLAN *) calloc(1, sizeof(DL_FFT_PLAN)))) return NULL;
+  p->m = m;
+  p->rev = (int *) malloc(m*sizeof(int));
+  p->tw = (double *) malloc((m/2+1)*2*sizeof(double));
+  p->rtw = (double *) malloc((m/2+1)*2*sizeof(double));
+  if (!p->rev || !p->tw || !p->rtw) {
+    free(p->rev); free(p->tw); free(p->rtw); free(p);
+    return NULL;
+  }
+  for (k = 0; k < m; k++) {
+    for (b = 0, r = 0; b < log2m; b++) r |= ((k >> b) & 1) << (log2m-1-b);
+    p->rev[k] = r;
+  }
+  for (k = 0; k <= m/2; k++) {
+    p->tw[2*k] = cos(2.0*M_PI*k/m);
+    p->tw[2*k+1] = -sin(2.0*M_PI*k/m);
+    p->rtw[2*k] = cos(M_PI*k/m);
+    p->rtw[2*k+1] = -sin(M_PI*k/m);
+  }
+  return p;
+}
+
+/*
+ * dlFftGetPlan - tables for m complex points (m a power of two)
+ */
+
+static DL_FFT_PLAN *dlFftGetPlan(int m)
+{
+  DL_FFT_PLAN *p;
+  int log2m = 0;
+
+  if (m < 1 || (m & (m-1))) return NULL;
+  while ((1 << log2m) < m) log2m++;
+  if (log2m > DL_FFT_MAX_LOG2) return NULL;
+
+#ifdef DL_FFT_PTHREAD
+  pthread_mutex_lock(&FftPlanMutex);
+#endif
+  if (!(p = FftPlans[log2m])) p = FftPlans[log2m] = dlFftMakePlan(log2m);
+#ifdef DL_FFT_PTHREAD
+  pthread_mutex_unlock(&FftPlanMutex);
+#endif
+  return p;
+}
+
+static void dlFftRun(DL_FFT_PLAN *p, double *z, int inverse)
+{
+  int m = p->m, len, half, step, i, j, k;
+  double wr, wi, xr, xi, sign = inverse ? -1.0 : 1.0;
+  double *a, *b;
+
+  for (k = 0; k < m; k++) {
+    j = p->rev[k];
+    if (j > k) {
+      xr = z[2*k]; z[2*k] = z[2*j]; z[2*j] = xr;
+      xi = z[2*k+1]; z[2*k+1] = z[2*j+1]; z[2*j+1] = xi;
+    }
+  }
+  for (len = 2; len <= m; len <<= 1) {
+    half = len/2;
+    step = m/len;
+    for (i = 0; i < m; i += len) {
+      a = z + 2*i;
+      b = a + 2*half;
+      for (j = 0; j < half; j++) {
+	wr = p->tw[2*j*step];
+	wi = sign*p->tw[2*j*step+1];
+	xr = b[2*j]*wr - b[2*j+1]*wi;
+	xi = b[2*j]*wi + b[2*j+1]*wr;
+	b[2*j] = a[2*j] - xr;
+	b[2*j+1] = a[2*j+1] - xi;
+	a[2*j] += xr;
+	a[2*j+1] += xi;
+      }
+    }
+  }
+}
+
+static void dlFftChirpFree(DL_FFT_CHIRP *c)
+{
+  if (c->w) free(c->w);
+  if (c->b) free(c->b);
+  free(c);
+}
+
+static DL_FFT_CHIRP *dlFftMakeChirp(int n)
+{
+  DL_FFT_CHIRP *c;
+  DL_FFT_PLAN *p;
+  long long k2;
+  int k, m = dlFftSize(2*(DL_SIZE) n-1);
+
+  if (!m || !(p = dlFftGetPlan(m))) return NULL;
+  if (!(c = (DL_FFT_CHIRP *) calloc(1, sizeof(DL_FFT_CHIRP)))) return NULL;
+  c->n = n;
+  c->m = m;
+  c->w = (double *) malloc(2*n*sizeof(double));
+  c->b = (double *) calloc(2*m, sizeof(double));
+  if (!c->w || !c->b) {
+    dlFftChirpFree(c);
+    return NULL;
+  }
+  for (k = 0; k < n; k++) {
+    /* k^2 mod 2n keeps the angle exact for large k */
+    k2 = ((long long) k*k) % (2*(long long) n);
+    c->w[2*k] = cos(M_PI*k2/n);
+    c->w[2*k+1] = -sin(M_PI*k2/n);
+  }
+  c->b[0] = c->w[0];
+  c->b[1] = -c->w[1];
+  for (k = 1; k < n; k++) {
+    c->b[2*k] = c->b[2*(m-k)] = c->w[2*k];
+    c->b[2*k+1] = c->b[2*(m-k)+1] = -c->w[2*k+1];
+  }
+  dlFftRun(p, c->b, 0);
+  return c;
+}
+
+/*
+ * dlFftGetChirp - chirp for n points; *tofree is set if it could not
+ * be kept
+ */
+
+static DL_FFT_CHIRP *dlFftFindChirp(int n, int *slot)
+{
+  int i;
+  for (i = 0; i < DL_FFT_CHIRPS && FftChirps[i]; i++)
+    if (FftChirps[i]->n == n) return FftChirps[i];
+  *slot = i;
+  return NULL;
+}
+
+static DL_FFT_CHIRP *dlFftGetChirp(int n, int *tofree)
+{
+  DL_FFT_CHIRP *c, *made;
+  int slot;
+
+  *tofree = 0;
+#ifdef DL_FFT_PTHREAD
+  pthread_mutex_lock(&FftPlanMutex);
+#endif
+  c = dlFftFindChirp(n, &slot);
+#ifdef DL_FFT_PTHREAD
+  pthread_mutex_unlock(&FftPlanMutex);
+#endif
+  if (c) return c;
+
+  /* made unlocked, as it needs the plan for its size */
+  if (!(made = dlFftMakeChirp(n))) return NULL;
+
+#ifdef DL_FFT_PTHREAD
+  pthread_mutex_lock(&FftPlanMutex);
+#endif
+  if (!(c = dlFftFindChirp(n, &slot))) {
+    c = made;
+    if (slot < DL_FFT_CHIRPS) FftChirps[slot] = made;
+    else *tofree = 1;
+  }
+#ifdef DL_FFT_PTHREAD
+  pthread_mutex_unlock(&FftPlanMutex);
+#endif
+  if (c != made) dlFftChirpFree(made);
+  return c;
+}
+
+/*
+ * dlFftBluestein - transform of n points (any n) as the convolution of
+ * the points times the chirp with the conjugate chirp
+ */
+
+static int dlFftBluestein(int n, double *z, int inverse)
+{
+  DL_FFT_CHIRP *c;
+  DL_FFT_PLAN *p;
+  double *a, *w, ar, ai, sign = inverse ? -1.0 : 1.0;
+  int k, m, tofree;
+
+  if (!(c = dlFftGetChirp(n, &tofree))) return 0;
+  m = c->m;
+  p = dlFftGetPlan(m);
+  if (!(a = (double *) calloc(2*m, sizeof(double)))) {
+    if (tofree) dlFftChirpFree(c);
+    return 0;
+  }
+  w = c->w;
+
+  /* the inverse is the conjugate of the transform of the conjugate */
+  for (k = 0; k < n; k++) {
+    ar = z[2*k];
+    ai = sign*z[2*k+1];
+    a[2*k] = ar*w[2*k] - ai*w[2*k+1];
+    a[2*k+1] = ar*w[2*k+1] + ai*w[2*k];
+  }
+  dlFftRun(p, a, 0);
+  for (k = 0; k < m; k++) {
+    ar = a[2*k]*c->b[2*k] - a[2*k+1]*c->b[2*k+1];
+    ai = a[2*k]*c->b[2*k+1] + a[2*k+1]*c->b[2*k];
+    a[2*k] = ar;
+    a[2*k+1] = ai;
+  }
+  dlFftRun(p, a, 1);
+  for (k = 0; k < n; k++) {
+    ar = a[2*k]/m;
+    ai = a[2*k+1]/m;
+    z[2*k] = ar*w[2*k] - ai*w[2*k+1];
+    z[2*k+1] = sign*(ar*w[2*k+1] + ai*w[2*k]);
+  }
+
+  free(a);
+  if (tofree) dlFftChirpFree(c);
+  return 1;
+}
+
+/*
+ * dlFftComplex - in place transform of n interleaved complex points,
+ * unscaled in both directions.  Returns 0 if n is too large or out of
+ * memory.
+ */
+
+int dlFftComplex(int n, double *z, int inverse)
+{
+  DL_FFT_PLAN *p;
+
+  if (n < 1) return 0;
+  if (n & (n-1)) return dlFftBluestein(n, z, inverse);
+  if (!(p = dlFftGetPlan(n))) return 0;
+  dlFftRun(p, z, inverse);
+  return 1;
+}
+
+/*
+ * dlFftRealAny - dlFftReal for n that is not a power of two, through a
+ * complex transform of all n points
+ */
+
+static int dlFftRealAny(int n, double *buf, int inverse)
+{
+  double *z;
+  int k, ok;
+
+  if (!(z = (double *) malloc(2*n*sizeof(double)))) return 0;
+  if (!inverse) {
+    for (k = 0; k < n; k++) {
+      z[2*k] = buf[k];
+      z[2*k+1] = 0.0;
+    }
+    if ((ok = dlFftComplex(n, z, 0)))
+      memcpy(buf, z, 2*(n/2+1)*sizeof(double));
+  }
+  else {
+    /* the negative frequencies are the conjugates of the positive */
+    for (k = 0; k <= n/2; k++) {
+      z[2*k] = buf[2*k];
+      z[2*k+1] = buf[2*k+1];
+    }
+    for (; k < n; k++) {
+      z[2*k] = buf[2*(n-k)];
+      z[2*k+1] = -buf[2*(n-k)+1];
+    }
+    if ((ok = dlFftComplex(n, z, 1)))
+      for (k = 0; k < n; k++) buf[k] = z[2*k]/n;
+  }
+  free(z);
+  return ok;
+}
+
+/*
+ * dlFftReal - in place transform of n real points; buf holds n+2
+ * doubles.  Forward, the n reals become the n/2+1 complex values of
+ * the non-negative frequencies.  Inverse turns those back into the n
+ * reals (scaled by 1/n, so a forward and an inverse transform give
+ * back the input).
+ */
+
+int dlFftReal(int n, double *buf, int inverse)
+{
+  DL_FFT_PLAN *p;
+  int m = n/2, k;
+  double ar, ai, br, bi, er, ei, qr, qi, wr, wi, tr, ti;
+
+  if (n < 1) return 0;
+  if (n < 2 || (n & (n-1))) return dlFftRealAny(n, buf, inverse);
+  if (!(p = dlFftGetPlan(m))) return 0;
+
+  if (!inverse) {
+    dlFftRun(p, buf, 0);
+    ar = buf[0];
+    ai = buf[1];
+    buf[0] = ar + ai;
+    buf[1] = 0.0;
+    buf[2*m] = ar - ai;
+    buf[2*m+1] = 0.0;
+  }
+  else {
+    ar = buf[0];
+    br = buf[2*m];
+    buf[0] = 0.5*(ar + br);
+    buf[1] = 0.5*(ar - br);
+  }
+
+  /* points k and m-k are made from each other */
+  for (k = 1; k <= m/2; k++) {
+    ar = buf[2*k];     ai = buf[2*k+1];
+    br = buf[2*(m-k)]; bi = -buf[2*(m-k)+1];
+    wr = p->rtw[2*k];
+    wi = p->rtw[2*k+1];
+    er = 0.5*(ar + br);
+    ei = 0.5*(ai + bi);
+    if (!inverse) {
+      /* odd part is (a-b)/2i, X[k] = e + w*o, X[m-k] = conj(e - w*o) */
+      qr = 0.5*(ai - bi);
+      qi = -0.5*(ar - br);
+      tr = wr*qr - wi*qi;
+      ti = wr*qi + wi*qr;
+      buf[2*k] = er + tr;
+      buf[2*k+1] = ei + ti;
+      buf[2*(m-k)] = er - tr;
+      buf[2*(m-k)+1] = -(ei - ti);
+    }
+    else {
+      /* odd part is (a-b)/2 * conj(w), Z[k] = e + i*o and
+	 Z[m-k] = conj(e) + i*conj(o) */
+      tr = 0.5*(ar - br);
+      ti = 0.5*(ai - bi);
+      qr = tr*wr + ti*wi;
+      qi = ti*wr - tr*wi;
+      buf[2*k] = er - qi;
+      buf[2*k+1] = ei + qr;
+      buf[2*(m-k)] = er + qi;
+      buf[2*(m-k)+1] = -ei + qr;
+    }
+  }
+
+  if (inverse) {
+    dlFftRun(p, buf, 1);
+    for (k = 0; k < n; k++) buf[k] /= m;
+  }
+  return 1;
+}
@@ -0,0 +1,31 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlfft.h
+ *
+ *  DESCRIPTION
+ *    FFTs in double precision, of any size (powers of two are done
+ *  directly, other sizes through power of two transforms about twice
+ *  as long).  Complex data is stored as interleaved (re, im) pairs.
+ *  The tables for each size are built the first time the size is used
+ *  and kept for the rest of the session, so repeated transforms of one
+ *  size (one per trial, say) only pay for the butterflies.
+ *
+ ************************************************************************/
+
+#ifndef DLFFT_H
+#define DLFFT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int dlFftSize(DL_SIZE n);
+int dlFftComplex(int n, double *z, int inverse);
+int dlFftReal(int n, double *buf, int inverse);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLFFT_H */
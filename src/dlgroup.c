@@ -0,0 +1,732 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlgroup.c
+ *
+ *  DESCRIPTION
+ *    Single pass group-by for dynlists (the Tcl commands dl_groupBy
+ *  and dg_aggregate are in tcl_dlgroup.c).
+ *
+ *    Each row's tuple of key values is hashed once and looked up in an
+ *  open addressing table of the groups seen so far; the row indices of
+ *  each group are then collected in one counting pass.  Groups come
+ *  out in the order of dl_uniqueCross (first key varying fastest), but
+ *  only combinations that occur are returned (dl_sortByLists returns
+ *  every crossing of the unique values, including empty ones).
+ *
+ *    Aggregates are count, sum, mean, std, sem, min, max and median.
+ *  The values of a column are gathered into one packed list of lists
+ *  in group order, so sum, mean, std, min and max are exactly what
+ *  dl_sums, dl_means, dl_stds, dl_mins and dl_maxs give for the
+ *  grouped lists (and use the same thread pool).
+ *
+ *    Float keys treat -0 and 0 as equal and put all NaNs in one group.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+
+#include "df.h"
+#include "dfana.h"
+#include "dlgroup.h"
+#include "dlsort.h"
+
+static char *DLAggregateNames[] = { "count", "sum", "mean", "std", "sem",
+				    "min", "max", "median" };
+
+
+/*
+ * Hashing and comparing elements of key lists.  Strings hash by their
+ * contents (once per table string for dictionary lists), so elements
+ * of different lists can be looked up in each other's tables.
+ */
+
+static uint32_t dlGroupMix(uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+static uint32_t dlGroupFloatBits(float f)
+{
+  union { float f; uint32_t u; } v;
+  if (f == 0.0) return 0;	/* -0 and 0 */
+  if (isnan(f)) return 0x7fc00000;
+  v.f = f;
+  return v.u;
+}
+
+static uint32_t dlGroupHashString(char *str)
+{
+  unsigned char *s = (unsigned char *) str;
+  uint32_t h = 2166136261u;	/* FNV-1a */
+  while (*s) {
+    h ^= *s++;
+    h *= 16777619u;
+  }
+  return dlGroupMix(h);
+}
+
+#define DL_GROUP_HASH_LOOP(expr)					\
+  for (i = 0; i < n; i++) {						\
+    uint32_t e = expr;							\
+    h[i] = combine ? h[i] ^ (e + 0x9e3779b9 + (h[i] << 6) + (h[i] >> 2)) : e; \
+  }
+
+/*
+ * dlGroupHashList - hash every element of dl into h, combined with the
+ * hashes already there if combine is set
+ */
+
+static int dlGroupHashList(DYN_LIST *dl, uint32_t *h, int combine)
+{
+  int i, n = DYN_LIST_N(dl);
+
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG:
+    {
+      int *v = (int *) DYN_LIST_VALS(dl);
+      DL_GROUP_HASH_LOOP(dlGroupMix((uint32_t) v[i]));
+    }
+    break;
+  case DF_SHORT:
+    {
+      short *v = (short *) DYN_LIST_VALS(dl);
+      DL_GROUP_HASH_LOOP(dlGroupMix((uint32_t) v[i]));
+    }
+    break;
+  case DF_CHAR:
+    {
+      char *v = (char *) DYN_LIST_VALS(dl);
+      DL_GROUP_HASH_LOOP(dlGroupMix((uint32_t) v[i]));
+    }
+    break;
+  case DF_FLOAT:
+    {
+      float *v = (float *) DYN_LIST_VALS(dl);
+      DL_GROUP_HASH_LOOP(dlGroupMix(dlGroupFloatBits(v[i])));
+    }
+    break;
+  case DF_STRING:
+    if (DYN_LIST_FLAGS(dl) & DL_DICT) {
+      DYN_DICT *dict = DYN_LIST_DICT(dl);
+      int *codes = DYN_LIST_CODES(dl);
+      uint32_t *sh = (uint32_t *) malloc((dict->nstrings+1)*sizeof(uint32_t));
+      if (!sh) return 0;
+      for (i = 0; i < dict->nstrings; i++)
+	sh[i] = dlGroupHashString(dict->strings[i]);
+      DL_GROUP_HASH_LOOP(sh[codes[i]]);
+      free(sh);
+    }
+    else {
+      char **v = (char **) DYN_LIST_VALS(dl);
+      DL_GROUP_HASH_LOOP(dlGroupHashString(v[i]));
+    }
+    break;
+  default:
+    return 0;
+  }
+  return 1;
+}
+
+static int dlGroupSameElement(DYN_LIST *a, int i, DYN_LIST *b, int j)
+{
+  switch (DYN_LIST_DATATYPE(a)) {
+  case DF_LONG:
+    return ((int *) DYN_LIST_VALS(a))[i] == ((int *) DYN_LIST_VALS(b))[j];
+  case DF_SHORT:
+    return ((short *) DYN_LIST_VALS(a))[i] ==
+      ((short *) DYN_LIST_VALS(b))[j];
+  case DF_CHAR:
+    return ((char *) DYN_LIST_VALS(a))[i] == ((char *) DYN_LIST_VALS(b))[j];
+  case DF_FLOAT:
+    return dlGroupFloatBits(((float *) DYN_LIST_VALS(a))[i]) ==
+      dlGroupFloatBits(((float *) DYN_LIST_VALS(b))[j]);
+  case DF_STRING:
+    if ((DYN_LIST_FLAGS(a) & DL_DICT) && (DYN_LIST_FLAGS(b) & DL_DICT) &&
+	DYN_LIST_DICT(a) == DYN_LIST_DICT(b))
+      return DYN_LIST_CODES(a)[i] == DYN_LIST_CODES(b)[j];
+    return !strcmp(((char **) DYN_LIST_VALS(a))[i],
+		   ((char **) DYN_LIST_VALS(b))[j]);
+  }
+  return 0;
+}
+
+static int dlGroupSameRow(DL_GROUPING *g, int r1, int r2)
+{
+  int k;
+  for (k = 0; k < g->nkeys; k++)
+    if (!dlGroupSameElement(g->keys[k], r1, g->keys[k], r2)) return 0;
+  return 1;
+}
+
+
+/*
+ * Count the rows of each group into g->offsets, dropping any row index
+ * built for an earlier numbering of the groups
+ */
+
+static int dlGroupCountRows(DL_GROUPING *g)
+{
+  int i;
+
+  if (g->offsets) free(g->offsets);
+  if (g->rows) free(g->rows);
+  g->rows = NULL;
+  g->offsets = (int *) calloc(g->ngroups+1, sizeof(int));
+  if (!g->offsets) return 0;
+  for (i = 0; i < g->nrows; i++) g->offsets[g->group[i]+1]++;
+  for (i = 0; i < g->ngroups; i++) g->offsets[i+1] += g->offsets[i];
+  return 1;
+}
+
+/*
+ * dlGroupIndexRows - fill g->rows with the rows of each group (in row
+ * order) if that has not been done yet
+ */
+
+int dlGroupIndexRows(DL_GROUPING *g)
+{
+  int i, *pos;
+
+  if (g->rows) return 1;
+  g->rows = (int *) malloc((g->nrows+1)*sizeof(int));
+  pos = (int *) malloc((g->ngroups+1)*sizeof(int));
+  if (!g->rows || !pos) {
+    if (pos) free(pos);
+    if (g->rows) free(g->rows);
+    g->rows = NULL;
+    return 0;
+  }
+  memcpy(pos, g->offsets, g->ngroups*sizeof(int));
+  for (i = 0; i < g->nrows; i++) g->rows[pos[g->group[i]]++] = i;
+  free(pos);
+  return 1;
+}
+
+void dlGroupFree(DL_GROUPING *g)
+{
+  if (!g) return;
+  if (g->keys) free(g->keys);
+  if (g->group) free(g->group);
+  if (g->first) free(g->first);
+  if (g->offsets) free(g->offsets);
+  if (g->rows) free(g->rows);
+  if (g->table) free(g->table);
+  if (g->hashes) free(g->hashes);
+  free(g);
+}
+
+/* rebuild the table at tsize slots from the group hashes */
+
+static int dlGroupRehash(DL_GROUPING *g, int tsize)
+{
+  int i, slot, *table;
+  uint32_t mask = tsize-1;
+
+  table = (int *) malloc(tsize*sizeof(int));
+  if (!table) return 0;
+  for (i = 0; i < tsize; i++) table[i] = -1;
+  for (i = 0; i < g->ngroups; i++) {
+    for (slot = g->hashes[i] & mask; table[slot] >= 0; slot = (slot+1) & mask);
+    table[slot] = i;
+  }
+  if (g->table) free(g->table);
+  g->table = table;
+  g->tsize = tsize;
+  return 1;
+}
+
+/*
+ * dlGroupAdd - start a new group with row as its first row, in the
+ * empty table slot found for it.  Returns the group, or -1 if there
+ * would be more than limit groups or memory ran out.
+ */
+
+static int dlGroupAdd(DL_GROUPING *g, int row, uint32_t h, int slot,
+		      int *maxgroups, int limit)
+{
+  int gid = g->ngroups;
+
+  if (gid >= limit) return -1;
+  if (gid == *maxgroups) {
+    int *f;
+    uint32_t *hs;
+    f = (int *) realloc(g->first, 2*(*maxgroups)*sizeof(int));
+    if (f) g->first = f;
+    hs = (uint32_t *) realloc(g->hashes, 2*(*maxgroups)*sizeof(uint32_t));
+    if (hs) g->hashes = hs;
+    if (!f || !hs) return -1;
+    *maxgroups *= 2;
+  }
+  g->first[gid] = row;
+  g->hashes[gid] = h;
+  g->table[slot] = gid;
+  g->ngroups++;
+
+  /* keep the table at most half full */
+  if (2*g->ngroups > g->tsize && !dlGroupRehash(g, 2*g->tsize)) return -1;
+  return gid;
+}
+
+/*
+ * Put each row in the group of the first earlier row with the same
+ * keys (HASH is the hash of row i, SAME(a, b) compares rows a and b),
+ * or in a new group
+ */
+
+#define DL_GROUP_INSERT(HASH, SAME)					\
+  {									\
+    int *table = g->table, *first = g->first, *group = g->group;	\
+    uint32_t *hashes = g->hashes, mask = g->tsize-1;			\
+    for (i = 0; i < g->nrows; i++) {					\
+      h = HASH;								\
+      for (slot = h & mask; (gid = table[slot]) >= 0;		\
+	   slot = (slot+1) & mask) {					\
+	if (hashes[gid] == h && SAME(first[gid], i)) break;		\
+      }									\
+      if (gid < 0) {							\
+	if ((gid = dlGroupAdd(g, i, h, slot, &maxgroups, limit)) < 0)	\
+	  goto failed;							\
+	table = g->table;						\
+	first = g->first;						\
+	hashes = g->hashes;						\
+	mask = g->tsize-1;						\
+      }									\
+      group[i] = gid;							\
+    }									\
+  }
+
+#define DL_GROUP_SAME_VALUE(a, b) (v[a] == v[b])
+#define DL_GROUP_SAME_FLOAT(a, b) \
+  (dlGroupFloatBits(v[a]) == dlGroupFloatBits(v[b]))
+#define DL_GROUP_SAME_STRING(a, b) (!strcmp(v[a], v[b]))
+#define DL_GROUP_SAME_ROW(a, b) dlGroupSameRow(g, a, b)
+
+/*
+ * dlGroupRows - group the rows of nkeys equal length key lists.
+ * Returns NULL if the keys are not flat lists of the same length.
+ */
+
+DL_GROUPING *dlGroupRows(int nkeys, DYN_LIST **keys)
+{
+  return dlGroupRowsMax(nkeys, keys, INT_MAX);
+}
+
+/*
+ * dlGroupRowsMax - dlGroupRows, giving up (and returning NULL) as soon
+ * as there are more than limit groups, for callers with a cheaper way
+ * to handle many distinct keys
+ */
+
+DL_GROUPING *dlGroupRowsMax(int nkeys, DYN_LIST **keys, int limit)
+{
+  DL_GROUPING *g;
+  int i, k, slot, gid, maxgroups;
+  uint32_t h, *rowhash = NULL;
+
+  if (nkeys < 1) return NULL;
+  for (k = 0; k < nkeys; k++) {
+    if (!keys[k] || DYN_LIST_DATATYPE(keys[k]) == DF_LIST) return NULL;
+    if (DYN_LIST_N(keys[k]) != DYN_LIST_N(keys[0])) return NULL;
+  }
+
+  g = (DL_GROUPING *) calloc(1, sizeof(DL_GROUPING));
+  if (!g) return NULL;
+  g->nkeys = nkeys;
+  g->nrows = DYN_LIST_N(keys[0]);
+  g->keys = (DYN_LIST **) malloc(nkeys*sizeof(DYN_LIST *));
+  g->group = (int *) malloc((g->nrows+1)*sizeof(int));
+  maxgroups = 64;
+  g->first = (int *) malloc(maxgroups*sizeof(int));
+  g->hashes = (uint32_t *) malloc(maxgroups*sizeof(uint32_t));
+  if (!g->keys || !g->group || !g->first || !g->hashes ||
+      !dlGroupRehash(g, 2*maxgroups))
+    goto failed;
+  memcpy(g->keys, keys, nkeys*sizeof(DYN_LIST *));
+
+  /* a single numeric key is hashed and compared in place */
+  if (nkeys == 1) switch (DYN_LIST_DATATYPE(keys[0])) {
+  case DF_LONG:
+    {
+      int *v = (int *) DYN_LIST_VALS(keys[0]);
+      DL_GROUP_INSERT(dlGroupMix((uint32_t) v[i]), DL_GROUP_SAME_VALUE);
+    }
+    goto grouped;
+  case DF_SHORT:
+    {
+      short *v = (short *) DYN_LIST_VALS(keys[0]);
+      DL_GROUP_INSERT(dlGroupMix((uint32_t) v[i]), DL_GROUP_SAME_VALUE);
+    }
+    goto grouped;
+  case DF_CHAR:
+    {
+      char *v = (char *) DYN_LIST_VALS(keys[0]);
+      DL_GROUP_INSERT(dlGroupMix((uint32_t) v[i]), DL_GROUP_SAME_VALUE);
+    }
+    goto grouped;
+  case DF_FLOAT:
+    {
+      float *v = (float *) DYN_LIST_VALS(keys[0]);
+      DL_GROUP_INSERT(dlGroupMix(dlGroupFloatBits(v[i])),
+		      DL_GROUP_SAME_FLOAT);
+    }
+    goto grouped;
+  }
+
+  rowhash = (uint32_t *) malloc((g->nrows+1)*sizeof(uint32_t));
+  if (!rowhash) goto failed;
+  for (k = 0; k < nkeys; k++)
+    if (!dlGroupHashList(keys[k], rowhash, k)) goto failed;
+
+  if (nkeys > 1) {
+    DL_GROUP_INSERT(rowhash[i], DL_GROUP_SAME_ROW);
+  }
+  else if (DYN_LIST_FLAGS(keys[0]) & DL_DICT) {
+    int *v = DYN_LIST_CODES(keys[0]);
+    DL_GROUP_INSERT(rowhash[i], DL_GROUP_SAME_VALUE);
+  }
+  else {
+    char **v = (char **) DYN_LIST_VALS(keys[0]);
+    DL_GROUP_INSERT(rowhash[i], DL_GROUP_SAME_STRING);
+  }
+  free(rowhash);
+
+ grouped:
+  if (!dlGroupCountRows(g)) {
+    dlGroupFree(g);
+    return NULL;
+  }
+  return g;
+
+ failed:
+  if (rowhash) free(rowhash);
+  dlGroupFree(g);
+  return NULL;
+}
+
+/*
+ * dlGroupFind - the group of each element of probe (a flat list of the
+ * same datatype as the single key of g), or -1 where there is none.
+ * This is an equality test, so NaNs are never found.  Returns a
+ * malloc'd array of DYN_LIST_N(probe) ids.
+ */
+
+int *dlGroupFind(DL_GROUPING *g, DYN_LIST *probe)
+{
+  int i, slot, gid, n, *ids;
+  uint32_t *h, mask;
+  DYN_LIST *keys;
+
+  if (!g || g->nkeys != 1 || !probe) return NULL;
+  keys = g->keys[0];
+  if (DYN_LIST_DATATYPE(probe) != DYN_LIST_DATATYPE(keys)) return NULL;
+
+  n = DYN_LIST_N(probe);
+  ids = (int *) malloc((n+1)*sizeof(int));
+  h = (uint32_t *) malloc((n+1)*sizeof(uint32_t));
+  if (!ids || !h || !dlGroupHashList(probe, h, 0)) {
+    if (ids) free(ids);
+    if (h) free(h);
+    return NULL;
+  }
+
+  mask = g->tsize-1;
+  for (i = 0; i < n; i++) {
+    for (slot = h[i] & mask; (gid = g->table[slot]) >= 0;
+	 slot = (slot+1) & mask) {
+      if (g->hashes[gid] == h[i] &&
+	  dlGroupSameElement(keys, g->first[gid], probe, i)) break;
+    }
+    ids[i] = gid;
+  }
+  if (DYN_LIST_DATATYPE(probe) == DF_FLOAT) {
+    float *v = (float *) DYN_LIST_VALS(probe);
+    for (i = 0; i < n; i++) if (isnan(v[i])) ids[i] = -1;
+  }
+  free(h);
+  return ids;
+}
+
+/*
+ * dlGroupKeyList - the value of key list "key" for each group
+ */
+
+DYN_LIST *dlGroupKeyList(DL_GROUPING *g, int key)
+{
+  int i;
+  DYN_LIST *dl, *keys;
+
+  if (!g || key < 0 || key >= g->nkeys) return NULL;
+  keys = g->keys[key];
+  dl = dfuCreateDynList(DYN_LIST_DATATYPE(keys), g->ngroups ? g->ngroups : 1);
+  if (!dl) return NULL;
+  for (i = 0; i < g->ngroups; i++)
+    dynListCopyElement(keys, g->first[i], dl);
+  return dl;
+}
+
+/*
+ * dlGroupSortGroups - renumber groups in order of their key values,
+ * last key most significant (the dl_uniqueCross order), by stable
+ * index sorts of each key from the first to the last
+ */
+
+int dlGroupSortGroups(DL_GROUPING *g)
+{
+  int i, j, k, *perm, *newperm, *newid, *first, *sorted;
+  uint32_t *hashes;
+  DYN_LIST *vals, *order;
+
+  if (!g) return 0;
+  if (g->ngroups < 2) return 1;
+
+  perm = (int *) malloc(g->ngroups*sizeof(int));
+  newperm = (int *) malloc(g->ngroups*sizeof(int));
+  if (!perm || !newperm) {
+    if (perm) free(perm);
+    if (newperm) free(newperm);
+    return 0;
+  }
+  for (i = 0; i < g->ngroups; i++) perm[i] = i;
+
+  for (k = 0; k < g->nkeys; k++) {
+    vals = dfuCreateDynList(DYN_LIST_DATATYPE(g->keys[k]), g->ngroups);
+    for (i = 0; i < g->ngroups; i++)
+      dynListCopyElement(g->keys[k], g->first[perm[i]], vals);
+    order = dynListSortListIndices(vals);
+    dfuFreeDynList(vals);
+    if (!order) {
+      free(perm);
+      free(newperm);
+      return 0;
+    }
+    sorted = (int *) DYN_LIST_VALS(order);
+    for (i = 0; i < g->ngroups; i++) newperm[i] = perm[sorted[i]];
+    memcpy(perm, newperm, g->ngroups*sizeof(int));
+    dfuFreeDynList(order);
+  }
+
+  /* perm[j] is the old number of the group that becomes group j */
+  newid = newperm;
+  first = (int *) malloc(g->ngroups*sizeof(int));
+  if (!first) {
+    free(perm);
+    free(newperm);
+    return 0;
+  }
+  hashes = (uint32_t *) malloc(g->ngroups*sizeof(uint32_t));
+  if (!hashes) {
+    free(first);
+    free(perm);
+    free(newperm);
+    return 0;
+  }
+  for (j = 0; j < g->ngroups; j++) {
+    newid[perm[j]] = j;
+    first[j] = g->first[perm[j]];
+    hashes[j] = g->hashes[perm[j]];
+  }
+  for (i = 0; i < g->nrows; i++) g->group[i] = newid[g->group[i]];
+  for (i = 0; i < g->tsize; i++)
+    if (g->table[i] >= 0) g->table[i] = newid[g->table[i]];
+  free(g->first);
+  g->first = first;
+  free(g->hashes);
+  g->hashes = hashes;
+  free(perm);
+  free(newperm);
+  return dlGroupCountRows(g);
+}
+
+/*
+ * Gather a numeric list's values in group order as a packed list of
+ * lists (one sublist per group)
+ */
+
+static DYN_LIST *dlGroupPacked(DL_GROUPING *g, DYN_LIST *data)
+{
+  int i, size = dfuDynListElementSize(DYN_LIST_DATATYPE(data));
+  char *vals, *src = (char *) DYN_LIST_VALS(data);
+  DYN_LIST *packed;
+
+  if (!dlGroupIndexRows(g)) return NULL;
+  vals = (char *) malloc((size_t) size*(g->nrows+1));
+  if (!vals) return NULL;
+  switch (size) {
+  case 4:
+    for (i = 0; i < g->nrows; i++)
+      ((uint32_t *) vals)[i] = ((uint32_t *) src)[g->rows[i]];
+    break;
+  case 2:
+    for (i = 0; i < g->nrows; i++)
+      ((uint16_t *) vals)[i] = ((uint16_t *) src)[g->rows[i]];
+    break;
+  default:
+    for (i = 0; i < g->nrows; i++)
+      memcpy(vals + (size_t) size*i, src + (size_t) size*g->rows[i], size);
+    break;
+  }
+  packed = dfuCreatePackedDynList("", DYN_LIST_DATATYPE(data), g->ngroups,
+				  g->offsets, vals);
+  free(vals);
+  return packed;
+}
+
+static int dlGroupNumeric(DYN_LIST *dl)
+{
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG: case DF_SHORT: case DF_CHAR: case DF_FLOAT:
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * dlGroupDataLists - data split into one list per group
+ */
+
+DYN_LIST *dlGroupDataLists(DL_GROUPING *g, DYN_LIST *data)
+{
+  int i, j;
+  DYN_LIST *lists, *l;
+
+  if (!g || !data || DYN_LIST_N(data) != g->nrows) return NULL;
+  if (!g->ngroups) return dfuCreateDynList(DF_LIST, 1);
+  if (dlGroupNumeric(data)) return dlGroupPacked(g, data);
+  if (!dlGroupIndexRows(g)) return NULL;
+
+  lists = dfuCreateDynList(DF_LIST, g->ngroups);
+  for (i = 0; i < g->ngroups; i++) {
+    l = dfuCreateDynList(DYN_LIST_DATATYPE(data),
+			 g->offsets[i+1] - g->offsets[i]);
+    for (j = g->offsets[i]; j < g->offsets[i+1]; j++)
+      dynListCopyElement(data, g->rows[j], l);
+    dfuMoveDynListList(lists, l);
+  }
+  return lists;
+}
+
+static float dlGroupMedian(int datatype, void *vals, int n)
+{
+  int m = n/2;
+  if (!n) return 0.0;
+  dlSortValues(datatype, n, vals);
+  switch (datatype) {
+  case DF_LONG:
+    {
+      int *v = (int *) vals;
+      return (n % 2) ? v[m] : (v[m] + (double) v[m-1])/2.0;
+    }
+  case DF_SHORT:
+    {
+      short *v = (short *) vals;
+      return (n % 2) ? v[m] : (v[m] + (double) v[m-1])/2.0;
+    }
+  case DF_CHAR:
+    {
+      char *v = (char *) vals;
+      return (n % 2) ? v[m] : (v[m] + (double) v[m-1])/2.0;
+    }
+  case DF_FLOAT:
+    {
+      float *v = (float *) vals;
+      return (n % 2) ? v[m] : (v[m] + (double) v[m-1])/2.0;
+    }
+  }
+  return 0.0;
+}
+
+/*
+ * dlGroupAggregate - one value per group of an aggregate of data
+ */
+
+DYN_LIST *dlGroupAggregate(DL_GROUPING *g, DYN_LIST *data, int agg)
+{
+  int i, n, size;
+  DYN_LIST *packed, *result = NULL, **sublists;
+  float *fvals;
+  char *buf;
+
+  if (!g || !data || DYN_LIST_N(data) != g->nrows) return NULL;
+
+  if (agg == DL_AGG_COUNT) {
+    int *counts = (int *) malloc((g->ngroups+1)*sizeof(int));
+    if (!counts) return NULL;
+    for (i = 0; i < g->ngroups; i++)
+      counts[i] = g->offsets[i+1] - g->offsets[i];
+    if (!g->ngroups) {
+      free(counts);
+      return dfuCreateDynList(DF_LONG, 1);
+    }
+    return dfuCreateDynListWithVals(DF_LONG, g->ngroups, counts);
+  }
+
+  if (!dlGroupNumeric(data) || agg < 0 || agg >= DL_N_AGGREGATES)
+    return NULL;
+  if (!g->ngroups) return dfuCreateDynList(DF_FLOAT, 1);
+  if (!(packed = dlGroupPacked(g, data))) return NULL;
+
+  switch (agg) {
+  case DL_AGG_SUM:  result = dynListSumLists(packed);  break;
+  case DL_AGG_MEAN: result = dynListMeanLists(packed); break;
+  case DL_AGG_STD:  result = dynListStdLists(packed);  break;
+  case DL_AGG_MIN:  result = dynListMinLists(packed);  break;
+  case DL_AGG_MAX:  result = dynListMaxLists(packed);  break;
+  case DL_AGG_SEM:
+    /* as dl_sems: dl_div [dl_stds l] [dl_sqrt [dl_lengths l]] */
+    if ((result = dynListStdLists(packed))) {
+      fvals = (float *) DYN_LIST_VALS(result);
+      for (i = 0; i < g->ngroups; i++) {
+	n = g->offsets[i+1] - g->offsets[i];
+	fvals[i] = fvals[i] / (float) sqrt((double) n);
+      }
+    }
+    break;
+  case DL_AGG_MEDIAN:
+    size = dfuDynListElementSize(DYN_LIST_DATATYPE(data));
+    sublists = (DYN_LIST **) DYN_LIST_VALS(packed);
+    fvals = (float *) malloc(g->ngroups*sizeof(float));
+    buf = (char *) malloc((size_t) size*(g->nrows+1));
+    if (fvals && buf) {
+      for (i = 0; i < g->ngroups; i++) {
+	n = DYN_LIST_N(sublists[i]);
+	memcpy(buf, DYN_LIST_VALS(sublists[i]), (size_t) size*n);
+	fvals[i] = dlGroupMedian(DYN_LIST_DATATYPE(data), buf, n);
+      }
+      result = dfuCreateDynListWithVals(DF_FLOAT, g->ngroups, fvals);
+    }
+    else if (fvals) free(fvals);
+    if (buf) free(buf);
+    break;
+  }
+  dfuFreeDynList(packed);
+  return result;
+}
+
+int dlGroupAggregateID(char *name, int *agg)
+{
+  int i;
+  for (i = 0; i < DL_N_AGGREGATES; i++) {
+    if (!strcmp(name, DLAggregateNames[i])) {
+      *agg = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+char *dlGroupAggregateName(int agg)
+{
+  if (agg < 0 || agg >= DL_N_AGGREGATES) return NULL;
+  return DLAggregateNames[agg];
+}
@@ -0,0 +1,60 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlgroup.h
+ *
+ *  DESCRIPTION
+ *    Hash based grouping of rows by the values of one or more key
+ *  lists, and aggregates over the groups.  dlGroupRows hashes each
+ *  row's key tuple once; groups are numbered in order of first
+ *  appearance until dlGroupSortGroups puts them in key order (last
+ *  key most significant, as dl_uniqueCross).  Rows keep their order
+ *  within a group.  dlGroupFind looks up the elements of another list
+ *  in a single key grouping.
+ *
+ ************************************************************************/
+
+#ifndef DLGROUP_H
+#define DLGROUP_H
+
+#include <stdint.h>
+
+enum DL_AGGREGATES { DL_AGG_COUNT, DL_AGG_SUM, DL_AGG_MEAN, DL_AGG_STD,
+		     DL_AGG_SEM, DL_AGG_MIN, DL_AGG_MAX, DL_AGG_MEDIAN,
+		     DL_N_AGGREGATES };
+
+typedef struct {
+  int nkeys;
+  DYN_LIST **keys;		/* key lists (not owned)                */
+  int nrows;
+  int ngroups;
+  int *group;			/* group of each row                    */
+  int *first;			/* first row of each group              */
+  int *offsets;			/* ngroups+1 offsets into rows          */
+  int *rows;			/* rows by group, see dlGroupIndexRows  */
+  int tsize;			/* hash table slots (a power of 2)      */
+  int *table;			/* group in each slot, -1 if empty      */
+  uint32_t *hashes;		/* hash of each group's key values      */
+} DL_GROUPING;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+DL_GROUPING *dlGroupRows(int nkeys, DYN_LIST **keys);
+DL_GROUPING *dlGroupRowsMax(int nkeys, DYN_LIST **keys, int limit);
+int *dlGroupFind(DL_GROUPING *g, DYN_LIST *probe);
+int dlGroupSortGroups(DL_GROUPING *g);
+int dlGroupIndexRows(DL_GROUPING *g);
+void dlGroupFree(DL_GROUPING *g);
+DYN_LIST *dlGroupKeyList(DL_GROUPING *g, int key);
+DYN_LIST *dlGroupDataLists(DL_GROUPING *g, DYN_LIST *data);
+DYN_LIST *dlGroupAggregate(DL_GROUPING *g, DYN_LIST *data, int agg);
+int dlGroupAggregateID(char *name, int *agg);
+char *dlGroupAggregateName(int agg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLGROUP_H */
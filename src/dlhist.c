@@ -0,0 +1,293 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlhist.c
+ *
+ *  DESCRIPTION
+ *    Histogram counting for dynListHistList, dynListHistLists and
+ *  dynListHist2D.  Values are binned a block at a time: the bins of
+ *  the block are computed first (with the dlsimd kernel when there is
+ *  one for the datatype) and then counted, so the loop that does the
+ *  counting has no arithmetic or range tests left in it.
+ *
+ *  Lists of at least dlThreadsThreshold() elements are split into one
+ *  piece per thread (see dlthread.c), each counted into its own
+ *  partial histogram; the partial counts are added at the end, so the
+ *  result does not depend on the number of threads.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "df.h"
+#include "dlhist.h"
+#include "dlsimd.h"
+#include "dlthread.h"
+
+#define DL_HIST_BLOCK 1024	/* values binned per pass               */
+#define DL_HIST_TOL   1e-12	/* recheck distance from edges / nbins  */
+#define DL_HIST_SPLIT 4		/* histograms counted into in turn      */
+#define DL_HIST_SPLIT_MAX 16384	/* largest histogram to split           */
+#define DL_HIST_SPLIT_MIN 64	/* values per bin worth splitting for   */
+
+typedef struct {
+  DL_HIST_AXIS *x, *y;		/* y is NULL for one axis               */
+  int xtype, ytype;
+  void *xvals, *yvals;
+  DL_SIZE n;
+  int ncounts;			/* bins in a histogram, plus one        */
+  int nparts;
+  int *partials;		/* nparts histograms                    */
+} DL_HIST_JOB;
+
+
+/*
+ * dlHistAxis - set up nbins bins over the (int or float) range list.
+ * Returns 0 for a bad range or number of bins.
+ */
+
+int dlHistAxis(DL_HIST_AXIS *axis, DYN_LIST *range, int nbins)
+{
+  if (!range || DYN_LIST_N(range) < 2) return 0;
+  if (nbins <= 0 || nbins == INT_MAX) return 0;
+
+  switch (DYN_LIST_DATATYPE(range)) {
+  case DF_LONG:
+    axis->start = ((int *) DYN_LIST_VALS(range))[0];
+    axis->stop = ((int *) DYN_LIST_VALS(range))[1];
+    break;
+  case DF_FLOAT:
+    axis->start = ((float *) DYN_LIST_VALS(range))[0];
+    axis->stop = ((float *) DYN_LIST_VALS(range))[1];
+    break;
+  default:
+    return 0;
+  }
+  axis->nbins = nbins;
+  axis->width = (axis->stop-axis->start)/nbins;
+  axis->tol = DL_HIST_TOL*nbins;
+  axis->integral = (axis->start == floor(axis->start) &&
+		    axis->width == floor(axis->width) &&
+		    fabs(axis->start) < INT_MAX && axis->width < INT_MAX);
+  return 1;
+}
+
+/*
+ * DL_HIST_BIN_LOOP - bin of each value, by division.  Without vectors
+ * a division costs no more than the multiply and edge test
+ */
+
+#define DL_HIST_BIN_LOOP(TYPE)						\
+  {									\
+    TYPE *v = (TYPE *) vals;						\
+    for (i = 0; i < n; i++) {						\
+      x = v[i];								\
+      if (!(x >= start && x < stop)) {					\
+	bins[i] = nbins;						\
+	continue;							\
+      }									\
+      b = (int) ((x - start) / width);					\
+      bins[i] = (b < nbins) ? b : nbins-1;				\
+    }									\
+  }
+
+/*
+ * dlHistBins - bin of each of n values (nbins if out of range).  The
+ * vector kernels multiply by 1/width, which can only differ from the
+ * division by a few ulps; values within tol of an edge are divided.
+ */
+
+void dlHistBins(DL_HIST_AXIS *a, int type, void *vals, DL_SIZE n,
+		int *bins)
+{
+  DL_SIZE i;
+  double start = a->start, stop = a->stop, width = a->width, tol = a->tol;
+  double inv = 1.0/width, x;
+  int nbins = a->nbins, b;
+
+  if (a->integral && type != DF_FLOAT) {
+    /*
+     * Integers on a grid of whole numbers: rounding 1/width up makes
+     * every product land in the same bin as the division (the error
+     * stays far below 1/width for ints), so nothing needs a recheck
+     */
+    inv = nextafter(inv, HUGE_VAL);
+    tol = -1.0;
+  }
+  if (isfinite(inv) && dlSimdHistBins(type, n, vals, start, stop, width,
+				      inv, tol, nbins, bins)) return;
+
+  switch (type) {
+  case DF_FLOAT: DL_HIST_BIN_LOOP(float); break;
+  case DF_LONG:  DL_HIST_BIN_LOOP(int);   break;
+  case DF_SHORT: DL_HIST_BIN_LOOP(short); break;
+  case DF_CHAR:  DL_HIST_BIN_LOOP(char);  break;
+  }
+}
+
+/*
+ * dlHistCountRange - add values start..stop-1 of the job to counts.
+ * Long runs of one bin (sorted data) would wait on each increment in
+ * turn, so small histograms are counted into DL_HIST_SPLIT copies in
+ * rotation and added up at the end.
+ */
+
+static void dlHistCountRange(DL_HIST_JOB *job, DL_SIZE start, DL_SIZE stop,
+			     int *counts)
+{
+  int xbins[DL_HIST_BLOCK], ybins[DL_HIST_BLOCK];
+  int xsize = dfuDynListElementSize(job->xtype);
+  int ysize = job->y ? dfuDynListElementSize(job->ytype) : 0;
+  int nx = job->x->nbins, ny, out, j, k, m, b;
+  int *c[DL_HIST_SPLIT], *extra = NULL;
+  DL_SIZE i;
+
+  c[0] = counts;
+  for (k = 1; k < DL_HIST_SPLIT; k++) c[k] = counts;
+  if (job->ncounts <= DL_HIST_SPLIT_MAX &&
+      stop - start >= (DL_SIZE) DL_HIST_SPLIT_MIN*job->ncounts &&
+      (extra = (int *) calloc((size_t) (DL_HIST_SPLIT-1)*job->ncounts,
+			      sizeof(int)))) {
+    for (k = 1; k < DL_HIST_SPLIT; k++)
+      c[k] = extra + (size_t) (k-1)*job->ncounts;
+  }
+
+  for (i = start; i < stop; i += m) {
+    m = (stop - i < DL_HIST_BLOCK) ? (int) (stop - i) : DL_HIST_BLOCK;
+    dlHistBins(job->x, job->xtype, (char *) job->xvals + i*xsize, m, xbins);
+    if (job->y) {
+      dlHistBins(job->y, job->ytype, (char *) job->yvals + i*ysize, m,
+		 ybins);
+      ny = job->y->nbins;
+      out = nx*ny;
+      for (j = 0; j < m; j++) {
+	if (xbins[j] == nx || ybins[j] == ny) xbins[j] = out;
+	else xbins[j] += ybins[j]*nx;
+      }
+    }
+    for (j = 0; j + DL_HIST_SPLIT <= m; j += DL_HIST_SPLIT)
+      for (k = 0; k < DL_HIST_SPLIT; k++) c[k][xbins[j+k]]++;
+    for (; j < m; j++) counts[xbins[j]]++;
+  }
+
+  if (extra) {
+    for (k = 1; k < DL_HIST_SPLIT; k++)
+      for (b = 0; b < job->ncounts; b++) counts[b] += c[k][b];
+    free(extra);
+  }
+}
+
+static void dlHistParts(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_HIST_JOB *job = (DL_HIST_JOB *) cd;
+  DL_SIZE p;
+
+  for (p = start; p < stop; p++)
+    dlHistCountRange(job, p*job->n/job->nparts, (p+1)*job->n/job->nparts,
+		     job->partials + p*job->ncounts);
+}
+
+/*
+ * dlHistRun - count the job into counts, in parallel for long lists
+ * when the partial histograms are small next to the data
+ */
+
+static void dlHistRun(DL_HIST_JOB *job, int *counts)
+{
+  int p, b, nthreads = dlThreadsGet();
+  int *partial;
+
+  if (nthreads > 1 && job->n >= dlThreadsThreshold() &&
+      (DL_SIZE) job->ncounts * nthreads <= job->n &&
+      (job->partials = (int *) calloc((size_t) job->ncounts * nthreads,
+				      sizeof(int)))) {
+    job->nparts = nthreads;
+    dlParallelFor(job->nparts, job->n, dlHistParts, job);
+    for (p = 0; p < job->nparts; p++) {
+      partial = job->partials + (size_t) p*job->ncounts;
+      for (b = 0; b < job->ncounts; b++) counts[b] += partial[b];
+    }
+    free(job->partials);
+    return;
+  }
+  dlHistCountRange(job, 0, job->n, counts);
+}
+
+static int dlHistNumeric(int type)
+{
+  return (type == DF_LONG || type == DF_SHORT ||
+	  type == DF_FLOAT || type == DF_CHAR);
+}
+
+/*
+ * dlHistAdd - add the values of dl (all the values, for a list of
+ * lists) to counts.  Returns 0 if dl holds something other than
+ * numbers.
+ */
+
+int dlHistAdd(DL_HIST_AXIS *axis, DYN_LIST *dl, int *counts)
+{
+  DL_HIST_JOB job;
+  DYN_LIST **sublists;
+  DL_SIZE i;
+
+  if (!dl) return 0;
+  if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
+    sublists = (DYN_LIST **) DYN_LIST_VALS(dl);
+    for (i = 0; i < DYN_LIST_N(dl); i++)
+      if (!dlHistAdd(axis, sublists[i], counts)) return 0;
+    return 1;
+  }
+  if (!dlHistNumeric(DYN_LIST_DATATYPE(dl))) return 0;
+
+  memset(&job, 0, sizeof(job));
+  job.x = axis;
+  job.xtype = DYN_LIST_DATATYPE(dl);
+  job.xvals = DYN_LIST_VALS(dl);
+  job.n = DYN_LIST_N(dl);
+  job.ncounts = axis->nbins+1;
+  dlHistRun(&job, counts);
+  return 1;
+}
+
+/*
+ * dlHistAdd2D - add the (x, y) pairs of two lists of the same length
+ * (or lists of lists of the same shape) to counts, which is
+ * yaxis->nbins rows of xaxis->nbins counts.  Returns 0 if the lists
+ * do not match or are not numeric.
+ */
+
+int dlHistAdd2D(DL_HIST_AXIS *xaxis, DL_HIST_AXIS *yaxis,
+		DYN_LIST *x, DYN_LIST *y, int *counts)
+{
+  DL_HIST_JOB job;
+  DYN_LIST **xs, **ys;
+  DL_SIZE i;
+
+  if (!x || !y || DYN_LIST_N(x) != DYN_LIST_N(y)) return 0;
+  if (DYN_LIST_DATATYPE(x) == DF_LIST && DYN_LIST_DATATYPE(y) == DF_LIST) {
+    xs = (DYN_LIST **) DYN_LIST_VALS(x);
+    ys = (DYN_LIST **) DYN_LIST_VALS(y);
+    for (i = 0; i < DYN_LIST_N(x); i++)
+      if (!dlHistAdd2D(xaxis, yaxis, xs[i], ys[i], counts)) return 0;
+    return 1;
+  }
+  if (!dlHistNumeric(DYN_LIST_DATATYPE(x)) ||
+      !dlHistNumeric(DYN_LIST_DATATYPE(y))) return 0;
+
+  memset(&job, 0, sizeof(job));
+  job.x = xaxis;
+  job.y = yaxis;
+  job.xtype = DYN_LIST_DATATYPE(x);
+  job.ytype = DYN_LIST_DATATYPE(y);
+  job.xvals = DYN_LIST_VALS(x);
+  job.yvals = DYN_LIST_VALS(y);
+  job.n = DYN_LIST_N(x);
+  job.ncounts = xaxis->nbins*yaxis->nbins+1;
+  dlHistRun(&job, counts);
+  return 1;
+}
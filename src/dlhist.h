@@ -0,0 +1,45 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlhist.h
+ *
+ *  DESCRIPTION
+ *    Histogram counting for dl_hist, dl_hists and dl_hist2d.  A
+ *  DL_HIST_AXIS describes nbins equal bins from start (inclusive) to
+ *  stop (exclusive); values outside it, and NaNs, are not counted.
+ *  The bin of x is (int) ((x-start)/width); the vector kernels compute
+ *  it as a multiply by 1/width, checked against the division near bin
+ *  edges, so the counts are always exactly those of the division.
+ *
+ *  The count arrays passed in hold nbins+1 ints (nx*ny+1 for two
+ *  axes): the last slot collects the values that are out of range.
+ *
+ ************************************************************************/
+
+#ifndef DLHIST_H
+#define DLHIST_H
+
+typedef struct {
+  double start, stop;
+  double width;			/* (stop-start)/nbins                  */
+  double tol;			/* distance from an edge to recheck    */
+  int nbins;
+  int integral;			/* start and width are whole numbers   */
+} DL_HIST_AXIS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int dlHistAxis(DL_HIST_AXIS *axis, DYN_LIST *range, int nbins);
+void dlHistBins(DL_HIST_AXIS *axis, int type, void *vals, DL_SIZE n,
+		int *bins);
+int dlHistAdd(DL_HIST_AXIS *axis, DYN_LIST *dl, int *counts);
+int dlHistAdd2D(DL_HIST_AXIS *xaxis, DL_HIST_AXIS *yaxis,
+		DYN_LIST *x, DYN_LIST *y, int *counts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLHIST_H */
@@ -0,0 +1,639 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dllinalg.c
+ *
+ *  DESCRIPTION
+ *    Dense decompositions and solvers (see dllinalg.h).
+ *
+ *  QR is by Householder reflections, kept column major so that each
+ *  reflection is applied with contiguous dot products and updates.
+ *  Least squares factors x once and applies the reflections to each
+ *  column of y, then back substitutes; the columns of y (and the
+ *  columns updated at each step of the factorization) are independent
+ *  and are shared out across threads.
+ *
+ *  Symmetric eigenproblems are reduced to tridiagonal form by
+ *  Householder reflections and solved by the implicit QL method
+ *  (tred2 / tqli of Numerical Recipes).  The SVD factors a = q r and
+ *  then orthogonalizes the columns of r by one sided Jacobi rotations,
+ *  which gives small singular values to full relative accuracy.  PCA
+ *  takes the eigenvectors of the covariance matrix of the centered
+ *  observations.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "df.h"
+#include "dllinalg.h"
+#include "dlthread.h"
+
+#define DL_LINALG_SWEEPS 60	/* Jacobi sweeps before giving up       */
+#define DL_LINALG_QLITER 60	/* QL iterations per eigenvalue         */
+
+typedef struct {
+  int m, n, k;
+  double *at;			/* n columns of m: reflectors and r     */
+  double *beta;			/* 2/v'v of each reflector, 0 for none  */
+  double *diag;			/* diagonal of r                        */
+} DL_QR;
+
+typedef struct {
+  DL_QR *qr;
+  int j;			/* reflector being applied              */
+  double *cols;			/* lstsq: columns of y                  */
+  double *b;			/* lstsq: n x p solutions               */
+  int m, n, p;
+  const double *x;		/* pca: centered observations           */
+  double *cov;
+} DL_LINALG_JOB;
+
+
+static double dlDot(const double *x, const double *y, int n)
+{
+  double sum = 0.0;
+  int i;
+  for (i = 0; i < n; i++) sum += x[i]*y[i];
+  return sum;
+}
+
+/*
+ * dlQRReflect - apply reflector j of qr to the column y (length m)
+ */
+
+static void dlQRReflect(DL_QR *qr, int j, double *y)
+{
+  const double *v = qr->at + (size_t) j*qr->m;
+  double s;
+  int i;
+
+  if (qr->beta[j] == 0.0) return;
+  s = qr->beta[j] * dlDot(v+j, y+j, qr->m-j);
+  for (i = j; i < qr->m; i++) y[i] -= s*v[i];
+}
+
+static void dlQRUpdate(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_LINALG_JOB *job = (DL_LINALG_JOB *) cd;
+  DL_QR *qr = job->qr;
+  DL_SIZE c;
+
+  for (c = start; c < stop; c++)
+    dlQRReflect(qr, job->j, qr->at + (size_t) (job->j+1+c)*qr->m);
+}
+
+static void dlQRFree(DL_QR *qr)
+{
+  if (qr->at) free(qr->at);
+  if (qr->beta) free(qr->beta);
+  if (qr->diag) free(qr->diag);
+}
+
+/*
+ * dlQRFactor - Householder factorization of a (m x n, row major)
+ */
+
+static int dlQRFactor(DL_QR *qr, const double *a, int m, int n)
+{
+  DL_LINALG_JOB job;
+  double *col, norm, alpha;
+  int i, j;
+
+  qr->m = m;
+  qr->n = n;
+  qr->k = (m < n) ? m : n;
+  qr->at = (double *) malloc((size_t) m*n*sizeof(double));
+  qr->beta = (double *) malloc(qr->k*sizeof(double));
+  qr->diag = (double *) malloc(qr->k*sizeof(double));
+  if (!qr->at || !qr->beta || !qr->diag) {
+    dlQRFree(qr);
+    return 0;
+  }
+  for (i = 0; i < m; i++)
+    for (j = 0; j < n; j++) qr->at[(size_t) j*m+i] = a[(size_t) i*n+j];
+
+  memset(&job, 0, sizeof(job));
+  job.qr = qr;
+  for (j = 0; j < qr->k; j++) {
+    col = qr->at + (size_t) j*m;
+    norm = sqrt(dlDot(col+j, col+j, m-j));
+    if (norm == 0.0) {
+      qr->beta[j] = qr->diag[j] = 0.0;
+      continue;
+    }
+    alpha = (col[j] > 0.0) ? -norm : norm;
+    col[j] -= alpha;
+    qr->beta[j] = 2.0 / dlDot(col+j, col+j, m-j);
+    qr->diag[j] = alpha;
+    job.j = j;
+    dlParallelFor(n-j-1, (DL_SIZE) (n-j-1)*(m-j), dlQRUpdate, &job);
+  }
+  return 1;
+}
+
+/*
+ * dlQRFullRank - 0 if a diagonal element of r is negligible next to the
+ * largest
+ */
+
+static int dlQRFullRank(DL_QR *qr)
+{
+  double big = 0.0, tol;
+  int j;
+
+  for (j = 0; j < qr->k; j++)
+    if (fabs(qr->diag[j]) > big) big = fabs(qr->diag[j]);
+  tol = ((qr->m > qr->n) ? qr->m : qr->n) * DBL_EPSILON * big;
+  for (j = 0; j < qr->k; j++) if (fabs(qr->diag[j]) <= tol) return 0;
+  return 1;
+}
+
+int dlQR(const double *a, int m, int n, double *q, double *r)
+{
+  DL_QR qr;
+  double *y;
+  int i, j, c, k;
+
+  if (!dlQRFactor(&qr, a, m, n)) return DL_LINALG_NOMEM;
+  k = qr.k;
+  if (!(y = (double *) malloc(m*sizeof(double)))) {
+    dlQRFree(&qr);
+    return DL_LINALG_NOMEM;
+  }
+
+  /* q is the reflectors applied, last to first, to the first k columns of I */
+  for (c = 0; c < k; c++) {
+    memset(y, 0, m*sizeof(double));
+    y[c] = 1.0;
+    for (j = k-1; j >= 0; j--) dlQRReflect(&qr, j, y);
+    for (i = 0; i < m; i++) q[(size_t) i*k+c] = y[i];
+  }
+  for (i = 0; i < k; i++) {
+    for (c = 0; c < n; c++) {
+      if (c < i) r[(size_t) i*n+c] = 0.0;
+      else if (c == i) r[(size_t) i*n+c] = qr.diag[i];
+      else r[(size_t) i*n+c] = qr.at[(size_t) c*m+i];
+    }
+  }
+
+  free(y);
+  dlQRFree(&qr);
+  return DL_LINALG_OK;
+}
+
+int dlCholesky(const double *a, int n, double *l)
+{
+  double s, *li, *lj;
+  int i, j;
+
+  memset(l, 0, (size_t) n*n*sizeof(double));
+  for (j = 0; j < n; j++) {
+    lj = l + (size_t) j*n;
+    s = a[(size_t) j*n+j] - dlDot(lj, lj, j);
+    if (!(s > 0.0)) return DL_LINALG_SINGULAR;
+    lj[j] = sqrt(s);
+    for (i = j+1; i < n; i++) {
+      li = l + (size_t) i*n;
+      li[j] = (a[(size_t) i*n+j] - dlDot(li, lj, j)) / lj[j];
+    }
+  }
+  return DL_LINALG_OK;
+}
+
+/*
+ * dlTred2 - Householder reduction of the symmetric z (n x n) to
+ * tridiagonal form: diagonal d, subdiagonal e[1..n-1]; z is replaced
+ * by the orthogonal matrix of the reduction
+ */
+
+#define Z(i,j) z[(size_t) (i)*n+(j)]
+
+static void dlTred2(double *z, int n, double *d, double *e)
+{
+  int l, k, j, i;
+  double scale, hh, h, g, f;
+
+  for (i = n-1; i > 0; i--) {
+    l = i-1;
+    h = scale = 0.0;
+    if (l > 0) {
+      for (k = 0; k <= l; k++) scale += fabs(Z(i,k));
+      if (scale == 0.0) e[i] = Z(i,l);
+      else {
+	for (k = 0; k <= l; k++) {
+	  Z(i,k) /= scale;
+	  h += Z(i,k)*Z(i,k);
+	}
+	f = Z(i,l);
+	g = (f >= 0.0) ? -sqrt(h) : sqrt(h);
+	e[i] = scale*g;
+	h -= f*g;
+	Z(i,l) = f-g;
+	f = 0.0;
+	for (j = 0; j <= l; j++) {
+	  Z(j,i) = Z(i,j)/h;
+	  g = 0.0;
+	  for (k = 0; k <= j; k++) g += Z(j,k)*Z(i,k);
+	  for (k = j+1; k <= l; k++) g += Z(k,j)*Z(i,k);
+	  e[j] = g/h;
+	  f += e[j]*Z(i,j);
+	}
+	hh = f/(h+h);
+	for (j = 0; j <= l; j++) {
+	  f = Z(i,j);
+	  e[j] = g = e[j]-hh*f;
+	  for (k = 0; k <= j; k++) Z(j,k) -= (f*e[k]+g*Z(i,k));
+	}
+      }
+    }
+    else e[i] = Z(i,l);
+    d[i] = h;
+  }
+  d[0] = 0.0;
+  e[0] = 0.0;
+  for (i = 0; i < n; i++) {
+    l = i-1;
+    if (d[i] != 0.0) {
+      for (j = 0; j <= l; j++) {
+	g = 0.0;
+	for (k = 0; k <= l; k++) g += Z(i,k)*Z(k,j);
+	for (k = 0; k <= l; k++) Z(k,j) -= g*Z(k,i);
+      }
+    }
+    d[i] = Z(i,i);
+    Z(i,i) = 1.0;
+    for (j = 0; j <= l; j++) Z(j,i) = Z(i,j) = 0.0;
+  }
+}
+
+/*
+ * dlTqli - eigenvalues (into d) and eigenvectors (columns of z) of the
+ * tridiagonal matrix from dlTred2, by QL with implicit shifts.
+ * Returns 0 if an eigenvalue does not converge.
+ */
+
+static int dlTqli(double *d, double *e, int n, double *z)
+{
+  int m, l, iter, i, k;
+  double s, r, p, g, f, dd, c, b;
+
+  for (i = 1; i < n; i++) e[i-1] = e[i];
+  e[n-1] = 0.0;
+  for (l = 0; l < n; l++) {
+    iter = 0;
+    do {
+      for (m = l; m < n-1; m++) {
+	dd = fabs(d[m])+fabs(d[m+1]);
+	if (fabs(e[m]) <= DBL_EPSILON*dd) break;
+      }
+      if (m != l) {
+	if (iter++ == DL_LINALG_QLITER) return 0;
+	g = (d[l+1]-d[l])/(2.0*e[l]);
+	r = hypot(g, 1.0);
+	g = d[m]-d[l]+e[l]/(g + ((g >= 0.0) ? fabs(r) : -fabs(r)));
+	s = c = 1.0;
+	p = 0.0;
+	for (i = m-1; i >= l; i--) {
+	  f = s*e[i];
+	  b = c*e[i];
+	  e[i+1] = (r = hypot(f, g));
+	  if (r == 0.0) {
+	    d[i+1] -= p;
+	    e[m] = 0.0;
+	    break;
+	  }
+	  s = f/r;
+	  c = g/r;
+	  g = d[i+1]-p;
+	  r = (d[i]-g)*s+2.0*c*b;
+	  d[i+1] = g+(p = s*r);
+	  g = c*r-b;
+	  for (k = 0; k < n; k++) {
+	    f = Z(k,i+1);
+	    Z(k,i+1) = s*Z(k,i)+c*f;
+	    Z(k,i) = c*Z(k,i)-s*f;
+	  }
+	}
+	if (r == 0.0 && i >= l) continue;
+	d[l] -= p;
+	e[l] = g;
+	e[m] = 0.0;
+      }
+    } while (m != l);
+  }
+  return 1;
+}
+
+#undef Z
+
+/*
+ * dlOrder - indices of the n values in descending order
+ */
+
+static int *dlOrder(const double *vals, int n)
+{
+  int *order, i, j, t;
+
+  if (!(order = (int *) malloc(n*sizeof(int)))) return NULL;
+  for (i = 0; i < n; i++) order[i] = i;
+  for (i = 1; i < n; i++) {
+    t = order[i];
+    for (j = i; j > 0 && vals[order[j-1]] < vals[t]; j--)
+      order[j] = order[j-1];
+    order[j] = t;
+  }
+  return order;
+}
+
+/*
+ * dlSignColumns - flip columns of v (rows x cols, row major), and of u
+ * if given, so the element of v largest in magnitude is positive
+ */
+
+static void dlSignColumns(double *v, int rows, int cols, double *u,
+			  int urows)
+{
+  int i, c, big;
+
+  for (c = 0; c < cols; c++) {
+    for (big = 0, i = 1; i < rows; i++)
+      if (fabs(v[(size_t) i*cols+c]) > fabs(v[(size_t) big*cols+c])) big = i;
+    if (v[(size_t) big*cols+c] >= 0.0) continue;
+    for (i = 0; i < rows; i++) v[(size_t) i*cols+c] = -v[(size_t) i*cols+c];
+    if (u) for (i = 0; i < urows; i++)
+      u[(size_t) i*cols+c] = -u[(size_t) i*cols+c];
+  }
+}
+
+int dlEigenSym(const double *a, int n, double *w, double *v)
+{
+  double *z, *d, *e;
+  int *order = NULL, i, c, status = DL_LINALG_NOMEM;
+
+  z = (double *) malloc((size_t) n*n*sizeof(double));
+  d = (double *) malloc(n*sizeof(double));
+  e = (double *) malloc(n*sizeof(double));
+  if (z && d && e) {
+    memcpy(z, a, (size_t) n*n*sizeof(double));
+    dlTred2(z, n, d, e);
+    if (!dlTqli(d, e, n, z)) status = DL_LINALG_NOCONV;
+    else if ((order = dlOrder(d, n))) {
+      for (c = 0; c < n; c++) {
+	w[c] = d[order[c]];
+	for (i = 0; i < n; i++) v[(size_t) i*n+c] = z[(size_t) i*n+order[c]];
+      }
+      dlSignColumns(v, n, n, NULL, 0);
+      status = DL_LINALG_OK;
+    }
+  }
+  if (order) free(order);
+  if (z) free(z);
+  if (d) free(d);
+  if (e) free(e);
+  return status;
+}
+
+/*
+ * dlSVDTall - svd of a (m x n, m >= n) as q r, then one sided Jacobi
+ * on the columns of r.  u is m x n, v is n x n.
+ */
+
+static int dlSVDTall(const double *a, int m, int n, double *u, double *s,
+		     double *v)
+{
+  double *q, *r, *w, *vt, *wp, *wq, *vp, *vq, *uc;
+  double alpha, beta, gamma, zeta, t, cs, sn, x, y, tol = n*DBL_EPSILON;
+  int *order = NULL, i, p, c, sweep, rotated = 1, status = DL_LINALG_NOMEM;
+
+  q = (double *) malloc((size_t) m*n*sizeof(double));
+  r = (double *) malloc((size_t) n*n*sizeof(double));
+  w = (double *) malloc((size_t) n*n*sizeof(double));
+  vt = (double *) calloc((size_t) n*n, sizeof(double));
+  uc = (double *) malloc(n*sizeof(double));
+  if (!q || !r || !w || !vt || !uc) goto done;
+  if ((status = dlQR(a, m, n, q, r)) != DL_LINALG_OK) goto done;
+
+  /* w and vt hold columns contiguously */
+  for (i = 0; i < n; i++) {
+    for (c = 0; c < n; c++) w[(size_t) c*n+i] = r[(size_t) i*n+c];
+    vt[(size_t) i*n+i] = 1.0;
+  }
+
+  for (sweep = 0; rotated && sweep < DL_LINALG_SWEEPS; sweep++) {
+    rotated = 0;
+    for (p = 0; p < n-1; p++) {
+      for (c = p+1; c < n; c++) {
+	wp = w + (size_t) p*n;
+	wq = w + (size_t) c*n;
+	alpha = dlDot(wp, wp, n);
+	beta = dlDot(wq, wq, n);
+	gamma = dlDot(wp, wq, n);
+	if (fabs(gamma) <= tol*sqrt(alpha*beta)) continue;
+	rotated = 1;
+	zeta = (beta-alpha)/(2.0*gamma);
+	t = ((zeta >= 0.0) ? 1.0 : -1.0)/(fabs(zeta)+sqrt(1.0+zeta*zeta));
+	cs = 1.0/sqrt(1.0+t*t);
+	sn = cs*t;
+	vp = vt + (size_t) p*n;
+	vq = vt + (size_t) c*n;
+	for (i = 0; i < n; i++) {
+	  x = wp[i]; y = wq[i];
+	  wp[i] = cs*x-sn*y;
+	  wq[i] = sn*x+cs*y;
+	  x = vp[i]; y = vq[i];
+	  vp[i] = cs*x-sn*y;
+	  vq[i] = sn*x+cs*y;
+	}
+      }
+    }
+  }
+  if (rotated) {
+    status = DL_LINALG_NOCONV;
+    goto done;
+  }
+
+  for (c = 0; c < n; c++) s[c] = sqrt(dlDot(w + (size_t) c*n, w + (size_t) c*n, n));
+  if (!(order = dlOrder(s, n))) {
+    status = DL_LINALG_NOMEM;
+    goto done;
+  }
+  for (c = 0; c < n; c++) {
+    p = order[c];
+    wp = w + (size_t) p*n;
+    for (i = 0; i < n; i++) uc[i] = (s[p] > 0.0) ? wp[i]/s[p] : 0.0;
+    for (i = 0; i < m; i++) u[(size_t) i*n+c] = dlDot(q + (size_t) i*n, uc, n);
+    for (i = 0; i < n; i++) v[(size_t) i*n+c] = vt[(size_t) p*n+i];
+  }
+  /* s last, as it is read through order above */
+  for (c = 0; c < n; c++) uc[c] = s[order[c]];
+  memcpy(s, uc, n*sizeof(double));
+  status = DL_LINALG_OK;
+
+ done:
+  if (order) free(order);
+  if (q) free(q);
+  if (r) free(r);
+  if (w) free(w);
+  if (vt) free(vt);
+  if (uc) free(uc);
+  return status;
+}
+
+int dlSVD(const double *a, int m, int n, double *u, double *s, double *v)
+{
+  double *at;
+  int i, j, status;
+
+  if (m >= n) {
+    status = dlSVDTall(a, m, n, u, s, v);
+  }
+  else {
+    /* a' = v s u' */
+    if (!(at = (double *) malloc((size_t) m*n*sizeof(double))))
+      return DL_LINALG_NOMEM;
+    for (i = 0; i < m; i++)
+      for (j = 0; j < n; j++) at[(size_t) j*m+i] = a[(size_t) i*n+j];
+    status = dlSVDTall(at, n, m, v, s, u);
+    free(at);
+  }
+  if (status == DL_LINALG_OK) {
+    dlSignColumns(v, n, (m < n) ? m : n, u, m);
+  }
+  return status;
+}
+
+static void dlLstsqColumns(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_LINALG_JOB *job = (DL_LINALG_JOB *) cd;
+  DL_QR *qr = job->qr;
+  int i, j, c, n = qr->n, m = qr->m;
+  double *y, sum;
+
+  for (c = start; c < stop; c++) {
+    y = job->cols + (size_t) c*m;
+    for (j = 0; j < n; j++) dlQRReflect(qr, j, y);
+    for (i = n-1; i >= 0; i--) {
+      sum = y[i];
+      for (j = i+1; j < n; j++) sum -= qr->at[(size_t) j*m+i]*y[j];
+      y[i] = sum/qr->diag[i];
+      job->b[(size_t) i*job->p+c] = y[i];
+    }
+  }
+}
+
+int dlLstsq(const double *x, int m, int n, const double *y, int p,
+	    double *b)
+{
+  DL_QR qr;
+  DL_LINALG_JOB job;
+  int i, c;
+
+  if (m < n) return DL_LINALG_SINGULAR;
+  if (!dlQRFactor(&qr, x, m, n)) return DL_LINALG_NOMEM;
+  if (!dlQRFullRank(&qr)) {
+    dlQRFree(&qr);
+    return DL_LINALG_SINGULAR;
+  }
+
+  memset(&job, 0, sizeof(job));
+  job.qr = &qr;
+  job.b = b;
+  job.p = p;
+  if (!(job.cols = (double *) malloc((size_t) m*p*sizeof(double)))) {
+    dlQRFree(&qr);
+    return DL_LINALG_NOMEM;
+  }
+  for (i = 0; i < m; i++)
+    for (c = 0; c < p; c++) job.cols[(size_t) c*m+i] = y[(size_t) i*p+c];
+  dlParallelFor(p, (DL_SIZE) p*m*n, dlLstsqColumns, &job);
+
+  free(job.cols);
+  dlQRFree(&qr);
+  return DL_LINALG_OK;
+}
+
+/*
+ * dlCovRows - rows start..stop of the upper half of the cross product
+ * of the centered observations
+ */
+
+static void dlCovRows(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_LINALG_JOB *job = (DL_LINALG_JOB *) cd;
+  int i, a, b, n = job->n, m = job->m;
+  const double *row;
+  double *cov, xa;
+
+  for (i = 0; i < m; i++) {
+    row = job->x + (size_t) i*n;
+    for (a = start; a < stop; a++) {
+      cov = job->cov + (size_t) a*n;
+      xa = row[a];
+      for (b = a; b < n; b++) cov[b] += xa*row[b];
+    }
+  }
+}
+
+int dlPCA(const double *x, int m, int n, int k, double *loadings,
+	  double *scores, double *variances)
+{
+  DL_LINALG_JOB job;
+  double *xc, *cov, *w, *v, *mean, *out, xv;
+  int i, a, b, status = DL_LINALG_NOMEM;
+
+  if (m < 2) return DL_LINALG_SINGULAR;
+  if (k <= 0 || k > n) k = n;
+  xc = (double *) malloc((size_t) m*n*sizeof(double));
+  cov = (double *) calloc((size_t) n*n, sizeof(double));
+  v = (double *) malloc((size_t) n*n*sizeof(double));
+  w = (double *) malloc(n*sizeof(double));
+  mean = (double *) calloc(n, sizeof(double));
+  if (!xc || !cov || !v || !w || !mean) goto done;
+
+  for (i = 0; i < m; i++)
+    for (a = 0; a < n; a++) mean[a] += x[(size_t) i*n+a];
+  for (a = 0; a < n; a++) mean[a] /= m;
+  for (i = 0; i < m; i++)
+    for (a = 0; a < n; a++)
+      xc[(size_t) i*n+a] = x[(size_t) i*n+a] - mean[a];
+
+  memset(&job, 0, sizeof(job));
+  job.x = xc;
+  job.cov = cov;
+  job.m = m;
+  job.n = n;
+  dlParallelFor(n, (DL_SIZE) m*n*(n+1)/2, dlCovRows, &job);
+  for (a = 0; a < n; a++) {
+    for (b = a; b < n; b++) {
+      cov[(size_t) a*n+b] /= (m-1);
+      cov[(size_t) b*n+a] = cov[(size_t) a*n+b];
+    }
+  }
+
+  if ((status = dlEigenSym(cov, n, w, v)) != DL_LINALG_OK) goto done;
+
+  for (a = 0; a < n; a++)
+    for (b = 0; b < k; b++) loadings[(size_t) a*k+b] = v[(size_t) a*n+b];
+  for (b = 0; b < n; b++) variances[b] = (w[b] > 0.0) ? w[b] : 0.0;
+  memset(scores, 0, (size_t) m*k*sizeof(double));
+  for (i = 0; i < m; i++) {
+    out = scores + (size_t) i*k;
+    for (a = 0; a < n; a++) {
+      xv = xc[(size_t) i*n+a];
+      for (b = 0; b < k; b++) out[b] += xv*loadings[(size_t) a*k+b];
+    }
+  }
+
+ done:
+  if (xc) free(xc);
+  if (cov) free(cov);
+  if (v) free(v);
+  if (w) free(w);
+  if (mean) free(mean);
+  return status;
+}
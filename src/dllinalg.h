@@ -0,0 +1,52 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dllinalg.h
+ *
+ *  DESCRIPTION
+ *    Dense decompositions and solvers for dm_qr, dm_chol, dm_eigen,
+ *  dm_svd, dm_lstsq and dm_pca.  Matrices are row major arrays of
+ *  doubles; all the arithmetic is done in double.
+ *
+ *    dlQR        a (m x n) = q (m x k) r (k x n), k = min(m,n)
+ *    dlCholesky  a (n x n) = l l', l lower (only a's lower half is read)
+ *    dlEigenSym  a (n x n symmetric) = v diag(w) v', w descending
+ *    dlSVD       a (m x n) = u (m x k) diag(s) v' (v n x k), s descending
+ *    dlLstsq     b (n x p) minimizing |x b - y| for x (m x n), y (m x p)
+ *    dlPCA       loadings (n x k, one component per column) and scores
+ *                (m x k) of the m observations of n variables in x, and
+ *                the variances along all n components
+ *
+ *  Eigenvectors, right singular vectors and loadings are signed so
+ *  that the element largest in magnitude of each is positive.
+ *
+ *  Each returns DL_LINALG_OK, DL_LINALG_NOMEM, DL_LINALG_SINGULAR (a
+ *  not positive definite, x rank deficient or with fewer rows than
+ *  columns, fewer than two observations) or DL_LINALG_NOCONV.
+ *
+ ************************************************************************/
+
+#ifndef DLLINALG_H
+#define DLLINALG_H
+
+enum DL_LINALG_STATUS { DL_LINALG_OK, DL_LINALG_NOMEM, DL_LINALG_SINGULAR,
+			DL_LINALG_NOCONV };
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int dlQR(const double *a, int m, int n, double *q, double *r);
+int dlCholesky(const double *a, int n, double *l);
+int dlEigenSym(const double *a, int n, double *w, double *v);
+int dlSVD(const double *a, int m, int n, double *u, double *s, double *v);
+int dlLstsq(const double *x, int m, int n, const double *y, int p,
+	    double *b);
+int dlPCA(const double *x, int m, int n, int k, double *loadings,
+	  double *scores, double *variances);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLLINALG_H */
@@ -0,0 +1,384 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlmat.c
+ *
+ *  DESCRIPTION
+ *    Contiguous float matrices and the kernels behind dm_mult,
+ *  dm_transpose, dm_rowSums / dm_colSums, dm_rowMeans / dm_colMeans
+ *  and dm_centerRows / dm_centerCols.
+ *
+ *  The product is computed a panel of DL_MAT_MC rows of the result at
+ *  a time.  Within a panel the result is built DL_MAT_NC columns at a
+ *  time in a block of double sums, to which each DL_MAT_KC deep slice
+ *  of the inner dimension is added in turn (by the dlsimd kernel where
+ *  there is one), so every sum still runs in ascending k.  Panels are
+ *  independent and are shared out across threads.
+ *
+ *  Transposes, sums and centering are single passes over the data,
+ *  made through arrays of row pointers so they need no copy of a list
+ *  of lists.  Row sums run four rows side by side, so the additions of
+ *  one row do not wait on each other; column sums add each row into
+ *  one vector of sums.  Both keep the order of the plain loops.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "df.h"
+#include "dfana.h"
+#include "dlmat.h"
+#include "dlsimd.h"
+#include "dlthread.h"
+
+#define DL_MAT_ALIGN   8	/* row strides are multiples of this     */
+#define DL_MAT_MC     64	/* result rows per panel                 */
+#define DL_MAT_NC    256	/* result columns per block of sums      */
+#define DL_MAT_KC    256	/* inner dimension per pass              */
+#define DL_MAT_TILE   32	/* transpose tile                        */
+#define DL_MAT_COLS  256	/* columns per column sum task           */
+
+typedef struct {
+  DL_MATRIX *a, *b, *c;		/* product                              */
+  float **in, **out;		/* rows, for the other kernels          */
+  int rows, cols;
+  const float *center;
+  int bycols;
+  double *sums;
+  int failed;
+} DL_MAT_JOB;
+
+
+DL_MATRIX *dlMatrixCreate(int rows, int cols)
+{
+  DL_MATRIX *m;
+
+  if (rows <= 0 || cols <= 0) return NULL;
+  if (!(m = (DL_MATRIX *) malloc(sizeof(DL_MATRIX)))) return NULL;
+  m->rows = rows;
+  m->cols = cols;
+  m->stride = (cols + DL_MAT_ALIGN - 1) / DL_MAT_ALIGN * DL_MAT_ALIGN;
+  if (!(m->vals = (float *) calloc((size_t) rows * m->stride,
+				   sizeof(float)))) {
+    free(m);
+    return NULL;
+  }
+  return m;
+}
+
+void dlMatrixFree(DL_MATRIX *m)
+{
+  if (!m) return;
+  free(m->vals);
+  free(m);
+}
+
+/*
+ * dlMatrixFromList - copy of a list of equal length DF_FLOAT rows, or
+ * NULL if dl is not one (or out of memory)
+ */
+
+DL_MATRIX *dlMatrixFromList(DYN_LIST *dl)
+{
+  DL_MATRIX *m;
+  DYN_LIST **rows;
+  int i;
+
+  if (!dynListIsMatrix(dl)) return NULL;
+  rows = (DYN_LIST **) DYN_LIST_VALS(dl);
+  if (!(m = dlMatrixCreate(DYN_LIST_N(dl), DYN_LIST_N(rows[0]))))
+    return NULL;
+  for (i = 0; i < m->rows; i++)
+    memcpy(DL_MATRIX_ROW(m, i), DYN_LIST_VALS(rows[i]),
+	   m->cols * sizeof(float));
+  return m;
+}
+
+DYN_LIST *dlMatrixToList(DL_MATRIX *m)
+{
+  DYN_LIST *dl;
+  float **vals;
+  int i;
+
+  if (!(vals = (float **) malloc(m->rows * sizeof(float *)))) return NULL;
+  if ((dl = dlMatrixNewList(m->rows, m->cols, vals))) {
+    for (i = 0; i < m->rows; i++)
+      memcpy(vals[i], DL_MATRIX_ROW(m, i), m->cols * sizeof(float));
+  }
+  free(vals);
+  return dl;
+}
+
+/*
+ * dlMatrixBlock - c (mr x nc, row stride ldc) += a (mr x kc) * b (kc x nc)
+ */
+
+static void dlMatrixBlock(int mr, int nc, int kc, const float *a, int lda,
+			  const float *b, int ldb, double *c, int ldc)
+{
+  int i, j, k;
+  const float *brow;
+  double *crow;
+  float av;
+
+  if (dlSimdGemm(mr, nc, kc, a, lda, b, ldb, c, ldc)) return;
+
+  for (i = 0; i < mr; i++) {
+    crow = c + (size_t) i*ldc;
+    for (k = 0; k < kc; k++) {
+      av = a[(size_t) i*lda + k];
+      brow = b + (size_t) k*ldb;
+      for (j = 0; j < nc; j++) crow[j] += av*brow[j];
+    }
+  }
+}
+
+static void dlMatrixPanels(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_MAT_JOB *job = (DL_MAT_JOB *) cd;
+  DL_MATRIX *a = job->a, *b = job->b, *c = job->c;
+  DL_SIZE p;
+  int i0, j0, k0, mr, nc, kc, i, j;
+  double *sums;
+  float *out;
+
+  if (!(sums = (double *) malloc(DL_MAT_MC*DL_MAT_NC*sizeof(double)))) {
+    job->failed = 1;
+    return;
+  }
+  for (p = start; p < stop; p++) {
+    i0 = p*DL_MAT_MC;
+    mr = (c->rows - i0 < DL_MAT_MC) ? c->rows - i0 : DL_MAT_MC;
+    for (j0 = 0; j0 < c->cols; j0 += DL_MAT_NC) {
+      nc = (c->cols - j0 < DL_MAT_NC) ? c->cols - j0 : DL_MAT_NC;
+      memset(sums, 0, (size_t) mr*nc*sizeof(double));
+      for (k0 = 0; k0 < a->cols; k0 += DL_MAT_KC) {
+	kc = (a->cols - k0 < DL_MAT_KC) ? a->cols - k0 : DL_MAT_KC;
+	dlMatrixBlock(mr, nc, kc, DL_MATRIX_ROW(a, i0) + k0, a->stride,
+		      DL_MATRIX_ROW(b, k0) + j0, b->stride, sums, nc);
+      }
+      for (i = 0; i < mr; i++) {
+	out = DL_MATRIX_ROW(c, i0+i) + j0;
+	for (j = 0; j < nc; j++) out[j] = sums[i*nc+j];
+      }
+    }
+  }
+  free(sums);
+}
+
+/*
+ * dlMatrixMultiply - a * b, or NULL if the inner dimensions differ
+ * (or out of memory)
+ */
+
+DL_MATRIX *dlMatrixMultiply(DL_MATRIX *a, DL_MATRIX *b)
+{
+  DL_MAT_JOB job;
+  int npanels;
+
+  if (a->cols != b->rows) return NULL;
+  memset(&job, 0, sizeof(job));
+  job.a = a;
+  job.b = b;
+  if (!(job.c = dlMatrixCreate(a->rows, b->cols))) return NULL;
+
+  npanels = (a->rows + DL_MAT_MC - 1) / DL_MAT_MC;
+  dlParallelFor(npanels, (DL_SIZE) a->rows * b->cols * a->cols,
+		dlMatrixPanels, &job);
+  if (job.failed) {
+    dlMatrixFree(job.c);
+    return NULL;
+  }
+  return job.c;
+}
+
+/*
+ * The kernels below read (and write) whole rows through arrays of row
+ * pointers, so they run straight on the rows of a list of lists as
+ * well as on a DL_MATRIX (dlMatrixRows): a copy into contiguous
+ * storage would cost as much as the pass itself.
+ */
+
+float **dlMatrixRows(DL_MATRIX *m)
+{
+  float **rows;
+  int i;
+
+  if (!(rows = (float **) malloc(m->rows * sizeof(float *)))) return NULL;
+  for (i = 0; i < m->rows; i++) rows[i] = DL_MATRIX_ROW(m, i);
+  return rows;
+}
+
+/*
+ * dlMatrixNewList - list of rows DF_FLOAT rows of cols (unset) values,
+ * with the value pointers in vals
+ */
+
+DYN_LIST *dlMatrixNewList(int rows, int cols, float **vals)
+{
+  DYN_LIST *dl, *row;
+  int i;
+
+  if (!(dl = dfuCreateDynList(DF_LIST, rows))) return NULL;
+  for (i = 0; i < rows; i++) {
+    if (!(vals[i] = (float *) malloc(cols * sizeof(float))) ||
+	!(row = dfuCreateDynListWithVals(DF_FLOAT, cols, vals[i]))) {
+      if (vals[i]) free(vals[i]);
+      dfuFreeDynList(dl);
+      return NULL;
+    }
+    dfuMoveDynListList(dl, row);
+  }
+  return dl;
+}
+
+static void dlMatrixTiles(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_MAT_JOB *job = (DL_MAT_JOB *) cd;
+  int i0, j0, i, j, iend, jend;
+  const float *row;
+
+  for (i0 = start*DL_MAT_TILE; i0 < job->rows && i0 < stop*DL_MAT_TILE;
+       i0 += DL_MAT_TILE) {
+    iend = (i0 + DL_MAT_TILE < job->rows) ? i0 + DL_MAT_TILE : job->rows;
+    for (j0 = 0; j0 < job->cols; j0 += DL_MAT_TILE) {
+      jend = (j0 + DL_MAT_TILE < job->cols) ? j0 + DL_MAT_TILE : job->cols;
+      for (i = i0; i < iend; i++) {
+	row = job->in[i];
+	for (j = j0; j < jend; j++) job->out[j][i] = row[j];
+      }
+    }
+  }
+}
+
+/*
+ * dlMatrixTranspose - out[j][i] = in[i][j], a tile at a time
+ */
+
+void dlMatrixTranspose(float **in, int rows, int cols, float **out)
+{
+  DL_MAT_JOB job;
+
+  memset(&job, 0, sizeof(job));
+  job.in = in;
+  job.out = out;
+  job.rows = rows;
+  job.cols = cols;
+  dlParallelFor((rows + DL_MAT_TILE - 1) / DL_MAT_TILE,
+		(DL_SIZE) rows * cols, dlMatrixTiles, &job);
+}
+
+static void dlMatrixRowSumRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_MAT_JOB *job = (DL_MAT_JOB *) cd;
+  DL_SIZE i;
+  int j, n = job->cols;
+  const float *r0, *r1, *r2, *r3;
+  double s0, s1, s2, s3;
+
+  for (i = start; i + 4 <= stop; i += 4) {
+    r0 = job->in[i];
+    r1 = job->in[i+1];
+    r2 = job->in[i+2];
+    r3 = job->in[i+3];
+    s0 = s1 = s2 = s3 = 0.0;
+    for (j = 0; j < n; j++) {
+      s0 += r0[j];
+      s1 += r1[j];
+      s2 += r2[j];
+      s3 += r3[j];
+    }
+    job->sums[i] = s0;
+    job->sums[i+1] = s1;
+    job->sums[i+2] = s2;
+    job->sums[i+3] = s3;
+  }
+  for (; i < stop; i++) {
+    r0 = job->in[i];
+    for (s0 = 0.0, j = 0; j < n; j++) s0 += r0[j];
+    job->sums[i] = s0;
+  }
+}
+
+void dlMatrixRowSums(float **rows, int nrows, int ncols, double *sums)
+{
+  DL_MAT_JOB job;
+
+  memset(&job, 0, sizeof(job));
+  job.in = rows;
+  job.rows = nrows;
+  job.cols = ncols;
+  job.sums = sums;
+  dlParallelFor(nrows, (DL_SIZE) nrows * ncols, dlMatrixRowSumRange, &job);
+}
+
+static void dlMatrixColSumRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_MAT_JOB *job = (DL_MAT_JOB *) cd;
+  int i, j, j0 = start*DL_MAT_COLS, j1 = stop*DL_MAT_COLS;
+  double *sums = job->sums;
+  const float *row;
+
+  if (j1 > job->cols) j1 = job->cols;
+  for (j = j0; j < j1; j++) sums[j] = 0.0;
+  for (i = 0; i < job->rows; i++) {
+    row = job->in[i];
+    for (j = j0; j < j1; j++) sums[j] += row[j];
+  }
+}
+
+void dlMatrixColSums(float **rows, int nrows, int ncols, double *sums)
+{
+  DL_MAT_JOB job;
+
+  memset(&job, 0, sizeof(job));
+  job.in = rows;
+  job.rows = nrows;
+  job.cols = ncols;
+  job.sums = sums;
+  dlParallelFor((ncols + DL_MAT_COLS - 1) / DL_MAT_COLS,
+		(DL_SIZE) nrows * ncols, dlMatrixColSumRange, &job);
+}
+
+static void dlMatrixCenterRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_MAT_JOB *job = (DL_MAT_JOB *) cd;
+  const float *c = job->center, *in;
+  DL_SIZE i;
+  int j, n = job->cols;
+  float *out, ci;
+
+  for (i = start; i < stop; i++) {
+    in = job->in[i];
+    out = job->out[i];
+    if (job->bycols) {
+      for (j = 0; j < n; j++) out[j] = in[j] - c[j];
+    }
+    else {
+      ci = c[i];
+      for (j = 0; j < n; j++) out[j] = in[j] - ci;
+    }
+  }
+}
+
+/*
+ * dlMatrixCenter - out = in less center[i] in each row i, or less
+ * center[j] in each column j (bycols); out may be in
+ */
+
+void dlMatrixCenter(float **in, int rows, int cols, const float *center,
+		    int bycols, float **out)
+{
+  DL_MAT_JOB job;
+
+  memset(&job, 0, sizeof(job));
+  job.in = in;
+  job.out = out;
+  job.rows = rows;
+  job.cols = cols;
+  job.center = center;
+  job.bycols = bycols;
+  dlParallelFor(rows, (DL_SIZE) rows * cols, dlMatrixCenterRange, &job);
+}
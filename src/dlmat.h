@@ -0,0 +1,55 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlmat.h
+ *
+ *  DESCRIPTION
+ *    Contiguous float matrices for the dm_* functions.  A DL_MATRIX
+ *  holds rows x cols values row major, each row starting stride
+ *  floats after the last (stride is cols rounded up to a whole number
+ *  of vectors).  dlMatrixFromList and dlMatrixToList convert to and
+ *  from the list of DF_FLOAT rows form used by dmana.c.
+ *
+ *  The single pass kernels (transpose, sums, centering) take arrays of
+ *  row pointers instead, from dlMatrixRows or from the rows of a list,
+ *  so lists are not copied to run them.
+ *
+ *  Products are sums of float products taken in double in ascending
+ *  k, the same values the list of lists code gave, whatever the
+ *  blocking, vector level or number of threads.
+ *
+ ************************************************************************/
+
+#ifndef DLMAT_H
+#define DLMAT_H
+
+typedef struct {
+  int rows, cols;
+  int stride;			/* floats from one row to the next      */
+  float *vals;
+} DL_MATRIX;
+
+#define DL_MATRIX_ROW(m,i) ((m)->vals + (size_t) (i) * (m)->stride)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+DL_MATRIX *dlMatrixCreate(int rows, int cols);
+void dlMatrixFree(DL_MATRIX *m);
+DL_MATRIX *dlMatrixFromList(DYN_LIST *dl);
+DYN_LIST *dlMatrixToList(DL_MATRIX *m);
+DL_MATRIX *dlMatrixMultiply(DL_MATRIX *a, DL_MATRIX *b);
+float **dlMatrixRows(DL_MATRIX *m);
+DYN_LIST *dlMatrixNewList(int rows, int cols, float **vals);
+void dlMatrixTranspose(float **in, int rows, int cols, float **out);
+void dlMatrixRowSums(float **rows, int nrows, int ncols, double *sums);
+void dlMatrixColSums(float **rows, int nrows, int ncols, double *sums);
+void dlMatrixCenter(float **in, int rows, int cols, const float *center,
+		    int bycols, float **out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLMAT_H */
@@ -6,15 +6,59 @@
 * March 1998, Michael Thayer              *
 \*****************************************/
 
+/*
+ * A "dynlist" object is a list returned by a command: its internal rep
+ * is one reference on the list's DL_RESULT (tcl_dl.h) and its string,
+ * made only when asked for, is the %list#% name.  The list is freed when
+ * the last reference goes, which happens when the last object holding it
+ * goes away or when the list is deleted or renamed first.
+ *
+ * A "dltemps" object is the value of the holder variable that every
+ * frame making results gets.  It keeps one more reference on each of
+ * them, so a temp list lives at least until its proc returns (which is
+ * what scripts that pass names around as plain strings expect), and
+ * drops them all when the variable goes.
+ *
+ * A "dlref" object is a name that has been looked up: its internal rep
+ * remembers the dlTable list, group or group:list it found, good until
+ * the interp's list or group generation moves on (tcl_dl.c bumps them
+ * whenever one of those is deleted or renamed).  A group:list also
+ * checks that the group still holds that list, under that name, at the
+ * same place, since lists come and go inside groups all the time.
+ */
+
 #include "dlobj.h"
+#include "dfana.h"
 #include <string.h>
-
-Tcl_ObjType * type_int, * type_list, * type_bool, * type_double, * type_str;
+#include <limits.h>
+
+#define DL_RESULTS_START	64	/* starting slots in the name table */
+#define DL_TEMPS_START		8	/* starting size of a holder	    */
+
+typedef struct {
+	int n, max;
+	DL_RESULT ** results;
+} DL_TEMPS;
+
+typedef struct {
+	Tcl_Interp * interp;
+	DLSHINFO * info;
+	unsigned int generation;	/* list or group generation	   */
+	DYN_GROUP * dg;			/* the group, or NULL for a list   */
+	DYN_LIST * dl;			/* the list, or NULL for a group   */
+	int index;			/* dl's place in dg		   */
+	int offset;			/* where dl's name starts in bytes */
+} DL_REF;
 
 static int set_from_any(Tcl_Interp * interp, Tcl_Obj * obj);
 static void update_string_proc(Tcl_Obj * obj);
 static void free_int_rep_proc(Tcl_Obj * obj);
 static void dup_int_rep_proc(Tcl_Obj * src, Tcl_Obj * dst);
+static void update_temps_string(Tcl_Obj * obj);
+static void free_temps_rep(Tcl_Obj * obj);
+static void dup_temps_rep(Tcl_Obj * src, Tcl_Obj * dst);
+static void free_ref_rep(Tcl_Obj * obj);
+static void dup_ref_rep(Tcl_Obj * src, Tcl_Obj * dst);
 
 static Tcl_ObjType tclDynListType = {
 	"dynlist",
@@ -24,324 +68,582 @@ static Tcl_ObjType tclDynListType = {
 	set_from_any
 };
 
-static DYN_LIST * ObjToDynList(Tcl_Interp * interp, Tcl_Obj * obj);
-static DYN_LIST * LongToDynList(Tcl_Interp * interp, Tcl_Obj * obj);
-static DYN_LIST * FloatToDynList(Tcl_Interp * interp, Tcl_Obj * obj);
-static DYN_LIST * StringToDynList(Tcl_Interp * interp, Tcl_Obj * obj);
-static DYN_LIST * ListToDynList(Tcl_Interp * interp, Tcl_Obj * obj);
+static Tcl_ObjType tclDynTempsType = {
+	"dltemps",
+	free_temps_rep,
+	dup_temps_rep,
+	update_temps_string,
+	set_from_any
+};
+
+/* The string is never dropped while this rep is held, so needs no proc */
+
+static Tcl_ObjType tclDynRefType = {
+	"dlref",
+	free_ref_rep,
+	dup_ref_rep,
+	NULL,
+	set_from_any
+};
 
-/* Convert a tcl object to a dynamic list */
+
+/* Names become results only by being returned, never by conversion */
 
 static int set_from_any(Tcl_Interp * interp, Tcl_Obj * obj)
 {
-	if (obj->typePtr == & tclDynListType) return(TCL_OK);
-	if ((obj->internalRep.otherValuePtr = ObjToDynList(interp, obj))) {
-		obj->typePtr = & tclDynListType;
-		return(TCL_OK);
-	}
+	if (interp) Tcl_SetResult(interp,
+		"DLSH: value cannot be converted to a dynlist result",
+		TCL_STATIC);
 	return(TCL_ERROR);
 }
 
 
-/* Extract a dynlist from an object */
+/*
+ * Names are numbered in order, so the slot for id is just id's low bits
+ * and most lookups hit at once.  Removed results leave a tombstone for
+ * the probes that ran past them, cleared whenever the table is rebuilt.
+ */
 
-static DYN_LIST * ObjToDynList(Tcl_Interp * interp, Tcl_Obj * obj)
+static DL_RESULT tombstone;
+#define DL_TOMBSTONE (& tombstone)
+
+/* The slot holding id, or NULL */
+
+static DL_RESULT ** find_slot(DL_RESULTS * results, int id)
 {
-	DYN_LIST * ret;
-
-	if (obj->typePtr == type_bool || obj->typePtr == type_int)
-		return(LongToDynList(interp, obj));
-	if (obj->typePtr == type_double)
-		return(FloatToDynList(interp, obj));
-	if (obj->typePtr == type_list)
-		return(ListToDynList(interp, obj));
-	if (obj->typePtr == type_str)
-		return(StringToDynList(interp, obj));
-	tclFindDynList(interp, Tcl_GetStringFromObj(obj, NULL), & ret);
-	return(ret);
+	unsigned int mask = results->size - 1, i = (unsigned int) id & mask;
+
+	for (; results->slots[i]; i = (i + 1) & mask)
+		if (results->slots[i] != DL_TOMBSTONE
+			&& results->slots[i]->id == id)
+			return(& results->slots[i]);
+	return(NULL);
 }
 
 
-/* Convert a long value to a dynamic list */
+/* Rebuild the table without tombstones, growing it if it is filling up */
 
-static DYN_LIST * LongToDynList(Tcl_Interp * interp, Tcl_Obj * obj)
+static void rebuild_table(DL_RESULTS * results)
 {
-	DYN_LIST * list = dfuCreateDynList(DF_LONG, 1);
-
-	if (list == NULL) {
-		Tcl_SetResult(interp, "DLSH: unable to create a new list",
-			TCL_STATIC);
-		return(NULL);
+	DL_RESULT ** old = results->slots;
+	unsigned int i, j, mask, oldsize = results->size;
+
+	if (4 * (results->n + 1) > results->size) results->size *= 2;
+	mask = results->size - 1;
+	results->slots = (DL_RESULT **)
+		Tcl_Alloc(results->size * sizeof(DL_RESULT *));
+	memset(results->slots, 0, results->size * sizeof(DL_RESULT *));
+	for (i = 0; i < oldsize; i++) {
+		if (!old[i] || old[i] == DL_TOMBSTONE) continue;
+		for (j = (unsigned int) old[i]->id & mask; results->slots[j];
+			j = (j + 1) & mask);
+		results->slots[j] = old[i];
 	}
-	dfuAddDynListLong(list, obj->internalRep.longValue);
-	return(list);
+	results->used = results->n;
+	Tcl_Free((char *) old);
+}
+
+
+static void remove_result(DL_RESULTS * results, DL_RESULT * result)
+{
+	DL_RESULT ** slot = find_slot(results, result->id);
+
+	if (!slot || *slot != result) return;
+	*slot = DL_TOMBSTONE;
+	results->n--;
+	result->owner = NULL;
 }
 
 
-/* Convert a long value to a dynamic list */
+/* Detach the list from its result, leaving it to the caller */
 
-static DYN_LIST * FloatToDynList(Tcl_Interp * interp, Tcl_Obj * obj)
+static DYN_LIST * take_list(DL_RESULT * result)
 {
-	DYN_LIST * list = dfuCreateDynList(DF_FLOAT, 1);
+	DYN_LIST * list = result->dl;
 
-	if (list == NULL) {
-		Tcl_SetResult(interp, "DLSH: unable to create a new list",
-			TCL_STATIC);
-		return(NULL);
-	}
-	dfuAddDynListFloat(list, (float) obj->internalRep.doubleValue);
+	if (result->owner) remove_result(result->owner, result);
+	result->dl = NULL;
 	return(list);
 }
 
 
-/* Convert a string value to a dynamic list */
-
-static DYN_LIST * StringToDynList(Tcl_Interp * interp, Tcl_Obj * obj)
+static void decr_result(DL_RESULT * result)
 {
-	DYN_LIST * list = dfuCreateDynList(DF_STRING, 1);
+	if (--result->refCount > 0) return;
+	if (result->dl) dfuFreeDynList(take_list(result));
+	Tcl_Free((char *) result);
+}
 
-	if (list == NULL) {
-		Tcl_SetResult(interp, "DLSH: unable to create a new list",
-			TCL_STATIC);
-		return(NULL);
+
+/* %list#% to #, or -1 for any other name */
+
+static int name_to_id(const char * name)
+{
+	int id = 0;
+
+	if (strncmp(name, "%list", 5)) return(-1);
+	name += 5;
+	if (*name < '0' || *name > '9') return(-1);
+	for (; *name >= '0' && *name <= '9'; name++) {
+		if (id > (INT_MAX - 9) / 10) return(-1);
+		id = id * 10 + (*name - '0');
 	}
-	dfuAddDynListString(list, Tcl_GetStringFromObj(obj, NULL));
-	return(list);
+	return((name[0] == '%' && !name[1]) ? id : -1);
 }
 
 
-/*
- * Convert a list value to a dynamic list.  This case is more complex than
- * the previous cases, since dynlists are less flexible than Tcl lists -
- * they can only contain one data type, so in some cases, we will have to
- * retype members, or put them into sublists.
- */
+static DL_RESULT * find_result(DL_RESULTS * results, const char * name)
+{
+	DL_RESULT ** slot;
+	int id = name_to_id(name);
 
-typedef enum { longv, floatv, stringv, listv } objtype;
+	if (id < 0 || !(slot = find_slot(results, id))) return(NULL);
+	return(*slot);
+}
 
-static objtype get_list_type(int objc, Tcl_Obj * objv[]);
-static DYN_LIST * create_long_list(Tcl_Interp * interp, int objc,
-	Tcl_Obj * objv[]);
-static DYN_LIST * create_float_list(Tcl_Interp * interp, int objc,
-	Tcl_Obj * objv[]);
-static DYN_LIST * create_string_list(Tcl_Interp * interp, int objc,
-	Tcl_Obj * objv[]);
-static DYN_LIST * create_list_list(Tcl_Interp * interp, int objc,
-	Tcl_Obj * objv[]);
 
-/* the main part of the conversion function */
+/* The %list#% name of a result */
 
-static DYN_LIST * ListToDynList(Tcl_Interp * interp, Tcl_Obj * obj)
+static void update_string_proc(Tcl_Obj * obj)
 {
-  int objc;
-  Tcl_Obj ** objv;
-  
-  dlErrorString[0] = 0;
-  if (Tcl_ListObjGetElements(interp, obj, & objc, & objv) != TCL_OK)
-    return(NULL);
-  switch (get_list_type(objc, objv)) {
-  case longv:
-    return(create_long_list(interp, objc, objv));
-  case floatv:
-    return(create_float_list(interp, objc, objv));
-  case stringv:
-    return(create_string_list(interp, objc, objv));
-  default:
-    break;
-  }
-  return(create_list_list(interp, objc, objv));
+	DL_RESULT * result = obj->internalRep.otherValuePtr;
+	char name[32];
+
+	snprintf(name, sizeof(name), "%%list%d%%", result->id);
+	obj->length = strlen(name);
+	obj->bytes = Tcl_Alloc(obj->length + 1);
+	strcpy(obj->bytes, name);
 }
 
 
-/*
- * Determines the type which the dynlist-to-be will have, based on the
- * elements to go in it.  The catch is that all elements must be of the same
- * type, so the Tcl list contains five ints and a string, the dynlist must be
- * of type string.
- */
+static void free_int_rep_proc(Tcl_Obj * obj)
+{
+	decr_result(obj->internalRep.otherValuePtr);
+	obj->typePtr = NULL;
+}
+
 
-objtype get_list_type(int objc, Tcl_Obj * objv[])
+static void dup_int_rep_proc(Tcl_Obj * src, Tcl_Obj * dst)
 {
-	int i;
-	objtype type = longv;
-
-	for (i = 0; i < objc; i++) {
-		if (objv[i]->typePtr == type_double
-			&& type < floatv) type = floatv;
-		if (objv[i]->typePtr == type_list
-			&& type < listv) type = listv;
-		if (objv[i]->typePtr != type_int && objv[i]->typePtr
-			!= type_bool && type < stringv) type = stringv;
-	}
-	return(type);
+	DL_RESULT * result = src->internalRep.otherValuePtr;
+
+	result->refCount++;
+	dst->internalRep.otherValuePtr = result;
+	dst->typePtr = & tclDynListType;
 }
 
 
-/* Makes a dynlist of type long from the array of objects passed */
+/* A holder shows the names of the lists it still keeps */
 
-DYN_LIST * create_long_list(Tcl_Interp * interp, int objc, Tcl_Obj * objv[])
+static void update_temps_string(Tcl_Obj * obj)
 {
+	DL_TEMPS * temps = obj->internalRep.otherValuePtr;
+	Tcl_DString str;
+	char name[32];
 	int i;
-	DYN_LIST * list = dfuCreateDynList(DF_LONG, objc);
 
-	if (list == NULL) {
-		Tcl_SetResult(interp, dlErrorString[0] ? dlErrorString :
-			"DLSH: unable to create new list", TCL_STATIC);
-		return(NULL);
+	Tcl_DStringInit(& str);
+	for (i = 0; i < temps->n; i++) {
+		if (!temps->results[i]->dl) continue;
+		snprintf(name, sizeof(name), "%%list%d%%",
+			temps->results[i]->id);
+		Tcl_DStringAppendElement(& str, name);
 	}
-	for (i = 0; i < objc; i++)
-		dfuAddDynListLong(list,
-			objv[i]->internalRep.longValue);
-	return(list);
+	obj->length = Tcl_DStringLength(& str);
+	obj->bytes = Tcl_Alloc(obj->length + 1);
+	memcpy(obj->bytes, Tcl_DStringValue(& str), obj->length + 1);
+	Tcl_DStringFree(& str);
 }
 
 
-/* Makes a dynlist of type float from the array of objects passed */
+static DL_TEMPS * new_temps(int max)
+{
+	DL_TEMPS * temps = (DL_TEMPS *) Tcl_Alloc(sizeof(DL_TEMPS));
 
-DYN_LIST * create_float_list(Tcl_Interp * interp, int objc, Tcl_Obj * objv[])
+	temps->n = 0;
+	temps->max = max;
+	temps->results = (DL_RESULT **) Tcl_Alloc(max * sizeof(DL_RESULT *));
+	return(temps);
+}
+
+
+static void free_temps_rep(Tcl_Obj * obj)
 {
+	DL_TEMPS * temps = obj->internalRep.otherValuePtr;
 	int i;
-	DYN_LIST * list = dfuCreateDynList(DF_FLOAT, objc);
 
-	if (list == NULL) {
-		Tcl_SetResult(interp, dlErrorString[0] ? dlErrorString :
-			"DLSH: unable to create new list", TCL_STATIC);
-		return(NULL);
-	}
-	for (i = 0; i < objc; i++)
-		if (objv[i]->typePtr == type_int)
-			dfuAddDynListFloat(list,
-				objv[i]->internalRep.longValue);
-		else dfuAddDynListFloat(list,
-			objv[i]->internalRep.doubleValue);
-	return(list);
+	for (i = 0; i < temps->n; i++) decr_result(temps->results[i]);
+	Tcl_Free((char *) temps->results);
+	Tcl_Free((char *) temps);
+	obj->typePtr = NULL;
 }
 
 
-/* Makes a dynlist of type string from the array of objects passed */
-
-DYN_LIST * create_string_list(Tcl_Interp * interp, int objc, Tcl_Obj * objv[])
+static void dup_temps_rep(Tcl_Obj * src, Tcl_Obj * dst)
 {
+	DL_TEMPS * from = src->internalRep.otherValuePtr, * to;
 	int i;
-	DYN_LIST * list = dfuCreateDynList(DF_STRING, 1);
 
-	if (list == NULL) {
-		Tcl_SetResult(interp, dlErrorString[0] ? dlErrorString :
-			"DLSH: unable to create new list", TCL_STATIC);
-		return(NULL);
+	to = new_temps(from->max);
+	for (i = 0; i < from->n; i++) {
+		to->results[i] = from->results[i];
+		to->results[i]->refCount++;
 	}
-	for (i = 0; i < objc; i++)
-		dfuAddDynListString(list,
-			Tcl_GetStringFromObj(objv[i], NULL));
-	return(list);
+	to->n = from->n;
+	dst->internalRep.otherValuePtr = to;
+	dst->typePtr = & tclDynTempsType;
 }
 
 
-/* Makes a dynlist of type list from the array of objects passed */
+/*
+ * Make room for one more result, first letting go of any that have
+ * already been deleted or renamed
+ */
 
-DYN_LIST * create_list_list(Tcl_Interp * interp, int objc, Tcl_Obj * objv[])
+static void grow_temps(DL_TEMPS * temps)
 {
-	int i;
-	DYN_LIST * addlist, * list = dfuCreateDynList(DF_LIST, 1);
+	int i, n = 0;
 
-	if (list == NULL) {
-		Tcl_SetResult(interp, dlErrorString[0] ? dlErrorString :
-			"DLSH: unable to create new list", TCL_STATIC);
-		return(NULL);
+	for (i = 0; i < temps->n; i++) {
+		if (temps->results[i]->dl) temps->results[n++] = temps->results[i];
+		else decr_result(temps->results[i]);
 	}
-	for (i = 0; i < objc; i++) {
-		addlist = ObjToDynList(interp, objv[i]);
-		if (addlist) {
-			dfuAddDynListList(list, addlist);
-			dfuFreeDynList(addlist);
-		} else
-			dfuFreeDynList(list);
+	temps->n = n;
+	if (n < temps->max / 2) return;
+	temps->max *= 2;
+	temps->results = (DL_RESULT **) Tcl_Realloc((char *) temps->results,
+		temps->max * sizeof(DL_RESULT *));
+}
+
+
+extern void dlResultsInit(DL_RESULTS * results, Tcl_Interp * interp)
+{
+	results->size = DL_RESULTS_START;
+	results->n = results->used = 0;
+	results->slots = (DL_RESULT **)
+		Tcl_Alloc(results->size * sizeof(DL_RESULT *));
+	memset(results->slots, 0, results->size * sizeof(DL_RESULT *));
+	results->interp = interp;
+	results->holder = Tcl_NewStringObj("%dltemps%", -1);
+	Tcl_IncrRefCount(results->holder);
+}
+
+
+/*
+ * Make an object owning list under the name %list<id>%.  The object
+ * holds the only reference; returns NULL if the name is still in use.
+ */
+
+extern Tcl_Obj * dlResultNewObj(DL_RESULTS * results, DYN_LIST * list,
+	int id)
+{
+	DL_RESULT * result;
+	Tcl_Obj * obj;
+	unsigned int i, mask;
+
+	if (find_slot(results, id)) return(NULL);
+	if (2 * (results->used + 1) > results->size) rebuild_table(results);
+
+	/* the first empty slot or tombstone from id's own */
+	mask = results->size - 1;
+	for (i = (unsigned int) id & mask; results->slots[i]
+		&& results->slots[i] != DL_TOMBSTONE; i = (i + 1) & mask);
+	if (!results->slots[i]) results->used++;
+
+	result = (DL_RESULT *) Tcl_Alloc(sizeof(DL_RESULT));
+	result->refCount = 1;
+	result->id = id;
+	result->dl = list;
+	result->owner = results;
+	results->slots[i] = result;
+	results->n++;
+
+	obj = Tcl_NewObj();
+	Tcl_InvalidateStringRep(obj);
+	obj->internalRep.otherValuePtr = result;
+	obj->typePtr = & tclDynListType;
+	return(obj);
+}
+
+
+/* Add a reference from the current frame's holder to a result object */
+
+extern int dlResultHold(Tcl_Interp * interp, DL_RESULTS * results,
+	Tcl_Obj * obj)
+{
+	Tcl_Obj * holder;
+	DL_TEMPS * temps;
+	DL_RESULT * result = obj->internalRep.otherValuePtr;
+
+	if (obj->typePtr != & tclDynListType) return(TCL_ERROR);
+
+	holder = Tcl_ObjGetVar2(interp, results->holder, NULL, 0);
+	if (!holder || holder->typePtr != & tclDynTempsType
+		|| Tcl_IsShared(holder)) {
+		if (holder && holder->typePtr == & tclDynTempsType)
+			holder = Tcl_DuplicateObj(holder);
+		else {
+			holder = Tcl_NewObj();
+			holder->internalRep.otherValuePtr =
+				new_temps(DL_TEMPS_START);
+			holder->typePtr = & tclDynTempsType;
+		}
+		Tcl_InvalidateStringRep(holder);
+		holder = Tcl_ObjSetVar2(interp, results->holder, NULL, holder,
+			0);
+		if (!holder || holder->typePtr != & tclDynTempsType
+			|| Tcl_IsShared(holder))
+			return(TCL_ERROR);
 	}
-	return(list) ;
+
+	temps = holder->internalRep.otherValuePtr;
+	if (temps->n == temps->max) grow_temps(temps);
+	temps->results[temps->n++] = result;
+	result->refCount++;
+	Tcl_InvalidateStringRep(holder);
+	return(TCL_OK);
 }
 
 
-/* Convert a dynamic list to a string */
+extern DYN_LIST * dlResultFind(DL_RESULTS * results, const char * name)
+{
+	DL_RESULT * result = find_result(results, name);
 
-static void update_string_proc(Tcl_Obj * obj)
+	return(result ? result->dl : NULL);
+}
+
+
+/*
+ * Take list away from its result so it can be renamed.  Returns 0 if
+ * list is not a live result.
+ */
+
+extern int dlResultRelease(DL_RESULTS * results, DYN_LIST * list)
 {
-	char * bytes;
-	DYN_LIST * list = obj->internalRep.otherValuePtr;
+	DL_RESULT * result = find_result(results, DYN_LIST_NAME(list));
 
-	if (DYN_LIST_NAME(list)[0] == 0)
-		if (tclDynListTempName(list, & bytes) != TCL_OK) return;
-	obj->length = strlen(bytes);
-	obj->bytes = Tcl_Alloc(obj->length + 1);
-	strcpy(obj->bytes, bytes);
+	if (!result || result->dl != list) return(0);
+	take_list(result);
+	return(1);
 }
 
 
-/* Delete any dynlists without a hash entry, or temporary lists */
+/* Free a result's list now (objects still holding it see it as gone) */
 
-static void free_int_rep_proc(Tcl_Obj * obj)
+extern int dlResultDelete(DL_RESULTS * results, const char * name)
+{
+	DL_RESULT * result = find_result(results, name);
+
+	if (!result) return(0);
+	dfuFreeDynList(take_list(result));
+	return(1);
+}
+
+
+extern void dlResultDeleteAll(DL_RESULTS * results)
 {
-	DYN_LIST * list = obj->internalRep.otherValuePtr;
-
-	if (DYN_LIST_FLAGS(list) & DL_SUBLIST) return;	/* Don't try to free
-								sublists */
-	if (DYN_LIST_NAME(list)[0] == 0)
-							/* no hash entry */
-		dfuFreeDynList(list);
-	else if (DYN_LIST_NAME(list)[0] == '%'
-		|| DYN_LIST_NAME(list)[0] == '>') {
-	/* Ah well... */
-		char * argv[2] = {0};
-
-		argv[1] = DYN_LIST_NAME(list);
-		dlErrorString[0] = 0;
-		if (tclDeleteDynList(NULL, NULL, 2, argv) != TCL_OK
-			&& dlErrorString[0]) fprintf(stderr, dlErrorString);
+	DL_RESULT * result;
+	int i;
+
+	for (i = 0; i < results->size; i++) {
+		result = results->slots[i];
+		results->slots[i] = NULL;
+		if (!result || result == DL_TOMBSTONE) continue;
+		result->owner = NULL;
+		dfuFreeDynList(result->dl);
+		result->dl = NULL;
 	}
+	results->n = results->used = 0;
 }
 
 
-/* Duplicate an internal representation */
+/* Cached lookups */
 
-static void dup_int_rep_proc(Tcl_Obj * src, Tcl_Obj * dst)
+static void free_ref_rep(Tcl_Obj * obj)
+{
+	Tcl_Free((char *) obj->internalRep.otherValuePtr);
+	obj->typePtr = NULL;
+}
+
+
+static void dup_ref_rep(Tcl_Obj * src, Tcl_Obj * dst)
+{
+	DL_REF * ref = (DL_REF *) Tcl_Alloc(sizeof(DL_REF));
+
+	*ref = * (DL_REF *) src->internalRep.otherValuePtr;
+	dst->internalRep.otherValuePtr = ref;
+	dst->typePtr = & tclDynRefType;
+}
+
+
+/* The ref obj holds for interp, or NULL if it has to be looked up again */
+
+static DL_REF * valid_ref(Tcl_Interp * interp, Tcl_Obj * obj)
 {
-	dst->internalRep.otherValuePtr = src->internalRep.otherValuePtr;
+	DL_REF * ref = obj->internalRep.otherValuePtr;
+	DYN_GROUP * dg;
+
+	if (obj->typePtr != & tclDynRefType || ref->interp != interp)
+		return(NULL);
+	dg = ref->dg;
+	if (!ref->dl) {
+		return((ref->generation == ref->info->groupGeneration) ?
+			ref : NULL);
+	}
+	if (!dg) {
+		return((ref->generation == ref->info->listGeneration) ?
+			ref : NULL);
+	}
+	if (ref->generation != ref->info->groupGeneration
+		|| ref->index >= DYN_GROUP_N(dg)
+		|| DYN_GROUP_LIST(dg, ref->index) != ref->dl
+		|| strcmp(DYN_LIST_NAME(ref->dl), obj->bytes + ref->offset))
+		return(NULL);
+	return(ref);
 }
 
 
-/* And register the whole shooting match */
+/* Make obj (whose string is current) a ref, reusing a stale one's rep */
 
-extern int register_dl_obj(void)
+static DL_REF * store_ref(Tcl_Interp * interp, DLSHINFO * info,
+	Tcl_Obj * obj)
 {
-	Tcl_RegisterObjType(& tclDynListType);
-	type_int = Tcl_GetObjType("int");
-	type_bool = Tcl_GetObjType("boolean");
-	type_double = Tcl_GetObjType("double");
-	type_list = Tcl_GetObjType("list");
-	type_str = Tcl_GetObjType("string");
-	return(TCL_OK);
+	DL_REF * ref;
+
+	if (obj->typePtr == & tclDynRefType)
+		ref = obj->internalRep.otherValuePtr;
+	else {
+		if (obj->typePtr && obj->typePtr->freeIntRepProc)
+			obj->typePtr->freeIntRepProc(obj);
+		ref = (DL_REF *) Tcl_Alloc(sizeof(DL_REF));
+		obj->internalRep.otherValuePtr = ref;
+		obj->typePtr = & tclDynRefType;
+	}
+	ref->interp = interp;
+	ref->info = info;
+	ref->dg = NULL;
+	ref->dl = NULL;
+	ref->index = ref->offset = 0;
+	return(ref);
 }
 
-extern void Tcl_SetDynListObj(Tcl_Obj * obj, DYN_LIST * list)
+
+/*
+ * Look up a plain name in the dlTable or a group:list in the dgTable,
+ * caching what is found.  Returns 0, caching nothing, for any other kind
+ * of name (temps, Tcl lists, sublists of lists) so the caller can hand
+ * it to tclFindDynList.
+ */
+
+static int lookup_ref(Tcl_Interp * interp, DLSHINFO * info, Tcl_Obj * obj,
+	DYN_LIST ** dlPtr)
 {
-	Tcl_ObjType * oldtype = obj->typePtr;
+	Tcl_HashEntry * entryPtr;
+	DYN_GROUP * dg;
+	DYN_LIST * dl;
+	DL_REF * ref;
+	char groupname[128], * name, * colon;
+	int id;
+
+	name = Tcl_GetString(obj);
+	if (name[0] == '%') return(0);
+
+	if ((entryPtr = Tcl_FindHashEntry(&info->dlTable, name))) {
+		if (!(dl = Tcl_GetHashValue(entryPtr))) return(0);
+		ref = store_ref(interp, info, obj);
+		ref->generation = info->listGeneration;
+		ref->dl = dl;
+		DYN_LIST_FLAGS(dl) &= ~DL_SUBLIST;
+		*dlPtr = dl;
+		return(1);
+	}
 
-	if (Tcl_IsShared(obj)) fprintf(stderr,
-		"Tcl_SetDynListObj: warning - modifying a shared object\n");
-	Tcl_InvalidateStringRep(obj);
-	if (oldtype && oldtype->freeIntRepProc)
-		oldtype->freeIntRepProc(obj);
-	obj->internalRep.otherValuePtr = list;
-	obj->typePtr = & tclDynListType;
+	if (!(colon = strchr(name, ':')) || strchr(colon + 1, ':')
+		|| colon - name >= (int) sizeof(groupname))
+		return(0);
+	strncpy(groupname, name, colon - name);
+	groupname[colon - name] = 0;
+	if (!(entryPtr = Tcl_FindHashEntry(&info->dgTable, groupname))
+		|| !(dg = Tcl_GetHashValue(entryPtr))
+		|| (id = dynGroupFindListID(dg, colon + 1)) < 0)
+		return(0);
+
+	dl = DYN_GROUP_LIST(dg, id);
+	ref = store_ref(interp, info, obj);
+	ref->generation = info->groupGeneration;
+	ref->dg = dg;
+	ref->dl = dl;
+	ref->index = id;
+	ref->offset = colon + 1 - name;
+	DYN_LIST_FLAGS(dl) |= DL_SUBLIST;
+	*dlPtr = dl;
+	return(1);
 }
 
 
-/* convert an object to a dynlist */
+/*
+ * Get the list an object refers to: a result object straight from its
+ * internal rep, a name looked up before from its cached ref, anything
+ * else by name.
+ */
 
 extern int Tcl_GetDynListFromObj(Tcl_Interp * interp, Tcl_Obj * objPtr,
 	DYN_LIST ** dlPtr)
 {
-	if (Tcl_ConvertToType(interp, objPtr, & tclDynListType) != TCL_OK)
-		return(TCL_ERROR);
-	*dlPtr = objPtr->internalRep.otherValuePtr;
-	return(TCL_OK);
+	DL_RESULT * result;
+	DL_REF * ref;
+	DLSHINFO * info;
+
+	if (objPtr->typePtr == & tclDynListType) {
+		result = objPtr->internalRep.otherValuePtr;
+		if (result->dl && result->owner
+			&& result->owner->interp == interp) {
+			*dlPtr = result->dl;
+			DYN_LIST_FLAGS(*dlPtr) &= ~DL_SUBLIST;
+			return(TCL_OK);
+		}
+	}
+	else if (objPtr->typePtr == & tclDynRefType) {
+		if ((ref = valid_ref(interp, objPtr)) && ref->dl) {
+			*dlPtr = ref->dl;
+			if (ref->dg) DYN_LIST_FLAGS(*dlPtr) |= DL_SUBLIST;
+			else DYN_LIST_FLAGS(*dlPtr) &= ~DL_SUBLIST;
+			return(TCL_OK);
+		}
+	}
+
+	if ((info = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL))
+		&& lookup_ref(interp, info, objPtr, dlPtr))
+		return(TCL_OK);
+	return(tclFindDynList(interp, Tcl_GetString(objPtr), dlPtr));
+}
+
+
+/* As Tcl_GetDynListFromObj, for a group name */
+
+extern int Tcl_GetDynGroupFromObj(Tcl_Interp * interp, Tcl_Obj * objPtr,
+	DYN_GROUP ** dgPtr)
+{
+	Tcl_HashEntry * entryPtr;
+	DL_REF * ref;
+	DLSHINFO * info;
+	DYN_GROUP * dg;
+
+	if (objPtr->typePtr == & tclDynRefType
+		&& (ref = valid_ref(interp, objPtr)) && !ref->dl) {
+		*dgPtr = ref->dg;
+		return(TCL_OK);
+	}
+
+	if ((info = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL))
+		&& (entryPtr = Tcl_FindHashEntry(&info->dgTable,
+			Tcl_GetString(objPtr)))
+		&& (dg = Tcl_GetHashValue(entryPtr))) {
+		ref = store_ref(interp, info, objPtr);
+		ref->generation = info->groupGeneration;
+		ref->dg = dg;
+		*dgPtr = dg;
+		return(TCL_OK);
+	}
+	return(tclFindDynGroup(interp, Tcl_GetString(objPtr), dgPtr));
 }
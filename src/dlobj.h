@@ -17,17 +17,22 @@
 
 /* from dlobj.c */
 
-extern int register_dl_obj(void) ;
-extern void Tcl_SetDynListObj(Tcl_Obj * obj, DYN_LIST * list) ;
+extern void dlResultsInit(DL_RESULTS * results, Tcl_Interp * interp) ;
+extern Tcl_Obj * dlResultNewObj(DL_RESULTS * results, DYN_LIST * list,
+	int id) ;
+extern int dlResultHold(Tcl_Interp * interp, DL_RESULTS * results,
+	Tcl_Obj * obj) ;
+extern DYN_LIST * dlResultFind(DL_RESULTS * results, const char * name) ;
+extern int dlResultRelease(DL_RESULTS * results, DYN_LIST * list) ;
+extern int dlResultDelete(DL_RESULTS * results, const char * name) ;
+extern void dlResultDeleteAll(DL_RESULTS * results) ;
 extern int Tcl_GetDynListFromObj(Tcl_Interp * interp, Tcl_Obj * objPtr,
 	DYN_LIST ** dlPtr) ;
+extern int Tcl_GetDynGroupFromObj(Tcl_Interp * interp, Tcl_Obj * objPtr,
+	DYN_GROUP ** dgPtr) ;
 
 /* from tcl_dl.c */
 
-extern char dlErrorString[] ;
 DLLEXP int tclFindDynList(Tcl_Interp *interp, char *name, DYN_LIST **dl) ;
-extern int tclDynListTempName(DYN_LIST *dl, char ** result) ;
-extern int tclDeleteDynList (ClientData data, Tcl_Interp *interp,
-	int argc, char *argv[]) ;
 
 #endif /* defined(__dlobj_h__) */
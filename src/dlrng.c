@@ -0,0 +1,417 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlrng.c
+ *
+ *  DESCRIPTION
+ *    Counter based generator behind the dl_ and dm_ random functions.
+ *  The Philox4x32-10 block function turns a key (the seed) and a four
+ *  word counter into four random words:
+ *
+ *    counter 0   index (low word)
+ *    counter 1   index (high word) + attempt << 16
+ *    counter 2,3 stream
+ *
+ *  Uniform floats and bounded ints take one word each (four per
+ *  block) and normals a third of a block, so element i of a fill
+ *  depends on nothing but i; fills are shared out with dlParallelFor
+ *  in any chunks, and the blocks themselves are made several at a time
+ *  by dlSimdPhilox.  Normals use the 128 layer ziggurat (Marsaglia and
+ *  Tsang, in Doornik's ZIGNOR form); the rare draws that miss the
+ *  rectangles continue in blocks of their own (see rngNormalSlow).
+ *
+ *  Permutations and samples without replacement are serial (Fisher-
+ *  Yates, and Floyd's algorithm with a hash set), but each step draws
+ *  from its own index, so they need no state beyond the stream.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "df.h"
+#include "dlrng.h"
+#include "dlsimd.h"
+#include "dlthread.h"
+
+#ifdef _MSC_VER
+#define DL_RNG_TLS __declspec(thread)
+#else
+#define DL_RNG_TLS __thread
+#endif
+
+#define DL_RNG_DEFAULT_SEED 0x5eed5eedULL
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+#define DL_RNG_CHUNK   64	/* blocks made at a time                */
+#define DL_RNG_NORMALS  3	/* normals per block                    */
+
+#define ZIG_LAYERS 128
+#define ZIG_R      3.442619855899
+#define ZIG_V      9.91256303526217e-3
+
+/* each thread's generator */
+typedef struct {
+  int seeded;
+  uint64_t seed;
+  uint64_t next;		/* stream for the next call             */
+} DL_RNG_STATE;
+
+static DL_RNG_TLS DL_RNG_STATE RngState;
+static volatile long RngThreads = 0;	/* threads started unseeded     */
+
+static double ZigX[ZIG_LAYERS+1];	/* layer edges                  */
+static double ZigRatio[ZIG_LAYERS];	/* ZigX[i+1]/ZigX[i]            */
+static DL_ONCE ZigOnce = DL_ONCE_INIT;
+
+typedef struct {
+  const DL_RNG *rng;
+  uint32_t max;
+  float *fout;
+  int *iout;
+} DL_RNG_JOB;
+
+/*
+ * Philox4x32-10: ten rounds of two 32 x 32 -> 64 bit products, the
+ * key bumped by the Weyl constants between rounds
+ */
+
+static void rngBlock(const DL_RNG *rng, uint64_t index, uint32_t attempt,
+		     uint32_t out[4])
+{
+  uint32_t c0 = (uint32_t) index;
+  uint32_t c1 = (uint32_t) (index >> 32) + (attempt << 16);
+  uint32_t c2 = rng->stream[0], c3 = rng->stream[1];
+  uint32_t k0 = rng->key[0], k1 = rng->key[1];
+  uint64_t p0, p1;
+  int r;
+
+  for (r = 0; r < 10; r++) {
+    p0 = (uint64_t) PHILOX_M0 * c0;
+    p1 = (uint64_t) PHILOX_M1 * c2;
+    c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+    c1 = (uint32_t) p1;
+    c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+    c3 = (uint32_t) p0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+/* floor(r * max / 2^64) for the 64 bit r in w[0] (high) and w[1] */
+static uint32_t rngBelow(const uint32_t *w, uint32_t max)
+{
+  uint64_t lo = (uint64_t) w[1] * max;
+  uint64_t hi = (uint64_t) w[0] * max + (lo >> 32);
+  return (uint32_t) (hi >> 32);
+}
+
+/* uniform in (0,1), for logs */
+static double rngOpen(uint32_t w)
+{
+  return (w + 0.5) * (1.0 / 4294967296.0);
+}
+
+/*****************************************************************************
+ *
+ * Per thread state
+ *
+ *****************************************************************************/
+
+static void rngThreadInit(void)
+{
+  long n;
+#ifdef _MSC_VER
+  n = _InterlockedIncrement(&RngThreads) - 1;
+#else
+  n = __sync_fetch_and_add(&RngThreads, 1);
+#endif
+  RngState.seeded = 1;
+  RngState.seed = DL_RNG_DEFAULT_SEED;
+  RngState.next = (uint64_t) n << 32;
+}
+
+/* the ziggurat tables, built once (see ZigOnce) */
+static void rngZigInit(void)
+{
+  double f;
+  int i;
+
+  f = exp(-0.5 * ZIG_R * ZIG_R);
+  ZigX[0] = ZIG_V / f;
+  ZigX[1] = ZIG_R;
+  ZigX[ZIG_LAYERS] = 0.0;
+  for (i = 2; i < ZIG_LAYERS; i++) {
+    ZigX[i] = sqrt(-2.0 * log(ZIG_V / ZigX[i-1] + f));
+    f = exp(-0.5 * ZigX[i] * ZigX[i]);
+  }
+  for (i = 0; i < ZIG_LAYERS; i++) ZigRatio[i] = ZigX[i+1] / ZigX[i];
+}
+
+void dlRngSeed(uint64_t seed, uint64_t stream)
+{
+  dlOnce(&ZigOnce, rngZigInit);
+  RngState.seeded = 1;
+  RngState.seed = seed;
+  RngState.next = stream << 32;
+}
+
+uint64_t dlRngGetSeed(void)
+{
+  if (!RngState.seeded) rngThreadInit();
+  return RngState.seed;
+}
+
+void dlRngNext(DL_RNG *rng)
+{
+  uint64_t stream;
+  if (!RngState.seeded) rngThreadInit();
+  stream = RngState.next++;
+  rng->key[0] = (uint32_t) RngState.seed;
+  rng->key[1] = (uint32_t) (RngState.seed >> 32);
+  rng->stream[0] = (uint32_t) stream;
+  rng->stream[1] = (uint32_t) (stream >> 32);
+}
+
+/*****************************************************************************
+ *
+ * Bulk fills
+ *
+ *****************************************************************************/
+
+/* blocks first .. first+n-1, by the vector kernel where there is one */
+static void rngBlocks(const DL_RNG *rng, DL_SIZE first, uint32_t attempt,
+		      DL_SIZE n, uint32_t *out)
+{
+  DL_SIZE i = dlSimdPhilox(rng->key, rng->stream, first, attempt, n, out);
+  for (; i < n; i++)
+    rngBlock(rng, (uint64_t) (first + i), attempt, out + 4*i);
+}
+
+/* element e is word e: block e/4, word e%4 */
+static void rngUniformRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_RNG_JOB *job = (DL_RNG_JOB *) cd;
+  uint32_t w[4*DL_RNG_CHUNK];
+  DL_SIZE b0, nb, e;
+
+  for (b0 = start / 4; b0 * 4 < stop; b0 += nb) {
+    nb = (stop + 3) / 4 - b0;
+    if (nb > DL_RNG_CHUNK) nb = DL_RNG_CHUNK;
+    rngBlocks(job->rng, b0, 0, nb, w);
+    for (e = b0 * 4 < start ? start : b0 * 4; e < stop && e < (b0 + nb) * 4;
+	 e++)
+      job->fout[e] = (w[e - b0*4] >> 8) * (1.0f / 16777216.0f);
+  }
+}
+
+/*
+ * Lemire's multiply and shift, one word per element; the rare words
+ * that would bias it (a fraction max/2^32) are replaced by a 64 bit
+ * draw from block (e, 1)
+ */
+static void rngIntsRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_RNG_JOB *job = (DL_RNG_JOB *) cd;
+  uint32_t w[4*DL_RNG_CHUNK], extra[4];
+  uint32_t max = job->max, thresh = (0u - max) % max;
+  uint64_t m;
+  DL_SIZE b0, nb, e;
+
+  for (b0 = start / 4; b0 * 4 < stop; b0 += nb) {
+    nb = (stop + 3) / 4 - b0;
+    if (nb > DL_RNG_CHUNK) nb = DL_RNG_CHUNK;
+    rngBlocks(job->rng, b0, 0, nb, w);
+    for (e = b0 * 4 < start ? start : b0 * 4; e < stop && e < (b0 + nb) * 4;
+	 e++) {
+      m = (uint64_t) w[e - b0*4] * max;
+      if ((uint32_t) m < thresh) {
+	rngBlock(job->rng, (uint64_t) e, 1, extra);
+	job->iout[e] = (int) rngBelow(extra, max);
+      }
+      else job->iout[e] = (int) (m >> 32);
+    }
+  }
+}
+
+/*
+ * The ziggurat's wedges and tail, for lane h of block b once (layer,
+ * u) has missed its rectangle.  Further uniforms come from blocks
+ * (b, h+1), (b, h+4), (b, h+7) ..., so the three lanes never share.
+ */
+static float rngNormalSlow(const DL_RNG *rng, uint64_t b, int h, int layer,
+			   double u)
+{
+  uint32_t w[4];
+  uint32_t attempt = h + 1;
+  double x, y, f0, f1;
+  int k;
+
+  for (;;) {
+    rngBlock(rng, b, attempt, w);
+    attempt += DL_RNG_NORMALS;
+
+    if (layer == 0) {
+      /* the tail beyond ZIG_R, from pairs of uniforms */
+      for (k = 0; ; k += 2) {
+	if (k == 4) {
+	  rngBlock(rng, b, attempt, w);
+	  attempt += DL_RNG_NORMALS;
+	  k = 0;
+	}
+	x = log(rngOpen(w[k])) / ZIG_R;
+	y = log(rngOpen(w[k+1]));
+	if (-2.0 * y >= x * x) return (float) (u < 0 ? x - ZIG_R : ZIG_R - x);
+      }
+    }
+
+    /* the wedge between the layer's rectangle and the curve */
+    x = u * ZigX[layer];
+    f0 = exp(-0.5 * (ZigX[layer] * ZigX[layer] - x * x));
+    f1 = exp(-0.5 * (ZigX[layer+1] * ZigX[layer+1] - x * x));
+    if (f1 + rngOpen(w[2]) * (f0 - f1) < 1.0) return (float) x;
+
+    /* rejected: start again */
+    layer = w[0] & (ZIG_LAYERS-1);
+    u = ((int32_t) w[1] + 0.5) * (1.0 / 2147483648.0);
+    if (fabs(u) < ZigRatio[layer]) return (float) (u * ZigX[layer]);
+  }
+}
+
+/*
+ * Three normals per block: lane h takes its layer from byte h of word
+ * 0 and its signed uniform from word h+1
+ */
+static void rngNormalRange(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_RNG_JOB *job = (DL_RNG_JOB *) cd;
+  uint32_t w[4*DL_RNG_CHUNK], *bw;
+  DL_SIZE b0, nb, b, e;
+  double u;
+  int h, layer;
+
+  for (b0 = start / DL_RNG_NORMALS; b0 * DL_RNG_NORMALS < stop; b0 += nb) {
+    nb = (stop + DL_RNG_NORMALS - 1) / DL_RNG_NORMALS - b0;
+    if (nb > DL_RNG_CHUNK) nb = DL_RNG_CHUNK;
+    rngBlocks(job->rng, b0, 0, nb, w);
+    for (b = 0; b < nb; b++) {
+      bw = w + 4*b;
+      for (h = 0; h < DL_RNG_NORMALS; h++) {
+	e = (b0 + b) * DL_RNG_NORMALS + h;
+	if (e < start) continue;
+	if (e >= stop) break;
+	layer = (bw[0] >> (8*h)) & (ZIG_LAYERS-1);
+	u = ((int32_t) bw[h+1] + 0.5) * (1.0 / 2147483648.0);
+	if (fabs(u) < ZigRatio[layer])
+	  job->fout[e] = (float) (u * ZigX[layer]);
+	else
+	  job->fout[e] = rngNormalSlow(job->rng, (uint64_t) (b0 + b), h,
+				       layer, u);
+      }
+    }
+  }
+}
+
+void dlRngUniform(const DL_RNG *rng, DL_SIZE n, float *out)
+{
+  DL_RNG_JOB job;
+  job.rng = rng;
+  job.fout = out;
+  dlParallelFor(n, n, rngUniformRange, &job);
+}
+
+void dlRngNormal(const DL_RNG *rng, DL_SIZE n, float *out)
+{
+  DL_RNG_JOB job;
+  dlOnce(&ZigOnce, rngZigInit);
+  job.rng = rng;
+  job.fout = out;
+  dlParallelFor(n, n * 4, rngNormalRange, &job);
+}
+
+void dlRngInts(const DL_RNG *rng, DL_SIZE n, uint32_t max, int *out)
+{
+  DL_RNG_JOB job;
+  if (!max) {
+    memset(out, 0, n * sizeof(int));
+    return;
+  }
+  job.rng = rng;
+  job.max = max;
+  job.iout = out;
+  dlParallelFor(n, n, rngIntsRange, &job);
+}
+
+/*****************************************************************************
+ *
+ * Permutations and samples
+ *
+ *****************************************************************************/
+
+/* shuffle out[0..n-1] in place, drawing from blocks (i/2, attempt) */
+static void rngShuffle(const DL_RNG *rng, uint32_t attempt, int n, int *out)
+{
+  uint32_t w[4];
+  int i, j, t;
+
+  for (i = n-1; i > 0; i--) {
+    if (i == n-1 || (i & 1)) rngBlock(rng, (uint64_t) (i >> 1), attempt, w);
+    j = (int) rngBelow(&w[2*(i & 1)], (uint32_t) i + 1);
+    t = out[i]; out[i] = out[j]; out[j] = t;
+  }
+}
+
+void dlRngPermutation(const DL_RNG *rng, int n, int *out)
+{
+  int i;
+  for (i = 0; i < n; i++) out[i] = i;
+  rngShuffle(rng, 0, n, out);
+}
+
+/*
+ * Floyd's algorithm: for j = m-n .. m-1 take t in [0,j], or j itself
+ * if t is already taken.  The set is an open addressed hash table of
+ * at least 2n slots; the n values are then shuffled, as they come out
+ * in a biased order.
+ */
+
+int dlRngChoose(const DL_RNG *rng, int m, int n, int *out)
+{
+  uint32_t w[4];
+  int *table, size, mask, shift, i, j, t, v, slot;
+
+  if (n <= 0) return 0;
+  if (n > m) return -1;
+
+  for (size = 16, shift = 28; size < 2 * n; size <<= 1, shift--);
+  if (!(table = (int *) malloc(size * sizeof(int)))) return -1;
+  memset(table, 0xff, size * sizeof(int));
+  mask = size - 1;
+
+  for (i = 0, j = m-n; j < m; i++, j++) {
+    if (i == 0 || !(i & 1)) rngBlock(rng, (uint64_t) (i >> 1), 0, w);
+    t = (int) rngBelow(&w[2*(i & 1)], (uint32_t) j + 1);
+    for (v = t; ; v = j) {
+      slot = (int) (((uint32_t) v * 2654435761u) >> shift) & mask;
+      while (table[slot] >= 0 && table[slot] != v) slot = (slot + 1) & mask;
+      if (table[slot] < 0) break;
+      /* t already taken: take j, which cannot be */
+    }
+    table[slot] = v;
+    out[i] = v;
+  }
+
+  free(table);
+  rngShuffle(rng, 1, n, out);
+  return 0;
+}
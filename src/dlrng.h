@@ -0,0 +1,55 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlrng.h
+ *
+ *  DESCRIPTION
+ *    Counter based random numbers for dl_urand, dl_zrand, dl_irand,
+ *  dl_randfill, dl_shuffle, dl_randchoose, dl_pickone and dm_urand /
+ *  dm_zrand.  Values come from the Philox4x32-10 function of a 64 bit
+ *  key (the seed) and a 128 bit counter holding a 64 bit stream and
+ *  the index of the element, so any element of any stream can be made
+ *  directly: bulk fills are split across threads and still give the
+ *  same values, and moving to another stream is a jump ahead.
+ *
+ *  Each thread has its own generator (seed and next stream).  Every
+ *  call takes a fresh stream with dlRngNext; dlRngSeed(seed, s) starts
+ *  the calling thread's streams at s << 32, so workers given the same
+ *  seed and different s never share values.
+ *
+ *    dlRngUniform      floats in [0,1)
+ *    dlRngNormal       standard normals (128 layer ziggurat)
+ *    dlRngInts         ints in [0,max), without modulo bias
+ *    dlRngPermutation  a random ordering of 0..n-1 (Fisher-Yates)
+ *    dlRngChoose       n distinct values of 0..m-1 in random order
+ *
+ ************************************************************************/
+
+#ifndef DLRNG_H
+#define DLRNG_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t key[2];		/* seed                                 */
+  uint32_t stream[2];		/* counter words 2 and 3                */
+} DL_RNG;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void dlRngSeed(uint64_t seed, uint64_t stream);
+uint64_t dlRngGetSeed(void);
+void dlRngNext(DL_RNG *rng);
+void dlRngUniform(const DL_RNG *rng, DL_SIZE n, float *out);
+void dlRngNormal(const DL_RNG *rng, DL_SIZE n, float *out);
+void dlRngInts(const DL_RNG *rng, DL_SIZE n, uint32_t max, int *out);
+void dlRngPermutation(const DL_RNG *rng, int n, int *out);
+int dlRngChoose(const DL_RNG *rng, int m, int n, int *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLRNG_H */
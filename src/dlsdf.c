@@ -0,0 +1,279 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlsdf.c
+ *
+ *  DESCRIPTION
+ *    Spike density functions: the spikes of a trial convolved with the
+ *  gaussian kernel of sdfMakeKernel.  A trial with few spikes adds the
+ *  whole kernel around each spike (clipped to the window once per
+ *  spike rather than tested tap by tap), which gives exactly the sums
+ *  sdfMakeSdf gives.  When the spikes times the kernel width outweigh
+ *  the window times its log, the spikes are binned and convolved with
+ *  the kernel by FFT instead; those values agree to float precision,
+ *  and points with no spike within reach of the kernel stay exactly 0.
+ *
+ *  Kernels are kept in a small cache, along with the transforms of
+ *  the kernel at the FFT sizes used.  Entries in use are never
+ *  evicted, so trials can be computed in parallel with one kernel.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "df.h"
+#include "dfana.h"
+#include "dlfft.h"
+#include "dlsdf.h"
+
+#if !defined(_WIN32)
+#define DL_SDF_PTHREAD 1
+#include <pthread.h>
+static pthread_mutex_t SdfMutex = PTHREAD_MUTEX_INITIALIZER;
+#define DL_SDF_LOCK()   pthread_mutex_lock(&SdfMutex)
+#define DL_SDF_UNLOCK() pthread_mutex_unlock(&SdfMutex)
+#else
+#define DL_SDF_LOCK()
+#define DL_SDF_UNLOCK()
+#endif
+
+#define DL_SDF_KCACHE   16	/* kernels kept                         */
+#define DL_SDF_SPECTRA   4	/* FFT sizes kept per kernel            */
+#define DL_SDF_FFT_COST  3	/* tap adds per FFT point and level     */
+
+struct DL_SDF_KERNEL {
+  float ksd, nsd;
+  int ksize;			/* taps from the centre out             */
+  float *taps;			/* 2*ksize-1 taps, centre at ksize-1    */
+  int refcount;
+  int cached;			/* held in SdfKernels                   */
+  unsigned long used;
+  int nffts[DL_SDF_SPECTRA];
+  double *spectra[DL_SDF_SPECTRA];
+};
+
+static DL_SDF_KERNEL *SdfKernels[DL_SDF_KCACHE];
+static unsigned long SdfClock = 0;
+
+static void dlSdfKernelFree(DL_SDF_KERNEL *k)
+{
+  int i;
+  for (i = 0; i < DL_SDF_SPECTRA; i++) if (k->spectra[i]) free(k->spectra[i]);
+  free(k->taps);
+  free(k);
+}
+
+static DL_SDF_KERNEL *dlSdfKernelMake(float ksd, float nsd)
+{
+  DL_SDF_KERNEL *k;
+  float *half;
+  int i, ks;
+
+  if (!(half = sdfMakeKernel(ksd, nsd, &ks))) return NULL;
+  if (!(k = (DL_SDF_KERNEL *) calloc(1, sizeof(DL_SDF_KERNEL))) ||
+      !(k->taps = (float *) malloc((2*ks-1)*sizeof(float)))) {
+    if (k) free(k);
+    free(half);
+    return NULL;
+  }
+  k->ksd = ksd;
+  k->nsd = nsd;
+  k->ksize = ks;
+  for (i = 0; i < ks; i++) k->taps[ks-1+i] = k->taps[ks-1-i] = half[i];
+  free(half);
+  return k;
+}
+
+/*
+ * dlSdfKernelGet - the kernel for ksd and nsd, from the cache when
+ * there.  Each kernel returned must be handed to dlSdfKernelRelease.
+ */
+
+DL_SDF_KERNEL *dlSdfKernelGet(float ksd, float nsd)
+{
+  DL_SDF_KERNEL *k;
+  int i, slot;
+
+  DL_SDF_LOCK();
+  for (i = 0; i < DL_SDF_KCACHE; i++) {
+    if ((k = SdfKernels[i]) && k->ksd == ksd && k->nsd == nsd) {
+      k->refcount++;
+      k->used = ++SdfClock;
+      DL_SDF_UNLOCK();
+      return k;
+    }
+  }
+  DL_SDF_UNLOCK();
+
+  if (!(k = dlSdfKernelMake(ksd, nsd))) return NULL;
+
+  /* take an empty slot, or the least recently used idle kernel's */
+  DL_SDF_LOCK();
+  k->refcount = 1;
+  k->used = ++SdfClock;
+  for (i = 0, slot = -1; i < DL_SDF_KCACHE; i++) {
+    if (!SdfKernels[i]) { slot = i; break; }
+    if (!SdfKernels[i]->refcount &&
+	(slot < 0 || SdfKernels[i]->used < SdfKernels[slot]->used)) slot = i;
+  }
+  if (slot >= 0) {
+    if (SdfKernels[slot]) dlSdfKernelFree(SdfKernels[slot]);
+    SdfKernels[slot] = k;
+    k->cached = 1;
+  }
+  DL_SDF_UNLOCK();
+  return k;
+}
+
+void dlSdfKernelRelease(DL_SDF_KERNEL *k)
+{
+  if (!k) return;
+  DL_SDF_LOCK();
+  if (!--k->refcount && !k->cached) dlSdfKernelFree(k);
+  DL_SDF_UNLOCK();
+}
+
+/*
+ * dlSdfSpectrum - transform of the kernel taps zero padded to nfft
+ * points.  *tofree is set if the result could not be kept with the
+ * kernel.
+ */
+
+static double *dlSdfSpectrum(DL_SDF_KERNEL *k, int nfft, int *tofree)
+{
+  double *spec;
+  int i, ntaps = 2*k->ksize-1;
+
+  *tofree = 0;
+  DL_SDF_LOCK();
+  for (i = 0; i < DL_SDF_SPECTRA; i++) {
+    if (k->nffts[i] == nfft) {
+      spec = k->spectra[i];
+      DL_SDF_UNLOCK();
+      return spec;
+    }
+  }
+  DL_SDF_UNLOCK();
+
+  if (!(spec = (double *) calloc(nfft+2, sizeof(double)))) return NULL;
+  for (i = 0; i < ntaps; i++) spec[i] = k->taps[i];
+  dlFftReal(nfft, spec, 0);
+
+  DL_SDF_LOCK();
+  for (i = 0; i < DL_SDF_SPECTRA; i++) {
+    if (!k->nffts[i]) {
+      k->nffts[i] = nfft;
+      k->spectra[i] = spec;
+      break;
+    }
+  }
+  if (i == DL_SDF_SPECTRA) *tofree = 1;
+  DL_SDF_UNLOCK();
+  return spec;
+}
+
+/*
+ * DL_SDF_BIN_LOOP - the bins of the spikes sdfMakeSdf would look at
+ * (the same first and last spike, found the same way), keeping those
+ * within half a kernel of the window
+ */
+
+#define DL_SDF_BIN_LOOP(TYPE)						\
+  {									\
+    TYPE *v = (TYPE *) spikes;						\
+    for (low = nspikes, j = 0; j < nspikes; j++) {			\
+      if ((float) v[j] > (float) lowlimit) { low = j; break; }		\
+    }									\
+    for (high = low-1, j = nspikes-1; j >= low-1 && j >= 0; j--) {	\
+      if ((float) v[j] < (float) highlimit) { high = j; break; }	\
+    }									\
+    for (j = low; j <= high; j++) {					\
+      d = (float) v[j] - start;						\
+      if ((double) d > -ks && (double) d < (double) nout + half)	\
+	bins[nin++] = (int) d;						\
+    }									\
+  }
+
+/*
+ * dlSdfTrial - the first nout points of the sdf of one trial starting
+ * at start.  span is the duration sdfMakeSdf was given (it limits
+ * which spikes are looked at).  Returns 0 if out of memory.
+ */
+
+int dlSdfTrial(DL_SDF_KERNEL *kernel, int type, void *spikes, int nspikes,
+	       float start, int span, float *out, int nout)
+{
+  int ks = kernel->ksize, half = ks-1, ntaps = 2*ks-1;
+  int low, high, j, nin = 0, lowlimit, highlimit, s, t, lo, hi, o;
+  int nfft, m, w, tofree;
+  int *bins, *counts;
+  double *buf, *spec, re, im;
+  float d, *taps = kernel->taps;
+
+  memset(out, 0, nout*sizeof(float));
+  if (nout <= 0 || nspikes <= 0) return 1;
+  if (!(bins = (int *) malloc(nspikes*sizeof(int)))) return 0;
+
+  lowlimit = start-ks;
+  highlimit = start+span+1+ks;
+  switch (type) {
+  case DF_FLOAT: DL_SDF_BIN_LOOP(float); break;
+  case DF_LONG:  DL_SDF_BIN_LOOP(int);   break;
+  case DF_SHORT: DL_SDF_BIN_LOOP(short); break;
+  case DF_CHAR:  DL_SDF_BIN_LOOP(char);  break;
+  }
+
+  m = nout+2*half;
+  nfft = dlFftSize(m);
+  if (!nfft || (double) nin*ntaps <
+      (double) DL_SDF_FFT_COST*nfft*log2((double) nfft)) {
+    /* add the kernel around each spike, in the order of the spikes */
+    for (j = 0; j < nin; j++) {
+      s = bins[j];
+      lo = (s-half < 0) ? 0 : s-half;
+      hi = (s+half+1 > nout) ? nout : s+half+1;
+      o = half-s;
+      for (t = lo; t < hi; t++) out[t] += taps[t+o];
+    }
+    free(bins);
+    return 1;
+  }
+
+  counts = (int *) calloc(m, sizeof(int));
+  buf = (double *) calloc(nfft+2, sizeof(double));
+  spec = (counts && buf) ? dlSdfSpectrum(kernel, nfft, &tofree) : NULL;
+  if (!spec) {
+    if (counts) free(counts);
+    if (buf) free(buf);
+    free(bins);
+    return 0;
+  }
+  for (j = 0; j < nin; j++) counts[bins[j]+half]++;
+  free(bins);
+
+  for (j = 0; j < m; j++) buf[j] = counts[j];
+  dlFftReal(nfft, buf, 0);
+  for (j = 0; j <= nfft/2; j++) {
+    re = buf[2*j]*spec[2*j] - buf[2*j+1]*spec[2*j+1];
+    im = buf[2*j]*spec[2*j+1] + buf[2*j+1]*spec[2*j];
+    buf[2*j] = re;
+    buf[2*j+1] = im;
+  }
+  dlFftReal(nfft, buf, 1);
+
+  /* point t sums the bins t..t+2*half; keep the zeros exact */
+  for (j = 0, w = 0; j < ntaps; j++) w += counts[j];
+  for (t = 0; t < nout; t++) {
+    if (w && buf[t+2*half] > 0.0) out[t] = buf[t+2*half];
+    w -= counts[t];
+    if (t+ntaps < m) w += counts[t+ntaps];
+  }
+
+  if (tofree) free(spec);
+  free(buf);
+  free(counts);
+  return 1;
+}
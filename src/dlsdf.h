@@ -0,0 +1,34 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlsdf.h
+ *
+ *  DESCRIPTION
+ *    Spike density functions for dl_sdf, dl_sdfs, dl_deepSdf and
+ *  dl_sdfAligned.  Kernels (the gaussian of sdfMakeKernel) are cached
+ *  by sd and number of sds, so a list of trials or repeated calls
+ *  with the same smoothing build each kernel once.  dlSdfKernelGet
+ *  returns a kernel that stays valid until it is released, whatever
+ *  other calls do to the cache.
+ *
+ ************************************************************************/
+
+#ifndef DLSDF_H
+#define DLSDF_H
+
+typedef struct DL_SDF_KERNEL DL_SDF_KERNEL;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+DL_SDF_KERNEL *dlSdfKernelGet(float ksd, float nsd);
+void dlSdfKernelRelease(DL_SDF_KERNEL *kernel);
+int dlSdfTrial(DL_SDF_KERNEL *kernel, int type, void *spikes, int nspikes,
+	       float start, int span, float *out, int nout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLSDF_H */
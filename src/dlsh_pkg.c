@@ -25,6 +25,8 @@ extern int Dlg_Init(Tcl_Interp * interp) ;
 extern int Cgps_Init(Tcl_Interp * interp) ;
 extern int Cgbase_Init(Tcl_Interp * interp) ;
 extern int DlNoise_Init(Tcl_Interp * interp) ;
+extern int DlExpr_Init(Tcl_Interp * interp) ;
+extern int DlGroup_Init(Tcl_Interp * interp) ;
 
 EXPORT(int,Dlsh_Init) (Tcl_Interp *interp)
 {
@@ -33,6 +35,8 @@ EXPORT(int,Dlsh_Init) (Tcl_Interp *interp)
   if (Dlg_Init(interp) == TCL_ERROR) return(TCL_ERROR);
   if (Cgbase_Init(interp) == TCL_ERROR) return(TCL_ERROR) ;
   if (DlNoise_Init(interp) == TCL_ERROR) return(TCL_ERROR);
+  if (DlExpr_Init(interp) == TCL_ERROR) return(TCL_ERROR);
+  if (DlGroup_Init(interp) == TCL_ERROR) return(TCL_ERROR);
 
   Tcl_PkgProvide(interp, "dlsh", "1.2");
 
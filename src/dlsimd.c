@@ -0,0 +1,643 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlsimd.c
+ *
+ *  DESCRIPTION
+ *    Run time dispatched SSE2 / AVX2 kernels for elementwise dynlist
+ *  arithmetic (dynListArithListList), relations
+ *  (dynListRelationListList), one argument math functions
+ *  (dynListMathOneArg), histogram bins (dlhist.c) and matrix products
+ *  (dlmat.c).  Both instruction sets are compiled into the library;
+ *  the one used is the best the CPU supports, which can be lowered
+ *  with the DLSH_SIMD environment variable or dl_simd.
+ *
+ *  The kernel bodies live in dlsimd_kern.h and are included once for
+ *  each instruction set with the vector macros below.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "df.h"
+#include "dfana.h"
+#include "dlsimd.h"
+#include "dlthread.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define DL_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+static int DLSimdSupport;	/* best level the CPU has      */
+static int DLSimdLevel;		/* level in use                */
+static DL_ONCE DLSimdOnce = DL_ONCE_INIT;
+static int DLSimdFastMath = 0;	/* use approximate exp / log / sin */
+
+/*
+ * The level and fast math flag are read by pool workers while dl_simd
+ * may change them, so they are loaded and stored atomically.
+ */
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define DL_SIMD_GET(v)      (*(volatile int *) &(v))
+#define DL_SIMD_SWAP(v, x)  _InterlockedExchange((volatile long *) &(v), (x))
+#else
+#define DL_SIMD_GET(v)      __atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define DL_SIMD_SWAP(v, x)  __atomic_exchange_n(&(v), (x), __ATOMIC_RELAXED)
+#endif
+
+static char *DLSimdLevelNames[] = { "scalar", "sse2", "avx2" };
+
+#ifdef DL_SIMD_X86
+
+#if defined(__GNUC__) || defined(__clang__)
+#define KTARGET_SSE2 __attribute__((target("sse2")))
+#define KTARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KTARGET_SSE2
+#define KTARGET_AVX2
+#endif
+
+/**********************************
+ ************* SSE2
+ **********************************/
+
+#define KFN(name)          dlsimd_##name##_sse2
+#define KTARGET            KTARGET_SSE2
+#define W                  4
+#define VBYTES             16
+#define HAVE_MULLO32       0
+#define VF                 __m128
+#define VI                 __m128i
+#define VF_LOAD(p)         _mm_loadu_ps(p)
+#define VF_STORE(p,v)      _mm_storeu_ps(p,v)
+#define VF_SET1(x)         _mm_set1_ps(x)
+#define VF_ZERO()          _mm_setzero_ps()
+#define VF_ADD(a,b)        _mm_add_ps(a,b)
+#define VF_SUB(a,b)        _mm_sub_ps(a,b)
+#define VF_MUL(a,b)        _mm_mul_ps(a,b)
+#define VF_DIV(a,b)        _mm_div_ps(a,b)
+#define VF_MIN(a,b)        _mm_min_ps(a,b)
+#define VF_MAX(a,b)        _mm_max_ps(a,b)
+#define VF_SQRT(a)         _mm_sqrt_ps(a)
+#define VF_AND(a,b)        _mm_and_ps(a,b)
+#define VF_ANDNOT(a,b)     _mm_andnot_ps(a,b)
+#define VF_OR(a,b)         _mm_or_ps(a,b)
+#define VF_XOR(a,b)        _mm_xor_ps(a,b)
+#define VF_CMPEQ(a,b)      _mm_cmpeq_ps(a,b)
+#define VF_CMPNE(a,b)      _mm_cmpneq_ps(a,b)
+#define VF_CMPLT(a,b)      _mm_cmplt_ps(a,b)
+#define VF_CMPLE(a,b)      _mm_cmple_ps(a,b)
+#define VF_CMPGT(a,b)      _mm_cmpgt_ps(a,b)
+#define VF_CMPGE(a,b)      _mm_cmpge_ps(a,b)
+#define VF_MOVEMASK(a)     _mm_movemask_ps(a)
+#define VF_ALLMASK         0xf
+#define VF_FROMI(a)        _mm_cvtepi32_ps(a)
+#define VF_TOI(a)          _mm_cvttps_epi32(a)
+#define VF_ASI(a)          _mm_castps_si128(a)
+#define VI_ASF(a)          _mm_castsi128_ps(a)
+#define VI_LOAD(p)         _mm_loadu_si128((__m128i *) (p))
+#define VI_STORE(p,v)      _mm_storeu_si128((__m128i *) (p),v)
+#define VI_LOADS16(p)      _mm_srai_epi32(_mm_unpacklo_epi16(           \
+			     _mm_loadl_epi64((__m128i *) (p)),          \
+			     _mm_loadl_epi64((__m128i *) (p))), 16)
+#define VI_SET1_32(x)      _mm_set1_epi32(x)
+#define VI_SET1_16(x)      _mm_set1_epi16(x)
+#define VI_SET1_8(x)       _mm_set1_epi8(x)
+#define VI_AND(a,b)        _mm_and_si128(a,b)
+#define VI_ANDNOT(a,b)     _mm_andnot_si128(a,b)
+#define VI_OR(a,b)         _mm_or_si128(a,b)
+#define VI_XOR(a,b)        _mm_xor_si128(a,b)
+#define VI_ADD32(a,b)      _mm_add_epi32(a,b)
+#define VI_SUB32(a,b)      _mm_sub_epi32(a,b)
+#define VI_CMPEQ32(a,b)    _mm_cmpeq_epi32(a,b)
+#define VI_CMPGT32(a,b)    _mm_cmpgt_epi32(a,b)
+#define VI_SLLI32(a,n)     _mm_slli_epi32(a,n)
+#define VI_SRLI32(a,n)     _mm_srli_epi32(a,n)
+#define VI_ADD16(a,b)      _mm_add_epi16(a,b)
+#define VI_SUB16(a,b)      _mm_sub_epi16(a,b)
+#define VI_MULLO16(a,b)    _mm_mullo_epi16(a,b)
+#define VI_MIN16(a,b)      _mm_min_epi16(a,b)
+#define VI_MAX16(a,b)      _mm_max_epi16(a,b)
+#define VI_ADD8(a,b)       _mm_add_epi8(a,b)
+#define VI_SUB8(a,b)       _mm_sub_epi8(a,b)
+#define VD                 __m128d
+#define VH                 __m128i
+#define VD_LOAD(p)         _mm_loadu_pd(p)
+#define VD_STORE(p,v)      _mm_storeu_pd(p,v)
+#define VD_SET1(x)         _mm_set1_pd(x)
+#define VD_ADD(a,b)        _mm_add_pd(a,b)
+#define VD_SUB(a,b)        _mm_sub_pd(a,b)
+#define VD_MUL(a,b)        _mm_mul_pd(a,b)
+#define VD_DIV(a,b)        _mm_div_pd(a,b)
+#define VD_MIN(a,b)        _mm_min_pd(a,b)
+#define VD_AND(a,b)        _mm_and_pd(a,b)
+#define VD_ANDNOT(a,b)     _mm_andnot_pd(a,b)
+#define VD_OR(a,b)         _mm_or_pd(a,b)
+#define VD_CMPLT(a,b)      _mm_cmplt_pd(a,b)
+#define VD_CMPGE(a,b)      _mm_cmpge_pd(a,b)
+#define VD_MOVEMASK(a)     _mm_movemask_pd(a)
+#define VD_TOH(a)          _mm_cvttpd_epi32(a)
+#define VD_FROMH(a)        _mm_cvtepi32_pd(a)
+#define VF_LOD(a)          _mm_cvtps_pd(a)
+#define VF_HID(a)          _mm_cvtps_pd(_mm_movehl_ps(a,a))
+#define VI_LOD(a)          _mm_cvtepi32_pd(a)
+#define VI_HID(a)          _mm_cvtepi32_pd(_mm_shuffle_epi32(a,0xee))
+#define VI_FROMH(lo,hi)    _mm_unpacklo_epi64(lo,hi)
+#define VI_SET1_64(x)      _mm_set1_epi64x(x)
+#define VI_MULEU32(a,b)    _mm_mul_epu32(a,b)
+#define VI_SLLI64(a,n)     _mm_slli_epi64(a,n)
+#define VI_SRLI64(a,n)     _mm_srli_epi64(a,n)
+
+#include "dlsimd_kern.h"
+
+#undef KFN
+#undef KTARGET
+#undef W
+#undef VBYTES
+#undef HAVE_MULLO32
+#undef VF
+#undef VI
+#undef VF_LOAD
+#undef VF_STORE
+#undef VF_SET1
+#undef VF_ZERO
+#undef VF_ADD
+#undef VF_SUB
+#undef VF_MUL
+#undef VF_DIV
+#undef VF_MIN
+#undef VF_MAX
+#undef VF_SQRT
+#undef VF_AND
+#undef VF_ANDNOT
+#undef VF_OR
+#undef VF_XOR
+#undef VF_CMPEQ
+#undef VF_CMPNE
+#undef VF_CMPLT
+#undef VF_CMPLE
+#undef VF_CMPGT
+#undef VF_CMPGE
+#undef VF_MOVEMASK
+#undef VF_ALLMASK
+#undef VF_FROMI
+#undef VF_TOI
+#undef VF_ASI
+#undef VI_ASF
+#undef VI_LOAD
+#undef VI_STORE
+#undef VI_LOADS16
+#undef VI_SET1_32
+#undef VI_SET1_16
+#undef VI_SET1_8
+#undef VI_AND
+#undef VI_ANDNOT
+#undef VI_OR
+#undef VI_XOR
+#undef VI_ADD32
+#undef VI_SUB32
+#undef VI_CMPEQ32
+#undef VI_CMPGT32
+#undef VI_SLLI32
+#undef VI_SRLI32
+#undef VI_ADD16
+#undef VI_SUB16
+#undef VI_MULLO16
+#undef VI_MIN16
+#undef VI_MAX16
+#undef VI_ADD8
+#undef VI_SUB8
+#undef VD
+#undef VH
+#undef VD_LOAD
+#undef VD_STORE
+#undef VD_SET1
+#undef VD_ADD
+#undef VD_SUB
+#undef VD_MUL
+#undef VD_DIV
+#undef VD_MIN
+#undef VD_AND
+#undef VD_ANDNOT
+#undef VD_OR
+#undef VD_CMPLT
+#undef VD_CMPGE
+#undef VD_MOVEMASK
+#undef VD_TOH
+#undef VD_FROMH
+#undef VF_LOD
+#undef VF_HID
+#undef VI_LOD
+#undef VI_HID
+#undef VI_FROMH
+#undef VI_SET1_64
+#undef VI_MULEU32
+#undef VI_SLLI64
+#undef VI_SRLI64
+
+/**********************************
+ ************* AVX2
+ **********************************/
+
+#define KFN(name)          dlsimd_##name##_avx2
+#define KTARGET            KTARGET_AVX2
+#define W                  8
+#define VBYTES             32
+#define HAVE_MULLO32       1
+#define VF                 __m256
+#define VI                 __m256i
+#define VF_LOAD(p)         _mm256_loadu_ps(p)
+#define VF_STORE(p,v)      _mm256_storeu_ps(p,v)
+#define VF_SET1(x)         _mm256_set1_ps(x)
+#define VF_ZERO()          _mm256_setzero_ps()
+#define VF_ADD(a,b)        _mm256_add_ps(a,b)
+#define VF_SUB(a,b)        _mm256_sub_ps(a,b)
+#define VF_MUL(a,b)        _mm256_mul_ps(a,b)
+#define VF_DIV(a,b)        _mm256_div_ps(a,b)
+#define VF_MIN(a,b)        _mm256_min_ps(a,b)
+#define VF_MAX(a,b)        _mm256_max_ps(a,b)
+#define VF_SQRT(a)         _mm256_sqrt_ps(a)
+#define VF_AND(a,b)        _mm256_and_ps(a,b)
+#define VF_ANDNOT(a,b)     _mm256_andnot_ps(a,b)
+#define VF_OR(a,b)         _mm256_or_ps(a,b)
+#define VF_XOR(a,b)        _mm256_xor_ps(a,b)
+#define VF_CMPEQ(a,b)      _mm256_cmp_ps(a,b,_CMP_EQ_OQ)
+#define VF_CMPNE(a,b)      _mm256_cmp_ps(a,b,_CMP_NEQ_UQ)
+#define VF_CMPLT(a,b)      _mm256_cmp_ps(a,b,_CMP_LT_OQ)
+#define VF_CMPLE(a,b)      _mm256_cmp_ps(a,b,_CMP_LE_OQ)
+#define VF_CMPGT(a,b)      _mm256_cmp_ps(a,b,_CMP_GT_OQ)
+#define VF_CMPGE(a,b)      _mm256_cmp_ps(a,b,_CMP_GE_OQ)
+#define VF_MOVEMASK(a)     _mm256_movemask_ps(a)
+#define VF_ALLMASK         0xff
+#define VF_FROMI(a)        _mm256_cvtepi32_ps(a)
+#define VF_TOI(a)          _mm256_cvttps_epi32(a)
+#define VF_ASI(a)          _mm256_castps_si256(a)
+#define VI_ASF(a)          _mm256_castsi256_ps(a)
+#define VI_LOAD(p)         _mm256_loadu_si256((__m256i *) (p))
+#define VI_STORE(p,v)      _mm256_storeu_si256((__m256i *) (p),v)
+#define VI_LOADS16(p)      _mm256_cvtepi16_epi32(                       \
+			     _mm_loadu_si128((__m128i *) (p)))
+#define VI_SET1_32(x)      _mm256_set1_epi32(x)
+#define VI_SET1_16(x)      _mm256_set1_epi16(x)
+#define VI_SET1_8(x)       _mm256_set1_epi8(x)
+#define VI_AND(a,b)        _mm256_and_si256(a,b)
+#define VI_ANDNOT(a,b)     _mm256_andnot_si256(a,b)
+#define VI_OR(a,b)         _mm256_or_si256(a,b)
+#define VI_XOR(a,b)        _mm256_xor_si256(a,b)
+#define VI_ADD32(a,b)      _mm256_add_epi32(a,b)
+#define VI_SUB32(a,b)      _mm256_sub_epi32(a,b)
+#define VI_MULLO32(a,b)    _mm256_mullo_epi32(a,b)
+#define VI_CMPEQ32(a,b)    _mm256_cmpeq_epi32(a,b)
+#define VI_CMPGT32(a,b)    _mm256_cmpgt_epi32(a,b)
+#define VI_SLLI32(a,n)     _mm256_slli_epi32(a,n)
+#define VI_SRLI32(a,n)     _mm256_srli_epi32(a,n)
+#define VI_ADD16(a,b)      _mm256_add_epi16(a,b)
+#define VI_SUB16(a,b)      _mm256_sub_epi16(a,b)
+#define VI_MULLO16(a,b)    _mm256_mullo_epi16(a,b)
+#define VI_MIN16(a,b)      _mm256_min_epi16(a,b)
+#define VI_MAX16(a,b)      _mm256_max_epi16(a,b)
+#define VI_ADD8(a,b)       _mm256_add_epi8(a,b)
+#define VI_SUB8(a,b)       _mm256_sub_epi8(a,b)
+#define VD                 __m256d
+#define VH                 __m128i
+#define VD_LOAD(p)         _mm256_loadu_pd(p)
+#define VD_STORE(p,v)      _mm256_storeu_pd(p,v)
+#define VD_SET1(x)         _mm256_set1_pd(x)
+#define VD_ADD(a,b)        _mm256_add_pd(a,b)
+#define VD_SUB(a,b)        _mm256_sub_pd(a,b)
+#define VD_MUL(a,b)        _mm256_mul_pd(a,b)
+#define VD_DIV(a,b)        _mm256_div_pd(a,b)
+#define VD_MIN(a,b)        _mm256_min_pd(a,b)
+#define VD_AND(a,b)        _mm256_and_pd(a,b)
+#define VD_ANDNOT(a,b)     _mm256_andnot_pd(a,b)
+#define VD_OR(a,b)         _mm256_or_pd(a,b)
+#define VD_CMPLT(a,b)      _mm256_cmp_pd(a,b,_CMP_LT_OQ)
+#define VD_CMPGE(a,b)      _mm256_cmp_pd(a,b,_CMP_GE_OQ)
+#define VD_MOVEMASK(a)     _mm256_movemask_pd(a)
+#define VD_TOH(a)          _mm256_cvttpd_epi32(a)
+#define VD_FROMH(a)        _mm256_cvtepi32_pd(a)
+#define VF_LOD(a)          _mm256_cvtps_pd(_mm256_castps256_ps128(a))
+#define VF_HID(a)          _mm256_cvtps_pd(_mm256_extractf128_ps(a,1))
+#define VI_LOD(a)          _mm256_cvtepi32_pd(_mm256_castsi256_si128(a))
+#define VI_HID(a)          _mm256_cvtepi32_pd(_mm256_extracti128_si256(a,1))
+#define VI_FROMH(lo,hi)    _mm256_inserti128_si256(                     \
+			     _mm256_castsi128_si256(lo),hi,1)
+#define VI_SET1_64(x)      _mm256_set1_epi64x(x)
+#define VI_MULEU32(a,b)    _mm256_mul_epu32(a,b)
+#define VI_SLLI64(a,n)     _mm256_slli_epi64(a,n)
+#define VI_SRLI64(a,n)     _mm256_srli_epi64(a,n)
+
+#include "dlsimd_kern.h"
+
+/*
+ * dlSimdDetect - best level this CPU (and OS, for the AVX state)
+ * supports
+ */
+
+static int dlSimdDetect(void)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return DL_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse2")) return DL_SIMD_SSE2;
+  return DL_SIMD_SCALAR;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] >= 7) {
+    __cpuid(info, 1);
+    /* OSXSAVE and AVX, and the OS saves the ymm state */
+    if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+	(_xgetbv(0) & 6) == 6) {
+      __cpuidex(info, 7, 0);
+      if (info[1] & (1 << 5)) return DL_SIMD_AVX2;
+    }
+  }
+  return DL_SIMD_SSE2;		/* x64 baseline */
+#else
+  return DL_SIMD_SCALAR;
+#endif
+}
+
+#else  /* !DL_SIMD_X86 */
+
+static int dlSimdDetect(void)
+{
+  return DL_SIMD_SCALAR;
+}
+
+#endif
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    dlSimdSupported / dlSimdLevel / dlSimdSetLevel
+ *
+ * DESCRIPTION
+ *    The level in use starts as the best one supported, or the one
+ *  named by DLSH_SIMD if that is lower, found once by whichever thread
+ *  asks first.  dlSimdSetLevel returns the previous level, or -1 if
+ *  the new one is not supported here.
+ *
+ *****************************************************************************/
+
+static void dlSimdInit(void)
+{
+  char *env;
+  int want;
+
+  DLSimdSupport = dlSimdDetect();
+  DLSimdLevel = DLSimdSupport;
+  if ((env = getenv("DLSH_SIMD")) != NULL &&
+      dlSimdLevelID(env, &want) && want < DLSimdLevel)
+    DLSimdLevel = want;
+}
+
+int dlSimdSupported(void)
+{
+  dlOnce(&DLSimdOnce, dlSimdInit);
+  return DLSimdSupport;
+}
+
+int dlSimdLevel(void)
+{
+  dlOnce(&DLSimdOnce, dlSimdInit);
+  return DL_SIMD_GET(DLSimdLevel);
+}
+
+int dlSimdSetLevel(int level)
+{
+  if (level < 0 || level > dlSimdSupported()) return -1;
+  return DL_SIMD_SWAP(DLSimdLevel, level);
+}
+
+char *dlSimdLevelName(int level)
+{
+  if (level < 0 || level >= DL_N_SIMD_LEVELS) return NULL;
+  return DLSimdLevelNames[level];
+}
+
+int dlSimdLevelID(char *name, int *level)
+{
+  int i;
+  for (i = 0; i < DL_N_SIMD_LEVELS; i++) {
+    if (!strcmp(name, DLSimdLevelNames[i])) {
+      *level = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int dlSimdSetFastMath(int status)
+{
+  return DL_SIMD_SWAP(DLSimdFastMath, status);
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    dlSimdArith
+ *
+ * DESCRIPTION
+ *    Elementwise func (DL_MATH_*) of vals1 and vals2 into out, which
+ *  has room for n values of the result type (float if either input is
+ *  float, else the common type).  copymode 1 / 2 broadcast the first
+ *  value of vals1 / vals2 as in dynListArithListList.
+ *
+ *****************************************************************************/
+
+int dlSimdArith(int func, int copymode, DL_SIZE n,
+		int type1, void *vals1, int type2, void *vals2, void *out)
+{
+#ifdef DL_SIMD_X86
+  int level = dlSimdLevel();
+  if (level == DL_SIMD_SCALAR || n < 4) return 0;
+
+  if (type1 == DF_FLOAT || type2 == DF_FLOAT) {
+    if ((type1 != DF_FLOAT && type1 != DF_LONG && type1 != DF_SHORT) ||
+	(type2 != DF_FLOAT && type2 != DF_LONG && type2 != DF_SHORT))
+      return 0;
+    if (level == DL_SIMD_AVX2)
+      return dlsimd_arith_float_avx2(func, copymode, n, type1, vals1,
+				     type2, vals2, (float *) out);
+    return dlsimd_arith_float_sse2(func, copymode, n, type1, vals1,
+				   type2, vals2, (float *) out);
+  }
+  if (type1 != type2) return 0;
+  if (level == DL_SIMD_AVX2)
+    return dlsimd_arith_int_avx2(func, copymode, n, type1, vals1, vals2, out);
+  return dlsimd_arith_int_sse2(func, copymode, n, type1, vals1, vals2, out);
+#else
+  return 0;
+#endif
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    dlSimdRelation
+ *
+ * DESCRIPTION
+ *    Elementwise relation op (DL_RELATION_*) of vals1 and vals2 as 0/1
+ *  ints into out.  Handles float, int and short lists and the float /
+ *  integer mixes; DL_RELATION_MOD is left to the caller.
+ *
+ *****************************************************************************/
+
+int dlSimdRelation(int op, int copymode, DL_SIZE n,
+		   int type1, void *vals1, int type2, void *vals2, int *out)
+{
+#ifdef DL_SIMD_X86
+  int level = dlSimdLevel();
+  if (level == DL_SIMD_SCALAR || n < 4) return 0;
+
+  if ((type1 != DF_FLOAT && type1 != DF_LONG && type1 != DF_SHORT) ||
+      (type2 != DF_FLOAT && type2 != DF_LONG && type2 != DF_SHORT))
+    return 0;
+  if (type1 != type2 && type1 != DF_FLOAT && type2 != DF_FLOAT) return 0;
+
+  if (level == DL_SIMD_AVX2)
+    return dlsimd_relation_avx2(op, copymode, n, type1, vals1,
+				type2, vals2, out);
+  return dlsimd_relation_sse2(op, copymode, n, type1, vals1,
+			      type2, vals2, out);
+#else
+  return 0;
+#endif
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    dlSimdMath1
+ *
+ * DESCRIPTION
+ *    One argument math function (DL_MATHFUNC1 id) of a float list.
+ *  sqrt and abs always; exp, log and sin only when fast math is on.
+ *
+ *****************************************************************************/
+
+int dlSimdMath1(int func_id, DL_SIZE n, float *vals, float *out)
+{
+#ifdef DL_SIMD_X86
+  int level = dlSimdLevel();
+  if (level == DL_SIMD_SCALAR || n < 4) return 0;
+
+  switch (func_id) {
+  case DL_SQRT:
+  case DL_ABS:
+    break;
+  case DL_EXP:
+  case DL_LOG:
+  case DL_SIN:
+    if (DL_SIMD_GET(DLSimdFastMath)) break;
+    return 0;
+  default:
+    return 0;
+  }
+  if (level == DL_SIMD_AVX2)
+    return dlsimd_math1_avx2(func_id, n, vals, out);
+  return dlsimd_math1_sse2(func_id, n, vals, out);
+#else
+  return 0;
+#endif
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    dlSimdHistBins
+ *
+ * DESCRIPTION
+ *    Bin of each of n float, int or short values for nbins bins of
+ *  the given width from start to stop, nbins for values outside (see
+ *  dlhist.h).  Bins are found by multiplying by inv; within tol of a
+ *  bin edge they are recomputed by division.
+ *
+ *****************************************************************************/
+
+int dlSimdHistBins(int type, DL_SIZE n, void *vals, double start,
+		   double stop, double width, double inv, double tol,
+		   int nbins, int *bins)
+{
+#ifdef DL_SIMD_X86
+  int level = dlSimdLevel();
+  if (level == DL_SIMD_SCALAR || n < 4) return 0;
+  if (type != DF_FLOAT && type != DF_LONG && type != DF_SHORT) return 0;
+
+  if (level == DL_SIMD_AVX2)
+    return dlsimd_histbins_avx2(type, n, vals, start, stop, width, inv,
+				tol, nbins, bins);
+  return dlsimd_histbins_sse2(type, n, vals, start, stop, width, inv,
+			      tol, nbins, bins);
+#else
+  return 0;
+#endif
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    dlSimdGemm
+ *
+ * DESCRIPTION
+ *    Adds the product of the mr x kc floats at a (row stride lda) and
+ *  the kc x nc floats at b (row stride ldb) to the mr x nc doubles at
+ *  c (row stride ldc), summing each element in ascending k (see
+ *  dlmat.c).
+ *
+ *****************************************************************************/
+
+int dlSimdGemm(int mr, int nc, int kc, const float *a, int lda,
+	       const float *b, int ldb, double *c, int ldc)
+{
+#ifdef DL_SIMD_X86
+  int level = dlSimdLevel();
+  if (level == DL_SIMD_SCALAR || nc < 8) return 0;
+
+  if (level == DL_SIMD_AVX2)
+    return dlsimd_gemm_avx2(mr, nc, kc, a, lda, b, ldb, c, ldc);
+  return dlsimd_gemm_sse2(mr, nc, kc, a, lda, b, ldb, c, ldc);
+#else
+  return 0;
+#endif
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    dlSimdPhilox
+ *
+ * DESCRIPTION
+ *    Computes the Philox4x32-10 blocks first .. first+n-1 of a stream
+ *  (see dlrng.c), W blocks at a time, putting the four words of block
+ *  first+b at out[4b .. 4b+3].  Returns the number of blocks done,
+ *  which may be fewer than n (the rest are left to the scalar code).
+ *
+ *****************************************************************************/
+
+DL_SIZE dlSimdPhilox(const unsigned int *key, const unsigned int *stream,
+		     DL_SIZE first, unsigned int attempt, DL_SIZE n,
+		     unsigned int *out)
+{
+#ifdef DL_SIMD_X86
+  int level = dlSimdLevel();
+  if (level == DL_SIMD_SCALAR) return 0;
+
+  if (level == DL_SIMD_AVX2)
+    return dlsimd_philox_avx2(key, stream, first, attempt, n, out);
+  return dlsimd_philox_sse2(key, stream, first, attempt, n, out);
+#else
+  return 0;
+#endif
+}
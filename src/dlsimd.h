@@ -0,0 +1,55 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlsimd.h
+ *
+ *  DESCRIPTION
+ *    Vector kernels for elementwise dynlist arithmetic, relations,
+ *  one argument math functions, histogram bins and matrix products.
+ *  SSE2 and AVX2 versions are compiled into the same library and
+ *  chosen at run time from the CPU; other architectures always use
+ *  the scalar loops in dlarith.c / dfana.c / dlhist.c / dlmat.c.
+ *
+ *  Each kernel returns 1 if it computed the result and 0 if the case
+ *  (datatypes, operation, level) is left to the scalar code.  Results
+ *  are bit identical to the scalar loops, except for the exp, log and
+ *  sin approximations which are only used when fast math is turned on.
+ *
+ ************************************************************************/
+
+#ifndef DLSIMD_H
+#define DLSIMD_H
+
+enum DL_SIMD_LEVELS { DL_SIMD_SCALAR, DL_SIMD_SSE2, DL_SIMD_AVX2,
+		      DL_N_SIMD_LEVELS };
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int dlSimdSupported(void);
+int dlSimdLevel(void);
+int dlSimdSetLevel(int level);
+char *dlSimdLevelName(int level);
+int dlSimdLevelID(char *name, int *level);
+int dlSimdSetFastMath(int status);
+
+int dlSimdArith(int func, int copymode, DL_SIZE n,
+		int type1, void *vals1, int type2, void *vals2, void *out);
+int dlSimdRelation(int op, int copymode, DL_SIZE n,
+		   int type1, void *vals1, int type2, void *vals2, int *out);
+int dlSimdMath1(int func_id, DL_SIZE n, float *vals, float *out);
+int dlSimdHistBins(int type, DL_SIZE n, void *vals, double start,
+		   double stop, double width, double inv, double tol,
+		   int nbins, int *bins);
+int dlSimdGemm(int mr, int nc, int kc, const float *a, int lda,
+	       const float *b, int ldb, double *c, int ldc);
+DL_SIZE dlSimdPhilox(const unsigned int *key, const unsigned int *stream,
+		     DL_SIZE first, unsigned int attempt, DL_SIZE n,
+		     unsigned int *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLSIMD_H */
@@ -0,0 +1,779 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlsimd_kern.h
+ *
+ *  DESCRIPTION
+ *    Kernel bodies for dlsimd.c.  This file is included once per
+ *  instruction set, after the KFN / KTARGET names and the V* vector
+ *  macros have been defined for that set; it is not a public header.
+ *
+ *  Each loop runs whole vectors and then finishes the last n%W
+ *  elements by copying them into a zero padded vector, so the tail is
+ *  computed with exactly the same instructions as the body.
+ *
+ ************************************************************************/
+
+/*
+ * Element loaders: a float vector from float, int or short data
+ */
+
+KTARGET static VF KFN(loadf)(int type, void *p, DL_SIZE i)
+{
+  switch (type) {
+  case DF_FLOAT: return VF_LOAD((float *) p + i);
+  case DF_LONG:  return VF_FROMI(VI_LOAD((int *) p + i));
+  default:       return VF_FROMI(VI_LOADS16((short *) p + i));
+  }
+}
+
+static float KFN(getf)(int type, void *p, DL_SIZE i)
+{
+  switch (type) {
+  case DF_FLOAT: return ((float *) p)[i];
+  case DF_LONG:  return (float) ((int *) p)[i];
+  default:       return (float) ((short *) p)[i];
+  }
+}
+
+static int KFN(geti)(int type, void *p, DL_SIZE i)
+{
+  if (type == DF_LONG) return ((int *) p)[i];
+  return ((short *) p)[i];
+}
+
+/*
+ * Loop bodies, specialised on the operation so that no call or switch
+ * is left inside the vector loop.  a and b hold the broadcast value
+ * on entry for copymode 1 / 2.
+ */
+
+#ifndef DLSIMD_KERN_LOOPS
+#define DLSIMD_KERN_LOOPS
+
+#define DLSIMD_VLOOP(STEP, LA, LB, STORE)				\
+  for (i = 0; i + (STEP) <= n; i += (STEP)) {				\
+    if (copymode != 1) a = LA;						\
+    if (copymode != 2) b = LB;						\
+    STORE;								\
+  }
+
+/* float operands; float/float avoids the per vector type test */
+#define DLSIMD_FLOOP(RESULT, STORE)					\
+  if (t1 == DF_FLOAT && t2 == DF_FLOAT) {				\
+    DLSIMD_VLOOP(W, VF_LOAD((float *) v1 + i), VF_LOAD((float *) v2 + i), \
+		 STORE(RESULT));					\
+  }									\
+  else {								\
+    DLSIMD_VLOOP(W, KFN(loadf)(t1, v1, i), KFN(loadf)(t2, v2, i),	\
+		 STORE(RESULT));					\
+  }
+
+/* int operands (or shorts widened to int) */
+#define DLSIMD_ILOOP(RESULT, STORE)					\
+  if (t1 == DF_LONG) {							\
+    DLSIMD_VLOOP(W, VI_LOAD((int *) v1 + i), VI_LOAD((int *) v2 + i),	\
+		 STORE(RESULT));					\
+  }									\
+  else {								\
+    DLSIMD_VLOOP(W, VI_LOADS16((short *) v1 + i),			\
+		 VI_LOADS16((short *) v2 + i), STORE(RESULT));		\
+  }
+
+/* same type integer operands, SIZE bytes each */
+#define DLSIMD_NLOOP(SIZE, RESULT)					\
+  DLSIMD_VLOOP(VBYTES / (SIZE), VI_LOAD(p1 + i * (SIZE)),		\
+	       VI_LOAD(p2 + i * (SIZE)), VI_STORE(po + i * (SIZE), RESULT))
+
+#define DLSIMD_FSTORE(r)   VF_STORE(out + i, r)
+#define DLSIMD_ISTORE(r)   VI_STORE(out + i, r)
+
+/* float arithmetic: division by 0 gives 0 as in the scalar code */
+#define DLSIMD_FDIV(a,b)   VF_AND(VF_DIV(a, b), VF_CMPNE(b, VF_ZERO()))
+
+/* int min / max from a compare and select */
+#define DLSIMD_SEL(m,a,b)  VI_OR(VI_AND(m, a), VI_ANDNOT(m, b))
+#define DLSIMD_MIN32(a,b)  DLSIMD_SEL(VI_CMPGT32(b, a), a, b)
+#define DLSIMD_MAX32(a,b)  DLSIMD_SEL(VI_CMPGT32(a, b), a, b)
+
+/* masks to 0/1 ints */
+#define DLSIMD_FTRUE(m)    VI_AND(VF_ASI(m), one)
+#define DLSIMD_ITRUE(m)    VI_AND(m, one)
+#define DLSIMD_IFALSE(m)   VI_XOR(VI_AND(m, one), one)
+
+#endif /* DLSIMD_KERN_LOOPS */
+
+/*
+ * Float results: float op float, and float with int or short on
+ * either side (the integer operand is converted to float first, as
+ * the scalar code does)
+ */
+
+KTARGET static VF KFN(fop)(int func, VF a, VF b)
+{
+  switch (func) {
+  case DL_MATH_ADD: return VF_ADD(a, b);
+  case DL_MATH_SUB: return VF_SUB(a, b);
+  case DL_MATH_MUL: return VF_MUL(a, b);
+  case DL_MATH_DIV: return DLSIMD_FDIV(a, b);
+  case DL_MATH_MIN: return VF_MIN(a, b);
+  default:          return VF_MAX(a, b);
+  }
+}
+
+KTARGET static int KFN(arith_float)(int func, int copymode, DL_SIZE n,
+				    int t1, void *v1, int t2, void *v2,
+				    float *out)
+{
+  DL_SIZE i, j;
+  VF a, b;
+  float pa[W], pb[W], pr[W];
+
+  a = VF_SET1(KFN(getf)(t1, v1, 0));
+  b = VF_SET1(KFN(getf)(t2, v2, 0));
+  switch (func) {
+  case DL_MATH_ADD: DLSIMD_FLOOP(VF_ADD(a, b), DLSIMD_FSTORE); break;
+  case DL_MATH_SUB: DLSIMD_FLOOP(VF_SUB(a, b), DLSIMD_FSTORE); break;
+  case DL_MATH_MUL: DLSIMD_FLOOP(VF_MUL(a, b), DLSIMD_FSTORE); break;
+  case DL_MATH_DIV: DLSIMD_FLOOP(DLSIMD_FDIV(a, b), DLSIMD_FSTORE); break;
+  case DL_MATH_MIN: DLSIMD_FLOOP(VF_MIN(a, b), DLSIMD_FSTORE); break;
+  case DL_MATH_MAX: DLSIMD_FLOOP(VF_MAX(a, b), DLSIMD_FSTORE); break;
+  default:
+    return 0;
+  }
+  if (i < n) {
+    for (j = 0; j < W; j++) {
+      pa[j] = (copymode == 1) ? KFN(getf)(t1, v1, 0) :
+	(i + j < n ? KFN(getf)(t1, v1, i + j) : 0.0f);
+      pb[j] = (copymode == 2) ? KFN(getf)(t2, v2, 0) :
+	(i + j < n ? KFN(getf)(t2, v2, i + j) : 0.0f);
+    }
+    VF_STORE(pr, KFN(fop)(func, VF_LOAD(pa), VF_LOAD(pb)));
+    for (j = 0; i + j < n; j++) out[i + j] = pr[j];
+  }
+  return 1;
+}
+
+/*
+ * Integer results of the same type: int (W lanes), short (2W lanes)
+ * and char (4W lanes).  Integer division has no vector instruction
+ * and is left to the scalar code, as are char mul / min / max.
+ */
+
+KTARGET static VI KFN(iop)(int type, int func, VI a, VI b)
+{
+  switch (type) {
+  case DF_LONG:
+    switch (func) {
+    case DL_MATH_ADD: return VI_ADD32(a, b);
+    case DL_MATH_SUB: return VI_SUB32(a, b);
+#if HAVE_MULLO32
+    case DL_MATH_MUL: return VI_MULLO32(a, b);
+#endif
+    case DL_MATH_MIN: return DLSIMD_MIN32(a, b);
+    default:          return DLSIMD_MAX32(a, b);
+    }
+  case DF_SHORT:
+    switch (func) {
+    case DL_MATH_ADD: return VI_ADD16(a, b);
+    case DL_MATH_SUB: return VI_SUB16(a, b);
+    case DL_MATH_MUL: return VI_MULLO16(a, b);
+    case DL_MATH_MIN: return VI_MIN16(a, b);
+    default:          return VI_MAX16(a, b);
+    }
+  default:
+    if (func == DL_MATH_ADD) return VI_ADD8(a, b);
+    return VI_SUB8(a, b);
+  }
+}
+
+KTARGET static int KFN(arith_int)(int func, int copymode, DL_SIZE n,
+				  int type, void *v1, void *v2, void *out)
+{
+  DL_SIZE i;
+  size_t size;
+  char *p1 = (char *) v1, *p2 = (char *) v2, *po = (char *) out;
+  char pa[VBYTES], pb[VBYTES], pr[VBYTES];
+  VI a, b;
+
+  switch (type) {
+  case DF_LONG:
+    size = sizeof(int);
+    a = VI_SET1_32(((int *) v1)[0]);
+    b = VI_SET1_32(((int *) v2)[0]);
+    switch (func) {
+    case DL_MATH_ADD: DLSIMD_NLOOP(4, VI_ADD32(a, b)); break;
+    case DL_MATH_SUB: DLSIMD_NLOOP(4, VI_SUB32(a, b)); break;
+#if HAVE_MULLO32
+    case DL_MATH_MUL: DLSIMD_NLOOP(4, VI_MULLO32(a, b)); break;
+#endif
+    case DL_MATH_MIN: DLSIMD_NLOOP(4, DLSIMD_MIN32(a, b)); break;
+    case DL_MATH_MAX: DLSIMD_NLOOP(4, DLSIMD_MAX32(a, b)); break;
+    default:
+      return 0;
+    }
+    break;
+  case DF_SHORT:
+    size = sizeof(short);
+    a = VI_SET1_16(((short *) v1)[0]);
+    b = VI_SET1_16(((short *) v2)[0]);
+    switch (func) {
+    case DL_MATH_ADD: DLSIMD_NLOOP(2, VI_ADD16(a, b)); break;
+    case DL_MATH_SUB: DLSIMD_NLOOP(2, VI_SUB16(a, b)); break;
+    case DL_MATH_MUL: DLSIMD_NLOOP(2, VI_MULLO16(a, b)); break;
+    case DL_MATH_MIN: DLSIMD_NLOOP(2, VI_MIN16(a, b)); break;
+    case DL_MATH_MAX: DLSIMD_NLOOP(2, VI_MAX16(a, b)); break;
+    default:
+      return 0;
+    }
+    break;
+  case DF_CHAR:
+    size = sizeof(char);
+    a = VI_SET1_8(((char *) v1)[0]);
+    b = VI_SET1_8(((char *) v2)[0]);
+    switch (func) {
+    case DL_MATH_ADD: DLSIMD_NLOOP(1, VI_ADD8(a, b)); break;
+    case DL_MATH_SUB: DLSIMD_NLOOP(1, VI_SUB8(a, b)); break;
+    default:
+      return 0;
+    }
+    break;
+  default:
+    return 0;
+  }
+
+  if (i < n) {
+    memset(pa, 0, VBYTES);
+    memset(pb, 0, VBYTES);
+    if (copymode != 1) memcpy(pa, p1 + i * size, (n - i) * size);
+    if (copymode != 2) memcpy(pb, p2 + i * size, (n - i) * size);
+    if (copymode != 1) a = VI_LOAD(pa);
+    if (copymode != 2) b = VI_LOAD(pb);
+    VI_STORE(pr, KFN(iop)(type, func, a, b));
+    memcpy(po + i * size, pr, (n - i) * size);
+  }
+  return 1;
+}
+
+/*
+ * Relations: masks are turned into 0/1 ints.  Float compares follow C
+ * (every compare with a NaN is false except !=), and a NaN counts as
+ * true for && / || since it is not zero.
+ */
+
+KTARGET static VI KFN(frel)(int op, VF a, VF b)
+{
+  VF z = VF_ZERO();
+  VI one = VI_SET1_32(1);
+  switch (op) {
+  case DL_RELATION_OR:
+    return DLSIMD_FTRUE(VF_OR(VF_CMPNE(a, z), VF_CMPNE(b, z)));
+  case DL_RELATION_AND:
+    return DLSIMD_FTRUE(VF_AND(VF_CMPNE(a, z), VF_CMPNE(b, z)));
+  case DL_RELATION_EQ:  return DLSIMD_FTRUE(VF_CMPEQ(a, b));
+  case DL_RELATION_NE:  return DLSIMD_FTRUE(VF_CMPNE(a, b));
+  case DL_RELATION_LT:  return DLSIMD_FTRUE(VF_CMPLT(a, b));
+  case DL_RELATION_LTE: return DLSIMD_FTRUE(VF_CMPLE(a, b));
+  case DL_RELATION_GT:  return DLSIMD_FTRUE(VF_CMPGT(a, b));
+  default:              return DLSIMD_FTRUE(VF_CMPGE(a, b));
+  }
+}
+
+KTARGET static VI KFN(irel)(int op, VI a, VI b)
+{
+  VI z = VI_SET1_32(0), one = VI_SET1_32(1);
+  switch (op) {
+  case DL_RELATION_OR:
+    return DLSIMD_IFALSE(VI_AND(VI_CMPEQ32(a, z), VI_CMPEQ32(b, z)));
+  case DL_RELATION_AND:
+    return DLSIMD_IFALSE(VI_OR(VI_CMPEQ32(a, z), VI_CMPEQ32(b, z)));
+  case DL_RELATION_EQ:  return DLSIMD_ITRUE(VI_CMPEQ32(a, b));
+  case DL_RELATION_NE:  return DLSIMD_IFALSE(VI_CMPEQ32(a, b));
+  case DL_RELATION_LT:  return DLSIMD_ITRUE(VI_CMPGT32(b, a));
+  case DL_RELATION_LTE: return DLSIMD_IFALSE(VI_CMPGT32(a, b));
+  case DL_RELATION_GT:  return DLSIMD_ITRUE(VI_CMPGT32(a, b));
+  default:              return DLSIMD_IFALSE(VI_CMPGT32(b, a));
+  }
+}
+
+KTARGET static int KFN(relation)(int op, int copymode, DL_SIZE n,
+				 int t1, void *v1, int t2, void *v2,
+				 int *out)
+{
+  DL_SIZE i, j;
+  int pr[W];
+  VI one = VI_SET1_32(1);
+
+  if (t1 == DF_FLOAT || t2 == DF_FLOAT) {
+    float pa[W], pb[W];
+    VF z = VF_ZERO();
+    VF a = VF_SET1(KFN(getf)(t1, v1, 0));
+    VF b = VF_SET1(KFN(getf)(t2, v2, 0));
+    switch (op) {
+    case DL_RELATION_OR:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_OR(VF_CMPNE(a, z), VF_CMPNE(b, z))),
+		   DLSIMD_ISTORE);
+      break;
+    case DL_RELATION_AND:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_AND(VF_CMPNE(a, z), VF_CMPNE(b, z))),
+		   DLSIMD_ISTORE);
+      break;
+    case DL_RELATION_EQ:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_CMPEQ(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_NE:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_CMPNE(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_LT:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_CMPLT(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_LTE:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_CMPLE(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_GT:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_CMPGT(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_GTE:
+      DLSIMD_FLOOP(DLSIMD_FTRUE(VF_CMPGE(a, b)), DLSIMD_ISTORE); break;
+    default:
+      return 0;
+    }
+    if (i < n) {
+      for (j = 0; j < W; j++) {
+	pa[j] = (copymode == 1) ? KFN(getf)(t1, v1, 0) :
+	  (i + j < n ? KFN(getf)(t1, v1, i + j) : 0.0f);
+	pb[j] = (copymode == 2) ? KFN(getf)(t2, v2, 0) :
+	  (i + j < n ? KFN(getf)(t2, v2, i + j) : 0.0f);
+      }
+      VI_STORE(pr, KFN(frel)(op, VF_LOAD(pa), VF_LOAD(pb)));
+      for (j = 0; i + j < n; j++) out[i + j] = pr[j];
+    }
+  }
+  else {
+    int pa[W], pb[W];
+    VI z = VI_SET1_32(0);
+    VI a = VI_SET1_32(KFN(geti)(t1, v1, 0));
+    VI b = VI_SET1_32(KFN(geti)(t2, v2, 0));
+    switch (op) {
+    case DL_RELATION_OR:
+      DLSIMD_ILOOP(DLSIMD_IFALSE(VI_AND(VI_CMPEQ32(a, z), VI_CMPEQ32(b, z))),
+		   DLSIMD_ISTORE);
+      break;
+    case DL_RELATION_AND:
+      DLSIMD_ILOOP(DLSIMD_IFALSE(VI_OR(VI_CMPEQ32(a, z), VI_CMPEQ32(b, z))),
+		   DLSIMD_ISTORE);
+      break;
+    case DL_RELATION_EQ:
+      DLSIMD_ILOOP(DLSIMD_ITRUE(VI_CMPEQ32(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_NE:
+      DLSIMD_ILOOP(DLSIMD_IFALSE(VI_CMPEQ32(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_LT:
+      DLSIMD_ILOOP(DLSIMD_ITRUE(VI_CMPGT32(b, a)), DLSIMD_ISTORE); break;
+    case DL_RELATION_LTE:
+      DLSIMD_ILOOP(DLSIMD_IFALSE(VI_CMPGT32(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_GT:
+      DLSIMD_ILOOP(DLSIMD_ITRUE(VI_CMPGT32(a, b)), DLSIMD_ISTORE); break;
+    case DL_RELATION_GTE:
+      DLSIMD_ILOOP(DLSIMD_IFALSE(VI_CMPGT32(b, a)), DLSIMD_ISTORE); break;
+    default:
+      return 0;
+    }
+    if (i < n) {
+      for (j = 0; j < W; j++) {
+	pa[j] = (copymode == 1) ? KFN(geti)(t1, v1, 0) :
+	  (i + j < n ? KFN(geti)(t1, v1, i + j) : 0);
+	pb[j] = (copymode == 2) ? KFN(geti)(t2, v2, 0) :
+	  (i + j < n ? KFN(geti)(t2, v2, i + j) : 0);
+      }
+      VI_STORE(pr, KFN(irel)(op, VI_LOAD(pa), VI_LOAD(pb)));
+      for (j = 0; i + j < n; j++) out[i + j] = pr[j];
+    }
+  }
+  return 1;
+}
+
+/*
+ * One argument math functions on float lists.  sqrt and fabs are
+ * exact.  exp, log and sin are the Cephes single precision
+ * approximations (a few ulp); a vector holding any value outside the
+ * range where they hold (or a NaN / inf) is done with libm instead.
+ */
+
+KTARGET static VF KFN(expf)(VF x)
+{
+  VF one = VF_SET1(1.0f), t, y, z;
+  VI n;
+
+  t = VF_ADD(VF_MUL(x, VF_SET1(1.44269504088896341f)), VF_SET1(0.5f));
+  z = VF_FROMI(VF_TOI(t));	/* floor(t) */
+  t = VF_SUB(z, VF_AND(VF_CMPGT(z, t), one));
+  x = VF_SUB(x, VF_MUL(t, VF_SET1(0.693359375f)));
+  x = VF_SUB(x, VF_MUL(t, VF_SET1(-2.12194440e-4f)));
+  z = VF_MUL(x, x);
+  y = VF_SET1(1.9875691500E-4f);
+  y = VF_ADD(VF_MUL(y, x), VF_SET1(1.3981999507E-3f));
+  y = VF_ADD(VF_MUL(y, x), VF_SET1(8.3334519073E-3f));
+  y = VF_ADD(VF_MUL(y, x), VF_SET1(4.1665795894E-2f));
+  y = VF_ADD(VF_MUL(y, x), VF_SET1(1.6666665459E-1f));
+  y = VF_ADD(VF_MUL(y, x), VF_SET1(5.0000001201E-1f));
+  y = VF_ADD(VF_ADD(VF_MUL(y, z), x), one);
+  n = VI_SLLI32(VI_ADD32(VF_TOI(t), VI_SET1_32(127)), 23);
+  return VF_MUL(y, VI_ASF(n));
+}
+
+KTARGET static VF KFN(logf)(VF x)
+{
+  VF one = VF_SET1(1.0f), e, m, y, z;
+  VI xi = VF_ASI(x);
+
+  e = VF_FROMI(VI_SUB32(VI_SRLI32(xi, 23), VI_SET1_32(126)));
+  m = VI_ASF(VI_OR(VI_AND(xi, VI_SET1_32(0x007fffff)),
+		   VI_SET1_32(0x3f000000)));	/* [0.5, 1) */
+  z = VF_CMPLT(m, VF_SET1(0.707106781186547524f));
+  y = VF_AND(m, z);
+  m = VF_ADD(VF_SUB(m, one), y);
+  e = VF_SUB(e, VF_AND(one, z));
+  z = VF_MUL(m, m);
+  y = VF_SET1(7.0376836292E-2f);
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(-1.1514610310E-1f));
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(1.1676998740E-1f));
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(-1.2420140846E-1f));
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(1.4249322787E-1f));
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(-1.6668057665E-1f));
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(2.0000714765E-1f));
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(-2.4999993993E-1f));
+  y = VF_ADD(VF_MUL(y, m), VF_SET1(3.3333331174E-1f));
+  y = VF_MUL(VF_MUL(y, m), z);
+  y = VF_ADD(y, VF_MUL(e, VF_SET1(-2.12194440e-4f)));
+  y = VF_SUB(y, VF_MUL(z, VF_SET1(0.5f)));
+  m = VF_ADD(m, y);
+  return VF_ADD(m, VF_MUL(e, VF_SET1(0.693359375f)));
+}
+
+KTARGET static VF KFN(sinf)(VF x)
+{
+  VF sign, y, z, c, s, poly;
+  VI j;
+
+  sign = VF_AND(x, VI_ASF(VI_SET1_32((int) 0x80000000)));
+  x = VF_ANDNOT(VI_ASF(VI_SET1_32((int) 0x80000000)), x);
+  j = VF_TOI(VF_MUL(x, VF_SET1(1.27323954473516f)));
+  j = VI_AND(VI_ADD32(j, VI_SET1_32(1)), VI_SET1_32(~1));
+  y = VF_FROMI(j);
+  sign = VF_XOR(sign, VI_ASF(VI_SLLI32(VI_AND(j, VI_SET1_32(4)), 29)));
+  poly = VI_ASF(VI_CMPEQ32(VI_AND(j, VI_SET1_32(2)), VI_SET1_32(0)));
+  x = VF_ADD(x, VF_MUL(y, VF_SET1(-0.78515625f)));
+  x = VF_ADD(x, VF_MUL(y, VF_SET1(-2.4187564849853515625e-4f)));
+  x = VF_ADD(x, VF_MUL(y, VF_SET1(-3.77489497744594108e-8f)));
+  z = VF_MUL(x, x);
+  c = VF_SET1(2.443315711809948E-005f);
+  c = VF_ADD(VF_MUL(c, z), VF_SET1(-1.388731625493765E-003f));
+  c = VF_ADD(VF_MUL(c, z), VF_SET1(4.166664568298827E-002f));
+  c = VF_MUL(VF_MUL(c, z), z);
+  c = VF_SUB(c, VF_MUL(z, VF_SET1(0.5f)));
+  c = VF_ADD(c, VF_SET1(1.0f));
+  s = VF_SET1(-1.9515295891E-4f);
+  s = VF_ADD(VF_MUL(s, z), VF_SET1(8.3321608736E-3f));
+  s = VF_ADD(VF_MUL(s, z), VF_SET1(-1.6666654611E-1f));
+  s = VF_ADD(VF_MUL(VF_MUL(s, z), x), x);
+  y = VF_OR(VF_AND(poly, s), VF_ANDNOT(poly, c));
+  return VF_XOR(y, sign);
+}
+
+/* all lanes inside the range where the approximation holds? */
+KTARGET static int KFN(indomain)(int func_id, VF x)
+{
+  VF m;
+  switch (func_id) {
+  case DL_EXP:
+    m = VF_AND(VF_CMPLE(x, VF_SET1(87.0f)), VF_CMPGE(x, VF_SET1(-87.0f)));
+    break;
+  case DL_LOG:
+    m = VF_AND(VF_CMPGE(x, VF_SET1(FLT_MIN)), VF_CMPLE(x, VF_SET1(FLT_MAX)));
+    break;
+  default:
+    m = VF_AND(VF_CMPLE(x, VF_SET1(8192.0f)), VF_CMPGE(x, VF_SET1(-8192.0f)));
+    break;
+  }
+  return VF_MOVEMASK(m) == VF_ALLMASK;
+}
+
+KTARGET static void KFN(mblock)(int func_id, float *in, float *out)
+{
+  int j;
+  VF x = VF_LOAD(in);
+  if (KFN(indomain)(func_id, x)) {
+    switch (func_id) {
+    case DL_EXP: VF_STORE(out, KFN(expf)(x)); break;
+    case DL_LOG: VF_STORE(out, KFN(logf)(x)); break;
+    default:     VF_STORE(out, KFN(sinf)(x)); break;
+    }
+    return;
+  }
+  for (j = 0; j < W; j++) {
+    switch (func_id) {
+    case DL_EXP: out[j] = (float) exp((double) in[j]); break;
+    case DL_LOG: out[j] = (float) log((double) in[j]); break;
+    default:     out[j] = (float) sin((double) in[j]); break;
+    }
+  }
+}
+
+KTARGET static int KFN(math1)(int func_id, DL_SIZE n, float *in, float *out)
+{
+  DL_SIZE i, j;
+  float pa[W], pr[W];
+  VF sign = VI_ASF(VI_SET1_32((int) 0x80000000));
+
+  switch (func_id) {
+  case DL_SQRT:
+    for (i = 0; i + W <= n; i += W)
+      VF_STORE(out + i, VF_SQRT(VF_LOAD(in + i)));
+    break;
+  case DL_ABS:
+    for (i = 0; i + W <= n; i += W)
+      VF_STORE(out + i, VF_ANDNOT(sign, VF_LOAD(in + i)));
+    break;
+  default:
+    for (i = 0; i + W <= n; i += W)
+      KFN(mblock)(func_id, in + i, out + i);
+    break;
+  }
+  if (i < n) {
+    for (j = 0; j < W; j++) pa[j] = (i + j < n) ? in[i + j] : 1.0f;
+    switch (func_id) {
+    case DL_SQRT: VF_STORE(pr, VF_SQRT(VF_LOAD(pa))); break;
+    case DL_ABS:  VF_STORE(pr, VF_ANDNOT(sign, VF_LOAD(pa))); break;
+    default:      KFN(mblock)(func_id, pa, pr); break;
+    }
+    for (j = 0; i + j < n; j++) out[i + j] = pr[j];
+  }
+  return 1;
+}
+
+/*
+ * Histogram bins.  Each vector of values is split into two halves of
+ * double lanes, so the bin arithmetic is the same double arithmetic as
+ * DL_HIST_BIN_LOOP in dlhist.c.  k holds start, stop, width, inv,
+ * tol, 1, the last bin and the out of range bin, broadcast.
+ */
+
+#ifndef DLSIMD_KERN_HIST
+#define DLSIMD_KERN_HIST
+
+#define DLSIMD_HBIN(X, R)						\
+  in = VD_AND(VD_CMPGE(X, k0), VD_CMPLT(X, k1));			\
+  r = VD_SUB(X, k0);							\
+  q = VD_MUL(r, k3);							\
+  t = VD_FROMH(VD_TOH(q));						\
+  near = VD_OR(VD_CMPLT(VD_SUB(q, t), k4),				\
+	       VD_CMPLT(VD_SUB(VD_ADD(t, k5), q), k4));			\
+  if (VD_MOVEMASK(VD_AND(in, near))) q = VD_DIV(r, k2);			\
+  q = VD_MIN(q, k6);							\
+  R = VD_TOH(VD_OR(VD_AND(in, q), VD_ANDNOT(in, k7)))
+
+#define DLSIMD_HLOOP(LOAD, LO, HI)					\
+  for (i = 0; i + W <= n; i += W) {					\
+    LOAD;								\
+    DLSIMD_HBIN(LO, lo);						\
+    DLSIMD_HBIN(HI, hi);						\
+    VI_STORE(out + i, VI_FROMH(lo, hi));				\
+  }
+
+#endif
+
+KTARGET static void KFN(hrun)(int type, void *p, DL_SIZE n, int *out,
+			      VD *k)
+{
+  DL_SIZE i;
+  VD k0 = k[0], k1 = k[1], k2 = k[2], k3 = k[3];
+  VD k4 = k[4], k5 = k[5], k6 = k[6], k7 = k[7];
+  VD in, r, q, t, near;
+  VH lo, hi;
+  VF f;
+  VI v;
+
+  switch (type) {
+  case DF_FLOAT:
+    DLSIMD_HLOOP(f = VF_LOAD((float *) p + i), VF_LOD(f), VF_HID(f));
+    break;
+  case DF_LONG:
+    DLSIMD_HLOOP(v = VI_LOAD((int *) p + i), VI_LOD(v), VI_HID(v));
+    break;
+  default:
+    DLSIMD_HLOOP(v = VI_LOADS16((short *) p + i), VI_LOD(v), VI_HID(v));
+    break;
+  }
+}
+
+KTARGET static int KFN(histbins)(int type, DL_SIZE n, void *vals,
+				 double start, double stop, double width,
+				 double inv, double tol, int nbins, int *bins)
+{
+  DL_SIZE i, j;
+  VD k[8];
+  int pr[W];
+  union { float f[W]; int i[W]; short s[W]; } pa;
+
+  k[0] = VD_SET1(start);
+  k[1] = VD_SET1(stop);
+  k[2] = VD_SET1(width);
+  k[3] = VD_SET1(inv);
+  k[4] = VD_SET1(tol);
+  k[5] = VD_SET1(1.0);
+  k[6] = VD_SET1((double) (nbins-1));
+  k[7] = VD_SET1((double) nbins);
+
+  KFN(hrun)(type, vals, n, bins, k);
+  i = n - n%W;
+  if (i < n) {
+    memset(&pa, 0, sizeof(pa));
+    for (j = 0; i + j < n; j++) {
+      switch (type) {
+      case DF_FLOAT: pa.f[j] = ((float *) vals)[i + j]; break;
+      case DF_LONG:  pa.i[j] = ((int *) vals)[i + j];   break;
+      default:       pa.s[j] = ((short *) vals)[i + j]; break;
+      }
+    }
+    KFN(hrun)(type, &pa, W, pr, k);
+    for (j = 0; i + j < n; j++) bins[i + j] = pr[j];
+  }
+  return 1;
+}
+
+/*
+ * Matrix product panel: c (mr x nc doubles) += a (mr x kc) * b (kc x nc),
+ * four rows of a at a time.  Products are taken in float and added to
+ * the double sums in ascending k, so every element is the sum the
+ * plain loop (sum += a[k]*b[k]) gives; columns past the last whole
+ * vector use that loop.
+ */
+
+#ifndef DLSIMD_GEMM_STEP
+#define DLSIMD_GEMM_STEP(A, L, H)					\
+  p = VF_MUL(VF_SET1((A)[k]), f);					\
+  L = VD_ADD(L, VF_LOD(p));						\
+  H = VD_ADD(H, VF_HID(p))
+#endif
+
+KTARGET static int KFN(gemm)(int mr, int nc, int kc, const float *a,
+			     int lda, const float *b, int ldb, double *c,
+			     int ldc)
+{
+  int i, j, k, r;
+  const float *a0, *a1, *a2, *a3;
+  double *c0, *c1, *c2, *c3, sum;
+  VD l0, h0, l1, h1, l2, h2, l3, h3;
+  VF f, p;
+
+  for (i = 0; i + 4 <= mr; i += 4) {
+    a0 = a + (size_t) i*lda; a1 = a0 + lda; a2 = a1 + lda; a3 = a2 + lda;
+    c0 = c + (size_t) i*ldc; c1 = c0 + ldc; c2 = c1 + ldc; c3 = c2 + ldc;
+    for (j = 0; j + W <= nc; j += W) {
+      l0 = VD_LOAD(c0 + j); h0 = VD_LOAD(c0 + j + W/2);
+      l1 = VD_LOAD(c1 + j); h1 = VD_LOAD(c1 + j + W/2);
+      l2 = VD_LOAD(c2 + j); h2 = VD_LOAD(c2 + j + W/2);
+      l3 = VD_LOAD(c3 + j); h3 = VD_LOAD(c3 + j + W/2);
+      for (k = 0; k < kc; k++) {
+	f = VF_LOAD(b + (size_t) k*ldb + j);
+	DLSIMD_GEMM_STEP(a0, l0, h0);
+	DLSIMD_GEMM_STEP(a1, l1, h1);
+	DLSIMD_GEMM_STEP(a2, l2, h2);
+	DLSIMD_GEMM_STEP(a3, l3, h3);
+      }
+      VD_STORE(c0 + j, l0); VD_STORE(c0 + j + W/2, h0);
+      VD_STORE(c1 + j, l1); VD_STORE(c1 + j + W/2, h1);
+      VD_STORE(c2 + j, l2); VD_STORE(c2 + j + W/2, h2);
+      VD_STORE(c3 + j, l3); VD_STORE(c3 + j + W/2, h3);
+    }
+  }
+  for (; i < mr; i++) {
+    a0 = a + (size_t) i*lda;
+    c0 = c + (size_t) i*ldc;
+    for (j = 0; j + W <= nc; j += W) {
+      l0 = VD_LOAD(c0 + j); h0 = VD_LOAD(c0 + j + W/2);
+      for (k = 0; k < kc; k++) {
+	f = VF_LOAD(b + (size_t) k*ldb + j);
+	DLSIMD_GEMM_STEP(a0, l0, h0);
+      }
+      VD_STORE(c0 + j, l0); VD_STORE(c0 + j + W/2, h0);
+    }
+  }
+  if (nc % W) {
+    for (r = 0; r < mr; r++) {
+      a0 = a + (size_t) r*lda;
+      c0 = c + (size_t) r*ldc;
+      for (j = nc - nc%W; j < nc; j++) {
+	for (sum = c0[j], k = 0; k < kc; k++)
+	  sum += a0[k] * b[(size_t) k*ldb + j];
+	c0[j] = sum;
+      }
+    }
+  }
+  return 1;
+}
+
+/*
+ * Philox4x32-10 blocks, one per lane.  The 32 x 32 -> 64 bit products
+ * are taken for the even lanes and (shifted down) the odd lanes, then
+ * their low and high halves are put back together lane by lane.  The
+ * words come out the same as rngBlock in dlrng.c.
+ */
+
+#ifndef DLSIMD_MULHILO
+#define DLSIMD_PHILOX_M0 0xD2511F53u
+#define DLSIMD_PHILOX_M1 0xCD9E8D57u
+#define DLSIMD_PHILOX_W0 0x9E3779B9u
+#define DLSIMD_PHILOX_W1 0xBB67AE85u
+#define DLSIMD_MULHILO(M, C, LO, HI)					\
+  pe = VI_MULEU32(C, M);						\
+  po = VI_MULEU32(VI_SRLI64(C, 32), M);				\
+  LO = VI_OR(VI_AND(pe, lomask), VI_SLLI64(po, 32));			\
+  HI = VI_OR(VI_SRLI64(pe, 32), VI_ANDNOT(lomask, po))
+#endif
+
+KTARGET static DL_SIZE KFN(philox)(const unsigned int *key,
+				   const unsigned int *stream,
+				   DL_SIZE first, unsigned int attempt,
+				   DL_SIZE n, unsigned int *out)
+{
+  DL_SIZE b, index;
+  int l, r;
+  unsigned int lanes[4][W];
+  VI c0, c1, c2, c3, k0, k1, lo0, hi0, lo1, hi1, pe, po;
+  VI m0 = VI_SET1_32((int) DLSIMD_PHILOX_M0);
+  VI m1 = VI_SET1_32((int) DLSIMD_PHILOX_M1);
+  VI w0 = VI_SET1_32((int) DLSIMD_PHILOX_W0);
+  VI w1 = VI_SET1_32((int) DLSIMD_PHILOX_W1);
+  VI lomask = VI_SET1_64(0xffffffffLL);
+
+  for (b = 0; b + W <= n; b += W) {
+    for (l = 0; l < W; l++) {
+      index = first + b + l;
+      lanes[0][l] = (unsigned int) index;
+      lanes[1][l] = (unsigned int) (index >> 32) + (attempt << 16);
+    }
+    c0 = VI_LOAD(lanes[0]);
+    c1 = VI_LOAD(lanes[1]);
+    c2 = VI_SET1_32((int) stream[0]);
+    c3 = VI_SET1_32((int) stream[1]);
+    k0 = VI_SET1_32((int) key[0]);
+    k1 = VI_SET1_32((int) key[1]);
+    for (r = 0; r < 10; r++) {
+      DLSIMD_MULHILO(m0, c0, lo0, hi0);
+      DLSIMD_MULHILO(m1, c2, lo1, hi1);
+      c0 = VI_XOR(VI_XOR(hi1, c1), k0);
+      c1 = lo1;
+      c2 = VI_XOR(VI_XOR(hi0, c3), k1);
+      c3 = lo0;
+      k0 = VI_ADD32(k0, w0);
+      k1 = VI_ADD32(k1, w1);
+    }
+    VI_STORE(lanes[0], c0);
+    VI_STORE(lanes[1], c1);
+    VI_STORE(lanes[2], c2);
+    VI_STORE(lanes[3], c3);
+    for (l = 0; l < W; l++) {
+      out[4*(b+l)]   = lanes[0][l];
+      out[4*(b+l)+1] = lanes[1][l];
+      out[4*(b+l)+2] = lanes[2][l];
+      out[4*(b+l)+3] = lanes[3][l];
+    }
+  }
+  return b;
+}
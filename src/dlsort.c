@@ -0,0 +1,413 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlsort.c
+ *
+ *  DESCRIPTION
+ *    LSD radix sorts of int, short, char and float lists, replacing
+ *  qsort with comparator callbacks in dynListSortList and
+ *  dynListSortListIndices.  Values are mapped to unsigned keys that
+ *  sort in the same order (sign bit flipped for integers, all bits
+ *  flipped for negative floats), then sorted one byte per pass,
+ *  skipping bytes that are the same for every key.  Index sorts carry
+ *  the original positions along with the keys, so they are stable.
+ *
+ *  Lists of at least dlThreadsThreshold() elements are split into one
+ *  run per thread (see dlthread.c); the runs are radix sorted in
+ *  parallel and then merged pairwise, each merge split at equal
+ *  output positions ("merge path") so every thread takes part in
+ *  every round.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "df.h"
+#include "dlsort.h"
+#include "dlthread.h"
+
+#define DL_SORT_MIN_SEGMENT 16384  /* smallest piece of a parallel merge */
+
+typedef struct {
+  uint32_t *keys, *ktmp;	/* keys and scratch space                */
+  int *idx, *itmp;		/* payload (indices) or NULL             */
+  int nbytes;			/* significant low order bytes of keys   */
+  DL_SIZE *bounds;		/* run boundaries, nruns+1               */
+  /* current merge round */
+  uint32_t *ksrc, *kdst;
+  int *isrc, *idst;
+  DL_SIZE *tasks;		/* lo, mid, hi, d0, d1 for each task     */
+} DL_SORT_JOB;
+
+
+/*
+ * Keys
+ */
+
+static uint32_t dlSortFloatKey(uint32_t u)
+{
+  if ((u & 0x7fffffff) > 0x7f800000) return 0xffffffff; /* NaN last  */
+  if (u == 0x80000000) u = 0;	                      /* -0 == 0      */
+  return (u & 0x80000000) ? ~u : (u | 0x80000000);
+}
+
+static uint32_t dlSortFloatFromKey(uint32_t k)
+{
+  return (k & 0x80000000) ? (k & 0x7fffffff) : ~k;
+}
+
+/*
+ * Fill keys from vals, returning the number of bytes to sort on (0
+ * for an unsupported type).  *exact is cleared if the keys can't be
+ * turned back into the same float bits (-0 or NaN present).
+ */
+
+static int dlSortMakeKeys(int datatype, DL_SIZE n, void *vals,
+			  uint32_t *keys, int *exact)
+{
+  DL_SIZE i;
+  *exact = 1;
+  switch (datatype) {
+  case DF_LONG:
+    {
+      int *v = (int *) vals;
+      for (i = 0; i < n; i++) keys[i] = (uint32_t) v[i] ^ 0x80000000;
+    }
+    return 4;
+  case DF_SHORT:
+    {
+      short *v = (short *) vals;
+      for (i = 0; i < n; i++) keys[i] = (uint16_t) v[i] ^ 0x8000;
+    }
+    return 2;
+  case DF_CHAR:
+    {
+      unsigned char *v = (unsigned char *) vals;
+#if CHAR_MIN < 0
+      for (i = 0; i < n; i++) keys[i] = v[i] ^ 0x80;
+#else
+      for (i = 0; i < n; i++) keys[i] = v[i];
+#endif
+    }
+    return 1;
+  case DF_FLOAT:
+    {
+      uint32_t *v = (uint32_t *) vals, k;
+      for (i = 0; i < n; i++) {
+	keys[i] = k = dlSortFloatKey(v[i]);
+	if (dlSortFloatFromKey(k) != v[i]) *exact = 0;
+      }
+    }
+    return 4;
+  }
+  return 0;
+}
+
+static void dlSortFromKeys(int datatype, DL_SIZE n, uint32_t *keys,
+			   void *vals)
+{
+  DL_SIZE i;
+  switch (datatype) {
+  case DF_LONG:
+    {
+      int *v = (int *) vals;
+      for (i = 0; i < n; i++) v[i] = (int) (keys[i] ^ 0x80000000);
+    }
+    break;
+  case DF_SHORT:
+    {
+      short *v = (short *) vals;
+      for (i = 0; i < n; i++) v[i] = (short) (uint16_t) (keys[i] ^ 0x8000);
+    }
+    break;
+  case DF_CHAR:
+    {
+      unsigned char *v = (unsigned char *) vals;
+#if CHAR_MIN < 0
+      for (i = 0; i < n; i++) v[i] = (unsigned char) (keys[i] ^ 0x80);
+#else
+      for (i = 0; i < n; i++) v[i] = (unsigned char) keys[i];
+#endif
+    }
+    break;
+  case DF_FLOAT:
+    {
+      uint32_t *v = (uint32_t *) vals;
+      for (i = 0; i < n; i++) v[i] = dlSortFloatFromKey(keys[i]);
+    }
+    break;
+  }
+}
+
+
+/*
+ * Radix sort keys[0..n-1] (and idx along with them, if not NULL) on
+ * their low nbytes bytes, using ktmp / itmp as scratch.  The result
+ * ends up back in keys / idx.
+ */
+
+static void dlRadixSort(uint32_t *keys, int *idx, uint32_t *ktmp, int *itmp,
+			DL_SIZE n, int nbytes)
+{
+  DL_SIZE counts[4][256], sum, c, i;
+  uint32_t *ks = keys, *kd = ktmp, *kt;
+  int *is = idx, *id = itmp, *it;
+  int b, shift, j;
+
+  if (n < 2) return;
+
+  memset(counts, 0, sizeof(counts));
+  for (i = 0; i < n; i++) {
+    uint32_t k = keys[i];
+    for (b = 0; b < nbytes; b++) counts[b][(k >> (8*b)) & 0xff]++;
+  }
+
+  for (b = 0; b < nbytes; b++) {
+    shift = 8*b;
+    /* every key has the same byte here: nothing to do */
+    if (counts[b][(ks[0] >> shift) & 0xff] == n) continue;
+    for (sum = 0, j = 0; j < 256; j++) {
+      c = counts[b][j];
+      counts[b][j] = sum;
+      sum += c;
+    }
+    if (is) {
+      for (i = 0; i < n; i++) {
+	DL_SIZE pos = counts[b][(ks[i] >> shift) & 0xff]++;
+	kd[pos] = ks[i];
+	id[pos] = is[i];
+      }
+      it = is; is = id; id = it;
+    }
+    else {
+      for (i = 0; i < n; i++)
+	kd[counts[b][(ks[i] >> shift) & 0xff]++] = ks[i];
+    }
+    kt = ks; ks = kd; kd = kt;
+  }
+
+  if (ks != keys) {
+    memcpy(keys, ks, n*sizeof(uint32_t));
+    if (idx) memcpy(idx, is, n*sizeof(int));
+  }
+}
+
+
+/*
+ * Parallel path
+ */
+
+static void dlSortRuns(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_SORT_JOB *job = (DL_SORT_JOB *) cd;
+  DL_SIZE r, lo;
+  for (r = start; r < stop; r++) {
+    lo = job->bounds[r];
+    dlRadixSort(job->keys+lo, job->idx ? job->idx+lo : NULL,
+		job->ktmp+lo, job->itmp ? job->itmp+lo : NULL,
+		job->bounds[r+1]-lo, job->nbytes);
+  }
+}
+
+/*
+ * Number of elements taken from a (length na) among the first d
+ * outputs of a stable merge of a and b (length nb)
+ */
+
+static DL_SIZE dlMergeSplit(uint32_t *a, DL_SIZE na, uint32_t *b, DL_SIZE nb,
+			    DL_SIZE d)
+{
+  DL_SIZE lo = d > nb ? d - nb : 0, hi = d < na ? d : na, mid;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (a[mid] <= b[d-mid-1]) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+static void dlSortMerges(void *cd, DL_SIZE start, DL_SIZE stop)
+{
+  DL_SORT_JOB *job = (DL_SORT_JOB *) cd;
+  DL_SIZE t, *task, lo, na, nb, d0, d1, i, j, iend, jend, k;
+  uint32_t *a, *b, *kd;
+  int *ia = NULL, *ib = NULL, *id = NULL;
+
+  for (t = start; t < stop; t++) {
+    task = &job->tasks[5*t];
+    lo = task[0];
+    na = task[1] - lo;
+    nb = task[2] - task[1];
+    d0 = task[3];
+    d1 = task[4];
+    a = job->ksrc + lo;
+    b = job->ksrc + task[1];
+    kd = job->kdst + lo;
+    if (job->isrc) {
+      ia = job->isrc + lo;
+      ib = job->isrc + task[1];
+      id = job->idst + lo;
+    }
+    i = dlMergeSplit(a, na, b, nb, d0);
+    iend = dlMergeSplit(a, na, b, nb, d1);
+    j = d0 - i;
+    jend = d1 - iend;
+    for (k = d0; k < d1; k++) {
+      if (j >= jend || (i < iend && a[i] <= b[j])) {
+	kd[k] = a[i];
+	if (id) id[k] = ia[i];
+	i++;
+      }
+      else {
+	kd[k] = b[j];
+	if (id) id[k] = ib[j];
+	j++;
+      }
+    }
+  }
+}
+
+static int dlSortParallel(uint32_t *keys, int *idx, uint32_t *ktmp,
+			  int *itmp, DL_SIZE n, int nbytes, int nthreads)
+{
+  DL_SORT_JOB job;
+  DL_SIZE r, p, nruns = nthreads, ntasks, seg, lo, mid, hi, d, *newb;
+  uint32_t *kt;
+  int *it;
+
+  job.keys = keys; job.ktmp = ktmp;
+  job.idx = idx; job.itmp = itmp;
+  job.nbytes = nbytes;
+  job.bounds = (DL_SIZE *) malloc((nruns+1)*sizeof(DL_SIZE));
+  /* enough tasks for any round: each pair adds at most one */
+  seg = n / ((DL_SIZE) nthreads * 4);
+  if (seg < DL_SORT_MIN_SEGMENT) seg = DL_SORT_MIN_SEGMENT;
+  job.tasks = (DL_SIZE *) malloc(5*(n/seg + nruns + 1)*sizeof(DL_SIZE));
+  if (!job.bounds || !job.tasks) {
+    if (job.bounds) free(job.bounds);
+    if (job.tasks) free(job.tasks);
+    return 0;
+  }
+  for (r = 0; r <= nruns; r++) job.bounds[r] = r * n / nruns;
+
+  dlParallelFor(nruns, n, dlSortRuns, &job);
+
+  job.ksrc = keys; job.kdst = ktmp;
+  job.isrc = idx; job.idst = itmp;
+  while (nruns > 1) {
+    ntasks = 0;
+    for (p = 0; p < nruns; p += 2) {
+      lo = job.bounds[p];
+      mid = job.bounds[p+1];
+      hi = (p+2 <= nruns) ? job.bounds[p+2] : mid;
+      for (d = 0; d < hi - lo; d += seg) {
+	DL_SIZE *task = &job.tasks[5*ntasks++];
+	task[0] = lo; task[1] = mid; task[2] = hi;
+	task[3] = d;
+	task[4] = (d + seg < hi - lo) ? d + seg : hi - lo;
+      }
+    }
+    dlParallelFor(ntasks, n, dlSortMerges, &job);
+
+    /* keep every other boundary */
+    newb = job.bounds;
+    for (p = 0; p <= nruns; p += 2) newb[p/2] = job.bounds[p];
+    if (nruns % 2) newb[nruns/2+1] = job.bounds[nruns];
+    nruns = (nruns + 1) / 2;
+
+    kt = job.ksrc; job.ksrc = job.kdst; job.kdst = kt;
+    it = job.isrc; job.isrc = job.idst; job.idst = it;
+  }
+
+  if (job.ksrc != keys) {
+    memcpy(keys, job.ksrc, n*sizeof(uint32_t));
+    if (idx) memcpy(idx, job.isrc, n*sizeof(int));
+  }
+  free(job.bounds);
+  free(job.tasks);
+  return 1;
+}
+
+static void dlSortKeys(uint32_t *keys, int *idx, uint32_t *ktmp, int *itmp,
+		       DL_SIZE n, int nbytes)
+{
+  int nthreads = dlThreadsGet();
+  if (nthreads > 1 && n >= dlThreadsThreshold() && n >= 2*nthreads) {
+    if (dlSortParallel(keys, idx, ktmp, itmp, n, nbytes, nthreads)) return;
+  }
+  dlRadixSort(keys, idx, ktmp, itmp, n, nbytes);
+}
+
+
+/*
+ * dlSortValues - sort a numeric list's values in place
+ */
+
+int dlSortValues(int datatype, DL_SIZE n, void *vals)
+{
+  uint32_t *keys;
+  int *idx = NULL, *itmp = NULL, nbytes, exact;
+
+  if (datatype != DF_LONG && datatype != DF_SHORT &&
+      datatype != DF_CHAR && datatype != DF_FLOAT) return 0;
+  if (n < 2) return 1;
+
+  keys = (uint32_t *) malloc(2*n*sizeof(uint32_t));
+  if (!keys) return 0;
+  nbytes = dlSortMakeKeys(datatype, n, vals, keys, &exact);
+
+  /* carry the original bits of -0 and NaNs along with the keys */
+  if (!exact) {
+    idx = (int *) malloc(2*n*sizeof(int));
+    if (!idx) {
+      free(keys);
+      return 0;
+    }
+    memcpy(idx, vals, n*sizeof(int));
+    itmp = idx + n;
+  }
+
+  dlSortKeys(keys, idx, keys+n, itmp, n, nbytes);
+
+  if (idx) {
+    memcpy(vals, idx, n*sizeof(int));
+    free(idx);
+  }
+  else dlSortFromKeys(datatype, n, keys, vals);
+  free(keys);
+  return 1;
+}
+
+/*
+ * dlSortIndices - stable sorting permutation of a numeric list
+ */
+
+int dlSortIndices(int datatype, DL_SIZE n, void *vals, int *indices)
+{
+  uint32_t *keys;
+  int *itmp, nbytes, exact;
+  DL_SIZE i;
+
+  if (datatype != DF_LONG && datatype != DF_SHORT &&
+      datatype != DF_CHAR && datatype != DF_FLOAT) return 0;
+
+  keys = (uint32_t *) malloc((2*n+1)*sizeof(uint32_t));
+  itmp = (int *) malloc((n+1)*sizeof(int));
+  if (!keys || !itmp) {
+    if (keys) free(keys);
+    if (itmp) free(itmp);
+    return 0;
+  }
+  nbytes = dlSortMakeKeys(datatype, n, vals, keys, &exact);
+  for (i = 0; i < n; i++) indices[i] = (int) i;
+
+  dlSortKeys(keys, indices, keys+n, itmp, n, nbytes);
+
+  free(keys);
+  free(itmp);
+  return 1;
+}
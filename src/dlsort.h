@@ -0,0 +1,33 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlsort.h
+ *
+ *  DESCRIPTION
+ *    Radix sorts for numeric dynlist values, used by dl_sort,
+ *  dl_sortIndices, dl_unique and the rank / recode functions.
+ *  dlSortValues sorts vals in place and dlSortIndices fills indices
+ *  with the stable sorting permutation of vals (vals is not changed).
+ *  Both return 1 if the datatype was handled (DF_LONG, DF_SHORT,
+ *  DF_FLOAT, DF_CHAR) and 0 otherwise.
+ *
+ *  Floats order -0 and 0 as equal and put NaNs last; chars order as
+ *  the platform's char type.
+ *
+ ************************************************************************/
+
+#ifndef DLSORT_H
+#define DLSORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int dlSortValues(int datatype, DL_SIZE n, void *vals);
+int dlSortIndices(int datatype, DL_SIZE n, void *vals, int *indices);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLSORT_H */
@@ -0,0 +1,642 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlspec.c
+ *
+ *  DESCRIPTION
+ *    Multitaper spectral estimates.  The tapers are the eigenvectors
+ *  of the tridiagonal matrix that commutes with the time and band
+ *  limiting operator (Slepian 1978): each eigenvalue is found by
+ *  bisection on the Sturm sequence and its vector by inverse iteration,
+ *  so a set of k tapers of n points costs O(k n) rather than the O(n^3)
+ *  of a full eigensolver.  Taper sets are kept in a small cache, along
+ *  with their transforms at the FFT sizes used for point data.  Sets in
+ *  use are never evicted, so trials can be done in parallel with one
+ *  set.
+ *
+ *  Also the chi-square and t quantiles for confidence intervals (in
+ *  place of dcdflib), and the jackknife intervals of Chronux's specerr
+ *  and coherr, done in one pass by leaving each estimate out of the
+ *  totals rather than re-averaging.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "df.h"
+#include "dlfft.h"
+#include "dlspec.h"
+
+#if !defined(_WIN32)
+#define DL_SPEC_PTHREAD 1
+#include <pthread.h>
+static pthread_mutex_t SpecMutex = PTHREAD_MUTEX_INITIALIZER;
+#define DL_SPEC_LOCK()   pthread_mutex_lock(&SpecMutex)
+#define DL_SPEC_UNLOCK() pthread_mutex_unlock(&SpecMutex)
+#else
+#define DL_SPEC_LOCK()
+#define DL_SPEC_UNLOCK()
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DL_DPSS_CACHE    16	/* taper sets kept                      */
+#define DL_DPSS_SPECTRA   4	/* FFT sizes kept per set               */
+#define DL_DPSS_ITERS     3	/* inverse iterations per taper         */
+
+struct DL_DPSS {
+  int n, ntapers;
+  double nw;
+  double *tapers;		/* ntapers rows of n points             */
+  int refcount;
+  int cached;			/* held in DpssSets                     */
+  unsigned long used;
+  int nffts[DL_DPSS_SPECTRA];
+  double *spectra[DL_DPSS_SPECTRA]; /* nfft/2+1 points per taper       */
+};
+
+static DL_DPSS *DpssSets[DL_DPSS_CACHE];
+static unsigned long DpssClock = 0;
+
+/*
+ * dlDpssCount - number of eigenvalues of the tridiagonal matrix (d on
+ * the diagonal, e2[i] the square of the element left of d[i]) below x
+ */
+
+static int dlDpssCount(int n, const double *d, const double *e2, double x)
+{
+  int i, count = 0;
+  double q = d[0] - x;
+
+  if (q < 0.0) count++;
+  for (i = 1; i < n; i++) {
+    if (q == 0.0) q = DBL_EPSILON*(fabs(x)+1.0);
+    q = d[i] - x - e2[i]/q;
+    if (q < 0.0) count++;
+  }
+  return count;
+}
+
+/*
+ * dlDpssSolve - solve (T - lambda) y = b in place, by elimination with
+ * partial pivoting (as in LAPACK's dgttrf/dgtts2).  Work holds 4n
+ * doubles and n ints follow in piv.
+ */
+
+static void dlDpssSolve(int n, const double *d, const double *e,
+			double lambda, double *b, double *work, int *piv)
+{
+  double *dg = work, *du = work+n, *du2 = work+2*n, *dl = work+3*n;
+  double fact, temp, tiny = DBL_EPSILON*(fabs(lambda)+1.0);
+  int i;
+
+  for (i = 0; i < n; i++) {
+    dg[i] = d[i] - lambda;
+    du[i] = dl[i] = (i < n-1) ? e[i+1] : 0.0;
+    du2[i] = 0.0;
+    piv[i] = 0;
+  }
+  for (i = 0; i < n-1; i++) {
+    if (fabs(dg[i]) >= fabs(dl[i])) {
+      if (dg[i] == 0.0) dg[i] = tiny;
+      fact = dl[i]/dg[i];
+      dl[i] = fact;
+      dg[i+1] -= fact*du[i];
+    }
+    else {
+      fact = dg[i]/dl[i];
+      dg[i] = dl[i];
+      dl[i] = fact;
+      temp = du[i];
+      du[i] = dg[i+1];
+      dg[i+1] = temp - fact*dg[i+1];
+      if (i < n-2) {
+	du2[i] = du[i+1];
+	du[i+1] = -fact*du[i+1];
+      }
+      piv[i] = 1;
+    }
+  }
+  if (dg[n-1] == 0.0) dg[n-1] = tiny;
+
+  for (i = 0; i < n-1; i++) {
+    if (!piv[i]) b[i+1] -= dl[i]*b[i];
+    else {
+      temp = b[i];
+      b[i] = b[i+1];
+      b[i+1] = temp - dl[i]*b[i];
+    }
+  }
+  b[n-1] /= dg[n-1];
+  if (n > 1) b[n-2] = (b[n-2] - du[n-2]*b[n-1])/dg[n-2];
+  for (i = n-3; i >= 0; i--)
+    b[i] = (b[i] - du[i]*b[i+1] - du2[i]*b[i+2])/dg[i];
+}
+
+static void dlDpssNormalize(int n, double *v)
+{
+  int i;
+  double ss = 0.0;
+  for (i = 0; i < n; i++) ss += v[i]*v[i];
+  if (ss > 0.0) for (ss = 1.0/sqrt(ss), i = 0; i < n; i++) v[i] *= ss;
+}
+
+static void dlDpssFree(DL_DPSS *s)
+{
+  int i;
+  for (i = 0; i < DL_DPSS_SPECTRA; i++) if (s->spectra[i]) free(s->spectra[i]);
+  if (s->tapers) free(s->tapers);
+  free(s);
+}
+
+static DL_DPSS *dlDpssMake(int n, double nw, int ntapers)
+{
+  DL_DPSS *s;
+  double *d, *e, *e2, *work, *v, lo, hi, mid, r, w = nw/n, dot, thresh;
+  int *piv, i, j, k, it, index;
+
+  if (!(s = (DL_DPSS *) calloc(1, sizeof(DL_DPSS)))) return NULL;
+  s->n = n;
+  s->nw = nw;
+  s->ntapers = ntapers;
+  s->tapers = (double *) malloc(ntapers*n*sizeof(double));
+  d = (double *) malloc(7*n*sizeof(double));
+  piv = (int *) malloc(n*sizeof(int));
+  if (!s->tapers || !d || !piv) {
+    if (d) free(d);
+    if (piv) free(piv);
+    dlDpssFree(s);
+    return NULL;
+  }
+  e = d+n;
+  e2 = d+2*n;
+  work = d+3*n;
+
+  /* the tridiagonal matrix and bounds on its eigenvalues */
+  lo = hi = 0.0;
+  for (i = 0; i < n; i++) {
+    d[i] = 0.25*(n-1-2.0*i)*(n-1-2.0*i)*cos(2.0*M_PI*w);
+    e[i] = i ? 0.5*i*(n-i) : 0.0;
+    e2[i] = e[i]*e[i];
+  }
+  for (i = 0; i < n; i++) {
+    r = e[i] + ((i < n-1) ? e[i+1] : 0.0);
+    if (!i || d[i]-r < lo) lo = d[i]-r;
+    if (!i || d[i]+r > hi) hi = d[i]+r;
+  }
+
+  for (k = 0; k < ntapers; k++) {
+    double a = lo, b = hi;
+
+    /* the k-th largest eigenvalue is the one with n-1-k below it */
+    index = n-1-k;
+    for (it = 0; it < 200; it++) {
+      mid = 0.5*(a+b);
+      if (mid <= a || mid >= b) break;
+      if (dlDpssCount(n, d, e2, mid) <= index) a = mid;
+      else b = mid;
+    }
+
+    v = s->tapers+k*n;
+    for (i = 0; i < n; i++) v[i] = 1.0 + 0.5*sin(1.0+2.399963*i);
+    for (it = 0; it < DL_DPSS_ITERS; it++) {
+      dlDpssSolve(n, d, e, 0.5*(a+b), v, work, piv);
+      for (j = 0; j < k; j++) {
+	const double *u = s->tapers+j*n;
+	for (dot = 0.0, i = 0; i < n; i++) dot += u[i]*v[i];
+	for (i = 0; i < n; i++) v[i] -= dot*u[i];
+      }
+      dlDpssNormalize(n, v);
+    }
+
+    /* symmetric tapers have a positive sum, antisymmetric ones start
+       with a positive lobe (Percival and Walden 1993, p. 379) */
+    if (!(k % 2)) {
+      for (dot = 0.0, i = 0; i < n; i++) dot += v[i];
+      if (dot < 0.0) for (i = 0; i < n; i++) v[i] = -v[i];
+    }
+    else {
+      thresh = (1.0/n > 1e-7) ? 1.0/n : 1e-7;
+      for (i = 0; i < n && v[i]*v[i] <= thresh; i++);
+      if (i < n && v[i] < 0.0) for (i = 0; i < n; i++) v[i] = -v[i];
+    }
+  }
+
+  free(d);
+  free(piv);
+  return s;
+}
+
+/*
+ * dlDpssGet - the first ntapers tapers of n points with time-bandwidth
+ * product nw, from the cache when there.  Each set returned must be
+ * handed to dlDpssRelease.
+ */
+
+DL_DPSS *dlDpssGet(int n, double nw, int ntapers)
+{
+  DL_DPSS *s;
+  int i, slot;
+
+  if (n < 1 || ntapers < 1 || ntapers > n || nw <= 0.0 || nw >= n/2.0)
+    return NULL;
+
+  DL_SPEC_LOCK();
+  for (i = 0; i < DL_DPSS_CACHE; i++) {
+    if ((s = DpssSets[i]) && s->n == n && s->nw == nw &&
+	s->ntapers == ntapers) {
+      s->refcount++;
+      s->used = ++DpssClock;
+      DL_SPEC_UNLOCK();
+      return s;
+    }
+  }
+  DL_SPEC_UNLOCK();
+
+  if (!(s = dlDpssMake(n, nw, ntapers))) return NULL;
+
+  /* take an empty slot, or the least recently used idle set's */
+  DL_SPEC_LOCK();
+  s->refcount = 1;
+  s->used = ++DpssClock;
+  for (i = 0, slot = -1; i < DL_DPSS_CACHE; i++) {
+    if (!DpssSets[i]) { slot = i; break; }
+    if (!DpssSets[i]->refcount &&
+	(slot < 0 || DpssSets[i]->used < DpssSets[slot]->used)) slot = i;
+  }
+  if (slot >= 0) {
+    if (DpssSets[slot]) dlDpssFree(DpssSets[slot]);
+    DpssSets[slot] = s;
+    s->cached = 1;
+  }
+  DL_SPEC_UNLOCK();
+  return s;
+}
+
+void dlDpssRelease(DL_DPSS *s)
+{
+  if (!s) return;
+  DL_SPEC_LOCK();
+  if (!--s->refcount && !s->cached) dlDpssFree(s);
+  DL_SPEC_UNLOCK();
+}
+
+const double *dlDpssTaper(DL_DPSS *s, int k)
+{
+  if (k < 0 || k >= s->ntapers) return NULL;
+  return s->tapers+k*s->n;
+}
+
+/*
+ * dlDpssSpectra - transforms of the tapers zero padded to nfft points.
+ * *tofree is set if the result could not be kept with the set.
+ */
+
+static double *dlDpssSpectra(DL_DPSS *s, int nfft, int *tofree)
+{
+  double *spec;
+  int i, k, nf = nfft/2+1;
+
+  *tofree = 0;
+  DL_SPEC_LOCK();
+  for (i = 0; i < DL_DPSS_SPECTRA; i++) {
+    if (s->nffts[i] == nfft) {
+      spec = s->spectra[i];
+      DL_SPEC_UNLOCK();
+      return spec;
+    }
+  }
+  DL_SPEC_UNLOCK();
+
+  if (!(spec = (double *) calloc(s->ntapers*2*nf+2, sizeof(double))))
+    return NULL;
+  for (k = 0; k < s->ntapers; k++) {
+    double *h = spec+k*2*nf;
+    memcpy(h, s->tapers+k*s->n, s->n*sizeof(double));
+    /* each transform writes two doubles past its nf points */
+    if (!dlFftReal(nfft, h, 0)) {
+      free(spec);
+      return NULL;
+    }
+  }
+
+  DL_SPEC_LOCK();
+  for (i = 0; i < DL_DPSS_SPECTRA; i++) {
+    if (!s->nffts[i]) {
+      s->nffts[i] = nfft;
+      s->spectra[i] = spec;
+      break;
+    }
+  }
+  if (i == DL_DPSS_SPECTRA) *tofree = 1;
+  DL_SPEC_UNLOCK();
+  return spec;
+}
+
+/*
+ * dlSpecNfft - transform size for n points: n itself if pad is
+ * negative, else the next power of two above n doubled pad times
+ */
+
+int dlSpecNfft(int n, int pad)
+{
+  int nfft;
+  if (pad < 0) return n;
+  if (!(nfft = dlFftSize(n))) return 0;
+  while (pad-- > 0) {
+    if (nfft > (1 << 29)) return 0;
+    nfft *= 2;
+  }
+  return nfft;
+}
+
+/*
+ * dlMtFft - tapered transforms of the n points x (n the length of the
+ * tapers, nfft at least n), into J: for each taper, the nfft/2+1
+ * complex values of the non-negative frequencies.  Point data has its
+ * mean taken out.  Returns 0 if out of memory.
+ */
+
+int dlMtFft(DL_DPSS *s, const double *x, int n, int nfft, double fs,
+	    int point, double *J)
+{
+  int i, k, nf = nfft/2+1, tofree = 0;
+  double *buf, *spec = NULL, scale, mean = 0.0;
+  const double *v;
+
+  if (n != s->n || nfft < n) return 0;
+  if (!(buf = (double *) malloc((nfft+2)*sizeof(double)))) return 0;
+  if (point) {
+    if (!(spec = dlDpssSpectra(s, nfft, &tofree))) {
+      free(buf);
+      return 0;
+    }
+    for (i = 0; i < n; i++) mean += x[i];
+    mean /= n;
+    scale = sqrt(fs);
+  }
+  else scale = 1.0/sqrt(fs);
+
+  for (k = 0; k < s->ntapers; k++) {
+    v = s->tapers+k*n;
+    for (i = 0; i < n; i++) buf[i] = x[i]*v[i];
+    for (; i < nfft+2; i++) buf[i] = 0.0;
+    dlFftReal(nfft, buf, 0);
+    if (point) {
+      const double *h = spec+k*2*nf;
+      for (i = 0; i < 2*nf; i++) J[i] = (buf[i] - mean*h[i])*scale;
+    }
+    else {
+      for (i = 0; i < 2*nf; i++) J[i] = buf[i]*scale;
+    }
+    J += 2*nf;
+  }
+
+  if (tofree) free(spec);
+  free(buf);
+  return 1;
+}
+
+/*
+ * dlGammaP - regularized lower incomplete gamma function, by its
+ * series below a+1 and its continued fraction above
+ */
+
+static double dlGammaP(double a, double x)
+{
+  double sum, del, ap, b, c, d, h, an;
+  int i;
+
+  if (x <= 0.0) return 0.0;
+  if (x < a+1.0) {
+    ap = a;
+    sum = del = 1.0/a;
+    for (i = 0; i < 1000; i++) {
+      ap += 1.0;
+      del *= x/ap;
+      sum += del;
+      if (fabs(del) < fabs(sum)*DBL_EPSILON) break;
+    }
+    return sum*exp(-x + a*log(x) - lgamma(a));
+  }
+  b = x+1.0-a;
+  c = 1.0/DBL_MIN;
+  d = 1.0/b;
+  h = d;
+  for (i = 1; i < 1000; i++) {
+    an = -i*(i-a);
+    b += 2.0;
+    d = an*d+b;
+    if (fabs(d) < DBL_MIN) d = DBL_MIN;
+    c = b+an/c;
+    if (fabs(c) < DBL_MIN) c = DBL_MIN;
+    d = 1.0/d;
+    del = d*c;
+    h *= del;
+    if (fabs(del-1.0) < DBL_EPSILON) break;
+  }
+  return 1.0 - exp(-x + a*log(x) - lgamma(a))*h;
+}
+
+/*
+ * dlBetaI - regularized incomplete beta function, by its continued
+ * fraction (on whichever side converges)
+ */
+
+static double dlBetaCf(double a, double b, double x)
+{
+  double c = 1.0, d, h, aa, del;
+  int m, m2;
+
+  d = 1.0 - (a+b)*x/(a+1.0);
+  if (fabs(d) < DBL_MIN) d = DBL_MIN;
+  d = 1.0/d;
+  h = d;
+  for (m = 1; m < 1000; m++) {
+    m2 = 2*m;
+    aa = m*(b-m)*x/((a-1.0+m2)*(a+m2));
+    d = 1.0+aa*d;
+    if (fabs(d) < DBL_MIN) d = DBL_MIN;
+    c = 1.0+aa/c;
+    if (fabs(c) < DBL_MIN) c = DBL_MIN;
+    d = 1.0/d;
+    h *= d*c;
+    aa = -(a+m)*(a+b+m)*x/((a+m2)*(a+1.0+m2));
+    d = 1.0+aa*d;
+    if (fabs(d) < DBL_MIN) d = DBL_MIN;
+    c = 1.0+aa/c;
+    if (fabs(c) < DBL_MIN) c = DBL_MIN;
+    d = 1.0/d;
+    del = d*c;
+    h *= del;
+    if (fabs(del-1.0) < DBL_EPSILON) break;
+  }
+  return h;
+}
+
+static double dlBetaI(double a, double b, double x)
+{
+  double bt;
+  if (x <= 0.0) return 0.0;
+  if (x >= 1.0) return 1.0;
+  bt = exp(lgamma(a+b) - lgamma(a) - lgamma(b) + a*log(x) + b*log(1.0-x));
+  if (x < (a+1.0)/(a+b+2.0)) return bt*dlBetaCf(a, b, x)/a;
+  return 1.0 - bt*dlBetaCf(b, a, 1.0-x)/b;
+}
+
+/*
+ * dlChi2Inv - x with a chi-square cdf of p on df degrees of freedom
+ * (NaN for p or df out of range)
+ */
+
+double dlChi2Inv(double p, double df)
+{
+  double lo = 0.0, hi, mid;
+  int i;
+
+  if (!(df > 0.0) || !(p >= 0.0 && p <= 1.0)) return NAN;
+  if (p == 0.0) return 0.0;
+  if (p == 1.0) return HUGE_VAL;
+  for (hi = df+10.0*sqrt(2.0*df)+10.0; dlGammaP(0.5*df, 0.5*hi) < p; hi *= 2.0)
+    lo = hi;
+  for (i = 0; i < 200; i++) {
+    mid = 0.5*(lo+hi);
+    if (mid <= lo || mid >= hi) break;
+    if (dlGammaP(0.5*df, 0.5*mid) < p) lo = mid;
+    else hi = mid;
+  }
+  return 0.5*(lo+hi);
+}
+
+/*
+ * dlTInv - t with a Student's t cdf of p on df degrees of freedom
+ * (NaN for p or df out of range)
+ */
+
+double dlTInv(double p, double df)
+{
+  double q, lo = 0.0, hi = 1.0, mid;
+  int i;
+
+  if (!(df > 0.0) || !(p >= 0.0 && p <= 1.0)) return NAN;
+  if (p == 0.5) return 0.0;
+  if (p == 0.0) return -HUGE_VAL;
+  if (p == 1.0) return HUGE_VAL;
+  if (p < 0.5) return -dlTInv(1.0-p, df);
+
+  /* for t > 0, the cdf is 1 - I(df/(df+t^2); df/2, 1/2)/2 */
+  q = 2.0*(1.0-p);
+  while (dlBetaI(0.5*df, 0.5, df/(df+hi*hi)) > q && hi < 1e300) {
+    lo = hi;
+    hi *= 2.0;
+  }
+  for (i = 0; i < 200; i++) {
+    mid = 0.5*(lo+hi);
+    if (mid <= lo || mid >= hi) break;
+    if (dlBetaI(0.5*df, 0.5, df/(df+mid*mid)) > q) lo = mid;
+    else hi = mid;
+  }
+  return 0.5*(lo+hi);
+}
+
+/*
+ * dlSpecJackknife - jackknife interval for the spectrum S from the n
+ * tapered transforms J (nf complex points each): the log spectrum
+ * with each transform left out in turn gives the spread, and the
+ * interval is S exp(-/+ tcrit sigma)
+ */
+
+void dlSpecJackknife(const double *J, int n, int nf, const double *S,
+		     double tcrit, double *lo, double *hi)
+{
+  int f, j;
+  double total, pw, mean, ss, lj, sigma;
+  const double *z;
+
+  for (f = 0; f < nf; f++) {
+    for (total = 0.0, j = 0; j < n; j++) {
+      z = J+(DL_SIZE) j*2*nf+2*f;
+      total += z[0]*z[0]+z[1]*z[1];
+    }
+    for (mean = 0.0, j = 0; j < n; j++) {
+      z = J+(DL_SIZE) j*2*nf+2*f;
+      pw = z[0]*z[0]+z[1]*z[1];
+      mean += log((total-pw)/(n-1));
+    }
+    mean /= n;
+    for (ss = 0.0, j = 0; j < n; j++) {
+      z = J+(DL_SIZE) j*2*nf+2*f;
+      pw = z[0]*z[0]+z[1]*z[1];
+      lj = log((total-pw)/(n-1)) - mean;
+      ss += lj*lj;
+    }
+    sigma = sqrt(n-1.0)*sqrt(ss/n);
+    lo[f] = S[f]*exp(-tcrit*sigma);
+    hi[f] = S[f]*exp(tcrit*sigma);
+  }
+}
+
+/*
+ * dlCohJackknife - jackknife interval for the coherence magnitude C
+ * from the n tapered transforms of each signal, on the atanh scale,
+ * and the jackknife phase deviation
+ */
+
+void dlCohJackknife(const double *J1, const double *J2, int n, int nf,
+		    const double *C, double tcrit, double *lo, double *hi,
+		    double *phistd)
+{
+  int f, j;
+  double t12r, t12i, t1, t2, s12r, s12i, s1, s2, c, cr, ci, mag, scale;
+  double mean, ss, d, pr, pi, atanhc, sigma;
+  const double *a, *b;
+  double *z = (double *) malloc(n*sizeof(double));
+
+  if (!z) return;
+  scale = sqrt(2.0*n-1.0);
+  for (f = 0; f < nf; f++) {
+    t12r = t12i = t1 = t2 = 0.0;
+    for (j = 0; j < n; j++) {
+      a = J1+(DL_SIZE) j*2*nf+2*f;
+      b = J2+(DL_SIZE) j*2*nf+2*f;
+      t12r += a[0]*b[0]+a[1]*b[1];
+      t12i += a[0]*b[1]-a[1]*b[0];
+      t1 += a[0]*a[0]+a[1]*a[1];
+      t2 += b[0]*b[0]+b[1]*b[1];
+    }
+    mean = pr = pi = 0.0;
+    for (j = 0; j < n; j++) {
+      a = J1+(DL_SIZE) j*2*nf+2*f;
+      b = J2+(DL_SIZE) j*2*nf+2*f;
+      s12r = t12r - (a[0]*b[0]+a[1]*b[1]);
+      s12i = t12i - (a[0]*b[1]-a[1]*b[0]);
+      s1 = t1 - (a[0]*a[0]+a[1]*a[1]);
+      s2 = t2 - (b[0]*b[0]+b[1]*b[1]);
+      c = sqrt(s1*s2);
+      cr = s12r/c;
+      ci = s12i/c;
+      mag = sqrt(cr*cr+ci*ci);
+      z[j] = scale*atanh(mag);
+      mean += z[j];
+      pr += cr/mag;
+      pi += ci/mag;
+    }
+    mean /= n;
+    for (ss = 0.0, j = 0; j < n; j++) {
+      d = z[j]-mean;
+      ss += d*d;
+    }
+    sigma = sqrt(n-1.0)*sqrt(ss/n);
+    atanhc = scale*atanh(C[f]);
+    lo[f] = tanh((atanhc - tcrit*sigma)/scale);
+    hi[f] = tanh((atanhc + tcrit*sigma)/scale);
+    phistd[f] = (2.0*n-2.0)*(1.0 - sqrt(pr*pr+pi*pi)/n);
+  }
+  free(z);
+}
@@ -0,0 +1,48 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlspec.h
+ *
+ *  DESCRIPTION
+ *    Multitaper spectral estimates for dl_mtfft, dl_mtspectrum,
+ *  dl_mtspecgram and dl_mtcoherence.  Tapers are the discrete prolate
+ *  spheroidal sequences (unit energy, the sign conventions of Percival
+ *  and Walden), cached by length, time-bandwidth product and count;
+ *  dlDpssGet returns tapers that stay valid until they are released,
+ *  whatever other calls do to the cache.
+ *
+ *  The tapered transforms of a trial follow Chronux: for continuous
+ *  data J = fft(x * taper * sqrt(fs)) / fs, and for binned point data
+ *  J = fft((x - mean(x)) * taper * sqrt(fs)).  Only the nfft/2+1
+ *  non-negative frequencies are kept.
+ *
+ ************************************************************************/
+
+#ifndef DLSPEC_H
+#define DLSPEC_H
+
+typedef struct DL_DPSS DL_DPSS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+DL_DPSS *dlDpssGet(int n, double nw, int ntapers);
+void dlDpssRelease(DL_DPSS *dpss);
+const double *dlDpssTaper(DL_DPSS *dpss, int k);
+int dlSpecNfft(int n, int pad);
+int dlMtFft(DL_DPSS *dpss, const double *x, int n, int nfft, double fs,
+	    int point, double *J);
+double dlChi2Inv(double p, double df);
+double dlTInv(double p, double df);
+void dlSpecJackknife(const double *J, int n, int nf, const double *S,
+		     double tcrit, double *lo, double *hi);
+void dlCohJackknife(const double *J1, const double *J2, int n, int nf,
+		    const double *C, double tcrit, double *lo, double *hi,
+		    double *phistd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLSPEC_H */
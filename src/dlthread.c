@@ -0,0 +1,234 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlthread.c
+ *
+ *  DESCRIPTION
+ *    A small persistent pool of worker threads used to run the per
+ *  sublist reductions (dynListMeanLists, dynListStdLists,
+ *  dynListSumLists ...) in parallel.  The number of threads defaults
+ *  to 1 (everything runs in the caller) and is set with dl_threads or
+ *  the DLSH_THREADS environment variable (0 meaning one per processor).
+ *
+ *  A call to dlParallelFor hands out chunks of the index range to the
+ *  workers and to the calling thread, which all take the next chunk
+ *  until none are left, so uneven sublist lengths still balance.  The
+ *  caller returns only after every chunk is finished.  Only one
+ *  parallel loop runs at a time: a loop started from inside a worker,
+ *  or from another thread while the pool is busy, simply runs serially.
+ *
+ *  Threads are only available with pthreads; elsewhere the pool has a
+ *  single thread and every loop runs in the caller.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "df.h"
+#include "dlthread.h"
+
+#if !defined(_WIN32)
+#define DL_THREADS_PTHREAD 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define DL_MAX_THREADS      256
+#define DL_CHUNKS_PER_THREAD  8	/* chunks handed out per thread      */
+
+static int DLThreads = -1;	             /* not yet initialized      */
+static DL_SIZE DLThreadsThreshold = 65536;   /* elements before going
+						parallel               */
+
+#ifdef DL_THREADS_PTHREAD
+
+typedef struct {
+  DL_RANGE_FUNC func;
+  void *cd;
+  DL_SIZE n;			/* indices 0..n-1                        */
+  DL_SIZE chunk;		/* indices per chunk                     */
+  DL_SIZE next;			/* start of the next chunk to hand out   */
+  DL_SIZE ndone;		/* indices finished                      */
+  int nworkers;			/* pool workers allowed to join          */
+} DL_THREAD_JOB;
+
+static pthread_mutex_t PoolCallMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t PoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PoolWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t PoolDone = PTHREAD_COND_INITIALIZER;
+static DL_THREAD_JOB *PoolJob = NULL;
+static unsigned long PoolGeneration = 0;
+static int PoolStarted = 0;	/* workers created so far                */
+static int PoolActive = 0;	/* workers currently inside a job        */
+
+/*
+ * Take chunks of the current job until there are none left.  Called
+ * with PoolMutex held; the mutex is released while func runs.
+ */
+static void dlThreadRunChunks(DL_THREAD_JOB *job)
+{
+  DL_SIZE start, stop;
+  while (job->next < job->n) {
+    start = job->next;
+    stop = start + job->chunk;
+    if (stop > job->n) stop = job->n;
+    job->next = stop;
+    pthread_mutex_unlock(&PoolMutex);
+    job->func(job->cd, start, stop);
+    pthread_mutex_lock(&PoolMutex);
+    job->ndone += stop - start;
+  }
+}
+
+static void *dlThreadWorker(void *arg)
+{
+  int id = (int) (size_t) arg;
+  unsigned long seen = 0;
+  DL_THREAD_JOB *job;
+
+  pthread_mutex_lock(&PoolMutex);
+  for (;;) {
+    while (PoolGeneration == seen || !PoolJob)
+      pthread_cond_wait(&PoolWork, &PoolMutex);
+    seen = PoolGeneration;
+    job = PoolJob;
+    if (id >= job->nworkers) continue;
+    PoolActive++;
+    dlThreadRunChunks(job);
+    PoolActive--;
+    if (job->ndone == job->n && !PoolActive)
+      pthread_cond_signal(&PoolDone);
+  }
+  return NULL;
+}
+
+/* start workers until there are n, returning how many there are */
+static int dlThreadStartWorkers(int n)
+{
+  pthread_t thread;
+  pthread_attr_t attr;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  while (PoolStarted < n) {
+    if (pthread_create(&thread, &attr, dlThreadWorker,
+		       (void *) (size_t) PoolStarted)) break;
+    PoolStarted++;
+  }
+  pthread_attr_destroy(&attr);
+  return PoolStarted;
+}
+
+#endif /* DL_THREADS_PTHREAD */
+
+
+/*
+ * dlThreadsAvailable - number of processors (1 without thread support)
+ */
+
+int dlThreadsAvailable(void)
+{
+#ifdef DL_THREADS_PTHREAD
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n < 1) return 1;
+  if (n > DL_MAX_THREADS) return DL_MAX_THREADS;
+  return (int) n;
+#else
+  return 1;
+#endif
+}
+
+/*
+ * dlThreadsGet - threads used by dlParallelFor, including the caller.
+ * The first call picks up DLSH_THREADS.
+ */
+
+int dlThreadsGet(void)
+{
+  char *env;
+  if (DLThreads < 0) {
+    DLThreads = 1;
+    if ((env = getenv("DLSH_THREADS")) != NULL && *env)
+      dlThreadsSet(atoi(env));
+  }
+  return DLThreads;
+}
+
+/*
+ * dlThreadsSet - set the number of threads (0 for one per processor),
+ * returning the number actually used
+ */
+
+int dlThreadsSet(int nthreads)
+{
+  if (nthreads <= 0) nthreads = dlThreadsAvailable();
+  if (nthreads > DL_MAX_THREADS) nthreads = DL_MAX_THREADS;
+#ifndef DL_THREADS_PTHREAD
+  nthreads = 1;
+#endif
+  DLThreads = nthreads;
+  return DLThreads;
+}
+
+DL_SIZE dlThreadsThreshold(void)
+{
+  return DLThreadsThreshold;
+}
+
+DL_SIZE dlThreadsSetThreshold(DL_SIZE nelements)
+{
+  DL_SIZE old = DLThreadsThreshold;
+  if (nelements >= 0) DLThreadsThreshold = nelements;
+  return old;
+}
+
+/*
+ * dlParallelFor - run func over 0..n-1.  work is the total number of
+ * elements the loop will touch and is compared with the threshold.
+ * Returns the number of threads that could have taken part.
+ */
+
+int dlParallelFor(DL_SIZE n, DL_SIZE work, DL_RANGE_FUNC func, void *cd)
+{
+  int nthreads = dlThreadsGet();
+
+  if (n <= 0) return 1;
+
+#ifdef DL_THREADS_PTHREAD
+  if (nthreads > 1 && n > 1 && work >= DLThreadsThreshold &&
+      !pthread_mutex_trylock(&PoolCallMutex)) {
+    DL_THREAD_JOB job;
+
+    if (nthreads > n) nthreads = (int) n;
+    nthreads = dlThreadStartWorkers(nthreads-1) + 1;
+    if (nthreads > 1) {
+      job.func = func;
+      job.cd = cd;
+      job.n = n;
+      job.chunk = n / ((DL_SIZE) nthreads * DL_CHUNKS_PER_THREAD);
+      if (job.chunk < 1) job.chunk = 1;
+      job.next = 0;
+      job.ndone = 0;
+      job.nworkers = nthreads-1;
+
+      pthread_mutex_lock(&PoolMutex);
+      PoolJob = &job;
+      PoolGeneration++;
+      pthread_cond_broadcast(&PoolWork);
+      dlThreadRunChunks(&job);
+      while (job.ndone < job.n || PoolActive)
+	pthread_cond_wait(&PoolDone, &PoolMutex);
+      PoolJob = NULL;
+      pthread_mutex_unlock(&PoolMutex);
+      pthread_mutex_unlock(&PoolCallMutex);
+      return nthreads;
+    }
+    pthread_mutex_unlock(&PoolCallMutex);
+  }
+#endif
+
+  func(cd, 0, n);
+  return 1;
+}
@@ -0,0 +1,53 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    dlthread.h
+ *
+ *  DESCRIPTION
+ *    Worker pool for splitting per sublist work (dl_means, dl_stds,
+ *  dl_sums ...) across threads.  dlParallelFor calls func(cd, start,
+ *  stop) over disjoint ranges covering 0..n-1; each index must write
+ *  only its own result slot, so the output does not depend on the
+ *  number of threads.  Work smaller than the threshold, nested calls
+ *  and calls made while another thread is using the pool run serially
+ *  in the calling thread.
+ *
+ *    dlOnce runs a function once whichever thread gets to it first, for
+ *  tables and settings that are filled in on first use and then read
+ *  from workers.
+ *
+ ************************************************************************/
+
+#ifndef DLTHREAD_H
+#define DLTHREAD_H
+
+#if !defined(_WIN32)
+#include <pthread.h>
+typedef pthread_once_t DL_ONCE;
+#define DL_ONCE_INIT PTHREAD_ONCE_INIT
+#define dlOnce(once, func) pthread_once(once, func)
+#else
+/* no pool threads without pthreads */
+typedef int DL_ONCE;
+#define DL_ONCE_INIT 0
+#define dlOnce(once, func) do { if (!*(once)) { *(once) = 1; (func)(); } } while (0)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*DL_RANGE_FUNC)(void *cd, DL_SIZE start, DL_SIZE stop);
+
+int dlThreadsAvailable(void);
+int dlThreadsGet(void);
+int dlThreadsSet(int nthreads);
+DL_SIZE dlThreadsThreshold(void);
+DL_SIZE dlThreadsSetThreshold(DL_SIZE nelements);
+int dlParallelFor(DL_SIZE n, DL_SIZE work, DL_RANGE_FUNC func, void *cd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLTHREAD_H */
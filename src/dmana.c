@@ -18,6 +18,9 @@
 
 #include "df.h"
 #include "dfana.h"
+#include "dlmat.h"
+#include "dllinalg.h"
+#include "dlrng.h"
 
 #include <utilc.h>
 
@@ -80,223 +83,164 @@ DYN_LIST *dynMatrixZeros(int nrows, int ncols)
   return(newmat);
 }
 
-DYN_LIST *dynMatrixUrands(int nrows, int ncols)
+/*
+ * dynMatrixRands - one stream of nrows*ncols uniform or normal values,
+ * taken row by row
+ */
+
+static DYN_LIST *dynMatrixRands(int nrows, int ncols, int normal)
 {
-  int i, j;
-  DYN_LIST *newmat, *row;
+  int i;
+  DL_RNG rng;
+  DL_SIZE n = (DL_SIZE) nrows * ncols;
+  DYN_LIST *newmat = NULL;
+  float *vals, **rows;
 
   if (nrows <= 0 || ncols <= 0) return(NULL);
 
-  newmat = dfuCreateDynList(DF_LIST, nrows);
-  row = dfuCreateDynList(DF_FLOAT, ncols);
-  
-  for (i = 0; i < nrows; i++) {
-    dfuResetDynList(row);
-    for (j = 0; j < ncols; j++) {
-      dfuAddDynListFloat(row, frand());
+  vals = (float *) malloc(n * sizeof(float));
+  rows = (float **) malloc(nrows * sizeof(float *));
+  if (vals && rows) {
+    dlRngNext(&rng);
+    if (normal) dlRngNormal(&rng, n, vals);
+    else dlRngUniform(&rng, n, vals);
+    if ((newmat = dlMatrixNewList(nrows, ncols, rows))) {
+      for (i = 0; i < nrows; i++)
+	memcpy(rows[i], vals + (size_t) i * ncols, ncols * sizeof(float));
     }
-    dfuAddDynListList(newmat, row);
   }
-  
-  dfuFreeDynList(row);
-
+  if (vals) free(vals);
+  if (rows) free(rows);
   return(newmat);
 }
 
-DYN_LIST *dynMatrixZrands(int nrows, int ncols)
+DYN_LIST *dynMatrixUrands(int nrows, int ncols)
 {
-  int i, j;
-  DYN_LIST *newmat, *row;
-
-  if (nrows <= 0 || ncols <= 0) return(NULL);
-
-  newmat = dfuCreateDynList(DF_LIST, nrows);
-  row = dfuCreateDynList(DF_FLOAT, ncols);
-  
-  for (i = 0; i < nrows; i++) {
-    dfuResetDynList(row);
-    for (j = 0; j < ncols; j++) {
-      dfuAddDynListFloat(row, zrand());
-    }
-    dfuAddDynListList(newmat, row);
-  }
-  
-  dfuFreeDynList(row);
+  return(dynMatrixRands(nrows, ncols, 0));
+}
 
-  return(newmat);
+DYN_LIST *dynMatrixZrands(int nrows, int ncols)
+{
+  return(dynMatrixRands(nrows, ncols, 1));
 }
 
 
-DYN_LIST *dynMatrixRowMeans(DYN_LIST *m)
-{
-  int i, j;
-  int nrows, ncols;
-  DYN_LIST *means = NULL, **rows;
-  float *rowvals;
-  double sum;
+/*
+ * dynMatrixRowVals - the value pointers of the rows of a matrix
+ */
 
-  if (!dynListIsMatrix(m)) return NULL;
-  if (!dynMatrixDims(m, &nrows, &ncols)) return NULL;
+static float **dynMatrixRowVals(DYN_LIST *m, int *nrows, int *ncols)
+{
+  int i;
+  DYN_LIST **rows;
+  float **vals;
 
+  if (!dynMatrixDims(m, nrows, ncols)) return NULL;
+  if (!(vals = (float **) malloc(*nrows*sizeof(float *)))) return NULL;
   rows = (DYN_LIST **) DYN_LIST_VALS(m);
-  means = dfuCreateDynList(DF_FLOAT, nrows);
-
-  for (i = 0; i < nrows; i++) {
-    rowvals = (float *) DYN_LIST_VALS(rows[i]);
-    sum = 0.0;
-    for (j = 0; j < ncols; j++) {
-      sum += rowvals[j];
-    }
-    dfuAddDynListFloat(means, sum/ncols);
-  }
-  return(means);
+  for (i = 0; i < *nrows; i++) vals[i] = (float *) DYN_LIST_VALS(rows[i]);
+  return vals;
 }
 
+/*
+ * dynMatrixSums - sums (or means) of the rows or columns of m, added
+ * in order in double
+ */
 
-DYN_LIST *dynMatrixColMeans(DYN_LIST *m)
+static DYN_LIST *dynMatrixSums(DYN_LIST *m, int cols, int mean)
 {
-  int i, j;
-  int nrows, ncols;
-  DYN_LIST *means = NULL, **rows;
-  float *rowvals;
+  int i, n, count, nrows, ncols;
+  float **rows, *vals = NULL;
   double *sums;
+  DYN_LIST *result = NULL;
 
-  if (!dynListIsMatrix(m)) return NULL;
-  if (!dynMatrixDims(m, &nrows, &ncols)) return NULL;
-
-  rows = (DYN_LIST **) DYN_LIST_VALS(m);
-  means = dfuCreateDynList(DF_FLOAT, ncols);
-  sums = (double *) calloc(ncols, sizeof(double));
-
-  for (i = 0; i < nrows; i++) {
-    rowvals = (float *) DYN_LIST_VALS(rows[i]);
-    for (j = 0; j < ncols; j++) {
-      sums[j] += rowvals[j];
-    }
-  }
-  
-  for (i = 0; i < ncols; i++) {
-    dfuAddDynListFloat(means, sums[i]/nrows);
+  if (!(rows = dynMatrixRowVals(m, &nrows, &ncols))) return NULL;
+  n = cols ? ncols : nrows;
+  count = cols ? nrows : ncols;
+  if ((sums = (double *) malloc(n*sizeof(double))) &&
+      (vals = (float *) malloc(n*sizeof(float)))) {
+    if (cols) dlMatrixColSums(rows, nrows, ncols, sums);
+    else dlMatrixRowSums(rows, nrows, ncols, sums);
+    for (i = 0; i < n; i++) vals[i] = mean ? sums[i]/count : sums[i];
+    if ((result = dfuCreateDynListWithVals(DF_FLOAT, n, vals))) vals = NULL;
   }
+  if (vals) free(vals);
+  if (sums) free(sums);
+  free(rows);
+  return(result);
+}
 
-  free(sums);
-  return(means);
+DYN_LIST *dynMatrixRowMeans(DYN_LIST *m)
+{
+  return dynMatrixSums(m, 0, 1);
 }
 
+DYN_LIST *dynMatrixColMeans(DYN_LIST *m)
+{
+  return dynMatrixSums(m, 1, 1);
+}
 
 DYN_LIST *dynMatrixRowSums(DYN_LIST *m)
 {
-  int i, j;
-  int nrows, ncols;
-  DYN_LIST *means = NULL, **rows;
-  float *rowvals;
-  double sum;
-
-  if (!dynListIsMatrix(m)) return NULL;
-  if (!dynMatrixDims(m, &nrows, &ncols)) return NULL;
-
-  rows = (DYN_LIST **) DYN_LIST_VALS(m);
-  means = dfuCreateDynList(DF_FLOAT, nrows);
-
-  for (i = 0; i < nrows; i++) {
-    rowvals = (float *) DYN_LIST_VALS(rows[i]);
-    sum = 0.0;
-    for (j = 0; j < ncols; j++) {
-      sum += rowvals[j];
-    }
-    dfuAddDynListFloat(means, sum);
-  }
-  return(means);
+  return dynMatrixSums(m, 0, 0);
 }
 
-
 DYN_LIST *dynMatrixColSums(DYN_LIST *m)
 {
-  int i, j;
-  int nrows, ncols;
-  DYN_LIST *means = NULL, **rows;
-  float *rowvals;
-  double *sums;
-
-  if (!dynListIsMatrix(m)) return NULL;
-  if (!dynMatrixDims(m, &nrows, &ncols)) return NULL;
-
-  rows = (DYN_LIST **) DYN_LIST_VALS(m);
-  means = dfuCreateDynList(DF_FLOAT, ncols);
-  sums = (double *) calloc(ncols, sizeof(double));
-
-  for (i = 0; i < nrows; i++) {
-    rowvals = (float *) DYN_LIST_VALS(rows[i]);
-    for (j = 0; j < ncols; j++) {
-      sums[j] += rowvals[j];
-    }
-  }
-  
-  for (i = 0; i < ncols; i++) {
-    dfuAddDynListFloat(means, sums[i]);
-  }
-
-  free(sums);
-  return(means);
+  return dynMatrixSums(m, 1, 0);
 }
 
 
+/*
+ * dynMatrixCenter - m less v[j] in each column j (bycols) or v[i] in
+ * each row i; v is converted to float if need be
+ */
 
-DYN_LIST *dynMatrixCenterRows(DYN_LIST *m, DYN_LIST *v)
+static DYN_LIST *dynMatrixCenter(DYN_LIST *m, DYN_LIST *v, int bycols)
 {
-  int i, j;
   int nrows, ncols;
-  DYN_LIST *newmat = NULL, **rows, *newrow;
-  float *rowvals, *centervals;
-
-  if (!dynListIsMatrix(m)) return NULL;
-  if (!dynMatrixDims(m, &nrows, &ncols)) return NULL;
-  if (DYN_LIST_N(v) != nrows) return NULL;
-
-  newmat = dfuCreateDynList(DF_LIST, nrows);
-  rows = (DYN_LIST **) DYN_LIST_VALS(m);
-  centervals = (float *) DYN_LIST_VALS(v);
-
-  newrow = dfuCreateDynList(DF_FLOAT, ncols);
-  for (i = 0; i < nrows; i++) {
-    rowvals = (float *) DYN_LIST_VALS(rows[i]);
-    dfuResetDynList(newrow);
-    for (j = 0; j < ncols; j++) {
-      dfuAddDynListFloat(newrow, rowvals[j]-centervals[i]);
-    }
-    dfuAddDynListList(newmat, newrow);
+  float **rows, **newrows = NULL;
+  DYN_LIST *fv = v, *newmat = NULL;
+
+  if (!v || !(rows = dynMatrixRowVals(m, &nrows, &ncols))) return NULL;
+  if (DYN_LIST_N(v) == (bycols ? ncols : nrows) &&
+      (DYN_LIST_DATATYPE(v) == DF_FLOAT ||
+       (fv = dynListConvertList(v, DF_FLOAT))) &&
+      (newrows = (float **) malloc(nrows*sizeof(float *))) &&
+      (newmat = dlMatrixNewList(nrows, ncols, newrows))) {
+    dlMatrixCenter(rows, nrows, ncols, (float *) DYN_LIST_VALS(fv),
+		   bycols, newrows);
   }
-  dfuFreeDynList(newrow);
-
+  if (fv && fv != v) dfuFreeDynList(fv);
+  if (newrows) free(newrows);
+  free(rows);
   return(newmat);
 }
 
+DYN_LIST *dynMatrixCenterRows(DYN_LIST *m, DYN_LIST *v)
+{
+  return dynMatrixCenter(m, v, 0);
+}
+
 DYN_LIST *dynMatrixCenterCols(DYN_LIST *m, DYN_LIST *v)
 {
-  int i, j;
-  int nrows, ncols;
-  DYN_LIST *newmat = NULL, **rows, *newrow;
-  float *rowvals, *centervals;
+  return dynMatrixCenter(m, v, 1);
+}
 
-  if (!dynListIsMatrix(m)) return NULL;
-  if (!dynMatrixDims(m, &nrows, &ncols)) return NULL;
-  if (DYN_LIST_N(v) != ncols) return NULL;
 
-  newmat = dfuCreateDynList(DF_LIST, nrows);
-  rows = (DYN_LIST **) DYN_LIST_VALS(m);
-  centervals = (float *) DYN_LIST_VALS(v);
+DYN_LIST *dynMatrixTranspose(DYN_LIST *m)
+{
+  int nrows, ncols;
+  float **rows, **newrows;
+  DYN_LIST *newmat = NULL;
 
-  newrow = dfuCreateDynList(DF_FLOAT, ncols);
-  for (i = 0; i < nrows; i++) {
-    rowvals = (float *) DYN_LIST_VALS(rows[i]);
-    dfuResetDynList(newrow);
-    for (j = 0; j < ncols; j++) {
-      dfuAddDynListFloat(newrow, rowvals[j]-centervals[j]);
-    }
-    dfuAddDynListList(newmat, newrow);
+  if (!(rows = dynMatrixRowVals(m, &nrows, &ncols))) return NULL;
+  if ((newrows = (float **) malloc(ncols*sizeof(float *)))) {
+    if ((newmat = dlMatrixNewList(ncols, nrows, newrows)))
+      dlMatrixTranspose(rows, nrows, ncols, newrows);
+    free(newrows);
   }
-  dfuFreeDynList(newrow);
-
+  free(rows);
   return(newmat);
 }
 
@@ -527,47 +471,74 @@ DYN_LIST *dynMatrixSubtract(DYN_LIST *m, DYN_LIST *l)
 
 
 
+/*
+ * In place forms of the elementwise matrix operations.  func is one of
+ * DL_MATH_ADD, SUB, MUL or DIV for a float operand; a matrix of the
+ * same size or a row vector may be added or subtracted.  Return 1, or
+ * 0 (leaving m unchanged) if the operands don't fit.
+ */
+
+int dynMatrixArithFloatInPlace(DYN_LIST *m, float k, int func)
+{
+  int i, nrows, ncols, ok = 1;
+  DYN_LIST **m_vals, *kl;
+
+  if (!dynMatrixDims(m, &nrows, &ncols)) return 0;
+  if (func == DL_MATH_DIV && k == 0.0) return 0;
+
+  m_vals = (DYN_LIST **) DYN_LIST_VALS(m);
+  kl = dfuCreateDynList(DF_FLOAT, 1);
+  dfuAddDynListFloat(kl, k);
+  for (i = 0; i < nrows && ok; i++)
+    ok = dynListArithListListInPlace(m_vals[i], kl, func);
+  dfuFreeDynList(kl);
+  return ok;
+}
+
+int dynMatrixArithInPlace(DYN_LIST *m, DYN_LIST *l, int func)
+{
+  int i, nrows1, ncols1, nrows2, ncols2, ok = 1;
+  DYN_LIST **m1_vals, **m2_vals;
+
+  if (func != DL_MATH_ADD && func != DL_MATH_SUB) return 0;
+  if (!dynMatrixDims(m, &nrows1, &ncols1)) return 0;
+  m1_vals = (DYN_LIST **) DYN_LIST_VALS(m);
+
+  if (dynListIsMatrix(l)) {
+    if (!dynMatrixDims(l, &nrows2, &ncols2)) return 0;
+    if (ncols1 != ncols2 || nrows1 != nrows2) return 0;
+    m2_vals = (DYN_LIST **) DYN_LIST_VALS(l);
+    for (i = 0; i < nrows1 && ok; i++)
+      ok = dynListArithListListInPlace(m1_vals[i], m2_vals[i], func);
+  }
+  else if (DYN_LIST_DATATYPE(l) == DF_FLOAT) {
+    if (DYN_LIST_N(l) != ncols1) return 0;
+    for (i = 0; i < nrows1 && ok; i++)
+      ok = dynListArithListListInPlace(m1_vals[i], l, func);
+  }
+  else return 0;
+  return ok;
+}
+
+
+
 DYN_LIST *dynMatrixMultiply(DYN_LIST *m1, DYN_LIST *m2)
 {
-  int i, j, k;
-  int rows1, rows2, cols1, cols2;
-  DYN_LIST *newmat = NULL, *vec, *t, **m1_vals, **m2_vals;
-  float *row, *col, *r2;
-  double sum;
+  int i, j;
+  int rows1, cols1;
+  DYN_LIST *newmat = NULL, *vec, **m1_vals;
+  DL_MATRIX *a, *b, *c;
+  float *row, *r2, *vals;
 
   if (dynListIsMatrix(m1) && dynListIsMatrix(m2)) {
-    if (!dynMatrixDims(m1, &rows1, &cols1) ||
-	!dynMatrixDims(m2, &rows2, &cols2)) {
-      return NULL;
+    a = dlMatrixFromList(m1);
+    b = dlMatrixFromList(m2);
+    if (a && b && (c = dlMatrixMultiply(a, b))) {
+      newmat = dlMatrixToList(c);
+      dlMatrixFree(c);
     }
-    if (cols1 != rows2) return(NULL);
-    
-    /*
-     * Create the transpose so we have pointers to each column
-     */
-    t = dynListTransposeList(m2);
-    
-    m1_vals = (DYN_LIST **) DYN_LIST_VALS(m1);
-    m2_vals = (DYN_LIST **) DYN_LIST_VALS(t);
-    
-    newmat = dfuCreateDynList(DF_LIST, rows1);
-    vec = dfuCreateDynList(DF_FLOAT, cols2);
-    
-    for (i = 0; i < rows1; i++) {
-      row = (float *) DYN_LIST_VALS(m1_vals[i]);
-      dfuResetDynList(vec);
-      for (j = 0; j < cols2; j++) {
-	col = (float *) DYN_LIST_VALS(m2_vals[j]);
-	for (k = 0, sum = 0.0; k < rows2; k++) {
-	  sum += row[k]*col[k];
-	}
-	dfuAddDynListFloat(vec, sum);
-      }
-      dfuAddDynListList(newmat, vec);
-    }
-    
-    dfuFreeDynList(t);
-    dfuFreeDynList(vec);
+    dlMatrixFree(a);
+    dlMatrixFree(b);
   }
   
   else if (dynListIsMatrix(m1) && DYN_LIST_DATATYPE(m2) == DF_FLOAT) {
@@ -576,18 +547,19 @@ DYN_LIST *dynMatrixMultiply(DYN_LIST *m1, DYN_LIST *m2)
     
     m1_vals = (DYN_LIST **) DYN_LIST_VALS(m1);
     newmat = dfuCreateDynList(DF_LIST, rows1);
-    vec = dfuCreateDynList(DF_FLOAT, cols1);
     r2 = (float *) DYN_LIST_VALS(m2);
     
     for (i = 0; i < rows1; i++) {
       row = (float *) DYN_LIST_VALS(m1_vals[i]);
-      dfuResetDynList(vec);
-      for (j = 0; j < cols1; j++) {
-	dfuAddDynListFloat(vec, row[j]*r2[j]);
+      if (!(vals = (float *) malloc(cols1*sizeof(float))) ||
+	  !(vec = dfuCreateDynListWithVals(DF_FLOAT, cols1, vals))) {
+	if (vals) free(vals);
+	dfuFreeDynList(newmat);
+	return NULL;
       }
-      dfuAddDynListList(newmat, vec);
+      for (j = 0; j < cols1; j++) vals[j] = row[j]*r2[j];
+      dfuMoveDynListList(newmat, vec);
     }
-    dfuFreeDynList(vec);
   }
   
   return(newmat);
@@ -845,6 +817,253 @@ DYN_LIST *dynMatrixReshape(DYN_LIST *l, int nrows, int ncols)
 }
 
 
+/*
+ * Decompositions and solvers (dllinalg.c), in double on copies of the
+ * float matrices
+ */
+
+static double *dynMatrixDoubles(DYN_LIST *m, int *nrows, int *ncols)
+{
+  int i, j;
+  DYN_LIST **rows;
+  float *row;
+  double *vals;
+
+  if (!dynMatrixDims(m, nrows, ncols)) return NULL;
+  vals = (double *) malloc((size_t) *nrows * *ncols * sizeof(double));
+  if (!vals) return NULL;
+  rows = (DYN_LIST **) DYN_LIST_VALS(m);
+  for (i = 0; i < *nrows; i++) {
+    row = (float *) DYN_LIST_VALS(rows[i]);
+    for (j = 0; j < *ncols; j++) vals[(size_t) i * *ncols + j] = row[j];
+  }
+  return vals;
+}
+
+/* the first ncols of each row of the nrows x stride doubles in vals */
+static DYN_LIST *dynMatrixFromDoubles(double *vals, int nrows, int ncols,
+				      int stride)
+{
+  int i, j;
+  float **rows;
+  DYN_LIST *newmat;
+
+  if (!(rows = (float **) malloc(nrows*sizeof(float *)))) return NULL;
+  if ((newmat = dlMatrixNewList(nrows, ncols, rows))) {
+    for (i = 0; i < nrows; i++)
+      for (j = 0; j < ncols; j++) rows[i][j] = vals[(size_t) i*stride+j];
+  }
+  free(rows);
+  return(newmat);
+}
+
+static DYN_LIST *dynListFromDoubles(double *vals, int n)
+{
+  int i;
+  float *fvals;
+  DYN_LIST *dl;
+
+  if (!(fvals = (float *) malloc(n*sizeof(float)))) return NULL;
+  for (i = 0; i < n; i++) fvals[i] = vals[i];
+  if (!(dl = dfuCreateDynListWithVals(DF_FLOAT, n, fvals))) free(fvals);
+  return(dl);
+}
+
+/* list of the n lists given, which are freed if any is NULL */
+static DYN_LIST *dynMatrixResults(int n, DYN_LIST **lists)
+{
+  int i;
+  DYN_LIST *results = NULL;
+
+  for (i = 0; i < n; i++) if (!lists[i]) break;
+  if (i == n && (results = dfuCreateDynList(DF_LIST, n))) {
+    for (i = 0; i < n; i++) dfuMoveDynListList(results, lists[i]);
+    return(results);
+  }
+  for (i = 0; i < n; i++) if (lists[i]) dfuFreeDynList(lists[i]);
+  return(NULL);
+}
+
+/*
+ * dynMatrixQR - list of q (m x k) and r (k x n), k = min(m,n)
+ */
+
+DYN_LIST *dynMatrixQR(DYN_LIST *m)
+{
+  int nrows, ncols, k;
+  double *a, *q, *r;
+  DYN_LIST *lists[2] = { NULL, NULL }, *result = NULL;
+
+  if (!(a = dynMatrixDoubles(m, &nrows, &ncols))) return NULL;
+  k = (nrows < ncols) ? nrows : ncols;
+  q = (double *) malloc((size_t) nrows*k*sizeof(double));
+  r = (double *) malloc((size_t) k*ncols*sizeof(double));
+  if (q && r && dlQR(a, nrows, ncols, q, r) == DL_LINALG_OK) {
+    lists[0] = dynMatrixFromDoubles(q, nrows, k, k);
+    lists[1] = dynMatrixFromDoubles(r, k, ncols, ncols);
+    result = dynMatrixResults(2, lists);
+  }
+  if (q) free(q);
+  if (r) free(r);
+  free(a);
+  return(result);
+}
+
+/*
+ * dynMatrixCholesky - lower triangular l with l l' = m, or NULL if m
+ * is not square and positive definite
+ */
+
+DYN_LIST *dynMatrixCholesky(DYN_LIST *m)
+{
+  int nrows, ncols;
+  double *a, *l;
+  DYN_LIST *result = NULL;
+
+  if (!(a = dynMatrixDoubles(m, &nrows, &ncols))) return NULL;
+  if (nrows == ncols &&
+      (l = (double *) malloc((size_t) nrows*nrows*sizeof(double)))) {
+    if (dlCholesky(a, nrows, l) == DL_LINALG_OK)
+      result = dynMatrixFromDoubles(l, nrows, nrows, nrows);
+    free(l);
+  }
+  free(a);
+  return(result);
+}
+
+/*
+ * dynMatrixEigen - list of the eigenvalues (descending) of the
+ * symmetric m and a matrix with the eigenvectors as its columns
+ */
+
+DYN_LIST *dynMatrixEigen(DYN_LIST *m)
+{
+  int nrows, ncols;
+  double *a, *w, *v;
+  DYN_LIST *lists[2] = { NULL, NULL }, *result = NULL;
+
+  if (!(a = dynMatrixDoubles(m, &nrows, &ncols))) return NULL;
+  if (nrows == ncols) {
+    w = (double *) malloc(nrows*sizeof(double));
+    v = (double *) malloc((size_t) nrows*nrows*sizeof(double));
+    if (w && v && dlEigenSym(a, nrows, w, v) == DL_LINALG_OK) {
+      lists[0] = dynListFromDoubles(w, nrows);
+      lists[1] = dynMatrixFromDoubles(v, nrows, nrows, nrows);
+      result = dynMatrixResults(2, lists);
+    }
+    if (w) free(w);
+    if (v) free(v);
+  }
+  free(a);
+  return(result);
+}
+
+/*
+ * dynMatrixSVD - list of u (m x k), the singular values (descending)
+ * and v (n x k), k = min(m,n), with m = u diag(s) v'
+ */
+
+DYN_LIST *dynMatrixSVD(DYN_LIST *m)
+{
+  int nrows, ncols, k;
+  double *a, *u, *s, *v;
+  DYN_LIST *lists[3] = { NULL, NULL, NULL }, *result = NULL;
+
+  if (!(a = dynMatrixDoubles(m, &nrows, &ncols))) return NULL;
+  k = (nrows < ncols) ? nrows : ncols;
+  u = (double *) malloc((size_t) nrows*k*sizeof(double));
+  s = (double *) malloc(k*sizeof(double));
+  v = (double *) malloc((size_t) ncols*k*sizeof(double));
+  if (u && s && v && dlSVD(a, nrows, ncols, u, s, v) == DL_LINALG_OK) {
+    lists[0] = dynMatrixFromDoubles(u, nrows, k, k);
+    lists[1] = dynListFromDoubles(s, k);
+    lists[2] = dynMatrixFromDoubles(v, ncols, k, k);
+    result = dynMatrixResults(3, lists);
+  }
+  if (u) free(u);
+  if (s) free(s);
+  if (v) free(v);
+  free(a);
+  return(result);
+}
+
+/*
+ * dynMatrixLstsq - least squares b for x b = y, where y is a matrix
+ * with a column per response (b is then a matrix with a column per
+ * response) or a single response vector.  NULL if the rows of x and
+ * y differ or x is rank deficient.
+ */
+
+DYN_LIST *dynMatrixLstsq(DYN_LIST *x, DYN_LIST *y)
+{
+  int i, nrows, ncols, yrows, ycols, vector = 0;
+  double *a, *b = NULL, *yvals = NULL;
+  DYN_LIST *fy, *result = NULL;
+
+  if (!(a = dynMatrixDoubles(x, &nrows, &ncols))) return NULL;
+  if (dynListIsMatrix(y)) {
+    yvals = dynMatrixDoubles(y, &yrows, &ycols);
+  }
+  else if (DYN_LIST_DATATYPE(y) != DF_LIST &&
+	   DYN_LIST_DATATYPE(y) != DF_STRING &&
+	   (fy = dynListConvertList(y, DF_FLOAT))) {
+    yrows = DYN_LIST_N(fy);
+    ycols = 1;
+    vector = 1;
+    if ((yvals = (double *) malloc(yrows*sizeof(double))))
+      for (i = 0; i < yrows; i++) yvals[i] = ((float *) DYN_LIST_VALS(fy))[i];
+    dfuFreeDynList(fy);
+  }
+
+  if (yvals && yrows == nrows &&
+      (b = (double *) malloc((size_t) ncols*ycols*sizeof(double))) &&
+      dlLstsq(a, nrows, ncols, yvals, ycols, b) == DL_LINALG_OK) {
+    if (vector) result = dynListFromDoubles(b, ncols);
+    else result = dynMatrixFromDoubles(b, ncols, ycols, ycols);
+  }
+  if (b) free(b);
+  if (yvals) free(yvals);
+  free(a);
+  return(result);
+}
+
+/*
+ * dynMatrixPCA - principal components of the rows (observations) of
+ * m: list of the loadings (a column per component), the scores (a
+ * column per component), the variance along each component and the
+ * proportion of the total variance that is.  ncomps <= 0 keeps them
+ * all.
+ */
+
+DYN_LIST *dynMatrixPCA(DYN_LIST *m, int ncomps)
+{
+  int i, nrows, ncols, k;
+  double *a, *loadings, *scores, *vars, total;
+  DYN_LIST *lists[4] = { NULL, NULL, NULL, NULL }, *result = NULL;
+
+  if (!(a = dynMatrixDoubles(m, &nrows, &ncols))) return NULL;
+  k = (ncomps <= 0 || ncomps > ncols) ? ncols : ncomps;
+  loadings = (double *) malloc((size_t) ncols*k*sizeof(double));
+  scores = (double *) malloc((size_t) nrows*k*sizeof(double));
+  vars = (double *) malloc(ncols*sizeof(double));
+  if (loadings && scores && vars &&
+      dlPCA(a, nrows, ncols, k, loadings, scores, vars) == DL_LINALG_OK) {
+    lists[0] = dynMatrixFromDoubles(loadings, ncols, k, k);
+    lists[1] = dynMatrixFromDoubles(scores, nrows, k, k);
+    lists[2] = dynListFromDoubles(vars, k);
+    for (i = 0, total = 0.0; i < ncols; i++) total += vars[i];
+    for (i = 0; i < k; i++) vars[i] = (total > 0.0) ? vars[i]/total : 0.0;
+    lists[3] = dynListFromDoubles(vars, k);
+    result = dynMatrixResults(4, lists);
+  }
+  if (loadings) free(loadings);
+  if (scores) free(scores);
+  if (vars) free(vars);
+  free(a);
+  return(result);
+}
+
+
 static double **dynMatrixToNRCMatrix(DYN_LIST *m)
 {
   int nrows, ncols, i, j;
@@ -22,6 +22,7 @@
 #ifndef _DF_H_
 #define _DF_H_
 
+#include <stdint.h>
 
 #define DF_ASCII  1
 #define DF_BINARY 2
@@ -44,9 +45,17 @@ enum DATA_TYPE {
   DF_FLAG, DF_CHAR, DF_LONG, DF_SHORT, DF_FLOAT, DF_STRUCTURE, 
   DF_STRING, DF_LONG_ARRAY, DF_SHORT_ARRAY, DF_FLOAT_ARRAY,
   DF_STRING_ARRAY, DF_LIST, DF_VOID, DF_VOID_ARRAY, DF_CHAR_ARRAY, 
-  DF_LIST_ARRAY
+  DF_LIST_ARRAY,
+  DF_SIZE_T			/* 64 bit element count                */
 };
 
+/*
+ * Element counts of dynlists and sizes of serialized buffers.  These
+ * are 64 bits wide so a single list (or a whole serialized group) can
+ * grow past 2^31 elements/bytes.
+ */
+typedef int64_t DL_SIZE;
+
 typedef struct _tag_info {
   int   tag_id;			/* enumerated tag identifier           */
   char *tag_name;		/* name to print out when dumped       */
@@ -720,14 +729,19 @@ typedef struct {
  ***********************************************************************/
 
 #define DYN_LIST_NAME_SIZE 64
-typedef struct {
+typedef struct _dyn_list {
   char name[DYN_LIST_NAME_SIZE];/* buffer to hold name of list*/
   int datatype;			/* kind of data store in vals */
-  int increment;		/* how much to reallocate by  */
-  int max;			/* maximum slots currently av.*/
-  int n;			/* number of slots filled     */
+  DL_SIZE increment;		/* how much to reallocate by  */
+  DL_SIZE max;			/* maximum slots currently av.*/
+  DL_SIZE n;			/* number of slots filled     */
   int flags;			/* info about the dynlist     */
   void *vals;			/* pointer to actual data     */
+  struct _dyn_pack *pack;	/* shared packed storage      */
+  struct _dyn_arena *arena;	/* arena holding this header  */
+  struct _dyn_share *share;	/* copy-on-write value buffer */
+  struct _dyn_dict *dict;	/* string table for DL_DICT   */
+  int *codes;			/* per element dict index     */
 } DYN_LIST;
 
 #define DYN_LIST_NAME(d)      ((d)->name)
@@ -737,12 +751,55 @@ typedef struct {
 #define DYN_LIST_N(d)         ((d)->n)
 #define DYN_LIST_VALS(d)      ((d)->vals)
 #define DYN_LIST_FLAGS(d)     ((d)->flags)
+#define DYN_LIST_PACK(d)      ((d)->pack)
+#define DYN_LIST_ARENA(d)     ((d)->arena)
+#define DYN_LIST_SHARE(d)     ((d)->share)
+#define DYN_LIST_DICT(d)      ((d)->dict)
+#define DYN_LIST_CODES(d)     ((d)->codes)
 
 enum DL_FLAG {
   DL_SUBLIST = 0x01,
-  DL_TCLOBJ = 0x02
+  DL_TCLOBJ = 0x02,
+  DL_VIEW = 0x04,		/* vals not owned (DYN_PACK or DYN_ARENA) */
+  DL_PACKED = 0x08,		/* sublists are views into a DYN_PACK */
+  DL_SHARED = 0x10,		/* vals are a DYN_SHARE, copy on write */
+  DL_DICT = 0x20		/* string vals point into a DYN_DICT */
 };
 
+/* in-memory storage flags, never written to or read from files */
+#define DL_STORAGE_FLAGS (DL_VIEW | DL_PACKED | DL_SHARED | DL_DICT)
+
+/***********************************************************************
+ *
+ *   Structure: DYN_PACK
+ *   Refers to: DYN_LIST
+ *   Found in:  DYN_LIST
+ *   Purpose:   Packed (ragged array) storage for a DF_LIST whose
+ *              sublists all share one numeric datatype.  Values live
+ *              in one flat buffer indexed by offsets; the sublists are
+ *              view headers allocated in the same block whose vals
+ *              point into that buffer.  The block is refcounted by the
+ *              parent list and each view header.  A view that needs to
+ *              grow copies its values out and stops borrowing.
+ *
+ ***********************************************************************/
+
+typedef struct _dyn_pack {
+  int refcount;			/* parent + live view headers */
+  int datatype;			/* datatype of packed values  */
+  int nlists;			/* number of sublists         */
+  int nvals;			/* total number of values     */
+  int *offsets;			/* nlists+1 offsets into vals */
+  DYN_LIST *headers;		/* sublist view headers       */
+  void *vals;			/* flat value buffer          */
+} DYN_PACK;
+
+#define DYN_PACK_NLISTS(p)    ((p)->nlists)
+#define DYN_PACK_NVALS(p)     ((p)->nvals)
+#define DYN_PACK_DATATYPE(p)  ((p)->datatype)
+#define DYN_PACK_OFFSETS(p)   ((p)->offsets)
+#define DYN_PACK_VALS(p)      ((p)->vals)
+
 /***********************************************************************
  *
  *   Structure: DYN_OLIST
@@ -754,9 +811,9 @@ enum DL_FLAG {
  ***********************************************************************/
 
 typedef struct {
-  int increment;		/* how much to reallocate by  */
-  int max;			/* maximum slots currently av.*/
-  int n;			/* number of slots filled     */
+  DL_SIZE increment;		/* how much to reallocate by  */
+  DL_SIZE max;			/* maximum slots currently av.*/
+  DL_SIZE n;			/* number of slots filled     */
   OBS_P **vals;			/* pointer to obsp pointers   */
 } DYN_OLIST;
 
@@ -776,12 +833,77 @@ typedef struct {
 
 #define DYN_GROUP_NAME_SIZE DYN_LIST_NAME_SIZE
 
+/***********************************************************************
+ *
+ *   Structure: DYN_ARENA
+ *   Refers to: None
+ *   Found in:  DYN_GROUP, DYN_LIST
+ *   Purpose:   Bump allocator optionally owned by a DYN_GROUP.  List
+ *              headers and data read into the group are carved from
+ *              large chunks and released together.  The arena is
+ *              refcounted by the group and by each list allocated
+ *              from it, so lists that are moved out of the group keep
+ *              it alive; their vals are marked DL_VIEW and are copied
+ *              to private storage when the list needs to grow.
+ *
+ ***********************************************************************/
+
+typedef struct _dyn_arena {
+  int refcount;			/* owning group + live lists  */
+  int chunksize;		/* default size of new chunks */
+  struct _dyn_arena_chunk *chunks; /* chunk list, newest first */
+} DYN_ARENA;
+
+/***********************************************************************
+ *
+ *   Structure: DYN_SHARE
+ *   Refers to: DYN_ARENA
+ *   Found in:  DYN_LIST
+ *   Purpose:   Numeric value buffer shared by copies of a list.  Each
+ *              sharing list is flagged DL_VIEW | DL_SHARED and holds
+ *              one reference; a list that is about to be modified
+ *              gets its own copy first (or takes the buffer over if
+ *              it is the last user).  Values carved from an arena
+ *              keep the arena alive instead of being freed.
+ *
+ ***********************************************************************/
+
+typedef struct _dyn_share {
+  int refcount;			/* lists sharing vals         */
+  void *vals;			/* shared value buffer        */
+  DYN_ARENA *arena;		/* arena owning vals, or NULL */
+} DYN_SHARE;
+
+/***********************************************************************
+ *
+ *   Structure: DYN_DICT
+ *   Refers to: None
+ *   Found in:  DYN_LIST
+ *   Purpose:   String table of a dictionary encoded (DL_DICT) string
+ *              list.  The list keeps an int code per element and its
+ *              vals point at the interned strings, so ordinary readers
+ *              see a normal DF_STRING list.  Tables are refcounted and
+ *              shared by copies, sorts and uniques of the list, which
+ *              lets comparisons between them run on the codes.  The
+ *              strings are kept in sorted order, so codes sort the
+ *              same way the strings do.  Any modification of the list
+ *              decodes it back to private strings first.
+ *
+ ***********************************************************************/
+
+typedef struct _dyn_dict {
+  int refcount;			/* lists using this table     */
+  int nstrings;			/* number of distinct strings */
+  char **strings;		/* sorted, distinct strings   */
+} DYN_DICT;
+
 typedef struct {
   char name[DYN_GROUP_NAME_SIZE];/* name of group              */
   int increment;		/* how much to reallocate by  */
   int max;			/* maximum slots currently av.*/
   int nlists;
   DYN_LIST **lists;		/* pointer to allocated lists */
+  DYN_ARENA *arena;		/* optional list allocator    */
 } DYN_GROUP;
 
 #define DYN_GROUP_NAME(d)      ((d)->name)
@@ -791,6 +913,7 @@ typedef struct {
 #define DYN_GROUP_NLISTS(d)    ((d)->nlists)
 #define DYN_GROUP_LISTS(d)     ((d)->lists)
 #define DYN_GROUP_LIST(d,i)    (DYN_GROUP_LISTS(d)[i])
+#define DYN_GROUP_ARENA(d)     ((d)->arena)
 
 
 /***********************************************************************
@@ -805,8 +928,8 @@ typedef struct {
 
 typedef struct {
   unsigned char *buffer;
-  int size;
-  int index;
+  DL_SIZE size;
+  DL_SIZE index;
 } BUF_DATA;
 
 #define BD_BUFFER(b)     ((b)->buffer)
@@ -897,13 +1020,14 @@ void dfuSetEmWindow(EM_DATA *emdata, int v0, int v1, int v2, int v3);
 void dfuSetSpChSource(SP_DATA *spdata, int channel, char source);
 void dfuSetSpChCellnum(SP_DATA *spdata, int channel, int cellnum);
 
-DYN_LIST *dfuCreateDynList(int type, int increment);
+DYN_LIST *dfuCreateDynList(int type, DL_SIZE increment);
 DYN_GROUP *dfuCreateDynGroup(int nlists);
-DYN_LIST *dfuCreateDynListWithVals(int datatype, int n, void *vals);
+DYN_LIST *dfuCreateDynListWithVals(int datatype, DL_SIZE n, void *vals);
 
-DYN_LIST *dfuCreateNamedDynList(char *name, int type, int increment);
+DYN_LIST *dfuCreateNamedDynList(char *name, int type, DL_SIZE increment);
 DYN_GROUP *dfuCreateNamedDynGroup(char *name, int nlists);
-DYN_LIST *dfuCreateNamedDynListWithVals(char *name, int t, int n, void *vals);
+DYN_LIST *dfuCreateNamedDynListWithVals(char *name, int t, DL_SIZE n,
+					void *vals);
 DYN_GROUP *dfuCopyDynGroup(DYN_GROUP *dg, char *name);
 int dfuAddDynGroupNewList(DYN_GROUP *, char *name, int type, int increment);
 int dfuAddDynGroupExistingList(DYN_GROUP *dg, char *name, DYN_LIST *list);
@@ -932,6 +1056,33 @@ void dfuAddDynListString(DYN_LIST *dynlist, char *string);
 
 void dfuMoveDynListList(DYN_LIST *, DYN_LIST *);
 
+int dfuDynListElementSize(int datatype);
+int dfuReserveDynList(DYN_LIST *, DL_SIZE n);
+DL_SIZE dfuAppendDynListN(DYN_LIST *, void *vals, DL_SIZE n);
+
+DYN_LIST *dfuCreatePackedDynList(char *name, int datatype, int nlists,
+				 int *offsets, void *vals);
+int dfuPackDynList(DYN_LIST *);
+int dfuUnpackDynList(DYN_LIST *);
+DYN_PACK *dfuGetDynListPack(DYN_LIST *);
+
+DYN_ARENA *dfuCreateDynArena(int chunksize);
+void *dfuArenaAlloc(DYN_ARENA *, DL_SIZE size);
+void dfuReleaseDynArena(DYN_ARENA *);
+DYN_LIST *dfuArenaNewDynList(DYN_ARENA *);
+DYN_ARENA *dfuEnableDynGroupArena(DYN_GROUP *);
+
+int dfuUnshareDynList(DYN_LIST *);
+int dfuIsSharedDynList(DYN_LIST *);
+
+DYN_DICT *dfuCreateDynDict(int nstrings, char **strings);
+void dfuReleaseDynDict(DYN_DICT *);
+int dfuDictEncodeDynList(DYN_LIST *);
+int dfuDictDecodeDynList(DYN_LIST *);
+DYN_DICT *dfuGetDynListDict(DYN_LIST *);
+int dfuSetDynListDict(DYN_LIST *, DYN_DICT *, DL_SIZE n, int *codes);
+DYN_LIST *dfuCreateDictDynList(char *name, DYN_DICT *, DL_SIZE n, int *codes);
+
 void dfuPrependDynListLong(DYN_LIST *, int);
 void dfuPrependDynListShort(DYN_LIST *, short);
 void dfuPrependDynListFloat(DYN_LIST *, float);
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 
 #if defined(SUN4) || defined(LYNX)
 #include <unistd.h>
@@ -26,6 +27,11 @@
 
 static int dfFlipEvents = 0;	/* to make up for byte ordering probs */
 
+static void dfuReleaseDynPack(DYN_PACK *pack);
+static int dfuIsDynPackHeader(DYN_PACK *pack, DYN_LIST *dl);
+static DYN_SHARE *dfuShareDynListVals(DYN_LIST *dl);
+static void dfuReleaseDynShare(DYN_SHARE *share);
+
 /*--------------------------------------------------------------------
   -----               Magic Number Functions                     -----
   -------------------------------------------------------------------*/
@@ -2884,7 +2890,7 @@ void dfuAddEmData(DYN_GROUP *emgroup, short hsamp, short vsamp)
  *
  ***********************************************************************/
 
-DYN_LIST *dfuCreateDynList(int datatype, int increment)
+DYN_LIST *dfuCreateDynList(int datatype, DL_SIZE increment)
 {
   return(dfuCreateNamedDynList("", datatype, increment));
 }
@@ -2898,7 +2904,7 @@ DYN_LIST *dfuCreateDynList(int datatype, int increment)
  *
  ***********************************************************************/
 
-DYN_LIST *dfuCreateNamedDynList(char *name, int datatype, int increment)
+DYN_LIST *dfuCreateNamedDynList(char *name, int datatype, DL_SIZE increment)
 {
   DYN_LIST *dynlist = (DYN_LIST *) calloc(1, sizeof(DYN_LIST));
   if (!dynlist) {
@@ -2970,7 +2976,7 @@ DYN_LIST *dfuCreateNamedDynList(char *name, int datatype, int increment)
  *
  ***********************************************************************/
 
-DYN_LIST *dfuCreateDynListWithVals(int datatype, int n, void *vals)
+DYN_LIST *dfuCreateDynListWithVals(int datatype, DL_SIZE n, void *vals)
 {
   return(dfuCreateNamedDynListWithVals("", datatype, n, vals));
 }
@@ -2983,7 +2989,8 @@ DYN_LIST *dfuCreateDynListWithVals(int datatype, int n, void *vals)
  *
  ***********************************************************************/
 
-DYN_LIST *dfuCreateNamedDynListWithVals(char *name, int t, int n, void *vals)
+DYN_LIST *dfuCreateNamedDynListWithVals(char *name, int t, DL_SIZE n,
+					void *vals)
 {
   DYN_LIST *dynlist;
 
@@ -3016,20 +3023,60 @@ DYN_LIST *dfuCreateNamedDynListWithVals(char *name, int t, int n, void *vals)
  *
  * dfuCopyDynList()
  *
- *    Create a copy of a dynamic list.
+ *    Create a copy of a dynamic list.  Numeric values are not copied:
+ *  the copy shares them with old (see DYN_SHARE) until either list is
+ *  modified.  Strings are duplicated and sublists copied the same way.
  *
  ***********************************************************************/
 
 DYN_LIST *dfuCopyDynList(DYN_LIST *old)
 {
-  int i, n;
+  DL_SIZE i, n;
   DYN_LIST *new;
+  DYN_SHARE *share;
   if (!old) return(NULL);
 
   new = (DYN_LIST *) calloc(1, sizeof(DYN_LIST));
 
   memcpy(new, old, sizeof(DYN_LIST));
 
+  /* copies never inherit the source's storage */
+  DYN_LIST_FLAGS(new) &= ~DL_STORAGE_FLAGS;
+  DYN_LIST_PACK(new) = NULL;
+  DYN_LIST_ARENA(new) = NULL;
+  DYN_LIST_SHARE(new) = NULL;
+  DYN_LIST_DICT(new) = NULL;
+  DYN_LIST_CODES(new) = NULL;
+
+  if (DYN_LIST_INCREMENT(old) == 0) {
+    DYN_LIST_INCREMENT(new) = 2;
+  }
+
+  /* dictionary encoded copies point at the same string table */
+  if (DYN_LIST_FLAGS(old) & DL_DICT) {
+    n = DYN_LIST_N(old) ? DYN_LIST_N(old) : 1;
+    DYN_LIST_VALS(new) = malloc(n*sizeof(char *));
+    DYN_LIST_CODES(new) = (int *) malloc(n*sizeof(int));
+    memcpy(DYN_LIST_VALS(new), DYN_LIST_VALS(old),
+	   DYN_LIST_N(old)*sizeof(char *));
+    memcpy(DYN_LIST_CODES(new), DYN_LIST_CODES(old),
+	   DYN_LIST_N(old)*sizeof(int));
+    DYN_LIST_DICT(new) = DYN_LIST_DICT(old);
+    DYN_LIST_DICT(new)->refcount++;
+    DYN_LIST_FLAGS(new) |= DL_DICT;
+    DYN_LIST_MAX(new) = DYN_LIST_N(old);
+    return(new);
+  }
+
+  if ((share = dfuShareDynListVals(old))) {
+    share->refcount++;
+    DYN_LIST_FLAGS(new) |= DL_VIEW | DL_SHARED;
+    DYN_LIST_SHARE(new) = share;
+    DYN_LIST_VALS(new) = DYN_LIST_VALS(old);
+    DYN_LIST_MAX(new) = DYN_LIST_N(old);
+    return(new);
+  }
+
   /* 
    * This is a strange situation, but something that we take care of
    *  by making sure that the copy actually allocates some space
@@ -3039,10 +3086,6 @@ DYN_LIST *dfuCopyDynList(DYN_LIST *old)
     n = 2;
   }
   else n = DYN_LIST_MAX(old);
-
-  if (DYN_LIST_INCREMENT(old) == 0) {
-    DYN_LIST_INCREMENT(new) = 2;
-  }
   
 
   switch (DYN_LIST_DATATYPE(old)) {
@@ -3091,6 +3134,7 @@ DYN_LIST *dfuCopyDynList(DYN_LIST *old)
       for (i = 0; i < DYN_LIST_N(old); i++) {
 	vals[i] = dfuCopyDynList(oldvals[i]);
       }
+      if (dfuGetDynListPack(old)) dfuPackDynList(new);
     }
     break;
   }
@@ -3250,15 +3294,44 @@ void dfuResetDynList(DYN_LIST *dynlist)
     }
   }
 
-  /* free any allocated strings */
+  /* free any allocated strings (dictionary strings belong to the dict) */
 
-  else if (DYN_LIST_DATATYPE(dynlist) == DF_STRING) {
+  else if (DYN_LIST_DATATYPE(dynlist) == DF_STRING &&
+	   !(DYN_LIST_FLAGS(dynlist) & DL_DICT)) {
     char **vals = DYN_LIST_VALS(dynlist);
     for (i = 0; i < DYN_LIST_N(dynlist); i++) {
       if (vals[i]) free(vals[i]);
     }
   }
 
+  if (DYN_LIST_FLAGS(dynlist) & DL_DICT) {
+    free(DYN_LIST_CODES(dynlist));
+    dfuReleaseDynDict(DYN_LIST_DICT(dynlist));
+    DYN_LIST_CODES(dynlist) = NULL;
+    DYN_LIST_DICT(dynlist) = NULL;
+    DYN_LIST_FLAGS(dynlist) &= ~DL_DICT;
+  }
+
+  /* a shared list refills private storage rather than the shared vals */
+  if (DYN_LIST_FLAGS(dynlist) & DL_SHARED) {
+    DL_SIZE max = DYN_LIST_INCREMENT(dynlist) > 0 ?
+      DYN_LIST_INCREMENT(dynlist) : 1;
+    dfuReleaseDynShare(DYN_LIST_SHARE(dynlist));
+    DYN_LIST_SHARE(dynlist) = NULL;
+    DYN_LIST_FLAGS(dynlist) &= ~(DL_VIEW | DL_SHARED);
+    DYN_LIST_VALS(dynlist) =
+      calloc(max, dfuDynListElementSize(DYN_LIST_DATATYPE(dynlist)));
+    DYN_LIST_MAX(dynlist) = DYN_LIST_VALS(dynlist) ? max : 0;
+  }
+
+  /* a packed parent no longer refers to its pack once emptied */
+  if ((DYN_LIST_FLAGS(dynlist) & DL_PACKED) && DYN_LIST_PACK(dynlist) &&
+      !dfuIsDynPackHeader(DYN_LIST_PACK(dynlist), dynlist)) {
+    dfuReleaseDynPack(DYN_LIST_PACK(dynlist));
+    DYN_LIST_PACK(dynlist) = NULL;
+    DYN_LIST_FLAGS(dynlist) &= ~DL_PACKED;
+  }
+
   DYN_LIST_N(dynlist) = 0;
 }
 
@@ -3277,6 +3350,12 @@ DYN_LIST *dfuResetDynListToType(DYN_LIST *dynlist, int datatype, int increment)
 
   dfuResetDynList(dynlist);
 
+  /* a view does not own its vals; start over with private storage */
+  if (DYN_LIST_FLAGS(dynlist) & DL_VIEW) {
+    DYN_LIST_VALS(dynlist) = NULL;
+    DYN_LIST_FLAGS(dynlist) &= ~DL_VIEW;
+  }
+
   /* Don't allow zero length allocs */
   if (!increment) increment++;
 
@@ -3338,6 +3417,172 @@ void dfuResetDynGroup(DYN_GROUP *dyngroup)
 
 
 
+/***********************************************************************
+ *
+ * dfuDynListElementSize(int datatype)
+ *
+ *    Return the size of a single element stored in a list of datatype,
+ *  or 0 for unsupported types.
+ *
+ ***********************************************************************/
+
+int dfuDynListElementSize(int datatype)
+{
+  switch (datatype) {
+  case DF_LONG:   return sizeof(int);
+  case DF_SHORT:  return sizeof(short);
+  case DF_FLOAT:  return sizeof(float);
+  case DF_CHAR:   return sizeof(char);
+  case DF_STRING: return sizeof(char *);
+  case DF_LIST:   return sizeof(DYN_LIST *);
+  default:        return 0;
+  }
+}
+
+/***********************************************************************
+ *
+ * dfuGrowDynListMax(DYN_LIST *)
+ *
+ *    Return the next capacity for a full dynamic list.  Lists grow
+ *  geometrically (by half their current size) so that building a
+ *  long list one element at a time costs amortized constant realloc
+ *  traffic; the list's increment is still honored as the minimum step.
+ *
+ ***********************************************************************/
+
+static DL_SIZE dfuGrowDynListMax(DYN_LIST *dynlist)
+{
+  DL_SIZE grow = DYN_LIST_MAX(dynlist) >> 1;
+  if (grow < DYN_LIST_INCREMENT(dynlist)) grow = DYN_LIST_INCREMENT(dynlist);
+  if (grow < 1) grow = 1;
+  return DYN_LIST_MAX(dynlist) + grow;
+}
+
+/***********************************************************************
+ *
+ * dfuResizeDynListVals(DYN_LIST *, DL_SIZE max)
+ *
+ *    Reallocate the vals array to hold max elements.  A view into a
+ *  packed parent (or shared values) does not own its vals, so its
+ *  values are copied into private storage instead.  Returns the new
+ *  vals (NULL on failure).
+ *
+ ***********************************************************************/
+
+static void *dfuResizeDynListVals(DYN_LIST *dynlist, DL_SIZE max)
+{
+  void *vals;
+  int size = dfuDynListElementSize(DYN_LIST_DATATYPE(dynlist));
+  if (!size) return NULL;
+
+  /* growing a dictionary encoded list gives it private strings */
+  if ((DYN_LIST_FLAGS(dynlist) & DL_DICT) && !dfuDictDecodeDynList(dynlist))
+    return NULL;
+
+  /* the last user of a shared buffer can simply take it over */
+  if ((DYN_LIST_FLAGS(dynlist) & DL_SHARED) &&
+      DYN_LIST_SHARE(dynlist)->refcount == 1 &&
+      !DYN_LIST_SHARE(dynlist)->arena)
+    dfuUnshareDynList(dynlist);
+
+  if (DYN_LIST_FLAGS(dynlist) & DL_VIEW) {
+    vals = malloc((size_t) size * max);
+    if (!vals) return NULL;
+    memcpy(vals, DYN_LIST_VALS(dynlist), (size_t) size * DYN_LIST_N(dynlist));
+    if (DYN_LIST_FLAGS(dynlist) & DL_SHARED) {
+      dfuReleaseDynShare(DYN_LIST_SHARE(dynlist));
+      DYN_LIST_SHARE(dynlist) = NULL;
+    }
+    DYN_LIST_FLAGS(dynlist) &= ~(DL_VIEW | DL_SHARED);
+  }
+  else {
+    vals = realloc(DYN_LIST_VALS(dynlist), (size_t) size * max);
+    if (!vals) return NULL;
+  }
+
+  DYN_LIST_VALS(dynlist) = vals;
+  DYN_LIST_MAX(dynlist) = max;
+  return vals;
+}
+
+static void *dfuGrowDynListVals(DYN_LIST *dynlist)
+{
+  return dfuResizeDynListVals(dynlist, dfuGrowDynListMax(dynlist));
+}
+
+/***********************************************************************
+ *
+ * dfuReserveDynList(DYN_LIST *, DL_SIZE n)
+ *
+ *    Ensure that the list can hold at least n elements without
+ *  further reallocation.  Returns 1 on success, 0 on failure.
+ *
+ ***********************************************************************/
+
+int dfuReserveDynList(DYN_LIST *dynlist, DL_SIZE n)
+{
+  if (!dynlist || n < 0) return 0;
+  if (n <= DYN_LIST_MAX(dynlist)) return 1;
+  return dfuResizeDynListVals(dynlist, n) != NULL;
+}
+
+/***********************************************************************
+ *
+ * dfuAppendDynListN(DYN_LIST *, void *vals, DL_SIZE n)
+ *
+ *    Append n elements stored contiguously at vals (in the list's own
+ *  element representation) to a dynamic list, growing storage once.
+ *  Strings are copied and DF_LIST elements are deep copied, as with
+ *  dfuAddDynListString and dfuAddDynListList.  Returns the number of
+ *  elements appended, or -1 on failure.
+ *
+ ***********************************************************************/
+
+DL_SIZE dfuAppendDynListN(DYN_LIST *dynlist, void *vals, DL_SIZE n)
+{
+  DL_SIZE i, need, max;
+  int size;
+
+  if (!dynlist || n < 0 || (n && !vals)) return -1;
+  if (!n) return 0;
+
+  size = dfuDynListElementSize(DYN_LIST_DATATYPE(dynlist));
+  if (!size) return -1;
+
+  need = DYN_LIST_N(dynlist) + n;
+  if (need > DYN_LIST_MAX(dynlist)) {
+    max = dfuGrowDynListMax(dynlist);
+    if (max < need) max = need;
+    if (!dfuReserveDynList(dynlist, max)) return -1;
+  }
+
+  switch (DYN_LIST_DATATYPE(dynlist)) {
+  case DF_STRING:
+    {
+      char **src = (char **) vals;
+      char **dst = (char **) DYN_LIST_VALS(dynlist) + DYN_LIST_N(dynlist);
+      for (i = 0; i < n; i++) {
+	dst[i] = malloc(strlen(src[i])+1);
+	strcpy(dst[i], src[i]);
+      }
+    }
+    break;
+  case DF_LIST:
+    {
+      DYN_LIST **src = (DYN_LIST **) vals;
+      DYN_LIST **dst = (DYN_LIST **) DYN_LIST_VALS(dynlist) + DYN_LIST_N(dynlist);
+      for (i = 0; i < n; i++) dst[i] = dfuCopyDynList(src[i]);
+    }
+    break;
+  default:
+    memcpy((char *) DYN_LIST_VALS(dynlist) + (size_t) size*DYN_LIST_N(dynlist),
+	   vals, (size_t) size*n);
+    break;
+  }
+  DYN_LIST_N(dynlist) += n;
+  return n;
+}
+
 /***********************************************************************
  *
  * dfuAddDynListLong(DYN_LIST *, int val)
@@ -3355,8 +3600,7 @@ void dfuAddDynListLong(DYN_LIST *dynlist, int val)
   vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (int *) realloc(vals, sizeof(int)*DYN_LIST_MAX(dynlist));
+    vals = (int *) dfuGrowDynListVals(dynlist);
   }
   vals[DYN_LIST_N(dynlist)] = val;
   DYN_LIST_N(dynlist)++;
@@ -3396,8 +3640,7 @@ int dfuInsertDynListLong(DYN_LIST *dynlist, int val, int pos)
   vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (int *) realloc(vals, sizeof(int)*DYN_LIST_MAX(dynlist));
+    vals = (int *) dfuGrowDynListVals(dynlist);
   }
 
   for (i = DYN_LIST_N(dynlist); i > pos; i--) {
@@ -3424,8 +3667,7 @@ void dfuAddDynListShort(DYN_LIST *dynlist, short val)
   short *vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (short *) realloc(vals, sizeof(short)*DYN_LIST_MAX(dynlist));
+    vals = (short *) dfuGrowDynListVals(dynlist);
   }
   vals[DYN_LIST_N(dynlist)] = val;
   DYN_LIST_N(dynlist)++;
@@ -3456,8 +3698,7 @@ int dfuInsertDynListShort(DYN_LIST *dynlist, short val, int pos)
   vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (short *) realloc(vals, sizeof(short)*DYN_LIST_MAX(dynlist));
+    vals = (short *) dfuGrowDynListVals(dynlist);
   }
   for (i = DYN_LIST_N(dynlist); i > pos; i--) {
     vals[i] = vals[i-1];
@@ -3483,8 +3724,7 @@ void dfuAddDynListFloat(DYN_LIST *dynlist, float val)
   float *vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (float *) realloc(vals, sizeof(float)*DYN_LIST_MAX(dynlist));
+    vals = (float *) dfuGrowDynListVals(dynlist);
   }
   vals[DYN_LIST_N(dynlist)] = val;
   DYN_LIST_N(dynlist)++;
@@ -3515,8 +3755,7 @@ int dfuInsertDynListFloat(DYN_LIST *dynlist, float val, int pos)
   vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (float *) realloc(vals, sizeof(float)*DYN_LIST_MAX(dynlist));
+    vals = (float *) dfuGrowDynListVals(dynlist);
   }
 
   for (i = DYN_LIST_N(dynlist); i > pos; i--) {
@@ -3543,8 +3782,7 @@ void dfuAddDynListChar(DYN_LIST *dynlist, unsigned char val)
   unsigned char *vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (unsigned char *) realloc(vals, sizeof(char)*DYN_LIST_MAX(dynlist));
+    vals = (unsigned char *) dfuGrowDynListVals(dynlist);
   }
   vals[DYN_LIST_N(dynlist)] = val;
   DYN_LIST_N(dynlist)++;
@@ -3575,8 +3813,7 @@ int dfuInsertDynListChar(DYN_LIST *dynlist, unsigned char val, int pos)
   vals = DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (unsigned char *) realloc(vals, sizeof(char)*DYN_LIST_MAX(dynlist));
+    vals = (unsigned char *) dfuGrowDynListVals(dynlist);
   }
 
   for (i = DYN_LIST_N(dynlist); i > pos; i--) {
@@ -3604,8 +3841,7 @@ void dfuAddDynListString(DYN_LIST *dynlist, char *string)
   char **vals = (char **) DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (char **) realloc(vals, sizeof(char *)*DYN_LIST_MAX(dynlist));
+    vals = (char **) dfuGrowDynListVals(dynlist);
   }
   vals[DYN_LIST_N(dynlist)] = malloc(strlen(string)+1);
   strcpy(vals[DYN_LIST_N(dynlist)], string);
@@ -3637,8 +3873,7 @@ int dfuInsertDynListString(DYN_LIST *dynlist, char *string, int pos)
   if (!dynlist || pos > DYN_LIST_N(dynlist)) return 0;
   vals = (char **) DYN_LIST_VALS(dynlist);
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (char **) realloc(vals, sizeof(char *)*DYN_LIST_MAX(dynlist));
+    vals = (char **) dfuGrowDynListVals(dynlist);
   }
 
   for (i = DYN_LIST_N(dynlist); i > pos; i--) {
@@ -3676,9 +3911,7 @@ void dfuAddDynListList(DYN_LIST *dynlist, DYN_LIST *newlist)
   }
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (DYN_LIST **)
-      realloc(vals, sizeof(DYN_LIST *)*DYN_LIST_MAX(dynlist));
+    vals = (DYN_LIST **) dfuGrowDynListVals(dynlist);
   }
 
   vals[DYN_LIST_N(dynlist)] = dfuCopyDynList(newlist);
@@ -3711,9 +3944,7 @@ void dfuMoveDynListList(DYN_LIST *dynlist, DYN_LIST *newlist)
   }
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = (DYN_LIST **)
-      realloc(vals, sizeof(DYN_LIST *)*DYN_LIST_MAX(dynlist));
+    vals = (DYN_LIST **) dfuGrowDynListVals(dynlist);
   }
 
   vals[DYN_LIST_N(dynlist)] = newlist;
@@ -3746,9 +3977,7 @@ int dfuInsertDynListList(DYN_LIST *dynlist, DYN_LIST *newlist, int pos)
   vals = (DYN_LIST **) DYN_LIST_VALS(dynlist);
 
   if (DYN_LIST_N(dynlist) == DYN_LIST_MAX(dynlist)) {
-    DYN_LIST_MAX(dynlist) += DYN_LIST_INCREMENT(dynlist);
-    vals = 
-      (DYN_LIST **) realloc(vals, sizeof(DYN_LIST *)*DYN_LIST_MAX(dynlist));
+    vals = (DYN_LIST **) dfuGrowDynListVals(dynlist);
   }
 
   for (i = DYN_LIST_N(dynlist); i > pos; i--) {
@@ -3761,6 +3990,721 @@ int dfuInsertDynListList(DYN_LIST *dynlist, DYN_LIST *newlist, int pos)
   return 1;
 }
 
+/***********************************************************************
+ *
+ * dfuNewDynPack(int datatype, int nlists, int nvals)
+ *
+ *    Allocate a DYN_PACK, its view headers, offsets and value buffer
+ *  as a single block.  The refcount starts at zero; attached lists
+ *  each take a reference.
+ *
+ ***********************************************************************/
+
+static DYN_PACK *dfuNewDynPack(int datatype, int nlists, int nvals)
+{
+  DYN_PACK *pack;
+  size_t bytes;
+  int size = dfuDynListElementSize(datatype);
+
+  bytes = sizeof(DYN_PACK) + (size_t) nlists * sizeof(DYN_LIST) +
+    (size_t) (nlists+1) * sizeof(int) + (size_t) (nvals ? nvals : 1) * size;
+  pack = (DYN_PACK *) malloc(bytes);
+  if (!pack) {
+    fprintf(stderr,"dlsh/dlwish: out of memory\n");
+    return(NULL);
+  }
+
+  pack->refcount = 0;
+  pack->datatype = datatype;
+  pack->nlists = nlists;
+  pack->nvals = nvals;
+  pack->headers = (DYN_LIST *) (pack + 1);
+  pack->offsets = (int *) (pack->headers + nlists);
+  pack->vals = (void *) (pack->offsets + nlists + 1);
+  memset(pack->headers, 0, (size_t) nlists * sizeof(DYN_LIST));
+  return pack;
+}
+
+static void dfuReleaseDynPack(DYN_PACK *pack)
+{
+  if (pack && --pack->refcount <= 0) free(pack);
+}
+
+static int dfuIsDynPackHeader(DYN_PACK *pack, DYN_LIST *dl)
+{
+  return (dl >= pack->headers && dl < pack->headers + pack->nlists);
+}
+
+/***********************************************************************
+ *
+ * dfuAttachDynPack(DYN_LIST *, DYN_PACK *)
+ *
+ *    Fill the (empty) DF_LIST dynlist with view headers for each
+ *  sublist in pack.  Offsets and values must already be in place.
+ *
+ ***********************************************************************/
+
+static void dfuAttachDynPack(DYN_LIST *dynlist, DYN_PACK *pack)
+{
+  int i, size = dfuDynListElementSize(pack->datatype);
+  DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dynlist);
+  DYN_LIST *h;
+
+  for (i = 0; i < pack->nlists; i++) {
+    h = &pack->headers[i];
+    DYN_LIST_DATATYPE(h) = pack->datatype;
+    DYN_LIST_N(h) = pack->offsets[i+1] - pack->offsets[i];
+    DYN_LIST_MAX(h) = DYN_LIST_N(h);
+    if (!DYN_LIST_INCREMENT(h)) DYN_LIST_INCREMENT(h) = 10;
+    DYN_LIST_FLAGS(h) = DL_VIEW;
+    DYN_LIST_VALS(h) = (char *) pack->vals + (size_t) size*pack->offsets[i];
+    DYN_LIST_PACK(h) = pack;
+    pack->refcount++;
+    vals[i] = h;
+  }
+  DYN_LIST_N(dynlist) = pack->nlists;
+  DYN_LIST_FLAGS(dynlist) |= DL_PACKED;
+  DYN_LIST_PACK(dynlist) = pack;
+  pack->refcount++;
+}
+
+/***********************************************************************
+ *
+ * dfuCreatePackedDynList(char *name, int type, int nlists, 
+ *                        int *offsets, void *vals)
+ *
+ *    Create a packed DF_LIST of nlists sublists of datatype type from
+ *  a flat value buffer and nlists+1 offsets (Arrow list layout).  The
+ *  values are copied; offsets need not start at zero.
+ *
+ ***********************************************************************/
+
+DYN_LIST *dfuCreatePackedDynList(char *name, int datatype, int nlists,
+				 int *offsets, void *vals)
+{
+  DYN_LIST *dynlist;
+  DYN_PACK *pack;
+  int i, nvals, size = dfuDynListElementSize(datatype);
+
+  if (nlists <= 0 || !offsets || datatype == DF_STRING || 
+      datatype == DF_LIST || !size) return NULL;
+
+  nvals = offsets[nlists] - offsets[0];
+  if (nvals < 0) return NULL;
+
+  dynlist = dfuCreateNamedDynList(name, DF_LIST, nlists);
+  if (!dynlist) return NULL;
+
+  if (!(pack = dfuNewDynPack(datatype, nlists, nvals))) {
+    dfuFreeDynList(dynlist);
+    return NULL;
+  }
+  for (i = 0; i <= nlists; i++) pack->offsets[i] = offsets[i] - offsets[0];
+  if (nvals) memcpy(pack->vals, (char *) vals + (size_t) size*offsets[0],
+		    (size_t) size*nvals);
+
+  dfuAttachDynPack(dynlist, pack);
+  return dynlist;
+}
+
+/***********************************************************************
+ *
+ * dfuGetDynListPack(DYN_LIST *)
+ *
+ *    Return the DYN_PACK backing dynlist if every sublist is still an
+ *  unmodified view into it (in order), otherwise NULL.
+ *
+ ***********************************************************************/
+
+DYN_PACK *dfuGetDynListPack(DYN_LIST *dynlist)
+{
+  int i, size;
+  DYN_PACK *pack;
+  DYN_LIST **vals;
+
+  if (!dynlist || !(DYN_LIST_FLAGS(dynlist) & DL_PACKED)) return NULL;
+  if (!(pack = DYN_LIST_PACK(dynlist))) return NULL;
+  if (DYN_LIST_N(dynlist) != pack->nlists) return NULL;
+
+  size = dfuDynListElementSize(pack->datatype);
+  vals = (DYN_LIST **) DYN_LIST_VALS(dynlist);
+  for (i = 0; i < pack->nlists; i++) {
+    if (vals[i] != &pack->headers[i] ||
+	!(DYN_LIST_FLAGS(vals[i]) & DL_VIEW) ||
+	DYN_LIST_DATATYPE(vals[i]) != pack->datatype ||
+	DYN_LIST_N(vals[i]) != pack->offsets[i+1] - pack->offsets[i] ||
+	DYN_LIST_VALS(vals[i]) !=
+	(char *) pack->vals + (size_t) size*pack->offsets[i])
+      return NULL;
+  }
+  return pack;
+}
+
+/***********************************************************************
+ *
+ * dfuPackDynList(DYN_LIST *)
+ *
+ *    Convert a DF_LIST whose sublists share a numeric datatype into
+ *  packed storage in place.  Returns 1 if the list is packed, 0 if it
+ *  cannot be (empty, mixed types, strings or deeper nesting).
+ *
+ ***********************************************************************/
+
+int dfuPackDynList(DYN_LIST *dynlist)
+{
+  int i, n, datatype, size;
+  DL_SIZE nvals = 0;
+  DYN_LIST **vals;
+  DYN_PACK *pack;
+
+  if (!dynlist || DYN_LIST_DATATYPE(dynlist) != DF_LIST) return 0;
+  if (dfuGetDynListPack(dynlist)) return 1;
+
+  n = DYN_LIST_N(dynlist);
+  if (!n) return 0;
+  vals = (DYN_LIST **) DYN_LIST_VALS(dynlist);
+
+  datatype = DYN_LIST_DATATYPE(vals[0]);
+  if (datatype == DF_STRING || datatype == DF_LIST) return 0;
+  for (i = 0; i < n; i++) {
+    if (DYN_LIST_DATATYPE(vals[i]) != datatype) return 0;
+    nvals += DYN_LIST_N(vals[i]);
+  }
+  /* pack offsets are ints; larger lists stay unpacked */
+  if (n > INT_MAX - 1 || nvals > INT_MAX) return 0;
+  size = dfuDynListElementSize(datatype);
+
+  if (!(pack = dfuNewDynPack(datatype, n, nvals))) return 0;
+
+  pack->offsets[0] = 0;
+  for (i = 0; i < n; i++) {
+    pack->offsets[i+1] = pack->offsets[i] + DYN_LIST_N(vals[i]);
+    memcpy((char *) pack->vals + (size_t) size*pack->offsets[i],
+	   DYN_LIST_VALS(vals[i]), (size_t) size*DYN_LIST_N(vals[i]));
+    strncpy(DYN_LIST_NAME(&pack->headers[i]), DYN_LIST_NAME(vals[i]),
+	    DYN_LIST_NAME_SIZE-1);
+    DYN_LIST_INCREMENT(&pack->headers[i]) = DYN_LIST_INCREMENT(vals[i]);
+    dfuFreeDynList(vals[i]);
+  }
+
+  /* drop any stale pack left over from earlier modification */
+  if (DYN_LIST_PACK(dynlist)) dfuReleaseDynPack(DYN_LIST_PACK(dynlist));
+  DYN_LIST_PACK(dynlist) = NULL;
+
+  dfuAttachDynPack(dynlist, pack);
+  return 1;
+}
+
+/***********************************************************************
+ *
+ * dfuUnpackDynList(DYN_LIST *)
+ *
+ *    Replace every view sublist of a packed DF_LIST by an ordinary
+ *  list with its own storage.
+ *
+ ***********************************************************************/
+
+int dfuUnpackDynList(DYN_LIST *dynlist)
+{
+  int i;
+  DYN_LIST **vals, *copy;
+
+  if (!dynlist || DYN_LIST_DATATYPE(dynlist) != DF_LIST) return 0;
+  if (!(DYN_LIST_FLAGS(dynlist) & DL_PACKED)) return 1;
+
+  vals = (DYN_LIST **) DYN_LIST_VALS(dynlist);
+  for (i = 0; i < DYN_LIST_N(dynlist); i++) {
+    if (DYN_LIST_PACK(vals[i])) {
+      if (!(copy = dfuCopyDynList(vals[i]))) return 0;
+      dfuFreeDynList(vals[i]);
+      vals[i] = copy;
+    }
+  }
+  dfuReleaseDynPack(DYN_LIST_PACK(dynlist));
+  DYN_LIST_PACK(dynlist) = NULL;
+  DYN_LIST_FLAGS(dynlist) &= ~DL_PACKED;
+  return 1;
+}
+
+/***********************************************************************
+ *
+ * DYN_ARENA functions
+ *
+ *    Chunks are carved front to back with 8 byte alignment; requests
+ *  larger than a chunk get a chunk of their own.  Nothing is returned
+ *  to the arena until the last reference is released.
+ *
+ ***********************************************************************/
+
+typedef struct _dyn_arena_chunk {
+  struct _dyn_arena_chunk *next;
+  DL_SIZE size;
+  DL_SIZE used;
+  double data[1];		/* start of storage (aligned) */
+} DYN_ARENA_CHUNK;
+
+#define DYN_ARENA_DEFAULT_CHUNK (1024*1024)
+
+DYN_ARENA *dfuCreateDynArena(int chunksize)
+{
+  DYN_ARENA *arena = (DYN_ARENA *) calloc(1, sizeof(DYN_ARENA));
+  if (!arena) return NULL;
+  arena->chunksize = chunksize > 0 ? chunksize : DYN_ARENA_DEFAULT_CHUNK;
+  arena->refcount = 1;
+  return arena;
+}
+
+void *dfuArenaAlloc(DYN_ARENA *arena, DL_SIZE size)
+{
+  DYN_ARENA_CHUNK *chunk;
+  void *p;
+
+  if (!arena || size < 0) return NULL;
+  size = (size + 7) & ~7;
+  if (!size) size = 8;
+
+  chunk = arena->chunks;
+  if (!chunk || chunk->size - chunk->used < size) {
+    DL_SIZE csize = size > arena->chunksize ? size : arena->chunksize;
+    chunk = (DYN_ARENA_CHUNK *) malloc(sizeof(DYN_ARENA_CHUNK) + csize);
+    if (!chunk) {
+      fprintf(stderr,"dlsh/dlwish: out of memory\n");
+      return NULL;
+    }
+    chunk->size = csize;
+    chunk->used = 0;
+    
+    /* an oversized chunk is full as soon as it is carved, so keep
+       filling the current one by linking the new chunk behind it */
+    if (arena->chunks && csize == size) {
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+    }
+    else {
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
+  }
+
+  p = (char *) chunk->data + chunk->used;
+  chunk->used += size;
+  return p;
+}
+
+void dfuReleaseDynArena(DYN_ARENA *arena)
+{
+  DYN_ARENA_CHUNK *chunk, *next;
+  if (!arena || --arena->refcount > 0) return;
+  for (chunk = arena->chunks; chunk; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+  free(arena);
+}
+
+/***********************************************************************
+ *
+ * dfuArenaNewDynList(DYN_ARENA *)
+ *
+ *    Allocate an empty, zeroed list header from arena.  The caller
+ *  fills in datatype and vals; vals carved from the arena must be
+ *  flagged DL_VIEW.
+ *
+ ***********************************************************************/
+
+DYN_LIST *dfuArenaNewDynList(DYN_ARENA *arena)
+{
+  DYN_LIST *dl = (DYN_LIST *) dfuArenaAlloc(arena, sizeof(DYN_LIST));
+  if (!dl) return NULL;
+  memset(dl, 0, sizeof(DYN_LIST));
+  DYN_LIST_ARENA(dl) = arena;
+  arena->refcount++;
+  return dl;
+}
+
+/***********************************************************************
+ *
+ * dfuEnableDynGroupArena(DYN_GROUP *)
+ *
+ *    Give a group its own arena (if it does not have one already) for
+ *  lists that are read into it.
+ *
+ ***********************************************************************/
+
+DYN_ARENA *dfuEnableDynGroupArena(DYN_GROUP *dg)
+{
+  if (!dg) return NULL;
+  if (!DYN_GROUP_ARENA(dg))
+    DYN_GROUP_ARENA(dg) = dfuCreateDynArena(0);
+  return DYN_GROUP_ARENA(dg);
+}
+
+/***********************************************************************
+ *
+ * dfuShareDynListVals(DYN_LIST *)
+ *
+ *    Return the DYN_SHARE holding dl's values, turning dl's own (or
+ *  arena) storage into one if needed, or NULL if its values cannot be
+ *  shared (empty, strings, sublists or views into a pack).  Sharing
+ *  lists have max == n, so any append goes through the copy in
+ *  dfuResizeDynListVals.
+ *
+ ***********************************************************************/
+
+static DYN_SHARE *dfuShareDynListVals(DYN_LIST *dl)
+{
+  DYN_SHARE *share;
+
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG:
+  case DF_SHORT:
+  case DF_FLOAT:
+  case DF_CHAR:
+    break;
+  default:
+    return NULL;
+  }
+  if (!DYN_LIST_N(dl) || !DYN_LIST_VALS(dl)) return NULL;
+  if (DYN_LIST_FLAGS(dl) & DL_SHARED) return DYN_LIST_SHARE(dl);
+
+  /* pack views belong to their parent; other views must be arena vals */
+  if (DYN_LIST_PACK(dl)) return NULL;
+  if ((DYN_LIST_FLAGS(dl) & DL_VIEW) && !DYN_LIST_ARENA(dl)) return NULL;
+
+  share = (DYN_SHARE *) calloc(1, sizeof(DYN_SHARE));
+  if (!share) return NULL;
+  share->refcount = 1;
+  share->vals = DYN_LIST_VALS(dl);
+  if (DYN_LIST_FLAGS(dl) & DL_VIEW) {
+    share->arena = DYN_LIST_ARENA(dl);
+    share->arena->refcount++;
+  }
+
+  DYN_LIST_FLAGS(dl) |= DL_VIEW | DL_SHARED;
+  DYN_LIST_SHARE(dl) = share;
+  DYN_LIST_MAX(dl) = DYN_LIST_N(dl);
+  return share;
+}
+
+static void dfuReleaseDynShare(DYN_SHARE *share)
+{
+  if (!share || --share->refcount > 0) return;
+  if (share->arena) dfuReleaseDynArena(share->arena);
+  else free(share->vals);
+  free(share);
+}
+
+/***********************************************************************
+ *
+ * dfuUnshareDynList(DYN_LIST *)
+ *
+ *    Give a list private, writable values before it is modified in
+ *  place (dictionary encoded lists are decoded).  Appending and inserting do this themselves; code that
+ *  stores into DYN_LIST_VALS directly must call it first.  Returns 1
+ *  on success, 0 if out of memory.
+ *
+ ***********************************************************************/
+
+int dfuUnshareDynList(DYN_LIST *dynlist)
+{
+  DYN_SHARE *share;
+  void *vals;
+  int size;
+
+  if (!dynlist) return 0;
+  if ((DYN_LIST_FLAGS(dynlist) & DL_DICT) && !dfuDictDecodeDynList(dynlist))
+    return 0;
+  if (!(DYN_LIST_FLAGS(dynlist) & DL_SHARED)) return 1;
+
+  share = DYN_LIST_SHARE(dynlist);
+  if (share->refcount == 1 && !share->arena) {
+    free(share);
+  }
+  else {
+    size = dfuDynListElementSize(DYN_LIST_DATATYPE(dynlist));
+    vals = malloc((size_t) size * (DYN_LIST_N(dynlist) ?
+				   DYN_LIST_N(dynlist) : 1));
+    if (!vals) return 0;
+    memcpy(vals, DYN_LIST_VALS(dynlist), (size_t) size*DYN_LIST_N(dynlist));
+    dfuReleaseDynShare(share);
+    DYN_LIST_VALS(dynlist) = vals;
+  }
+  DYN_LIST_SHARE(dynlist) = NULL;
+  DYN_LIST_FLAGS(dynlist) &= ~(DL_VIEW | DL_SHARED);
+  return 1;
+}
+
+/***********************************************************************
+ *
+ * dfuIsSharedDynList(DYN_LIST *)
+ *
+ *    Return 1 if dynlist currently shares its values with another list.
+ *
+ ***********************************************************************/
+
+int dfuIsSharedDynList(DYN_LIST *dynlist)
+{
+  return (dynlist && (DYN_LIST_FLAGS(dynlist) & DL_SHARED) &&
+	  DYN_LIST_SHARE(dynlist)->refcount > 1);
+}
+
+/***********************************************************************
+ *
+ * dfuCreateDynDict(int nstrings, char **strings)
+ *
+ *    Make a string table for dictionary encoded lists, taking over
+ *  strings (and the malloc'd strings it points to).  The strings must
+ *  be distinct and in strcmp() order so that codes sort like the
+ *  strings they stand for; NULL is returned (and nothing taken over)
+ *  otherwise.  The table starts with no references.
+ *
+ ***********************************************************************/
+
+DYN_DICT *dfuCreateDynDict(int nstrings, char **strings)
+{
+  DYN_DICT *dict;
+  int i;
+
+  if (nstrings < 0 || (nstrings && !strings)) return NULL;
+  for (i = 1; i < nstrings; i++)
+    if (strcmp(strings[i-1], strings[i]) >= 0) return NULL;
+
+  dict = (DYN_DICT *) calloc(1, sizeof(DYN_DICT));
+  if (!dict) return NULL;
+  dict->nstrings = nstrings;
+  dict->strings = strings;
+  return dict;
+}
+
+void dfuReleaseDynDict(DYN_DICT *dict)
+{
+  int i;
+  if (!dict || --dict->refcount > 0) return;
+  for (i = 0; i < dict->nstrings; i++) free(dict->strings[i]);
+  if (dict->strings) free(dict->strings);
+  free(dict);
+}
+
+DYN_DICT *dfuGetDynListDict(DYN_LIST *dynlist)
+{
+  if (!dynlist || !(DYN_LIST_FLAGS(dynlist) & DL_DICT)) return NULL;
+  return DYN_LIST_DICT(dynlist);
+}
+
+/***********************************************************************
+ *
+ * dfuSetDynListDict(DYN_LIST *, DYN_DICT *, DL_SIZE n, int *codes)
+ *
+ *    Fill an empty list with n dictionary encoded strings.  The codes
+ *  are copied and checked against the table, which gains a reference.
+ *  Returns 1 on success, 0 on failure (the list is left unchanged).
+ *
+ ***********************************************************************/
+
+int dfuSetDynListDict(DYN_LIST *dynlist, DYN_DICT *dict, DL_SIZE n,
+		      int *codes)
+{
+  DL_SIZE i;
+  char **vals;
+  int *newcodes;
+
+  if (!dynlist || !dict || n < 0 || (n && !codes)) return 0;
+  if (DYN_LIST_N(dynlist) ||
+      (DYN_LIST_FLAGS(dynlist) & (DL_STORAGE_FLAGS & ~DL_VIEW))) return 0;
+  for (i = 0; i < n; i++)
+    if (codes[i] < 0 || codes[i] >= dict->nstrings) return 0;
+
+  vals = (char **) malloc((n ? n : 1)*sizeof(char *));
+  newcodes = (int *) malloc((n ? n : 1)*sizeof(int));
+  if (!vals || !newcodes) {
+    if (vals) free(vals);
+    if (newcodes) free(newcodes);
+    return 0;
+  }
+  for (i = 0; i < n; i++) {
+    newcodes[i] = codes[i];
+    vals[i] = dict->strings[codes[i]];
+  }
+
+  /* arena headers may hold (unowned) arena vals */
+  if (DYN_LIST_VALS(dynlist) && !(DYN_LIST_FLAGS(dynlist) & DL_VIEW))
+    free(DYN_LIST_VALS(dynlist));
+
+  dict->refcount++;
+  DYN_LIST_DATATYPE(dynlist) = DF_STRING;
+  DYN_LIST_FLAGS(dynlist) &= ~DL_VIEW;
+  DYN_LIST_FLAGS(dynlist) |= DL_DICT;
+  DYN_LIST_DICT(dynlist) = dict;
+  DYN_LIST_CODES(dynlist) = newcodes;
+  DYN_LIST_VALS(dynlist) = vals;
+  DYN_LIST_N(dynlist) = n;
+  DYN_LIST_MAX(dynlist) = n;
+  return 1;
+}
+
+DYN_LIST *dfuCreateDictDynList(char *name, DYN_DICT *dict, DL_SIZE n,
+			       int *codes)
+{
+  DYN_LIST *dynlist = dfuCreateNamedDynList(name, DF_STRING, n ? n : 1);
+  if (!dynlist) return NULL;
+  if (!dfuSetDynListDict(dynlist, dict, n, codes)) {
+    dfuFreeDynList(dynlist);
+    return NULL;
+  }
+  return dynlist;
+}
+
+/***********************************************************************
+ *
+ * dfuDictEncodeDynList(DYN_LIST *)
+ *
+ *    Convert a string list in place to a dictionary encoded list: each
+ *  distinct string is kept once in a sorted table and the list holds
+ *  its code.  Returns 1 on success (or if already encoded), 0 if the
+ *  list is not a string list or memory runs out.
+ *
+ ***********************************************************************/
+
+typedef struct {
+  char *string;
+  int code;
+} DICT_ENTRY;
+
+static int dict_entry_compare(const void *a, const void *b)
+{
+  return strcmp(((DICT_ENTRY *) a)->string, ((DICT_ENTRY *) b)->string);
+}
+
+static unsigned int dict_hash(const char *s)
+{
+  unsigned int h = 2166136261u;	/* FNV-1a */
+  while (*s) {
+    h ^= (unsigned char) *s++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+int dfuDictEncodeDynList(DYN_LIST *dynlist)
+{
+  DL_SIZE i, n;
+  int nstrings = 0, *codes = NULL, *slots = NULL, *remap = NULL;
+  unsigned int h, mask, nslots;
+  char **vals, **strings = NULL;
+  DICT_ENTRY *entries = NULL;
+  DYN_DICT *dict;
+
+  if (!dynlist || DYN_LIST_DATATYPE(dynlist) != DF_STRING) return 0;
+  if (DYN_LIST_FLAGS(dynlist) & DL_DICT) return 1;
+  if (DYN_LIST_FLAGS(dynlist) & DL_STORAGE_FLAGS) return 0;
+
+  n = DYN_LIST_N(dynlist);
+  if (n > INT_MAX / 2) return 0;
+  vals = (char **) DYN_LIST_VALS(dynlist);
+
+  for (nslots = 16; nslots < 2*n; nslots <<= 1);
+  mask = nslots-1;
+
+  codes = (int *) malloc((n ? n : 1)*sizeof(int));
+  entries = (DICT_ENTRY *) malloc((n ? n : 1)*sizeof(DICT_ENTRY));
+  slots = (int *) calloc(nslots, sizeof(int));
+  if (!codes || !entries || !slots) goto nomem;
+
+  /* slots hold 1 + the index of the first occurrence's entry */
+  for (i = 0; i < n; i++) {
+    for (h = dict_hash(vals[i]) & mask; slots[h]; h = (h+1) & mask)
+      if (!strcmp(entries[slots[h]-1].string, vals[i])) break;
+    if (!slots[h]) {
+      entries[nstrings].string = vals[i];
+      entries[nstrings].code = nstrings;
+      slots[h] = ++nstrings;
+    }
+    codes[i] = slots[h]-1;
+  }
+  free(slots);
+  slots = NULL;
+
+  /* renumber codes in sorted string order */
+  qsort(entries, nstrings, sizeof(DICT_ENTRY), dict_entry_compare);
+  remap = (int *) malloc((nstrings ? nstrings : 1)*sizeof(int));
+  strings = (char **) malloc((nstrings ? nstrings : 1)*sizeof(char *));
+  if (!remap || !strings) goto nomem;
+  for (i = 0; i < nstrings; i++) {
+    remap[entries[i].code] = i;
+    strings[i] = entries[i].string;
+  }
+  free(entries);
+  entries = NULL;
+
+  dict = dfuCreateDynDict(nstrings, strings);
+  if (!dict) goto nomem;
+
+  /* the first occurrence of each string moved into the table */
+  for (i = 0; i < n; i++) {
+    codes[i] = remap[codes[i]];
+    if (vals[i] != strings[codes[i]]) free(vals[i]);
+    vals[i] = strings[codes[i]];
+  }
+  free(remap);
+
+  dict->refcount++;
+  DYN_LIST_FLAGS(dynlist) |= DL_DICT;
+  DYN_LIST_DICT(dynlist) = dict;
+  DYN_LIST_CODES(dynlist) = codes;
+  DYN_LIST_MAX(dynlist) = n;
+  return 1;
+
+ nomem:
+  if (codes) free(codes);
+  if (entries) free(entries);
+  if (slots) free(slots);
+  if (remap) free(remap);
+  if (strings) free(strings);
+  return 0;
+}
+
+/***********************************************************************
+ *
+ * dfuDictDecodeDynList(DYN_LIST *)
+ *
+ *    Give a dictionary encoded list its own copy of each string again.
+ *  Returns 1 on success (or if not encoded), 0 if out of memory, in
+ *  which case the list is still encoded.
+ *
+ ***********************************************************************/
+
+int dfuDictDecodeDynList(DYN_LIST *dynlist)
+{
+  DL_SIZE i, n;
+  char **vals, **copies, *s;
+
+  if (!dynlist) return 0;
+  if (!(DYN_LIST_FLAGS(dynlist) & DL_DICT)) return 1;
+
+  n = DYN_LIST_N(dynlist);
+  vals = (char **) DYN_LIST_VALS(dynlist);
+  copies = (char **) malloc((n ? n : 1)*sizeof(char *));
+  if (!copies) return 0;
+  for (i = 0; i < n; i++) {
+    s = vals[i];
+    if (!(copies[i] = malloc(strlen(s)+1))) {
+      while (i--) free(copies[i]);
+      free(copies);
+      return 0;
+    }
+    strcpy(copies[i], s);
+  }
+  if (n) memcpy(vals, copies, n*sizeof(char *));
+  free(copies);
+
+  free(DYN_LIST_CODES(dynlist));
+  dfuReleaseDynDict(DYN_LIST_DICT(dynlist));
+  DYN_LIST_CODES(dynlist) = NULL;
+  DYN_LIST_DICT(dynlist) = NULL;
+  DYN_LIST_FLAGS(dynlist) &= ~DL_DICT;
+  return 1;
+}
+
 /***********************************************************************
  *
  * dfuSetObsPeriods(DATA_FILE *, DYN_OLIST *)
@@ -4036,6 +4980,7 @@ void dfuFreeDynGroup(DYN_GROUP *dyngroup)
       dfuFreeDynList(DYN_GROUP_LIST(dyngroup,i));
   
   if (DYN_GROUP_NLISTS(dyngroup)) free(DYN_GROUP_LISTS(dyngroup));
+  if (DYN_GROUP_ARENA(dyngroup)) dfuReleaseDynArena(DYN_GROUP_ARENA(dyngroup));
   free(dyngroup);
 }
 
@@ -4057,8 +5002,10 @@ void dfuFreeDynList(DYN_LIST *dynlist)
   /* Should never get this message */
   if (!DYN_LIST_MAX(dynlist)) {
     fprintf(stderr, "dfuFreeDynList: received list with no allocated space\n");
-    fprintf(stderr, "DYN_LIST_N(dynlist) = %d\n", DYN_LIST_N(dynlist));
-    fprintf(stderr, "DYN_LIST_INC(dynlist) = %d\n", DYN_LIST_INCREMENT(dynlist));
+    fprintf(stderr, "DYN_LIST_N(dynlist) = %lld\n",
+	    (long long) DYN_LIST_N(dynlist));
+    fprintf(stderr, "DYN_LIST_INC(dynlist) = %lld\n",
+	    (long long) DYN_LIST_INCREMENT(dynlist));
     fprintf(stderr, "DYN_LIST_VALS(dynlist) = %x\n", DYN_LIST_VALS(dynlist));
     return;
   }
@@ -4073,16 +5020,42 @@ void dfuFreeDynList(DYN_LIST *dynlist)
     }
   }
 
-  /* free any allocated strings */
+  /* free any allocated strings (dictionary strings belong to the dict) */
 
-  else if (DYN_LIST_DATATYPE(dynlist) == DF_STRING) {
+  else if (DYN_LIST_DATATYPE(dynlist) == DF_STRING &&
+	   !(DYN_LIST_FLAGS(dynlist) & DL_DICT)) {
     char **vals = DYN_LIST_VALS(dynlist);
     for (i = 0; i < DYN_LIST_N(dynlist); i++) {
       if (vals[i]) free(vals[i]);
     }
   }
 
-  if (DYN_LIST_VALS(dynlist)) free(DYN_LIST_VALS(dynlist));
+  if (DYN_LIST_FLAGS(dynlist) & DL_DICT) {
+    free(DYN_LIST_CODES(dynlist));
+    dfuReleaseDynDict(DYN_LIST_DICT(dynlist));
+    DYN_LIST_CODES(dynlist) = NULL;
+    DYN_LIST_DICT(dynlist) = NULL;
+    DYN_LIST_FLAGS(dynlist) &= ~DL_DICT;
+  }
+
+  if (DYN_LIST_VALS(dynlist) && !(DYN_LIST_FLAGS(dynlist) & DL_VIEW))
+    free(DYN_LIST_VALS(dynlist));
+
+  if (DYN_LIST_SHARE(dynlist)) dfuReleaseDynShare(DYN_LIST_SHARE(dynlist));
+
+  /* view headers live inside their pack and go away with it */
+  if (DYN_LIST_PACK(dynlist)) {
+    DYN_PACK *pack = DYN_LIST_PACK(dynlist);
+    int inpack = dfuIsDynPackHeader(pack, dynlist);
+    dfuReleaseDynPack(pack);
+    if (inpack) return;
+  }
+
+  /* as do headers carved from an arena */
+  if (DYN_LIST_ARENA(dynlist)) {
+    dfuReleaseDynArena(DYN_LIST_ARENA(dynlist));
+    return;
+  }
   free(dynlist);
 }
 
@@ -369,39 +369,32 @@ static DYN_LIST *add_dpoint_to_list(DYN_LIST *dl, ds_datapoint_t *dpoint)
   case DSERV_BYTE:
     if (!dl) dl = dfuCreateDynList(DF_CHAR, dpoint->data.len);
     if (!dl) return NULL;
-    for (i = 0; i < dpoint->data.len; i++) {
-      dfuAddDynListChar(dl, ((unsigned char *) dpoint->data.buf)[i]);
-    }
+    dfuAppendDynListN(dl, dpoint->data.buf, dpoint->data.len);
     break;
   case DSERV_FLOAT:
     n = dpoint->data.len/sizeof(float);
     if (!dl) dl = dfuCreateDynList(DF_FLOAT, n);
     if (!dl) return NULL;
-    for (i = 0; i < n; i++) {
-      dfuAddDynListFloat(dl, ((float *) dpoint->data.buf)[i]);
-    }
+    dfuAppendDynListN(dl, dpoint->data.buf, n);
     break;
   case DSERV_SHORT:
     n = dpoint->data.len/sizeof(short);
     if (!dl) dl = dfuCreateDynList(DF_SHORT, n);
     if (!dl) return NULL;
-    for (i = 0; i < n; i++) {
-      dfuAddDynListShort(dl, ((short *) dpoint->data.buf)[i]);
-    }
+    dfuAppendDynListN(dl, dpoint->data.buf, n);
     break;
   case DSERV_INT:
     n = dpoint->data.len/sizeof(int);
     if (!dl) dl = dfuCreateDynList(DF_LONG, n);
     if (!dl) return NULL;
-    for (i = 0; i < n; i++) {
-      dfuAddDynListLong(dl, ((int *) dpoint->data.buf)[i]);
-    }
+    dfuAppendDynListN(dl, dpoint->data.buf, n);
     break;
   case DSERV_DOUBLE:
     n = dpoint->data.len/sizeof(double);
     if (!dl) dl = dfuCreateDynList(DF_FLOAT, n);
     if (!dl) return NULL;
     d = (double *) dpoint->data.buf;
+    dfuReserveDynList(dl, DYN_LIST_N(dl) + n);
     for (i = 0; i < n; i++) {
       dfuAddDynListFloat(dl, (float) d[i]);
     }
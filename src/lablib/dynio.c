@@ -18,39 +18,42 @@
 #endif
 #include <zlib.h>
 
-extern size_t compress_buffer_to_lz4_file(unsigned char *, int, FILE *);
-extern int decompress_lz4_file_to_buffer(FILE *, int *, unsigned char **);
+extern size_t compress_buffer_to_lz4_file(unsigned char *, size_t, FILE *);
+extern int decompress_lz4_file_to_buffer(FILE *, size_t *, unsigned char **);
 
 
-static int dgFlipEvents = 0;	/* to make up for byte ordering probs */
 char dgMagicNumber[] = { 0x21, 0x12, 0x36, 0x63 };
 float dgVersion = 1.0;
 
+/*
+ * Files holding a list with more than INT_MAX elements carry this
+ * version instead.  Such counts are written as -1, preceded by a
+ * DL_NVALS64_TAG holding the real count, so readers that only know
+ * dgVersion refuse the file rather than misreading it.  Dictionary
+ * encoded string lists (DL_DICT_STRINGS_TAG + DL_DICT_CODES_TAG) are
+ * likewise only found in files of this version.
+ */
+float dgLargeVersion = 2.0;
+
 #define DG_DATA_BUFFER_SIZE 64000
+#define DG_STRUCT_STACK_INCREMENT 10
 
-static void dgDumpBuffer(unsigned char *buffer, int n, int type, FILE *fp);
-static unsigned char *DgBuffer = NULL;
-static int DgBufferIndex = 0;
-static int DgBufferSize;
-static int DgRecording = 0;
-static int DgBufferIncrement = DG_DATA_BUFFER_SIZE;
+static void dgDumpBuffer(unsigned char *buffer, DL_SIZE n, int type, FILE *fp);
 
-/* Keep track of which structure we're in using a stack */
-static int DgCurStruct = DG_TOP_LEVEL;
-static char *DgCurStructName = "DG_TOP_LEVEL";
-static TAG_INFO *DgStructStack = NULL;
-static int DgStructStackIncrement = 10;
-static int DgStructStackSize = 0;
-static int DgStructStackIndex = -1;
+static void send_event(DG_IO_CTX *ctx, unsigned char type, unsigned char *data);
+static void send_count(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n);
+static void send_bytes(DG_IO_CTX *ctx, DL_SIZE n, unsigned char *data);
+static void push(DG_IO_CTX *ctx, unsigned char *data, int, DL_SIZE);
+static void dg_stamp_large_version(DG_IO_CTX *ctx);
 
-static void send_event(unsigned char type, unsigned char *data);
-static void send_bytes(int n, unsigned char *data);
-static void push(unsigned char *data, int, int);
+static int dguBufferToDynGroup(DG_IO_CTX *ctx, BUF_DATA *bdata, DYN_GROUP *dg);
+static int dguBufferToDynList(DG_IO_CTX *ctx, BUF_DATA *bdata, DYN_LIST *dl);
 
-static int dguBufferToDynGroup(BUF_DATA *bdata, DYN_GROUP *dg);
-static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl);
+static DYN_LIST *dguNewDynList(DG_IO_CTX *ctx);
+static void *dguAllocVals(DG_IO_CTX *ctx, DL_SIZE n, int size);
 
-int dguBufferToStruct(unsigned char *vbuf, int bufsize, DYN_GROUP *dg);
+static DL_SIZE dg_array_count(DG_IO_CTX *ctx, int count);
+static int dg_known_version(float version);
 
 /***********************************************************************/
 /*                        Structure Tag Tables                         */
@@ -82,7 +85,10 @@ TAG_INFO DLTags[] = {
   { DL_FLOAT_DATA_TAG,  "FLOAT_DATA",  DF_FLOAT_ARRAY,  DG_TOP_LEVEL },
   { DL_LIST_DATA_TAG,   "LIST_DATA",   DF_LIST_ARRAY,   DG_TOP_LEVEL },
   { DL_SUBLIST_TAG,     "SUBLIST",     DF_STRUCTURE,    DYN_LIST_STRUCT },
-  { DL_FLAGS_TAG,       "FLAGS",       DF_LONG,         DG_TOP_LEVEL }
+  { DL_FLAGS_TAG,       "FLAGS",       DF_LONG,         DG_TOP_LEVEL },
+  { DL_NVALS64_TAG,     "NVALS64",     DF_SIZE_T,       DG_TOP_LEVEL },
+  { DL_DICT_STRINGS_TAG,"DICT_STRINGS",DF_STRING_ARRAY, DG_TOP_LEVEL },
+  { DL_DICT_CODES_TAG,  "DICT_CODES",  DF_LONG_ARRAY,   DG_TOP_LEVEL }
 };
 
 TAG_INFO *DGTagTable[] = { DGTopLevelTags, DGTags, DLTags };
@@ -91,51 +97,66 @@ TAG_INFO *DGTagTable[] = { DGTopLevelTags, DGTags, DLTags };
 /*                      Initialization Routines                           */
 /**************************************************************************/
 
-void dgInitBuffer(void)
+DG_IO_CTX *dgCreateIOCtx(void)
+{
+  return (DG_IO_CTX *) calloc(1, sizeof(DG_IO_CTX));
+}
+
+void dgFreeIOCtx(DG_IO_CTX *ctx)
+{
+  if (!ctx) return;
+  dgCloseBufferCtx(ctx);
+  free(ctx);
+}
+
+void dgInitBufferCtx(DG_IO_CTX *ctx)
 {
-  DgBufferSize = DG_DATA_BUFFER_SIZE;
-  if (!(DgBuffer = (unsigned char *)
-	calloc(DgBufferSize, sizeof(unsigned char)))) {
+  if (ctx->buffer) free(ctx->buffer);
+  ctx->size = DG_DATA_BUFFER_SIZE;
+  if (!(ctx->buffer = (unsigned char *)
+	calloc(ctx->size, sizeof(unsigned char)))) {
     fprintf(stderr,"Unable to allocate dg buffer\n");
     return;
   }
   
-  dgResetBuffer();
+  dgResetBufferCtx(ctx);
 }
 
-void dgResetBuffer(void)
+void dgResetBufferCtx(DG_IO_CTX *ctx)
 {
-  DgRecording = 1;
-  DgBufferIndex = 0;
+  ctx->recording = 1;
+  ctx->index = 0;
+  ctx->depth = 0;
   
-  dgPushStruct(DG_TOP_LEVEL, "DG_TOP_LEVEL");
+  dgPushStructCtx(ctx, DG_TOP_LEVEL, "DG_TOP_LEVEL");
   
-  dgRecordMagicNumber();
-  dgRecordFloat(T_VERSION_TAG, dgVersion);
+  dgRecordMagicNumberCtx(ctx);
+  dgRecordFloatCtx(ctx, T_VERSION_TAG, dgVersion);
 }
 
-void dgCloseBuffer(void)
+void dgCloseBufferCtx(DG_IO_CTX *ctx)
 {
-  if (DgBuffer) free(DgBuffer);
-  dgFreeStructStack();
-  DgRecording = 0;
+  if (ctx->buffer) free(ctx->buffer);
+  ctx->buffer = NULL;
+  dgFreeStructStackCtx(ctx);
+  ctx->recording = 0;
 }
 
-unsigned char *dgGetBuffer(void)
+unsigned char *dgGetBufferCtx(DG_IO_CTX *ctx)
 {
-  return DgBuffer;
+  return ctx->buffer;
 }
 
-int dgGetBufferSize(void)
+DL_SIZE dgGetBufferSizeCtx(DG_IO_CTX *ctx)
 {
-  return DgBufferIndex;
+  return ctx->index;
 }
 
 
 /* get estimate of list size (in bytes) */
-static int get_list_length(DYN_LIST *dl)
+static DL_SIZE get_list_length(DYN_LIST *dl)
 {
-  int i, sum = 64;		/* overhead */
+  DL_SIZE i, sum = 64;		/* overhead */
   DYN_LIST **vals;
 
   if (!dl) return sum;
@@ -168,10 +189,10 @@ static int get_list_length(DYN_LIST *dl)
   return sum;
 }
 
-int dgEstimateGroupSize(DYN_GROUP *dg)
+DL_SIZE dgEstimateGroupSize(DYN_GROUP *dg)
 {
   int i;
-  int nelts = 0;
+  DL_SIZE nelts = 0;
   
   for (i = 0; i < DYN_GROUP_NLISTS(dg); i++) {
     nelts += get_list_length(DYN_GROUP_LIST(dg,i));
@@ -179,14 +200,14 @@ int dgEstimateGroupSize(DYN_GROUP *dg)
   return nelts;
 }
 
-int dgSetBufferIncrement(int increment)
+DL_SIZE dgSetBufferIncrementCtx(DG_IO_CTX *ctx, DL_SIZE increment)
 {
-  int old = DgBufferIncrement;
-  if (increment >= 0) DgBufferIncrement = increment;
+  DL_SIZE old = ctx->increment ? ctx->increment : DG_DATA_BUFFER_SIZE;
+  if (increment >= 0) ctx->increment = increment;
   return old;
 }
 
-int dgWriteBuffer(char *filename, char format)
+int dgWriteBufferCtx(DG_IO_CTX *ctx, char *filename, char format)
 {
    FILE *fp = stdout;
    char *filemode = "wb+";
@@ -208,24 +229,26 @@ int dgWriteBuffer(char *filename, char format)
    }
 
    if (format == DF_LZ4) {
-     int bytes_written;
-     bytes_written = compress_buffer_to_lz4_file(DgBuffer, DgBufferIndex, fp);
+     size_t bytes_written;
+     bytes_written = compress_buffer_to_lz4_file(ctx->buffer, ctx->index, fp);
      if (!bytes_written) {
        fclose(fp);
        return 0;
      }
    }
    else {
-     dgDumpBuffer(DgBuffer, DgBufferIndex, format, fp);
+     dgDumpBuffer(ctx->buffer, ctx->index, format, fp);
    }
 
    if (filename && filename[0]) fclose(fp);
    return 1;
 }
 
-int dgWriteBufferCompressed(char *filename)
+int dgWriteBufferCompressedCtx(DG_IO_CTX *ctx, char *filename)
 {
   gzFile file;
+  DL_SIZE offset;
+  unsigned int chunk;
   
   if (filename && filename[0]) {
     if (!(file = gzopen(filename, "wb"))) {
@@ -236,8 +259,14 @@ int dgWriteBufferCompressed(char *filename)
     file = gzdopen(fileno(stdout), "wb");
   }
   
-  if (gzwrite(file, DgBuffer, DgBufferIndex) != DgBufferIndex) {
-    return 0;
+  /* gzwrite takes an unsigned int length, so write large buffers in
+     pieces */
+  for (offset = 0; offset < ctx->index; offset += chunk) {
+    chunk = (ctx->index - offset > (1 << 30)) ?
+      (1 << 30) : (unsigned int) (ctx->index - offset);
+    if (gzwrite(file, ctx->buffer + offset, chunk) != (int) chunk) {
+      return 0;
+    }
   }
   
   if (filename && filename[0]) {
@@ -248,14 +277,14 @@ int dgWriteBufferCompressed(char *filename)
   return 1;
 }
 
-int dgReadDynGroup(char *filename, DYN_GROUP *dg)
+int dgReadDynGroupCtx(DG_IO_CTX *ctx, char *filename, DYN_GROUP *dg)
 {
   FILE *fp = stdin;
   char *filemode = "rb";
   int status = 0;
   char *suffix;
   unsigned char *data;
-  int size;
+  size_t size;
   
   if (filename && filename[0]) {
     if (!(fp = fopen(filename, filemode))) {
@@ -269,7 +298,7 @@ int dgReadDynGroup(char *filename, DYN_GROUP *dg)
 	  (suffix[1] == 'L' && suffix[2] == 'Z' && suffix[3] == '4')) {
 	if (decompress_lz4_file_to_buffer(fp, &size, &data)) {
 	  fclose(fp);
-	  status = dguBufferToStruct(data, size, dg);
+	  status = dguBufferToStructCtx(ctx, data, size, dg);
 	  free(data);
 	  return status;
 	}
@@ -281,7 +310,7 @@ int dgReadDynGroup(char *filename, DYN_GROUP *dg)
     }
   }
 
-  status = dguFileToStruct(fp, dg);
+  status = dguFileToStructCtx(ctx, fp, dg);
 
   if (filename && filename[0]) fclose(fp);
   return(status);
@@ -300,7 +329,7 @@ int dgReadDynGroup(char *filename, DYN_GROUP *dg)
  * Returns DF_OK (1) on success, 0 on any failure (open / decompress / parse),
  * matching the failure convention of dgReadDynGroup().
  */
-int dguGzipFileToStruct(char *filename, DYN_GROUP *dg)
+int dguGzipFileToStructCtx(DG_IO_CTX *ctx, char *filename, DYN_GROUP *dg)
 {
   gzFile in;
   unsigned char *buf = NULL;
@@ -314,10 +343,9 @@ int dguGzipFileToStruct(char *filename, DYN_GROUP *dg)
   for (;;) {
     int len;
 
-    /* dguBufferToStruct takes an int length; refuse anything that would
-       not fit (also keeps the size_t arithmetic below well clear of
-       overflow on the platforms we build). */
-    if (total > (size_t) INT_MAX - CHUNK - 1) {
+    /* keep the size_t arithmetic below well clear of overflow (only
+       reachable where size_t is 32 bits) */
+    if (total > ((size_t) -1) / 2 - CHUNK - 1) {
       fprintf(stderr, "dg: \"%s\" too large to decompress in memory\n",
 	      filename);
       free(buf); gzclose(in); return 0;
@@ -351,7 +379,7 @@ int dguGzipFileToStruct(char *filename, DYN_GROUP *dg)
 
   /* 2nd arg is the total decompressed byte count (the EOF bound the parser
      uses) -- exactly as the LZ4 path passes its `size` above. */
-  status = dguBufferToStruct(buf, (int) total, dg);
+  status = dguBufferToStructCtx(ctx, buf, (DL_SIZE) total, dg);
   free(buf);					/* parser copied everything out */
   return status;
 }
@@ -370,9 +398,9 @@ int dgReadDynGroupCompressed(char *filename, DYN_GROUP *dg)
 
 
 
-void dgLoadStructure(DYN_GROUP *dg)
+void dgLoadStructureCtx(DG_IO_CTX *ctx, DYN_GROUP *dg)
 {
-  dguBufferToStruct(DgBuffer, DgBufferIndex, dg);
+  dguBufferToStructCtx(ctx, ctx->buffer, ctx->index, dg);
 }
 
 /*********************************************************************/
@@ -380,70 +408,83 @@ void dgLoadStructure(DYN_GROUP *dg)
 /*********************************************************************/
 
 
-void dgRecordDynList(unsigned char tag, DYN_LIST *dl)
+void dgRecordDynListCtx(DG_IO_CTX *ctx, unsigned char tag, DYN_LIST *dl)
 {
-  dgBeginStruct(tag);
-  dgRecordString(DL_NAME_TAG, DYN_LIST_NAME(dl));
-  dgRecordLong(DL_INCREMENT_TAG, DYN_LIST_INCREMENT(dl));
-  dgRecordLong(DL_FLAGS_TAG, DYN_LIST_FLAGS(dl));
-  dgRecordVoidArray(DL_DATA_TAG, DYN_LIST_DATATYPE(dl), DYN_LIST_N(dl),
-		    DYN_LIST_VALS(dl));
-  dgEndStruct();
+  dgBeginStructCtx(ctx, tag);
+  dgRecordStringCtx(ctx, DL_NAME_TAG, DYN_LIST_NAME(dl));
+  dgRecordLongCtx(ctx, DL_INCREMENT_TAG, DYN_LIST_INCREMENT(dl) > INT_MAX ?
+	       INT_MAX : (int) DYN_LIST_INCREMENT(dl));
+  dgRecordLongCtx(ctx, DL_FLAGS_TAG, DYN_LIST_FLAGS(dl) & ~DL_STORAGE_FLAGS);
+  if (DYN_LIST_FLAGS(dl) & DL_DICT) {
+    DYN_DICT *dict = DYN_LIST_DICT(dl);
+    dg_stamp_large_version(ctx);
+    send_event(ctx, DL_DATA_TAG, NULL);
+    dgRecordStringArrayCtx(ctx, DL_DICT_STRINGS_TAG, dict->nstrings,
+			   dict->strings);
+    dgRecordLongArrayCtx(ctx, DL_DICT_CODES_TAG, DYN_LIST_N(dl),
+			 DYN_LIST_CODES(dl));
+  }
+  else
+    dgRecordVoidArrayCtx(ctx, DL_DATA_TAG, DYN_LIST_DATATYPE(dl),
+			 DYN_LIST_N(dl), DYN_LIST_VALS(dl));
+  dgEndStructCtx(ctx);
 }
 
-void dgRecordDynGroup(DYN_GROUP *dg)
+void dgRecordDynGroupCtx(DG_IO_CTX *ctx, DYN_GROUP *dg)
 {
   int i = 0;
-  dgBeginStruct(DG_BEGIN_TAG);
-  dgRecordString(DG_NAME_TAG, DYN_GROUP_NAME(dg));
-  dgRecordLong(DG_NLISTS_TAG, DYN_GROUP_NLISTS(dg));
+  dgBeginStructCtx(ctx, DG_BEGIN_TAG);
+  dgRecordStringCtx(ctx, DG_NAME_TAG, DYN_GROUP_NAME(dg));
+  dgRecordLongCtx(ctx, DG_NLISTS_TAG, DYN_GROUP_NLISTS(dg));
   for (i = 0; i < DYN_GROUP_NLISTS(dg); i++) 
-    dgRecordDynList(DG_DYNLIST_TAG, DYN_GROUP_LIST(dg,i));
-  dgEndStruct();
+    dgRecordDynListCtx(ctx, DG_DYNLIST_TAG, DYN_GROUP_LIST(dg,i));
+  dgEndStructCtx(ctx);
 }
 
 /*********************************************************************/
 /*                   Array Event Recording Funcs                     */
 /*********************************************************************/
 
-void dgBeginStruct(unsigned char tag)
+void dgBeginStructCtx(DG_IO_CTX *ctx, unsigned char tag)
 {
-  dgRecordFlag(tag);
-  dgPushStruct(dgGetStructureType(tag), dgGetTagName(tag));
+  dgRecordFlagCtx(ctx, tag);
+  dgPushStructCtx(ctx, dgGetStructureTypeCtx(ctx, tag),
+		  dgGetTagNameCtx(ctx, tag));
 }
 
-void dgEndStruct(void)
+void dgEndStructCtx(DG_IO_CTX *ctx)
 {
-  dgRecordFlag(END_STRUCT);
-  dgPopStruct();
+  dgRecordFlagCtx(ctx, END_STRUCT);
+  dgPopStructCtx(ctx);
 }
 
-void dgRecordVoidArray(unsigned char type, int datatype, int n, void *data)
+void dgRecordVoidArrayCtx(DG_IO_CTX *ctx, unsigned char type, int datatype,
+			  DL_SIZE n, void *data)
 {
-  int i;
-  send_event(type, NULL);
+  DL_SIZE i;
+  send_event(ctx, type, NULL);
   switch (datatype) {
   case DF_CHAR:
-    dgRecordCharArray(DL_CHAR_DATA_TAG, n, (char *) data);
+    dgRecordCharArrayCtx(ctx, DL_CHAR_DATA_TAG, n, (char *) data);
     break;
   case DF_SHORT:
-    dgRecordShortArray(DL_SHORT_DATA_TAG, n, (short *) data);
+    dgRecordShortArrayCtx(ctx, DL_SHORT_DATA_TAG, n, (short *) data);
     break;
   case DF_LONG:
-    dgRecordLongArray(DL_LONG_DATA_TAG, n, (int *) data);
+    dgRecordLongArrayCtx(ctx, DL_LONG_DATA_TAG, n, (int *) data);
     break;
   case DF_FLOAT:
-    dgRecordFloatArray(DL_FLOAT_DATA_TAG, n, (float *) data);
+    dgRecordFloatArrayCtx(ctx, DL_FLOAT_DATA_TAG, n, (float *) data);
     break;
   case DF_STRING:
-    dgRecordStringArray(DL_STRING_DATA_TAG, n, (char **) data);
+    dgRecordStringArrayCtx(ctx, DL_STRING_DATA_TAG, n, (char **) data);
     break;
   case DF_LIST:
     {
       DYN_LIST **vals = (DYN_LIST **) data;
-      dgRecordListArray(DL_LIST_DATA_TAG, n);
+      dgRecordListArrayCtx(ctx, DL_LIST_DATA_TAG, n);
       for (i = 0; i < n; i++) {
-	dgRecordDynList(DL_SUBLIST_TAG, vals[i]);
+	dgRecordDynListCtx(ctx, DL_SUBLIST_TAG, vals[i]);
       }
     }
     break;
@@ -451,92 +492,102 @@ void dgRecordVoidArray(unsigned char type, int datatype, int n, void *data)
 }
 
 
-void dgRecordString(unsigned char type, char *str)
+void dgRecordStringCtx(DG_IO_CTX *ctx, unsigned char type, char *str)
 {
   int length;
   if (!str) return;
   length = strlen(str) + 1;
-  send_event(type, (unsigned char *) &length);
-  send_bytes(length, (unsigned char *)str);
+  send_event(ctx, type, (unsigned char *) &length);
+  send_bytes(ctx, length, (unsigned char *)str);
 }
 
-void dgRecordStringArray(unsigned char type, int n, char **s)
+void dgRecordStringArrayCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n,
+			    char **s)
 {
-  int length, i;
+  int length;
+  DL_SIZE i;
   char *str;
   
   if (!s) return;
-  send_event(type, (unsigned char *) &n);
+  send_count(ctx, type, n);
   
   for (i = 0; i < n; i++) {
     str = s[i];
     length = strlen(str) + 1;
-    send_bytes(sizeof(int), (unsigned char *) &length);
-    send_bytes(length, (unsigned char *)str);
+    send_bytes(ctx, sizeof(int), (unsigned char *) &length);
+    send_bytes(ctx, length, (unsigned char *)str);
   }
 }
 
-void dgRecordLongArray(unsigned char type, int n, int *a)
+void dgRecordLongArrayCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n, int *a)
 {
-  send_event(type, (unsigned char *) &n);
-  send_bytes(n*sizeof(int), (unsigned char *) a);
+  send_count(ctx, type, n);
+  send_bytes(ctx, n*sizeof(int), (unsigned char *) a);
 }
 
-void dgRecordCharArray(unsigned char type, int n, char *a)
+void dgRecordCharArrayCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n,
+			  char *a)
 {
-  send_event(type, (unsigned char *) &n);
-  send_bytes(n*sizeof(char), (unsigned char *) a);
+  send_count(ctx, type, n);
+  send_bytes(ctx, n*sizeof(char), (unsigned char *) a);
 }
 
-void dgRecordShortArray(unsigned char type, int n, short *a)
+void dgRecordShortArrayCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n,
+			   short *a)
 {
-  send_event(type, (unsigned char *) &n);
-  send_bytes(n*sizeof(short), (unsigned char *) a);
+  send_count(ctx, type, n);
+  send_bytes(ctx, n*sizeof(short), (unsigned char *) a);
 }
 
-void dgRecordFloatArray(unsigned char type, int n, float *a)
+void dgRecordFloatArrayCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n,
+			   float *a)
 {
-  send_event(type, (unsigned char *) &n);
-  send_bytes(n*sizeof(float), (unsigned char *) a);
+  send_count(ctx, type, n);
+  send_bytes(ctx, n*sizeof(float), (unsigned char *) a);
 }
 
-void dgRecordListArray(unsigned char type, int n)
+void dgRecordListArrayCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n)
 {
-  send_event(type, (unsigned char *) &n);
+  send_count(ctx, type, n);
 }
 
 /*********************************************************************/
 /*                  Low Level Event Recording Funcs                  */
 /*********************************************************************/
 
-void dgRecordMagicNumber(void)
+void dgRecordMagicNumberCtx(DG_IO_CTX *ctx)
 {
-  send_bytes(DG_MAGIC_NUMBER_SIZE, (unsigned char *) dgMagicNumber);
+  send_bytes(ctx, DG_MAGIC_NUMBER_SIZE, (unsigned char *) dgMagicNumber);
 }
 
-void dgRecordFlag(unsigned char type)
+void dgRecordFlagCtx(DG_IO_CTX *ctx, unsigned char type)
 {
-  send_event(type, (unsigned char *) NULL);
+  send_event(ctx, type, (unsigned char *) NULL);
 }
 
-void dgRecordChar(unsigned char type, unsigned char val)
+void dgRecordCharCtx(DG_IO_CTX *ctx, unsigned char type, unsigned char val)
 {
-  send_event(type, (unsigned char *) &val);
+  send_event(ctx, type, (unsigned char *) &val);
 }
 
-void dgRecordLong(unsigned char type, int val)
+void dgRecordLongCtx(DG_IO_CTX *ctx, unsigned char type, int val)
 {
-  send_event(type, (unsigned char *) &val);
+  send_event(ctx, type, (unsigned char *) &val);
 }
 
-void dgRecordShort(unsigned char type, short val)
+void dgRecordShortCtx(DG_IO_CTX *ctx, unsigned char type, short val)
 {
-  send_event(type, (unsigned char *) &val);
+  send_event(ctx, type, (unsigned char *) &val);
 }
 
-void dgRecordFloat(unsigned char type, float val)
+void dgRecordFloatCtx(DG_IO_CTX *ctx, unsigned char type, float val)
 {
-  send_event(type, (unsigned char *) &val);
+  send_event(ctx, type, (unsigned char *) &val);
+}
+
+void dgRecordSizeCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE val)
+{
+  send_event(ctx, type, (unsigned char *) &val);
 }
 
 
@@ -544,85 +595,81 @@ void dgRecordFloat(unsigned char type, float val)
 /*                    Keep Track of Current Structure                */
 /*********************************************************************/
 
-void dgPushStruct(int newstruct, char *name)
+void dgPushStructCtx(DG_IO_CTX *ctx, int newstruct, char *name)
 {
-  if (!DgStructStack) 
-    DgStructStack = 
-      (TAG_INFO *) calloc(DgStructStackIncrement, sizeof(TAG_INFO));
-  
-  else if (DgStructStackIndex == (DgStructStackSize-1)) {
-    DgStructStackSize += DgStructStackIncrement;
-    DgStructStack = 
-      (TAG_INFO *) realloc(DgStructStack, DgStructStackSize*sizeof(TAG_INFO));
+  if (ctx->depth == ctx->stack_size) {
+    ctx->stack_size += DG_STRUCT_STACK_INCREMENT;
+    ctx->stack = 
+      (TAG_INFO *) realloc(ctx->stack, ctx->stack_size*sizeof(TAG_INFO));
   }
-  DgStructStackIndex++;
-  DgStructStack[DgStructStackIndex].struct_type = newstruct;
-  DgStructStack[DgStructStackIndex].tag_name = name;
-  DgCurStruct = newstruct;
-  DgCurStructName = name;
+  ctx->stack[ctx->depth].struct_type = newstruct;
+  ctx->stack[ctx->depth].tag_name = name;
+  ctx->depth++;
+  ctx->cur_struct = newstruct;
+  ctx->cur_struct_name = name;
 }
     
-int dgPopStruct(void)
+int dgPopStructCtx(DG_IO_CTX *ctx)
 {
-  if (!DgStructStackIndex) {
+  if (ctx->depth <= 1) {
     fprintf(stderr, "dgPopStruct(): popped to an empty stack\n");
     return(-1);
   }
 
-  DgStructStackIndex--;
-  DgCurStruct = DgStructStack[DgStructStackIndex].struct_type;
-  DgCurStructName = DgStructStack[DgStructStackIndex].tag_name;
+  ctx->depth--;
+  ctx->cur_struct = ctx->stack[ctx->depth-1].struct_type;
+  ctx->cur_struct_name = ctx->stack[ctx->depth-1].tag_name;
 
-  return(DgCurStruct);
+  return(ctx->cur_struct);
 }
 
-void dgFreeStructStack(void)
+void dgFreeStructStackCtx(DG_IO_CTX *ctx)
 {
-  if (DgStructStack) free(DgStructStack);
-  DgStructStack = NULL;
-  DgStructStackSize = 0;
-  DgStructStackIndex = -1;
+  if (ctx->stack) free(ctx->stack);
+  ctx->stack = NULL;
+  ctx->stack_size = 0;
+  ctx->depth = 0;
 }
 
-int dgGetCurrentStruct(void)
+int dgGetCurrentStructCtx(DG_IO_CTX *ctx)
 {
-  return(DgCurStruct);
+  return(ctx->cur_struct);
 }
 
-char *dgGetCurrentStructName(void)
+char *dgGetCurrentStructNameCtx(DG_IO_CTX *ctx)
 {
-  return(DgCurStructName);
+  return(ctx->cur_struct_name ? ctx->cur_struct_name : "DG_TOP_LEVEL");
 }
 
 
-char *dgGetTagName(int type)
+char *dgGetTagNameCtx(DG_IO_CTX *ctx, int type)
 {
-  return(DGTagTable[DgCurStruct][type].tag_name);
+  return(DGTagTable[ctx->cur_struct][type].tag_name);
 }
 
-int dgGetDataType(int type)
+int dgGetDataTypeCtx(DG_IO_CTX *ctx, int type)
 {
-  return(DGTagTable[DgCurStruct][type].data_type);
+  return(DGTagTable[ctx->cur_struct][type].data_type);
 }
 
-int dgGetStructureType(int type)
+int dgGetStructureTypeCtx(DG_IO_CTX *ctx, int type)
 {
-  return(DGTagTable[DgCurStruct][type].struct_type);
+  return(DGTagTable[ctx->cur_struct][type].struct_type);
 }
 /*********************************************************************/
 /*               Local Byte Stream Handling Functions                */
 /*********************************************************************/
 
-static void send_event(unsigned char type, unsigned char *data)
+static void send_event(DG_IO_CTX *ctx, unsigned char type, unsigned char *data)
 {
 /* First push the tag into the buffer */
-  push((unsigned char *)&type, 1, 1);
+  push(ctx, (unsigned char *)&type, 1, 1);
   
 /* The only "special" tag is the END_STRUCT tag, which means pop up */
   if (type == END_STRUCT) return;
 
 /* All other tags may have data; check the current struct tag table  */
-  switch(DGTagTable[DgCurStruct][type].data_type) {
+  switch(DGTagTable[ctx->cur_struct][type].data_type) {
   case DF_STRUCTURE:            /* data follows via tags             */
   case DF_FLAG:		
   case DF_VOID_ARRAY:
@@ -635,17 +682,20 @@ static void send_event(unsigned char type, unsigned char *data)
   case DF_CHAR_ARRAY:
   case DF_LIST_ARRAY:
   case DF_LONG:
-    push(data, sizeof(int), 1);
+    push(ctx, data, sizeof(int), 1);
     break;
   case DF_CHAR:
-    push(data, sizeof(char), 1);
+    push(ctx, data, sizeof(char), 1);
     break;
   case DF_SHORT:
-    push(data, sizeof(short), 1);
+    push(ctx, data, sizeof(short), 1);
     break;
   case DF_VERSION:
   case DF_FLOAT:
-    push(data, sizeof(float), 1);
+    push(ctx, data, sizeof(float), 1);
+    break;
+  case DF_SIZE_T:
+    push(ctx, data, sizeof(DL_SIZE), 1);
     break;
   default:
     fprintf(stderr,"Unrecognized event type: %d\n", type);
@@ -653,31 +703,54 @@ static void send_event(unsigned char type, unsigned char *data)
   }
 }
 
-static void send_bytes(int n, unsigned char *data)
+/*
+ * Array counts are stored as ints.  A count that doesn't fit is
+ * recorded in a preceding DL_NVALS64_TAG and written as -1, and the
+ * buffer's version is raised to dgLargeVersion (the version float
+ * follows the magic number and the version tag).
+ */
+static void dg_stamp_large_version(DG_IO_CTX *ctx)
+{
+  memcpy(&ctx->buffer[DG_MAGIC_NUMBER_SIZE+1], &dgLargeVersion, sizeof(float));
+}
+
+static void send_count(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n)
+{
+  int count = (int) n;
+  if (n > INT_MAX) {
+    dgRecordSizeCtx(ctx, DL_NVALS64_TAG, n);
+    dg_stamp_large_version(ctx);
+    count = -1;
+  }
+  send_event(ctx, type, (unsigned char *) &count);
+}
+
+static void send_bytes(DG_IO_CTX *ctx, DL_SIZE n, unsigned char *data)
 {
-  push(data, sizeof(unsigned char), n);
+  push(ctx, data, sizeof(unsigned char), n);
 }
 
-static void push(unsigned char *data, int size, int count)
+static void push(DG_IO_CTX *ctx, unsigned char *data, int size, DL_SIZE count)
 {
-   int nbytes, newsize;
-   int buffer_increment = DgBufferIncrement;
+   DL_SIZE nbytes, newsize;
+   DL_SIZE buffer_increment =
+     ctx->increment ? ctx->increment : DG_DATA_BUFFER_SIZE;
    
    nbytes = count * size;
    
-   if (DgBufferIndex + nbytes >= DgBufferSize) {
+   if (ctx->index + nbytes >= ctx->size) {
      if (nbytes > buffer_increment)
        buffer_increment = 2*nbytes;
      do {
-       newsize = DgBufferSize + buffer_increment;
-       DgBuffer = (unsigned char *) realloc(DgBuffer, newsize);
+       newsize = ctx->size + buffer_increment;
+       ctx->buffer = (unsigned char *) realloc(ctx->buffer, newsize);
        /* Really need to check that buffer was reallocated properly */
-       DgBufferSize = newsize;
-     } while(DgBufferIndex + nbytes >= DgBufferSize);
+       ctx->size = newsize;
+     } while(ctx->index + nbytes >= ctx->size);
    }
    
-   memcpy(&DgBuffer[DgBufferIndex], data, nbytes);
-   DgBufferIndex += nbytes;
+   memcpy(&ctx->buffer[ctx->index], data, nbytes);
+   ctx->index += nbytes;
 }
 
 
@@ -685,7 +758,7 @@ static void push(unsigned char *data, int size, int count)
 /*                         Dump Helper Funcs                             */
 /*************************************************************************/
 
-static void dgDumpBuffer(unsigned char *buffer, int n, int type, FILE *fp)
+static void dgDumpBuffer(unsigned char *buffer, DL_SIZE n, int type, FILE *fp)
 {
   switch(type) {
   case DF_BINARY:
@@ -732,9 +805,46 @@ int vconfirm_magic_number(char *s)
   -----                   File Read Functions                    -----
   -------------------------------------------------------------------*/
 
+/* the versions this reader understands */
+static int dg_known_version(float version)
+{
+  return (version == dgVersion || version == dgLargeVersion);
+}
+
+/* resolve an array count, picking up a pending DL_NVALS64_TAG count */
+static DL_SIZE dg_array_count(DG_IO_CTX *ctx, int count)
+{
+  if (count == -1 && ctx->next_count > 0) return ctx->next_count;
+  return count;
+}
+
+static DL_SIZE flipsize(DL_SIZE val)
+{
+  DL_SIZE newval;
+  unsigned char *old = (unsigned char *) &val, *new = (unsigned char *) &newval;
+  int i;
+  for (i = 0; i < (int) sizeof(DL_SIZE); i++)
+    new[i] = old[sizeof(DL_SIZE)-1-i];
+  return newval;
+}
+
+/* byte swap n 2 or 4 byte values (the flip*s() helpers take int counts) */
+static void flip_vals(DL_SIZE n, int size, void *vals)
+{
+  DL_SIZE i;
+  if (size == sizeof(short)) {
+    short *s = (short *) vals;
+    for (i = 0; i < n; i++) s[i] = flipshort(s[i]);
+  }
+  else if (size == sizeof(int)) {
+    int *l = (int *) vals;	/* floats are flipped bytewise, as ints */
+    for (i = 0; i < n; i++) l[i] = fliplong(l[i]);
+  }
+}
+
 
 static 
-void read_version(FILE *InFP, FILE *OutFP)
+void read_version(DG_IO_CTX *ctx, FILE *InFP, FILE *OutFP)
 {
   float val;
   if (fread(&val, sizeof(float), 1, InFP) != 1) {
@@ -745,56 +855,56 @@ void read_version(FILE *InFP, FILE *OutFP)
   /* 
    * The VERSION should stay as a float, so that byte ordering can be 
    * checked dynamically.  If it doesn't match the first way, then the
-   * dgFlipEvents flag is set and it's tried again.
+   * flip flag is set and it's tried again.
    */
 
-  if (val != dgVersion) {
-    dgFlipEvents = 1;
+  if (!dg_known_version(val)) {
+    ctx->flip = 1;
     val = flipfloat(val);
-    if (val != dgVersion) {
+    if (!dg_known_version(val)) {
       fprintf(stderr,
 	      "Unable to read this version of data file (V %5.1f/%5.1f)\n",
 	      val, flipfloat(val));
       return;
     }
   }
-  else dgFlipEvents = 0;
+  else ctx->flip = 0;
   fprintf(OutFP,"%-20s\t%3.1f\n", "DG_VERSION", val);
 }
 
 static 
-void read_flag(char type, FILE *InFP, FILE *OutFP)
+void read_flag(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
-  fprintf(OutFP, "%-20s\n", dgGetTagName(type));
+  fprintf(OutFP, "%-20s\n", dgGetTagNameCtx(ctx, type));
 }
 
 static 
-void read_float(char type, FILE *InFP, FILE *OutFP)
+void read_float(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   float val;
   if (fread(&val, sizeof(float), 1, InFP) != 1) {
      fprintf(stderr,"Error reading float info\n");
      return;
   }
-  if (dgFlipEvents) val = flipfloat(val);
+  if (ctx->flip) val = flipfloat(val);
 
-  fprintf(OutFP, "%-20s\t%6.3f\n", dgGetTagName(type), val);
+  fprintf(OutFP, "%-20s\t%6.3f\n", dgGetTagNameCtx(ctx, type), val);
 }
 
 static 
-void read_char(char type, FILE *InFP, FILE *OutFP)
+void read_char(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   char val;
   if (fread(&val, sizeof(char), 1, InFP) != 1) {
      fprintf(stderr,"Error reading char val\n");
      return;
   }
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), val);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), val);
 }
 
 
 static
-void read_long(char type, FILE *InFP, FILE *OutFP)
+void read_long(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   int val;
   
@@ -803,13 +913,28 @@ void read_long(char type, FILE *InFP, FILE *OutFP)
     return;
   }
   
-  if (dgFlipEvents) val = fliplong(val);
+  if (ctx->flip) val = fliplong(val);
+  
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), val);
+}
+
+static
+void read_size(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
+{
+  DL_SIZE val;
+  
+  if (fread(&val, sizeof(DL_SIZE), 1, InFP) != 1) {
+    fprintf(stderr,"Error reading size val\n");
+    return;
+  }
+  
+  if (ctx->flip) val = flipsize(val);
   
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), val);
+  fprintf(OutFP, "%-20s\t%lld\n", dgGetTagNameCtx(ctx, type), (long long) val);
 }
 
 static
-void read_short(char type, FILE *InFP, FILE *OutFP)
+void read_short(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   short val;
   
@@ -818,16 +943,16 @@ void read_short(char type, FILE *InFP, FILE *OutFP)
     return;
   }
   
-  if (dgFlipEvents) val = flipshort(val);
+  if (ctx->flip) val = flipshort(val);
 
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), val);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), val);
 }   
 
 
 /*********************** ARRAY VERSIONS ************************/
 
 static
-void read_string(char type, FILE *InFP, FILE *OutFP)
+void read_string(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   int length;
   char *str = "";
@@ -837,7 +962,7 @@ void read_string(char type, FILE *InFP, FILE *OutFP)
     return;
   }
   
-  if (dgFlipEvents) length = fliplong(length);
+  if (ctx->flip) length = fliplong(length);
   if (length) {
     str = (char *) malloc(length);
     
@@ -847,12 +972,12 @@ void read_string(char type, FILE *InFP, FILE *OutFP)
     }
   }
 
-  fprintf(OutFP, "%-20s\t%s\n", dgGetTagName(type), str);
+  fprintf(OutFP, "%-20s\t%s\n", dgGetTagNameCtx(ctx, type), str);
   if (length) free(str);
 }
 
 static
-void read_strings(char type, FILE *InFP, FILE *OutFP)
+void read_strings(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   int n, i;
   int length;
@@ -862,15 +987,15 @@ void read_strings(char type, FILE *InFP, FILE *OutFP)
     fprintf(stderr,"Error reading string length\n");
     return;
   }
-  if (dgFlipEvents) n = fliplong(n);
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type),n);
+  if (ctx->flip) n = fliplong(n);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type),n);
 
   for (i = 0; i < n; i++) {
     if (fread(&length, sizeof(int), 1, InFP) != 1) {
       fprintf(stderr,"Error reading string length\n");
       return;
     }
-    if (dgFlipEvents) length = fliplong(length);
+    if (ctx->flip) length = fliplong(length);
     
     str = "";
     if (length) {
@@ -888,7 +1013,7 @@ void read_strings(char type, FILE *InFP, FILE *OutFP)
 }
 
 static
-void read_chars(char type, FILE *InFP, FILE *OutFP)
+void read_chars(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   int nchars, i;
   char *vals = NULL;
@@ -898,7 +1023,7 @@ void read_chars(char type, FILE *InFP, FILE *OutFP)
     return;
   }
 
-  if (dgFlipEvents) nchars = fliplong(nchars);
+  if (ctx->flip) nchars = fliplong(nchars);
   
   if (nchars) {
     if (!(vals = (char *) calloc(nchars, sizeof(char)))) {
@@ -912,7 +1037,7 @@ void read_chars(char type, FILE *InFP, FILE *OutFP)
     }
   }
   
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nchars); 
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nchars); 
   
   for (i = 0; i < nchars; i++) {
     fprintf(OutFP, "%d\t%c\n", i+1, vals[i]);
@@ -922,7 +1047,7 @@ void read_chars(char type, FILE *InFP, FILE *OutFP)
 
 
 static
-void read_longs(char type, FILE *InFP, FILE *OutFP)
+void read_longs(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   int nlongs, i;
   int *vals = NULL;
@@ -932,7 +1057,7 @@ void read_longs(char type, FILE *InFP, FILE *OutFP)
     return;
   }
   
-  if (dgFlipEvents) nlongs = fliplong(nlongs);
+  if (ctx->flip) nlongs = fliplong(nlongs);
   
   if (nlongs) {
     if (!(vals = (int *) calloc(nlongs, sizeof(int)))) {
@@ -945,10 +1070,10 @@ void read_longs(char type, FILE *InFP, FILE *OutFP)
       return;
     }
     
-    if (dgFlipEvents) fliplongs(nlongs, vals);
+    if (ctx->flip) fliplongs(nlongs, vals);
   }
 
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nlongs); 
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nlongs); 
   
   for (i = 0; i < nlongs; i++) {
     fprintf(OutFP, "%d\t%d\n", i+1, vals[i]);
@@ -958,7 +1083,7 @@ void read_longs(char type, FILE *InFP, FILE *OutFP)
 
 
 static
-void read_shorts(char type, FILE *InFP, FILE *OutFP)
+void read_shorts(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   int nshorts, i;
   short *vals = NULL;
@@ -968,7 +1093,7 @@ void read_shorts(char type, FILE *InFP, FILE *OutFP)
     return;
   }
   
-  if (dgFlipEvents) nshorts = fliplong(nshorts);
+  if (ctx->flip) nshorts = fliplong(nshorts);
   
   if (nshorts) {
     if (!(vals = (short *) calloc(nshorts, sizeof(short)))) {
@@ -981,10 +1106,10 @@ void read_shorts(char type, FILE *InFP, FILE *OutFP)
       return;
     }
     
-    if (dgFlipEvents) flipshorts(nshorts, vals);
+    if (ctx->flip) flipshorts(nshorts, vals);
   }
   
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nshorts); 
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nshorts); 
   
   for (i = 0; i < nshorts; i++) {
     fprintf(OutFP, "%d\t%d\n", i+1, vals[i]);
@@ -993,7 +1118,7 @@ void read_shorts(char type, FILE *InFP, FILE *OutFP)
 }
 
 static
-void read_floats(char type, FILE *InFP, FILE *OutFP)
+void read_floats(DG_IO_CTX *ctx, char type, FILE *InFP, FILE *OutFP)
 {
   int nfloats, i;
   float *vals = NULL;
@@ -1003,7 +1128,7 @@ void read_floats(char type, FILE *InFP, FILE *OutFP)
     return;
   }
   
-  if (dgFlipEvents) nfloats = fliplong(nfloats);
+  if (ctx->flip) nfloats = fliplong(nfloats);
   
   if (nfloats) {
     if (!(vals = (float *) calloc(nfloats, sizeof(float)))) {
@@ -1016,9 +1141,9 @@ void read_floats(char type, FILE *InFP, FILE *OutFP)
       return;
     }
     
-    if (dgFlipEvents) flipfloats(nfloats, vals);
+    if (ctx->flip) flipfloats(nfloats, vals);
   }
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nfloats); 
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nfloats); 
   
   for (i = 0; i < nfloats; i++) {
     fprintf(OutFP, "%d\t%6.2f\n", i+1, vals[i]);
@@ -1039,7 +1164,7 @@ void read_floats(char type, FILE *InFP, FILE *OutFP)
   -------------------------------------------------------------------*/
 
 static 
-int vread_version(float *version, FILE *OutFP)
+int vread_version(DG_IO_CTX *ctx, float *version, FILE *OutFP)
 {
   float val;
   memcpy(&val, version, sizeof(float));
@@ -1050,80 +1175,91 @@ int vread_version(float *version, FILE *OutFP)
    * FlipEvents flag is set and it's tried again.
    */
 
-  if (val != dgVersion) {
-    dgFlipEvents = 1;
+  if (!dg_known_version(val)) {
+    ctx->flip = 1;
     val = flipfloat(val);
-    if (val != dgVersion) {
+    if (!dg_known_version(val)) {
       fprintf(stderr,
 	      "Unable to read this version of data file (V %5.1f/%5.1f)\n",
 	      val, flipfloat(val));
       return(sizeof(float));
     }
   }
-  else dgFlipEvents = 0;
+  else ctx->flip = 0;
   fprintf(OutFP,"%-20s\t%3.1f\n", "DG_VERSION", val);
   return(sizeof(float));
 }
 
 static int
-vread_flag(char type, FILE *OutFP)
+vread_flag(DG_IO_CTX *ctx, char type, FILE *OutFP)
 {
-  fprintf(OutFP, "%-20s\n", dgGetTagName(type));
+  fprintf(OutFP, "%-20s\n", dgGetTagNameCtx(ctx, type));
   return(0);
 }
 
 static 
-int vread_float(char type, float *fval, FILE *OutFP)
+int vread_float(DG_IO_CTX *ctx, char type, float *fval, FILE *OutFP)
 {
   float val;
   memcpy(&val, fval, sizeof(float));
 
-  if (dgFlipEvents) val = flipfloat(val);
+  if (ctx->flip) val = flipfloat(val);
 
-  fprintf(OutFP, "%-20s\t%6.3f\n", dgGetTagName(type), val);
+  fprintf(OutFP, "%-20s\t%6.3f\n", dgGetTagNameCtx(ctx, type), val);
   return(sizeof(float));
 }
 
 
 static 
-int vread_char(char type, char *cval, FILE *OutFP)
+int vread_char(DG_IO_CTX *ctx, char type, char *cval, FILE *OutFP)
 {
   char val;
   memcpy(&val, cval, sizeof(char));
 
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), val);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), val);
   return(sizeof(char));
 }
 
 
 static
-int vread_long(char type, int *ival, FILE *OutFP)
+int vread_long(DG_IO_CTX *ctx, char type, int *ival, FILE *OutFP)
 {
   int val;
   memcpy(&val, ival, sizeof(int));
 
-  if (dgFlipEvents) val = fliplong(val);
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), val);
+  if (ctx->flip) val = fliplong(val);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), val);
   return(sizeof(int));
 }   
 
 
 static
-int vread_short(char type, short *sval, FILE *OutFP)
+int vread_size(DG_IO_CTX *ctx, char type, DL_SIZE *sval, FILE *OutFP)
+{
+  DL_SIZE val;
+  memcpy(&val, sval, sizeof(DL_SIZE));
+
+  if (ctx->flip) val = flipsize(val);
+  fprintf(OutFP, "%-20s\t%lld\n", dgGetTagNameCtx(ctx, type), (long long) val);
+  return(sizeof(DL_SIZE));
+}   
+
+static
+int vread_short(DG_IO_CTX *ctx, char type, short *sval, FILE *OutFP)
 {
   short val;
   memcpy(&val, sval, sizeof(short));
 
-  if (dgFlipEvents) val = flipshort(val);
+  if (ctx->flip) val = flipshort(val);
   
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), val);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), val);
   return(sizeof(short));
 }   
 
 /*********************** ARRAY VERSIONS ************************/
 
 static 
-int vread_string(char type, int *iptr, FILE *OutFP)
+int vread_string(DG_IO_CTX *ctx, char type, int *iptr, FILE *OutFP)
 {
   int length;
   int *next = iptr+1;
@@ -1131,14 +1267,14 @@ int vread_string(char type, int *iptr, FILE *OutFP)
 
   memcpy(&length, iptr, sizeof(int));
 
-  if (dgFlipEvents) length = fliplong(length);
+  if (ctx->flip) length = fliplong(length);
   
-  if (length) fprintf(OutFP, "%-20s\t%s\n", dgGetTagName(type), str);
+  if (length) fprintf(OutFP, "%-20s\t%s\n", dgGetTagNameCtx(ctx, type), str);
   return(length+sizeof(int));
 }
 
 static 
-int vread_strings(char type, int *iptr, FILE *OutFP)
+int vread_strings(DG_IO_CTX *ctx, char type, int *iptr, FILE *OutFP)
 {
   int n, i;
   int length, sum = 0;
@@ -1146,13 +1282,13 @@ int vread_strings(char type, int *iptr, FILE *OutFP)
   char *str = "";
   
   memcpy(&n, iptr++, sizeof(int));
-  if (dgFlipEvents) n = fliplong(n);
+  if (ctx->flip) n = fliplong(n);
   
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), n);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), n);
 
   for (i = 0; i < n; i++) {
     memcpy(&length, next, sizeof(int));
-    if (dgFlipEvents) length = fliplong(length);
+    if (ctx->flip) length = fliplong(length);
 
     if (length) str = (char *) next+sizeof(int);
     
@@ -1164,7 +1300,7 @@ int vread_strings(char type, int *iptr, FILE *OutFP)
 }
 
 static
-int vread_longs(char type, int *n, FILE *OutFP)
+int vread_longs(DG_IO_CTX *ctx, char type, int *n, FILE *OutFP)
 {
   int i;
   int nvals;
@@ -1173,7 +1309,7 @@ int vread_longs(char type, int *n, FILE *OutFP)
   int *vals = NULL;
 
   memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
 
   if (nvals) {
     if (!(vals = (int *) calloc(nvals, sizeof(int)))) {
@@ -1182,9 +1318,9 @@ int vread_longs(char type, int *n, FILE *OutFP)
     }
     memcpy(vals, vl, sizeof(int)*nvals);
 
-    if (dgFlipEvents) fliplongs(nvals, vals);
+    if (ctx->flip) fliplongs(nvals, vals);
   }
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nvals);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nvals);
   
   for (i = 0; i < nvals; i++) {
     fprintf(OutFP, "%d\t%d\n", i+1, vals[i]);
@@ -1196,7 +1332,7 @@ int vread_longs(char type, int *n, FILE *OutFP)
 
 
 static
-int vread_shorts(char type, int *n, FILE *OutFP)
+int vread_shorts(DG_IO_CTX *ctx, char type, int *n, FILE *OutFP)
 {
   int i;
   int nvals;
@@ -1205,7 +1341,7 @@ int vread_shorts(char type, int *n, FILE *OutFP)
   short *vals = NULL;
 
   memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
 
   if (nvals) {
     if (!(vals = (short *) calloc(nvals, sizeof(short)))) {
@@ -1214,9 +1350,9 @@ int vread_shorts(char type, int *n, FILE *OutFP)
     }
     memcpy(vals, vl, sizeof(short)*nvals);
     
-    if (dgFlipEvents) flipshorts(nvals, vals);
+    if (ctx->flip) flipshorts(nvals, vals);
   }
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nvals);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nvals);
   
   for (i = 0; i < nvals; i++) {
     fprintf(OutFP, "%d\t%d\n", i+1, vals[i]);
@@ -1228,7 +1364,7 @@ int vread_shorts(char type, int *n, FILE *OutFP)
 
 
 static
-int vread_chars(char type, int *n, FILE *OutFP)
+int vread_chars(DG_IO_CTX *ctx, char type, int *n, FILE *OutFP)
 {
   int i;
   int nvals;
@@ -1237,7 +1373,7 @@ int vread_chars(char type, int *n, FILE *OutFP)
   char *vals = NULL;
 
   memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
 
   if (nvals) {
     if (!(vals = (char *) calloc(nvals, sizeof(char)))) {
@@ -1247,7 +1383,7 @@ int vread_chars(char type, int *n, FILE *OutFP)
     memcpy(vals, vl, sizeof(char)*nvals);
   }
 
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nvals);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nvals);
   
   for (i = 0; i < nvals; i++) {
     fprintf(OutFP, "%d\t%c\n", i+1, vals[i]);
@@ -1258,7 +1394,7 @@ int vread_chars(char type, int *n, FILE *OutFP)
 }
 
 static
-int vread_floats(char type, int *n, FILE *OutFP)
+int vread_floats(DG_IO_CTX *ctx, char type, int *n, FILE *OutFP)
 {
   int i;
   int nvals;
@@ -1267,7 +1403,7 @@ int vread_floats(char type, int *n, FILE *OutFP)
   float *vals = NULL;
 
   memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
 
   if (nvals) {
     if (!(vals = (float *) calloc(nvals, sizeof(float)))) {
@@ -1276,9 +1412,9 @@ int vread_floats(char type, int *n, FILE *OutFP)
     }
     memcpy(vals, vl, sizeof(float)*nvals);
     
-    if (dgFlipEvents) flipfloats(nvals, vals);
+    if (ctx->flip) flipfloats(nvals, vals);
   }
-  fprintf(OutFP, "%-20s\t%d\n", dgGetTagName(type), nvals);
+  fprintf(OutFP, "%-20s\t%d\n", dgGetTagNameCtx(ctx, type), nvals);
   
   for (i = 0; i < nvals; i++) {
     fprintf(OutFP, "%d\t%6.2f\n", i+1, vals[i]);
@@ -1303,7 +1439,7 @@ int skip_bytes(FILE *InFP, int n)
 }
 
 static
-void skip_version(FILE *InFP) 
+void skip_version(DG_IO_CTX *ctx, FILE *InFP) 
 {
   float val;
   if (fread(&val, sizeof(float), 1, InFP) != 1) {
@@ -1314,20 +1450,20 @@ void skip_version(FILE *InFP)
   /* 
    * The VERSION should stay as a float, so that byte ordering can be 
    * checked dynamically.  If it doesn't match the first way, then the
-   * dgFlipEvents flag is set and it's tried again.
+   * flip flag is set and it's tried again.
    */
 
-  if (val != dgVersion) {
-    dgFlipEvents = 1;
+  if (!dg_known_version(val)) {
+    ctx->flip = 1;
     val = flipfloat(val);
-    if (val != dgVersion) {
+    if (!dg_known_version(val)) {
       fprintf(stderr,
 	      "Unable to read this version of data file (V %5.1f/%5.1f)\n",
 	      val, flipfloat(val));
       return;
     }
   }
-  else dgFlipEvents = 0;
+  else ctx->flip = 0;
 }
 
 static int skip_float(FILE *InFP) 
@@ -1350,7 +1486,7 @@ static int skip_long(FILE *InFP)
   return(skip_bytes(InFP, sizeof(int)));
 }
 
-static int skip_string(FILE *InFP)
+static int skip_string(DG_IO_CTX *ctx, FILE *InFP)
 {
   int length;
   
@@ -1358,11 +1494,11 @@ static int skip_string(FILE *InFP)
     fprintf(stderr,"Error reading string length\n");
     return(0);
   }
-  if (dgFlipEvents) length = fliplong(length);
+  if (ctx->flip) length = fliplong(length);
   return(skip_bytes(InFP, length));
 }
 
-static int skip_strings(FILE *InFP)
+static int skip_strings(DG_IO_CTX *ctx, FILE *InFP)
 {
   int i, n, sum = 0, size; 
   
@@ -1370,45 +1506,45 @@ static int skip_strings(FILE *InFP)
     fprintf(stderr,"Error reading number of strings\n");
     return(0);
   }
-  if (dgFlipEvents) n = fliplong(n);
+  if (ctx->flip) n = fliplong(n);
   for (i = 0; i < n; i++) {
-    size = skip_string(InFP);
+    size = skip_string(ctx, InFP);
     if (!size) return(0);
     sum += size;
   }
   return(sizeof(int)+sum);
 }
 
-static int skip_longs(FILE *InFP)
+static int skip_longs(DG_IO_CTX *ctx, FILE *InFP)
 {
   int nvals;
   if (fread(&nvals, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of ints\n");
     return(0);
   }
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
   return(skip_bytes(InFP, nvals*sizeof(int)));
 }
 
-static int skip_shorts(FILE *InFP)
+static int skip_shorts(DG_IO_CTX *ctx, FILE *InFP)
 {
   int nvals;
   if (fread(&nvals, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of shorts\n");
     return(0);
   }
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
   return(skip_bytes(InFP, nvals*sizeof(short)));
 }
 
-static int skip_floats(FILE *InFP)
+static int skip_floats(DG_IO_CTX *ctx, FILE *InFP)
 {
   int nvals;
   if (fread(&nvals, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of floats\n");
     return(0);
   }
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
   return(skip_bytes(InFP, nvals*sizeof(float)));
 }
 
@@ -1417,7 +1553,7 @@ static int skip_floats(FILE *InFP)
   -------------------------------------------------------------------*/
 
 static 
-int vskip_version(float *version)
+int vskip_version(DG_IO_CTX *ctx, float *version)
 {
   float val;
   memcpy(&val, version, sizeof(float));
@@ -1428,17 +1564,17 @@ int vskip_version(float *version)
    * FlipEvents flag is set and it's tried again.
    */
 
-  if (val != dgVersion) {
-    dgFlipEvents = 1;
+  if (!dg_known_version(val)) {
+    ctx->flip = 1;
     val = flipfloat(val);
-    if (val != dgVersion) {
+    if (!dg_known_version(val)) {
       fprintf(stderr,
 	      "Unable to read this version of data file (V %5.1f/%5.1f)\n",
 	      val, flipfloat(val));
       return(sizeof(float));
     }
   }
-  else dgFlipEvents = 0;
+  else ctx->flip = 0;
   return(sizeof(float));
 }
 
@@ -1462,52 +1598,52 @@ static int vskip_long(void)
   return(sizeof(int)); 
 }
 
-static int vskip_string(int *l)
+static int vskip_string(DG_IO_CTX *ctx, int *l)
 {
   int length;
   memcpy(&length, l, sizeof(int));
   
-  if (dgFlipEvents) length = fliplong(length);
+  if (ctx->flip) length = fliplong(length);
   return(sizeof(int)+length);
 }
 
-static int vskip_strings(int *l)
+static int vskip_strings(DG_IO_CTX *ctx, int *l)
 {
   int n, size, sum = 0, i;
   char *next = (char *) (l) + sizeof(int);
 
   memcpy(&n, l, sizeof(int));
-  if (dgFlipEvents) n = fliplong(n);
+  if (ctx->flip) n = fliplong(n);
   
   for (i = 0; i < n; i++) {
-    size = vskip_string((int *)next);
+    size = vskip_string(ctx, (int *)next);
     sum += size;
     next += size;
   }
   return(sizeof(int)+sum);
 }
 
-static int vskip_floats(int *n)
+static int vskip_floats(DG_IO_CTX *ctx, int *n)
 {
   int nvals;
   memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
   return(sizeof(int)+(nvals*sizeof(float)));
 }
 
-static int vskip_shorts(int *n)
+static int vskip_shorts(DG_IO_CTX *ctx, int *n)
 {
   int nvals;
   memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
   return(sizeof(int)+(nvals*sizeof(short)));
 }
 
-static int vskip_longs(int *n)
+static int vskip_longs(DG_IO_CTX *ctx, int *n)
 {
   int nvals;
   memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) nvals = fliplong(nvals);
   return(sizeof(int)+(nvals*sizeof(int)));
 }
 
@@ -1519,13 +1655,12 @@ static int vskip_longs(int *n)
  * The file get_ and buffer vget_ readers below used to exit(-1) on any
  * short read, unknown version, or allocation failure -- which killed the
  * whole host process (e.g. dserv) whenever a single .dg/.dgz or datapoint
- * blob was corrupt or truncated.  They now set dgReadError and return safe
- * defaults; the parser loops (dguFileToStruct/DynGroup/DynList and their
- * dguBuffer counterparts) check the flag and abort cleanly.  Array and
- * string counts are also bounded against the bytes actually remaining so
- * a garbage length can't drive a huge allocation.
+ * blob was corrupt or truncated.  They now set the context's read_error
+ * and return safe defaults; the parser loops (dguFileToStruct/DynGroup/
+ * DynList and their dguBuffer counterparts) check the flag and abort
+ * cleanly.  Array and string counts are also bounded against the bytes
+ * actually remaining so a garbage length can't drive a huge allocation.
  */
-static int dgReadError = 0;
 
 /* Bytes remaining from the current position to end of file, or -1 if it
    can't be determined.  Called once per list (not per element), so the
@@ -1544,112 +1679,112 @@ static long file_remaining(FILE *fp)
 
 /* True if a count is sane: non-negative and count*elemsize fits in what
    remains of the file.  rem<0 (unknown size) only rejects negatives. */
-static int file_count_ok(FILE *fp, int count, size_t elemsize)
+static int file_count_ok(FILE *fp, DL_SIZE count, size_t elemsize)
 {
   long rem;
   if (count < 0) return 0;
   rem = file_remaining(fp);
   if (rem < 0) return 1;
-  if ((long) count * (long) elemsize > rem) return 0;
+  if (count > (DL_SIZE) rem / (DL_SIZE) elemsize) return 0;
   return 1;
 }
 
 static
-void get_version(FILE *InFP, float *version)
+void get_version(DG_IO_CTX *ctx, FILE *InFP, float *version)
 {
   float val;
   *version = 0;
   if (fread(&val, sizeof(float), 1, InFP) != 1) {
      fprintf(stderr,"Error reading float info\n");
-     dgReadError = 1;
+     ctx->read_error = 1;
      return;
   }
 
   /*
    * The VERSION should stay as a float, so that byte ordering can be
    * checked dynamically.  If it doesn't match the first way, then the
-   * dgFlipEvents flag is set and it's tried again.
+   * flip flag is set and it's tried again.
    */
 
-  if (val != dgVersion) {
-    dgFlipEvents = 1;
+  if (!dg_known_version(val)) {
+    ctx->flip = 1;
     val = flipfloat(val);
-    if (val != dgVersion) {
+    if (!dg_known_version(val)) {
       fprintf(stderr,
 	      "Unable to read this version of data file (V %5.1f/%5.1f)\n",
 	      val, flipfloat(val));
-      dgFlipEvents = 0;
-      dgReadError = 1;
+      ctx->flip = 0;
+      ctx->read_error = 1;
       return;
     }
   }
-  else dgFlipEvents = 0;
+  else ctx->flip = 0;
   *version = val;
 }
 
 
 static
-void get_float(FILE *InFP, float *fval)
+void get_float(DG_IO_CTX *ctx, FILE *InFP, float *fval)
 {
   float val;
   *fval = 0;
   if (fread(&val, sizeof(float), 1, InFP) != 1) {
      fprintf(stderr,"Error reading float info\n");
-     dgReadError = 1;
+     ctx->read_error = 1;
      return;
   }
-  if (dgFlipEvents) val = flipfloat(val);
+  if (ctx->flip) val = flipfloat(val);
   *fval = val;
 }
 
 static
-void get_char(FILE *InFP, char *cval)
+void get_char(DG_IO_CTX *ctx, FILE *InFP, char *cval)
 {
   char val;
   *cval = 0;
   if (fread(&val, sizeof(char), 1, InFP) != 1) {
      fprintf(stderr,"Error reading char val\n");
-     dgReadError = 1;
+     ctx->read_error = 1;
      return;
   }
   *cval = val;
 }
 
 static
-void get_long(FILE *InFP,  int *ival)
+void get_long(DG_IO_CTX *ctx, FILE *InFP,  int *ival)
 {
   int val;
   *ival = 0;
 
   if (fread(&val, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading int val\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
-  if (dgFlipEvents) val = fliplong(val);
+  if (ctx->flip) val = fliplong(val);
 
   *ival = val;
 }
 
 static
-void get_short(FILE *InFP,  short *sval)
+void get_short(DG_IO_CTX *ctx, FILE *InFP,  short *sval)
 {
   short val;
   *sval = 0;
 
   if (fread(&val, sizeof(short), 1, InFP) != 1) {
     fprintf(stderr,"Error reading short val\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
-  if (dgFlipEvents) val = flipshort(val);
+  if (ctx->flip) val = flipshort(val);
   *sval = val;
 }
 
 static
-void get_string(FILE *InFP, int *n, char **s)
+void get_string(DG_IO_CTX *ctx, FILE *InFP, int *n, char **s)
 {
   int length;
   char *str;
@@ -1658,15 +1793,15 @@ void get_string(FILE *InFP, int *n, char **s)
   *s = strdup("");
   if (fread(&length, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading string length\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
-  if (dgFlipEvents) length = fliplong(length);
+  if (ctx->flip) length = fliplong(length);
 
   if (!file_count_ok(InFP, length, sizeof(char))) {
     fprintf(stderr,"Corrupt string length %d, aborting\n", length);
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
@@ -1675,7 +1810,7 @@ void get_string(FILE *InFP, int *n, char **s)
     if (!str || fread(str, length, 1, InFP) != 1) {
       fprintf(stderr,"Error reading\n");
       free(str);
-      dgReadError = 1;
+      ctx->read_error = 1;
       return;
     }
     free(*s);
@@ -1685,33 +1820,36 @@ void get_string(FILE *InFP, int *n, char **s)
 }
 
 static
-void get_strings(FILE *InFP, int *num, char ***s)
+void get_strings(DG_IO_CTX *ctx, FILE *InFP, DL_SIZE *num, char ***s)
 {
-  int i, n, length;
+  int count, length;
+  DL_SIZE i, n;
   char **strings = NULL;
 
   *num = 0;
   *s = NULL;
-  if (fread(&n, sizeof(int), 1, InFP) != 1) {
+  if (fread(&count, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of strings\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
-  if (dgFlipEvents) n = fliplong(n);
+  if (ctx->flip) count = fliplong(count);
+  n = dg_array_count(ctx, count);
 
   /* each string is at least a 4-byte length prefix */
   if (!file_count_ok(InFP, n, sizeof(int))) {
-    fprintf(stderr,"Corrupt string-array count %d, aborting\n", n);
-    dgReadError = 1;
+    fprintf(stderr,"Corrupt string-array count %lld, aborting\n",
+	    (long long) n);
+    ctx->read_error = 1;
     return;
   }
 
   if (n) {
     strings = (char **) calloc(n, sizeof(char *));
-    if (!strings) { dgReadError = 1; return; }
+    if (!strings) { ctx->read_error = 1; return; }
     for (i = 0; i < n; i++) {
-      get_string(InFP, &length, &strings[i]);
-      if (dgReadError) { n = i + 1; break; }
+      get_string(ctx, InFP, &length, &strings[i]);
+      if (ctx->read_error) { n = i + 1; break; }
     }
   }
 
@@ -1720,23 +1858,26 @@ void get_strings(FILE *InFP, int *num, char ***s)
 }
 
 static
-void get_chars(FILE *InFP, int *n, char **v)
+void get_chars(DG_IO_CTX *ctx, FILE *InFP, DL_SIZE *n, char **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
 
   *n = 0;
   *v = NULL;
-  if (fread(&nvals, sizeof(int), 1, InFP) != 1) {
+  if (fread(&count, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of chars\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (!file_count_ok(InFP, nvals, sizeof(char))) {
-    fprintf(stderr,"Corrupt char count %d, aborting\n", nvals);
-    dgReadError = 1;
+    fprintf(stderr,"Corrupt char count %lld, aborting\n",
+	    (long long) nvals);
+    ctx->read_error = 1;
     return;
   }
 
@@ -1745,7 +1886,7 @@ void get_chars(FILE *InFP, int *n, char **v)
     if (!vals || fread(vals, sizeof(char), nvals, InFP) != (size_t) nvals) {
       fprintf(stderr,"Error reading char elements\n");
       free(vals);
-      dgReadError = 1;
+      ctx->read_error = 1;
       return;
     }
     *n = nvals;
@@ -1754,23 +1895,26 @@ void get_chars(FILE *InFP, int *n, char **v)
 }
 
 static
-void get_shorts(FILE *InFP, int *n, short **v)
+void get_shorts(DG_IO_CTX *ctx, FILE *InFP, DL_SIZE *n, short **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
 
   *n = 0;
   *v = NULL;
-  if (fread(&nvals, sizeof(int), 1, InFP) != 1) {
+  if (fread(&count, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of shorts\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (!file_count_ok(InFP, nvals, sizeof(short))) {
-    fprintf(stderr,"Corrupt short count %d, aborting\n", nvals);
-    dgReadError = 1;
+    fprintf(stderr,"Corrupt short count %lld, aborting\n",
+	    (long long) nvals);
+    ctx->read_error = 1;
     return;
   }
 
@@ -1779,33 +1923,36 @@ void get_shorts(FILE *InFP, int *n, short **v)
     if (!vals || fread(vals, sizeof(short), nvals, InFP) != (size_t) nvals) {
       fprintf(stderr,"Error reading short elements\n");
       free(vals);
-      dgReadError = 1;
+      ctx->read_error = 1;
       return;
     }
-    if (dgFlipEvents) flipshorts(nvals, vals);
+    if (ctx->flip) flip_vals(nvals, sizeof(short), vals);
     *n = nvals;
     *v = vals;
   }
 }
 
 static
-void get_longs(FILE *InFP, int *n, int **v)
+void get_longs(DG_IO_CTX *ctx, FILE *InFP, DL_SIZE *n, int **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
 
   *n = 0;
   *v = NULL;
-  if (fread(&nvals, sizeof(int), 1, InFP) != 1) {
+  if (fread(&count, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of ints\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (!file_count_ok(InFP, nvals, sizeof(int))) {
-    fprintf(stderr,"Corrupt int count %d, aborting\n", nvals);
-    dgReadError = 1;
+    fprintf(stderr,"Corrupt int count %lld, aborting\n",
+	    (long long) nvals);
+    ctx->read_error = 1;
     return;
   }
 
@@ -1814,33 +1961,36 @@ void get_longs(FILE *InFP, int *n, int **v)
     if (!vals || fread(vals, sizeof(int), nvals, InFP) != (size_t) nvals) {
       fprintf(stderr,"Error reading long elements\n");
       free(vals);
-      dgReadError = 1;
+      ctx->read_error = 1;
       return;
     }
-    if (dgFlipEvents) fliplongs(nvals, vals);
+    if (ctx->flip) flip_vals(nvals, sizeof(int), vals);
     *n = nvals;
     *v = vals;
   }
 }
 
 static
-void get_floats(FILE *InFP, int *n, float **v)
+void get_floats(DG_IO_CTX *ctx, FILE *InFP, DL_SIZE *n, float **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
 
   *n = 0;
   *v = NULL;
-  if (fread(&nvals, sizeof(int), 1, InFP) != 1) {
+  if (fread(&count, sizeof(int), 1, InFP) != 1) {
     fprintf(stderr,"Error reading number of floats\n");
-    dgReadError = 1;
+    ctx->read_error = 1;
     return;
   }
 
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (!file_count_ok(InFP, nvals, sizeof(float))) {
-    fprintf(stderr,"Corrupt float count %d, aborting\n", nvals);
-    dgReadError = 1;
+    fprintf(stderr,"Corrupt float count %lld, aborting\n",
+	    (long long) nvals);
+    ctx->read_error = 1;
     return;
   }
 
@@ -1849,10 +1999,10 @@ void get_floats(FILE *InFP, int *n, float **v)
     if (!vals || fread(vals, sizeof(float), nvals, InFP) != (size_t) nvals) {
       fprintf(stderr,"Error reading float elements\n");
       free(vals);
-      dgReadError = 1;
+      ctx->read_error = 1;
       return;
     }
-    if (dgFlipEvents) flipfloats(nvals, vals);
+    if (ctx->flip) flip_vals(nvals, sizeof(float), vals);
     *n = nvals;
     *v = vals;
   }
@@ -1863,38 +2013,38 @@ void get_floats(FILE *InFP, int *n, float **v)
   -------------------------------------------------------------------*/
 
 static
-int vget_version(float *v, float *version)
+int vget_version(DG_IO_CTX *ctx, float *v, float *version)
 {
   float val;
   memcpy(&val, v, sizeof(float));
-  if (val != dgVersion) {
-    dgFlipEvents = 1;
+  if (!dg_known_version(val)) {
+    ctx->flip = 1;
     val = flipfloat(val);
-    if (val != dgVersion) {
+    if (!dg_known_version(val)) {
       /* Corrupt/unknown version.  This used to exit(-1), which killed the
          whole host process (e.g. dserv) when a single datapoint or file
          was malformed.  Signal an error to the caller instead. */
       fprintf(stderr,
 	      "Unable to read this version of data file (V %5.1f/%5.1f)\n",
 	      val, flipfloat(val));
-      dgFlipEvents = 0;
+      ctx->flip = 0;
       *version = val;
       return(-1);
     }
   }
-  else dgFlipEvents = 0;
+  else ctx->flip = 0;
   *version = val;
   return(sizeof(float));
 }
    
 
 static 
-int vget_float(float *fval, float *v)
+int vget_float(DG_IO_CTX *ctx, float *fval, float *v)
 {
   float val;
   memcpy(&val, fval, sizeof(float));
 
-  if (dgFlipEvents) val = flipfloat(val);
+  if (ctx->flip) val = flipfloat(val);
   *v = val;
   return(sizeof(float));
 }
@@ -1907,37 +2057,37 @@ int vget_char(char *cval, char *c)
 }
 
 static
-int vget_long(int *ival, int *l)
+int vget_long(DG_IO_CTX *ctx, int *ival, int *l)
 {
   int val;
   memcpy(&val, ival, sizeof(int));
 
-  if (dgFlipEvents) val = fliplong(val);
+  if (ctx->flip) val = fliplong(val);
   *l = val;
   return(sizeof(int));
 }
 
 static 
-int vget_short(short *sval, short *s)
+int vget_short(DG_IO_CTX *ctx, short *sval, short *s)
 {
   short val;
   memcpy(&val, sval, sizeof(short));
 
-  if (dgFlipEvents) val = flipshort(val);
+  if (ctx->flip) val = flipshort(val);
   *s = val;
   return(sizeof(short));
 }
 
 static 
-int vget_string(int *iptr, int *l, char **s)
+int vget_string(DG_IO_CTX *ctx, int *iptr, int *l, char **s)
 {
   int length;
   int *next = iptr+1;
-  static char *str;
+  char *str;
   
   memcpy(&length, iptr, sizeof(int));
   
-  if (dgFlipEvents) length = fliplong(length);
+  if (ctx->flip) length = fliplong(length);
   
   if (length) {
     str = (char *) malloc(length);
@@ -1953,18 +2103,20 @@ int vget_string(int *iptr, int *l, char **s)
 
 
 static 
-int vget_strings(int *iptr, int *num, char ***s)
+DL_SIZE vget_strings(DG_IO_CTX *ctx, int *iptr, DL_SIZE *num, char ***s)
 {
-  int n, i, size, sum, length;
+  int count, size, length;
+  DL_SIZE n, i, sum;
   char *next = (char *) iptr + sizeof(int);
   char **strings = NULL;
   
-  memcpy(&n, iptr, sizeof(int));
-  if (dgFlipEvents) n = fliplong(n);
+  memcpy(&count, iptr, sizeof(int));
+  if (ctx->flip) count = fliplong(count);
+  n = dg_array_count(ctx, count);
 
   if (n) strings = (char **) calloc(n, sizeof(char *));
   for (i = 0, sum = 0; i < n; i++) {
-    size = vget_string((int *) next, &length, &strings[i]);
+    size = vget_string(ctx, (int *) next, &length, &strings[i]);
     sum += size;
     next += size;
   }
@@ -1975,26 +2127,28 @@ int vget_strings(int *iptr, int *num, char ***s)
 }
 
 static
-int vget_shorts(int *n, int *nv, short **v)
+DL_SIZE vget_shorts(DG_IO_CTX *ctx, int *n, DL_SIZE *nv, short **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
   int *next = n+1;
   short *vl = (short *) next;
   short *vals = NULL;
 
-  memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  memcpy(&count, n, sizeof(int));
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (nvals) {
-    if (!(vals = (short *) calloc(nvals, sizeof(short)))) {
+    if (!(vals = (short *) dguAllocVals(ctx, nvals, sizeof(short)))) {
       fprintf(stderr,"dgutils: error allocating space for short array\n");
-      dgReadError = 1;
+      ctx->read_error = 1;
       *nv = 0; *v = NULL;
       return(sizeof(int));
     }
     memcpy(vals, vl, sizeof(short)*nvals);
 
-    if (dgFlipEvents) flipshorts(nvals, vals);
+    if (ctx->flip) flip_vals(nvals, sizeof(short), vals);
   }
 
   *nv = nvals;
@@ -2004,20 +2158,22 @@ int vget_shorts(int *n, int *nv, short **v)
 }
 
 static
-int vget_chars(int *n, int *nv, char **v)
+DL_SIZE vget_chars(DG_IO_CTX *ctx, int *n, DL_SIZE *nv, char **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
   int *next = n+1;
   char *vl = (char *) next;
   char *vals = NULL;
 
-  memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  memcpy(&count, n, sizeof(int));
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (nvals) {
-    if (!(vals = (char *) calloc(nvals, sizeof(char)))) {
+    if (!(vals = (char *) dguAllocVals(ctx, nvals, sizeof(char)))) {
       fprintf(stderr,"dgutils: error allocating space for char array\n");
-      dgReadError = 1;
+      ctx->read_error = 1;
       *nv = 0; *v = NULL;
       return(sizeof(int));
     }
@@ -2031,26 +2187,28 @@ int vget_chars(int *n, int *nv, char **v)
 }
 
 static
-int vget_longs(int *n, int *nv, int **v)
+DL_SIZE vget_longs(DG_IO_CTX *ctx, int *n, DL_SIZE *nv, int **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
   int *next = n+1;
   int *vl = (int *) next;
   int *vals = NULL;
 
-  memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  memcpy(&count, n, sizeof(int));
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (nvals) {
-    if (!(vals = (int *) calloc(nvals, sizeof(int)))) {
+    if (!(vals = (int *) dguAllocVals(ctx, nvals, sizeof(int)))) {
       fprintf(stderr,"dgutils: error allocating space for int array\n");
-      dgReadError = 1;
+      ctx->read_error = 1;
       *nv = 0; *v = NULL;
       return(sizeof(int));
     }
     memcpy(vals, vl, sizeof(int)*nvals);
 
-    if (dgFlipEvents) fliplongs(nvals, vals);
+    if (ctx->flip) flip_vals(nvals, sizeof(int), vals);
   }
 
   *nv = nvals;
@@ -2060,26 +2218,28 @@ int vget_longs(int *n, int *nv, int **v)
 }
 
 static
-int vget_floats(int *n, int *nv, float **v)
+DL_SIZE vget_floats(DG_IO_CTX *ctx, int *n, DL_SIZE *nv, float **v)
 {
-  int nvals;
+  int count;
+  DL_SIZE nvals;
   int *next = n+1;
   float *vl = (float *) next;
   float *vals = NULL;
 
-  memcpy(&nvals, n, sizeof(int));
-  if (dgFlipEvents) nvals = fliplong(nvals);
+  memcpy(&count, n, sizeof(int));
+  if (ctx->flip) count = fliplong(count);
+  nvals = dg_array_count(ctx, count);
 
   if (nvals) {
-    if (!(vals = (float *) calloc(nvals, sizeof(float)))) {
+    if (!(vals = (float *) dguAllocVals(ctx, nvals, sizeof(float)))) {
       fprintf(stderr,"dgutils: error allocating space for float array\n");
-      dgReadError = 1;
+      ctx->read_error = 1;
       *nv = 0; *v = NULL;
       return(sizeof(int));
     }
     memcpy(vals, vl, sizeof(float)*nvals);
 
-    if (dgFlipEvents) flipfloats(nvals, vals);
+    if (ctx->flip) flip_vals(nvals, sizeof(float), vals);
   }
 
   *nv = nvals;
@@ -2094,28 +2254,29 @@ int vget_floats(int *n, int *nv, float **v)
   -----           File to Structure Transfer Functions           -----
   -------------------------------------------------------------------*/
 
-int dguFileToStruct(FILE *InFP, DYN_GROUP *dg)
+int dguFileToStructCtx(DG_IO_CTX *ctx, FILE *InFP, DYN_GROUP *dg)
 {
   int c, status = DF_OK;
   float version;
 
-  dgReadError = 0;
+  ctx->read_error = 0;
+  ctx->next_count = 0;
 
   if (!confirm_magic_number(InFP)) {
     //    fprintf(stderr,"dgutils: file not recognized as dg format\n");
     return(0);
   }
 
-  while(status == DF_OK && !dgReadError && (c = getc(InFP)) != EOF) {
+  while(status == DF_OK && !ctx->read_error && (c = getc(InFP)) != EOF) {
     switch (c) {
     case END_STRUCT:
       status = DF_FINISHED;
       break;
     case DG_VERSION_TAG:
-      get_version(InFP, &version);
+      get_version(ctx, InFP, &version);
       break;
     case DG_BEGIN_TAG:
-      status = dguFileToDynGroup(InFP, dg);
+      status = dguFileToDynGroupCtx(ctx, InFP, dg);
       break;
     default:
       fprintf(stderr,"unknown event type %d\n", c);
@@ -2123,15 +2284,15 @@ int dguFileToStruct(FILE *InFP, DYN_GROUP *dg)
       break;
     }
   }
-  if (status == DF_ABORT || dgReadError) return(DF_ABORT);
+  if (status == DF_ABORT || ctx->read_error) return(DF_ABORT);
   return(DF_OK);
 }
 
-int dguFileToDynGroup(FILE *InFP, DYN_GROUP *dg)
+int dguFileToDynGroupCtx(DG_IO_CTX *ctx, FILE *InFP, DYN_GROUP *dg)
 {
   int n = 0, nlists, c, status = DF_OK;
 
-  while(status == DF_OK && !dgReadError && (c = getc(InFP)) != EOF) {
+  while(status == DF_OK && !ctx->read_error && (c = getc(InFP)) != EOF) {
     switch (c) {
     case END_STRUCT:
       status = DF_FINISHED;
@@ -2140,19 +2301,19 @@ int dguFileToDynGroup(FILE *InFP, DYN_GROUP *dg)
       {
 	char *string;
 	int n;
-	get_string(InFP, &n, &string);
+	get_string(ctx, InFP, &n, &string);
 	strncpy(DYN_GROUP_NAME(dg), string, DYN_GROUP_NAME_SIZE-1);
 	free((void *) string);
       }
       break;
     case DG_NLISTS_TAG:
-      get_long(InFP, (int *) &nlists);
+      get_long(ctx, InFP, (int *) &nlists);
       break;
     case DG_DYNLIST_TAG:
       {
 	DYN_LIST *dl = (DYN_LIST *) calloc(1, sizeof(DYN_LIST));
 	DYN_LIST_INCREMENT(dl) = 10;
-	status = dguFileToDynList(InFP, dl);
+	status = dguFileToDynListCtx(ctx, InFP, dl);
 	dfuAddDynGroupExistingList(dg, DYN_LIST_NAME(dl), dl);
 	n++;
       }
@@ -2163,24 +2324,91 @@ int dguFileToDynGroup(FILE *InFP, DYN_GROUP *dg)
       break;
     }
   }
-  if (status == DF_ABORT || dgReadError) return(DF_ABORT);
+  if (status == DF_ABORT || ctx->read_error) return(DF_ABORT);
   return(DF_OK);
 }
 
-int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
+/*
+ * A dictionary encoded list is stored as its string table followed by
+ * the codes; the readers hold on to the table until the codes arrive.
+ * The codes are copied, so the caller still owns them.
+ */
+static void dgu_free_strings(DL_SIZE n, char **strings)
+{
+  DL_SIZE i;
+  if (!strings) return;
+  for (i = 0; i < n; i++) if (strings[i]) free(strings[i]);
+  free(strings);
+}
+
+static int dgu_set_dict(DYN_LIST *dl, DL_SIZE nstrings, char **strings,
+			DL_SIZE n, int *codes)
+{
+  DYN_DICT *dict = NULL;
+
+  if (nstrings <= INT_MAX) dict = dfuCreateDynDict((int) nstrings, strings);
+  if (!dict) {
+    dgu_free_strings(nstrings, strings);
+    return 0;
+  }
+  if (!dfuSetDynListDict(dl, dict, n, codes)) {
+    dfuReleaseDynDict(dict);
+    return 0;
+  }
+  return 1;
+}
+
+int dguFileToDynListCtx(DG_IO_CTX *ctx, FILE *InFP, DYN_LIST *dl)
 {
   int c, status = DF_OK;
+  char **dict_strings = NULL;	/* table waiting for its codes */
+  DL_SIZE dict_n = -1;
 
-  while(status == DF_OK && !dgReadError && (c = getc(InFP)) != EOF) {
+  while(status == DF_OK && !ctx->read_error && (c = getc(InFP)) != EOF) {
     switch (c) {
     case END_STRUCT:
       status = DF_FINISHED;
       break;
     case DL_INCREMENT_TAG:
-      get_long(InFP, (int *) &DYN_LIST_INCREMENT(dl));
+      {
+	int increment;
+	get_long(ctx, InFP, &increment);
+	DYN_LIST_INCREMENT(dl) = increment;
+      }
+      break;
+    case DL_NVALS64_TAG:
+      if (fread(&ctx->next_count, sizeof(DL_SIZE), 1, InFP) != 1) {
+	ctx->read_error = 1;
+	break;
+      }
+      if (ctx->flip) ctx->next_count = flipsize(ctx->next_count);
       break;
     case DL_FLAGS_TAG:
-      get_long(InFP, (int *) &DYN_LIST_FLAGS(dl));
+      {
+	int flags;
+	get_long(ctx, InFP, &flags);
+	DYN_LIST_FLAGS(dl) = (flags & ~DL_STORAGE_FLAGS) |
+	  (DYN_LIST_FLAGS(dl) & DL_STORAGE_FLAGS);
+      }
+      break;
+    case DL_DICT_STRINGS_TAG:
+      if (dict_n >= 0) { status = DF_ABORT; break; }
+      get_strings(ctx, InFP, &dict_n, &dict_strings);
+      ctx->next_count = 0;
+      break;
+    case DL_DICT_CODES_TAG:
+      {
+	int *data;
+	DL_SIZE n;
+	if (dict_n < 0) { status = DF_ABORT; break; }
+	get_longs(ctx, InFP, &n, &data);
+	ctx->next_count = 0;
+	if (ctx->read_error ||
+	    !dgu_set_dict(dl, dict_n, dict_strings, n, data)) status = DF_ABORT;
+	dict_strings = NULL;
+	dict_n = -1;
+	if (data) free(data);
+      }
       break;
     case DL_DATA_TAG:
       break;
@@ -2188,7 +2416,7 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
       {
 	char *string;
 	int n;
-	get_string(InFP, &n, &string);
+	get_string(ctx, InFP, &n, &string);
 	strncpy(DYN_LIST_NAME(dl), string, DYN_LIST_NAME_SIZE-1);
 	free((void *) string);
       }
@@ -2196,8 +2424,9 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
     case DL_STRING_DATA_TAG:
       {
 	char **data;
-	int n;
-	get_strings(InFP, &n, &data);
+	DL_SIZE n;
+	get_strings(ctx, InFP, &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_STRING;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
@@ -2211,8 +2440,9 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
     case DL_FLOAT_DATA_TAG:
       {
 	float *data;
-	int n;
-	get_floats(InFP, &n, &data);
+	DL_SIZE n;
+	get_floats(ctx, InFP, &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_FLOAT;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
@@ -2223,8 +2453,9 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
     case DL_LONG_DATA_TAG:
       {
 	int *data;
-	int n;
-	get_longs(InFP, &n, &data);
+	DL_SIZE n;
+	get_longs(ctx, InFP, &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_LONG;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
@@ -2235,8 +2466,9 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
     case DL_SHORT_DATA_TAG:
       {
 	short *data;
-	int n;
-	get_shorts(InFP, &n, &data);
+	DL_SIZE n;
+	get_shorts(ctx, InFP, &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_SHORT;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
@@ -2246,8 +2478,9 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
     case DL_CHAR_DATA_TAG:
       {
 	char *data;
-	int n;
-	get_chars(InFP, &n, &data);
+	DL_SIZE n;
+	get_chars(ctx, InFP, &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_CHAR;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
@@ -2258,16 +2491,21 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
     case DL_LIST_DATA_TAG:
       {
 	DYN_LIST *newlist, **vals;
-	int n, i;
+	DL_SIZE n, i;
 
 	/* Figure out how many there are */
-	get_long(InFP, (int *) &n);
+	{
+	  int count;
+	  get_long(ctx, InFP, &count);
+	  n = dg_array_count(ctx, count);
+	  ctx->next_count = 0;
+	}
 
 	/* Reject a corrupt count: a sublist needs at least one byte (its
 	   DL_SUBLIST_TAG), so n can't exceed the bytes left in the file. */
-	if (dgReadError || !file_count_ok(InFP, n, 1)) {
-	  fprintf(stderr,"Corrupt list count %d, aborting\n", n);
-	  dgReadError = 1;
+	if (ctx->read_error || !file_count_ok(InFP, n, 1)) {
+	  fprintf(stderr,"Corrupt list count %lld, aborting\n", (long long) n);
+	  ctx->read_error = 1;
 	  status = DF_ABORT;
 	  break;
 	}
@@ -2292,9 +2530,9 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
 	  }
 	  newlist = (DYN_LIST *) calloc(1, sizeof(DYN_LIST));
 	  DYN_LIST_INCREMENT(newlist) = 10;
-	  status = dguFileToDynList(InFP, newlist);
+	  status = dguFileToDynListCtx(ctx, InFP, newlist);
 	  vals[i] = newlist;
-	  if (status == DF_ABORT || dgReadError) { DYN_LIST_N(dl) = i + 1; break; }
+	  if (status == DF_ABORT || ctx->read_error) { DYN_LIST_N(dl) = i + 1; break; }
 	}
 	if (status == DF_ABORT) break;
       }
@@ -2305,7 +2543,8 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
       break;
     }
   }
-  if (status == DF_ABORT || dgReadError) return(DF_ABORT);
+  if (dict_strings) dgu_free_strings(dict_n, dict_strings);
+  if (status == DF_ABORT || ctx->read_error) return(DF_ABORT);
   return(DF_OK);
 }
 
@@ -2327,62 +2566,67 @@ int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
  *   Returns 1 if the array fits within the bytes remaining in the buffer,
  *   0 otherwise.  Peeks the count without advancing the read index.
  */
-static long bd_remaining(BUF_DATA *bdata)
+static DL_SIZE bd_remaining(BUF_DATA *bdata)
 {
-  return (long) BD_SIZE(bdata) - (long) BD_INDEX(bdata);
+  return BD_SIZE(bdata) - BD_INDEX(bdata);
 }
 
 /* true if at least nbytes remain before the end of the buffer */
-static int bd_have(BUF_DATA *bdata, long nbytes)
+static int bd_have(BUF_DATA *bdata, DL_SIZE nbytes)
 {
   return bd_remaining(bdata) >= nbytes;
 }
 
-static int bd_array_fits(BUF_DATA *bdata, int elemsize)
+static int bd_array_fits(DG_IO_CTX *ctx, BUF_DATA *bdata, int elemsize)
 {
-  long remaining = bd_remaining(bdata);
-  int cnt;
-  if (remaining < (long) sizeof(int)) return 0;
-  memcpy(&cnt, BD_DATA(bdata), sizeof(int));
-  if (dgFlipEvents) cnt = fliplong(cnt);
+  DL_SIZE remaining = bd_remaining(bdata);
+  DL_SIZE cnt;
+  int count;
+  if (remaining < (DL_SIZE) sizeof(int)) return 0;
+  memcpy(&count, BD_DATA(bdata), sizeof(int));
+  if (ctx->flip) count = fliplong(count);
+  cnt = dg_array_count(ctx, count);
   if (cnt < 0) return 0;
   /* each element needs elemsize bytes after the 4-byte count */
-  if ((long) cnt * (long) elemsize > remaining - (long) sizeof(int)) return 0;
+  if (cnt > (remaining - (DL_SIZE) sizeof(int)) / elemsize) return 0;
   return 1;
 }
 
 /* A DL_STRING_DATA_TAG array is: [int count][ (int len)(len bytes) ]*count.
    Walk it entirely within the buffer to reject a truncated/corrupt run
    before vget_strings() does unbounded per-string malloc/memcpy. */
-static int bd_string_array_fits(BUF_DATA *bdata)
+static int bd_string_array_fits(DG_IO_CTX *ctx, BUF_DATA *bdata)
 {
-  long remaining = bd_remaining(bdata);
-  long off = 0;
-  int i, count, len;
-  if (remaining < (long) sizeof(int)) return 0;
+  DL_SIZE remaining = bd_remaining(bdata);
+  DL_SIZE off = 0, i, n;
+  int count, len;
+  if (remaining < (DL_SIZE) sizeof(int)) return 0;
   memcpy(&count, BD_DATA(bdata), sizeof(int));
-  if (dgFlipEvents) count = fliplong(count);
-  if (count < 0) return 0;
+  if (ctx->flip) count = fliplong(count);
+  n = dg_array_count(ctx, count);
+  if (n < 0) return 0;
   off = sizeof(int);
-  for (i = 0; i < count; i++) {
-    if (off + (long) sizeof(int) > remaining) return 0;
+  for (i = 0; i < n; i++) {
+    if (off + (DL_SIZE) sizeof(int) > remaining) return 0;
     memcpy(&len, BD_DATA(bdata) + off, sizeof(int));
-    if (dgFlipEvents) len = fliplong(len);
+    if (ctx->flip) len = fliplong(len);
     if (len < 0) return 0;
-    off += (long) sizeof(int) + (long) len;
+    off += (DL_SIZE) sizeof(int) + len;
     if (off > remaining) return 0;
   }
   return 1;
 }
 
-int dguBufferToStruct(unsigned char *vbuf, int bufsize, DYN_GROUP *dg)
+int dguBufferToStructCtx(DG_IO_CTX *ctx, unsigned char *vbuf, DL_SIZE bufsize,
+			 DYN_GROUP *dg)
 {
   int c, status = DF_OK;
   int advance_bytes = 0;
   float version;
   BUF_DATA *bdata = (BUF_DATA *) calloc(1, sizeof(BUF_DATA));
 
-  dgReadError = 0;
+  ctx->read_error = 0;
+  ctx->next_count = 0;
 
   if (!vconfirm_magic_number((char *)vbuf)) {
     free(bdata);
@@ -2393,7 +2637,8 @@ int dguBufferToStruct(unsigned char *vbuf, int bufsize, DYN_GROUP *dg)
   BD_INDEX(bdata) = DF_MAGIC_NUMBER_SIZE;
   BD_SIZE(bdata) = bufsize;
 
-  while (status == DF_OK && !dgReadError && BD_INDEX(bdata) < BD_SIZE(bdata)) {
+  while (status == DF_OK && !ctx->read_error &&
+	 BD_INDEX(bdata) < BD_SIZE(bdata)) {
     BD_INCINDEX(bdata, advance_bytes);
     advance_bytes = 0;
     c = BD_GETC(bdata);
@@ -2404,13 +2649,13 @@ int dguBufferToStruct(unsigned char *vbuf, int bufsize, DYN_GROUP *dg)
     case DG_VERSION_TAG:
       if (!bd_have(bdata, sizeof(float))) { status = DF_ABORT; break; }
       {
-	int vbytes = vget_version((float *) BD_DATA(bdata), &version);
+	int vbytes = vget_version(ctx, (float *) BD_DATA(bdata), &version);
 	if (vbytes < 0) { status = DF_ABORT; break; }
 	advance_bytes += vbytes;
       }
       break;
     case DG_BEGIN_TAG:
-      status = dguBufferToDynGroup(bdata, dg);
+      status = dguBufferToDynGroup(ctx, bdata, dg);
       break;
     default:
       fprintf(stderr,"unknown event type %d\n", c);
@@ -2420,16 +2665,25 @@ int dguBufferToStruct(unsigned char *vbuf, int bufsize, DYN_GROUP *dg)
   }
   free(bdata);
 
-  if (status == DF_ABORT || dgReadError) return(DF_ABORT);
+  if (status == DF_ABORT || ctx->read_error) return(DF_ABORT);
   return(DF_OK);
 }
 
-static int dguBufferToDynGroup(BUF_DATA *bdata, DYN_GROUP *dg)
+static int dguBufferToDynGroup(DG_IO_CTX *ctx, BUF_DATA *bdata, DYN_GROUP *dg)
 {
   int n = 0, c, status = DF_OK, advance_bytes = 0;
   int nlists;
 
-  while (status == DF_OK && !dgReadError && !BD_EOF(bdata)) {
+  /* size a fresh arena's chunks from the data still to be read, since
+     headers and values together take roughly twice the buffer space */
+  if ((ctx->arena = DYN_GROUP_ARENA(dg)) && !ctx->arena->chunks) {
+    DL_SIZE want = 2 * bd_remaining(bdata);
+    if (want < 4096) want = 4096;
+    if (want > 16*1024*1024) want = 16*1024*1024;
+    ctx->arena->chunksize = (int) want;
+  }
+
+  while (status == DF_OK && !ctx->read_error && !BD_EOF(bdata)) {
     BD_INCINDEX(bdata, advance_bytes);
     advance_bytes = 0;
     c = BD_GETC(bdata);
@@ -2441,8 +2695,8 @@ static int dguBufferToDynGroup(BUF_DATA *bdata, DYN_GROUP *dg)
       {
 	char *string;
 	int n;
-	if (!bd_array_fits(bdata, 1)) { status = DF_ABORT; break; }
-	advance_bytes += vget_string((int *) BD_DATA(bdata),
+	if (!bd_array_fits(ctx, bdata, 1)) { status = DF_ABORT; break; }
+	advance_bytes += vget_string(ctx, (int *) BD_DATA(bdata),
 				     &n, &string);
 	strncpy(DYN_GROUP_NAME(dg), string, DYN_GROUP_NAME_SIZE-1);
 	free((void *) string);
@@ -2450,13 +2704,12 @@ static int dguBufferToDynGroup(BUF_DATA *bdata, DYN_GROUP *dg)
       break;
     case DG_NLISTS_TAG:
       if (!bd_have(bdata, sizeof(int))) { status = DF_ABORT; break; }
-      advance_bytes += vget_long((int *) BD_DATA(bdata), &nlists);
+      advance_bytes += vget_long(ctx, (int *) BD_DATA(bdata), &nlists);
       break;
     case DG_DYNLIST_TAG:
       {
-	DYN_LIST *dl = (DYN_LIST *) calloc(1, sizeof(DYN_LIST));
-	DYN_LIST_INCREMENT(dl) = 10;
-	status = dguBufferToDynList(bdata, dl);
+	DYN_LIST *dl = dguNewDynList(ctx);
+	status = dguBufferToDynList(ctx, bdata, dl);
 	dfuAddDynGroupExistingList(dg, DYN_LIST_NAME(dl), dl);
 	n++;
       }
@@ -2467,16 +2720,41 @@ static int dguBufferToDynGroup(BUF_DATA *bdata, DYN_GROUP *dg)
       break;
     }
   }
-  if (status == DF_ABORT || dgReadError) return(DF_ABORT);
+  ctx->arena = NULL;
+  if (status == DF_ABORT || ctx->read_error) return(DF_ABORT);
   return(DF_OK);
 }
 
-static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
+/*
+ * dguNewDynList / dguAllocVals
+ *
+ *   Allocate list headers and numeric data for the buffer reader, from
+ *   the arena of the group being read if it has one.  Arena data does
+ *   not belong to the list, so lists built from it are flagged DL_VIEW.
+ */
+static DYN_LIST *dguNewDynList(DG_IO_CTX *ctx)
+{
+  DYN_LIST *dl;
+  if (ctx->arena) dl = dfuArenaNewDynList(ctx->arena);
+  else dl = (DYN_LIST *) calloc(1, sizeof(DYN_LIST));
+  DYN_LIST_INCREMENT(dl) = 10;
+  return dl;
+}
+
+static void *dguAllocVals(DG_IO_CTX *ctx, DL_SIZE n, int size)
+{
+  if (ctx->arena) return dfuArenaAlloc(ctx->arena, n*size);
+  return calloc(n, size);
+}
+
+static int dguBufferToDynList(DG_IO_CTX *ctx, BUF_DATA *bdata, DYN_LIST *dl)
 {
   int c, status = DF_OK;
-  int advance_bytes = 0;
+  DL_SIZE advance_bytes = 0;
+  char **dict_strings = NULL;	/* table waiting for its codes */
+  DL_SIZE dict_n = -1;
 
-  while (status == DF_OK && !dgReadError && !BD_EOF(bdata)) {
+  while (status == DF_OK && !ctx->read_error && !BD_EOF(bdata)) {
     BD_INCINDEX(bdata, advance_bytes);
     advance_bytes = 0;
     c = BD_GETC(bdata);
@@ -2486,13 +2764,48 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
       break;
     case DL_INCREMENT_TAG:
       if (!bd_have(bdata, sizeof(int))) { status = DF_ABORT; break; }
-      advance_bytes += vget_long((int *) BD_DATA(bdata),
-				 (int *) &DYN_LIST_INCREMENT(dl));
+      {
+	int increment;
+	advance_bytes += vget_long(ctx, (int *) BD_DATA(bdata), &increment);
+	DYN_LIST_INCREMENT(dl) = increment;
+      }
+      break;
+    case DL_NVALS64_TAG:
+      if (!bd_have(bdata, sizeof(DL_SIZE))) { status = DF_ABORT; break; }
+      memcpy(&ctx->next_count, BD_DATA(bdata), sizeof(DL_SIZE));
+      if (ctx->flip) ctx->next_count = flipsize(ctx->next_count);
+      advance_bytes += sizeof(DL_SIZE);
       break;
     case DL_FLAGS_TAG:
       if (!bd_have(bdata, sizeof(int))) { status = DF_ABORT; break; }
-      advance_bytes += vget_long((int *) BD_DATA(bdata),
-				 (int *) &DYN_LIST_FLAGS(dl));
+      {
+	int flags;
+	advance_bytes += vget_long(ctx, (int *) BD_DATA(bdata), &flags);
+	DYN_LIST_FLAGS(dl) = (flags & ~DL_STORAGE_FLAGS) |
+	  (DYN_LIST_FLAGS(dl) & DL_STORAGE_FLAGS);
+      }
+      break;
+    case DL_DICT_STRINGS_TAG:
+      if (dict_n >= 0) { status = DF_ABORT; break; }
+      if (!bd_string_array_fits(ctx, bdata)) { status = DF_ABORT; break; }
+      advance_bytes += vget_strings(ctx, (int *) BD_DATA(bdata), &dict_n,
+				    &dict_strings);
+      ctx->next_count = 0;
+      break;
+    case DL_DICT_CODES_TAG:
+      {
+	int *data;
+	DL_SIZE n;
+	if (dict_n < 0) { status = DF_ABORT; break; }
+	if (!bd_array_fits(ctx, bdata, sizeof(int))) { status = DF_ABORT; break; }
+	advance_bytes += vget_longs(ctx, (int *) BD_DATA(bdata), &n, &data);
+	ctx->next_count = 0;
+	if (ctx->read_error ||
+	    !dgu_set_dict(dl, dict_n, dict_strings, n, data)) status = DF_ABORT;
+	dict_strings = NULL;
+	dict_n = -1;
+	if (data && !ctx->arena) free(data);
+      }
       break;
     case DL_DATA_TAG:
       break;
@@ -2500,8 +2813,8 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
       {
 	char *string;
 	int n;
-	if (!bd_array_fits(bdata, 1)) { status = DF_ABORT; break; }
-	advance_bytes += vget_string((int *) BD_DATA(bdata),
+	if (!bd_array_fits(ctx, bdata, 1)) { status = DF_ABORT; break; }
+	advance_bytes += vget_string(ctx, (int *) BD_DATA(bdata),
 				     &n, &string);
 	strncpy(DYN_LIST_NAME(dl), string, DYN_LIST_NAME_SIZE-1);
 	free((void *) string);
@@ -2510,11 +2823,12 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
     case DL_STRING_DATA_TAG:
       {
 	char **data;
-	int n;
+	DL_SIZE n;
 	/* validate the whole string run fits before the unbounded reads
 	   inside vget_strings() */
-	if (!bd_string_array_fits(bdata)) { status = DF_ABORT; break; }
-	advance_bytes += vget_strings((int *) BD_DATA(bdata), &n, &data);
+	if (!bd_string_array_fits(ctx, bdata)) { status = DF_ABORT; break; }
+	advance_bytes += vget_strings(ctx, (int *) BD_DATA(bdata), &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_STRING;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
@@ -2529,65 +2843,78 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
     case DL_FLOAT_DATA_TAG:
       {
 	float *data;
-	int n;
-	if (!bd_array_fits(bdata, sizeof(float))) { status = DF_ABORT; break; }
-	advance_bytes += vget_floats((int *) BD_DATA(bdata), &n, &data);
+	DL_SIZE n;
+	if (!bd_array_fits(ctx, bdata, sizeof(float))) { status = DF_ABORT; break; }
+	advance_bytes += vget_floats(ctx, (int *) BD_DATA(bdata), &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_FLOAT;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
 	if (n) DYN_LIST_VALS(dl) = data;
 	else DYN_LIST_VALS(dl) = NULL;
+	if (n && ctx->arena) DYN_LIST_FLAGS(dl) |= DL_VIEW;
       }
       break;
     case DL_LONG_DATA_TAG:
       {
 	int *data;
-	int n;
-	if (!bd_array_fits(bdata, sizeof(int))) { status = DF_ABORT; break; }
-	advance_bytes += vget_longs((int *) BD_DATA(bdata), &n, &data);
+	DL_SIZE n;
+	if (!bd_array_fits(ctx, bdata, sizeof(int))) { status = DF_ABORT; break; }
+	advance_bytes += vget_longs(ctx, (int *) BD_DATA(bdata), &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_LONG;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
 	if (n) DYN_LIST_VALS(dl) = data;
 	else DYN_LIST_VALS(dl) = NULL;
+	if (n && ctx->arena) DYN_LIST_FLAGS(dl) |= DL_VIEW;
       }
       break;
     case DL_SHORT_DATA_TAG:
       {
 	short *data;
-	int n;
-	if (!bd_array_fits(bdata, sizeof(short))) { status = DF_ABORT; break; }
-	advance_bytes += vget_shorts((int *) BD_DATA(bdata), &n, &data);
+	DL_SIZE n;
+	if (!bd_array_fits(ctx, bdata, sizeof(short))) { status = DF_ABORT; break; }
+	advance_bytes += vget_shorts(ctx, (int *) BD_DATA(bdata), &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_SHORT;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
 	DYN_LIST_VALS(dl) = data;
+	if (n && ctx->arena) DYN_LIST_FLAGS(dl) |= DL_VIEW;
       }
       break;
     case DL_CHAR_DATA_TAG:
       {
 	char *data;
-	int n;
-	if (!bd_array_fits(bdata, sizeof(char))) { status = DF_ABORT; break; }
-	advance_bytes += vget_chars((int *) BD_DATA(bdata), &n, &data);
+	DL_SIZE n;
+	if (!bd_array_fits(ctx, bdata, sizeof(char))) { status = DF_ABORT; break; }
+	advance_bytes += vget_chars(ctx, (int *) BD_DATA(bdata), &n, &data);
+	ctx->next_count = 0;
 	DYN_LIST_DATATYPE(dl) = DF_CHAR;
 	DYN_LIST_MAX(dl) = n;
 	DYN_LIST_N(dl) = n;
 	if (n) DYN_LIST_VALS(dl) = data;
 	else DYN_LIST_VALS(dl) = NULL;
+	if (n && ctx->arena) DYN_LIST_FLAGS(dl) |= DL_VIEW;
       }
       break;
     case DL_LIST_DATA_TAG:
       {
 	DYN_LIST *newlist, **vals;
-	int n, i;
+	DL_SIZE n, i;
 
 	/* A list of sublists needs at least one byte per sublist (the
 	   DL_SUBLIST_TAG); reject a count that can't fit in the buffer. */
-	if (!bd_array_fits(bdata, 1)) { status = DF_ABORT; break; }
+	if (!bd_array_fits(ctx, bdata, 1)) { status = DF_ABORT; break; }
 
 	/* Figure out how many there are */
-	advance_bytes = vget_long((int *) BD_DATA(bdata), (int *) &n);
+	{
+	  int count;
+	  advance_bytes = vget_long(ctx, (int *) BD_DATA(bdata), &count);
+	  n = dg_array_count(ctx, count);
+	  ctx->next_count = 0;
+	}
 	BD_INCINDEX(bdata, advance_bytes);
 	advance_bytes = 0;
 
@@ -2598,8 +2925,11 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
 	DYN_LIST_INCREMENT(dl) = 10;
 	DYN_LIST_MAX(dl) = n ? n : 1;
 	DYN_LIST_N(dl) = n;
-	DYN_LIST_VALS(dl) =
-	  (DYN_LIST **) calloc(DYN_LIST_MAX(dl), sizeof(DYN_LIST *));
+	DYN_LIST_VALS(dl) = dguAllocVals(ctx, DYN_LIST_MAX(dl), sizeof(DYN_LIST *));
+	if (ctx->arena) {
+	  memset(DYN_LIST_VALS(dl), 0, DYN_LIST_MAX(dl)*sizeof(DYN_LIST *));
+	  DYN_LIST_FLAGS(dl) |= DL_VIEW;
+	}
 	vals = (DYN_LIST **) DYN_LIST_VALS(dl);
 
 	/* Now fill up the list of lists by recursively calling this func.
@@ -2609,9 +2939,8 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
 	  if (BD_EOF(bdata)) { DYN_LIST_N(dl) = i; status = DF_ABORT; break; }
 	  c = BD_GETC(bdata);
 	  if (c != DL_SUBLIST_TAG) { DYN_LIST_N(dl) = i; status = DF_ABORT; break; }
-	  newlist = (DYN_LIST *) calloc(1, sizeof(DYN_LIST));
-	  DYN_LIST_INCREMENT(newlist) = 10;
-	  status = dguBufferToDynList(bdata, newlist);
+	  newlist = dguNewDynList(ctx);
+	  status = dguBufferToDynList(ctx, bdata, newlist);
 	  vals[i] = newlist;
 	  if (status == DF_ABORT) { DYN_LIST_N(dl) = i + 1; break; }
 	}
@@ -2624,7 +2953,8 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
       break;
     }
   }
-  if (status == DF_ABORT || dgReadError) return(DF_ABORT);
+  if (dict_strings) dgu_free_strings(dict_n, dict_strings);
+  if (status == DF_ABORT || ctx->read_error) return(DF_ABORT);
   return(DF_OK);
 }
 
@@ -2634,71 +2964,77 @@ static int dguBufferToDynList(BUF_DATA *bdata, DYN_LIST *dl)
   -----                    Output Functions                      -----
   -------------------------------------------------------------------*/
 
-void dguBufferToAscii(unsigned char *vbuf, int bufsize, FILE *OutFP)
+void dguBufferToAsciiCtx(DG_IO_CTX *ctx, unsigned char *vbuf, DL_SIZE bufsize,
+			 FILE *OutFP)
 {
   int c, dtype;
-  int i, advance_bytes = 0;
+  DL_SIZE i;
+  int advance_bytes = 0;
   
-  dgPushStruct(DG_TOP_LEVEL, "DG_TOP_LEVEL");
+  dgPushStructCtx(ctx, DG_TOP_LEVEL, "DG_TOP_LEVEL");
 
   if (!vconfirm_magic_number((char *)vbuf)) {
     fprintf(stderr,"dgutils: file not recognized as dg format\n");
-    dgPopStruct();
+    dgPopStructCtx(ctx);
     return;
   }
 
   for (i = DG_MAGIC_NUMBER_SIZE; i < bufsize; i+=advance_bytes) {
     c = vbuf[i++];
     if (c == END_STRUCT) {
-      fprintf(OutFP, "END:   %s\n", dgGetCurrentStructName());
-      dgPopStruct();
+      fprintf(OutFP, "END:   %s\n", dgGetCurrentStructNameCtx(ctx));
+      dgPopStructCtx(ctx);
       advance_bytes = 0;
       continue;
     }
-    switch (dtype = dgGetDataType(c)) {
+    switch (dtype = dgGetDataTypeCtx(ctx, c)) {
     case DF_STRUCTURE:
-      fprintf(OutFP, "BEGIN: %s\n", dgGetTagName(c));
-      dgPushStruct(dgGetStructureType(c), dgGetTagName(c));
+      fprintf(OutFP, "BEGIN: %s\n", dgGetTagNameCtx(ctx, c));
+      dgPushStructCtx(ctx, dgGetStructureTypeCtx(ctx, c),
+		      dgGetTagNameCtx(ctx, c));
       advance_bytes = 0;
       break;
     case DF_VERSION:
-      advance_bytes = vread_version((float *) &vbuf[i], OutFP);
+      advance_bytes = vread_version(ctx, (float *) &vbuf[i], OutFP);
       break;
     case DF_VOID_ARRAY:
       advance_bytes = 0;
       break;
     case DF_FLAG:
-      advance_bytes = vread_flag(c, OutFP);
+      advance_bytes = vread_flag(ctx, c, OutFP);
       break;
     case DF_CHAR:
-      advance_bytes = vread_char(c, (char *) &vbuf[i], OutFP);
+      advance_bytes = vread_char(ctx, c, (char *) &vbuf[i], OutFP);
       break;
     case DF_LONG:
-      advance_bytes = vread_long(c, (int *) &vbuf[i], OutFP);
+      advance_bytes = vread_long(ctx, c, (int *) &vbuf[i], OutFP);
+      break;
+    case DF_SIZE_T:
+      advance_bytes = vread_size(ctx, c, (DL_SIZE *) &vbuf[i], OutFP);
       break;
     case DF_SHORT:
-      advance_bytes = vread_short(c, (short *) &vbuf[i], OutFP);
+      advance_bytes = vread_short(ctx, c, (short *) &vbuf[i], OutFP);
       break;
     case DF_FLOAT:
-      advance_bytes = vread_float(c, (float *) &vbuf[i], OutFP);
+      advance_bytes = vread_float(ctx, c, (float *) &vbuf[i], OutFP);
       break;
     case DF_STRING:
-      advance_bytes = vread_string(c, (int *) &vbuf[i], OutFP);
+      advance_bytes = vread_string(ctx, c, (int *) &vbuf[i], OutFP);
       break;
     case DF_STRING_ARRAY:
-      advance_bytes = vread_strings(c, (int *) &vbuf[i], OutFP);
+      advance_bytes = vread_strings(ctx, c, (int *) &vbuf[i], OutFP);
       break;
     case DF_FLOAT_ARRAY:
-      advance_bytes = vread_floats(c, (int *) &vbuf[i], OutFP);
+      advance_bytes = vread_floats(ctx, c, (int *) &vbuf[i], OutFP);
       break;
     case DF_LONG_ARRAY:
-      advance_bytes = vread_longs(c, (int *) &vbuf[i], OutFP);
+      advance_bytes = vread_longs(ctx, c, (int *) &vbuf[i], OutFP);
       break;
     case DF_SHORT_ARRAY:
-      advance_bytes = vread_shorts(c, (int *) &vbuf[i], OutFP);
+      advance_bytes = vread_shorts(ctx, c, (int *) &vbuf[i], OutFP);
       break;
     case DF_LIST_ARRAY:
-      advance_bytes = vread_long(c, (int *) &vbuf[i], OutFP);
+      advance_bytes = vread_long(ctx, c, (int *) &vbuf[i], OutFP);
       break;
     default:
       fprintf(stderr,"unknown event type %d\n", c);
@@ -2707,11 +3043,11 @@ void dguBufferToAscii(unsigned char *vbuf, int bufsize, FILE *OutFP)
   }
 }
 
-void dguFileToAscii(FILE *InFP, FILE *OutFP)
+void dguFileToAsciiCtx(DG_IO_CTX *ctx, FILE *InFP, FILE *OutFP)
 {
   int c, dtype;
   
-  dgPushStruct(DG_TOP_LEVEL, "DG_TOP_LEVEL");
+  dgPushStructCtx(ctx, DG_TOP_LEVEL, "DG_TOP_LEVEL");
 
   if (!confirm_magic_number(InFP)) {
     fprintf(stderr,"dgutils: file not recognized as dg format\n");
@@ -2720,55 +3056,59 @@ void dguFileToAscii(FILE *InFP, FILE *OutFP)
   
   while((c = getc(InFP)) != EOF) {
     if (c == END_STRUCT) {
-      fprintf(OutFP, "END:   %s\n", dgGetCurrentStructName());
-      dgPopStruct();
+      fprintf(OutFP, "END:   %s\n", dgGetCurrentStructNameCtx(ctx));
+      dgPopStructCtx(ctx);
       continue;
     }
-    switch (dtype = dgGetDataType(c)) {
+    switch (dtype = dgGetDataTypeCtx(ctx, c)) {
     case DF_STRUCTURE:
-      fprintf(OutFP, "BEGIN: %s\n", dgGetTagName(c));
-      dgPushStruct(dgGetStructureType(c), dgGetTagName(c));
+      fprintf(OutFP, "BEGIN: %s\n", dgGetTagNameCtx(ctx, c));
+      dgPushStructCtx(ctx, dgGetStructureTypeCtx(ctx, c),
+		      dgGetTagNameCtx(ctx, c));
       break;
     case DF_VERSION:
-      read_version(InFP, OutFP);
+      read_version(ctx, InFP, OutFP);
       break;
     case DF_VOID_ARRAY:
       break;
     case DF_FLAG:
-      read_flag(c, InFP, OutFP);
+      read_flag(ctx, c, InFP, OutFP);
       break;
     case DF_CHAR:
-      read_char(c, InFP, OutFP);
+      read_char(ctx, c, InFP, OutFP);
       break;
     case DF_LONG:
-      read_long(c, InFP, OutFP);
+      read_long(ctx, c, InFP, OutFP);
+      break;
+    case DF_SIZE_T:
+      read_size(ctx, c, InFP, OutFP);
       break;
     case DF_SHORT:
-      read_short(c, InFP, OutFP);
+      read_short(ctx, c, InFP, OutFP);
       break;
     case DF_FLOAT:
-      read_float(c, InFP, OutFP);
+      read_float(ctx, c, InFP, OutFP);
       break;
     case DF_STRING:
-      read_string(c, InFP, OutFP);
+      read_string(ctx, c, InFP, OutFP);
       break;
     case DF_STRING_ARRAY:
-      read_strings(c, InFP, OutFP);
+      read_strings(ctx, c, InFP, OutFP);
       break;
     case DF_FLOAT_ARRAY:
-      read_floats(c, InFP, OutFP);
+      read_floats(ctx, c, InFP, OutFP);
       break;
     case DF_LONG_ARRAY:
-      read_longs(c, InFP, OutFP);
+      read_longs(ctx, c, InFP, OutFP);
       break;
     case DF_CHAR_ARRAY:
-      read_chars(c, InFP, OutFP);
+      read_chars(ctx, c, InFP, OutFP);
       break;
     case DF_SHORT_ARRAY:
-      read_shorts(c, InFP, OutFP);
+      read_shorts(ctx, c, InFP, OutFP);
       break;
     case DF_LIST_ARRAY:
-      read_long(c, InFP, OutFP);
+      read_long(ctx, c, InFP, OutFP);
       break;
     default:
       fprintf(stderr,"unknown event type %d\n", c);
@@ -2778,3 +3118,267 @@ void dguFileToAscii(FILE *InFP, FILE *OutFP)
 }
 
 
+/*--------------------------------------------------------------------
+  -----                 Default Context Functions                -----
+
+      The original entry points.  Recording and the struct stack keep
+      their state between calls, so these share one default context
+      and are not reentrant.  Reading a whole file or buffer needs no
+      state from before, so each of those readers gets a context of
+      its own and may run in several threads at once.
+
+  -------------------------------------------------------------------*/
+
+static DG_IO_CTX DgDefaultCtx;
+
+void dgInitBuffer(void)
+{
+  dgInitBufferCtx(&DgDefaultCtx);
+}
+
+void dgResetBuffer(void)
+{
+  dgResetBufferCtx(&DgDefaultCtx);
+}
+
+void dgCloseBuffer(void)
+{
+  dgCloseBufferCtx(&DgDefaultCtx);
+}
+
+unsigned char *dgGetBuffer(void)
+{
+  return dgGetBufferCtx(&DgDefaultCtx);
+}
+
+DL_SIZE dgGetBufferSize(void)
+{
+  return dgGetBufferSizeCtx(&DgDefaultCtx);
+}
+
+DL_SIZE dgSetBufferIncrement(DL_SIZE increment)
+{
+  return dgSetBufferIncrementCtx(&DgDefaultCtx, increment);
+}
+
+int dgWriteBuffer(char *filename, char format)
+{
+  return dgWriteBufferCtx(&DgDefaultCtx, filename, format);
+}
+
+int dgWriteBufferCompressed(char *filename)
+{
+  return dgWriteBufferCompressedCtx(&DgDefaultCtx, filename);
+}
+
+void dgLoadStructure(DYN_GROUP *dg)
+{
+  dgLoadStructureCtx(&DgDefaultCtx, dg);
+}
+
+void dgRecordDynList(unsigned char tag, DYN_LIST *dl)
+{
+  dgRecordDynListCtx(&DgDefaultCtx, tag, dl);
+}
+
+void dgRecordDynGroup(DYN_GROUP *dg)
+{
+  dgRecordDynGroupCtx(&DgDefaultCtx, dg);
+}
+
+void dgBeginStruct(unsigned char tag)
+{
+  dgBeginStructCtx(&DgDefaultCtx, tag);
+}
+
+void dgEndStruct(void)
+{
+  dgEndStructCtx(&DgDefaultCtx);
+}
+
+void dgRecordVoidArray(unsigned char type, int datatype, DL_SIZE n,
+		       void *data)
+{
+  dgRecordVoidArrayCtx(&DgDefaultCtx, type, datatype, n, data);
+}
+
+void dgRecordString(unsigned char type, char *str)
+{
+  dgRecordStringCtx(&DgDefaultCtx, type, str);
+}
+
+void dgRecordStringArray(unsigned char type, DL_SIZE n, char **s)
+{
+  dgRecordStringArrayCtx(&DgDefaultCtx, type, n, s);
+}
+
+void dgRecordLongArray(unsigned char type, DL_SIZE n, int *a)
+{
+  dgRecordLongArrayCtx(&DgDefaultCtx, type, n, a);
+}
+
+void dgRecordCharArray(unsigned char type, DL_SIZE n, char *a)
+{
+  dgRecordCharArrayCtx(&DgDefaultCtx, type, n, a);
+}
+
+void dgRecordShortArray(unsigned char type, DL_SIZE n, short *a)
+{
+  dgRecordShortArrayCtx(&DgDefaultCtx, type, n, a);
+}
+
+void dgRecordFloatArray(unsigned char type, DL_SIZE n, float *a)
+{
+  dgRecordFloatArrayCtx(&DgDefaultCtx, type, n, a);
+}
+
+void dgRecordListArray(unsigned char type, DL_SIZE n)
+{
+  dgRecordListArrayCtx(&DgDefaultCtx, type, n);
+}
+
+void dgRecordMagicNumber(void)
+{
+  dgRecordMagicNumberCtx(&DgDefaultCtx);
+}
+
+void dgRecordFlag(unsigned char type)
+{
+  dgRecordFlagCtx(&DgDefaultCtx, type);
+}
+
+void dgRecordChar(unsigned char type, unsigned char val)
+{
+  dgRecordCharCtx(&DgDefaultCtx, type, val);
+}
+
+void dgRecordLong(unsigned char type, int val)
+{
+  dgRecordLongCtx(&DgDefaultCtx, type, val);
+}
+
+void dgRecordShort(unsigned char type, short val)
+{
+  dgRecordShortCtx(&DgDefaultCtx, type, val);
+}
+
+void dgRecordFloat(unsigned char type, float val)
+{
+  dgRecordFloatCtx(&DgDefaultCtx, type, val);
+}
+
+void dgRecordSize(unsigned char type, DL_SIZE val)
+{
+  dgRecordSizeCtx(&DgDefaultCtx, type, val);
+}
+
+void dgPushStruct(int newstruct, char *name)
+{
+  dgPushStructCtx(&DgDefaultCtx, newstruct, name);
+}
+
+int dgPopStruct(void)
+{
+  return dgPopStructCtx(&DgDefaultCtx);
+}
+
+void dgFreeStructStack(void)
+{
+  dgFreeStructStackCtx(&DgDefaultCtx);
+}
+
+int dgGetCurrentStruct(void)
+{
+  return dgGetCurrentStructCtx(&DgDefaultCtx);
+}
+
+char *dgGetCurrentStructName(void)
+{
+  return dgGetCurrentStructNameCtx(&DgDefaultCtx);
+}
+
+char *dgGetTagName(int type)
+{
+  return dgGetTagNameCtx(&DgDefaultCtx, type);
+}
+
+int dgGetDataType(int type)
+{
+  return dgGetDataTypeCtx(&DgDefaultCtx, type);
+}
+
+int dgGetStructureType(int type)
+{
+  return dgGetStructureTypeCtx(&DgDefaultCtx, type);
+}
+
+int dguFileToDynGroup(FILE *InFP, DYN_GROUP *dg)
+{
+  return dguFileToDynGroupCtx(&DgDefaultCtx, InFP, dg);
+}
+
+int dguFileToDynList(FILE *InFP, DYN_LIST *dl)
+{
+  return dguFileToDynListCtx(&DgDefaultCtx, InFP, dl);
+}
+
+
+/* whole file / buffer readers */
+
+int dgReadDynGroup(char *filename, DYN_GROUP *dg)
+{
+  DG_IO_CTX ctx;
+  int status;
+  memset(&ctx, 0, sizeof(ctx));
+  status = dgReadDynGroupCtx(&ctx, filename, dg);
+  dgFreeStructStackCtx(&ctx);
+  return status;
+}
+
+int dguGzipFileToStruct(char *filename, DYN_GROUP *dg)
+{
+  DG_IO_CTX ctx;
+  int status;
+  memset(&ctx, 0, sizeof(ctx));
+  status = dguGzipFileToStructCtx(&ctx, filename, dg);
+  dgFreeStructStackCtx(&ctx);
+  return status;
+}
+
+int dguFileToStruct(FILE *InFP, DYN_GROUP *dg)
+{
+  DG_IO_CTX ctx;
+  int status;
+  memset(&ctx, 0, sizeof(ctx));
+  status = dguFileToStructCtx(&ctx, InFP, dg);
+  dgFreeStructStackCtx(&ctx);
+  return status;
+}
+
+int dguBufferToStruct(unsigned char *vbuf, DL_SIZE bufsize,
+		      DYN_GROUP *dg)
+{
+  DG_IO_CTX ctx;
+  int status;
+  memset(&ctx, 0, sizeof(ctx));
+  status = dguBufferToStructCtx(&ctx, vbuf, bufsize, dg);
+  dgFreeStructStackCtx(&ctx);
+  return status;
+}
+
+void dguBufferToAscii(unsigned char *vbuf, DL_SIZE bufsize, FILE *OutFP)
+{
+  DG_IO_CTX ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  dguBufferToAsciiCtx(&ctx, vbuf, bufsize, OutFP);
+  dgFreeStructStackCtx(&ctx);
+}
+
+void dguFileToAscii(FILE *InFP, FILE *OutFP)
+{
+  DG_IO_CTX ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  dguFileToAsciiCtx(&ctx, InFP, OutFP);
+  dgFreeStructStackCtx(&ctx);
+}
+
@@ -46,7 +46,39 @@ enum DG_TAG { DG_NAME_TAG, DG_NLISTS_TAG, DG_DYNLIST_TAG };
 enum DL_TAG { DL_NAME_TAG, DL_INCREMENT_TAG, DL_DATA_TAG,
 	    DL_STRING_DATA_TAG, DL_CHAR_DATA_TAG, DL_SHORT_DATA_TAG,
 	    DL_LONG_DATA_TAG, DL_FLOAT_DATA_TAG, DL_LIST_DATA_TAG,
-	    DL_SUBLIST_TAG, DL_FLAGS_TAG };
+	    DL_SUBLIST_TAG, DL_FLAGS_TAG, DL_NVALS64_TAG,
+	    DL_DICT_STRINGS_TAG, DL_DICT_CODES_TAG };
+
+/***********************************************************************
+ *
+ *  DG_IO_CTX holds everything one write or read needs between calls:
+ *  the buffer being recorded, the stack of structures it is in, and
+ *  what the reader has learned so far (byte order, errors, a pending
+ *  64 bit count).  A zeroed context is ready to use, so one can live
+ *  on the stack; contexts share nothing, so threads writing or reading
+ *  at the same time each use their own.  The functions without the
+ *  Ctx suffix work on a single default context.
+ *
+ ***********************************************************************/
+
+typedef struct _dg_io_ctx {
+  unsigned char *buffer;	/* data being recorded                */
+  DL_SIZE index;		/* bytes recorded so far              */
+  DL_SIZE size;			/* bytes allocated for buffer         */
+  DL_SIZE increment;		/* to grow by (0 = default)           */
+  int recording;
+
+  int cur_struct;		/* structure being written or read    */
+  char *cur_struct_name;	/* (NULL = "DG_TOP_LEVEL")            */
+  TAG_INFO *stack;		/* enclosing structures               */
+  int stack_size;
+  int depth;			/* entries in use (0 = empty)         */
+
+  int flip;			/* data is in the other byte order    */
+  int read_error;		/* set on truncated or corrupt input  */
+  DL_SIZE next_count;		/* count from DL_NVALS64_TAG, or 0    */
+  DYN_ARENA *arena;		/* arena of the group being read      */
+} DG_IO_CTX;
 
 /***********************************************************************
  *
@@ -64,9 +96,9 @@ void dgCloseBuffer(void);	              /* free mem assoc. w/buf */
 int  dgWriteBuffer(char *filename, char format);
 int  dgWriteBufferCompressed(char *filename);
 unsigned char *dgGetBuffer(void);
-int dgGetBufferSize(void);
-int dgSetBufferIncrement(int);
-int dgEstimateGroupSize(DYN_GROUP *dg);
+DL_SIZE dgGetBufferSize(void);
+DL_SIZE dgSetBufferIncrement(DL_SIZE);
+DL_SIZE dgEstimateGroupSize(DYN_GROUP *dg);
 
 void dgRecordDynGroup(DYN_GROUP *dg);
 
@@ -77,15 +109,16 @@ void dgRecordChar(unsigned char, unsigned char);
 void dgRecordLong(unsigned char, int);
 void dgRecordShort(unsigned char, short);
 void dgRecordFloat(unsigned char, float);
+void dgRecordSize(unsigned char, DL_SIZE);
 
 void dgRecordString(unsigned char, char *);
-void dgRecordStringArray(unsigned char, int, char **);
-void dgRecordVoidArray(unsigned char, int, int, void *);
-void dgRecordLongArray(unsigned char, int, int *);
-void dgRecordShortArray(unsigned char, int, short *);
-void dgRecordFloatArray(unsigned char, int, float *);
-void dgRecordCharArray(unsigned char, int, char *);
-void dgRecordListArray(unsigned char type, int n);
+void dgRecordStringArray(unsigned char, DL_SIZE, char **);
+void dgRecordVoidArray(unsigned char, int, DL_SIZE, void *);
+void dgRecordLongArray(unsigned char, DL_SIZE, int *);
+void dgRecordShortArray(unsigned char, DL_SIZE, short *);
+void dgRecordFloatArray(unsigned char, DL_SIZE, float *);
+void dgRecordCharArray(unsigned char, DL_SIZE, char *);
+void dgRecordListArray(unsigned char type, DL_SIZE n);
 
 void dgBeginStruct(unsigned char tag);
 void dgEndStruct(void);
@@ -103,14 +136,74 @@ int dgReadDynGroup(char *, DYN_GROUP *dg);
 int dgReadDynGroupCompressed(char *, DYN_GROUP *dg);
 int dguGzipFileToStruct(char *filename, DYN_GROUP *dg);
 int dguFileToStruct(FILE *InFP, DYN_GROUP *dg);
-int dguBufferToStruct(unsigned char *vbuf, int n, DYN_GROUP *dg);
+int dguBufferToStruct(unsigned char *vbuf, DL_SIZE n, DYN_GROUP *dg);
 
 void dguFileToAscii(FILE *InFP, FILE *OutFP);
 
 int dguFileToDynGroup(FILE *InFP, DYN_GROUP *dg);
 int dguFileToDynList(FILE *InFP, DYN_LIST *dl);
-void dguBufferToAscii(unsigned char *vbuf, int bufsize, FILE *OutFP);
-
+void dguBufferToAscii(unsigned char *vbuf, DL_SIZE bufsize, FILE *OutFP);
+
+
+DG_IO_CTX *dgCreateIOCtx(void);
+void dgFreeIOCtx(DG_IO_CTX *ctx);
+
+void dgInitBufferCtx(DG_IO_CTX *ctx);
+void dgResetBufferCtx(DG_IO_CTX *ctx);
+void dgCloseBufferCtx(DG_IO_CTX *ctx);
+int  dgWriteBufferCtx(DG_IO_CTX *ctx, char *filename, char format);
+int  dgWriteBufferCompressedCtx(DG_IO_CTX *ctx, char *filename);
+unsigned char *dgGetBufferCtx(DG_IO_CTX *ctx);
+DL_SIZE dgGetBufferSizeCtx(DG_IO_CTX *ctx);
+DL_SIZE dgSetBufferIncrementCtx(DG_IO_CTX *ctx, DL_SIZE);
+
+void dgRecordDynGroupCtx(DG_IO_CTX *ctx, DYN_GROUP *dg);
+void dgRecordDynListCtx(DG_IO_CTX *ctx, unsigned char tag, DYN_LIST *dl);
+
+void dgRecordMagicNumberCtx(DG_IO_CTX *ctx);
+
+void dgRecordFlagCtx(DG_IO_CTX *ctx, unsigned char);
+void dgRecordCharCtx(DG_IO_CTX *ctx, unsigned char, unsigned char);
+void dgRecordLongCtx(DG_IO_CTX *ctx, unsigned char, int);
+void dgRecordShortCtx(DG_IO_CTX *ctx, unsigned char, short);
+void dgRecordFloatCtx(DG_IO_CTX *ctx, unsigned char, float);
+void dgRecordSizeCtx(DG_IO_CTX *ctx, unsigned char, DL_SIZE);
+
+void dgRecordStringCtx(DG_IO_CTX *ctx, unsigned char, char *);
+void dgRecordStringArrayCtx(DG_IO_CTX *ctx, unsigned char, DL_SIZE, char **);
+void dgRecordVoidArrayCtx(DG_IO_CTX *ctx, unsigned char, int, DL_SIZE,
+			  void *);
+void dgRecordLongArrayCtx(DG_IO_CTX *ctx, unsigned char, DL_SIZE, int *);
+void dgRecordShortArrayCtx(DG_IO_CTX *ctx, unsigned char, DL_SIZE, short *);
+void dgRecordFloatArrayCtx(DG_IO_CTX *ctx, unsigned char, DL_SIZE, float *);
+void dgRecordCharArrayCtx(DG_IO_CTX *ctx, unsigned char, DL_SIZE, char *);
+void dgRecordListArrayCtx(DG_IO_CTX *ctx, unsigned char type, DL_SIZE n);
+
+void dgBeginStructCtx(DG_IO_CTX *ctx, unsigned char tag);
+void dgEndStructCtx(DG_IO_CTX *ctx);
+
+void dgPushStructCtx(DG_IO_CTX *ctx, int newstruct, char *);
+int  dgPopStructCtx(DG_IO_CTX *ctx);
+void dgFreeStructStackCtx(DG_IO_CTX *ctx);
+int  dgGetCurrentStructCtx(DG_IO_CTX *ctx);
+char *dgGetCurrentStructNameCtx(DG_IO_CTX *ctx);
+char *dgGetTagNameCtx(DG_IO_CTX *ctx, int type);
+int  dgGetDataTypeCtx(DG_IO_CTX *ctx, int type);
+int  dgGetStructureTypeCtx(DG_IO_CTX *ctx, int type);
+
+int dgReadDynGroupCtx(DG_IO_CTX *ctx, char *, DYN_GROUP *dg);
+int dguGzipFileToStructCtx(DG_IO_CTX *ctx, char *filename, DYN_GROUP *dg);
+int dguFileToStructCtx(DG_IO_CTX *ctx, FILE *InFP, DYN_GROUP *dg);
+int dguBufferToStructCtx(DG_IO_CTX *ctx, unsigned char *vbuf, DL_SIZE n,
+			 DYN_GROUP *dg);
+void dgLoadStructureCtx(DG_IO_CTX *ctx, DYN_GROUP *dg);
+
+void dguFileToAsciiCtx(DG_IO_CTX *ctx, FILE *InFP, FILE *OutFP);
+
+int dguFileToDynGroupCtx(DG_IO_CTX *ctx, FILE *InFP, DYN_GROUP *dg);
+int dguFileToDynListCtx(DG_IO_CTX *ctx, FILE *InFP, DYN_LIST *dl);
+void dguBufferToAsciiCtx(DG_IO_CTX *ctx, unsigned char *vbuf,
+			 DL_SIZE bufsize, FILE *OutFP);
 
 #ifdef __cplusplus
 }
@@ -13,7 +13,7 @@
 #define LZ4_HEADER_SIZE 19
 #define LZ4_FOOTER_SIZE 4
 
-size_t compress_buffer_to_lz4_file(unsigned char *data, int src_size, FILE *out)
+size_t compress_buffer_to_lz4_file(unsigned char *data, size_t src_size, FILE *out)
 {
   LZ4F_errorCode_t r;
   LZ4F_compressionContext_t ctx;
@@ -45,7 +45,7 @@ size_t compress_buffer_to_lz4_file(unsigned char *data, int src_size, FILE *out)
   
   k = 0;
   src = data;
-  while(count_in < (size_t) src_size) {
+  while(count_in < src_size) {
     remaining = src_size-count_in;
     if (remaining > BUF_SIZE) k = BUF_SIZE;
     else k = remaining;
@@ -103,7 +103,7 @@ static size_t get_block_size(const LZ4F_frameInfo_t* info)
   }
 }
 
-int decompress_lz4_file_to_buffer(FILE *in, int *size, unsigned char **data)
+int decompress_lz4_file_to_buffer(FILE *in, size_t *size, unsigned char **data)
 {
   unsigned char* const src = malloc(BUF_SIZE);
   unsigned char* dst = NULL, *cur_dst;
@@ -144,9 +144,10 @@ int decompress_lz4_file_to_buffer(FILE *in, int *size, unsigned char **data)
 
       /* for now, insiste content size was specified or bail */
       if (!info.contentSize) goto cleanup;
-      dstCapacity = info.contentSize;
+      if (info.contentSize > (unsigned long long) ((size_t) -1)) goto cleanup;
+      dstCapacity = (size_t) info.contentSize;
       nbytes = 0;
-      dst = malloc((int) dstCapacity);
+      dst = malloc(dstCapacity);
       if (!dst) { goto cleanup; }
       cur_dst = dst;
       srcPtr += srcSize;
@@ -32,12 +32,17 @@
 #endif
 
 #include <stdint.h>
+#include <limits.h>
 #include <tcl.h>
 #include <df.h>
 #include <dynio.h>
 #include "dfana.h"
+#include "dlsimd.h"
+#include "dlthread.h"
+#include "dlrng.h"
 #include <labtcl.h>
 #include "tcl_dl.h"
+#include "dlobj.h"
 #include "dgmsgpack.h"
 #include "dgarrow.h"
 #include <jansson.h>
@@ -51,11 +56,6 @@
 /* generated at build time from src/dl_sugar.tcl (see cmake/EmbedTcl.cmake) */
 #include "dl_sugar_tcl.h"
 
-static const char *DLSH_ASSOC_DATA_KEY = "dlsh";
-
-/* to protect non thread safe dynio operations */
-static Tcl_Mutex dgBufferMutex;
-
 /* to save as JSON */
 extern json_t *dg_to_json(DYN_GROUP *dg);
 extern json_t *dg_element_to_json(DYN_GROUP *dg, int element);
@@ -119,12 +119,22 @@ enum DG_DUMP_TYPES   { DG_DUMP, DG_DUMP_LIST_NAMES, DG_LISTNAMES,
 enum DG_COMPRESSED_TYPES   { DG_UNCOMPRESSED, DG_COMPRESSED };
 enum DG_APPEND_TYPES { DG_MOVE, DG_COPY };
 enum DL_TYPE_INFO    { DL_DATATYPE, DL_IS_MATRIX };
+enum DL_STORAGE_MODES { DL_PACK_STORAGE, DL_UNPACK_STORAGE, 
+			DL_IS_PACKED_STORAGE, DG_PACK_STORAGE,
+			DL_IS_SHARED_STORAGE };
+enum DL_DICT_MODES   { DL_DICT_ENCODE, DL_DICT_DECODE, DL_IS_DICT_ENCODED,
+		       DL_DICT_CODES, DL_DICT_STRINGS, DG_DICT_ENCODE };
 enum DL_DUMP_TYPES   { 
   DL_DUMP, DL_DUMP_AS_ROW, DL_DUMP_MATRIX, DL_DUMP_MATRIX_IN_COLS, 
   DL_TO_TCL_LIST, DL_DUMPBYTES, DL_DUMPBYTES_AS };
 enum DL_DUMP_FORMATS {
   DL_DUMP_USHORT
 };
+enum DL_SDF_TYPES    { DL_SDF_GAUSSIAN, DL_SDF_ADAPTIVE };
+enum DL_FFT_TYPES    { DL_FFT_REAL, DL_FFT_COMPLEX, DL_FFT_INVERSE };
+enum DL_SPEC_TYPES   { DL_SPEC_MTFFT, DL_SPEC_SPECTRUM, DL_SPEC_SPECGRAM,
+		       DL_SPEC_COHERENCE, DL_SPEC_SPECERR, DL_SPEC_COHERR,
+		       DL_SPEC_CHI2INV, DL_SPEC_TINV };
 enum DL_CONSERS      { DL_COMBINE, DL_CONCAT, DL_INCREMENT, DL_INTERLEAVE };
 enum DL_ARITH_TYPES  { DL_ADD, DL_SUBTRACT, DL_MULTIPLY, DL_DIVIDE,
 		      DL_DIVIDE_ROWS, DL_MULTIPLY_ROWS, DL_POW, DL_CONV,
@@ -141,7 +151,8 @@ enum DL_LISTLIST_TYPES { DL_RECIPROCAL, DL_TRANSPOSE, DL_SORT, DL_UNIQUE,
 			   DL_LAST_INDEX_LIST, DL_PACK, DL_DEEP_PACK,
 			 DL_IDIFF, DL_SUBSHIFT, DL_UNPACK_LISTS,
 			 DL_RECODE_WITH_TIES, DL_BSHIFT, DL_BSHIFTCYCLE,
-                         DL_TRANSPOSE_AT, DL_CUT, DL_GRADIENT};
+                         DL_TRANSPOSE_AT, DL_CUT, DL_GRADIENT,
+			 DL_UNIQUE_ORDERED, DL_VALUE_COUNTS};
 enum DL_REPLACERS    { DL_REPLACE, DL_REPLACE_BY_INDEX };
 enum DL_REPEATERS    { DL_REPEAT, DL_REPLICATE, DL_REPEAT_ELTS };
 enum DL_PERMUTERS    { DL_PERMUTE, DL_REVERSE, DL_REVERSE_ALL, DL_BREVERSE };
@@ -180,7 +191,8 @@ enum DL_TOFROMSTRING { DL_TOFROM_BINARY, DL_TOFROM_BASE64, DL_TOFROM_JSON };
  *****************************************************************************/
 
 static int tclDynGroupDir             (ClientData, Tcl_Interp *, int, char **);
-static int tclDynGroupExists          (ClientData, Tcl_Interp *, int, char **);
+static int tclDynGroupExists          (ClientData, Tcl_Interp *, int,
+				       Tcl_Obj * const objv[]);
 static int tclCreateDynGroup          (ClientData, Tcl_Interp *, int, char **);
 static int tclCopyDynGroup            (ClientData, Tcl_Interp *, int, char **);
 static int tclRenameDynGroup          (ClientData, Tcl_Interp *, int, char **);
@@ -197,18 +209,23 @@ static int tclDumpDynGroup            (ClientData, Tcl_Interp *, int, char **);
 static int tclSetFormat               (ClientData, Tcl_Interp *, int, char **);
 
 static int tclDynListDir              (ClientData, Tcl_Interp *, int, char **);
-static int tclDynListExists           (ClientData, Tcl_Interp *, int, char **);
+static int tclDynListExists           (ClientData, Tcl_Interp *, int,
+				       Tcl_Obj * const objv[]);
 static int tclDynListSublist          (ClientData, Tcl_Interp *, int, char **);
 static int tclDynListDatatype         (ClientData, Tcl_Interp *, int, char **);
 static int tclCreateDynList           (ClientData, Tcl_Interp *, int, char **);
 static int tclSetDynList              (ClientData, Tcl_Interp *, int, char **);
 static int tclLocalDynList            (ClientData, Tcl_Interp *, int, char **);
 static int tclReturnDynList           (ClientData, Tcl_Interp *, int, char **);
-static int tclGetPutDynList           (ClientData, Tcl_Interp *, int, char **);
+static int tclGetPutDynList           (ClientData, Tcl_Interp *, int,
+				       Tcl_Obj * const objv[]);
 static int tclDeleteDynList           (ClientData, Tcl_Interp *, int, char **);
 static int tclDeleteTraceDynList      (ClientData, Tcl_Interp *, int, char **);
 static int tclRenameDynList           (ClientData, Tcl_Interp *, int, char **);
 static int tclResetDynList            (ClientData, Tcl_Interp *, int, char **);
+static int tclReserveDynList          (ClientData, Tcl_Interp *, int, char **);
+static int tclPackStorageDynList      (ClientData, Tcl_Interp *, int, char **);
+static int tclDictEncodeDynList       (ClientData, Tcl_Interp *, int, char **);
 static int tclCleanDynList            (ClientData, Tcl_Interp *, int, char **);
 static int tclPushTmpList             (ClientData, Tcl_Interp *, int, char **);
 static int tclPopTmpList              (ClientData, Tcl_Interp *, int, char **);
@@ -224,7 +241,8 @@ static int tclConsDynList             (ClientData, Tcl_Interp *, int, char **);
 static int tclDumpDynList             (ClientData, Tcl_Interp *, int, char **);
 static int tclConvertDynList          (ClientData, Tcl_Interp *, int, char **);
 static int tclUnsignedConvertDynList  (ClientData, Tcl_Interp *, int, char **);
-static int tclArithDynList            (ClientData, Tcl_Interp *, int, char **);
+static int tclArithDynList            (ClientData, Tcl_Interp *, int,
+				       Tcl_Obj * const objv[]);
 static int tclListFromList            (ClientData, Tcl_Interp *, int, char **);
 static int tclReshapeList             (ClientData, Tcl_Interp *, int, char **);
 static int tclRestructureList         (ClientData, Tcl_Interp *, int, char **);
@@ -233,30 +251,109 @@ static int tclPermuteDynList          (ClientData, Tcl_Interp *, int, char **);
 static int tclRepList                 (ClientData, Tcl_Interp *, int, char **);
 static int tclCountLists              (ClientData, Tcl_Interp *, int, char **);
 static int tclSortByLists             (ClientData, Tcl_Interp *, int, char **);
-static int tclReduceList              (ClientData, Tcl_Interp *, int, char **);
+static int tclReduceList              (ClientData, Tcl_Interp *, int,
+				       Tcl_Obj * const objv[]);
 static int tclReduceLists             (ClientData, Tcl_Interp *, int, char **);
 static int tclHistLists               (ClientData, Tcl_Interp *, int, char **);
+static int tclHist2D                  (ClientData, Tcl_Interp *, int, char **);
 static int tclHistBins                (ClientData, Tcl_Interp *, int, char **);
 static int tclGenerateDynList         (ClientData, Tcl_Interp *, int, char **);
 static int tclSeries                  (ClientData, Tcl_Interp *, int, char **);
 static int tclSdfLists                (ClientData, Tcl_Interp *, int, char **);
 static int tclSdfListsRecursive       (ClientData, Tcl_Interp *, int, char **);
 static int tclParzenLists             (ClientData, Tcl_Interp *, int, char **);
+static int tclSdfAligned              (ClientData, Tcl_Interp *, int, char **);
+static int tclFftLists                (ClientData, Tcl_Interp *, int, char **);
+static int tclDpss                    (ClientData, Tcl_Interp *, int, char **);
+static int tclMtSpecLists             (ClientData, Tcl_Interp *, int, char **);
+static int tclSpecErrLists            (ClientData, Tcl_Interp *, int, char **);
+static int tclSpecQuantile            (ClientData, Tcl_Interp *, int, char **);
 static int tclDLHelp                  (ClientData, Tcl_Interp *, int, char **);
 static int tclMathFuncOneArg          (ClientData, Tcl_Interp *, int, char **);
+static int tclArithDynListInPlace     (ClientData, Tcl_Interp *, int, char **);
+static int tclMathFuncOneArgInPlace   (ClientData, Tcl_Interp *, int, char **);
 static int tclFillList                (ClientData, Tcl_Interp *, int, char **);
 static int tclTempName                (ClientData, Tcl_Interp *, int, char **);
 static int tclDgTempName              (ClientData, Tcl_Interp *, int, char **);
 static int tclSetMatherr              (ClientData, Tcl_Interp *, int, char **);
+static int tclSimdLevel               (ClientData, Tcl_Interp *, int, char **);
+static int tclThreads                 (ClientData, Tcl_Interp *, int, char **);
+static int tclSetFastMath             (ClientData, Tcl_Interp *, int, char **);
 static int tclLoadPackage             (ClientData, Tcl_Interp *, int, char **);
 static int tclDateToDays              (ClientData, Tcl_Interp *, int, char **); 
 static int tclDaysToDate              (ClientData, Tcl_Interp *, int, char **); 
 static int tclNoOp                    (ClientData, Tcl_Interp *, int, char **);
 static int tclSetRandomSeed           (ClientData, Tcl_Interp *, int, char **);
 
-static TCL_COMMANDS DLcommands[] = {
+/*
+ * Commands called often enough that looking up their list arguments by
+ * name every time shows: these take objects, which cache the lookup
+ * (see Tcl_GetDynListFromObj)
+ */
+
+static TCL_OBJ_COMMANDS DLobjcommands[] = {
   { "dg_exists",           tclDynGroupExists,     NULL, 
       "returns 1 if dynGroup exists" },
+  { "dl_exists",           tclDynListExists,      NULL, 
+      "returns 1 if dynList exists" },
+  { "dl_get",              tclGetPutDynList,      (void *) DL_GET, 
+      "get an element from a dynList" },
+  { "dl_put",              tclGetPutDynList,      (void *) DL_PUT, 
+      "put an element in a dynList" },
+  { "dl_first",            tclGetPutDynList,      (void *) DL_FIRST, 
+      "get first element from a dynList" },
+  { "dl_last",             tclGetPutDynList,      (void *) DL_LAST, 
+      "get last element from a dynList" },
+  { "dl_pickone",          tclGetPutDynList,      (void *) DL_PICKONE, 
+      "get random element from a dynList" },
+  { "dl_add",              tclArithDynList,       (void *) DL_ADD,
+      "elementwise add" },
+  { "dl_sub",              tclArithDynList,       (void *) DL_SUBTRACT,
+      "elementwise subtract" },
+  { "dl_mult",             tclArithDynList,       (void *) DL_MULTIPLY,
+      "elementwise multiply" },
+  { "dl_div",              tclArithDynList,       (void *) DL_DIVIDE,
+      "elementwise divide" },
+  { "dl_pow",              tclArithDynList,       (void *) DL_POW,
+      "elementwise pow a,b" },
+  { "dl_atan2",            tclArithDynList,       (void *) DL_ATAN2,
+      "elementwise atan2" },
+  { "dl_fmod",             tclArithDynList,       (void *) DL_FMOD,
+      "elementwise fmod" },
+  { "dl_length",           tclReduceList,         (void *) DL_LENGTH,
+      "return length of lists" },
+  { "dl_depth",            tclReduceList,         (void *) DL_DEPTH,
+      "return depth of a list" },
+  { "dl_min",              tclReduceList,         (void *) DL_MIN,
+      "return min of a list" },
+  { "dl_max",              tclReduceList,         (void *) DL_MAX,
+      "return max of a list" },
+  { "dl_any",             tclReduceList,          (void *) DL_ANY,
+      "return 1 if any element nonzero" },
+  { "dl_all",             tclReduceList,          (void *) DL_ALL,
+      "return 1 if all elements nonzero" },  
+  { "dl_minIndex",         tclReduceList,         (void *) DL_MIN_INDEX,
+      "return index of min of a list" },
+  { "dl_maxIndex",         tclReduceList,         (void *) DL_MAX_INDEX,
+      "return indices of maxs" },
+  { "dl_sum",              tclReduceList,         (void *) DL_SUM,
+      "return sum of a list" },
+  { "dl_prod",              tclReduceList,        (void *) DL_PROD,
+      "return prod of a list" },
+  { "dl_mean",             tclReduceList,         (void *) DL_MEAN,
+      "return mean value of a list" },
+  { "dl_std",              tclReduceList,         (void *) DL_STD,
+      "return standard deviation of a list" },
+  { "dl_var",              tclReduceList,         (void *) DL_VAR,
+      "return variance of a list" },
+  { "dl_conv",             tclArithDynList,      (void *) DL_CONV,
+      "convolve data with kernel" },
+  { "dl_conv2",             tclArithDynList,      (void *) DL_CONV2,
+      "convolve data with recursive kernel" },
+  { NULL, NULL, NULL, NULL }
+};
+
+static TCL_COMMANDS DLcommands[] = {
   { "dg_dir",              tclDynGroupDir,        NULL, 
       "returns list of current dynGroups" },
   { "dg_create",           tclCreateDynGroup,     NULL, 
@@ -303,8 +400,6 @@ static TCL_COMMANDS DLcommands[] = {
 
 
 
-  { "dl_exists",           tclDynListExists,      NULL, 
-      "returns 1 if dynList exists" },
   { "dl_sublist",          tclDynListSublist,     NULL, 
       "returns 1 if dynList is a sublist" },
   { "dl_dir",              tclDynListDir,         NULL, 
@@ -339,6 +434,33 @@ static TCL_COMMANDS DLcommands[] = {
       "delete a dynList from a trace cmd" },
   { "dl_reset",            tclResetDynList,       NULL, 
       "reset a dynList" },
+  { "dl_reserve",          tclReserveDynList,     NULL, 
+      "preallocate storage for n elements in a dynList" },
+  { "dl_packStorage",      tclPackStorageDynList, (void *) DL_PACK_STORAGE, 
+      "store a list of numeric lists as one values+offsets block" },
+  { "dl_unpackStorage",    tclPackStorageDynList, (void *) DL_UNPACK_STORAGE, 
+      "give each sublist of a packed list its own storage" },
+  { "dl_isPackedStorage",  tclPackStorageDynList, 
+      (void *) DL_IS_PACKED_STORAGE, 
+      "returns 1 if list uses packed values+offsets storage" },
+  { "dl_isSharedStorage",  tclPackStorageDynList, 
+      (void *) DL_IS_SHARED_STORAGE, 
+      "returns 1 if list shares its values with a copy" },
+  { "dg_packStorage",      tclPackStorageDynList, (void *) DG_PACK_STORAGE, 
+      "use packed storage for all packable list-of-list columns" },
+  { "dl_dictEncode",       tclDictEncodeDynList,  (void *) DL_DICT_ENCODE, 
+      "store a string list as codes into a table of distinct strings" },
+  { "dl_dictDecode",       tclDictEncodeDynList,  (void *) DL_DICT_DECODE, 
+      "give each string of a dictionary encoded list its own storage" },
+  { "dl_isDictEncoded",    tclDictEncodeDynList,  
+      (void *) DL_IS_DICT_ENCODED, 
+      "returns 1 if list is a dictionary encoded string list" },
+  { "dl_dictCodes",        tclDictEncodeDynList,  (void *) DL_DICT_CODES, 
+      "returns the codes of a dictionary encoded string list" },
+  { "dl_dictStrings",      tclDictEncodeDynList,  (void *) DL_DICT_STRINGS, 
+      "returns the sorted string table of a dictionary encoded list" },
+  { "dg_dictEncode",       tclDictEncodeDynList,  (void *) DG_DICT_ENCODE, 
+      "dictionary encode all string columns of a dyngroup" },
   { "dl_pushTemps" ,       tclPushTmpList,        NULL,
       "save names of subsequently created temp lists" },
   { "dl_popTemps" ,        tclPopTmpList,         NULL,
@@ -349,8 +471,6 @@ static TCL_COMMANDS DLcommands[] = {
       "delete temporary dynLists" },
   { "dl_cleanReturns" ,    tclCleanDynList,       (void *) DL_CLEAN_RETS, 
       "delete temporary dynLists" },
-  { "dl_get",              tclGetPutDynList,      (void *) DL_GET, 
-      "get an element from a dynList" },
   { "dl_cycle",            tclListFromList,       (void *) DL_SHIFTCYCLE,
       "cycle elements of a list" },
   { "dl_shift",            tclListFromList,       (void *) DL_SHIFT,
@@ -377,14 +497,6 @@ static TCL_COMMANDS DLcommands[] = {
       "replace selected elements from a list (using indices)" },
   { "dl_where",            tclWhereDynList,       (void *) NULL,
       "conditional selection: where(mask, if_true, if_false)" },
-  { "dl_put",              tclGetPutDynList,      (void *) DL_PUT, 
-      "put an element in a dynList" },
-  { "dl_first",            tclGetPutDynList,      (void *) DL_FIRST, 
-      "get first element from a dynList" },
-  { "dl_last",             tclGetPutDynList,      (void *) DL_LAST, 
-      "get last element from a dynList" },
-  { "dl_pickone",          tclGetPutDynList,      (void *) DL_PICKONE, 
-      "get random element from a dynList" },
   { "dl_append",           tclAppendDynList,      (void *) DL_APPEND, 
       "append an element to a dynList" },
   { "dl_prepend",          tclAppendDynList,      (void *) DL_PREPEND, 
@@ -521,16 +633,6 @@ static TCL_COMMANDS DLcommands[] = {
       "count all occurences of a sublist within a source list" },
   { "dl_mod",              tclCompareDynList,     (void *) DL_MOD,
       "list1 mod list2" },
-  { "dl_add",              tclArithDynList,       (void *) DL_ADD,
-      "elementwise add" },
-  { "dl_sub",              tclArithDynList,       (void *) DL_SUBTRACT,
-      "elementwise subtract" },
-  { "dl_mult",             tclArithDynList,       (void *) DL_MULTIPLY,
-      "elementwise multiply" },
-  { "dl_div",              tclArithDynList,       (void *) DL_DIVIDE,
-      "elementwise divide" },
-  { "dl_pow",              tclArithDynList,       (void *) DL_POW,
-      "elementwise pow a,b" },
   { "dl_abs",              tclMathFuncOneArg,     (void *) DL_ABS,
       "elementwise absolute value" },
   { "dl_acos",             tclMathFuncOneArg,     (void *) DL_ACOS,
@@ -539,10 +641,6 @@ static TCL_COMMANDS DLcommands[] = {
       "elementwise asin" },
   { "dl_atan",             tclMathFuncOneArg,     (void *) DL_ATAN,
       "elementwise atan" },
-  { "dl_atan2",            tclArithDynList,       (void *) DL_ATAN2,
-      "elementwise atan2" },
-  { "dl_fmod",             tclArithDynList,       (void *) DL_FMOD,
-      "elementwise fmod" },
   { "dl_ceil",             tclMathFuncOneArg,     (void *) DL_CEIL,
       "smallest integer not less than" },
   { "dl_cos",              tclMathFuncOneArg,     (void *) DL_COS,
@@ -571,6 +669,56 @@ static TCL_COMMANDS DLcommands[] = {
       "elementwise tan" },
   { "dl_tanh",             tclMathFuncOneArg,     (void *) DL_TANH,
       "elementwise hyperbolic tan" },
+  { "dl_addInPlace",       tclArithDynListInPlace, (void *) DL_MATH_ADD,
+      "elementwise add into list1" },
+  { "dl_subInPlace",       tclArithDynListInPlace, (void *) DL_MATH_SUB,
+      "elementwise subtract into list1" },
+  { "dl_multInPlace",      tclArithDynListInPlace, (void *) DL_MATH_MUL,
+      "elementwise multiply into list1" },
+  { "dl_divInPlace",       tclArithDynListInPlace, (void *) DL_MATH_DIV,
+      "elementwise divide into list1" },
+  { "dl_powInPlace",       tclArithDynListInPlace, (void *) DL_MATH_POW,
+      "elementwise pow a,b into list1" },
+  { "dl_atan2InPlace",     tclArithDynListInPlace, (void *) DL_MATH_ATAN2,
+      "elementwise atan2 a,b into list1" },
+  { "dl_fmodInPlace",      tclArithDynListInPlace, (void *) DL_MATH_FMOD,
+      "elementwise fmod a,b into list1" },
+  { "dl_absInPlace",       tclMathFuncOneArgInPlace, (void *) DL_ABS,
+      "elementwise absolute value, in place" },
+  { "dl_acosInPlace",      tclMathFuncOneArgInPlace, (void *) DL_ACOS,
+      "elementwise acos, in place" },
+  { "dl_asinInPlace",      tclMathFuncOneArgInPlace, (void *) DL_ASIN,
+      "elementwise asin, in place" },
+  { "dl_atanInPlace",      tclMathFuncOneArgInPlace, (void *) DL_ATAN,
+      "elementwise atan, in place" },
+  { "dl_ceilInPlace",      tclMathFuncOneArgInPlace, (void *) DL_CEIL,
+      "elementwise ceil, in place" },
+  { "dl_cosInPlace",       tclMathFuncOneArgInPlace, (void *) DL_COS,
+      "elementwise cos, in place" },
+  { "dl_coshInPlace",      tclMathFuncOneArgInPlace, (void *) DL_COSH,
+      "elementwise hyperbolic cosine, in place" },
+  { "dl_expInPlace",       tclMathFuncOneArgInPlace, (void *) DL_EXP,
+      "elementwise exp, in place" },
+  { "dl_lgammaInPlace",    tclMathFuncOneArgInPlace, (void *) DL_LGAMMA,
+      "elementwise lgamma, in place" },
+  { "dl_floorInPlace",     tclMathFuncOneArgInPlace, (void *) DL_FLOOR,
+      "elementwise floor, in place" },
+  { "dl_roundInPlace",     tclMathFuncOneArgInPlace, (void *) DL_ROUND,
+      "elementwise round, in place" },
+  { "dl_logInPlace",       tclMathFuncOneArgInPlace, (void *) DL_LOG,
+      "elementwise log, in place" },
+  { "dl_log10InPlace",     tclMathFuncOneArgInPlace, (void *) DL_LOG10,
+      "elementwise log10, in place" },
+  { "dl_sinInPlace",       tclMathFuncOneArgInPlace, (void *) DL_SIN,
+      "elementwise sin, in place" },
+  { "dl_sinhInPlace",      tclMathFuncOneArgInPlace, (void *) DL_SINH,
+      "elementwise hyperbolic sine, in place" },
+  { "dl_sqrtInPlace",      tclMathFuncOneArgInPlace, (void *) DL_SQRT,
+      "elementwise sqrt, in place" },
+  { "dl_tanInPlace",       tclMathFuncOneArgInPlace, (void *) DL_TAN,
+      "elementwise tan, in place" },
+  { "dl_tanhInPlace",      tclMathFuncOneArgInPlace, (void *) DL_TANH,
+      "elementwise hyperbolic tan, in place" },
   { "dl_recip",            tclListFromList,       (void *) DL_RECIPROCAL,
       "return elementwise reciprocals" },
   { "dl_sign",             tclListFromList,       (void *) DL_SIGN,
@@ -635,6 +783,10 @@ static TCL_COMMANDS DLcommands[] = {
       "extract unique elements of a list" },
   { "dl_uniqueNoSort",     tclListFromList,       (void *) DL_UNIQUE_NO_SORT,
       "extract unique elements of a list" },
+  { "dl_uniqueOrdered",    tclListFromList,       (void *) DL_UNIQUE_ORDERED,
+      "extract unique elements of a list in order of appearance" },
+  { "dl_valueCounts",      tclListFromList,       (void *) DL_VALUE_COUNTS,
+      "return unique elements of a list and their counts" },
   { "dl_count",            tclCountLists,         (void *) DL_SINGLE,
       "return number of elements falling in range" },
   { "dl_counts",           tclCountLists,         (void *) DL_RECURSIVE,
@@ -651,36 +803,20 @@ static TCL_COMMANDS DLcommands[] = {
       "return list sorted by list of lists" },
   { "dl_sortBySelected",   tclSortByLists,        (void *) DL_BYSELECTED,
       "return list sorted by list of lists" },
-  { "dl_length",           tclReduceList,         (void *) DL_LENGTH,
-      "return length of lists" },
   { "dl_llength",          tclListFromList,       (void *) DL_LLENGTH,
       "return mapped list lengths" },
-  { "dl_depth",            tclReduceList,         (void *) DL_DEPTH,
-      "return depth of a list" },
-  { "dl_min",              tclReduceList,         (void *) DL_MIN,
-      "return min of a list" },
   { "dl_mins",             tclReduceLists,        (void *) DL_MIN,
       "return list of list mins" },
-  { "dl_max",              tclReduceList,         (void *) DL_MAX,
-      "return max of a list" },
   { "dl_maxs",             tclReduceLists,        (void *) DL_MAX,
       "return list of list max's" },
   { "dl_bmins",            tclReduceLists,        (void *) DL_BMIN,
       "return list of list mins" },
   { "dl_bmaxs",            tclReduceLists,        (void *) DL_BMAX,
       "return list of list max's" },
-  { "dl_any",             tclReduceList,          (void *) DL_ANY,
-      "return 1 if any element nonzero" },
-  { "dl_all",             tclReduceList,          (void *) DL_ALL,
-      "return 1 if all elements nonzero" },  
   { "dl_anys",            tclReduceLists,         (void *) DL_ANYS,
       "return 1 if any element nonzero" },
   { "dl_alls",            tclReduceLists,         (void *) DL_ALLS,
       "return 1 if all elements nonzero" },  
-  { "dl_minIndex",         tclReduceList,         (void *) DL_MIN_INDEX,
-      "return index of min of a list" },
-  { "dl_maxIndex",         tclReduceList,         (void *) DL_MAX_INDEX,
-      "return indices of maxs" },
   { "dl_minIndices",       tclReduceLists,        (void *) DL_MIN_INDEX,
       "return indices of mins" },
   { "dl_maxIndices",       tclReduceLists,        (void *) DL_MAX_INDEX,
@@ -691,20 +827,14 @@ static TCL_COMMANDS DLcommands[] = {
       "return index of max of a list, preserving structure" },
   { "dl_indices",          tclListFromList,       (void *) DL_INDICES,
       "return indices of nonnull elements" },
-  { "dl_sum",              tclReduceList,         (void *) DL_SUM,
-      "return sum of a list" },
   { "dl_sums",             tclReduceLists,        (void *) DL_SUM,
       "return list of list sums" },
   { "dl_cumsum",           tclListFromList,       (void *) DL_CUMSUM,
       "return cumulutive sums of a list" },
-  { "dl_prod",              tclReduceList,        (void *) DL_PROD,
-      "return prod of a list" },
   { "dl_prods",             tclReduceLists,       (void *) DL_PROD,
       "return list of list prods" },
   { "dl_cumprod",           tclListFromList,      (void *) DL_CUMPROD,
       "return cumulutive products of a list" },
-  { "dl_mean",             tclReduceList,         (void *) DL_MEAN,
-      "return mean value of a list" },
   { "dl_meanList",         tclReduceLists,        (void *) DL_MEAN_LIST,
       "return average list of lists" },
   { "dl_sumList",         tclReduceLists,         (void *) DL_SUMCOLS_LIST,
@@ -719,14 +849,10 @@ static TCL_COMMANDS DLcommands[] = {
       "return list of list \"bottom level\" means" },
   { "dl_bsums",            tclReduceLists,        (void *) DL_BSUMS,
       "return list of \"bottom level\" sums" },
-  { "dl_std",              tclReduceList,         (void *) DL_STD,
-      "return standard deviation of a list" },
   { "dl_stds",             tclReduceLists,        (void *) DL_STD,
       "return list of list standard devs" },
   { "dl_hstds",            tclReduceLists,        (void *) DL_HSTD,
       "return list of list \"horizontal\" stds" },
-  { "dl_var",              tclReduceList,         (void *) DL_VAR,
-      "return variance of a list" },
   { "dl_vars",             tclReduceLists,        (void *) DL_VAR,
       "return list of list variances" },
   { "dl_hvars",            tclReduceLists,        (void *) DL_HVAR,
@@ -737,6 +863,8 @@ static TCL_COMMANDS DLcommands[] = {
       "return histogram of a list" },
   { "dl_hists",            tclHistLists,          (void *) DL_RECURSIVE,
       "return a list of histograms of lists" },
+  { "dl_hist2d",           tclHist2D,             NULL,
+      "return 2D histogram of paired x and y lists" },
   { "dl_sdf",              tclSdfLists,          (void *) DL_SINGLE,
       "return sdf of a list" },
   { "dl_sdfs",             tclSdfLists,          (void *) DL_RECURSIVE,
@@ -749,10 +877,34 @@ static TCL_COMMANDS DLcommands[] = {
       "return adaptive sdf of a list" },
   { "dl_parzens",          tclParzenLists,       (void *) DL_RECURSIVE,
       "return a list of sdfs of lists" },
-  { "dl_conv",             tclArithDynList,      (void *) DL_CONV,
-      "convolve data with kernel" },
-  { "dl_conv2",             tclArithDynList,      (void *) DL_CONV2,
-      "convolve data with recursive kernel" },
+  { "dl_sdfAligned",       tclSdfAligned,        (void *) DL_SDF_GAUSSIAN,
+      "return sdfs of trials around align times" },
+  { "dl_parzenAligned",    tclSdfAligned,        (void *) DL_SDF_ADAPTIVE,
+      "return adaptive sdfs of trials around align times" },
+  { "dl_fft",              tclFftLists,          (void *) DL_FFT_REAL,
+      "return FFT of real data" },
+  { "dl_cfft",             tclFftLists,          (void *) DL_FFT_COMPLEX,
+      "return FFT of complex data" },
+  { "dl_ifft",             tclFftLists,          (void *) DL_FFT_INVERSE,
+      "return inverse FFT of complex data" },
+  { "dl_dpss",             tclDpss,              NULL,
+      "return discrete prolate spheroidal sequences (Slepian tapers)" },
+  { "dl_mtfft",            tclMtSpecLists,       (void *) DL_SPEC_MTFFT,
+      "return tapered FFTs of trials" },
+  { "dl_mtspectrum",       tclMtSpecLists,       (void *) DL_SPEC_SPECTRUM,
+      "return multitaper spectra of trials" },
+  { "dl_mtspecgram",       tclMtSpecLists,       (void *) DL_SPEC_SPECGRAM,
+      "return multitaper spectrograms of trials" },
+  { "dl_mtcoherence",      tclMtSpecLists,       (void *) DL_SPEC_COHERENCE,
+      "return multitaper coherence of pairs of trials" },
+  { "dl_specerr",          tclSpecErrLists,      (void *) DL_SPEC_SPECERR,
+      "return confidence limits for spectra" },
+  { "dl_coherr",           tclSpecErrLists,      (void *) DL_SPEC_COHERR,
+      "return confidence limits for coherence" },
+  { "dl_chi2inv",          tclSpecQuantile,      (void *) DL_SPEC_CHI2INV,
+      "return inverse of the chi-square distribution" },
+  { "dl_tinv",             tclSpecQuantile,      (void *) DL_SPEC_TINV,
+      "return inverse of Student's t distribution" },
   { "dl_idiff",            tclListFromList,      (void *) DL_IDIFF,
       "return interelement differences" },
   { "dl_fill",             tclFillList,           NULL,
@@ -761,6 +913,12 @@ static TCL_COMMANDS DLcommands[] = {
 
   { "dl_setMatherr",       tclSetMatherr,         NULL, 
       "turn on/off domain checking for math functions" },
+  { "dl_simd",             tclSimdLevel,          NULL, 
+      "query/set the vector instruction set used by list arithmetic" },
+  { "dl_setFastMath",      tclSetFastMath,        NULL, 
+      "turn on/off approximate vector exp, log and sin" },
+  { "dl_threads",          tclThreads,            NULL, 
+      "query/set the number of threads used by per sublist reductions" },
   { "dl_pkg",              tclLoadPackage,        NULL, 
       "setup dlsh addon package" },
 
@@ -800,6 +958,12 @@ static int tclDoTimes(ClientData data, Tcl_Interp * interp, int objc,
 		      Tcl_Obj * const objv[]);
 static int tclForEach(ClientData data, Tcl_Interp * interp, int objc,
 		      Tcl_Obj * const objv[]);
+static int tclMapDynList(ClientData data, Tcl_Interp * interp, int objc,
+			 Tcl_Obj * const objv[]);
+static int tclFilterDynList(ClientData data, Tcl_Interp * interp, int objc,
+			    Tcl_Obj * const objv[]);
+static int tclReduceDynList(ClientData data, Tcl_Interp * interp, int objc,
+			    Tcl_Obj * const objv[]);
 static int tclDynGroupToString(ClientData data, Tcl_Interp * interp, int objc,
 			       Tcl_Obj * const objv[]);			       
 static int tclDynGroupFromString(ClientData data, Tcl_Interp * interp, 
@@ -808,6 +972,10 @@ static int tclDynListToString(ClientData data, Tcl_Interp * interp, int objc,
 			      Tcl_Obj * const objv[]);
 static int tclDynListFromString(ClientData data, Tcl_Interp * interp, int objc,
 				Tcl_Obj * const objv[]);
+static int tclDynListToBytes(ClientData data, Tcl_Interp * interp, int objc,
+			     Tcl_Obj * const objv[]);
+static int tclDynListFromBytes(ClientData data, Tcl_Interp * interp, int objc,
+			       Tcl_Obj * const objv[]);
 static int tclDynGroupToMsgpack(ClientData data, Tcl_Interp * interp, int objc,
 			      Tcl_Obj * const objv[]);
 
@@ -877,6 +1045,7 @@ int Dl_Init(Tcl_Interp *interp)
  
   Tcl_InitHashTable(&dlshinfo->dlTable, TCL_STRING_KEYS);
   Tcl_InitHashTable(&dlshinfo->dgTable, TCL_STRING_KEYS);
+  dlResultsInit(&dlshinfo->results, interp);
 
   dlshinfo->TmpListStack =  (TMPLIST_STACK *) calloc(1, sizeof(TMPLIST_STACK));
   TMPLIST_SIZE(dlshinfo->TmpListStack) = 0;
@@ -897,10 +1066,19 @@ int Dl_Init(Tcl_Interp *interp)
 		      (Tcl_CmdDeleteProc *) NULL);
     i++;
   }
+  for (i = 0; DLobjcommands[i].name; i++) {
+    Tcl_CreateObjCommand(interp, DLobjcommands[i].name, 
+			 (Tcl_ObjCmdProc *) DLobjcommands[i].func, 
+			 (ClientData) DLobjcommands[i].cd, 
+			 (Tcl_CmdDeleteProc *) NULL);
+  }
 
   /* Add the two objectified commands */
   Tcl_CreateObjCommand(interp, "dl_dotimes", tclDoTimes, NULL, NULL);
   Tcl_CreateObjCommand(interp, "dl_foreach", tclForEach, NULL, NULL);
+  Tcl_CreateObjCommand(interp, "dl_map", tclMapDynList, NULL, NULL);
+  Tcl_CreateObjCommand(interp, "dl_filter", tclFilterDynList, NULL, NULL);
+  Tcl_CreateObjCommand(interp, "dl_reduce", tclReduceDynList, NULL, NULL);
   Tcl_CreateObjCommand(interp, "dg_toString", tclDynGroupToString, 
 		       (ClientData) DG_TOFROM_BINARY, NULL);
   Tcl_CreateObjCommand(interp, "dg_fromString", tclDynGroupFromString,
@@ -947,6 +1125,8 @@ int Dl_Init(Tcl_Interp *interp)
 		       (ClientData) DL_TOFROM_BINARY, NULL);
   Tcl_CreateObjCommand(interp, "dl_fromString64", tclDynListFromString, 
 		       (ClientData) DL_TOFROM_BASE64, NULL);
+  Tcl_CreateObjCommand(interp, "dl_toBytes", tclDynListToBytes, NULL, NULL);
+  Tcl_CreateObjCommand(interp, "dl_fromBytes", tclDynListFromBytes, NULL, NULL);
   Tcl_CreateObjCommand(interp, "dl_regexp", tclRegexpList,
 		       (ClientData) DL_REGEXP, NULL);
   Tcl_CreateObjCommand(interp, "dl_regmatch", tclRegexpList,
@@ -966,10 +1146,11 @@ int Dl_Init(Tcl_Interp *interp)
 
   Dm_Init(interp);		/* add the matrix functions */
 
-  /* Embedded Tcl: the dl_comprehension helpers (dl_map/dl_filter/dl_reduce/
-     dl_comp). Built into the library and evaluated here -- after every dl_*
-     command they depend on is registered -- so they are always available on
-     load without needing the VFS lib path. See cmake/EmbedTcl.cmake. */
+  /* Embedded Tcl: the dl_comprehension helpers (dl_comp; dl_map, dl_filter
+     and dl_reduce are commands above). Built into the library and evaluated
+     here -- after every dl_* command they depend on is registered -- so they
+     are always available on load without needing the VFS lib path. See
+     cmake/EmbedTcl.cmake. */
   if (Tcl_Eval(interp, dl_comprehension_tcl) != TCL_OK)
     return TCL_ERROR;
 
@@ -1006,7 +1187,7 @@ int Dl_Init(Tcl_Interp *interp)
   Tcl_EvalFile(interp, startup);
 #endif
   
-  raninit();
+  dlRngSeed((uint32_t) raninit(), 0);
 
 #ifdef WIN32
   _fmode = _O_BINARY;		/* Make default file i/o binary */
@@ -1040,6 +1221,11 @@ static int tclDLHelp (ClientData cd, Tcl_Interp *interp,
     }
     i++;
   }
+  for (i = 0; DLobjcommands[i].name; i++) {
+    if (DLobjcommands[i].desc && DLobjcommands[i].desc[0] != 0) {
+      printf("%-22s - %s\n", DLobjcommands[i].name, DLobjcommands[i].desc);
+    }
+  }
   return TCL_OK;
 }
 
@@ -1066,14 +1252,16 @@ static int tclDLHelp (ClientData cd, Tcl_Interp *interp,
  *****************************************************************************/
 
 static int tclDynGroupExists (ClientData data, Tcl_Interp *interp,
-			      int argc, char *argv[])
+			      int objc, Tcl_Obj * const objv[])
 {
-  if (argc < 2) {
-      Tcl_AppendResult(interp, "usage: ", argv[0], " name", NULL);
+  DYN_GROUP *dg;
+
+  if (objc < 2) {
+      Tcl_AppendResult(interp, "usage: ", Tcl_GetString(objv[0]), " name", NULL);
       return TCL_ERROR;
   }
 
-  if (tclFindDynGroup(interp, argv[1], NULL) == TCL_OK) 
+  if (Tcl_GetDynGroupFromObj(interp, objv[1], &dg) == TCL_OK) 
     Tcl_SetObjResult(interp, Tcl_NewIntObj(1));
   else 
     Tcl_SetObjResult(interp, Tcl_NewIntObj(0));
@@ -1334,6 +1522,7 @@ static int tclRenameDynGroup (ClientData data, Tcl_Interp *interp,
       DYN_GROUP *dgold;
       if ((dgold = Tcl_GetHashValue(entryPtr))) dfuFreeDynGroup(dgold);
       Tcl_DeleteHashEntry(entryPtr);
+      dlinfo->groupGeneration++;
     }
 
     /* Actually rename the group */
@@ -1347,6 +1536,7 @@ static int tclRenameDynGroup (ClientData data, Tcl_Interp *interp,
     /* And remove old name from hash table */
     entryPtr = Tcl_FindHashEntry(&dlinfo->dgTable, oldname);
     Tcl_DeleteHashEntry(entryPtr);
+    dlinfo->groupGeneration++;
 
     Tcl_SetResult(interp, newname, TCL_VOLATILE);
     return TCL_OK;
@@ -1466,8 +1656,8 @@ static int tclWriteDynGroup (ClientData data, Tcl_Interp *interp,
   int format = DF_BINARY;
   int operation = DG_UNCOMPRESSED;
   int status;
-  int buffer_increment = 0;	/* use default */
-  int oldval;
+  DL_SIZE buffer_increment = 0;	/* use default */
+  DG_IO_CTX *ctx;
   
   if (argc < 2) {
     Tcl_AppendResult(interp, "usage: ", argv[0], " dyngroup filename",
@@ -1511,24 +1701,17 @@ static int tclWriteDynGroup (ClientData data, Tcl_Interp *interp,
     outfile = argv[2];
   }
   
-  Tcl_MutexLock(&dgBufferMutex);
-  
-  dgInitBuffer();
-  if (!buffer_increment) {
-    oldval = dgSetBufferIncrement(buffer_increment);
-  }
-  oldval = dgSetBufferIncrement(buffer_increment);
-  dgRecordDynGroup(dg);    
+  /* each write records into its own context, so threads don't collide */
+  ctx = dgCreateIOCtx();
+  dgInitBufferCtx(ctx);
+  dgSetBufferIncrementCtx(ctx, buffer_increment);
+  dgRecordDynGroupCtx(ctx, dg);    
   if (operation == DG_UNCOMPRESSED)
-    status = dgWriteBuffer(outfile, format);
+    status = dgWriteBufferCtx(ctx, outfile, format);
   else 
-    status = dgWriteBufferCompressed(outfile);
+    status = dgWriteBufferCompressedCtx(ctx, outfile);
     
-  dgCloseBuffer();
-
-  dgSetBufferIncrement(oldval);
-  
-  Tcl_MutexUnlock(&dgBufferMutex);
+  dgFreeIOCtx(ctx);
   
   if (argc < 3) free(outfile);
   
@@ -1937,7 +2120,7 @@ static int tclDynGroupToString(ClientData data, Tcl_Interp * interp, int objc,
   Tcl_Obj * o;
   DYN_GROUP *dg;
   char *dgname;
-  int oldval;			/* previous buffer increment */
+  DG_IO_CTX *ctx;		/* records the group */
   int encode64 = 0;
   json_t *json;
   char *json_str;
@@ -2009,28 +2192,31 @@ static int tclDynGroupToString(ClientData data, Tcl_Interp * interp, int objc,
     return TCL_OK;
   }
   
-  Tcl_MutexLock(&dgBufferMutex);
-   
-  dgInitBuffer();
-  oldval = dgSetBufferIncrement(dgEstimateGroupSize(dg));
-  dgRecordDynGroup(dg);    
+  ctx = dgCreateIOCtx();
+  dgInitBufferCtx(ctx);
+  dgSetBufferIncrementCtx(ctx, dgEstimateGroupSize(dg));
+  dgRecordDynGroupCtx(ctx, dg);    
   if (!encode64) {
-    o = Tcl_NewByteArrayObj(dgGetBuffer(), dgGetBufferSize());
+    o = Tcl_NewByteArrayObj(dgGetBufferCtx(ctx), dgGetBufferSizeCtx(ctx));
   }
   else {			/* base 64 encoded as ascii string */
     char *encoded_data;
     int encoded_length, result;
-    encoded_length = (((dgGetBufferSize()/3) + (dgGetBufferSize() % 3 > 0)) * 4);
+    DL_SIZE size = dgGetBufferSizeCtx(ctx);
+    if (size > (INT_MAX/4)*3) {
+      dgFreeIOCtx(ctx);
+      Tcl_AppendResult(interp, Tcl_GetString(objv[0]),
+		       ": dyngroup too large for base64 encoding", NULL);
+      return TCL_ERROR;
+    }
+    encoded_length = (((size/3) + (size % 3 > 0)) * 4);
     encoded_data = (char *) calloc(encoded_length, sizeof(char));
-    result =  base64encode(dgGetBuffer(),
-			   dgGetBufferSize(), encoded_data, encoded_length);
+    result =  base64encode(dgGetBufferCtx(ctx),
+			   size, encoded_data, encoded_length);
     o = Tcl_NewStringObj(encoded_data, encoded_length);
     free(encoded_data);
   }
-  dgCloseBuffer();
-  dgSetBufferIncrement(oldval);
-
-  Tcl_MutexUnlock(&dgBufferMutex);
+  dgFreeIOCtx(ctx);
 
   if (Tcl_ObjSetVar2(interp, objv[2], NULL, o,
 		     TCL_LEAVE_ERR_MSG) == NULL)
@@ -2203,6 +2389,7 @@ static int tclDynGroupFromString(ClientData cdata, Tcl_Interp * interp,
       DYN_GROUP *dgold;
       if ((dgold = Tcl_GetHashValue(entryPtr))) dfuFreeDynGroup(dgold);
       Tcl_DeleteHashEntry(entryPtr);
+      dlinfo->groupGeneration++;
     }
   }
   if (!(dg = dfuCreateDynGroup(4))) {
@@ -2210,13 +2397,10 @@ static int tclDynGroupFromString(ClientData cdata, Tcl_Interp * interp,
 		  TCL_STATIC);
     return TCL_ERROR;
   }
-  
-  /* dynio code not thread safe so need to protect this section */
-  Tcl_MutexLock(&dgBufferMutex);
+  dfuEnableDynGroupArena(dg);
   
   if (!encode64) {
     if (dguBufferToStruct(data, length, dg) != DF_OK) {
-      Tcl_MutexUnlock(&dgBufferMutex);  // Don't forget to unlock on error!
       dfuFreeDynGroup(dg);  // Clean up the allocated dg
       Tcl_SetResult(interp, "dg_fromString: file not recognized as dg format",
 		    TCL_STATIC);
@@ -2231,7 +2415,6 @@ static int tclDynGroupFromString(ClientData cdata, Tcl_Interp * interp,
     result = base64decode((char *) data, length, decoded_data, &decoded_length);
     if (result) {
       free(decoded_data);
-      Tcl_MutexUnlock(&dgBufferMutex);  // Unlock on error
       dfuFreeDynGroup(dg);  // Clean up
       char resultstr[128];
       snprintf(resultstr, sizeof(resultstr),
@@ -2242,7 +2425,6 @@ static int tclDynGroupFromString(ClientData cdata, Tcl_Interp * interp,
     }
     if (dguBufferToStruct(decoded_data, decoded_length, dg) != DF_OK) {
       free(decoded_data);
-      Tcl_MutexUnlock(&dgBufferMutex);  // Unlock on error
       dfuFreeDynGroup(dg);  // Clean up
       Tcl_SetResult(interp,
 		    "dg_fromString64: file not recognized as dg format",
@@ -2252,8 +2434,6 @@ static int tclDynGroupFromString(ClientData cdata, Tcl_Interp * interp,
     free(decoded_data);
   }
   
-  Tcl_MutexUnlock(&dgBufferMutex);
-  
   if (newname) strncpy(DYN_GROUP_NAME(dg), newname, DYN_GROUP_NAME_SIZE-1);
   if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dgTable, DYN_GROUP_NAME(dg)))) {
     DYN_GROUP *dgold;
@@ -2261,6 +2441,7 @@ static int tclDynGroupFromString(ClientData cdata, Tcl_Interp * interp,
       dfuFreeDynGroup(dgold);
     }
     Tcl_DeleteHashEntry(entryPtr);
+    dlinfo->groupGeneration++;
   }
   /*
    * Add to hash table which contains list of open dyngroups
@@ -2417,6 +2598,202 @@ static int tclDynListFromString(ClientData cdata, Tcl_Interp * interp,
   return TCL_OK;
 }
 
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDynListToBytes / tclDynListFromBytes
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_toBytes dynlist ?-byteorder native|little|big?
+ *    dl_fromBytes type bytes ?-offset n? ?-stride n? ?-count n?
+ *                            ?-byteorder native|little|big?
+ *
+ * DESCRIPTION
+ *    Move the values of a char, short, long or float list to and from a
+ * Tcl bytearray as raw machine values, with a single copy and no string
+ * conversion.  dl_fromBytes reads count elements of type starting at
+ * byte offset, stride bytes apart (default: packed, as many as fit), so
+ * one channel of interleaved data can be pulled out directly.
+ *
+ *****************************************************************************/
+
+enum DL_BYTEORDER { DL_BYTEORDER_NATIVE, DL_BYTEORDER_LITTLE, DL_BYTEORDER_BIG };
+
+static int tclGetByteOrderFromObj(Tcl_Interp *interp, Tcl_Obj *obj, int *swap)
+{
+  static const char *const orders[] = { "native", "little", "big", NULL };
+  const int one = 1;
+  int host_little = *(const char *) &one;
+  int order;
+
+  if (Tcl_GetIndexFromObj(interp, obj, orders, "byteorder", 0,
+			  &order) != TCL_OK)
+    return TCL_ERROR;
+  *swap = (order == DL_BYTEORDER_LITTLE && !host_little) ||
+    (order == DL_BYTEORDER_BIG && host_little);
+  return TCL_OK;
+}
+
+static void tclSwapBytes(unsigned char *p, DL_SIZE n, int size)
+{
+  DL_SIZE i;
+  unsigned char t;
+
+  if (size == 2) {
+    for (i = 0; i < n; i++, p += 2) {
+      t = p[0]; p[0] = p[1]; p[1] = t;
+    }
+  }
+  else if (size == 4) {
+    for (i = 0; i < n; i++, p += 4) {
+      t = p[0]; p[0] = p[3]; p[3] = t;
+      t = p[1]; p[1] = p[2]; p[2] = t;
+    }
+  }
+}
+
+static int tclDynListToBytes(ClientData data, Tcl_Interp * interp, int objc,
+			     Tcl_Obj * const objv[])
+{
+  DYN_LIST *dl;
+  Tcl_Obj *o;
+  unsigned char *bytes;
+  int size, swap = 0;
+
+  if (objc != 2 && !(objc == 4 && !strcmp(Tcl_GetString(objv[2]),
+					   "-byteorder"))) {
+    Tcl_WrongNumArgs(interp, 1, objv, "dynlist ?-byteorder order?");
+    return TCL_ERROR;
+  }
+  if (Tcl_GetDynListFromObj(interp, objv[1], &dl) != TCL_OK) return TCL_ERROR;
+  if (objc == 4 && tclGetByteOrderFromObj(interp, objv[3], &swap) != TCL_OK)
+    return TCL_ERROR;
+
+  if (DYN_LIST_DATATYPE(dl) == DF_LIST || DYN_LIST_DATATYPE(dl) == DF_STRING) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]),
+		     ": data type not supported", NULL);
+    return TCL_ERROR;
+  }
+  size = dfuDynListElementSize(DYN_LIST_DATATYPE(dl));
+
+  o = Tcl_NewByteArrayObj(NULL, 0);
+  bytes = Tcl_SetByteArrayLength(o, DYN_LIST_N(dl) * size);
+  if (DYN_LIST_N(dl)) memcpy(bytes, DYN_LIST_VALS(dl), DYN_LIST_N(dl) * size);
+  if (swap) tclSwapBytes(bytes, DYN_LIST_N(dl), size);
+  Tcl_SetObjResult(interp, o);
+  return TCL_OK;
+}
+
+static int tclDynListFromBytes(ClientData data, Tcl_Interp * interp, int objc,
+			       Tcl_Obj * const objv[])
+{
+  static const char *const options[] = {
+    "-offset", "-stride", "-count", "-byteorder", NULL
+  };
+  enum options { FB_OFFSET, FB_STRIDE, FB_COUNT, FB_BYTEORDER };
+  DYN_LIST *dl;
+  unsigned char *bytes, *src, *dst;
+  Tcl_Size length;
+  Tcl_WideInt offset = 0, stride = 0, count = -1, fit, i;
+  int datatype, size, index, swap = 0;
+
+  if (objc < 3 || objc % 2 == 0) {
+    Tcl_WrongNumArgs(interp, 1, objv,
+		     "type bytes ?-offset n? ?-stride n? ?-count n? "
+		     "?-byteorder order?");
+    return TCL_ERROR;
+  }
+
+  if (!dynGetDatatypeID(Tcl_GetString(objv[1]), &datatype) ||
+      datatype == DF_LIST || datatype == DF_STRING) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": bad datatype \"",
+		     Tcl_GetString(objv[1]),
+		     "\": must be char, short, long, int or float", NULL);
+    return TCL_ERROR;
+  }
+  size = dfuDynListElementSize(datatype);
+
+  for (i = 3; i < objc; i += 2) {
+    if (Tcl_GetIndexFromObj(interp, objv[i], options, "option", 0,
+			    &index) != TCL_OK)
+      return TCL_ERROR;
+    switch ((enum options) index) {
+    case FB_OFFSET:
+      if (Tcl_GetWideIntFromObj(interp, objv[i+1], &offset) != TCL_OK)
+	return TCL_ERROR;
+      break;
+    case FB_STRIDE:
+      if (Tcl_GetWideIntFromObj(interp, objv[i+1], &stride) != TCL_OK)
+	return TCL_ERROR;
+      break;
+    case FB_COUNT:
+      if (Tcl_GetWideIntFromObj(interp, objv[i+1], &count) != TCL_OK)
+	return TCL_ERROR;
+      break;
+    case FB_BYTEORDER:
+      if (tclGetByteOrderFromObj(interp, objv[i+1], &swap) != TCL_OK)
+	return TCL_ERROR;
+      break;
+    }
+  }
+  if (!stride) stride = size;
+  if (offset < 0 || stride < size) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]),
+		     ": offset must be >= 0 and stride >= the element size",
+		     NULL);
+    return TCL_ERROR;
+  }
+
+  if (!(bytes = Tcl_GetByteArrayFromObj(objv[2], &length))) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": invalid bytearray",
+		     NULL);
+    return TCL_ERROR;
+  }
+  fit = (length - offset >= size) ? (length - offset - size) / stride + 1 : 0;
+  if (count < 0) count = fit;
+  else if (count > fit) {
+    char resultstr[128];
+    snprintf(resultstr, sizeof(resultstr),
+	     "%s: %lld elements do not fit in %lld bytes",
+	     Tcl_GetString(objv[0]),
+	     (long long) count, (long long) length);
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(resultstr, -1));
+    return TCL_ERROR;
+  }
+
+  if (!(dl = dfuCreateDynList(datatype, count)) || !DYN_LIST_VALS(dl)) {
+    if (dl) dfuFreeDynList(dl);
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": out of memory", NULL);
+    return TCL_ERROR;
+  }
+
+  src = bytes + offset;
+  dst = (unsigned char *) DYN_LIST_VALS(dl);
+  if (stride == size) {
+    memcpy(dst, src, count * size);
+  }
+  else {
+    switch (size) {
+    case 1:
+      for (i = 0; i < count; i++, src += stride) dst[i] = *src;
+      break;
+    case 2:
+      for (i = 0; i < count; i++, src += stride, dst += 2) memcpy(dst, src, 2);
+      break;
+    case 4:
+      for (i = 0; i < count; i++, src += stride, dst += 4) memcpy(dst, src, 4);
+      break;
+    }
+  }
+  if (swap) tclSwapBytes((unsigned char *) DYN_LIST_VALS(dl), count, size);
+  DYN_LIST_N(dl) = count;
+
+  return tclPutList(interp, dl);
+}
+
 /*****************************************************************************
  *
  * FUNCTION
@@ -2460,6 +2837,9 @@ static DYN_GROUP *dgReadFromFile(const char *filename,
     return NULL;
   }
 
+  /* lists read into the group are carved from its arena */
+  dfuEnableDynGroupArena(dg);
+
   /* No need to uncompress a raw .dg file */
   if ((suffix = strrchr(filename, '.')) && strstr(suffix, "dg") &&
       !strstr(suffix, "dgz")) {
@@ -2538,6 +2918,7 @@ static int tclReadDynGroup (ClientData data, Tcl_Interp *interp,
       DYN_GROUP *dgold;
       if ((dgold = Tcl_GetHashValue(entryPtr))) dfuFreeDynGroup(dgold);
       Tcl_DeleteHashEntry(entryPtr);
+      dlinfo->groupGeneration++;
     }
   }
 
@@ -2553,6 +2934,7 @@ static int tclReadDynGroup (ClientData data, Tcl_Interp *interp,
       dfuFreeDynGroup(dgold);
     }
     Tcl_DeleteHashEntry(entryPtr);
+    dlinfo->groupGeneration++;
   }
 
   /*
@@ -2706,6 +3088,7 @@ static int tclDeleteDynGroup (ClientData data, Tcl_Interp *interp,
     if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dgTable, argv[i]))) {
       if ((dg = Tcl_GetHashValue(entryPtr))) dfuFreeDynGroup(dg);
       Tcl_DeleteHashEntry(entryPtr);
+      dlinfo->groupGeneration++;
     }
   
     /* 
@@ -2857,9 +3240,13 @@ static int tclAddExistingListDynGroup (ClientData data, Tcl_Interp *interp,
 
   switch (operation) {
   case DG_MOVE:
-    if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, oldname))) {
+    if ((dl = dlResultFind(&dlinfo->results, oldname))) {
+      dlResultRelease(&dlinfo->results, dl);
+    }
+    else if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, oldname))) {
       dl = Tcl_GetHashValue(entryPtr);
       Tcl_DeleteHashEntry(entryPtr);
+      dlinfo->listGeneration++;
     }
     else {
       char *colon;
@@ -3223,50 +3610,191 @@ static int tclSetMatherr (ClientData data, Tcl_Interp *interp,
   return TCL_OK;
 }
 
-
 /*****************************************************************************
  *
  * FUNCTION
- *    tclDynListDir
+ *    tclSimdLevel
  *
  * ARGS
- *    Tcl_Interp *interp
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_simd
  *
  * DESCRIPTION
- *    Returns a list of all existing dynlists.
+ *    Return the instruction set (scalar, sse2 or avx2) used by the
+ * elementwise arithmetic, relation and math kernels, after setting
+ * it if a level (or "best") is given.
  *
  *****************************************************************************/
 
-static int tclDynListDir (ClientData data, Tcl_Interp *interp,
-			  int argc, char *argv[])
+static int tclSimdLevel (ClientData data, Tcl_Interp *interp,
+			 int argc, char *argv[])
 {
-  Tcl_HashEntry *entryPtr;
-  Tcl_HashSearch searchEntry;
-  Tcl_DString dirList;
-  DYN_LIST *dl;
-
-  DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
-  if (!dlinfo) return TCL_ERROR;
-  
-
-  Tcl_DStringInit(&dirList);
+  int level;
+  if (argc > 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " ?level?", (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (argc == 2) {
+    if (!strcmp(argv[1], "best")) level = dlSimdSupported();
+    else if (!dlSimdLevelID(argv[1], &level)) {
+      Tcl_AppendResult(interp, argv[0], ": unknown level \"", argv[1],
+		       "\" (should be scalar, sse2, avx2 or best)",
+		       (char *) NULL);
+      return TCL_ERROR;
+    }
+    if (dlSimdSetLevel(level) < 0) {
+      Tcl_AppendResult(interp, argv[0], ": ", argv[1], 
+		       " not supported on this cpu", (char *) NULL);
+      return TCL_ERROR;
+    }
+  }
+  Tcl_SetResult(interp, dlSimdLevelName(dlSimdLevel()), TCL_STATIC);
+  return TCL_OK;
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclThreads
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_threads
+ *
+ * DESCRIPTION
+ *    Return the number of threads used for per sublist reductions
+ * (dl_means, dl_stds, dl_sums, dl_maxs ...), after setting it if given
+ * (0 for one per processor).  The optional second argument is the
+ * total number of elements below which the work is done serially.
+ *
+ *****************************************************************************/
+
+static int tclThreads (ClientData data, Tcl_Interp *interp,
+		       int argc, char *argv[])
+{
+  int nthreads, threshold;
+
+  if (argc > 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " ?nthreads? ?minsize?",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (argc > 1) {
+    if (Tcl_GetInt(interp, argv[1], &nthreads) != TCL_OK) return TCL_ERROR;
+    if (nthreads < 0) {
+      Tcl_AppendResult(interp, argv[0], ": nthreads must be >= 0",
+		       (char *) NULL);
+      return TCL_ERROR;
+    }
+  }
+  if (argc > 2) {
+    if (Tcl_GetInt(interp, argv[2], &threshold) != TCL_OK) return TCL_ERROR;
+    if (threshold < 0) {
+      Tcl_AppendResult(interp, argv[0], ": minsize must be >= 0",
+		       (char *) NULL);
+      return TCL_ERROR;
+    }
+    dlThreadsSetThreshold((DL_SIZE) threshold);
+  }
+  if (argc > 1) dlThreadsSet(nthreads);
+  Tcl_SetObjResult(interp, Tcl_NewIntObj(dlThreadsGet()));
+  return TCL_OK;
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclSetFastMath
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_setFastMath
+ *
+ * DESCRIPTION
+ *    Allow dl_exp, dl_log and dl_sin on float lists to use vector
+ * approximations (a few ulp from libm) instead of exact results.
+ * Returns the previous setting.
+ *
+ *****************************************************************************/
+
+static int tclSetFastMath (ClientData data, Tcl_Interp *interp,
+			   int argc, char *argv[])
+{
+  int status;
+  if (argc < 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " status", (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (Tcl_GetInt(interp, argv[1], &status) != TCL_OK)  return TCL_ERROR;
+  Tcl_SetObjResult(interp, Tcl_NewIntObj(dlSimdSetFastMath(status)));
+  return TCL_OK;
+}
+
+
+/* one {name datatype n max} entry of dl_dir */
+
+static void tclDynListDirEntry(Tcl_DString *dirList, char *name, DYN_LIST *dl)
+{
+  char buf[32];
+  Tcl_DStringStartSublist(dirList);
+  Tcl_DStringAppendElement(dirList, name);
+  Tcl_DStringAppendElement(dirList, 
+			   dynGetDatatypeName(DYN_LIST_DATATYPE(dl)));
+  sprintf(buf, "%lld", (long long) DYN_LIST_N(dl));
+  Tcl_DStringAppendElement(dirList, buf);
+  sprintf(buf, "%lld", (long long) DYN_LIST_MAX(dl));
+  Tcl_DStringAppendElement(dirList, buf);
+  Tcl_DStringEndSublist(dirList);
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDynListDir
+ *
+ * ARGS
+ *    Tcl_Interp *interp
+ *
+ * DESCRIPTION
+ *    Returns a list of all existing dynlists.
+ *
+ *****************************************************************************/
+
+static int tclDynListDir (ClientData data, Tcl_Interp *interp,
+			  int argc, char *argv[])
+{
+  Tcl_HashEntry *entryPtr;
+  Tcl_HashSearch searchEntry;
+  Tcl_DString dirList;
+  DL_RESULT *result;
+  int i;
+
+  DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
+  if (!dlinfo) return TCL_ERROR;
+  
+
+  Tcl_DStringInit(&dirList);
   entryPtr = Tcl_FirstHashEntry(&dlinfo->dlTable, &searchEntry);
 
   if (entryPtr) {
     do {
-      char buf[16];
-      Tcl_DStringStartSublist(&dirList);
-      dl = (DYN_LIST *) Tcl_GetHashValue(entryPtr);
-      Tcl_DStringAppendElement(&dirList, Tcl_GetHashKey(&dlinfo->dlTable, entryPtr));
-      Tcl_DStringAppendElement(&dirList, 
-			       dynGetDatatypeName(DYN_LIST_DATATYPE(dl)));
-      sprintf(buf, "%d", DYN_LIST_N(dl));
-      Tcl_DStringAppendElement(&dirList, buf);
-      sprintf(buf, "%d", DYN_LIST_MAX(dl));
-      Tcl_DStringAppendElement(&dirList, buf);
-      Tcl_DStringEndSublist(&dirList);
+      tclDynListDirEntry(&dirList, Tcl_GetHashKey(&dlinfo->dlTable, entryPtr),
+			 (DYN_LIST *) Tcl_GetHashValue(entryPtr));
     } while ((entryPtr = Tcl_NextHashEntry(&searchEntry)) != NULL);
   }
+
+  /* and the temporary lists returned by commands (skipping empty slots */
+  /* and the tombstones of removed ones, which have no list)            */
+  for (i = 0; i < dlinfo->results.size; i++) {
+    if ((result = dlinfo->results.slots[i]) && result->dl)
+      tclDynListDirEntry(&dirList, DYN_LIST_NAME(result->dl), result->dl);
+  }
   Tcl_DStringResult(interp, &dirList);
   return TCL_OK;
 }
@@ -3288,14 +3816,16 @@ static int tclDynListDir (ClientData data, Tcl_Interp *interp,
  *****************************************************************************/
 
 static int tclDynListExists (ClientData data, Tcl_Interp *interp,
-			     int argc, char *argv[])
+			     int objc, Tcl_Obj * const objv[])
 {
-  if (argc < 2) {
-      Tcl_AppendResult(interp, "usage: ", argv[0], " name", NULL);
+  DYN_LIST *dl;
+
+  if (objc < 2) {
+      Tcl_AppendResult(interp, "usage: ", Tcl_GetString(objv[0]), " name", NULL);
       return TCL_ERROR;
   }
 
-  if (tclFindDynList(interp, argv[1], NULL) == TCL_OK)
+  if (Tcl_GetDynListFromObj(interp, objv[1], &dl) == TCL_OK)
     Tcl_SetObjResult(interp, Tcl_NewIntObj(1));
   else 
     Tcl_SetObjResult(interp, Tcl_NewIntObj(0));
@@ -3414,13 +3944,12 @@ static int tclCreateDynList (ClientData data, Tcl_Interp *interp,
 			     int argc, char *argv[])
 {
   DYN_LIST *dl;
-  Tcl_HashEntry *entryPtr;
+  Tcl_Obj *obj;
 
   DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
   if (!dlinfo) return TCL_ERROR;
 
-  int newentry, datatype = DF_LONG, increment = dlinfo->DefaultListIncrement;
-  char listname[256];
+  int datatype = DF_LONG, increment = dlinfo->DefaultListIncrement;
   int i, startindex;		/* first optional arg */
 
   if (data == 0) {		/* dl_create */
@@ -3437,90 +3966,82 @@ static int tclCreateDynList (ClientData data, Tcl_Interp *interp,
     startindex = 1;
   }
 
-  /* One of two places new temporary lists are created */
-  /*   also see tclPutList, which converts an existing */
-  /*   dynlist into a dynlist for dlsh...              */
-  if (dlinfo->TmpListRecordList) dfuAddDynListLong(dlinfo->TmpListRecordList, dlinfo->dlCount);
-  sprintf(listname, "%%list%d%%", dlinfo->dlCount++);
-
-  if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, listname))) {
-    Tcl_AppendResult(interp,
-		     "dl_create: list ", listname, " already exists", NULL);
+  if (!(dl = dfuCreateDynList(datatype, increment))) {
+    Tcl_SetResult(interp, "dl_create: error creating new dynlist", TCL_STATIC);
     return TCL_ERROR;
   }
-
-  if (!(dl = dfuCreateNamedDynList(listname, datatype, increment))) {
-    Tcl_SetResult(interp, "dl_create: error creating new dynlist", TCL_STATIC);
+  if (tclPutList(interp, dl) != TCL_OK) {
+    dfuFreeDynList(dl);
     return TCL_ERROR;
   }
 
-  /*
-   * Add to hash table which contains list of open dynlists
-   */
-  entryPtr = Tcl_CreateHashEntry(&dlinfo->dlTable, listname, &newentry);
-  Tcl_SetHashValue(entryPtr, dl);
-
-  /* NEW!!! */
-  /* Add a local variable that will, when the current proc exits, free list */
-  Tcl_SetVar(interp, listname, listname, 0);
-  Tcl_TraceVar(interp, listname, 
-	       TCL_TRACE_WRITES | TCL_TRACE_UNSETS, 
-	       (Tcl_VarTraceProc *) tclDeleteLocalDynList, 
-	       (ClientData) strdup(listname));
+  /* hold on to the result while dl_append replaces it */
+  obj = Tcl_GetObjResult(interp);
+  Tcl_IncrRefCount(obj);
   
   for (i = startindex; i < argc; i++) {
     if (argv[i][0]) {		/* as int as it's not the empty string */
-      if (Tcl_VarEval(interp, "dl_append ", listname, " {", argv[i], "}", 
-		      (char *) NULL) != TCL_OK) {
+      if (Tcl_VarEval(interp, "dl_append ", Tcl_GetString(obj), " {", argv[i],
+		      "}", (char *) NULL) != TCL_OK) {
+	Tcl_DecrRefCount(obj);
 	return TCL_ERROR;
       }
     }
   }
   
-  Tcl_SetResult(interp, listname, TCL_VOLATILE);
+  Tcl_SetObjResult(interp, obj);
+  Tcl_DecrRefCount(obj);
   return TCL_OK;
 }
 
+/*
+ * Names dl %list#% and wraps it in a result object that owns it (see
+ * dlobj.c).  Lists made while temps are pushed are recorded so that
+ * dl_popTemps can free them.
+ */
+
+static Tcl_Obj *tclNewResultObj(Tcl_Interp *interp, DLSHINFO *dlinfo,
+				DYN_LIST *dl)
+{
+  Tcl_Obj *obj;
+  char listname[32];
+  int id = dlinfo->dlCount++;
+
+  sprintf(listname, "%%list%d%%", id);
+  if (!(obj = dlResultNewObj(&dlinfo->results, dl, id))) {
+    Tcl_AppendResult(interp, "dl_create: list ",
+		     listname, " already exists", NULL);
+    return NULL;
+  }
+  if (dlinfo->TmpListRecordList) dfuAddDynListLong(dlinfo->TmpListRecordList, id);
+  strncpy(DYN_LIST_NAME(dl), listname, DYN_LIST_NAME_SIZE-1);
+  return obj;
+}
+
+/*
+ * Returns dl as a temporary list: the interp result becomes an object
+ * owning it, and any object the script copies that into keeps it too.
+ */
+
 int tclPutList(Tcl_Interp *interp, DYN_LIST *dl) 
 {
-  Tcl_HashEntry *entryPtr;
-  int newentry;
-  char listname[128];
+  Tcl_Obj *obj;
 
   DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
   if (!dlinfo) return TCL_ERROR;
 
-  if (dlinfo->TmpListRecordList) dfuAddDynListLong(dlinfo->TmpListRecordList, dlinfo->dlCount);
-  sprintf(listname, "%%list%d%%", dlinfo->dlCount++);
-
-  if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, listname))) {
-    Tcl_AppendResult(interp, "dl_create: list ",
-		     listname, " already exists", NULL);
-    return TCL_ERROR;
-  }
-  
   if (!dl) {
     Tcl_SetResult(interp, "tclPutList: attempted to add NULL list ptr",
 		  TCL_STATIC);
     return TCL_ERROR;
   }
 
-  if (listname != DYN_LIST_NAME(dl))
-    strncpy(DYN_LIST_NAME(dl), listname, DYN_LIST_NAME_SIZE-1);
-  /*
-   * Add to hash table which contains list of open dynlists
-   */
-  entryPtr = Tcl_CreateHashEntry(&dlinfo->dlTable, listname, &newentry);
-  Tcl_SetHashValue(entryPtr, dl);
+  if (!(obj = tclNewResultObj(interp, dlinfo, dl))) return TCL_ERROR;
 
-  /* NEW!!! */
-  /* Add a local variable that will, when the current proc exits, free list */
-  Tcl_SetVar(interp, listname, listname, 0);
-  Tcl_TraceVar(interp, listname, TCL_TRACE_WRITES | TCL_TRACE_UNSETS, 
-	       (Tcl_VarTraceProc *) tclDeleteLocalDynList, 
-	       (ClientData) strdup(listname));
+  /* The current frame's holder keeps it until the proc exits */
+  dlResultHold(interp, &dlinfo->results, obj);
 
-  Tcl_SetResult(interp, listname, TCL_VOLATILE);
+  Tcl_SetObjResult(interp, obj);
   return TCL_OK;
 }
 
@@ -3558,13 +4079,17 @@ static int tclDeleteDynList (ClientData data, Tcl_Interp *interp,
   }
 
   for (i = 1; i < argc; i++) {
-    if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, argv[i]))) {
+    if (argv[i][0] == '%' && dlResultDelete(&dlinfo->results, argv[i])) {
+      continue;
+    }
+    else if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, argv[i]))) {
       if (Tcl_GetVar(interp, argv[i], 0)) {
 	Tcl_UnsetVar(interp, argv[i], 0);
       }
       else {
 	if ((dl = Tcl_GetHashValue(entryPtr))) dfuFreeDynList(dl);
 	Tcl_DeleteHashEntry(entryPtr);
+	dlinfo->listGeneration++;
       }
     }
   
@@ -3580,6 +4105,7 @@ static int tclDeleteDynList (ClientData data, Tcl_Interp *interp,
 	Tcl_VarEval(interp, "dl_delete ", Tcl_GetHashKey(&dlinfo->dlTable, entryPtr),
 		    (char *) NULL);
       }
+      dlResultDeleteAll(&dlinfo->results);
     }
 
     else if (tclFindDynListInGroup(interp, argv[i], &dg, &groupid) == TCL_OK) {
@@ -3636,6 +4162,7 @@ static int tclDeleteTraceDynList (ClientData data, Tcl_Interp *interp,
     else {
       if ((dl = Tcl_GetHashValue(entryPtr))) dfuFreeDynList(dl);
       Tcl_DeleteHashEntry(entryPtr);
+      dlinfo->listGeneration++;
     }
   }
   return TCL_OK;
@@ -3669,6 +4196,8 @@ static int tclCleanDynList (ClientData data, Tcl_Interp *interp,
 
   DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
   if (!dlinfo) return TCL_ERROR;
+
+  if (mode == DL_CLEAN_TEMPS) dlResultDeleteAll(&dlinfo->results);
   
   for (entryPtr = Tcl_FirstHashEntry(&dlinfo->dlTable, &search);
        entryPtr != NULL;
@@ -3721,6 +4250,28 @@ static int tclRenameDynList (ClientData data, Tcl_Interp *interp,
 }
 
 
+/*
+ * If dl is a temporary (%#%) or returned (>#<) top level list, takes it
+ * from whatever owns it -- its result objects or the dlTable -- so the
+ * caller can give it a new name, and returns 1.  Other lists (sublists,
+ * lists in groups, named lists) are left alone and must be copied.
+ */
+
+static int tclTakeTempList(DLSHINFO *dlinfo, DYN_LIST *dl)
+{
+  Tcl_HashEntry *entryPtr;
+
+  if (DYN_LIST_FLAGS(dl) & DL_SUBLIST) return 0;
+  if (dlResultRelease(&dlinfo->results, dl)) return 1;
+  if ((DYN_LIST_NAME(dl)[0] == '%' || DYN_LIST_NAME(dl)[0] == '>') &&
+      (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, DYN_LIST_NAME(dl)))) {
+    Tcl_DeleteHashEntry(entryPtr);
+    dlinfo->listGeneration++;
+    return 1;
+  }
+  return 0;
+}
+
 /*****************************************************************************
  *
  * FUNCTION
@@ -3804,11 +4355,7 @@ static int tclSetDynList (ClientData data, Tcl_Interp *interp,
       if (tclFindDynList(interp, newname, &newdl) != TCL_OK ||
 	  !(DYN_LIST_FLAGS(newdl) & DL_SUBLIST)) { 
 	Tcl_ResetResult(interp);
-	if ((DYN_LIST_NAME(dl)[0] == '%' || DYN_LIST_NAME(dl)[0] == '>') &&
-	    (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, DYN_LIST_NAME(dl))) &&
-	    !(DYN_LIST_FLAGS(dl) & DL_SUBLIST)) {
-	  Tcl_DeleteHashEntry(entryPtr);
-	  
+	if (tclTakeTempList(dlinfo, dl)) {
 	  strncpy(DYN_LIST_NAME(dl), colon+1, DYN_LIST_NAME_SIZE-1);
 	  dfuAddDynGroupExistingList(dg, DYN_LIST_NAME(dl), dl);
 	}
@@ -3838,6 +4385,7 @@ static int tclSetDynList (ClientData data, Tcl_Interp *interp,
   else if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable,newname))) {
     if ((newdl = Tcl_GetHashValue(entryPtr))) dfuFreeDynList(newdl);
     Tcl_DeleteHashEntry(entryPtr);
+    dlinfo->listGeneration++;
     newdl = NULL;
   }
   
@@ -3846,11 +4394,7 @@ static int tclSetDynList (ClientData data, Tcl_Interp *interp,
   /*    groups and must be copied)                         */
   /*  as can a return list found in the dlTable            */
 
-  if ((DYN_LIST_NAME(dl)[0] == '%' || DYN_LIST_NAME(dl)[0] == '>') &&
-      (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, DYN_LIST_NAME(dl))) &&
-      !(DYN_LIST_FLAGS(dl) & DL_SUBLIST)) {
-    Tcl_DeleteHashEntry(entryPtr);
-
+  if (tclTakeTempList(dlinfo, dl)) {
     /* Change the element of the group */
     if (replace_grouplist) {
       strncpy(DYN_LIST_NAME(dl), strchr(newname,':')+1, DYN_LIST_NAME_SIZE-1);
@@ -3920,6 +4464,7 @@ static int tclSetDynList (ClientData data, Tcl_Interp *interp,
 	DYN_LIST *olddl;
 	if ((olddl = Tcl_GetHashValue(entryPtr))) dfuFreeDynList(olddl);
 	Tcl_DeleteHashEntry(entryPtr);
+	dlinfo->listGeneration++;
       }
 
       entryPtr = Tcl_CreateHashEntry(&dlinfo->dlTable, newname, &newentry);
@@ -3951,6 +4496,7 @@ static char *tclDeleteLocalDynList(ClientData clientData, Tcl_Interp *interp,
       dfuFreeDynList(dl);
     }
     Tcl_DeleteHashEntry(entryPtr);
+    dlinfo->listGeneration++;
   }
 
   /*
@@ -4037,11 +4583,7 @@ static int tclLocalDynList (ClientData data, Tcl_Interp *interp,
   /*    groups and must be copied)                         */
   /* Return lists (>#<) can also be renamed                */
 
-  if ((DYN_LIST_NAME(dl)[0] == '%' || DYN_LIST_NAME(dl)[0] == '>') &&
-      (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, DYN_LIST_NAME(dl))) &&
-      !(DYN_LIST_FLAGS(dl) & DL_SUBLIST)) {
-    Tcl_DeleteHashEntry(entryPtr);
-
+  if (tclTakeTempList(dlinfo, dl)) {
     if (Tcl_GetVar(interp, DYN_LIST_NAME(dl), 0)) {
       Tcl_UntraceVar(interp, DYN_LIST_NAME(dl), 
 		     TCL_TRACE_WRITES | TCL_TRACE_UNSETS, 
@@ -4100,13 +4642,16 @@ static int tclLocalDynList (ClientData data, Tcl_Interp *interp,
  *         proc mk {} { return [dl_return [some_builder ...]] }
  *   - At the top level (info level 0) no trace is installed, so a top-level
  *     dl_return persists until dl_clean / interp teardown.
+ *   - A plain temp handed back with "return [cmd ...]" is different: it is
+ *     owned by its Tcl_Objs (see tclPutList), so it lives as long as the
+ *     caller keeps the value.
  *
  *****************************************************************************/
 
 static int tclReturnDynList (ClientData data, Tcl_Interp *interp,
 			     int argc, char *argv[])
 {
-  Tcl_HashEntry *entryPtr;
+  Tcl_HashEntry *entryPtr = NULL;
   int newentry;
   DYN_LIST *dl;
   char newname[256];
@@ -4130,11 +4675,14 @@ static int tclReturnDynList (ClientData data, Tcl_Interp *interp,
   /*   dl_return'ed, though!                               */
 
   if (argv[1][0] != '>' &&
-      (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, DYN_LIST_NAME(dl)))) {
-    Tcl_DeleteHashEntry(entryPtr);
-    
-    if (Tcl_GetVar(interp, DYN_LIST_NAME(dl), 0)) 
-      Tcl_UnsetVar(interp, DYN_LIST_NAME(dl), 0);
+      (dlResultRelease(&dlinfo->results, dl) ||
+       (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, DYN_LIST_NAME(dl))))) {
+    if (entryPtr) {
+      Tcl_DeleteHashEntry(entryPtr);
+      dlinfo->listGeneration++;
+      if (Tcl_GetVar(interp, DYN_LIST_NAME(dl), 0)) 
+	Tcl_UnsetVar(interp, DYN_LIST_NAME(dl), 0);
+    }
     
     strncpy(DYN_LIST_NAME(dl), newname, DYN_LIST_NAME_SIZE-1);
     entryPtr = Tcl_CreateHashEntry(&dlinfo->dlTable, newname, &newentry);
@@ -4240,6 +4788,7 @@ static int tclPopTmpList (ClientData data, Tcl_Interp *interp,
       vals = (int *) DYN_LIST_VALS(dlinfo->TmpListRecordList);
       for (i = 0; i < DYN_LIST_N(dlinfo->TmpListRecordList); i++) {
 	sprintf(listname, "%%list%d%%", vals[i]);
+	if (dlResultDelete(&dlinfo->results, listname)) continue;
 	if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, listname))) {
 
 
@@ -4247,6 +4796,7 @@ static int tclPopTmpList (ClientData data, Tcl_Interp *interp,
 
 
 	  Tcl_DeleteHashEntry(entryPtr);
+	  dlinfo->listGeneration++;
 	}
       }
       
@@ -4279,6 +4829,7 @@ static int tclPopTmpList (ClientData data, Tcl_Interp *interp,
   vals = (int *) DYN_LIST_VALS(dlinfo->TmpListRecordList);
   for (i = 0; i < DYN_LIST_N(dlinfo->TmpListRecordList); i++) {
     sprintf(listname, "%%list%d%%", vals[i]);
+    if (dlResultDelete(&dlinfo->results, listname)) continue;
     if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, listname))) {
       if (Tcl_GetVar(interp, listname, 0)) {
 	Tcl_UnsetVar(interp, listname, 0);
@@ -4286,6 +4837,7 @@ static int tclPopTmpList (ClientData data, Tcl_Interp *interp,
       else {
 	if ((dl = Tcl_GetHashValue(entryPtr))) dfuFreeDynList(dl);
 	Tcl_DeleteHashEntry(entryPtr);
+	dlinfo->listGeneration++;
       }
     }
   }
@@ -4320,44 +4872,56 @@ static int tclPopTmpList (ClientData data, Tcl_Interp *interp,
  *****************************************************************************/
 
 static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
-			     int argc, char *argv[])
+			     int objc, Tcl_Obj * const objv[])
 {
   DYN_LIST *dl = NULL;
   int mode = (Tcl_Size) data;
   int i;
 
   if (mode == DL_FIRST || mode == DL_LAST || mode == DL_PICKONE) {
-    if (argc < 2) {
-      Tcl_AppendResult(interp, "usage: ", argv[0], " dynlist", (char *) NULL);
+    if (objc < 2) {
+      Tcl_AppendResult(interp, "usage: ", Tcl_GetString(objv[0]), " dynlist", (char *) NULL);
       return TCL_ERROR;
     }
-    if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+    if (Tcl_GetDynListFromObj(interp, objv[1], &dl) != TCL_OK) return TCL_ERROR;
     if (!DYN_LIST_N(dl)) return TCL_OK;
     
     switch (mode) {
     case DL_FIRST: i = 0; break;
     case DL_LAST: i = DYN_LIST_N(dl)-1; break;
-    case DL_PICKONE: i = ran(DYN_LIST_N(dl)); break;
+    case DL_PICKONE:
+      {
+	DL_RNG rng;
+	dlRngNext(&rng);
+	dlRngInts(&rng, 1, DYN_LIST_N(dl), &i);
+      }
+      break;
     }
   }
-  else if (mode == DL_PUT && argc < 4) {
-    Tcl_AppendResult(interp, "usage: ", argv[0], " dynlist index newval", 
+  else if (mode == DL_PUT && objc < 4) {
+    Tcl_AppendResult(interp, "usage: ", Tcl_GetString(objv[0]), " dynlist index newval", 
 		     (char *) NULL);
     return TCL_ERROR;
   }
-  else if (argc < 3) {
-    Tcl_AppendResult(interp, "usage: ", argv[0], " dynlist index", 
+  else if (objc < 3) {
+    Tcl_AppendResult(interp, "usage: ", Tcl_GetString(objv[0]), " dynlist index", 
 		     (char *) NULL);
     return TCL_ERROR;
   }
   else {
-    if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
-    if (Tcl_GetInt(interp, argv[2], &i) != TCL_OK) return TCL_ERROR;
+    if (Tcl_GetDynListFromObj(interp, objv[1], &dl) != TCL_OK) return TCL_ERROR;
+    if (Tcl_GetIntFromObj(interp, objv[2], &i) != TCL_OK) return TCL_ERROR;
   }
 
   
   if (i < 0 || i >= DYN_LIST_N(dl)) {
-    Tcl_AppendResult(interp, argv[0], ": index out of range", NULL);
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": index out of range", NULL);
+    return TCL_ERROR;
+  }
+
+  /* values may be shared with copies of this list */
+  if (mode == DL_PUT && !dfuUnshareDynList(dl)) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": out of memory", NULL);
     return TCL_ERROR;
   }
 
@@ -4367,11 +4931,11 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
       int *vals = (int *) DYN_LIST_VALS(dl);
       if (mode == DL_PUT) {
 	int element;
-	if (Tcl_GetInt(interp, argv[3], &element) != TCL_OK) {
+	if (Tcl_GetIntFromObj(interp, objv[3], &element) != TCL_OK) {
 	  return TCL_ERROR;
 	}
 	vals[i] = element;
-	Tcl_AppendResult(interp, argv[1], NULL);	
+	Tcl_SetObjResult(interp, objv[1]);	
       }
       else Tcl_SetObjResult(interp, Tcl_NewIntObj(vals[i]));
       break;
@@ -4381,11 +4945,11 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
       short *vals = (short *) DYN_LIST_VALS(dl);
       if (mode == DL_PUT) {
 	int element;
-	if (Tcl_GetInt(interp, argv[3], &element) != TCL_OK) {
+	if (Tcl_GetIntFromObj(interp, objv[3], &element) != TCL_OK) {
 	  return TCL_ERROR;
 	}
 	vals[i] = (short) element;
-	Tcl_AppendResult(interp, argv[1], NULL);	
+	Tcl_SetObjResult(interp, objv[1]);	
       }
       else Tcl_SetObjResult(interp, Tcl_NewIntObj(vals[i]));
       break;
@@ -4395,11 +4959,11 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
        char *vals = (char *) DYN_LIST_VALS(dl);
        if (mode == DL_PUT) {
 	int element;
-	if (Tcl_GetInt(interp, argv[3], &element) != TCL_OK) {
+	if (Tcl_GetIntFromObj(interp, objv[3], &element) != TCL_OK) {
 	  return TCL_ERROR;
 	}
 	vals[i] = (char) element;
-	Tcl_AppendResult(interp, argv[1], NULL);	
+	Tcl_SetObjResult(interp, objv[1]);	
       }
       else Tcl_SetObjResult(interp, Tcl_NewIntObj(vals[i]));
       break;
@@ -4409,11 +4973,11 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
        float *vals = (float *) DYN_LIST_VALS(dl);
        if (mode == DL_PUT) {
 	double element;
-	if (Tcl_GetDouble(interp, argv[3], &element) != TCL_OK) {
+	if (Tcl_GetDoubleFromObj(interp, objv[3], &element) != TCL_OK) {
 	  return TCL_ERROR;
 	}
 	vals[i] = (float) element;
-	Tcl_AppendResult(interp, argv[1], NULL);	
+	Tcl_SetObjResult(interp, objv[1]);	
       }
       else Tcl_SetObjResult(interp, Tcl_NewDoubleObj(vals[i]));
       break;
@@ -4422,10 +4986,11 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
     {
       char **vals = (char **) DYN_LIST_VALS(dl);
       if (mode == DL_PUT) {
+	const char *str = Tcl_GetString(objv[3]);
 	if (vals[i]) free((void *) vals[i]);
-	vals[i] = malloc(strlen(argv[3])+1);
-	strcpy(vals[i], argv[3]);
-	Tcl_AppendResult(interp, argv[1], NULL);
+	vals[i] = malloc(strlen(str)+1);
+	strcpy(vals[i], str);
+	Tcl_SetObjResult(interp, objv[1]);
       }
       else {
 	Tcl_SetResult(interp, vals[i], TCL_VOLATILE);
@@ -4437,10 +5002,10 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
       DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
       if (mode == DL_PUT) {
 	DYN_LIST *dl;
-	if (tclFindDynList(interp, argv[3], &dl) != TCL_OK) return TCL_ERROR;
+	if (Tcl_GetDynListFromObj(interp, objv[3], &dl) != TCL_OK) return TCL_ERROR;
 	if (vals[i]) dfuFreeDynList(vals[i]);
 	vals[i] = dfuCopyDynList(dl);
-	Tcl_AppendResult(interp, argv[1], NULL);
+	Tcl_SetObjResult(interp, objv[1]);
       }
       else if (vals[i]) {
 	return(tclPutList(interp, dfuCopyDynList(vals[i])));
@@ -4448,7 +5013,7 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
       break;
     }
   default:
-    Tcl_AppendResult(interp, argv[0], ": invalid datatype", (char *) NULL);
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": invalid datatype", (char *) NULL);
     return TCL_ERROR;
     break;
   }
@@ -4456,6 +5021,73 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
 }
 
 
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclAppendDynListBulk
+ *
+ * ARGS
+ *    Tcl_Interp *interp, DYN_LIST *dl, char *vals
+ *
+ * DESCRIPTION
+ *    Converts a Tcl list of numeric values into the datatype of dl
+ *  and appends them all with a single dfuAppendDynListN.
+ *
+ *****************************************************************************/
+
+static int tclAppendDynListBulk(Tcl_Interp *interp, DYN_LIST *dl, char *vals)
+{
+  Tcl_Size i, n;
+  const char **elts;
+  void *buf;
+  int ival, status = TCL_OK;
+  double dval;
+
+  if (Tcl_SplitList(interp, vals, &n, &elts) != TCL_OK) return TCL_ERROR;
+  if (!n) {
+    Tcl_Free((char *) elts);
+    return TCL_OK;
+  }
+
+  buf = malloc((size_t) n * dfuDynListElementSize(DYN_LIST_DATATYPE(dl)));
+  if (!buf) {
+    Tcl_Free((char *) elts);
+    Tcl_AppendResult(interp, "dl_append: out of memory", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  for (i = 0; i < n && status == TCL_OK; i++) {
+    switch (DYN_LIST_DATATYPE(dl)) {
+    case DF_LONG:
+      if ((status = Tcl_GetInt(interp, elts[i], &ival)) == TCL_OK)
+	((int *) buf)[i] = ival;
+      break;
+    case DF_SHORT:
+      if ((status = Tcl_GetInt(interp, elts[i], &ival)) == TCL_OK)
+	((short *) buf)[i] = ival;
+      break;
+    case DF_CHAR:
+      if ((status = Tcl_GetInt(interp, elts[i], &ival)) == TCL_OK)
+	((unsigned char *) buf)[i] = ival;
+      break;
+    case DF_FLOAT:
+      if ((status = Tcl_GetDouble(interp, elts[i], &dval)) == TCL_OK)
+	((float *) buf)[i] = dval;
+      break;
+    }
+  }
+
+  if (status == TCL_OK && dfuAppendDynListN(dl, buf, n) < 0) {
+    Tcl_AppendResult(interp, "dl_append: unable to grow list", (char *) NULL);
+    status = TCL_ERROR;
+  }
+
+  free(buf);
+  Tcl_Free((char *) elts);
+  return status;
+}
+
+
 /*****************************************************************************
  *
  * FUNCTION
@@ -4468,7 +5100,9 @@ static int tclGetPutDynList (ClientData data, Tcl_Interp *interp,
  *    dl_append
  *
  * DESCRIPTION
- *    Appends an element to a dynlist
+ *    Appends an element to a dynlist.  For numeric lists, dl_append
+ *  also accepts Tcl lists of values (dl_append $l {1 2 3}), which are
+ *  converted and appended in bulk.
  *
  *****************************************************************************/
 
@@ -4538,13 +5172,21 @@ static int tclAppendDynList (ClientData data, Tcl_Interp *interp,
     if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
   }
 
+  /* Make room for all scalar arguments at once */
+  if (argc - start > 1) dfuReserveDynList(dl, DYN_LIST_N(dl) + argc - start);
+
   switch (DYN_LIST_DATATYPE(dl)) {
   case DF_LONG:
     {
       int element;
       for (i = start; i < argc; i++, pos++) {
 	if (Tcl_GetInt(interp, argv[i], &element) != TCL_OK) {
-	  return TCL_ERROR;
+	  if (mode != DL_APPEND || !strpbrk(argv[i], " \t\n")) 
+	    return TCL_ERROR;
+	  Tcl_ResetResult(interp);
+	  if (tclAppendDynListBulk(interp, dl, argv[i]) != TCL_OK)
+	    return TCL_ERROR;
+	  continue;
 	}
 	switch (mode) {
 	case DL_APPEND:    dfuAddDynListLong(dl, element);          break;
@@ -4559,7 +5201,12 @@ static int tclAppendDynList (ClientData data, Tcl_Interp *interp,
       int element;
       for (i = start; i < argc; i++, pos++) {
 	if (Tcl_GetInt(interp, argv[i], &element) != TCL_OK) {
-	  return TCL_ERROR;
+	  if (mode != DL_APPEND || !strpbrk(argv[i], " \t\n")) 
+	    return TCL_ERROR;
+	  Tcl_ResetResult(interp);
+	  if (tclAppendDynListBulk(interp, dl, argv[i]) != TCL_OK)
+	    return TCL_ERROR;
+	  continue;
 	}
 	switch (mode) {
 	case DL_APPEND:    dfuAddDynListShort(dl, element);          break;
@@ -4574,7 +5221,12 @@ static int tclAppendDynList (ClientData data, Tcl_Interp *interp,
       int element;
       for (i = start; i < argc; i++, pos++) {
 	if (Tcl_GetInt(interp, argv[i], &element) != TCL_OK) {
-	  return TCL_ERROR;
+	  if (mode != DL_APPEND || !strpbrk(argv[i], " \t\n")) 
+	    return TCL_ERROR;
+	  Tcl_ResetResult(interp);
+	  if (tclAppendDynListBulk(interp, dl, argv[i]) != TCL_OK)
+	    return TCL_ERROR;
+	  continue;
 	}
 	switch (mode) {
 	case DL_APPEND:    dfuAddDynListChar(dl, element);          break;
@@ -4589,7 +5241,12 @@ static int tclAppendDynList (ClientData data, Tcl_Interp *interp,
       double element;
       for (i = start; i < argc; i++, pos++) {
 	if (Tcl_GetDouble(interp, argv[i], &element) != TCL_OK) {
-	  return TCL_ERROR;
+	  if (mode != DL_APPEND || !strpbrk(argv[i], " \t\n")) 
+	    return TCL_ERROR;
+	  Tcl_ResetResult(interp);
+	  if (tclAppendDynListBulk(interp, dl, argv[i]) != TCL_OK)
+	    return TCL_ERROR;
+	  continue;
 	}
 	switch (mode) {
 	case DL_APPEND:    dfuAddDynListFloat(dl, element);          break;
@@ -4691,6 +5348,10 @@ static int tclConsDynList (ClientData data, Tcl_Interp *interp,
 			 (char *) NULL);
 	return TCL_ERROR;
       }
+      if (!dfuUnshareDynList(dl1)) {
+	Tcl_AppendResult(interp, argv[0], ": out of memory", (char *) NULL);
+	return TCL_ERROR;
+      }
       vals = (int *) DYN_LIST_VALS(dl1);
       vals[index]++;
       Tcl_SetObjResult(interp, Tcl_NewIntObj(vals[index]));
@@ -4896,25 +5557,252 @@ static int tclResetDynList (ClientData data, Tcl_Interp *interp,
     Tcl_AppendResult(interp, DYN_LIST_NAME(dl), NULL);
   return TCL_OK;
 }
-Tcl_Obj *tclDynListToTclObj(Tcl_Interp *interp, DYN_LIST *dl)
-{
-  int i;
-
-  if (!dl) {
-    return NULL;
-  }
 
-  Tcl_Obj *listPtr = Tcl_NewListObj(0, NULL);
 
-  switch (DYN_LIST_DATATYPE(dl)) {
-  case DF_LONG:
-    {
-      int *vals = (int *) DYN_LIST_VALS(dl);
-      for (i = 0; i < DYN_LIST_N(dl); i++) {
-	Tcl_ListObjAppendElement(interp, listPtr, Tcl_NewIntObj(vals[i]));
-      }
-    }
-    break;
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclPackStorageDynList
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_packStorage
+ *    dl_unpackStorage
+ *    dl_isPackedStorage
+ *    dg_packStorage
+ *
+ * DESCRIPTION
+ *    Switches lists of numeric lists between per-sublist storage and
+ *  packed (flat values + offsets) storage.  Packed sublists are views
+ *  and behave like ordinary lists; one that grows gets its own copy.
+ *  dl_packStorage leaves lists that cannot be packed unchanged and
+ *  dg_packStorage returns the number of columns packed.
+ *
+ *****************************************************************************/
+
+static int tclPackStorageDynList (ClientData data, Tcl_Interp *interp,
+				  int argc, char *argv[])
+{
+  DYN_LIST *dl;
+  DYN_GROUP *dg;
+  int i, npacked = 0;
+  int mode = (Tcl_Size) data;
+
+  if (argc != 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], 
+		     mode == DG_PACK_STORAGE ? " dyngroup" : " dynlist", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (mode == DG_PACK_STORAGE) {
+    if (tclFindDynGroup(interp, argv[1], &dg) != TCL_OK) return TCL_ERROR;
+    for (i = 0; i < DYN_GROUP_NLISTS(dg); i++) {
+      if (DYN_LIST_DATATYPE(DYN_GROUP_LIST(dg,i)) == DF_LIST &&
+	  dfuPackDynList(DYN_GROUP_LIST(dg,i))) npacked++;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(npacked));
+    return TCL_OK;
+  }
+
+  if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+
+  switch (mode) {
+  case DL_IS_PACKED_STORAGE:
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(dfuGetDynListPack(dl) != NULL));
+    return TCL_OK;
+  case DL_IS_SHARED_STORAGE:
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(dfuIsSharedDynList(dl)));
+    return TCL_OK;
+  case DL_PACK_STORAGE:
+    if (DYN_LIST_DATATYPE(dl) == DF_LIST) dfuPackDynList(dl);
+    break;
+  case DL_UNPACK_STORAGE:
+    if (!dfuUnpackDynList(dl) && DYN_LIST_DATATYPE(dl) == DF_LIST) {
+      Tcl_AppendResult(interp, argv[0], ": out of memory", (char *) NULL);
+      return TCL_ERROR;
+    }
+    break;
+  }
+
+  if (strchr(argv[1],':'))
+    Tcl_AppendResult(interp, argv[1], NULL);
+  else
+    Tcl_AppendResult(interp, DYN_LIST_NAME(dl), NULL);
+  return TCL_OK;
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDictEncodeDynList
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_dictEncode
+ *    dl_dictDecode
+ *    dl_isDictEncoded
+ *    dl_dictCodes
+ *    dl_dictStrings
+ *    dg_dictEncode
+ *
+ * DESCRIPTION
+ *    Switches string lists between one allocation per string and
+ *  dictionary encoding (an int code per element into a sorted table of
+ *  the distinct strings).  Encoded lists behave like ordinary string
+ *  lists; equality, sorting and uniques work on the codes and any
+ *  modification decodes the list first.  dl_dictCodes returns the codes
+ *  as a long list (e.g. for dl_hist or dl_countOccurences) and
+ *  dl_dictStrings the table they index.  dg_dictEncode returns the
+ *  number of columns encoded.
+ *
+ *****************************************************************************/
+
+static int tclDictEncodeDynList (ClientData data, Tcl_Interp *interp,
+				 int argc, char *argv[])
+{
+  DYN_LIST *dl, *newlist;
+  DYN_GROUP *dg;
+  DYN_DICT *dict;
+  int i, nencoded = 0;
+  int mode = (Tcl_Size) data;
+
+  if (argc != 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], 
+		     mode == DG_DICT_ENCODE ? " dyngroup" : " dynlist", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (mode == DG_DICT_ENCODE) {
+    if (tclFindDynGroup(interp, argv[1], &dg) != TCL_OK) return TCL_ERROR;
+    for (i = 0; i < DYN_GROUP_NLISTS(dg); i++) {
+      if (DYN_LIST_DATATYPE(DYN_GROUP_LIST(dg,i)) == DF_STRING &&
+	  dfuDictEncodeDynList(DYN_GROUP_LIST(dg,i))) nencoded++;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(nencoded));
+    return TCL_OK;
+  }
+
+  if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+
+  switch (mode) {
+  case DL_IS_DICT_ENCODED:
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(dfuGetDynListDict(dl) != NULL));
+    return TCL_OK;
+  case DL_DICT_CODES:
+  case DL_DICT_STRINGS:
+    if (!(dict = dfuGetDynListDict(dl))) {
+      Tcl_AppendResult(interp, argv[0], ": list \"", argv[1],
+		       "\" is not dictionary encoded", (char *) NULL);
+      return TCL_ERROR;
+    }
+    if (mode == DL_DICT_CODES) {
+      newlist = dfuCreateDynList(DF_LONG, DYN_LIST_N(dl) ? DYN_LIST_N(dl) : 1);
+      dfuAppendDynListN(newlist, DYN_LIST_CODES(dl), DYN_LIST_N(dl));
+    }
+    else {
+      newlist = dfuCreateDynList(DF_STRING, dict->nstrings ? dict->nstrings : 1);
+      dfuAppendDynListN(newlist, dict->strings, dict->nstrings);
+    }
+    return(tclPutList(interp, newlist));
+  case DL_DICT_ENCODE:
+    if (DYN_LIST_DATATYPE(dl) != DF_STRING) {
+      Tcl_AppendResult(interp, argv[0], ": list \"", argv[1],
+		       "\" is not a string list", (char *) NULL);
+      return TCL_ERROR;
+    }
+    if (!dfuDictEncodeDynList(dl)) {
+      Tcl_AppendResult(interp, argv[0], ": out of memory", (char *) NULL);
+      return TCL_ERROR;
+    }
+    break;
+  case DL_DICT_DECODE:
+    if (!dfuDictDecodeDynList(dl)) {
+      Tcl_AppendResult(interp, argv[0], ": out of memory", (char *) NULL);
+      return TCL_ERROR;
+    }
+    break;
+  }
+
+  if (strchr(argv[1],':'))
+    Tcl_AppendResult(interp, argv[1], NULL);
+  else
+    Tcl_AppendResult(interp, DYN_LIST_NAME(dl), NULL);
+  return TCL_OK;
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclReserveDynList
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_reserve
+ *
+ * DESCRIPTION
+ *    Preallocates storage so that dynlist can hold n elements without
+ *  reallocating.  The contents of the list are not changed.
+ *
+ *****************************************************************************/
+
+static int tclReserveDynList (ClientData data, Tcl_Interp *interp,
+			      int argc, char *argv[])
+{
+  DYN_LIST *dl;
+  int n;
+
+  if (argc != 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " dynlist n", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[2], &n) != TCL_OK) return TCL_ERROR;
+  if (n < 0) {
+    Tcl_AppendResult(interp, argv[0], ": n must be nonnegative", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (!dfuReserveDynList(dl, n)) {
+    Tcl_AppendResult(interp, argv[0], ": unable to reserve storage", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (strchr(argv[1],':'))
+    Tcl_AppendResult(interp, argv[1], NULL);
+  else
+    Tcl_AppendResult(interp, DYN_LIST_NAME(dl), NULL);
+  return TCL_OK;
+}
+Tcl_Obj *tclDynListToTclObj(Tcl_Interp *interp, DYN_LIST *dl)
+{
+  int i;
+
+  if (!dl) {
+    return NULL;
+  }
+
+  Tcl_Obj *listPtr = Tcl_NewListObj(0, NULL);
+
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG:
+    {
+      int *vals = (int *) DYN_LIST_VALS(dl);
+      for (i = 0; i < DYN_LIST_N(dl); i++) {
+	Tcl_ListObjAppendElement(interp, listPtr, Tcl_NewIntObj(vals[i]));
+      }
+    }
+    break;
   case DF_SHORT:
     {
       short *vals = (short *) DYN_LIST_VALS(dl);
@@ -6241,21 +7129,21 @@ static int tclDynListNot (ClientData data, Tcl_Interp *interp,
  *****************************************************************************/
 
 static int tclArithDynList (ClientData data, Tcl_Interp *interp,
-			    int argc, char *argv[])
+			    int objc, Tcl_Obj * const objv[])
 {
   int i;
   DYN_LIST *dl1, *dl2, *newlist = NULL, *newlist1;
   int operation = (Tcl_Size) data;
   int mathop = -1;
 
-  if (argc < 3) {
-    Tcl_AppendResult(interp, "usage: ", argv[0], " list1 list2 [list3...]",
+  if (objc < 3) {
+    Tcl_AppendResult(interp, "usage: ", Tcl_GetString(objv[0]), " list1 list2 [list3...]",
 		     (char *) NULL);
     return TCL_ERROR;
   }
 
-  if (tclFindDynList(interp, argv[1], &dl1) != TCL_OK) return TCL_ERROR;
-  if (tclFindDynList(interp, argv[2], &dl2) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDynListFromObj(interp, objv[1], &dl1) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDynListFromObj(interp, objv[2], &dl2) != TCL_OK) return TCL_ERROR;
   
   switch (operation) {
   case DL_ADD:       mathop = DL_MATH_ADD;     break;
@@ -6266,9 +7154,9 @@ static int tclArithDynList (ClientData data, Tcl_Interp *interp,
 
   if (mathop != -1) {		/* + - * / */
     newlist = dynListArithListList(dl1, dl2, mathop);
-    for (i = 3; i < argc; i++) {
+    for (i = 3; i < objc; i++) {
       if (!newlist) goto error;
-      if (tclFindDynList(interp, argv[i], &dl1) != TCL_OK) {
+      if (Tcl_GetDynListFromObj(interp, objv[i], &dl1) != TCL_OK) {
 	dfuFreeDynList(newlist);
 	return TCL_ERROR;
       }
@@ -6290,7 +7178,7 @@ static int tclArithDynList (ClientData data, Tcl_Interp *interp,
     /*
     if ((DYN_LIST_N(dl2) != DF_LIST) && !(DYN_LIST_N(dl2) % 2)) {
       Tcl_ResetResult(interp);
-      Tcl_AppendResult(interp, argv[0], 
+      Tcl_AppendResult(interp, Tcl_GetString(objv[0]), 
 		       ": convolution kernel must have odd number of elements",
 		       (char *) NULL);
       return TCL_ERROR;
@@ -6306,9 +7194,9 @@ static int tclArithDynList (ClientData data, Tcl_Interp *interp,
   if (!newlist) {
   error:
     Tcl_ResetResult(interp);
-    Tcl_AppendResult(interp, argv[0], 
-		     ": unable to combine \"", argv[1], "\" and \"", 
-		     argv[2], "\" arithmetically",
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), 
+		     ": unable to combine \"", Tcl_GetString(objv[1]), "\" and \"", 
+		     Tcl_GetString(objv[2]), "\" arithmetically",
 		     (char *) NULL);
     return TCL_ERROR;
   }
@@ -6420,6 +7308,123 @@ static int tclMathFuncOneArg (ClientData data, Tcl_Interp *interp,
 }
 
 
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclArithDynListInPlace
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_addInPlace
+ *    dl_subInPlace
+ *    dl_multInPlace
+ *    dl_divInPlace
+ *    dl_powInPlace
+ *    dl_atan2InPlace
+ *    dl_fmodInPlace
+ *
+ * DESCRIPTION
+ *    As dl_add etc., but the result is written into list1 rather than a
+ * new list.  Only allowed when the result would have list1's datatype
+ * and shape (so an int list can't be multiplied by a float in place).
+ * Returns list1.
+ *
+ *****************************************************************************/
+
+static int tclArithDynListInPlace (ClientData data, Tcl_Interp *interp,
+				   int argc, char *argv[])
+{
+  DYN_LIST *dl1, *dl2;
+  int mathop = (Tcl_Size) data;
+
+  if (argc != 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " list1 list2",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (tclFindDynList(interp, argv[1], &dl1) != TCL_OK) return TCL_ERROR;
+  if (tclFindDynList(interp, argv[2], &dl2) != TCL_OK) return TCL_ERROR;
+
+  if (!dynListArithListListInPlace(dl1, dl2, mathop)) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0],
+		     ": unable to combine \"", argv[1], "\" and \"",
+		     argv[2], "\" in place", (char *) NULL);
+    return TCL_ERROR;
+  }
+  Tcl_SetResult(interp, argv[1], TCL_VOLATILE);
+  return TCL_OK;
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclMathFuncOneArgInPlace
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_absInPlace, acosInPlace, ...
+ *
+ * DESCRIPTION
+ *    Elementwise math functions which replace the list's own values.
+ * Float lists take any function but ceil, floor and round; int lists
+ * abs, ceil, floor and round; short and char lists only abs.
+ *
+ *****************************************************************************/
+
+static int tclMathFuncOneArgInPlace (ClientData data, Tcl_Interp *interp,
+				     int argc, char *argv[])
+{
+  DYN_LIST *dl;
+  int operation = (Tcl_Size) data;
+  int status;
+
+  if (argc != 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " dynlist",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+
+  status = dynListMathOneArgInPlace(dl, operation);
+  if (status == 1) {
+    Tcl_SetResult(interp, argv[1], TCL_VOLATILE);
+    return TCL_OK;
+  }
+
+  Tcl_ResetResult(interp);
+  if (!status) {
+    Tcl_AppendResult(interp, argv[0], ": result for \"", argv[1],
+		     "\" would not have the same datatype", (char *) NULL);
+    return TCL_ERROR;
+  }
+  switch (operation) {
+  case DL_SQRT:
+    Tcl_AppendResult(interp, argv[0], ": list elements must be nonnegative",
+		     (char *) NULL);
+    break;
+  case DL_LOG:
+  case DL_LOG10:
+    Tcl_AppendResult(interp, argv[0], ": list elements must be positive",
+		     (char *) NULL);
+    break;
+  default:
+    Tcl_AppendResult(interp, argv[0],
+		     ": list elements must be in the range [-1,1]",
+		     (char *) NULL);
+    break;
+  }
+  return TCL_ERROR;
+}
+
+
 /*
  * Tcl command: dl_srand
  * 
@@ -6427,34 +7432,46 @@ static int tclMathFuncOneArg (ClientData data, Tcl_Interp *interp,
  *   dl_srand           - returns current seed
  *   dl_srand 0         - auto-seed from system entropy, returns new seed
  *   dl_srand <n>       - set seed to n (n > 0), returns n
+ *   dl_srand <n> <s>   - seed n, starting at stream s (s >= 0), so that
+ *                        workers seeded alike with different s draw
+ *                        independent values
  *
+ *  The seed is per thread (see dlrng.h) and also seeds the lablib
+ *  generators.
  */
 
 /* Declare external functions from randvars.c */
 extern int ranset(int seed);
-extern int ranget(void);
 
 static int tclSetRandomSeed(ClientData clientData, Tcl_Interp *interp,
                        int argc, char *argv[])
 {
-    int seed, result;
+    int seed, result, stream = 0;
     
     if (argc == 1) {
         /* No argument - return current seed */
-        Tcl_SetObjResult(interp, Tcl_NewIntObj(ranget()));
+        Tcl_SetObjResult(interp, Tcl_NewIntObj((int) dlRngGetSeed()));
         return TCL_OK;
     }
     
-    if (argc != 2) {
-        Tcl_AppendResult(interp, "usage: ", argv[0], " [seed]", NULL);
+    if (argc > 3) {
+        Tcl_AppendResult(interp, "usage: ", argv[0], " [seed [stream]]", NULL);
         return TCL_ERROR;
     }
     
     if (Tcl_GetInt(interp, argv[1], &seed) != TCL_OK) {
         return TCL_ERROR;
     }
-    
-    result = ranset(seed);
+    if (argc == 3) {
+        if (Tcl_GetInt(interp, argv[2], &stream) != TCL_OK) return TCL_ERROR;
+        if (stream < 0) {
+            Tcl_AppendResult(interp, argv[0], ": stream must be >= 0", NULL);
+            return TCL_ERROR;
+        }
+    }
+    
+    result = ranset(seed);
+    dlRngSeed((uint32_t) result, (uint64_t) stream);
     Tcl_SetObjResult(interp, Tcl_NewIntObj(result));
     return TCL_OK;
 }
@@ -7035,6 +8052,12 @@ static int tclListFromList (ClientData data, Tcl_Interp *interp,
   case DL_UNIQUE_NO_SORT:
     newlist = dynListUniqueNoSortList(dl);
     break;
+  case DL_UNIQUE_ORDERED:
+    newlist = dynListUniqueOrderedList(dl);
+    break;
+  case DL_VALUE_COUNTS:
+    newlist = dynListValueCounts(dl);
+    break;
   case DL_CUMSUM:
     newlist = dynListCumSumProdList(dl, DL_SUM_LIST);
     break;
@@ -7155,8 +8178,8 @@ static int tclReshapeList (ClientData data, Tcl_Interp *interp,
   if (nrows * ncols != DYN_LIST_N(dl)) {
     char resultstr[256];
     snprintf(resultstr, sizeof(resultstr),
-	     "%s: cannot create a %dx%d list from %d elements",
-	     argv[0], nrows, ncols, DYN_LIST_N(dl));
+	     "%s: cannot create a %dx%d list from %lld elements",
+	     argv[0], nrows, ncols, (long long) DYN_LIST_N(dl));
     Tcl_SetObjResult(interp, Tcl_NewStringObj(resultstr, -1));
     return TCL_ERROR;
   }
@@ -7598,6 +8621,66 @@ static int tclHistLists (ClientData data, Tcl_Interp *interp,
   }
 }
 
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclHist2D
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_hist2d
+ *
+ * DESCRIPTION
+ *   Count x, y pairs in a grid of bins, returned as a list of nybins
+ * rows of nxbins counts (lists of lists are counted together).
+ *
+ *****************************************************************************/
+
+static int tclHist2D (ClientData data, Tcl_Interp *interp,
+		      int argc, char *argv[])
+{
+  DYN_LIST *x, *y, *newlist;
+  DYN_LIST *xrange, *yrange;
+  int nxbins, nybins;
+
+  if (argc != 9) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " xlist ylist",
+		     " xstart xstop nxbins ystart ystop nybins",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (tclFindDynList(interp, argv[1], &x) != TCL_OK) return TCL_ERROR;
+  if (tclFindDynList(interp, argv[2], &y) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[5], &nxbins) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[8], &nybins) != TCL_OK) return TCL_ERROR;
+  if (tclGetNumericRange(interp, argv[3], argv[4], &xrange) != TCL_OK) {
+    Tcl_AppendResult(interp, argv[0], ": bad x range specified",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (tclGetNumericRange(interp, argv[6], argv[7], &yrange) != TCL_OK) {
+    Tcl_AppendResult(interp, argv[0], ": bad y range specified",
+		     (char *) NULL);
+    dfuFreeDynList(xrange);
+    return TCL_ERROR;
+  }
+
+  newlist = dynListHist2D(x, y, xrange, nxbins, yrange, nybins);
+  dfuFreeDynList(xrange);
+  dfuFreeDynList(yrange);
+
+  if (!newlist) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": bad operands (", argv[1], ", ",
+		     argv[2], ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
 /*****************************************************************************
  *
  * FUNCTION
@@ -7786,6 +8869,397 @@ static int tclParzenLists (ClientData data, Tcl_Interp *interp,
   }
 }
 
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclSdfAligned
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_sdfAligned
+ *    dl_parzenAligned
+ *
+ * DESCRIPTION
+ *   Sdfs of each trial of spike times from pre to post ms around the
+ * trial's align time (one time, or one per trial), as a list of lists
+ * (trials by time).  The same as dl_sdfs/dl_parzens given align+pre
+ * and align+post as the starts and stops.
+ *
+ *****************************************************************************/
+
+static int tclSdfAligned (ClientData data, Tcl_Interp *interp,
+			  int argc, char *argv[])
+{
+  DYN_LIST *dl, *aligns, *newlist;
+  int resolution;
+  double pre, post, nsd, ksd;
+  int mode = (Tcl_Size) data;
+
+  if (argc != 8) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " spikes aligns pre post",
+		     (mode == DL_SDF_ADAPTIVE) ? " pilot_sd nsd" :
+		     " kernel_sd kernel_nsds", " resolution",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+  if (tclFindDynList(interp, argv[2], &aligns) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDouble(interp, argv[3], &pre) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDouble(interp, argv[4], &post) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDouble(interp, argv[5], &ksd) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDouble(interp, argv[6], &nsd) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[7], &resolution) != TCL_OK) return TCL_ERROR;
+
+  newlist = dynListSdfAligned(dl, aligns, pre, post, ksd, nsd, resolution,
+			      mode == DL_SDF_ADAPTIVE);
+  if (!newlist) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": bad operands (", argv[1], ", ",
+		     argv[2], ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclFftLists
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_fft
+ *    dl_cfft
+ *    dl_ifft
+ *
+ * DESCRIPTION
+ *   FFT of a list of numbers (dl_fft) or of the complex list re + i im
+ * (dl_cfft, and dl_ifft for the inverse, scaled by 1/nfft), zero
+ * padded or cut to nfft points if given.  Returns a list of the real
+ * and imaginary parts over all frequencies; lists of lists give a list
+ * of transforms.  Any nfft may be used.
+ *
+ *****************************************************************************/
+
+static int tclFftLists (ClientData data, Tcl_Interp *interp,
+			int argc, char *argv[])
+{
+  DYN_LIST *re, *im = NULL, *newlist;
+  int nfft = 0, nargs;
+  int mode = (Tcl_Size) data;
+
+  nargs = (mode == DL_FFT_REAL) ? 2 : 3;
+  if (argc != nargs && argc != nargs+1) {
+    Tcl_AppendResult(interp, "usage: ", argv[0],
+		     (mode == DL_FFT_REAL) ? " data" : " real imag", " ?nfft?",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (tclFindDynList(interp, argv[1], &re) != TCL_OK) return TCL_ERROR;
+  if (mode != DL_FFT_REAL &&
+      tclFindDynList(interp, argv[2], &im) != TCL_OK) return TCL_ERROR;
+  if (argc > nargs) {
+    if (Tcl_GetInt(interp, argv[nargs], &nfft) != TCL_OK) return TCL_ERROR;
+    if (nfft < 1) {
+      Tcl_AppendResult(interp, argv[0], ": nfft must be positive",
+		       (char *) NULL);
+      return TCL_ERROR;
+    }
+  }
+
+  newlist = dynListFft(re, im, nfft, mode == DL_FFT_INVERSE);
+  if (!newlist) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": bad operands (", argv[1],
+		     im ? ", " : "", im ? argv[2] : "", ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDpss
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_dpss
+ *
+ * DESCRIPTION
+ *   The first ntapers discrete prolate spheroidal sequences (Slepian
+ * tapers) of n points with time-bandwidth product nw, a list per
+ * taper, each with unit energy.
+ *
+ *****************************************************************************/
+
+static int tclDpss (ClientData data, Tcl_Interp *interp,
+		    int argc, char *argv[])
+{
+  DYN_LIST *newlist;
+  int n, ntapers;
+  double nw;
+
+  if (argc != 4) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " n nw ntapers",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (Tcl_GetInt(interp, argv[1], &n) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDouble(interp, argv[2], &nw) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[3], &ntapers) != TCL_OK) return TCL_ERROR;
+
+  newlist = dynListDpss(n, nw, ntapers);
+  if (!newlist) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": bad operands (", argv[1], " ",
+		     argv[2], " ", argv[3], ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclMtSpecLists
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_mtfft
+ *    dl_mtspectrum
+ *    dl_mtspecgram
+ *    dl_mtcoherence
+ *
+ * DESCRIPTION
+ *   Multitaper estimates for each trial of a list of equal length
+ * trials, sampled at samp_freq and tapered by the first ntapers
+ * Slepian tapers with time-bandwidth product nw.  Trials are
+ * transformed at the next power of two above their length, doubled
+ * pad times (or their length if pad < 0), and results cover the
+ * frequencies 0 to samp_freq/2.  Point is 1 for binned spike counts
+ * (which have their mean removed before tapering), 0 for continuous
+ * data.
+ *
+ *   dl_mtfft returns the tapered transforms J of each trial (a list
+ * per taper of real and imaginary parts); dl_mtspectrum returns
+ * {S J freqs}; dl_mtspecgram the spectra of windows of win samples
+ * every step samples through each trial, {S freqs}; dl_mtcoherence
+ * {cohmag cohphase S12r S12i S1 S2 J1 J2 freqs}.
+ *
+ *****************************************************************************/
+
+static int tclMtSpecLists (ClientData data, Tcl_Interp *interp,
+			   int argc, char *argv[])
+{
+  DYN_LIST *dl, *dl2 = NULL, *newlist = NULL;
+  int ntapers, pad, point = 0, point2 = 0, win = 0, step = 0;
+  int nargs, first = 2;
+  double nw, fs;
+  int mode = (Tcl_Size) data;
+
+  switch (mode) {
+  case DL_SPEC_SPECGRAM:  nargs = 8; break;
+  case DL_SPEC_COHERENCE: nargs = 7; break;
+  default:                nargs = 6; break;
+  }
+
+  if (argc != nargs &&
+      argc != nargs+((mode == DL_SPEC_COHERENCE) ? 2 : 1)) {
+    Tcl_AppendResult(interp, "usage: ", argv[0],
+		     (mode == DL_SPEC_COHERENCE) ? " data1 data2" : " data",
+		     (mode == DL_SPEC_SPECGRAM) ? " win step" : "",
+		     " nw ntapers pad samp_freq",
+		     (mode == DL_SPEC_COHERENCE) ? " ?point1 point2?" :
+		     " ?point?", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+  if (mode == DL_SPEC_COHERENCE) {
+    if (tclFindDynList(interp, argv[2], &dl2) != TCL_OK) return TCL_ERROR;
+    first = 3;
+  }
+  if (mode == DL_SPEC_SPECGRAM) {
+    if (Tcl_GetInt(interp, argv[2], &win) != TCL_OK) return TCL_ERROR;
+    if (Tcl_GetInt(interp, argv[3], &step) != TCL_OK) return TCL_ERROR;
+    first = 4;
+  }
+  if (Tcl_GetDouble(interp, argv[first], &nw) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[first+1], &ntapers) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[first+2], &pad) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDouble(interp, argv[first+3], &fs) != TCL_OK) return TCL_ERROR;
+  if (argc > nargs) {
+    if (Tcl_GetBoolean(interp, argv[nargs], &point) != TCL_OK)
+      return TCL_ERROR;
+    if (mode == DL_SPEC_COHERENCE &&
+	Tcl_GetBoolean(interp, argv[nargs+1], &point2) != TCL_OK)
+      return TCL_ERROR;
+  }
+
+  switch (mode) {
+  case DL_SPEC_MTFFT:
+    newlist = dynListMtFft(dl, nw, ntapers, pad, fs, point);
+    break;
+  case DL_SPEC_SPECTRUM:
+    newlist = dynListMtSpectrum(dl, nw, ntapers, pad, fs, point);
+    break;
+  case DL_SPEC_SPECGRAM:
+    newlist = dynListMtSpecgram(dl, win, step, nw, ntapers, pad, fs, point);
+    break;
+  case DL_SPEC_COHERENCE:
+    newlist = dynListMtCoherence(dl, dl2, nw, ntapers, pad, fs,
+				 point, point2);
+    break;
+  }
+  if (!newlist) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": bad operands (", argv[1],
+		     dl2 ? ", " : "", dl2 ? argv[2] : "", ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclSpecErrLists
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_specerr
+ *    dl_coherr
+ *
+ * DESCRIPTION
+ *   Confidence limits at level p for the spectra S (dl_specerr) or
+ * coherence magnitudes C (dl_coherr) of each condition, given the
+ * tapered transforms J of each condition's trials as returned by
+ * dl_mtspectrum or dl_mtcoherence.  Method 1 uses the chi-square
+ * distribution of the spectrum, method 2 the jackknife over trials
+ * and tapers; spike counts per condition correct the degrees of
+ * freedom for point data (for dl_coherr, of the first or both signals).
+ *
+ *   dl_specerr returns {Serrl Serru}; dl_coherr returns {confC
+ * {Cerrl Cerru} phistd}, where confC is the magnitude above which
+ * coherence is significant (the limits need method 2).
+ *
+ *****************************************************************************/
+
+static int tclSpecErrLists (ClientData data, Tcl_Interp *interp,
+			    int argc, char *argv[])
+{
+  DYN_LIST *S, *J1, *J2 = NULL, *nsp1 = NULL, *nsp2 = NULL, *newlist;
+  double p;
+  int method, first;
+  int mode = (Tcl_Size) data;
+
+  if (mode == DL_SPEC_SPECERR) {
+    if (argc != 5 && argc != 6) {
+      Tcl_AppendResult(interp, "usage: ", argv[0],
+		       " spectra J p method ?numspks?", (char *) NULL);
+      return TCL_ERROR;
+    }
+    first = 3;
+  }
+  else {
+    if (argc < 6 || argc > 8) {
+      Tcl_AppendResult(interp, "usage: ", argv[0],
+		       " cohmag J1 J2 p method ?numspks1? ?numspks2?",
+		       (char *) NULL);
+      return TCL_ERROR;
+    }
+    first = 4;
+  }
+
+  if (tclFindDynList(interp, argv[1], &S) != TCL_OK) return TCL_ERROR;
+  if (tclFindDynList(interp, argv[2], &J1) != TCL_OK) return TCL_ERROR;
+  if (mode == DL_SPEC_COHERR &&
+      tclFindDynList(interp, argv[3], &J2) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDouble(interp, argv[first], &p) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetInt(interp, argv[first+1], &method) != TCL_OK) return TCL_ERROR;
+  if (method != 1 && method != 2) {
+    Tcl_AppendResult(interp, argv[0], ": method must be 1 (asymptotic) ",
+		     "or 2 (jackknife)", (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (argc > first+2) {
+    if (tclFindDynList(interp, argv[first+2], &nsp1) != TCL_OK)
+      return TCL_ERROR;
+    if (argc > first+3 &&
+	tclFindDynList(interp, argv[first+3], &nsp2) != TCL_OK)
+      return TCL_ERROR;
+  }
+
+  if (mode == DL_SPEC_SPECERR)
+    newlist = dynListSpecErr(S, J1, p, method, nsp1);
+  else
+    newlist = dynListCohErr(S, J1, J2, p, method, nsp1, nsp2);
+  if (!newlist) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": bad operands (", argv[1], ", ",
+		     argv[2], ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclSpecQuantile
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_chi2inv
+ *    dl_tinv
+ *
+ * DESCRIPTION
+ *   Inverse chi-square and Student's t distributions: the value below
+ * which a fraction p of the distribution on df degrees of freedom
+ * lies, for each p and df (either may be a single value).
+ *
+ *****************************************************************************/
+
+static int tclSpecQuantile (ClientData data, Tcl_Interp *interp,
+			    int argc, char *argv[])
+{
+  DYN_LIST *p, *df, *newlist;
+  int mode = (Tcl_Size) data;
+
+  if (argc != 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " p df", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (tclFindDynList(interp, argv[1], &p) != TCL_OK) return TCL_ERROR;
+  if (tclFindDynList(interp, argv[2], &df) != TCL_OK) return TCL_ERROR;
+
+  newlist = dynListSpecQuantile(p, df, mode == DL_SPEC_TINV);
+  if (!newlist) {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, argv[0], ": bad operands (", argv[1], ", ",
+		     argv[2], ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
 
 
 /*****************************************************************************
@@ -7814,7 +9288,7 @@ static int tclParzenLists (ClientData data, Tcl_Interp *interp,
  *****************************************************************************/
 
 static int tclReduceList (ClientData data, Tcl_Interp *interp,
-			  int argc, char *argv[])
+			  int objc, Tcl_Obj * const objv[])
 {
   DYN_LIST *dl, *retlist, *collapsed;
   float retval = 0.0;
@@ -7823,13 +9297,13 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
   int operation = (Tcl_Size) data;
 
   /* Only min / max can accept multiple args */
-  if (argc > 2) {
+  if (objc > 2) {
     if (operation == DL_MAX || operation == DL_MIN) {
       int i, mathop;
       DYN_LIST *dl1, *dl2, *newlist = NULL, *newlist1;
 
-      if (tclFindDynList(interp, argv[1], &dl1) != TCL_OK) return TCL_ERROR;
-      if (tclFindDynList(interp, argv[2], &dl2) != TCL_OK) return TCL_ERROR;
+      if (Tcl_GetDynListFromObj(interp, objv[1], &dl1) != TCL_OK) return TCL_ERROR;
+      if (Tcl_GetDynListFromObj(interp, objv[2], &dl2) != TCL_OK) return TCL_ERROR;
   
       switch (operation) {
       case DL_MIN:       mathop = DL_MATH_MIN;     break;
@@ -7837,9 +9311,9 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
       }
 
       newlist = dynListArithListList(dl1, dl2, mathop);
-      for (i = 3; i < argc; i++) {
+      for (i = 3; i < objc; i++) {
 	if (!newlist) goto error;
-	if (tclFindDynList(interp, argv[i], &dl1) != TCL_OK) {
+	if (Tcl_GetDynListFromObj(interp, objv[i], &dl1) != TCL_OK) {
 	  dfuFreeDynList(newlist);
 	  return TCL_ERROR;
 	}
@@ -7850,7 +9324,7 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
       if (!newlist) {
       error:
 	Tcl_ResetResult(interp);
-	Tcl_AppendResult(interp, argv[0], ": bad arguments", (char *) NULL);
+	Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": bad arguments", (char *) NULL);
 	return TCL_ERROR;
       }
       else {
@@ -7859,18 +9333,17 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
     }  
   }
 
-  if (argc != 2) {
-    Tcl_AppendResult(interp, "usage: ", argv[0], " dynlist",
+  if (objc != 2) {
+    Tcl_AppendResult(interp, "usage: ", Tcl_GetString(objv[0]), " dynlist",
 		     (char *) NULL);
     return TCL_ERROR;
   }
   
-  if (tclFindDynList(interp, argv[1], &dl) != TCL_OK) return TCL_ERROR;
+  if (Tcl_GetDynListFromObj(interp, objv[1], &dl) != TCL_OK) return TCL_ERROR;
 
   switch (operation) {
   case DL_LENGTH:
-    intval = DYN_LIST_N(dl);
-    Tcl_SetObjResult(interp, Tcl_NewIntObj(intval));
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(DYN_LIST_N(dl)));
     return TCL_OK;
     break;
   case DL_ANY:
@@ -7887,8 +9360,8 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
     if (DYN_LIST_N(dl) == 0) return TCL_OK;
     intval = dynListMinListIndex(dl);
     if (intval < 0) {
-      Tcl_AppendResult(interp, argv[0], ": can't find min of list\"",
-		       argv[1], "\"", (char *) NULL);
+      Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": can't find min of list\"",
+		       Tcl_GetString(objv[1]), "\"", (char *) NULL);
       return TCL_ERROR;
     }
     Tcl_SetObjResult(interp, Tcl_NewIntObj(intval));
@@ -7898,8 +9371,8 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
     if (DYN_LIST_N(dl) == 0) return TCL_OK;
     intval = dynListMaxListIndex(dl);
     if (intval < 0) {
-      Tcl_AppendResult(interp, argv[0], ": can't find max of list\"",
-		       argv[1], "\"", (char *) NULL);
+      Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": can't find max of list\"",
+		       Tcl_GetString(objv[1]), "\"", (char *) NULL);
       return TCL_ERROR;
     }
     Tcl_SetObjResult(interp, Tcl_NewIntObj(intval));
@@ -7938,7 +9411,7 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
     if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
       collapsed = dynListCollapseList(dl);
       if (!collapsed) {
-	Tcl_AppendResult(interp, argv[0], ": invalid argument", (char *) NULL);
+	Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": invalid argument", (char *) NULL);
 	return TCL_ERROR;
       }
       retval = dynListMeanList(collapsed);
@@ -7952,7 +9425,7 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
     if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
       collapsed = dynListCollapseList(dl);
       if (!collapsed) {
-	Tcl_AppendResult(interp, argv[0], ": invalid argument", (char *) NULL);
+	Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": invalid argument", (char *) NULL);
 	return TCL_ERROR;
       }
       retval = dynListStdList(collapsed);
@@ -7966,7 +9439,7 @@ static int tclReduceList (ClientData data, Tcl_Interp *interp,
     if (DYN_LIST_DATATYPE(dl) == DF_LIST) {
       collapsed = dynListCollapseList(dl);
       if (!collapsed) {
-	Tcl_AppendResult(interp, argv[0], ": invalid argument", (char *) NULL);
+	Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": invalid argument", (char *) NULL);
 	return TCL_ERROR;
       }
       retval = dynListVarList(collapsed);
@@ -9296,6 +10769,15 @@ int tclFindDynList(Tcl_Interp *interp, char *name, DYN_LIST **dl)
 				 * it's set to NULL 
 				 */
 
+  /* Temporary lists returned by commands */
+  if (name[0] == '%' && (list = dlResultFind(&dlinfo->results, name))) {
+    if (dl) {
+      *dl = list;
+      DYN_LIST_FLAGS(*dl) &= ~DL_SUBLIST; /* Flag as top-level list */
+    }
+    return TCL_OK;
+  }
+
   if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, name))) {
     list = Tcl_GetHashValue(entryPtr);
     if (!list) {
@@ -9351,6 +10833,7 @@ int tclFindDynList(Tcl_Interp *interp, char *name, DYN_LIST **dl)
   else if (colon) {
     int len;
     DYN_GROUP *dg;
+    DYN_LIST *dll = NULL;
     char groupname[128], listname[128];
     
     /* Get the group */
@@ -9372,10 +10855,9 @@ int tclFindDynList(Tcl_Interp *interp, char *name, DYN_LIST **dl)
     }
     
     /* This searches for a *list* named groupname that is a list of lists */
-    else if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, groupname))) {
-      DYN_LIST *dll;
-
-      if (!(dll = Tcl_GetHashValue(entryPtr))) {
+    else if ((dll = dlResultFind(&dlinfo->results, groupname)) ||
+	     (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, groupname))) {
+      if (!dll && !(dll = Tcl_GetHashValue(entryPtr))) {
 	strncpy(outname, groupname, 63);
 	Tcl_ResetResult(interp);
 	Tcl_AppendResult(interp, "dl_find: invalid dlptr ", outname, 
@@ -9570,6 +11052,14 @@ static int tclFindDynListParent(Tcl_Interp *interp, char *name, DYN_LIST **dl,
 				 * it's set to NULL 
 				 */
 
+  if (name[0] == '%' && (list = dlResultFind(&dlinfo->results, name))) {
+    if (dl) {
+      *dl = list;
+      DYN_LIST_FLAGS(*dl) &= ~DL_SUBLIST; /* Flag as top-level list */
+    }
+    return TCL_OK;
+  }
+
   if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, name))) {
     list = Tcl_GetHashValue(entryPtr);
     if (!list) {
@@ -9598,6 +11088,7 @@ static int tclFindDynListParent(Tcl_Interp *interp, char *name, DYN_LIST **dl,
    */
   else if ((colon = strchr(name,':'))) {
     DYN_GROUP *dg;
+    DYN_LIST *dll = NULL;
     char groupname[64], listname[64];
     
     /* Get the group */
@@ -9616,10 +11107,9 @@ static int tclFindDynListParent(Tcl_Interp *interp, char *name, DYN_LIST **dl,
     }
     
     /* This searches for a *list* named groupname that is a list of lists */
-    else if ((entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, groupname))) {
-      DYN_LIST *dll;
-
-      if (!(dll = Tcl_GetHashValue(entryPtr))) {
+    else if ((dll = dlResultFind(&dlinfo->results, groupname)) ||
+	     (entryPtr = Tcl_FindHashEntry(&dlinfo->dlTable, groupname))) {
+      if (!dll && !(dll = Tcl_GetHashValue(entryPtr))) {
 	Tcl_ResetResult(interp);
 	Tcl_AppendResult(interp, "dl_find: invalid dlptr ", groupname, 
 			 " in table", (char *) NULL);
@@ -10017,7 +11507,7 @@ int dynListPrintValChan(Tcl_Interp * interp, DYN_LIST *dl, int i,
     {
       DYN_LIST **vals = (DYN_LIST **) DYN_LIST_VALS(dl);
       sprintf(buf, DLFormatTable[FMT_LIST], DYN_LIST_DATATYPE(vals[i]), 
-	      DYN_LIST_N(vals[i]));
+	      (int) DYN_LIST_N(vals[i]));
       write_or_result(interp, chan, buf, -1);
     }
     break;
@@ -10072,6 +11562,107 @@ static int tclDoTimes(ClientData data, Tcl_Interp * interp, int objc,
 }
 
 
+/*
+ * Sets var to element i of dl for dl_foreach, dl_map, dl_filter and
+ * dl_reduce.  A scalar is written into the variable's current value
+ * when only the variable holds it, so a loop whose body does not keep
+ * the value makes no object per element; as with incr, the variable is
+ * set again afterwards so its traces still fire.  A sublist is handed
+ * over as a result object owning a copy, held only by the variable.
+ */
+
+static int tclSetLoopVar(Tcl_Interp *interp, DLSHINFO *dlinfo,
+			 Tcl_Obj *varName, DYN_LIST *dl, int i)
+{
+  Tcl_Obj *val = Tcl_ObjGetVar2(interp, varName, NULL, 0);
+
+  if (val && Tcl_IsShared(val)) val = NULL;
+
+  switch (DYN_LIST_DATATYPE(dl)) {
+  case DF_LONG:
+    if (val) Tcl_SetWideIntObj(val, ((int *) DYN_LIST_VALS(dl))[i]);
+    else val = Tcl_NewWideIntObj(((int *) DYN_LIST_VALS(dl))[i]);
+    break;
+  case DF_SHORT:
+    if (val) Tcl_SetIntObj(val, ((short *) DYN_LIST_VALS(dl))[i]);
+    else val = Tcl_NewIntObj(((short *) DYN_LIST_VALS(dl))[i]);
+    break;
+  case DF_CHAR:
+    if (val) Tcl_SetIntObj(val, ((unsigned char *) DYN_LIST_VALS(dl))[i]);
+    else val = Tcl_NewIntObj(((unsigned char *) DYN_LIST_VALS(dl))[i]);
+    break;
+  case DF_FLOAT:
+    if (val) Tcl_SetDoubleObj(val, ((float *) DYN_LIST_VALS(dl))[i]);
+    else val = Tcl_NewDoubleObj(((float *) DYN_LIST_VALS(dl))[i]);
+    break;
+  case DF_STRING:
+    if (val) Tcl_SetStringObj(val, ((char **) DYN_LIST_VALS(dl))[i], -1);
+    else val = Tcl_NewStringObj(((char **) DYN_LIST_VALS(dl))[i], -1);
+    break;
+  case DF_LIST: {
+    DYN_LIST *copy = dfuCopyDynList(((DYN_LIST **) DYN_LIST_VALS(dl))[i]);
+    if (!copy || !(val = tclNewResultObj(interp, dlinfo, copy))) {
+      if (copy) dfuFreeDynList(copy);
+      return TCL_ERROR;
+    }
+    break;
+  }
+  }
+
+  if (!Tcl_ObjSetVar2(interp, varName, NULL, val, TCL_LEAVE_ERR_MSG))
+    return TCL_ERROR;
+  return TCL_OK;
+}
+
+/*
+ * Finds the list a loop runs over, refusing datatypes with no loop value
+ */
+
+static int tclFindLoopList(Tcl_Interp *interp, Tcl_Obj *cmd, Tcl_Obj *name,
+			   DYN_LIST **dl)
+{
+  int dt;
+
+  if (Tcl_GetDynListFromObj(interp, name, dl) != TCL_OK) return TCL_ERROR;
+
+  dt = DYN_LIST_DATATYPE(*dl);
+  if (dt != DF_LONG && dt != DF_SHORT && dt != DF_FLOAT &&
+      dt != DF_CHAR && dt != DF_STRING && dt != DF_LIST) {
+    Tcl_AppendResult(interp, Tcl_GetString(cmd),
+		     ": unsupported list datatype", NULL);
+    return TCL_ERROR;
+  }
+  return TCL_OK;
+}
+
+
+/*
+ * dl_map, dl_filter and dl_reduce were Tcl procs, so a return in their
+ * body returned from them rather than from the proc calling them.  Take
+ * one level off a TCL_RETURN the way a proc would; other codes pass.
+ */
+
+static int tclLoopReturn(Tcl_Interp *interp, int rc)
+{
+  Tcl_Obj *options, *key, *value;
+  int level = 1;
+
+  if (rc != TCL_RETURN) return rc;
+
+  options = Tcl_GetReturnOptions(interp, rc);
+  Tcl_IncrRefCount(options);
+  key = Tcl_NewStringObj("-level", -1);
+  Tcl_IncrRefCount(key);
+  if (Tcl_DictObjGet(NULL, options, key, &value) == TCL_OK && value)
+    Tcl_GetIntFromObj(NULL, value, &level);
+  Tcl_DictObjPut(NULL, options, key, Tcl_NewIntObj(level - 1));
+  rc = Tcl_SetReturnOptions(interp, options);
+  Tcl_DecrRefCount(key);
+  Tcl_DecrRefCount(options);
+  return rc;
+}
+
+
 /***************************************************************\
 * tclForEach
 *    Executes a script operation repeatedly, like a for loop
@@ -10085,10 +11676,13 @@ static int tclDoTimes(ClientData data, Tcl_Interp * interp, int objc,
 static int tclForEach(ClientData data, Tcl_Interp * interp, int objc,
 		      Tcl_Obj * const objv[])
 {
-  int i, n, dt, rc = TCL_OK;
+  int i, n, rc = TCL_OK;
   DYN_LIST *dl;
   Tcl_Obj *varName, *body;
 
+  DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
+  if (!dlinfo) return TCL_ERROR;
+
   if (objc != 4) {
     Tcl_WrongNumArgs(interp, 1, objv, "var list body");
     return TCL_ERROR;
@@ -10096,70 +11690,435 @@ static int tclForEach(ClientData data, Tcl_Interp * interp, int objc,
   varName = objv[1];
   body    = objv[3];
 
-  if (tclFindDynList(interp, Tcl_GetString(objv[2]), &dl) != TCL_OK)
+  if (tclFindLoopList(interp, objv[0], objv[2], &dl) != TCL_OK)
     return TCL_ERROR;
 
-  dt = DYN_LIST_DATATYPE(dl);
-  n  = DYN_LIST_N(dl);
+  n = DYN_LIST_N(dl);
 
-  if (dt != DF_LONG && dt != DF_SHORT && dt != DF_FLOAT &&
-      dt != DF_CHAR && dt != DF_STRING && dt != DF_LIST) {
-    Tcl_AppendResult(interp, "dl_foreach: unsupported list datatype", NULL);
-    return TCL_ERROR;
+  for (i = 0; i < n; i++) {
+    if (tclSetLoopVar(interp, dlinfo, varName, dl, i) != TCL_OK)
+      return TCL_ERROR;
+
+    /* body is compiled once and the bytecode kept in its object */
+    rc = Tcl_EvalObjEx(interp, body, 0);
+
+    if (rc == TCL_CONTINUE) { rc = TCL_OK; continue; }
+    if (rc == TCL_BREAK)    { rc = TCL_OK; break; }
+    if (rc != TCL_OK)       break;	/* TCL_ERROR / TCL_RETURN propagate */
+  }
+
+  /* drop the loop variable (and with it the last DF_LIST element) */
+  Tcl_UnsetVar2(interp, Tcl_GetString(varName), NULL, 0);
+  return rc;
+}
+
+/*
+ * dl_map collects its results with no Tcl list in between.  Given a
+ * type they are converted as dl_append would; otherwise they go into
+ * an int list while every one is an integer, are kept as doubles once
+ * one is not, and become strings once one is not a number, the earlier
+ * numbers printed as Tcl would print them.
+ */
+
+enum MAP_STATE { MAP_TYPED, MAP_INT, MAP_DOUBLE, MAP_STRING };
+
+typedef struct {
+  int state;
+  DYN_LIST *out;		/* typed, int or string results */
+  double *vals;			/* MAP_DOUBLE results           */
+  char *isint;			/* ... and which were integers  */
+  int n, size;
+} MAP_OUTPUT;
+
+static int tclMapToStrings(MAP_OUTPUT *m)
+{
+  int i;
+  char buf[TCL_DOUBLE_SPACE];
+  DYN_LIST *strings = dfuCreateDynList(DF_STRING, m->n > 10 ? m->n : 10);
+
+  if (!strings) return TCL_ERROR;
+  if (m->state == MAP_INT) {
+    for (i = 0; i < DYN_LIST_N(m->out); i++) {
+      sprintf(buf, "%d", ((int *) DYN_LIST_VALS(m->out))[i]);
+      dfuAddDynListString(strings, buf);
+    }
+    dfuFreeDynList(m->out);
+  }
+  else {
+    for (i = 0; i < m->n; i++) {
+      if (m->isint[i]) sprintf(buf, "%d", (int) m->vals[i]);
+      else Tcl_PrintDouble(NULL, m->vals[i], buf);
+      dfuAddDynListString(strings, buf);
+    }
   }
+  m->out = strings;
+  m->state = MAP_STRING;
+  return TCL_OK;
+}
 
+static int tclMapToDoubles(MAP_OUTPUT *m)
+{
+  int i, n = DYN_LIST_N(m->out);
+
+  m->size = n > 64 ? 2 * n : 128;
+  m->vals = (double *) malloc(m->size * sizeof(double));
+  m->isint = (char *) malloc(m->size);
+  if (!m->vals || !m->isint) return TCL_ERROR;
   for (i = 0; i < n; i++) {
-    Tcl_Obj *val = NULL;
-    char tmpname[128];		/* DF_LIST: name of the per-element temp list */
-    tmpname[0] = 0;
-
-    /* Build the loop value as a FRESH Tcl_Obj each iteration (refcount 0).
-       The old code mutated one shared object in place, which panics modern
-       Tcl ("...called with shared object"). For DF_LIST we hand the body a
-       real, referenceable dynlist: copy the sublist, register it via
-       tclPutList, and bind the loop var to its temp name. */
-    switch (dt) {
+    m->vals[i] = ((int *) DYN_LIST_VALS(m->out))[i];
+    m->isint[i] = 1;
+  }
+  m->n = n;
+  dfuFreeDynList(m->out);
+  m->out = NULL;
+  m->state = MAP_DOUBLE;
+  return TCL_OK;
+}
+
+static int tclMapEmpty(Tcl_Obj *r)
+{
+  Tcl_Size length;
+  Tcl_GetStringFromObj(r, &length);
+  return !length;
+}
+
+static int tclMapAdd(Tcl_Interp *interp, MAP_OUTPUT *m, Tcl_Obj *r)
+{
+  int ival;
+  double dval;
+  DYN_LIST *dl;
+
+  /*
+   * Empty results are left out, as dl_create left them out; numbers
+   * are tried first so they need no string rep to tell.
+   */
+  if (m->state == MAP_TYPED) {
+    switch (DYN_LIST_DATATYPE(m->out)) {
     case DF_LONG:
-      val = Tcl_NewWideIntObj(((int *) DYN_LIST_VALS(dl))[i]); break;
     case DF_SHORT:
-      val = Tcl_NewIntObj(((short *) DYN_LIST_VALS(dl))[i]); break;
     case DF_CHAR:
-      val = Tcl_NewIntObj(((unsigned char *) DYN_LIST_VALS(dl))[i]); break;
+      if (Tcl_GetIntFromObj(NULL, r, &ival) != TCL_OK) {
+	if (tclMapEmpty(r)) return TCL_OK;
+	return Tcl_GetIntFromObj(interp, r, &ival);
+      }
+      if (DYN_LIST_DATATYPE(m->out) == DF_LONG)
+	dfuAddDynListLong(m->out, ival);
+      else if (DYN_LIST_DATATYPE(m->out) == DF_SHORT)
+	dfuAddDynListShort(m->out, ival);
+      else dfuAddDynListChar(m->out, ival);
+      break;
     case DF_FLOAT:
-      val = Tcl_NewDoubleObj(((float *) DYN_LIST_VALS(dl))[i]); break;
-    case DF_STRING:
-      val = Tcl_NewStringObj(((char **) DYN_LIST_VALS(dl))[i], -1); break;
-    case DF_LIST: {
-      DYN_LIST *copy = dfuCopyDynList(((DYN_LIST **) DYN_LIST_VALS(dl))[i]);
-      if (!copy || tclPutList(interp, copy) != TCL_OK) {
-	if (copy) dfuFreeDynList(copy);
-	return TCL_ERROR;
+      if (Tcl_GetDoubleFromObj(NULL, r, &dval) != TCL_OK) {
+	if (tclMapEmpty(r)) return TCL_OK;
+	return Tcl_GetDoubleFromObj(interp, r, &dval);
       }
-      strncpy(tmpname, Tcl_GetStringResult(interp), sizeof(tmpname)-1);
-      tmpname[sizeof(tmpname)-1] = 0;
-      val = Tcl_NewStringObj(tmpname, -1);
+      dfuAddDynListFloat(m->out, dval);
       break;
+    case DF_STRING:
+      if (tclMapEmpty(r)) return TCL_OK;
+      dfuAddDynListString(m->out, Tcl_GetString(r));
+      break;
+    case DF_LIST:
+      if (tclMapEmpty(r)) return TCL_OK;
+      if (Tcl_GetDynListFromObj(interp, r, &dl) != TCL_OK) return TCL_ERROR;
+      dfuAddDynListList(m->out, dl);
+      break;
+    }
+    return TCL_OK;
+  }
+
+  /* untyped, an empty result still makes the list a string list */
+  if (m->state == MAP_INT) {
+    if (Tcl_GetIntFromObj(NULL, r, &ival) == TCL_OK) {
+      dfuAddDynListLong(m->out, ival);
+      return TCL_OK;
+    }
+    if (Tcl_GetDoubleFromObj(NULL, r, &dval) == TCL_OK) {
+      if (tclMapToDoubles(m) != TCL_OK) goto nomem;
+    }
+    else if (tclMapToStrings(m) != TCL_OK) goto nomem;
+  }
+
+  if (m->state == MAP_DOUBLE) {
+    if (Tcl_GetDoubleFromObj(NULL, r, &dval) == TCL_OK) {
+      if (m->n == m->size) {
+	double *vals;
+	char *isint;
+	m->size *= 2;
+	vals = (double *) realloc(m->vals, m->size * sizeof(double));
+	if (vals) m->vals = vals;
+	isint = (char *) realloc(m->isint, m->size);
+	if (isint) m->isint = isint;
+	if (!vals || !isint) goto nomem;
+      }
+      m->isint[m->n] = Tcl_GetIntFromObj(NULL, r, &ival) == TCL_OK;
+      m->vals[m->n++] = dval;
+      return TCL_OK;
     }
+    if (tclMapToStrings(m) != TCL_OK) goto nomem;
+  }
+
+  if (tclMapEmpty(r)) return TCL_OK;
+  dfuAddDynListString(m->out, Tcl_GetString(r));
+  return TCL_OK;
+
+ nomem:
+  Tcl_AppendResult(interp, "dl_map: out of memory", NULL);
+  return TCL_ERROR;
+}
+
+static DYN_LIST *tclMapFinish(MAP_OUTPUT *m)
+{
+  DYN_LIST *dl = m->out;
+  int i;
+
+  if (m->state == MAP_DOUBLE) {
+    dl = dfuCreateDynList(DF_FLOAT, m->n > 10 ? m->n : 10);
+    if (dl) {
+      for (i = 0; i < m->n; i++) ((float *) DYN_LIST_VALS(dl))[i] = m->vals[i];
+      DYN_LIST_N(dl) = m->n;
     }
+  }
+  /* an empty result has nothing to go by */
+  else if (m->state == MAP_INT && !DYN_LIST_N(dl)) {
+    dfuFreeDynList(dl);
+    dl = dfuCreateDynList(DF_FLOAT, 10);
+  }
+  if (m->vals) free(m->vals);
+  if (m->isint) free(m->isint);
+  m->vals = NULL;
+  m->isint = NULL;
+  m->out = NULL;
+  return dl;
+}
+
+static void tclMapDiscard(MAP_OUTPUT *m)
+{
+  if (m->out) dfuFreeDynList(m->out);
+  if (m->vals) free(m->vals);
+  if (m->isint) free(m->isint);
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclMapDynList
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_map
+ *
+ * DESCRIPTION
+ *    Evaluates body with var set to each element (or sublist) of a list
+ *  and returns the results as a new list, of type auto (int, float or
+ *  string, whichever the results fit), int, short, char, float, string
+ *  or list.  Empty results are left out.  continue skips an element;
+ *  break stops the map; return returns from dl_map itself.
+ *
+ *****************************************************************************/
+
+static int tclMapDynList(ClientData data, Tcl_Interp * interp, int objc,
+			 Tcl_Obj * const objv[])
+{
+  int i, n, type, rc = TCL_OK;
+  DYN_LIST *dl, *result;
+  MAP_OUTPUT m;
+
+  DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
+  if (!dlinfo) return TCL_ERROR;
+
+  if (objc != 4 && objc != 5) {
+    Tcl_WrongNumArgs(interp, 1, objv, "var list body ?type?");
+    return TCL_ERROR;
+  }
 
-    if (!Tcl_ObjSetVar2(interp, varName, NULL, val, TCL_LEAVE_ERR_MSG)) {
-      if (tmpname[0]) Tcl_UnsetVar2(interp, tmpname, NULL, 0);
+  memset(&m, 0, sizeof(m));
+  if (objc == 5 && strcmp(Tcl_GetString(objv[4]), "auto")) {
+    if (!dynGetDatatypeID(Tcl_GetString(objv[4]), &type)) {
+      Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": bad datatype \"",
+		       Tcl_GetString(objv[4]), "\": must be auto, char, short, "
+		       "long, int, float, string or list", NULL);
       return TCL_ERROR;
     }
+    m.state = MAP_TYPED;
+  }
+  else {
+    type = DF_LONG;
+    m.state = MAP_INT;
+  }
 
-    rc = Tcl_EvalObjEx(interp, body, 0);
+  if (tclFindLoopList(interp, objv[0], objv[2], &dl) != TCL_OK)
+    return TCL_ERROR;
 
-    /* free the per-element temp list now that the body has run */
-    if (tmpname[0]) Tcl_UnsetVar2(interp, tmpname, NULL, 0);
+  n = DYN_LIST_N(dl);
+  if (!(m.out = dfuCreateDynList(type, n > 10 ? n : 10))) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": out of memory", NULL);
+    return TCL_ERROR;
+  }
 
+  for (i = 0; i < n; i++) {
+    if (tclSetLoopVar(interp, dlinfo, objv[1], dl, i) != TCL_OK) {
+      rc = TCL_ERROR;
+      break;
+    }
+    rc = Tcl_EvalObjEx(interp, objv[3], 0);
     if (rc == TCL_CONTINUE) { rc = TCL_OK; continue; }
     if (rc == TCL_BREAK)    { rc = TCL_OK; break; }
-    if (rc != TCL_OK)       break;	/* TCL_ERROR / TCL_RETURN propagate */
+    if (rc != TCL_OK) break;
+    if ((rc = tclMapAdd(interp, &m, Tcl_GetObjResult(interp))) != TCL_OK)
+      break;
   }
 
-  /* drop the loop variable (and, for DF_LIST, any dangling temp-list name) */
-  Tcl_UnsetVar2(interp, Tcl_GetString(varName), NULL, 0);
-  return rc;
+  Tcl_UnsetVar2(interp, Tcl_GetString(objv[1]), NULL, 0);
+  if (rc != TCL_OK) {
+    tclMapDiscard(&m);
+    return tclLoopReturn(interp, rc);
+  }
+  if (!(result = tclMapFinish(&m))) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]), ": out of memory", NULL);
+    return TCL_ERROR;
+  }
+  Tcl_ResetResult(interp);
+  return tclPutList(interp, result);
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclFilterDynList
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_filter
+ *
+ * DESCRIPTION
+ *    Returns the elements (or sublists) of a list for which pred,
+ *  evaluated with var set to each, is true.  continue drops an element;
+ *  break drops it and the rest; return returns from dl_filter itself.
+ *
+ *****************************************************************************/
+
+static int tclFilterDynList(ClientData data, Tcl_Interp * interp, int objc,
+			    Tcl_Obj * const objv[])
+{
+  int i, n, keep, rc = TCL_OK;
+  DYN_LIST *dl, *mask, *result;
+
+  DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
+  if (!dlinfo) return TCL_ERROR;
+
+  if (objc != 4) {
+    Tcl_WrongNumArgs(interp, 1, objv, "var list pred");
+    return TCL_ERROR;
+  }
+
+  if (tclFindLoopList(interp, objv[0], objv[2], &dl) != TCL_OK)
+    return TCL_ERROR;
+
+  n = DYN_LIST_N(dl);
+  mask = dfuCreateDynList(DF_LONG, n > 10 ? n : 10);
+
+  for (i = 0; i < n; i++) {
+    if (tclSetLoopVar(interp, dlinfo, objv[1], dl, i) != TCL_OK) {
+      rc = TCL_ERROR;
+      break;
+    }
+    rc = Tcl_EvalObjEx(interp, objv[3], 0);
+    if (rc == TCL_CONTINUE) { rc = TCL_OK; keep = 0; }
+    else if (rc == TCL_BREAK) { rc = TCL_OK; break; }
+    else if (rc != TCL_OK) break;
+    else if ((rc = Tcl_GetBooleanFromObj(interp, Tcl_GetObjResult(interp),
+					 &keep)) != TCL_OK) break;
+    dfuAddDynListLong(mask, keep);
+  }
+  while (rc == TCL_OK && DYN_LIST_N(mask) < n) dfuAddDynListLong(mask, 0);
+
+  Tcl_UnsetVar2(interp, Tcl_GetString(objv[1]), NULL, 0);
+  if (rc != TCL_OK) {
+    dfuFreeDynList(mask);
+    return tclLoopReturn(interp, rc);
+  }
+  result = dynListSelect(dl, mask);
+  dfuFreeDynList(mask);
+  if (!result) {
+    Tcl_AppendResult(interp, Tcl_GetString(objv[0]),
+		     ": unable to select elements from list \"",
+		     Tcl_GetString(objv[2]), "\"", NULL);
+    return TCL_ERROR;
+  }
+  Tcl_ResetResult(interp);
+  return tclPutList(interp, result);
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclReduceDynList
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_reduce
+ *
+ * DESCRIPTION
+ *    Left fold: accVar starts at init and is set to the result of body
+ *  for each element (or sublist), with elemVar set to the element.
+ *  Returns the final value of accVar.  continue leaves accVar as it
+ *  was; break stops the fold; return returns from dl_reduce itself.
+ *
+ *****************************************************************************/
+
+static int tclReduceDynList(ClientData data, Tcl_Interp * interp, int objc,
+			    Tcl_Obj * const objv[])
+{
+  int i, n, rc = TCL_OK;
+  DYN_LIST *dl;
+  Tcl_Obj *acc;
+
+  DLSHINFO *dlinfo = Tcl_GetAssocData(interp, DLSH_ASSOC_DATA_KEY, NULL);
+  if (!dlinfo) return TCL_ERROR;
+
+  if (objc != 6) {
+    Tcl_WrongNumArgs(interp, 1, objv, "accVar elemVar list body init");
+    return TCL_ERROR;
+  }
+
+  if (tclFindLoopList(interp, objv[0], objv[3], &dl) != TCL_OK)
+    return TCL_ERROR;
+  if (!Tcl_ObjSetVar2(interp, objv[1], NULL, objv[5], TCL_LEAVE_ERR_MSG))
+    return TCL_ERROR;
+
+  n = DYN_LIST_N(dl);
+  for (i = 0; i < n; i++) {
+    if (tclSetLoopVar(interp, dlinfo, objv[2], dl, i) != TCL_OK) {
+      rc = TCL_ERROR;
+      break;
+    }
+    rc = Tcl_EvalObjEx(interp, objv[4], 0);
+    if (rc == TCL_CONTINUE) { rc = TCL_OK; continue; }
+    if (rc == TCL_BREAK)    { rc = TCL_OK; break; }
+    if (rc != TCL_OK) break;
+    if (!Tcl_ObjSetVar2(interp, objv[1], NULL, Tcl_GetObjResult(interp),
+			TCL_LEAVE_ERR_MSG)) {
+      rc = TCL_ERROR;
+      break;
+    }
+  }
+
+  Tcl_UnsetVar2(interp, Tcl_GetString(objv[2]), NULL, 0);
+  if (rc != TCL_OK) return tclLoopReturn(interp, rc);
+  if (!(acc = Tcl_ObjGetVar2(interp, objv[1], NULL, TCL_LEAVE_ERR_MSG)))
+    return TCL_ERROR;
+  Tcl_SetObjResult(interp, acc);
+  return TCL_OK;
 }
 
 /* Date functions (replacing IMSL equivalents) */
@@ -2,8 +2,12 @@
  * Publically called functions from the tcl_dl module.
  */
 
+#ifndef TCL_DL_H
+#define TCL_DL_H
+
 #define DEFAULT_STARTUP_DIR  "/usr/local/lib/dlsh"
 #define DEFAULT_STARTUP_FILE "dlshrc"
+#define DLSH_ASSOC_DATA_KEY  "dlsh"	/* interp assoc data for DLSHINFO */
 #ifdef WIN32
 #include <fcntl.h>		/* for _O_BINARY */
 #pragma warning (disable:4244)
@@ -35,6 +39,32 @@ typedef struct {
 #define TMPLIST_INC(t)         ((t)->increment)
 #define TMPLIST_TMPLISTS(t)    ((t)->lists)
 
+/*
+ * Lists returned by commands (%list#%) are owned by Tcl_Objs (dlobj.c):
+ * each object holding a result counts one reference on its record and
+ * the list is freed with the last one.  The objects are the result
+ * itself, whatever the script stores it in, and a holder variable in
+ * the frame that made it, so a temp still lives at least until its
+ * proc returns.  Records are found by name through an open addressed
+ * table keyed on the #.
+ */
+
+typedef struct _dl_result {
+  int refCount;			/* objects holding this result          */
+  int id;			/* # of its %list#% name                */
+  DYN_LIST *dl;			/* NULL once deleted or renamed         */
+  struct _dl_results *owner;
+} DL_RESULT;
+
+typedef struct _dl_results {
+  DL_RESULT **slots;		/* open addressed on id                 */
+  int size;			/* number of slots (a power of two)     */
+  int n;			/* live results                         */
+  int used;			/* slots not empty (live or tombstone)  */
+  Tcl_Interp *interp;		/* interp the names belong to           */
+  Tcl_Obj *holder;		/* name of each frame's holder variable */
+} DL_RESULTS;
+
 typedef struct _dlshinfo {
   /*
    * Local tables for holding dynGroups and dynLists
@@ -61,8 +91,18 @@ typedef struct _dlshinfo {
    */
   TMPLIST_STACK *TmpListStack;
   DYN_LIST *TmpListRecordList;
-    
-  
+
+  /*
+   * temporary lists returned by commands
+   */
+  DL_RESULTS results;
+
+  /*
+   * bumped when a dlTable list or a group is deleted or renamed, so
+   * lookups cached in argument objects (dlobj.c) are made again
+   */
+  unsigned int listGeneration;
+  unsigned int groupGeneration;
 } DLSHINFO;
 
 #ifdef __cplusplus
@@ -108,3 +148,5 @@ int dynListPrintValChan(Tcl_Interp * interp, DYN_LIST *dl, int i,
 #ifdef __cplusplus
 }
 #endif
+
+#endif /* TCL_DL_H */
@@ -0,0 +1,264 @@
+/*************************************************************************
+ *
+ *  NAME
+ *    tcl_dlgroup.c
+ *
+ *  DESCRIPTION
+ *    Tcl commands for the single pass group-by in dlgroup.c.
+ *
+ *    dl_groupBy ?-agg aggregates? data key ?key ...?
+ *    dg_aggregate group keys {column aggregate ...}
+ *
+ *    dl_groupBy returns a list of lists: the key value of each group
+ *  for every key list, then either the grouped data (a list of lists)
+ *  or one list per aggregate.  dg_aggregate returns a new group with
+ *  the key lists under their own names and column_aggregate lists.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tcl.h>
+
+#include "df.h"
+#include "dfana.h"
+#include "tcl_dl.h"
+#include "dlgroup.h"
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclGroupBy
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dl_groupBy
+ *
+ * DESCRIPTION
+ *    Group data by one or more key lists, returning the key values of
+ * each group followed by the grouped data or the requested aggregates.
+ *
+ *****************************************************************************/
+
+static int tclGroupBy(ClientData data, Tcl_Interp *interp,
+		      int argc, char *argv[])
+{
+  int i, k, nkeys, nagg = 0, *aggs = NULL, first = 1;
+  Tcl_Size naggnames = 0;
+  const char **aggnames = NULL;
+  DYN_LIST *dl, **keys, *result, *l;
+  DL_GROUPING *g;
+
+  if (argc > 2 && !strcmp(argv[1], "-agg")) {
+    if (Tcl_SplitList(interp, argv[2], &naggnames, &aggnames) != TCL_OK)
+      return TCL_ERROR;
+    first = 3;
+  }
+  if (argc - first < 2) {
+    if (aggnames) Tcl_Free((char *) aggnames);
+    Tcl_AppendResult(interp, "usage: ", argv[0],
+		     " ?-agg aggregates? data key ?key ...?", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (naggnames) {
+    aggs = (int *) malloc(naggnames*sizeof(int));
+    for (i = 0; i < naggnames; i++) {
+      if (!dlGroupAggregateID((char *) aggnames[i], &aggs[nagg++])) {
+	Tcl_AppendResult(interp, argv[0], ": unknown aggregate \"",
+			 aggnames[i], "\" (should be count, sum, mean, std, "
+			 "sem, min, max or median)", (char *) NULL);
+	Tcl_Free((char *) aggnames);
+	free(aggs);
+	return TCL_ERROR;
+      }
+    }
+  }
+  if (aggnames) Tcl_Free((char *) aggnames);
+
+  if (tclFindDynList(interp, argv[first], &dl) != TCL_OK) {
+    if (aggs) free(aggs);
+    return TCL_ERROR;
+  }
+  nkeys = argc - first - 1;
+  keys = (DYN_LIST **) malloc(nkeys*sizeof(DYN_LIST *));
+  for (k = 0; k < nkeys; k++) {
+    if (tclFindDynList(interp, argv[first+1+k], &keys[k]) != TCL_OK)
+      goto error;
+    if (DYN_LIST_DATATYPE(keys[k]) == DF_LIST ||
+	DYN_LIST_N(keys[k]) != DYN_LIST_N(dl)) {
+      Tcl_AppendResult(interp, argv[0], ": key \"", argv[first+1+k],
+		       "\" must be a flat list the same length as data",
+		       (char *) NULL);
+      goto error;
+    }
+  }
+
+  if (!(g = dlGroupRows(nkeys, keys)) || !dlGroupSortGroups(g)) {
+    dlGroupFree(g);
+    Tcl_AppendResult(interp, argv[0], ": unable to group rows",
+		     (char *) NULL);
+    goto error;
+  }
+
+  result = dfuCreateDynList(DF_LIST, nkeys + (nagg ? nagg : 1));
+  for (k = 0; k < nkeys; k++)
+    dfuMoveDynListList(result, dlGroupKeyList(g, k));
+  if (!nagg) {
+    l = dlGroupDataLists(g, dl);
+    dfuMoveDynListList(result, l);
+  }
+  else {
+    for (i = 0; i < nagg; i++) {
+      if (!(l = dlGroupAggregate(g, dl, aggs[i]))) {
+	Tcl_AppendResult(interp, argv[0], ": unable to take ",
+			 dlGroupAggregateName(aggs[i]), " of \"",
+			 argv[first], "\"", (char *) NULL);
+	dfuFreeDynList(result);
+	dlGroupFree(g);
+	goto error;
+      }
+      dfuMoveDynListList(result, l);
+    }
+  }
+  dlGroupFree(g);
+  free(keys);
+  if (aggs) free(aggs);
+  return tclPutList(interp, result);
+
+ error:
+  free(keys);
+  if (aggs) free(aggs);
+  return TCL_ERROR;
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclGroupAggregate
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * TCL FUNCTION
+ *    dg_aggregate
+ *
+ * DESCRIPTION
+ *    Group the rows of a dyngroup by one or more of its lists and
+ * return a new group holding the keys and the requested aggregates.
+ *
+ *****************************************************************************/
+
+static int tclGroupAggregate(ClientData data, Tcl_Interp *interp,
+			     int argc, char *argv[])
+{
+  Tcl_Size nkeys, naggs;
+  const char **keynames = NULL, **aggnames = NULL;
+  char name[DYN_LIST_NAME_SIZE+128];
+  DYN_GROUP *dg, *result = NULL;
+  DYN_LIST **keys = NULL, *dl, *l;
+  DL_GROUPING *g = NULL;
+  int i, j, agg, status = TCL_ERROR;
+
+  if (argc != 4) {
+    Tcl_AppendResult(interp, "usage: ", argv[0],
+		     " group keys {column aggregate ...}", (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (tclFindDynGroup(interp, argv[1], &dg) != TCL_OK) return TCL_ERROR;
+  if (Tcl_SplitList(interp, argv[2], &nkeys, &keynames) != TCL_OK)
+    return TCL_ERROR;
+  if (Tcl_SplitList(interp, argv[3], &naggs, &aggnames) != TCL_OK)
+    goto done;
+  if (!nkeys || naggs % 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0],
+		     " group keys {column aggregate ...}", (char *) NULL);
+    goto done;
+  }
+
+  keys = (DYN_LIST **) malloc(nkeys*sizeof(DYN_LIST *));
+  for (i = 0; i < nkeys; i++) {
+    snprintf(name, sizeof(name), "%s:%s", argv[1], keynames[i]);
+    if (tclFindDynList(interp, name, &keys[i]) != TCL_OK) goto done;
+    if (DYN_LIST_DATATYPE(keys[i]) == DF_LIST ||
+	DYN_LIST_N(keys[i]) != DYN_LIST_N(keys[0])) {
+      Tcl_AppendResult(interp, argv[0], ": key \"", keynames[i],
+		       "\" must be a flat list the same length as \"",
+		       keynames[0], "\"", (char *) NULL);
+      goto done;
+    }
+  }
+  for (i = 0; i < naggs; i += 2) {
+    if (!dlGroupAggregateID((char *) aggnames[i+1], &agg)) {
+      Tcl_AppendResult(interp, argv[0], ": unknown aggregate \"",
+		       aggnames[i+1], "\" (should be count, sum, mean, std, "
+		       "sem, min, max or median)", (char *) NULL);
+      goto done;
+    }
+    /* each result list needs its own name */
+    for (j = 0; j < i; j += 2) {
+      if (!strcmp(aggnames[j], aggnames[i]) &&
+	  !strcmp(aggnames[j+1], aggnames[i+1])) {
+	Tcl_AppendResult(interp, argv[0], ": duplicate aggregate \"",
+			 aggnames[i], " ", aggnames[i+1], "\"", (char *) NULL);
+	goto done;
+      }
+    }
+    snprintf(name, sizeof(name), "%s_%s", aggnames[i], aggnames[i+1]);
+    for (j = 0; j < nkeys; j++) {
+      if (!strcmp(keynames[j], name)) {
+	Tcl_AppendResult(interp, argv[0], ": aggregate \"", name,
+			 "\" has the same name as a key", (char *) NULL);
+	goto done;
+      }
+    }
+  }
+
+  if (!(g = dlGroupRows(nkeys, keys)) || !dlGroupSortGroups(g)) {
+    Tcl_AppendResult(interp, argv[0], ": unable to group rows",
+		     (char *) NULL);
+    goto done;
+  }
+
+  result = dfuCreateDynGroup(nkeys + naggs/2);
+  for (i = 0; i < nkeys; i++)
+    dfuAddDynGroupExistingList(result, (char *) keynames[i],
+			       dlGroupKeyList(g, i));
+  for (i = 0; i < naggs; i += 2) {
+    snprintf(name, sizeof(name), "%s:%s", argv[1], aggnames[i]);
+    if (tclFindDynList(interp, name, &dl) != TCL_OK) goto done;
+    dlGroupAggregateID((char *) aggnames[i+1], &agg);
+    if (!(l = dlGroupAggregate(g, dl, agg))) {
+      Tcl_AppendResult(interp, argv[0], ": unable to take ", aggnames[i+1],
+		       " of \"", aggnames[i], "\"", (char *) NULL);
+      goto done;
+    }
+    snprintf(name, sizeof(name), "%s_%s", aggnames[i], aggnames[i+1]);
+    dfuAddDynGroupExistingList(result, name, l);
+  }
+
+  status = tclPutGroup(interp, result);
+  if (status == TCL_OK) result = NULL;
+
+ done:
+  if (result) dfuFreeDynGroup(result);
+  dlGroupFree(g);
+  if (keys) free(keys);
+  if (keynames) Tcl_Free((char *) keynames);
+  if (aggnames) Tcl_Free((char *) aggnames);
+  return status;
+}
+
+int DlGroup_Init(Tcl_Interp *interp)
+{
+  Tcl_CreateCommand(interp, "dl_groupBy", (Tcl_CmdProc *) tclGroupBy,
+		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+  Tcl_CreateCommand(interp, "dg_aggregate", (Tcl_CmdProc *) tclGroupAggregate,
+		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+  return TCL_OK;
+}
@@ -35,6 +35,7 @@ enum DM_ARITH_TYPES  { DM_MULT, DM_DIV, DM_ADD, DM_SUB };
 enum DM_GENERATORS   { DM_IDENTITY, DM_ZEROS, DM_URANDS, DM_ZRANDS };
 enum DM_MAT_FROM_MAT { DM_TRANSPOSE, DM_INVERSE, DM_LUINV, DM_LUDCMP, DM_DIAG};
 enum DM_MEAN_TYPES   { DM_ROWS, DM_COLS };
+enum DM_DECOMP_TYPES { DM_QR, DM_CHOL, DM_EIGEN, DM_SVD };
 
 /*****************************************************************************
  *                           TCL Bound Functions 
@@ -46,9 +47,13 @@ static int tclDynMatrixDump          (ClientData, Tcl_Interp *, int, char **);
 static int tclDynMatrixDims          (ClientData, Tcl_Interp *, int, char **);
 static int tclDynMatrixFromMatrix    (ClientData, Tcl_Interp *, int, char **);
 static int tclDynMatrixArith         (ClientData, Tcl_Interp *, int, char **);
+static int tclDynMatrixArithInPlace  (ClientData, Tcl_Interp *, int, char **);
 static int tclDynMatrixMeans         (ClientData, Tcl_Interp *, int, char **);
 static int tclDynMatrixSums          (ClientData, Tcl_Interp *, int, char **);
 static int tclDynMatrixCenter        (ClientData, Tcl_Interp *, int, char **);
+static int tclDynMatrixDecompose     (ClientData, Tcl_Interp *, int, char **);
+static int tclDynMatrixLstsq         (ClientData, Tcl_Interp *, int, char **);
+static int tclDynMatrixPCA           (ClientData, Tcl_Interp *, int, char **);
 static int tclDMHelp                 (ClientData, Tcl_Interp *, int, char **);
 
 static TCL_COMMANDS DMcommands[] = {
@@ -80,6 +85,14 @@ static TCL_COMMANDS DMcommands[] = {
       "returns matrix * operand" },
   { "dm_div",              tclDynMatrixArith,       (void *) DM_DIV,
       "returns matrix / operand" },
+  { "dm_addInPlace",       tclDynMatrixArithInPlace, (void *) DM_ADD,
+      "matrix + operand, stored in matrix" },
+  { "dm_subInPlace",       tclDynMatrixArithInPlace, (void *) DM_SUB,
+      "matrix - operand, stored in matrix" },
+  { "dm_multInPlace",      tclDynMatrixArithInPlace, (void *) DM_MULT,
+      "matrix * float, stored in matrix" },
+  { "dm_divInPlace",       tclDynMatrixArithInPlace, (void *) DM_DIV,
+      "matrix / float, stored in matrix" },
 
   { "dm_rowSums",         tclDynMatrixSums,         (void *) DM_ROWS,
       "returns sums of rows" },
@@ -104,6 +117,19 @@ static TCL_COMMANDS DMcommands[] = {
       "returns diag of a matrix" },
   { "dm_ludcmp",           tclDynMatrixFromMatrix,  (void *) DM_LUDCMP,
       "returns LU decomposition of a matrix" },
+
+  { "dm_qr",               tclDynMatrixDecompose,   (void *) DM_QR,
+      "returns {q r} QR decomposition of a matrix" },
+  { "dm_chol",             tclDynMatrixDecompose,   (void *) DM_CHOL,
+      "returns lower Cholesky factor of a positive definite matrix" },
+  { "dm_eigen",            tclDynMatrixDecompose,   (void *) DM_EIGEN,
+      "returns {values vectors} of a symmetric matrix" },
+  { "dm_svd",              tclDynMatrixDecompose,   (void *) DM_SVD,
+      "returns {u s v} singular value decomposition of a matrix" },
+  { "dm_lstsq",            tclDynMatrixLstsq,       NULL,
+      "returns least squares solution b of x b = y" },
+  { "dm_pca",              tclDynMatrixPCA,         NULL,
+      "returns {loadings scores variances proportions}" },
   
   { "dm_help",              tclDMHelp,             (void *) DMcommands, 
       "display help for matrix operations" },
@@ -374,7 +400,12 @@ static int tclDynMatrixFromMatrix (ClientData cd, Tcl_Interp *interp,
   
   switch (operation) {
   case DM_TRANSPOSE:
-    return(Tcl_VarEval(interp, "dl_transpose ", argv[1], (char *) NULL));
+    newmat = dynMatrixTranspose(m);
+    if (!newmat) {
+      Tcl_AppendResult(interp, argv[0], ": error transposing (", 
+		       argv[1], ")", (char *) NULL);
+      return TCL_ERROR;
+    }
     break;
   case DM_DIAG:
     newmat = dynMatrixDiag(m);
@@ -630,6 +661,77 @@ static int tclDynMatrixArith (ClientData cd, Tcl_Interp *interp,
 }
 
 
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDynMatrixArithInPlace
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * DESCRIPTION
+ *    Elementwise matrix arithmetic stored back into the matrix: add or
+ * subtract a matrix, row vector or float, multiply or divide by a float.
+ * Returns the matrix.
+ *
+ *****************************************************************************/
+
+static int tclDynMatrixArithInPlace (ClientData cd, Tcl_Interp *interp,
+				     int argc, char *argv[])
+{
+  DYN_LIST *m, *l;
+  double k;
+  int ok, mathop = 0;
+  int operation = (Tcl_Size) cd;
+
+  if (argc != 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " matrix [matrix|vec|float]",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  switch (operation) {
+  case DM_ADD:  mathop = DL_MATH_ADD; break;
+  case DM_SUB:  mathop = DL_MATH_SUB; break;
+  case DM_MULT: mathop = DL_MATH_MUL; break;
+  case DM_DIV:  mathop = DL_MATH_DIV; break;
+  }
+
+  if (tclFindDynMatrix(interp, argv[1], &m) != TCL_OK) return TCL_ERROR;
+  Tcl_ResetResult(interp);
+
+  /* a number is taken as a scalar, not a one element list */
+  if (Tcl_GetDouble(interp, argv[2], &k) == TCL_OK) {
+    ok = dynMatrixArithFloatInPlace(m, k, mathop);
+  }
+  else if (tclFindDynList(interp, argv[2], &l) == TCL_OK) {
+    if (operation == DM_MULT || operation == DM_DIV) {
+      Tcl_ResetResult(interp);
+      Tcl_AppendResult(interp, argv[0], ": operand must be a float",
+		       (char *) NULL);
+      return TCL_ERROR;
+    }
+    ok = dynMatrixArithInPlace(m, l, mathop);
+  }
+  else {
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, "usage: ", argv[0], " matrix [matrix|vec|float]",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  Tcl_ResetResult(interp);
+  if (!ok) {
+    Tcl_AppendResult(interp, argv[0], ": unable to combine matrix \"",
+		     argv[1], "\" and \"", argv[2], "\" in place",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+  Tcl_SetResult(interp, argv[1], TCL_VOLATILE);
+  return TCL_OK;
+}
+
+
 /*****************************************************************************
  *
  * FUNCTION
@@ -769,7 +871,7 @@ static int tclDynMatrixCenter (ClientData cd, Tcl_Interp *interp,
   
   if ((operation == DM_ROWS && DYN_LIST_N(v) != nrows) ||
       (operation == DM_COLS && DYN_LIST_N(v) != ncols)) {
-    if (argc < 2) dfuFreeDynList(v); /* should never happen */
+    if (argc == 2) dfuFreeDynList(v); /* should never happen */
     Tcl_ResetResult(interp);
     Tcl_AppendResult(interp, argv[0], ": incompatible center vector", 
 		     (char *) NULL);
@@ -782,7 +884,7 @@ static int tclDynMatrixCenter (ClientData cd, Tcl_Interp *interp,
   }
 
   /* Don't need this anymore, so delete if we created it above */
-  if (argc < 2) dfuFreeDynList(v);
+  if (argc == 2) dfuFreeDynList(v);
 
   if (!newlist) {
     Tcl_ResetResult(interp);
@@ -794,6 +896,173 @@ static int tclDynMatrixCenter (ClientData cd, Tcl_Interp *interp,
   return(tclPutList(interp, newlist));
 }
 
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDynMatrixDecompose
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * BOUND FUNCTIONS
+ *    dm_qr
+ *    dm_chol
+ *    dm_eigen
+ *    dm_svd
+ *
+ * DESCRIPTION
+ *    Return the factors of a matrix: {q r}, l, {values vectors} or
+ *  {u s v}
+ *
+ *****************************************************************************/
+
+static int tclDynMatrixDecompose (ClientData cd, Tcl_Interp *interp, 
+				  int argc, char *argv[])
+{
+  DYN_LIST *m, *newlist = NULL;
+  int nrows, ncols;
+  int operation = (Tcl_Size) cd;
+
+  if (argc != 2) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " matrix", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+  
+  if (tclFindDynMatrix(interp, argv[1], &m) != TCL_OK) 
+    return TCL_ERROR;
+  dynMatrixDims(m, &nrows, &ncols);
+
+  if ((operation == DM_CHOL || operation == DM_EIGEN) && nrows != ncols) {
+    Tcl_AppendResult(interp, argv[0], ": matrix must be square", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  switch (operation) {
+  case DM_QR:    newlist = dynMatrixQR(m);       break;
+  case DM_CHOL:  newlist = dynMatrixCholesky(m); break;
+  case DM_EIGEN: newlist = dynMatrixEigen(m);    break;
+  case DM_SVD:   newlist = dynMatrixSVD(m);      break;
+  }
+
+  if (!newlist) {
+    if (operation == DM_CHOL) 
+      Tcl_AppendResult(interp, argv[0], ": matrix (", argv[1], 
+		       ") is not positive definite", (char *) NULL);
+    else 
+      Tcl_AppendResult(interp, argv[0], ": error decomposing (", argv[1], 
+		       ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDynMatrixLstsq
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * BOUND FUNCTIONS
+ *    dm_lstsq
+ *
+ * DESCRIPTION
+ *    Return least squares coefficients b of x b = y, for a response
+ *  vector y or a matrix y with one response per column
+ *
+ *****************************************************************************/
+
+static int tclDynMatrixLstsq (ClientData cd, Tcl_Interp *interp, 
+			      int argc, char *argv[])
+{
+  DYN_LIST *x, *y, *newlist;
+  int nrows, ncols, yrows;
+
+  if (argc != 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " x y", (char *) NULL);
+    return TCL_ERROR;
+  }
+  
+  if (tclFindDynMatrix(interp, argv[1], &x) != TCL_OK) return TCL_ERROR;
+  if (tclFindDynList(interp, argv[2], &y) != TCL_OK) return TCL_ERROR;
+  dynMatrixDims(x, &nrows, &ncols);
+
+  yrows = DYN_LIST_N(y);
+  if (yrows != nrows || 
+      (DYN_LIST_DATATYPE(y) == DF_LIST && !dynListIsMatrix(y)) ||
+      DYN_LIST_DATATYPE(y) == DF_STRING) {
+    Tcl_AppendResult(interp, argv[0], ": y must be a vector or matrix with ",
+		     "as many rows as x", (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (nrows < ncols) {
+    Tcl_AppendResult(interp, argv[0], ": x has fewer rows than columns",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (!(newlist = dynMatrixLstsq(x, y))) {
+    Tcl_AppendResult(interp, argv[0], ": x (", argv[1], 
+		     ") is rank deficient", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
+
+/*****************************************************************************
+ *
+ * FUNCTION
+ *    tclDynMatrixPCA
+ *
+ * ARGS
+ *    Tcl Args
+ *
+ * BOUND FUNCTIONS
+ *    dm_pca
+ *
+ * DESCRIPTION
+ *    Return {loadings scores variances proportions} of the principal
+ *  components of a matrix of observations (rows) of variables (cols)
+ *
+ *****************************************************************************/
+
+static int tclDynMatrixPCA (ClientData cd, Tcl_Interp *interp, 
+			    int argc, char *argv[])
+{
+  DYN_LIST *m, *newlist;
+  int nrows, ncols, ncomps = 0;
+
+  if (argc < 2 || argc > 3) {
+    Tcl_AppendResult(interp, "usage: ", argv[0], " matrix ?ncomps?", 
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+  
+  if (tclFindDynMatrix(interp, argv[1], &m) != TCL_OK) return TCL_ERROR;
+  if (argc > 2 && Tcl_GetInt(interp, argv[2], &ncomps) != TCL_OK) 
+    return TCL_ERROR;
+  dynMatrixDims(m, &nrows, &ncols);
+
+  if (nrows < 2) {
+    Tcl_AppendResult(interp, argv[0], ": need at least two observations",
+		     (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  if (!(newlist = dynMatrixPCA(m, ncomps))) {
+    Tcl_AppendResult(interp, argv[0], ": error computing components of (", 
+		     argv[1], ")", (char *) NULL);
+    return TCL_ERROR;
+  }
+  return(tclPutList(interp, newlist));
+}
+
 /*****************************************************************************
  *
  * FUNCTION
@@ -0,0 +1,129 @@
+#!/usr/bin/env dlsh
+#
+# test_dg_arena.tcl
+#   Correctness test for the per-group arena used when a dynGroup is read
+#   from a buffer (dg_fromString, dg_read of .dgz / .lz4).  List headers and
+#   values of such groups live in a few large chunks owned by the group;
+#   every list command must still treat them as ordinary lists, and lists
+#   that grow, move out of the group or outlive it must stay valid.
+#
+#   Usage:  dlsh test_dg_arena.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+set tmp [file tempdir]
+
+proc make {} {
+    set g [dg_create]
+    dl_set $g:id [dl_ilist 1 2 3]
+    dl_set $g:rt [dl_flist 0.5 1.5 2.5]
+    dl_set $g:code [dl_slist a bb ccc]
+    dl_set $g:spikes [dl_llist [dl_flist 1 2] [dl_flist] [dl_flist 3 4 5]]
+    dl_set $g:nested [dl_llist [dl_llist [dl_ilist 1] [dl_ilist 2 3]]]
+    return $g
+}
+set src [make]
+
+set ::nreload 0
+proc reload {src} {
+    dg_toString $src buf
+    return [dg_fromString $buf arena[incr ::nreload]]
+}
+
+# --- round trip through a buffer ---
+set g [reload $src]
+foreach col {id rt code spikes nested} {
+    check "round trip $col" [dl_tcllist $g:$col] [dl_tcllist $src:$col]
+}
+check "lengths" [dl_tcllist [dl_lengths $g:spikes]] {2 0 3}
+
+# --- arena lists grow out of the arena without losing data ---
+dl_append $g:id 4
+dl_append $g:id 5
+check "append" [dl_tcllist $g:id] {1 2 3 4 5}
+dl_append $g:spikes:1 9
+check "append to sublist" [dl_tcllist $g:spikes] {{1.0 2.0} 9.0 {3.0 4.0 5.0}}
+dl_append $g:spikes [dl_flist 7]
+check "append sublist" [dl_length $g:spikes] 4
+check "neighbours intact" [dl_tcllist $g:rt] {0.5 1.5 2.5}
+dl_put $g:rt 1 9
+check "put" [dl_tcllist $g:rt] {0.5 9.0 2.5}
+dl_reset $g:code
+check "reset" [dl_length $g:code] 0
+dl_append $g:code z
+check "append after reset" [dl_tcllist $g:code] z
+
+# --- lists that leave the group keep their storage ---
+set g [reload $src]
+dl_set keep $g:spikes
+dg_remove $g code
+check "remove column" [dg_tclListnames $g] {id rt spikes nested}
+dg_delete $g
+check "copy outlives group" [dl_tcllist keep] {{1.0 2.0} {} {3.0 4.0 5.0}}
+
+set g [reload $src]
+dl_set moved [dl_choose $g:rt [dl_ilist 0 2]]
+dg_delete $g
+check "derived outlives group" [dl_tcllist moved] {0.5 2.5}
+
+# --- packed storage on top of an arena group ---
+set g [reload $src]
+dg_packStorage $g
+check "packStorage" [dl_isPackedStorage $g:spikes] 1
+check "packed contents" [dl_tcllist $g:spikes] [dl_tcllist $src:spikes]
+dg_delete $g
+
+# --- files read through the buffer path ---
+foreach ext {dgz lz4} {
+    dg_write $src [file join $tmp arena.$ext]
+    set g [dg_read [file join $tmp arena.$ext] read$ext]
+    check "read .$ext" [dl_tcllist $g:spikes] [dl_tcllist $src:spikes]
+    dl_append $g:spikes:0 3
+    check "read .$ext then grow" [dl_tcllist $g:spikes:0] {1.0 2.0 3.0}
+    dg_toString $g buf2
+    set g2 [dg_fromString $buf2 rewrite$ext]
+    check "rewrite .$ext" [dl_tcllist $g2:spikes:0] {1.0 2.0 3.0}
+    dg_delete $g $g2
+    file delete [file join $tmp arena.$ext]
+}
+
+# --- repeated read/delete must not leak arena chunks ---
+proc rss_kb {} {
+    if {![file readable /proc/self/status]} { return 0 }
+    set f [open /proc/self/status]; set s [read $f]; close $f
+    if {[regexp {VmRSS:\s+(\d+)} $s -> kb]} { return $kb }
+    return 0
+}
+set big [dg_create]
+dl_set $big:x [dl_fromto 0 200000]
+dl_set $big:l [dl_llist [dl_fromto 0 1000] [dl_fromto 0 1000]]
+dg_toString $big bigbuf
+for {set i 0} {$i < 20} {incr i} { dg_delete [dg_fromString $bigbuf bigcopy] }
+set before [rss_kb]
+for {set i 0} {$i < 200} {incr i} { dg_delete [dg_fromString $bigbuf bigcopy] }
+set grew [expr {[rss_kb] - $before}]
+check "no growth over 200 reads (grew ${grew}kB)" [expr {$grew < 8192}] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,114 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_bytes.tcl
+#   dl_toBytes / dl_fromBytes: char, short, long and float lists must
+#   come back from their bytes unchanged, match what binary format and
+#   binary scan make of the same values in either byte order, and
+#   -offset / -stride / -count must pull single channels out of
+#   interleaved data.  Also prints the time a million floats take each
+#   way against the Tcl list + binary route.
+#
+#   Usage:  dlsh test_dl_bytes.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# --- round trips and agreement with binary format ---
+# type, list of it, binary format letters (little, big)
+foreach {type l letters} [list \
+        char  [dl_char [dl_ilist 0 1 -1 127 -128 100 -77]] {c c} \
+        short [dl_short [dl_ilist 0 1 -1 32767 -32768 1234 -4321]] {s S} \
+        long  [dl_ilist 0 1 -1 2147483647 -2147483648 123456789 -987654321] {i I} \
+        float [dl_flist 0.0 1.5 -2.25 1e+20 -3.0517578125e-05] {r R}] {
+    lassign $letters lo hi
+    set b [dl_toBytes $l]
+    check "$type round trip" [dl_tcllist [dl_fromBytes $type $b]] [dl_tcllist $l]
+    check "$type datatype" [dl_datatype [dl_fromBytes $type $b]] [dl_datatype $l]
+    set little [dl_toBytes $l -byteorder little]
+    set big [dl_toBytes $l -byteorder big]
+    check "$type little" [expr {$little eq [binary format $lo* [dl_tcllist $l]]}] 1
+    check "$type big" [expr {$big eq [binary format $hi* [dl_tcllist $l]]}] 1
+    check "$type from big" [dl_tcllist [dl_fromBytes $type $big -byteorder big]] \
+        [dl_tcllist $l]
+    check "$type native" [expr {[dl_toBytes $l -byteorder native] eq $b}] 1
+}
+check "int is long" [dl_tcllist [dl_fromBytes int [binary format i* {5 -6}] \
+                                     -byteorder little]] {5 -6}
+binary scan [binary format s* {1 -2 300}] s* scanned
+check "binary scan agrees" [dl_tcllist [dl_fromBytes short \
+                                            [binary format s* {1 -2 300}] -byteorder little]] \
+    $scanned
+
+# --- offsets, strides, counts ---
+# three interleaved 16 bit channels, 5 frames
+set frames {}
+for {set f 0} {$f < 5} {incr f} { lappend frames $f [expr {100+$f}] [expr {-$f}] }
+set data [binary format s* $frames]
+check "channel 0" [dl_tcllist [dl_fromBytes short $data -stride 6 -byteorder little]] \
+    {0 1 2 3 4}
+check "channel 1" [dl_tcllist [dl_fromBytes short $data -offset 2 -stride 6 \
+                                   -byteorder little]] {100 101 102 103 104}
+check "channel 2" [dl_tcllist [dl_fromBytes short $data -offset 4 -stride 6 \
+                                   -byteorder little]] {0 -1 -2 -3 -4}
+check "count" [dl_tcllist [dl_fromBytes short $data -offset 2 -stride 6 -count 2 \
+                               -byteorder little]] {100 101}
+check "header skipped" [dl_tcllist [dl_fromBytes long \
+                                        "hdr![binary format i* {7 8 9}]" -offset 4 \
+                                        -byteorder little]] {7 8 9}
+check "odd tail ignored" [dl_length [dl_fromBytes long [string repeat x 11]]] 2
+check "char stride" [dl_tcllist [dl_fromBytes char abcdef -stride 2]] \
+    [dl_tcllist [dl_char [dl_ilist 97 99 101]]]
+check "empty" [list [dl_length [dl_fromBytes float ""]] [string length [dl_toBytes [dl_flist]]]] \
+    {0 0}
+check "offset past end" [dl_length [dl_fromBytes short abc -offset 10]] 0
+check "unaligned float" [dl_tcllist [dl_fromBytes float "x[binary format r 2.5]" \
+                                         -offset 1 -byteorder little]] 2.5
+
+# --- errors ---
+check "too many" [catch {dl_fromBytes short abcd -count 3}] 1
+check "bad type" [catch {dl_fromBytes string abcd}] 1
+check "bad order" [catch {dl_fromBytes short abcd -byteorder middle}] 1
+check "bad option" [catch {dl_fromBytes short abcd -size 2}] 1
+check "small stride" [catch {dl_fromBytes long abcdefgh -stride 2}] 1
+check "negative offset" [catch {dl_fromBytes char abcd -offset -1}] 1
+check "list list" [catch {dl_toBytes [dl_llist [dl_ilist 1]]}] 1
+check "string list" [catch {dl_toBytes [dl_slist a]}] 1
+check "toBytes usage" [catch {dl_toBytes [dl_ilist 1] -byteorder}] 1
+
+# --- timing (informational) ---
+dl_set big [dl_zrand 1000000]
+set b [dl_toBytes big -byteorder little]
+check "million round trip" [dl_sum [dl_eq [dl_fromBytes float $b -byteorder little] big]] \
+    1000000
+foreach {label script} {
+    "dl_toBytes"               {dl_toBytes big -byteorder little}
+    "binary format r* tcllist" {binary format r* [dl_tcllist big]}
+    "dl_fromBytes"             {dl_return [dl_fromBytes float $b -byteorder little]}
+    "binary scan + dl_flist"   {binary scan $b r* v; dl_return [dl_flist {*}$v]}
+} {
+    puts [format "     %-26s 1M floats %8.0f us" $label \
+              [lindex [time $script 3] 0]]
+}
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
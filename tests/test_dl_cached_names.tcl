@@ -0,0 +1,152 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_cached_names.tcl
+#   dl_get, dl_put, dl_length, dl_add and the other object commands keep
+#   the list a name was found to be in the name's Tcl_Obj: the same
+#   literal must find the new list once the old one is deleted,
+#   replaced or renamed, whether it is a plain list, a group or a
+#   group:list, and names that are not cached (temps, Tcl lists,
+#   sublists) must work as before.  Also prints the time each command
+#   takes on a named list.
+#
+#   Usage:  dlsh test_dl_cached_names.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# each proc body keeps one literal per name, so every call after the
+# first goes through the cache
+proc lenx {} { dl_length x }
+proc getx {i} { dl_get x $i }
+proc lenga {} { dl_length g:a }
+proc getga {i} { dl_get g:a $i }
+proc hasg {} { dg_exists g }
+proc hasx {} { dl_exists x }
+proc try {script} { if {[catch {uplevel 1 $script} r]} { return error } { return $r } }
+
+# --- plain lists ---
+dl_set x [dl_ilist 1 2 3]
+check "first lookup" [list [lenx] [getx 2]] {3 3}
+check "cached lookup" [list [lenx] [getx 2]] {3 3}
+dl_set x [dl_flist 4 5]
+check "replaced by dl_set" [list [lenx] [getx 1]] {2 5.0}
+dl_delete x
+check "deleted" [list [try lenx] [hasx]] {error 0}
+dl_set x [dl_slist a b c d]
+check "made again" [list [lenx] [getx 3] [hasx]] {4 d 1}
+dl_put x 0 z
+check "dl_put" [getx 0] z
+dl_set y [dl_ilist 9]
+dl_set x y
+check "copied over" [list [lenx] [getx 0]] {1 9}
+
+proc locals {} {
+    dl_local l [dl_ilist 1 2]
+    set r [dl_length $l]
+    dl_local l [dl_ilist 1 2 3]
+    lappend r [dl_length $l]
+}
+check "dl_local" [list [locals] [locals]] {{2 3} {2 3}}
+proc inner {n} { dl_return [dl_fromto 0 $n] }
+proc outer {} {
+    set a [inner 3]
+    set r [dl_length $a]
+    dl_set kept $a
+    lappend r [dl_length kept] [try {dl_length $a}]
+}
+check "dl_return" [outer] {3 3 error}
+dl_delete kept
+
+# --- groups and group:list names ---
+dg_create g
+dl_set g:a [dl_ilist 10 20 30]
+dl_set g:b [dl_ilist 1]
+check "group list" [list [lenga] [getga 1] [hasg]] {3 20 1}
+check "group list cached" [list [lenga] [getga 1]] {3 20}
+dl_set g:a [dl_ilist 7]
+check "replaced in group" [list [lenga] [getga 0]] {1 7}
+dg_remove g a
+check "removed from group" [try lenga] error
+dg_addNewList g a
+dl_append g:a 5
+check "added to group" [list [lenga] [getga 0]] {1 5}
+dg_rename g:a c
+check "renamed in group" [list [try lenga] [dl_length g:c]] {error 1}
+dg_rename g:b a
+check "other list renamed in" [getga 0] 1
+dg_reset g
+check "group reset" [lenga] 0
+dg_delete g
+check "group deleted" [list [try lenga] [hasg]] {error 0}
+dg_create g
+dl_set g:a [dl_flist 1.5]
+check "group made again" [list [hasg] [getga 0]] {1 1.5}
+dg_create h
+dl_set h:a [dl_ilist 1 2]
+dg_rename g old
+dg_rename h g
+check "group renamed over" [list [lenga] [dl_length old:a]] {2 1}
+dg_delete g
+dg_delete old
+
+# --- names that are not cached ---
+proc literal {} { dl_length {1 2 3 4} }
+check "tcl list" [list [literal] [literal]] {4 4}
+dl_set ll [dl_llist [dl_ilist 1 2] [dl_ilist 3 4 5]]
+proc sub {} { dl_length ll:1 }
+check "sublist" [list [sub] [sub]] {3 3}
+dl_set ll [dl_llist [dl_ilist 1]]
+check "sublist after replace" [list [try sub] [dl_length ll:0]] {error 1}
+proc temps {} { dl_length [dl_add [dl_ilist 1 2] 1] }
+check "temps" [list [temps] [temps]] {2 2}
+set name x
+llength $name
+check "shimmered name" [dl_length $name] 1
+check "errors" [list [catch {dl_get nosuch 0}] [catch {dl_add x}] \
+                    [catch {dl_get x 5}] [dl_exists nosuch] [dg_exists nosuch]] \
+    {1 1 1 0 0}
+
+# --- a group list found in one step however far along it is ---
+dg_create wide
+for {set i 0} {$i < 500} {incr i} { dl_set wide:l$i [dl_ilist $i] }
+proc first {n} { for {set i 0} {$i < $n} {incr i} { dl_length wide:l0 } }
+proc last {n} { for {set i 0} {$i < $n} {incr i} { dl_length wide:l499 } }
+set t0 [lindex [time {first 20000} 3] 0]
+set t1 [lindex [time {last 20000} 3] 0]
+check "flat group lookup" [expr {$t1 < 2 * $t0}] 1
+dg_delete wide
+
+# --- timing (informational) ---
+dl_set x [dl_fromto 0 100]
+dg_create g
+dl_set g:a [dl_fromto 0 100]
+foreach cmd {{dl_length x} {dl_get x 5} {dl_add x x} {dl_add x 1}
+             {dl_length g:a} {dl_get g:a 5}} {
+    proc bench {n} "for {set i 0} {\$i < \$n} {incr i} { $cmd }"
+    puts [format "     %-16s %6.2f us" $cmd \
+              [expr {[lindex [time {bench 50000} 3] 0] / 50000.}]]
+}
+dg_delete g
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
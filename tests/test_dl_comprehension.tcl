@@ -1,10 +1,11 @@
 #!/usr/bin/env dlsh
 #
 # test_dl_comprehension.tcl
-#   Correctness test for the embedded comprehension layer (dl_map / dl_filter /
-#   dl_reduce / dl_comp). These procs are built into libdlsh from
-#   src/dl_comprehension.tcl and Tcl_Eval'd in Dl_Init, so they must be present
-#   immediately after the package loads -- this test does NOT source the .tcl.
+#   Correctness test for the comprehension layer (dl_map / dl_filter /
+#   dl_reduce / dl_comp). dl_comp is built into libdlsh from
+#   src/dl_comprehension.tcl and Tcl_Eval'd in Dl_Init, the others are
+#   commands, so all must be present immediately after the package loads --
+#   this test does NOT source the .tcl.
 #
 #   Usage:  dlsh test_dl_comprehension.tcl        (exits non-zero on failure)
 
@@ -0,0 +1,141 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_conv_fft.tcl
+#   dl_conv and dl_conv2 against a Tcl reference (the kernel centred on
+#   each point, data beyond the ends counted as 0), for short kernels
+#   (summed term by term) and long ones (overlap-add FFT), single lists,
+#   lists of trials sharing one kernel, per trial kernels and deeper
+#   lists.  Also checks that stretches of zeros stay exactly 0 on the
+#   FFT path and that threads do not change any result.
+#
+#   Usage:  dlsh test_dl_conv_fft.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# largest difference between two lists, relative to the largest value
+proc reldiff {a b} {
+    if {[llength $a] != [llength $b]} { return "lengths [llength $a] [llength $b]" }
+    set d 0.0
+    set m 1e-30
+    foreach x $a y $b {
+        set d [expr {max($d, abs($x - $y))}]
+        set m [expr {max($m, abs($y))}]
+    }
+    return [expr {$d/$m < 1e-5}]
+}
+
+# reference convolution of one list
+proc ref_conv {v k} {
+    set n [llength $v]
+    set h [expr {[llength $k]/2}]
+    set out {}
+    for {set i 0} {$i < $n} {incr i} {
+        set sum 0.0
+        set lo [expr {max(0, $i-$h)}]
+        set hi [expr {min($n-1, $i+$h)}]
+        for {set t $lo} {$t <= $hi} {incr t} {
+            set sum [expr {$sum + [lindex $k [expr {$t-$i+$h}]]*[lindex $v $t]}]
+        }
+        lappend out $sum
+    }
+    return $out
+}
+
+proc rlist {n} {
+    set l {}
+    for {set i 0} {$i < $n} {incr i} { lappend l [expr {rand()-0.3}] }
+    dl_return [dl_flist {*}$l]
+}
+expr {srand(11)}
+
+# --- single lists, short and long kernels ---
+foreach {n k} {10 3 200 9 300 31 500 101 2000 151 1500 401 700 599} {
+    dl_set d [rlist $n]
+    dl_set kk [rlist $k]
+    check "conv $n $k" \
+        [reldiff [dl_tcllist [dl_conv d kk]] \
+             [ref_conv [dl_tcllist d] [dl_tcllist kk]]] 1
+}
+dl_set ints [dl_int [dl_mult [rlist 800] 100]]
+dl_set ikern [dl_ones 201]
+check "int data and kernel" \
+    [reldiff [dl_tcllist [dl_conv ints ikern]] \
+         [ref_conv [dl_tcllist ints] [dl_tcllist ikern]]] 1
+check "short kernel exact" [dl_tcllist [dl_conv [dl_ilist 1 2 3 4] [dl_ilist 1 1 1]]] \
+    {3.0 6.0 9.0 7.0}
+check "empty kernel" [dl_tcllist [dl_conv [dl_ilist 1 2 3] [dl_ilist]]] {1 2 3}
+
+# stretches of zeros stay exactly zero on the FFT path
+dl_set gap [dl_concat [rlist 1000] [dl_zeros 3000.] [rlist 1000]]
+set g [dl_tcllist [dl_conv gap [rlist 501]]]
+check "fft zeros" [lsort -unique [lrange $g 1300 3700]] 0.0
+check "fft nonzero" [expr {[lindex $g 1100] != 0 && [lindex $g 3900] != 0}] 1
+
+# --- lists of trials ---
+dl_set trials [dl_llist]
+foreach n {1200 900 2000 1500 600} { dl_append trials [rlist $n] }
+dl_set kk [rlist 301]
+set got [dl_tcllist [dl_conv trials kk]]
+foreach g $got trial [dl_tcllist trials] {
+    check "shared kernel [llength $trial]" \
+        [reldiff $g [ref_conv $trial [dl_tcllist kk]]] 1
+}
+check "one kernel sublist" [dl_tcllist [dl_conv trials [dl_llist kk]]] $got
+dl_set kerns [dl_llist]
+foreach k {3 201 301 51 401} { dl_append kerns [rlist $k] }
+foreach g [dl_tcllist [dl_conv trials kerns]] trial [dl_tcllist trials] \
+    k [dl_tcllist kerns] {
+    check "per trial kernel [llength $k]" [reldiff $g [ref_conv $trial $k]] 1
+}
+check "deep conv" [dl_tcllist [dl_conv [dl_llist trials] kk]] [list $got]
+check "deep conv2" [dl_tcllist [dl_conv2 [dl_llist trials trials] [dl_llist kk]]] \
+    [list $got $got]
+
+# --- threads ---
+dl_set many [dl_llist]
+for {set i 0} {$i < 64} {incr i} { dl_append many [rlist [expr {500 + 37*$i}]] }
+proc tresults {} {
+    list [dl_tcllist [dl_conv many [rlist 257]]] \
+        [dl_tcllist [dl_conv many [dl_ones 9.]]] \
+        [dl_tcllist [dl_conv2 [dl_llist many many] [dl_llist [dl_ones 129.]]]]
+}
+expr {srand(3)}
+dl_threads 1
+set want [tresults]
+foreach t {2 4} {
+    expr {srand(3)}
+    dl_threads $t 0
+    check "$t threads identical" [expr {[tresults] eq $want}] 1
+}
+dl_threads 1
+
+# --- errors ---
+check "even kernel" [catch {dl_conv [rlist 100] [rlist 64]}] 1
+check "kernel too long" [catch {dl_conv [rlist 100] [rlist 101]}] 1
+check "kernel count" [catch {dl_conv trials [dl_llist kk kk]}] 1
+check "bad trial" [catch {dl_conv [dl_llist [rlist 500] [rlist 10]] kk}] 1
+check "string list" [catch {dl_conv [dl_slist a b c d] [dl_ilist 1 1 1]}] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
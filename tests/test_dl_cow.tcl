@@ -0,0 +1,161 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_cow.tcl
+#   Correctness test for copy-on-write value buffers.  Copies of numeric
+#   lists (dl_set, dg_copy, dl_local / dl_return, sublist dl_get ...)
+#   share their values until one side is modified; whichever list is
+#   written must get its own copy and the other must never change.
+#
+#   Usage:  dlsh test_dl_cow.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# --- dl_set copies share until written ---
+dl_set a [dl_ilist 1 2 3]
+dl_set b a
+check "copy shares" [dl_isSharedStorage b] 1
+check "source shares" [dl_isSharedStorage a] 1
+dl_put b 0 10
+check "put on copy" [dl_tcllist b] {10 2 3}
+check "source unchanged" [dl_tcllist a] {1 2 3}
+check "copy detached" [dl_isSharedStorage b] 0
+check "source sole owner" [dl_isSharedStorage a] 0
+dl_put a 2 30
+check "sole owner writes in place" [dl_tcllist a] {1 2 30}
+check "copy unchanged" [dl_tcllist b] {10 2 3}
+
+# strings are always copied
+dl_set s1 [dl_slist x y]
+dl_set s2 s1
+check "strings not shared" [dl_isSharedStorage s2] 0
+
+# --- every kind of modification detaches ---
+foreach {label cmd want} {
+    append   {dl_append c 4}          {1 2 3 4}
+    prepend  {dl_prepend c 0}         {0 1 2 3}
+    insert   {dl_insert c 1 9}        {1 9 2 3}
+    concat   {dl_concat c [dl_ilist 7]} {1 2 3 7}
+    incr     {dl_increment c 1}       {1 3 3}
+    counter  {dl_increment c}         {1 2 3 4}
+    reset    {dl_reset c; dl_append c 5} {5}
+    reserve  {dl_reserve c 100; dl_put c 0 8} {8 2 3}
+} {
+    dl_set src [dl_ilist 1 2 3]
+    dl_set c src
+    eval $cmd
+    check "$label copy" [dl_tcllist c] $want
+    check "$label source" [dl_tcllist src] {1 2 3}
+}
+
+# the source can be modified too
+dl_set src [dl_flist 1 2 3]
+dl_set c src
+dl_append src 4
+dl_put src 0 0
+check "modified source" [dl_tcllist src] {0.0 2.0 3.0 4.0}
+check "copy of modified source" [dl_tcllist c] {1.0 2.0 3.0}
+
+# sorting a shared list returns a sorted copy only
+dl_set u [dl_ilist 3 1 2]
+dl_set v u
+check "sort" [dl_tcllist [dl_sort v]] {1 2 3}
+check "sort leaves source" [dl_tcllist u] {3 1 2}
+
+# --- sublists ---
+dl_set ll [dl_llist [dl_ilist 1 2] [dl_ilist 3 4 5]]
+set sub [dl_get ll 1]
+check "sublist get shares" [dl_isSharedStorage $sub] 1
+dl_put $sub 0 99
+check "sublist copy modified" [dl_tcllist $sub] {99 4 5}
+check "parent unchanged" [dl_tcllist ll] {{1 2} {3 4 5}}
+dl_set ll2 ll
+dl_put ll2:0 1 20
+check "nested copy modified" [dl_tcllist ll2] {{1 20} {3 4 5}}
+check "nested source unchanged" [dl_tcllist ll] {{1 2} {3 4 5}}
+
+# --- groups ---
+set g [dg_create]
+dl_set $g:x [dl_fromto 0 5]
+dl_set $g:y [dl_flist 0.5 1.5]
+set g2 [dg_copy $g]
+check "dg_copy shares" [dl_isSharedStorage $g2:x] 1
+dl_put $g2:x 0 100
+dl_append $g:y 2.5
+check "group copy modified" [dl_tcllist $g2:x] {100 1 2 3 4}
+check "group source unchanged" [dl_tcllist $g:x] {0 1 2 3 4}
+check "group source appended" [dl_tcllist $g:y] {0.5 1.5 2.5}
+check "group copy not appended" [dl_tcllist $g2:y] {0.5 1.5}
+dg_delete $g
+check "copy outlives source" [dl_tcllist $g2:y] {0.5 1.5}
+
+# dg_concat copies its first input
+set c1 [dg_create]
+dl_set $c1:x [dl_ilist 1 2]
+set c2 [dg_create]
+dl_set $c2:x [dl_ilist 3]
+set cc [dg_concat $c1 $c2]
+check "concat result" [dl_tcllist $cc:x] {1 2 3}
+check "concat first input" [dl_tcllist $c1:x] {1 2}
+
+# --- dl_local / dl_return ---
+proc scale {l} {
+    dl_local r $l
+    dl_put $r 0 -1
+    dl_return $r
+}
+dl_set p [dl_ilist 5 6]
+check "proc result" [dl_tcllist [scale p]] {-1 6}
+check "proc input unchanged" [dl_tcllist p] {5 6}
+
+# --- values read into a group arena can be shared too ---
+set src [dg_create]
+dl_set $src:x [dl_ilist 1 2 3]
+dl_set $src:f [dl_flist 4 5]
+dg_toString $src buf
+set r [dg_fromString $buf cowread]
+set rc [dg_copy $r cowcopy]
+check "arena copy shares" [dl_isSharedStorage $rc:x] 1
+dg_delete $r
+check "arena copy outlives group" [dl_tcllist $rc:x] {1 2 3}
+dl_put $rc:f 1 6
+check "arena copy writable" [dl_tcllist $rc:f] {4.0 6.0}
+dg_delete $rc
+
+# --- copies are cheap: many copies of a big list cost no memory ---
+proc rss_kb {} {
+    if {![file readable /proc/self/status]} { return 0 }
+    set f [open /proc/self/status]; set s [read $f]; close $f
+    if {[regexp {VmRSS:\s+(\d+)} $s -> kb]} { return $kb }
+    return 0
+}
+dl_set big [dl_zeros 2000000.]
+set before [rss_kb]
+for {set i 0} {$i < 50} {incr i} { dl_set bigcopy$i big }
+set grew [expr {[rss_kb] - $before}]
+check "50 copies of 8MB list (grew ${grew}kB)" [expr {$grew < 16384}] 1
+check "copy contents" [dl_sum bigcopy49] 0.0
+for {set i 0} {$i < 50} {incr i} { dl_delete bigcopy$i }
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,185 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_dict_strings.tcl
+#   Correctness test for dictionary encoded string lists.  An encoded
+#   list must give exactly the same results as the plain string list it
+#   was made from (comparisons, sorting, uniques, grouping), decode
+#   itself when modified, and keep its encoding through dg_toString /
+#   dg_fromString and dg_write / dg_read.
+#
+#   Usage:  dlsh test_dl_dict_strings.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+set words {pear apple fig apple kiwi pear pear date fig banana}
+
+# --- encode / decode ---
+dl_set plain [dl_slist {*}$words]
+dl_set enc [dl_slist {*}$words]
+check "not encoded" [dl_isDictEncoded enc] 0
+dl_dictEncode enc
+check "encoded" [dl_isDictEncoded enc] 1
+check "contents" [dl_tcllist enc] [dl_tcllist plain]
+check "length" [dl_length enc] 10
+check "datatype" [dl_datatype enc] string
+check "table" [dl_tcllist [dl_dictStrings enc]] {apple banana date fig kiwi pear}
+check "codes" [dl_tcllist [dl_dictCodes enc]] {5 0 3 0 4 5 5 2 3 1}
+check "codes histogram" [dl_tcllist [dl_hist [dl_dictCodes enc] 0 6 6]] \
+    {2 1 1 2 1 3}
+check "encode twice" [dl_tcllist [dl_dictEncode enc]] [dl_tcllist plain]
+check "encode non-string" [catch {dl_dictEncode [dl_ilist 1 2]}] 1
+check "codes of plain list" [catch {dl_dictCodes plain}] 1
+
+# --- results identical to the plain list ---
+foreach op {eq noteq lt lte gt gte eqIndex ltIndex} {
+    foreach s {apple pear zzz aaa} {
+        check "list $op $s" [dl_tcllist [dl_$op enc $s]] \
+            [dl_tcllist [dl_$op plain $s]]
+        check "$s $op list" [dl_tcllist [dl_$op $s enc]] \
+            [dl_tcllist [dl_$op $s plain]]
+    }
+}
+dl_set enc2 [dl_sort enc]
+dl_set plain2 [dl_sort plain]
+check "sort" [dl_tcllist enc2] [dl_tcllist plain2]
+check "sort result encoded" [dl_isDictEncoded enc2] 1
+dl_set rev [dl_reverse enc]
+dl_dictEncode rev
+foreach op {eq noteq lt eqIndex} {
+    check "list $op list" [dl_tcllist [dl_$op enc enc2]] \
+        [dl_tcllist [dl_$op plain plain2]]
+    check "separate tables $op" [dl_tcllist [dl_$op enc rev]] \
+        [dl_tcllist [dl_$op plain [dl_reverse plain]]]
+}
+check "sortIndices" [dl_tcllist [dl_sortIndices enc]] \
+    [dl_tcllist [dl_sortIndices plain]]
+check "unique" [dl_tcllist [dl_unique enc]] [dl_tcllist [dl_unique plain]]
+check "unique encoded" [dl_isDictEncoded [dl_unique enc]] 1
+check "uniqueNoSort" [dl_tcllist [dl_uniqueNoSort enc2]] \
+    [dl_tcllist [dl_uniqueNoSort plain2]]
+check "find" [dl_tcllist [dl_find enc fig]] [dl_tcllist [dl_find plain fig]]
+check "select" [dl_tcllist [dl_select enc [dl_eq enc pear]]] {pear pear pear}
+dl_set vals [dl_fromto 0 10]
+check "sortByList" [dl_tcllist [dl_sortByList vals enc]] \
+    [dl_tcllist [dl_sortByList vals plain]]
+check "sortByLists" [dl_tcllist [dl_sortByLists vals enc]] \
+    [dl_tcllist [dl_sortByLists vals plain]]
+check "countOccurences" [dl_tcllist [dl_countOccurences enc [dl_slist pear fig]]] \
+    [dl_tcllist [dl_countOccurences plain [dl_slist pear fig]]]
+check "empty" [dl_tcllist [dl_dictEncode [dl_slist]]] {}
+
+# --- modifications decode the list ---
+dl_set m enc
+check "copy encoded" [dl_isDictEncoded m] 1
+dl_put m 0 grape
+check "put" [dl_get m 0] grape
+check "put decodes" [dl_isDictEncoded m] 0
+check "source unchanged" [dl_tcllist enc] [dl_tcllist plain]
+foreach {label cmd want} {
+    append  {dl_append c z}          {b a b z}
+    prepend {dl_prepend c z}         {z b a b}
+    insert  {dl_insert c 1 z}        {b z a b}
+    concat  {dl_concat c [dl_slist z]} {b a b z}
+    reset   {dl_reset c; dl_append c z} {z}
+} {
+    dl_set c [dl_dictEncode [dl_slist b a b]]
+    eval $cmd
+    check "$label" [dl_tcllist c] $want
+    check "$label decodes" [dl_isDictEncoded c] 0
+}
+dl_set d [dl_dictEncode [dl_slist x y x]]
+dl_dictDecode d
+check "decode" [list [dl_isDictEncoded d] [dl_tcllist d]] {0 {x y x}}
+
+# --- serialization keeps the encoding ---
+set g [dg_create dictgroup]
+dl_set $g:s [dl_slist {*}$words]
+dl_set $g:n [dl_fromto 0 10]
+dl_set $g:t [dl_slist a b]
+check "dg_dictEncode" [dg_dictEncode $g] 2
+dg_toString $g buf
+binary scan $buf @5f v
+check "buffer version" $v 2.0
+set h [dg_fromString $buf dictcopy]
+check "buffer round trip" [dl_tcllist $h:s] [dl_tcllist plain]
+check "buffer keeps encoding" [dl_isDictEncoded $h:s] 1
+check "buffer other columns" [dl_tcllist $h:n] [dl_tcllist $g:n]
+dl_append $h:s melon
+check "read list appendable" [dl_get $h:s 10] melon
+dg_delete $h
+
+set tmp [file tempdir]
+foreach ext {dg dgz lz4} {
+    set fname [file join $tmp dict.$ext]
+    dg_write $g $fname
+    set h [dg_read $fname dict_$ext]
+    check "$ext round trip" [dl_tcllist $h:s] [dl_tcllist plain]
+    check "$ext keeps encoding" [dl_isDictEncoded $h:s] 1
+    dg_delete $h
+}
+file delete -force $tmp
+
+# plain string groups are unchanged
+set p [dg_create plaingroup]
+dl_set $p:s [dl_slist a b]
+dg_toString $p pbuf
+binary scan $pbuf @5f v
+check "plain buffer version" $v 1.0
+dg_delete $p
+
+# a table that is not sorted is rejected
+set b2 [string map [list [binary format ia1xia1x 2 a 2 b] \
+                        [binary format ia1xia1x 2 b 2 a]] $buf]
+check "unsorted table rejected" [catch {dg_fromString $b2 bad}] 1
+dg_delete $g
+
+# --- memory is released ---
+proc rss_kb {} {
+    if {![file readable /proc/self/status]} { return 0 }
+    set f [open /proc/self/status]; set s [read $f]; close $f
+    if {[regexp {VmRSS:\s+(\d+)} $s -> kb]} { return $kb }
+    return 0
+}
+dl_set many [dl_repeat [dl_slist alpha beta gamma delta] 25000]
+# temporaries made inside a proc are released when it returns
+proc churn {i} {
+    dl_set e many
+    dl_dictEncode e
+    dl_set u [dl_unique [dl_sort e]]
+    dl_set eq [dl_eq e beta]
+    set g [dg_create tmp$i]
+    dl_set $g:e e
+    dg_toString $g buf
+    dg_delete [dg_fromString $buf tmpcopy$i]
+    dg_delete $g
+    dl_put e 0 x
+}
+for {set i 0} {$i < 10} {incr i} { churn $i }
+set before [rss_kb]
+for {set i 0} {$i < 100} {incr i} { churn $i }
+set grew [expr {[rss_kb] - $before}]
+check "no leak (grew ${grew}kB)" [expr {$grew < 16384}] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,198 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_expr.tcl
+#   dl_expr must give exactly the list the equivalent nested dl_add /
+#   dl_mult / dl_lt ... commands give: same datatype, same values (compared
+#   bit for bit through dg_toString), same broadcasting of length 1 lists
+#   and the same recursion into lists of lists.  Also checks parsing,
+#   error messages, $var operands, the compiled expression cache and that
+#   repeated evaluation does not leak.
+#
+#   Usage:  dlsh test_dl_expr.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+proc bytes {l} {
+    set g [dg_create exprcmp]
+    dl_set $g:r $l
+    dg_toString $g buf
+    dg_delete $g
+    return [binary encode hex $buf]
+}
+
+proc same {label got want} {
+    check $label [bytes $got] [bytes $want]
+}
+
+# --- inputs: longer than one evaluation block, with an odd tail ---
+dl_setMatherr 0
+set n 2500
+dl_set a [dl_mult [dl_sub [dl_urand $n] 0.5] 20.0]
+dl_set b [dl_mult [dl_sub [dl_urand $n] 0.5] 20.0]
+dl_set b [dl_mult b [dl_gt [dl_urand $n] 0.2]]
+dl_set i [dl_int [dl_mult [dl_sub [dl_urand $n] 0.5] 200]]
+dl_set j [dl_int [dl_mult [dl_sub [dl_urand $n] 0.5] 20]]
+dl_set s [dl_short [dl_mult [dl_sub [dl_urand $n] 0.5] 200]]
+dl_set s2 [dl_short [dl_mult [dl_sub [dl_urand $n] 0.5] 20]]
+dl_set c [dl_char [dl_mult [dl_urand $n] 100]]
+dl_set one [dl_flist 2.5]
+dl_set ione [dl_ilist 3]
+
+# --- arithmetic ---
+same "float add"   [dl_expr a + b]          [dl_add a b]
+same "float chain" [dl_expr {a * b + a / b - 2.0}] \
+    [dl_sub [dl_add [dl_mult a b] [dl_div a b]] 2.0]
+same "int chain"   [dl_expr {i * j - i / j + 7}] \
+    [dl_add [dl_sub [dl_mult i j] [dl_div i j]] 7]
+same "short"       [dl_expr {s * s2 + s - s2}] \
+    [dl_sub [dl_add [dl_mult s s2] s] s2]
+same "char"        [dl_expr {c + c * c}] [dl_add c [dl_mult c c]]
+same "mixed"       [dl_expr {i * a + s}] [dl_add [dl_mult i a] s]
+same "broadcast"   [dl_expr {one * a + ione}] [dl_add [dl_mult one a] ione]
+same "min max"     [dl_expr {min(a, b) + max(i, a)}] \
+    [dl_add [dl_min a b] [dl_max i a]]
+same "pow fmod"    [dl_expr {pow(a, 2) + fmod(a, 3.0) + atan2(a, b)}] \
+    [dl_add [dl_add [dl_pow a 2] [dl_fmod a 3.0]] [dl_atan2 a b]]
+same "int pow"     [dl_expr {pow(j, 2)}] [dl_pow j 2]
+same "negate"      [dl_expr {-a - -i}] [dl_sub [dl_negate a] [dl_negate i]]
+same "unary plus"  [dl_expr {+a}] [dl_expr a]
+same "precedence"  [dl_expr {1 + 2 * 3 - 4 / 2.0}] \
+    [dl_sub [dl_add 1 [dl_mult 2 3]] [dl_div 4 2.0]]
+same "parens"      [dl_expr {(a + b) * (a - b)}] \
+    [dl_mult [dl_add a b] [dl_sub a b]]
+same "name only"   [dl_expr a] a
+
+# --- relations and logic ---
+same "relation"    [dl_expr {a > b}] [dl_gt a b]
+same "and or not"  [dl_expr {(a > 0 && b < 0) || !(i == j)}] \
+    [dl_or [dl_and [dl_gt a 0] [dl_lt b 0]] [dl_not [dl_eq i j]]]
+same "compare ops" [dl_expr {(i <= j) + (i >= j) + (i != 0) + (s < s2)}] \
+    [dl_add [dl_add [dl_add [dl_lte i j] [dl_gte i j]] [dl_noteq i 0]] \
+         [dl_lt s s2]]
+same "mixed rel"   [dl_expr {i < a}] [dl_lt i a]
+dl_set m [dl_ilist 7 -7 9 10]
+dl_set md [dl_ilist 3 3 0 4]
+check "mod values" [dl_tcllist [dl_expr {m % md}]] {1 -1 0 2}
+
+# --- one argument functions ---
+dl_set pos [dl_add [dl_abs a] 0.5]
+same "sqrt log"    [dl_expr {sqrt(pos) + log(pos) - exp(a / 10.0)}] \
+    [dl_sub [dl_add [dl_sqrt pos] [dl_log pos]] [dl_exp [dl_div a 10.0]]]
+same "trig"        [dl_expr {sin(a) * cos(b) + tanh(a)}] \
+    [dl_add [dl_mult [dl_sin a] [dl_cos b]] [dl_tanh a]]
+same "round"       [dl_expr {floor(a) + ceil(b) - round(a)}] \
+    [dl_sub [dl_add [dl_floor a] [dl_ceil b]] [dl_round a]]
+same "int abs"     [dl_expr {abs(i) + abs(j)}] [dl_add [dl_abs i] [dl_abs j]]
+same "short abs"   [dl_expr {abs(s) - s2}] [dl_sub [dl_abs s] s2]
+same "int sqrt"    [dl_expr {sqrt(abs(i))}] [dl_sqrt [dl_abs i]]
+
+# --- empty and length 1 lists ---
+dl_set e [dl_flist]
+check "empty name" [dl_length [dl_expr {a * e + 1}]] 0
+same "all scalar" [dl_expr {one * 2 + ione}] [dl_add [dl_mult one 2] ione]
+check "constants" [dl_tcllist [dl_expr {2 * 3 + 1}]] 7
+
+# --- lists of lists ---
+dl_set ll [dl_llist [dl_flist 1 2 3] [dl_flist 4 5] [dl_flist]]
+dl_set ll2 [dl_llist [dl_flist 10 20 30] [dl_flist 1 2] [dl_flist]]
+dl_set per [dl_flist 100 200 300]
+same "list list"   [dl_expr {ll * ll2 + 1}] [dl_add [dl_mult ll ll2] 1]
+same "list flat"   [dl_expr {ll + per}] [dl_add ll per]
+same "list scalar" [dl_expr {sqrt(ll) > 1.5}] [dl_gt [dl_sqrt ll] 1.5]
+dl_set l1 [dl_llist [dl_flist 2]]
+same "list bcast"  [dl_expr {l1 * ll2}] [dl_mult l1 ll2]
+dl_set nest [dl_llist [dl_llist [dl_ilist 1 2] [dl_ilist 3]] \
+                 [dl_llist [dl_ilist 4 5 6]]]
+same "nested"      [dl_expr {nest * 2 - nest}] [dl_sub [dl_mult nest 2] nest]
+
+# --- groups and variables ---
+set g [dg_create]
+dl_set $g:x [dl_fromto 0 10]
+dl_set $g:y [dl_fromto 10 20]
+same "group:list"  [dl_expr $g:x * $g:y] [dl_mult $g:x $g:y]
+proc scaled {l k} { dl_return [dl_expr {$l * $k + 1}] }
+same "\$var"       [scaled a one] [dl_add [dl_mult a one] 1]
+dg_delete $g
+
+# --- errors ---
+check "usage" [catch {dl_expr} msg] 1
+check "syntax" [list [catch {dl_expr {a +}} msg] $msg] \
+    {1 {dl_expr: syntax error at end of expression}}
+check "paren" [catch {dl_expr {(a + b}} msg] 1
+check "function" [list [catch {dl_expr {foo(a)}} msg] $msg] \
+    {1 {dl_expr: unknown function at "foo(a)"}}
+check "no list" [catch {dl_expr {nosuchlist + 1}}] 1
+dl_set two [dl_flist 1 2]
+check "length" [list [catch {dl_expr {a + two}} msg] $msg] \
+    {1 {dl_expr: list lengths do not match}}
+check "types" [catch {dl_expr {i + s}}] 1
+dl_set str [dl_slist a b]
+check "strings" [catch {dl_expr {str + 1}}] 1
+check "no var" [catch {dl_expr {$nosuchvar + 1}}] 1
+dl_setMatherr 1
+check "domain" [list [catch {dl_expr {sqrt(a)}} msg] $msg] \
+    {1 {dl_expr: argument out of domain}}
+check "domain ok" [dl_length [dl_expr {sqrt(pos)}]] $n
+dl_setMatherr 0
+
+# --- simd and scalar paths agree ---
+set best [dl_simd best]
+set want [bytes [dl_expr {a * b + i / 3.0 > s}]]
+dl_simd scalar
+check "scalar path" [bytes [dl_expr {a * b + i / 3.0 > s}]] $want
+dl_simd $best
+
+# --- cache ---
+dl_exprCache clear
+check "cache empty" [dl_exprCache] 0
+dl_expr {a + b}
+dl_expr {a + b}
+dl_expr {a - b}
+check "cache reuse" [dl_exprCache] 2
+check "cache usage" [catch {dl_exprCache flush}] 1
+for {set k 0} {$k < 600} {incr k} { dl_expr "a + $k" }
+check "cache bounded" [expr {[dl_exprCache] <= 512}] 1
+
+# --- leaks: temporaries are reclaimed when the proc returns ---
+proc get_rss_kb {} {
+    if {[file readable /proc/self/status]} {
+        set f [open /proc/self/status r]; set d [read $f]; close $f
+        if {[regexp {VmRSS:\s+(\d+)\s+kB} $d -> rss]} { return $rss }
+    }
+    return -1
+}
+proc work {} {
+    for {set k 0} {$k < 50} {incr k} {
+        dl_expr {a * b + sqrt(pos) - (i > j)}
+        dl_expr {ll * ll2 + per}
+    }
+}
+for {set r 0} {$r < 5} {incr r} { work }
+set rss0 [get_rss_kb]
+for {set r 0} {$r < 40} {incr r} { work }
+set growth [expr {[get_rss_kb] - $rss0}]
+check "no leak ($growth kB)" [expr {$growth < 1024}] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,226 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_groupby.tcl
+#   dl_sortByLists / dl_sortBySelected against a Tcl reference (every
+#   crossing of the unique selection values, first list fastest, empty
+#   crossings kept, unmatched rows dropped), dl_groupBy with and
+#   without aggregates against the same reductions of the grouped
+#   lists, and dg_aggregate, on int, float, short, char, string and
+#   dictionary string keys.
+#
+#   Usage:  dlsh test_dl_groupby.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# reference: rows of data for every crossing of the selection uniques
+proc ref_sortByLists {data cats sels} {
+    set d [dl_tcllist $data]
+    set cs {}
+    set us {}
+    foreach c $cats s $sels {
+        lappend cs [dl_tcllist $c]
+        lappend us [dl_tcllist [dl_unique $s]]
+    }
+    set result {}
+    foreach combo [ref_cross $us] {
+        set l {}
+        for {set i 0} {$i < [llength $d]} {incr i} {
+            set ok 1
+            foreach c $cs v $combo {
+                if {[lindex $c $i] != $v} { set ok 0; break }
+            }
+            if {$ok} { lappend l [lindex $d $i] }
+        }
+        lappend result $l
+    }
+    return $result
+}
+
+# combinations of the unique lists, first list varying fastest
+proc ref_cross {us} {
+    set out {}
+    set n 1
+    set sizes [lmap u $us {llength $u}]
+    foreach s $sizes { set n [expr {$n * $s}] }
+    for {set i 0} {$i < $n} {incr i} {
+        set combo {}
+        set r $i
+        foreach u $us s $sizes {
+            lappend combo [lindex $u [expr {$r % $s}]]
+            set r [expr {$r / $s}]
+        }
+        lappend out $combo
+    }
+    return $out
+}
+
+proc ref_median {l} {
+    set s [lsort -real $l]
+    set n [llength $s]
+    if {!$n} { return 0.0 }
+    if {$n % 2} { return [expr {double([lindex $s [expr {$n/2}]])}] }
+    return [expr {([lindex $s [expr {$n/2}]] + [lindex $s [expr {$n/2-1}]])/2.0}]
+}
+
+proc close {a b} {
+    foreach x $a y $b {
+        if {abs($x - $y) > 1e-4 * (1 + abs($y))} { return 0 }
+    }
+    return [expr {[llength $a] == [llength $b]}]
+}
+
+# --- inputs ---
+set n 500
+dl_set rt [dl_mult [dl_urand $n] 100]
+dl_set id [dl_ilist]
+for {set i 0} {$i < $n} {incr i} { dl_append id $i }
+dl_set side [dl_int [dl_mult [dl_urand $n] 3]]
+dl_set coh [dl_char [dl_sub [dl_int [dl_mult [dl_urand $n] 4]] 2]]
+dl_set sh [dl_short [dl_mult [dl_int [dl_mult [dl_urand $n] 2]] 1000]]
+dl_set fk [dl_div [dl_int [dl_mult [dl_urand $n] 3]] 2.0]
+set words {left right up down}
+dl_set name [dl_slist]
+foreach v [dl_tcllist side] { dl_append name [lindex $words $v] }
+dl_set dname name
+dl_dictEncode dname
+
+# --- dl_sortByLists / dl_sortBySelected ---
+foreach keys {{side} {side coh} {coh side sh} {fk} {name} {dname side}
+              {sh dname fk}} {
+    set want [ref_sortByLists id $keys $keys]
+    check "sortByLists $keys" [dl_tcllist [dl_sortByLists id {*}$keys]] $want
+    check "sortBySelected $keys" \
+        [dl_tcllist [dl_sortBySelected id $keys $keys]] $want
+}
+
+# selections that leave some crossings empty and some rows unmatched
+dl_set a [dl_ilist 1 2 1 3 2 1]
+dl_set b [dl_slist x y y x x z]
+dl_set v [dl_flist 10 20 30 40 50 60]
+dl_set sa [dl_ilist 1 2]
+dl_set sb [dl_slist x y]
+check "selections" [dl_tcllist [dl_sortBySelected v {a b} {sa sb}]] \
+    {10.0 50.0 30.0 20.0}
+check "all crossings" [dl_tcllist [dl_sortByLists v a b]] \
+    {10.0 50.0 40.0 30.0 20.0 {} 60.0 {} {}}
+dl_set sb2 [dl_slist x w]
+check "empty crossings" [dl_tcllist [dl_sortBySelected v {a b} {sa sb2}]] \
+    {{} {} 10.0 50.0}
+check "string data" [dl_tcllist [dl_sortByLists b a]] {{x y z} {y x} x}
+check "zero and -0 together" \
+    [dl_tcllist [dl_sortByLists [dl_ilist 1 2 3] [dl_flist 0 -0.0 1]]] \
+    {{1 2} 3}
+
+# --- dl_groupBy ---
+foreach keys {{side} {side coh} {name} {dname sh} {fk coh}} {
+    set cats $keys
+    set full [ref_sortByLists rt $cats $cats]
+    set u [dl_uniqueCross {*}$cats]
+    set keep {}
+    set i 0
+    foreach l $full {
+        if {[llength $l]} { lappend keep $i }
+        incr i
+    }
+    dl_set sel [dl_ilist {*}$keep]
+    dl_set groups [dl_choose [dl_sortByLists rt {*}$cats] sel]
+    set r [dl_groupBy rt {*}$cats]
+    check "groupBy $keys length" [dl_length $r] [expr {[llength $cats]+1}]
+    for {set k 0} {$k < [llength $cats]} {incr k} {
+        check "groupBy $keys key $k" [dl_tcllist $r:$k] \
+            [dl_tcllist [dl_choose $u:$k sel]]
+    }
+    check "groupBy $keys data" [dl_tcllist $r:[llength $cats]] \
+        [dl_tcllist groups]
+
+    set r [dl_groupBy -agg {count sum mean std sem min max median} rt {*}$cats]
+    set o [llength $cats]
+    check "count $keys" [dl_tcllist $r:$o] [dl_tcllist [dl_lengths groups]]
+    check "sum $keys" [dl_tcllist $r:[incr o]] [dl_tcllist [dl_sums groups]]
+    check "mean $keys" [dl_tcllist $r:[incr o]] [dl_tcllist [dl_means groups]]
+    check "std $keys" [dl_tcllist $r:[incr o]] [dl_tcllist [dl_stds groups]]
+    check "sem $keys" [close [dl_tcllist $r:[incr o]] \
+        [dl_tcllist [dl_div [dl_stds groups] [dl_sqrt [dl_lengths groups]]]]] 1
+    check "min $keys" [dl_tcllist $r:[incr o]] [dl_tcllist [dl_mins groups]]
+    check "max $keys" [dl_tcllist $r:[incr o]] [dl_tcllist [dl_maxs groups]]
+    check "median $keys" [close [dl_tcllist $r:[incr o]] \
+        [lmap l [dl_tcllist groups] {ref_median $l}]] 1
+}
+
+check "int median" [dl_tcllist [dl_groupBy -agg median \
+    [dl_ilist 1 4 2 7 3] [dl_ilist 0 0 1 0 1]]:1] {4.0 2.5}
+check "char data" [dl_tcllist [dl_groupBy -agg {min max sum} \
+    [dl_char [dl_ilist -5 3 -1 7]] [dl_slist a b a b]]] \
+    {{a b} {-5 3} {-1 7} {-6 10}}
+check "nan keys one group" [dl_tcllist [dl_groupBy -agg count \
+    [dl_ilist 1 2 3] [dl_log [dl_flist -1 -1 1]]]:1] {1 2}
+check "empty" [dl_tcllist [dl_groupBy -agg {count mean} [dl_flist] [dl_ilist]]] \
+    {{} {} {}}
+
+# --- dg_aggregate ---
+set g [dg_create trials]
+dl_set $g:side side
+dl_set $g:name name
+dl_set $g:rt rt
+dl_set $g:coh coh
+set a [dg_aggregate $g {name coh} {rt mean rt count coh max}]
+check "aggregate lists" [dg_tclListnames $a] \
+    {name coh rt_mean rt_count coh_max}
+set r [dl_groupBy -agg {mean count} rt name coh]
+check "aggregate keys" [dl_tcllist $a:name] [dl_tcllist $r:0]
+check "aggregate mean" [dl_tcllist $a:rt_mean] [dl_tcllist $r:2]
+check "aggregate count" [dl_tcllist $a:rt_count] [dl_tcllist $r:3]
+check "aggregate max" [dl_tcllist $a:coh_max] [dl_tcllist $a:coh]
+dg_delete $a
+
+# --- large inputs and threads ---
+set big 200000
+dl_set bk [dl_int [dl_mult [dl_urand $big] 1000]]
+dl_set bv [dl_urand $big]
+dl_set bgroups [dl_sortByLists bv bk]
+check "big groups" [dl_length bgroups] [dl_length [dl_unique bk]]
+check "big rows" [dl_sum [dl_lengths bgroups]] $big
+dl_threads 1
+set want [dl_tcllist [dl_groupBy -agg {mean std} bv bk]]
+dl_threads 4 0
+check "threads identical" [dl_tcllist [dl_groupBy -agg {mean std} bv bk]] $want
+dl_threads 1
+
+# --- errors ---
+check "usage" [catch {dl_groupBy rt} msg] 1
+check "bad agg" [catch {dl_groupBy -agg mode rt side} msg] 1
+check "bad agg msg" [string match "*unknown aggregate*" $msg] 1
+check "length mismatch" [catch {dl_groupBy rt [dl_ilist 1 2]} msg] 1
+check "string agg" [catch {dl_groupBy -agg mean name side} msg] 1
+check "missing column" [catch {dg_aggregate $g {side} {nope mean}} msg] 1
+check "odd pairs" [catch {dg_aggregate $g {side} {rt}} msg] 1
+check "duplicate pair" [catch {dg_aggregate $g {side} {rt mean rt mean}} msg] 1
+check "duplicate pair msg" [string match "*duplicate aggregate*" $msg] 1
+dl_set $g:rt_max rt
+check "key named like aggregate" \
+    [catch {dg_aggregate $g {rt_max} {rt max}} msg] 1
+dg_delete $g
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,184 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_hist.tcl
+#   dl_hist, dl_hists and dl_hist2d on float, int, short and char lists
+#   against a Tcl reference (bin = int((x-start)/width), start
+#   inclusive, stop exclusive), including values on bin edges, out of
+#   range values, NaN and inf, lists of lists and int and float ranges.
+#   The vector kernels multiply by 1/width; every level must give the
+#   same counts as the scalar division, and threads must not change
+#   the counts.
+#
+#   Usage:  dlsh test_dl_hist.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# reference histogram of a Tcl list
+proc ref_bin {v start stop nbins} {
+    if {!($v >= $start && $v < $stop)} { return -1 }
+    set b [expr {int(($v - $start) / (($stop - $start) / double($nbins)))}]
+    if {$b >= $nbins} { set b [expr {$nbins - 1}] }
+    return $b
+}
+
+proc ref_hist {l start stop nbins} {
+    set counts [lrepeat $nbins 0]
+    foreach v $l {
+        if {[string is double -strict $v] && $v eq $v} {
+            set b [ref_bin $v $start $stop $nbins]
+            if {$b >= 0} { lset counts $b [expr {[lindex $counts $b] + 1}] }
+        }
+    }
+    return $counts
+}
+
+proc ref_hist2d {xs ys xr nx yr ny} {
+    set counts [lrepeat [expr {$nx*$ny}] 0]
+    foreach x $xs y $ys {
+        set bx [ref_bin $x {*}$xr $nx]
+        set by [ref_bin $y {*}$yr $ny]
+        if {$bx >= 0 && $by >= 0} {
+            set k [expr {$by*$nx + $bx}]
+            lset counts $k [expr {[lindex $counts $k] + 1}]
+        }
+    }
+    set rows {}
+    for {set r 0} {$r < $ny} {incr r} {
+        lappend rows [lrange $counts [expr {$r*$nx}] [expr {($r+1)*$nx - 1}]]
+    }
+    return $rows
+}
+
+# --- inputs: quarters, so values print and compare exactly ---
+set n 3001
+dl_set f [dl_div [dl_int [dl_mult [dl_sub [dl_urand $n] 0.3] 480]] 4.0]
+dl_set i [dl_int [dl_mult [dl_sub [dl_urand $n] 0.3] 130]]
+dl_set s [dl_short i]
+dl_set c [dl_char [dl_mult [dl_urand $n] 120]]
+dl_set nan [dl_log [dl_flist -1]]
+dl_set sp [dl_concat [dl_flist 0 10 -0.0 9.999 5 inf -inf] nan \
+               [dl_flist 2.5 7.5 100]]
+
+foreach l {f i s c} {
+    set tl [dl_tcllist $l]
+    foreach {start stop nbins} {0 100 10 0 100 7 -20 20 40 -1.5 60.5 31
+                                10 10 3 5 1 4 0 1 1} {
+        check "hist $l $start $stop $nbins" \
+            [dl_tcllist [dl_hist $l $start $stop $nbins]] \
+            [ref_hist $tl $start $stop $nbins]
+    }
+}
+check "specials" [dl_tcllist [dl_hist sp 0 10 4]] {2 1 1 2}
+check "empty" [dl_tcllist [dl_hist [dl_flist] 0 1 3]] {0 0 0}
+
+# --- lists of lists ---
+dl_set ll [dl_llist [dl_flist 1 2 3.5] [dl_flist] [dl_flist 9 2] \
+               [dl_llist [dl_flist 4 4]]]
+check "nested sum" [dl_tcllist [dl_hist ll 0 10 5]] {1 3 2 0 1}
+check "hists" [dl_tcllist [dl_hists ll 0 10 5]] \
+    {{1 2 0 0 0} {0 0 0 0 0} {0 1 0 0 1} {0 0 2 0 0}}
+dl_set trials [dl_reshape [dl_mult [dl_urand 20000] 100] 400 50]
+set want {}
+foreach t [dl_tcllist trials] { lappend want [ref_hist $t 0 100 20] }
+check "hists trials" [dl_tcllist [dl_hists trials 0 100 20]] $want
+check "hists mixed types" \
+    [dl_tcllist [dl_hists [dl_llist [dl_ilist 1 5] [dl_short [dl_ilist 3]] \
+                               [dl_char [dl_ilist 9]]] 0 10 2]] \
+    {{1 1} {1 0} {0 1}}
+
+# --- 2D ---
+dl_set x [dl_div [dl_int [dl_mult [dl_urand $n] 90]] 2.0]
+dl_set y [dl_int [dl_mult [dl_sub [dl_urand $n] 0.1] 60]]
+set tx [dl_tcllist x]
+set ty [dl_tcllist y]
+foreach {xr nx yr ny} {{0 40} 8 {0 50} 5 {-5 45} 10 {10 30} 20 {0 1} 1 {0 50} 1} {
+    check "hist2d $xr $nx $yr $ny" \
+        [dl_tcllist [dl_hist2d x y {*}$xr $nx {*}$yr $ny]] \
+        [ref_hist2d $tx $ty $xr $nx $yr $ny]
+}
+check "hist2d shape" [dl_tcllist [dl_lengths [dl_hist2d x y 0 10 3 0 10 4]]] \
+    {3 3 3 3}
+check "hist2d nested" \
+    [dl_tcllist [dl_hist2d [dl_llist [dl_flist 0.5 1.5] [dl_flist 1.5]] \
+                     [dl_llist [dl_ilist 0 1] [dl_ilist 1]] 0 2 2 0 2 2]] \
+    {{1 0} {0 2}}
+
+# --- vector levels against the scalar division ---
+# tenths land within a rounding error of the edges of 0.1 wide bins
+dl_set edges [dl_concat [dl_mult [dl_series -50 1050] 0.1] \
+                  [dl_mult [dl_series 0 999] 0.3] sp]
+dl_set big [dl_concat f [dl_mult [dl_urand 100000] 130]]
+dl_set bigi [dl_int [dl_mult [dl_urand 100000] 3000]]
+proc results {} {
+    set r {}
+    foreach l {edges big bigi i s f} {
+        foreach {start stop nbins} {0 100 1000 -3 97 1000 0 1 10 0 3000 300
+                                    0 3000 7 -0.7 99.3 333} {
+            lappend r [dl_tcllist [dl_hist $l $start $stop $nbins]]
+        }
+    }
+    lappend r [dl_tcllist [dl_hist2d edges edges 0 50 500 -1 104 21]]
+    return $r
+}
+dl_simd scalar
+set want [results]
+set best [dl_simd best]
+foreach level {sse2 avx2} {
+    if {$best eq "scalar"} break
+    dl_simd $level
+    check "$level identical" [expr {[results] eq $want}] 1
+    if {$level eq $best} break
+}
+dl_simd $best
+
+# --- threads ---
+dl_set huge [dl_mult [dl_urand 300000] 1000]
+dl_set hugey [dl_mult [dl_urand 300000] 1000]
+dl_set sorted [dl_sort huge]
+proc tresults {} {
+    list [dl_tcllist [dl_hist huge 0 1000 100]] \
+        [dl_tcllist [dl_hist sorted 100 900 1000]] \
+        [dl_tcllist [dl_hist2d huge hugey 0 1000 30 0 1000 30]]
+}
+dl_threads 1
+set want [tresults]
+check "sorted same as unsorted" [lindex $want 1] \
+    [dl_tcllist [dl_hist huge 100 900 1000]]
+foreach t {2 3 4} {
+    dl_threads $t 0
+    check "$t threads identical" [expr {[tresults] eq $want}] 1
+}
+dl_threads 1
+
+# --- errors ---
+check "usage" [catch {dl_hist f 0 1} msg] 1
+check "zero bins" [catch {dl_hist f 0 1 0} msg] 1
+check "strings" [catch {dl_hist [dl_slist a b] 0 1 2} msg] 1
+check "2d usage" [catch {dl_hist2d x y 0 1 2 0 1} msg] 1
+check "2d lengths" [catch {dl_hist2d x [dl_flist 1] 0 1 2 0 1 2} msg] 1
+check "2d bins" [catch {dl_hist2d x y 0 1 2 0 1 -1} msg] 1
+check "2d msg" [string match "*bad operands*" $msg] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
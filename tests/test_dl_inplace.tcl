@@ -0,0 +1,218 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_inplace.tcl
+#   dl_addInPlace, dl_sqrtInPlace, dm_addInPlace ... must leave their
+#   first argument holding exactly what dl_add, dl_sqrt, dm_add ... return
+#   (same datatypes, values compared bit for bit), including broadcasting,
+#   lists of lists, packed and copy on write storage.  Operations whose
+#   result would change the list's datatype or shape are errors that leave
+#   the list untouched.
+#
+#   Usage:  dlsh test_dl_inplace.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# datatype and exact values (dl_tcllist prints floats so they read back
+# bit for bit), recursively
+proc sig {l} {
+    if {[dl_datatype $l] eq "list"} {
+        set r list
+        for {set k 0} {$k < [dl_length $l]} {incr k} {
+            lappend r [sig [dl_get $l $k]]
+        }
+        return $r
+    }
+    return [list [dl_datatype $l] [dl_tcllist $l]]
+}
+
+# run "dl_<op>InPlace x y" on a copy of x and compare with "dl_<op> x y"
+proc same2 {op x y} {
+    set want [sig [dl_$op $x $y]]
+    dl_set t $x
+    check "${op}InPlace returns list" [dl_${op}InPlace t $y] t
+    check "${op}InPlace $x $y" [sig t] $want
+}
+
+proc same1 {op x} {
+    set want [sig [dl_$op $x]]
+    dl_set t $x
+    dl_${op}InPlace t
+    check "${op}InPlace $x" [sig t] $want
+}
+
+# --- inputs ---
+dl_setMatherr 0
+set n 1001
+dl_set f [dl_mult [dl_sub [dl_urand $n] 0.5] 20.0]
+dl_set f2 [dl_mult [dl_sub [dl_urand $n] 0.5] 20.0]
+dl_set f2 [dl_mult f2 [dl_gt [dl_urand $n] 0.1]]
+dl_set i [dl_int [dl_mult [dl_sub [dl_urand $n] 0.5] 200]]
+dl_set i2 [dl_int [dl_mult [dl_sub [dl_urand $n] 0.5] 20]]
+dl_set s [dl_short [dl_mult [dl_sub [dl_urand $n] 0.5] 200]]
+dl_set s2 [dl_short [dl_mult [dl_sub [dl_urand $n] 0.5] 20]]
+dl_set c [dl_char [dl_mult [dl_urand $n] 100]]
+dl_set c2 [dl_char [dl_add [dl_mult [dl_urand $n] 10] 1]]
+dl_set big [dl_ilist 16777217 -16777217 3]
+dl_set small [dl_flist 1.5 2.5 3.5]
+dl_set f1 [dl_flist 2.5]
+dl_set i1 [dl_ilist 3]
+dl_set p [dl_flist 1.5 2 2.5 0.5]
+dl_set e [dl_flist]
+
+foreach op {add sub mult div pow atan2 fmod} {
+    foreach pair {{f f2} {i i2} {s s2} {c c2} {f i} {f s} {f c} {f f1}
+                  {f i1} {i i1} {small big} {p p}} {
+        # dl_pow / dl_atan2 / dl_fmod return zeros for short and char
+        # operands; those are checked by value below instead
+        if {$op in {pow atan2 fmod} && [regexp {^[sc]} [lindex $pair 1]]} {
+            continue
+        }
+        same2 $op {*}$pair
+    }
+}
+same2 add e f1
+dl_set sp [dl_short [dl_ilist 2 -3 4]]
+dl_powInPlace sp [dl_short [dl_ilist 3 2 0]]
+check "short pow" [dl_tcllist sp] {8 9 1}
+dl_set cp [dl_char [dl_ilist 7 9]]
+dl_fmodInPlace cp [dl_char [dl_ilist 4 5]]
+check "char fmod" [dl_tcllist cp] {3 4}
+dl_set fs [dl_flist 2 3]
+dl_powInPlace fs [dl_short [dl_ilist 3 2]]
+check "float short pow" [dl_tcllist fs] {8.0 9.0}
+
+foreach op {abs acos asin atan cos cosh exp lgamma log log10 sin sinh sqrt
+            tan tanh} {
+    same1 $op p
+}
+foreach op {abs sqrt exp sin} { same1 $op f }
+foreach op {abs ceil floor round} { same1 $op i }
+same1 abs s
+same1 abs c
+
+# --- lists of lists ---
+dl_set ll [dl_llist [dl_flist 1 2 3] [dl_flist 4 5] [dl_flist]]
+dl_set ll2 [dl_llist [dl_flist 10 20 30] [dl_flist 1 2] [dl_flist]]
+dl_set per [dl_flist 100 200 300]
+dl_set l1 [dl_llist [dl_flist 2]]
+dl_set nest [dl_llist [dl_llist [dl_ilist 1 2] [dl_ilist 3]] \
+                 [dl_llist [dl_ilist 4 5 6]]]
+same2 mult ll ll2
+same2 add ll per
+same2 sub ll f1
+same2 mult ll l1
+same2 add nest i1
+same2 mult nest nest
+same1 sqrt ll
+same1 abs nest
+
+# --- storage ---
+dl_set orig [dl_fromto 0 10]
+dl_set cp orig
+check "copy shares" [dl_isSharedStorage cp] 1
+dl_multInPlace cp 2
+check "copy changed" [dl_tcllist cp] {0 2 4 6 8 10 12 14 16 18}
+check "original untouched" [dl_tcllist orig] {0 1 2 3 4 5 6 7 8 9}
+
+dl_set pk [dl_llist [dl_flist 1 2 3] [dl_flist 4 5]]
+dl_packStorage pk
+dl_addInPlace pk 1
+check "packed" [dl_tcllist pk] {{2.0 3.0 4.0} {5.0 6.0}}
+check "still packed" [dl_isPackedStorage pk] 1
+
+set g [dg_create]
+dl_set $g:x [dl_flist 1 4 9]
+dl_sqrtInPlace $g:x
+check "group:list" [dl_tcllist $g:x] {1.0 2.0 3.0}
+dg_delete $g
+
+# --- errors leave the list unchanged ---
+dl_set ki [dl_ilist 1 2 3]
+check "int * float" [list [catch {dl_multInPlace ki 0.5} msg] $msg] \
+    {1 {dl_multInPlace: unable to combine "ki" and "0.5" in place}}
+check "int * float unchanged" [dl_tcllist ki] {1 2 3}
+check "length" [catch {dl_addInPlace ki [dl_ilist 1 2]}] 1
+check "broadcast into 1" [catch {dl_addInPlace i1 ki}] 1
+check "flat + lists" [catch {dl_addInPlace ki ll}] 1
+check "mixed ints" [catch {dl_addInPlace ki [dl_short ki]}] 1
+check "strings" [catch {dl_addInPlace [dl_slist a] [dl_slist b]}] 1
+dl_set bad [dl_llist [dl_flist 1 2] [dl_ilist 1 2]]
+check "partial" [catch {dl_multInPlace bad 0.5}] 1
+check "partial unchanged" [dl_tcllist bad] {{1.0 2.0} {1 2}}
+check "sqrt int" [list [catch {dl_sqrtInPlace ki} msg] $msg] \
+    {1 {dl_sqrtInPlace: result for "ki" would not have the same datatype}}
+check "floor float" [catch {dl_floorInPlace f}] 1
+check "abs short ok" [catch {dl_absInPlace s}] 0
+check "usage" [catch {dl_addInPlace ki}] 1
+dl_setMatherr 1
+dl_set neg [dl_llist [dl_flist 4 9] [dl_flist 16 -1]]
+check "domain" [list [catch {dl_sqrtInPlace neg} msg] $msg] \
+    {1 {dl_sqrtInPlace: list elements must be nonnegative}}
+check "domain unchanged" [dl_tcllist neg] {{4.0 9.0} {16.0 -1.0}}
+dl_setMatherr 0
+
+# --- matrices ---
+dl_set m [dm_urand 5 7]
+dl_set m2 [dm_urand 5 7]
+dl_set v [dl_urand 7]
+foreach {op arg} {add m2 sub m2 add v sub v add 2.5 sub 2.5 mult 2.5
+                  div 2.5} {
+    if {[string is double $arg]} {
+        set want [sig [dl_$op m $arg]]
+    } else {
+        set want [sig [dm_$op m $arg]]
+    }
+    dl_set t m
+    check "dm_${op}InPlace returns" [dm_${op}InPlace t $arg] t
+    check "dm_${op}InPlace $arg" [sig t] $want
+}
+check "dm mult matrix" [catch {dm_multInPlace m m2}] 1
+check "dm div zero" [catch {dm_divInPlace m 0}] 1
+check "dm dims" [catch {dm_addInPlace m [dm_urand 5 6]}] 1
+
+# --- no allocation churn: repeated in place updates don't grow memory ---
+proc get_rss_kb {} {
+    if {[file readable /proc/self/status]} {
+        set f [open /proc/self/status r]; set d [read $f]; close $f
+        if {[regexp {VmRSS:\s+(\d+)\s+kB} $d -> rss]} { return $rss }
+    }
+    return -1
+}
+dl_set acc [dl_zeros 100000.]
+dl_set one [dl_ones 100000.]
+proc work {} {
+    for {set k 0} {$k < 100} {incr k} {
+        dl_addInPlace acc one
+        dl_multInPlace acc 1.0
+    }
+}
+for {set r 0} {$r < 2} {incr r} { work }
+set rss0 [get_rss_kb]
+for {set r 0} {$r < 18} {incr r} { work }
+set growth [expr {[get_rss_kb] - $rss0}]
+check "accumulated" [dl_tcllist [dl_unique acc]] 2000.0
+check "no growth ($growth kB)" [expr {$growth < 1024}] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
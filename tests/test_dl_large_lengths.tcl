@@ -0,0 +1,110 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_large_lengths.tcl
+#   Test of 64-bit list lengths in the dg serializer.  Groups whose lists
+#   all fit in 32-bit counts must still be written as version 1.0 files,
+#   byte for byte readable by older readers; arrays longer than INT_MAX are
+#   preceded by an NVALS64 tag carrying the real count, and the file is
+#   stamped version 2.0.  The reader side is exercised here with a hand-made
+#   buffer so that no multi-gigabyte allocation is needed; set
+#   DLSH_TEST_LARGE=1 to also round-trip a real list of 2^31+ elements.
+#
+#   Usage:  dlsh test_dl_large_lengths.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# buffer layout: 4 byte magic, version tag, version float
+proc buf_version {buf} {
+    binary scan $buf @5f v
+    return $v
+}
+
+set tmp [file tempdir]
+
+set g [dg_create small]
+dl_set $g:x [dl_ilist 7 8 9]
+dl_set $g:f [dl_flist 0.5 1.5]
+dl_set $g:s [dl_slist a bb]
+dl_set $g:l [dl_llist [dl_ilist 1 2] [dl_ilist]]
+
+# --- small groups keep the version 1.0 format ---
+dg_toString $g buf
+check "small group version" [buf_version $buf] 1.0
+set h [dg_fromString $buf small_copy]
+foreach col {x f s l} {
+    check "round trip $col" [dl_tcllist $h:$col] [dl_tcllist $g:$col]
+}
+dg_delete $h
+
+foreach ext {dgz lz4 dg} {
+    set fname [file join $tmp small.$ext]
+    dg_write $g $fname
+    set h [dg_read $fname small_$ext]
+    check "$ext round trip" [dl_tcllist $h:x] {7 8 9}
+    check "$ext lists" [dl_tcllist $h:l] {{1 2} {}}
+    dg_delete $h
+}
+
+check "dl_length" [dl_length $g:x] 3
+
+# --- NVALS64 count preceding an array whose 32-bit count is -1 ---
+set i [string first [binary format ci 6 3] $buf]
+set b2 [string replace $buf 5 8 [binary format f 2.0]]
+set b2 [string replace $b2 $i [expr {$i+4}] [binary format cwci 11 3 6 -1]]
+set h [dg_fromString $b2 v2]
+check "version 2.0 NVALS64 read" [dl_tcllist $h:x] {7 8 9}
+check "other lists unaffected" [dl_tcllist $h:s] {a bb}
+dg_delete $h
+
+# a 64-bit count larger than the buffer is rejected, not read past
+set b3 [string replace $b2 [expr {$i+1}] [expr {$i+8}] \
+            [binary format w 1000000000]]
+check "oversized NVALS64 rejected" [catch {dg_fromString $b3 bad}] 1
+
+# unknown versions are still refused
+set b4 [string replace $buf 5 8 [binary format f 3.0]]
+check "unknown version rejected" [catch {dg_fromString $b4 bad}] 1
+
+# --- real >INT_MAX list (needs ~8GB, opt in) ---
+if {[info exists ::env(DLSH_TEST_LARGE)] && $::env(DLSH_TEST_LARGE)} {
+    set n [expr {wide(1) << 31}]
+    set big [dg_create big]
+    dl_set $big:c [dl_char [dl_ones 1048576]]
+    # doubling keeps each concat's source below INT_MAX elements
+    for {set k 0} {$k < 11} {incr k} { dl_concat $big:c $big:c }
+    dl_concat $big:c [dl_char [dl_ones 16]]
+    check "large length" [dl_length $big:c] [expr {$n + 16}]
+    dg_toString $big bigbuf
+    check "large group version" [buf_version $bigbuf] 2.0
+    set h [dg_fromString $bigbuf big_copy]
+    unset bigbuf
+    check "large round trip length" [dl_length $h:c] [expr {$n + 16}]
+    dg_delete $h
+    dg_delete $big
+}
+
+file delete -force $tmp
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,229 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_map.tcl
+#   dl_map, dl_filter and dl_reduce are commands now: they must give
+#   what the Tcl procs they replace gave (copied below as tcl_map,
+#   tcl_filter and tcl_reduce), type their results the same way, leave
+#   out empty results, handle break, continue, return and errors, and a
+#   loop value the body keeps must not change under it when the next
+#   element reuses the loop variable.
+#   Also prints the time each takes on a million elements against the
+#   Tcl procs.
+#
+#   Usage:  dlsh test_dl_map.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# the procs dl_comprehension.tcl used to define
+proc tcl_map {var listname body {type auto}} {
+    upvar 1 $var v
+    set out {}
+    dl_foreach v $listname { lappend out [uplevel 1 $body] }
+    if {$type eq "auto"} { set type [::dl::_infer_type $out] }
+    return [dl_return [dl_create $type {*}$out]]
+}
+proc tcl_filter {var listname pred} {
+    upvar 1 $var v
+    set mask {}
+    dl_foreach v $listname { lappend mask [expr {[uplevel 1 $pred] ? 1 : 0}] }
+    return [dl_return [dl_select $listname [dl_ilist {*}$mask]]]
+}
+proc tcl_reduce {accVar elemVar listname body init} {
+    upvar 1 $accVar acc $elemVar v
+    set acc $init
+    dl_foreach v $listname { set acc [uplevel 1 $body] }
+    return $acc
+}
+
+proc same {label native tcl} {
+    check "$label" [list [dl_datatype $native] [dl_tcllist $native]] \
+        [list [dl_datatype $tcl] [dl_tcllist $tcl]]
+}
+
+# --- agreement with the Tcl procs ---
+proc agree {} {
+    set xs [dl_fromto 0 10]
+    set fs [dl_flist 0.5 1.25 -3 7]
+    set ss [dl_slist apple b cherry]
+    set cs [dl_char [dl_ilist 1 2 250]]
+    set rows [dl_llist [dl_ilist 1 2 3] [dl_ilist 10 20] [dl_ilist 5]]
+    set holes [dl_llist [dl_ilist 1 2] [dl_flist 1.5] [dl_ilist]]
+    foreach {label l body type} [list \
+            "int"            $xs   {expr {$x*$x+1}}      auto \
+            "int to float"   $xs   {expr {$x/2.0}}       auto \
+            "mixed numbers"  $xs   {expr {$x%2 ? $x : $x/4.0}} auto \
+            "late float"     $xs   {expr {$x == 9 ? 0.1 : $x}} auto \
+            "to string"      $xs   {expr {$x < 7 ? $x/3.0 : "s$x"}} auto \
+            "ints to string" $xs   {expr {$x < 7 ? $x : "s$x"}} auto \
+            "floats in"      $fs   {expr {$x*2}}         auto \
+            "strings"        $ss   {string length $x}    auto \
+            "string out"     $ss   {string toupper $x}   auto \
+            "chars"          $cs   {expr {$x+1}}         auto \
+            "rows"           $rows {dl_sum $r}           auto \
+            "empty sublist"  $holes {dl_sum $r}          auto \
+            "empty results"  $xs   {if {$x > 3} {set x}} auto \
+            "all empty"      $xs   {}                    auto \
+            "empty typed"    $xs   {if {$x % 2} {set x}} int \
+            "empty floats"   $xs   {if {$x % 2} {set x}} float \
+            "empty strings"  $ss   {if {$x ne "b"} {set x}} string \
+            "float type"     $xs   {expr {$x*$x}}        float \
+            "short type"     $xs   {expr {-$x}}          short \
+            "char type"      $xs   {expr {$x*20}}        char \
+            "string type"    $xs   {expr {$x*2}}         string \
+            "empty"          [dl_ilist] {expr {$x+1}}    auto \
+            "empty int"      [dl_ilist] {expr {$x+1}}    int] {
+        set var [expr {$l eq $rows || $l eq $holes ? "r" : "x"}]
+        same "map $label" [dl_map $var $l $body $type] [tcl_map $var $l $body $type]
+    }
+    same "map list type" [dl_map r $rows {dl_add $r 1} list] \
+        [tcl_map r $rows {dl_add $r 1} list]
+
+    foreach {label l var pred} [list \
+            "flat"  $xs   x {expr {$x>5 && $x%3==0}} \
+            "float" $fs   x {expr {$x > 0}} \
+            "none"  $xs   x {expr {$x < 0}} \
+            "words" $ss   x {string match *e* $x} \
+            "bool"  $xs   x {expr {$x%2 ? "yes" : "no"}} \
+            "rows"  $rows r {expr {[dl_length $r]>=2}}] {
+        same "filter $label" [dl_filter $var $l $pred] [tcl_filter $var $l $pred]
+    }
+
+    foreach {label l body init} [list \
+            "sum"    $xs {expr {$a+$x}}         0 \
+            "max"    $xs {expr {max($a,$x)}}    -1 \
+            "float"  $fs {expr {$a*$x}}         1 \
+            "string" $ss {string cat $a $x}     > \
+            "empty"  [dl_ilist] {expr {$a+$x}}  init] {
+        check "reduce $label" [dl_reduce a x $l $body $init] \
+            [tcl_reduce a x $l $body $init]
+    }
+    check "reduce rows" [dl_reduce a r $rows {expr {$a+[dl_length $r]}} 0] 6
+}
+agree
+
+# --- control flow, variables and errors ---
+proc flow {} {
+    set xs [dl_fromto 0 10]
+    set r [list [dl_tcllist [dl_map x $xs {if {$x%3} continue; set x}]] \
+               [dl_tcllist [dl_map x $xs {if {$x > 3} break; set x}]] \
+               [dl_tcllist [dl_filter x $xs {if {$x%2} continue; expr 1}]] \
+               [dl_tcllist [dl_filter x $xs {if {$x == 4} break; expr 1}]] \
+               [dl_reduce a x $xs {if {$x%2} continue; expr {$a+$x}} 0] \
+               [dl_reduce a x $xs {if {$x > 3} break; expr {$a+$x}} 0] \
+               [info exists x] $a]
+}
+check "continue and break" [flow] {{0 3 6 9} {0 1 2 3} {0 2 4 6 8} {0 1 2 3} 20 6 0 6}
+
+proc errors {} {
+    set xs [dl_fromto 0 5]
+    foreach script {
+        {dl_map x $xs {error oops}}
+        {dl_map x $xs {expr {$x*0.5}} int}
+        {dl_map x $xs {format a} float}
+        {dl_map x $xs {set x} nosuchtype}
+        {dl_map x nosuchlist {set x}}
+        {dl_filter x $xs {format maybe}}
+        {dl_reduce a x $xs {error oops} 0}
+        {dl_map x $xs}
+        {dl_reduce a x $xs {}}
+    } {
+        lappend r [catch $script msg]
+    }
+    lappend r [info exists x] $msg
+}
+check "errors" [errors] {1 1 1 1 1 1 1 1 1 0 {wrong # args: should be "dl_reduce accVar elemVar list body init"}}
+check "error message" [list [catch {dl_map x [dl_ilist 1 2] {expr {$x/2.0}} int} m] $m] \
+    {1 {expected integer but got "0.5"}}
+
+# return in a body returns from the command, as it did from the procs
+proc returns {} { dl_map x [dl_ilist 1 2] { return early }; return late }
+check "return from body" [returns] late
+check "return value" [list [dl_map x [dl_ilist 1 2] {return early}] \
+                          [dl_filter x [dl_ilist 1 2] {return early}] \
+                          [dl_reduce a x [dl_ilist 1 2] {return early} 0]] \
+    {early early early}
+check "tcl_map return" [tcl_map x [dl_ilist 1 2] {return early}] early
+proc deep {} { dl_map x [dl_ilist 1 2] { return -level 2 deep }; return late }
+check "return -level 2" [deep] deep
+check "return -code error" \
+    [list [catch {dl_reduce a x [dl_ilist 1] {return -code error bad} 0} m] $m] \
+    {1 bad}
+
+# --- loop values the body keeps ---
+proc kept {} {
+    set seen {}
+    dl_map x [dl_fromto 0 5] { lappend seen $x; set x }
+    dl_foreach x [dl_flist 1.5 2.5] { lappend seen $x }
+    dl_filter s [dl_slist a b] { lappend seen $s; expr 1 }
+    set held [dl_map x [dl_ilist 7 8] { set last $x; expr {$x+1} }]
+    list $seen $last [dl_tcllist $held]
+}
+check "kept values" [kept] {{0 1 2 3 4 1.5 2.5 a b} 8 {8 9}}
+proc traced {} {
+    set ::writes 0
+    trace add variable x write {apply {args { incr ::writes }}}
+    dl_map x [dl_fromto 0 5] { expr {$x+1} }
+    set ::writes
+}
+check "write traces" [traced] 5
+proc nested {} {
+    dl_tcllist [dl_map x [dl_fromto 1 4] {
+        dl_reduce a y [dl_fromto 0 $x] {expr {$a+$x*$y}} 0
+    }]
+}
+check "nested" [nested] {0 2 9}
+set g [dl_ilist 3 4]
+check "global scope" [list [dl_tcllist [dl_map x $g {expr {$x*2}}]] [info exists x]] {{6 8} 0}
+
+# --- lifetimes ---
+proc mk {} { return [dl_map x [dl_ilist 1 2 3] {expr {$x*10}}] }
+check "returned from a proc" [dl_tcllist [mk]] {10 20 30}
+proc loc {} {
+    dl_local kept [dl_filter x [dl_fromto 0 10] {expr {$x > 5}}]
+    dl_tcllist $kept
+}
+check "dl_local" [loc] {6 7 8 9}
+
+# --- timing (informational) ---
+dl_set big [dl_fromto 0 1000000]
+proc bench {which} {
+    switch $which {
+        "dl_map"     { dl_length [dl_map x big {expr {$x*2}}] }
+        "tcl_map"    { dl_length [tcl_map x big {expr {$x*2}}] }
+        "dl_filter"  { dl_length [dl_filter x big {expr {$x%3 == 0}}] }
+        "tcl_filter" { dl_length [tcl_filter x big {expr {$x%3 == 0}}] }
+        "dl_reduce"  { dl_reduce a x big {expr {$a+$x}} 0 }
+        "tcl_reduce" { tcl_reduce a x big {expr {$a+$x}} 0 }
+    }
+}
+check "million" [list [bench dl_map] [bench dl_filter] [bench dl_reduce]] \
+    {1000000 333334 499999500000}
+foreach which {dl_map tcl_map dl_filter tcl_filter dl_reduce tcl_reduce} {
+    puts [format "     %-10s 1M elements %8.0f us" $which \
+              [lindex [time {bench $which} 1] 0]]
+}
+dl_delete big
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
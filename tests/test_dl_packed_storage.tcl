@@ -0,0 +1,118 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_packed_storage.tcl
+#   Correctness test for packed (values + offsets) storage of lists of
+#   numeric lists: dl_packStorage / dl_unpackStorage / dg_packStorage.
+#
+#   Packed sublists are views into one shared buffer.  Every existing
+#   command must see them as ordinary lists; a view that grows must get
+#   its own storage without disturbing its neighbours.
+#
+#   Usage:  dlsh test_dl_packed_storage.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+proc make {} {
+    dl_return [dl_llist [dl_flist 1 2 3] [dl_flist] [dl_flist 4 5] [dl_flist 6]]
+}
+
+# --- packing is in place and transparent ---
+set l [make]
+check "not packed initially" [dl_isPackedStorage $l] 0
+check "pack returns name" [dl_packStorage $l] $l
+check "packed" [dl_isPackedStorage $l] 1
+check "contents" [dl_tcllist $l] [dl_tcllist [make]]
+check "lengths" [dl_tcllist [dl_lengths $l]] {3 0 2 1}
+check "sums" [dl_tcllist [dl_sums $l]] {6.0 0.0 9.0 6.0}
+check "arith" [dl_tcllist [dl_mult $l 2]] {{2.0 4.0 6.0} {} {8.0 10.0} 12.0}
+check "sublist get" [dl_tcllist [dl_get $l 2]] {4.0 5.0}
+check "unpackLists" [dl_tcllist [dl_unpack $l]] {1.0 2.0 3.0 4.0 5.0 6.0}
+
+# copies of packed lists stay packed and independent
+dl_set orig [make]
+dl_packStorage orig
+dl_set cpy orig
+check "copy packed" [dl_isPackedStorage cpy] 1
+dl_put cpy:0 0 99
+check "copy independent" [dl_tcllist orig:0] {1.0 2.0 3.0}
+check "copy modified" [dl_tcllist cpy:0] {99.0 2.0 3.0}
+
+# --- in place writes go to the shared buffer, growth detaches ---
+dl_put $l:2 1 50
+check "put in view" [dl_tcllist $l] {{1.0 2.0 3.0} {} {4.0 50.0} 6.0}
+check "still packed after put" [dl_isPackedStorage $l] 1
+dl_append $l:1 7
+dl_append $l:0 8
+check "append to views" [dl_tcllist $l] {{1.0 2.0 3.0 8.0} 7.0 {4.0 50.0} 6.0}
+check "no longer fully packed" [dl_isPackedStorage $l] 0
+check "repack" [dl_isPackedStorage [dl_packStorage $l]] 1
+check "repacked contents" [dl_tcllist $l] {{1.0 2.0 3.0 8.0} 7.0 {4.0 50.0} 6.0}
+
+# --- replacing / appending whole sublists on a packed parent ---
+dl_set $l:3 [dl_flist 10 11]
+dl_append $l [dl_flist 12]
+check "replace and append sublists" [dl_tcllist $l] \
+    {{1.0 2.0 3.0 8.0} 7.0 {4.0 50.0} {10.0 11.0} 12.0}
+
+# --- unpack, mixed / unpackable lists are left alone ---
+dl_unpackStorage $l
+check "unpacked" [dl_isPackedStorage $l] 0
+check "unpacked contents" [dl_tcllist $l] {{1.0 2.0 3.0 8.0} 7.0 {4.0 50.0} {10.0 11.0} 12.0}
+set m [dl_llist [dl_ilist 1] [dl_flist 2]]
+dl_packStorage $m
+check "mixed types not packed" [dl_isPackedStorage $m] 0
+set s [dl_llist [dl_slist a b]]
+dl_packStorage $s
+check "strings not packed" [dl_isPackedStorage $s] 0
+
+# --- groups: pack all columns, serialization round trip ---
+set g [dg_create]
+dl_set $g:spikes [dl_llist [dl_ilist 1 2] [dl_ilist] [dl_ilist 3 4 5]]
+dl_set $g:eye [dl_llist [dl_short [dl_ilist 1]] [dl_short [dl_ilist 2 3]]]
+dl_set $g:names [dl_slist a b c]
+check "dg_packStorage" [dg_packStorage $g] 2
+dg_toString $g buf
+set g2 [dg_fromString $buf g2]
+check "round trip spikes" [dl_tcllist $g2:spikes] {{1 2} {} {3 4 5}}
+check "round trip eye" [dl_tcllist $g2:eye] {1 {2 3}}
+dg_delete $g2
+
+# sublists outliving their parent keep the shared block alive
+dl_set sub $g:spikes:2
+dg_delete $g
+check "sublist copy after delete" [dl_tcllist sub] {3 4 5}
+
+# --- reset / reset-to-type ---
+set l [make]
+dl_packStorage $l
+dl_reset $l
+check "reset packed" [dl_length $l] 0
+dl_append $l [dl_ilist 1]
+check "reuse after reset" [dl_tcllist $l] 1
+
+if {$::fail} {
+    puts "=== $::fail FAILURE(S) ==="
+    exit 1
+}
+puts "=== ALL PASS ==="
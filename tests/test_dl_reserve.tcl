@@ -0,0 +1,84 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_reserve.tcl
+#   Correctness test for dl_reserve and the bulk form of dl_append.
+#
+#   dl_append used to grow lists by a fixed increment, so building a long
+#   column one value at a time was quadratic in realloc traffic.  Lists now
+#   grow geometrically, dl_reserve preallocates storage, and dl_append
+#   accepts a Tcl list of numeric values which is appended in one pass.
+#
+#   Usage:  dlsh test_dl_reserve.tcl        (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# --- dl_reserve keeps contents and returns the list name ---
+set l [dl_ilist 1 2 3]
+check "reserve returns name" [dl_reserve $l 100000] $l
+check "reserve keeps contents" [dl_tcllist $l] {1 2 3}
+check "reserve smaller is no-op" [dl_tcllist [dl_reserve $l 1]] {1 2 3}
+check "reserve negative errors" [catch {dl_reserve $l -1}] 1
+
+# --- bulk dl_append for every numeric type ---
+set l [dl_ilist]
+dl_append $l {1 2 3} 4 {5 6}
+check "bulk long" [dl_tcllist $l] {1 2 3 4 5 6}
+
+set l [dl_flist]
+dl_append $l {0.5 1.5}
+check "bulk float" [dl_tcllist $l] {0.5 1.5}
+
+set l [dl_short [dl_ilist]]
+dl_append $l {-1 1}
+check "bulk short" [dl_tcllist $l] {-1 1}
+
+set l [dl_uchar [dl_ilist]]
+dl_append $l {65 66}
+check "bulk char" [dl_tcllist $l] {65 66}
+
+set l [dl_ilist 7]
+check "bulk bad element errors" [catch {dl_append $l {1 x 3}}] 1
+check "bulk bad element leaves list" [dl_tcllist $l] 7
+
+# strings keep whitespace-containing values intact
+set l [dl_slist]
+dl_append $l {a b} c
+check "string append not split" [dl_length $l] 2
+
+# --- geometric growth: long single-element append loop ---
+set l [dl_ilist]
+for {set i 0} {$i < 200000} {incr i} { dl_append $l $i }
+check "append loop length" [dl_length $l] 200000
+check "append loop last" [dl_last $l] 199999
+check "append loop ordered" [dl_sum [dl_eq $l [dl_fromto 0 200000]]] 200000
+
+set l [dl_ilist]
+dl_append $l [dl_tcllist [dl_fromto 0 100000]]
+check "bulk append 100000" [dl_sum [dl_eq $l [dl_fromto 0 100000]]] 100000
+
+if {$::fail} {
+    puts "=== $::fail FAILURE(S) ==="
+    exit 1
+}
+puts "=== ALL PASS ==="
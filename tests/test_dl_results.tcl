@@ -0,0 +1,160 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_results.tcl
+#   Lists returned by commands (%list#%) are owned by their Tcl_Objs:
+#   a temp must live until the proc that made it returns, even when its
+#   name is only kept as a string; a temp a proc returns must live on in
+#   its caller; dl_set, dl_local, dl_return and dg_addExistingList must
+#   take temps over by renaming; dl_delete, dl_clean and dl_popTemps
+#   must still free them early; and making one must cost the same
+#   however many are alive.  Also prints the time a loop of temps takes.
+#
+#   Usage:  dlsh test_dl_results.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+proc exists {name} { expr {![catch {dl_length $name}]} }
+proc ntemps {} {
+    set n 0
+    foreach e [dl_dir] { if {[string match %list* [lindex $e 0]]} { incr n } }
+    return $n
+}
+
+# --- lifetime within a proc ---
+proc strings {} {
+    # names kept only as strings still work until the proc returns
+    set cmd "dl_sum [dl_ilist 1 2 3]"
+    set name [string range "x[dl_flist 4 5]" 1 end]
+    list [eval $cmd] [dl_tcllist $name]
+}
+check "names as strings" [strings] {6 {4.0 5.0}}
+
+proc made {} {
+    global names objs
+    # names as plain strings do not hold the lists, objects do
+    set names [list [string range "x[dl_ilist 1]" 1 end] [dl_ilist 2]]
+    set objs [list [dl_ilist 3] [dl_llist [dl_ilist 4]]]
+    # shimmering a value to a Tcl list must not free it before return
+    llength [lindex $names 1]
+    list [exists [lindex $names 0]] [exists [lindex $names 1]]
+}
+dl_clean
+check "alive in proc" [made] {1 1}
+check "freed at return" [list [exists [lindex $names 0]] [exists [lindex $names 1]] \
+                             [ntemps]] {0 0 2}
+check "held by objects" [list [dl_tcllist [lindex $objs 0]] \
+                             [dl_tcllist [lindex $objs 1]]] {3 4}
+unset objs
+check "freed with objects" [ntemps] 0
+
+proc mk {n} { return [dl_fromto 0 $n] }
+proc use {} {
+    set a [mk 4]
+    set b [mk 3]
+    list [dl_tcllist $a] [dl_tcllist $b] [dl_length [mk 10]]
+}
+check "returned temps" [use] {{0 1 2 3} {0 1 2} 10}
+proc keep {} { set ::kept [mk 5] }
+keep
+check "returned temp kept" [dl_tcllist $::kept] {0 1 2 3 4}
+unset ::kept
+
+# --- names ---
+proc sub {} {
+    set l [dl_llist [dl_ilist 1 2] [dl_ilist 3 4 5]]
+    list [dl_tcllist $l:1] [dl_length $l:0] [expr {[lsearch [info vars] %dltemps%] >= 0}]
+}
+check "sublists of temps" [sub] {{3 4 5} 2 1}
+set t [dl_ilist 7]
+check "dl_dir lists temps" [expr {[lsearch -index 0 [dl_dir] $t] >= 0}] 1
+
+# --- renaming takes temps over ---
+proc renames {} {
+    set t [dl_ilist 1 2 3]
+    dl_set named $t
+    set r [list [exists $t] [dl_tcllist named]]
+    dl_local loc [dl_ilist 4 5]
+    lappend r [dl_tcllist $loc]
+    set ret [dl_return [dl_ilist 6]]
+    lappend r [string index $ret 0] [dl_tcllist $ret]
+    dg_create g
+    set t2 [dl_ilist 8 9]
+    dg_addExistingList g $t2 nine
+    lappend r [exists $t2] [dl_tcllist g:nine]
+    dg_delete g
+    return $r
+}
+check "renames" [renames] {0 {1 2 3} {4 5} > 6 0 {8 9}}
+check "named survives" [dl_tcllist named] {1 2 3}
+dl_delete named
+
+# --- early frees ---
+set t [dl_ilist 1 2]
+dl_delete $t
+check "dl_delete" [exists $t] 0
+set t [dl_ilist 1 2]
+dl_clean
+check "dl_clean" [list [exists $t] [ntemps]] {0 0}
+dl_pushTemps
+set t [dl_ilist 1 2]
+set u [dl_llist $t]
+dl_popTemps
+check "dl_popTemps" [list [exists $t] [exists $u]] {0 0}
+proc pushed {} {
+    dl_pushTemps
+    for {set i 0} {$i < 100} {incr i} { dl_ilist $i }
+    set n [ntemps]
+    dl_popTemps
+    expr {$n - [ntemps]}
+}
+check "popTemps in proc" [pushed] 100
+
+# --- dl_foreach elements ---
+proc each {} {
+    set r {}
+    dl_foreach e [dl_llist [dl_ilist 1 2] [dl_ilist 3]] {
+        lappend r [dl_tcllist $e]
+        if {![info exists first]} { set first $e }
+    }
+    lappend r [dl_tcllist $first]
+}
+check "foreach sublists" [each] {{1 2} 3 {1 2}}
+
+# --- cost does not grow with live temps ---
+proc temps {n} { for {set i 0} {$i < $n} {incr i} { dl_add [dl_ilist 1 2 3] 1 } }
+set small [expr {[lindex [time {temps 1000} 3] 0] / 1000.}]
+set large [expr {[lindex [time {temps 30000} 3] 0] / 30000.}]
+check "flat cost" [expr {$large < 3 * $small}] 1
+
+# --- timing (informational) ---
+puts [format "     dl_add \[dl_ilist 1 2 3\] 1 in a proc:  %6.2f us" $large]
+puts [format "     dl_negate \$x in a proc:              %6.2f us" \
+          [expr {[lindex [time {
+              apply {{n} {
+                  dl_local x [dl_ilist 1 2 3]
+                  for {set i 0} {$i < $n} {incr i} { dl_negate $x }
+              }} 30000} 3] 0] / 30000.}]]
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,175 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_rng.tcl
+#   dl_urand, dl_zrand, dl_irand, dl_randfill, dl_shuffle,
+#   dl_randchoose, dl_pickone and dm_urand / dm_zrand on the counter
+#   based generator: a seed must give the same values again, whatever
+#   dl_threads and dl_simd are set to; dl_srand seed stream must give
+#   independent streams; values must lie in range with the right
+#   moments, and permutations and samples must hold distinct values.
+#   Also prints the time the fills take for a million elements.
+#
+#   Usage:  dlsh test_dl_rng.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+proc within {x lo hi} { expr {$x >= $lo && $x <= $hi} }
+
+# every generator once, from a given seed
+proc draws {seed {n 5000}} {
+    dl_srand $seed
+    list [dl_tcllist [dl_urand $n]] [dl_tcllist [dl_zrand $n]] \
+        [dl_tcllist [dl_irand $n 1000]] [dl_tcllist [dl_randfill $n]] \
+        [dl_tcllist [dl_shuffle [dl_fromto 0 $n]]] \
+        [dl_tcllist [dl_randchoose [expr {$n*10}] [expr {$n/2}]]] \
+        [dl_tcllist [dm_urand 7 9]] [dl_tcllist [dm_zrand 9 7]] \
+        [dl_pickone [dl_fromto 0 $n]]
+}
+
+# --- seeds and streams ---
+set a [draws 17]
+check "same seed" [expr {[draws 17] eq $a}] 1
+check "other seed" [expr {[lindex [draws 18] 0] ne [lindex $a 0]}] 1
+check "stream 0 is the seed" [expr {[dl_srand 17 0] == 17 &&
+                                    [dl_tcllist [dl_urand 10]] eq
+                                    [lrange [lindex $a 0] 0 9]}] 1
+dl_srand 17 1
+check "other stream" [expr {[dl_tcllist [dl_urand 10]] ne
+                            [lrange [lindex $a 0] 0 9]}] 1
+dl_srand 17
+check "calls differ" [expr {[dl_tcllist [dl_urand 10]] ne
+                            [dl_tcllist [dl_urand 10]]}] 1
+check "seed returned" [dl_srand 123] 123
+check "seed read back" [dl_srand] 123
+check "auto seed" [expr {[dl_srand 0] != 0}] 1
+
+# a prefix is the start of a longer fill
+dl_srand 5; set short [dl_tcllist [dl_zrand 10]]
+dl_srand 5; set long [dl_tcllist [dl_zrand 1000]]
+check "zrand prefix" [lrange $long 0 9] $short
+dl_srand 5; set short [dl_tcllist [dl_irand 7 99]]
+dl_srand 5; set long [dl_tcllist [dl_irand 1000 99]]
+check "irand prefix" [lrange $long 0 6] $short
+
+# --- threads and vector levels ---
+set n 300007
+proc big {} {
+    global n
+    dl_srand 99
+    list [dl_tcllist [dl_urand $n]] [dl_tcllist [dl_zrand $n]] \
+        [dl_tcllist [dl_irand $n 12345]] [dl_tcllist [dm_zrand 300 1001]]
+}
+dl_threads 1
+set level [dl_simd]
+set want [big]
+foreach l {scalar sse2 avx2} {
+    if {[catch {dl_simd $l}]} continue
+    check "simd $l identical" [expr {[big] eq $want}] 1
+}
+dl_simd $level
+foreach t {2 4} {
+    dl_threads $t 0
+    check "$t threads identical" [expr {[big] eq $want}] 1
+}
+dl_threads 1
+
+# --- ranges and moments ---
+dl_srand 3
+set n 1000000
+dl_set u [dl_urand $n]
+check "urand range" [expr {[dl_min u] >= 0.0 && [dl_max u] < 1.0}] 1
+check "urand mean" [within [dl_mean u] 0.498 0.502] 1
+check "urand var" [within [dl_var u] [expr {1/12.-0.001}] [expr {1/12.+0.001}]] 1
+check "urand deciles" [expr {[dl_max [dl_abs [dl_sub [dl_hist u 0. 1. 10] \
+                                                   [expr {$n/10}]]]] < 1500}] 1
+
+dl_set z [dl_zrand $n]
+check "zrand mean" [within [dl_mean z] -0.005 0.005] 1
+check "zrand std" [within [dl_std z] 0.995 1.005] 1
+check "zrand tails" [within [expr {[dl_sum [dl_gt [dl_abs z] 2.0]]/double($n)}] \
+                         0.0440 0.0470] 1
+check "zrand far tail" [within [dl_sum [dl_gt [dl_abs z] 3.5]] 380 560] 1
+check "zrand symmetric" [within [dl_sum [dl_gt z 0]] 498500 501500] 1
+
+dl_set i [dl_irand $n 7]
+check "irand range" [list [dl_min i] [dl_max i]] {0 6}
+check "irand counts" [expr {[dl_max [dl_abs [dl_sub [dl_hist i 0 7 7] \
+                                                  [expr {$n/7.}]]]] < 1500}] 1
+dl_set i [dl_irand $n 2000000000]
+check "irand large max" [expr {[dl_min i] >= 0 && [dl_max i] < 2000000000 &&
+                               [within [dl_mean i] 0.998e9 1.002e9]}] 1
+check "irand max 1" [dl_sum [dl_irand 100 1]] 0
+check "irand lists" [dl_tcllist [dl_lengths [dl_irand [dl_ilist 3 0 5] 4]]] {3 0 5}
+check "urand lists" [dl_tcllist [dl_lengths [dl_urand [dl_ilist 2 6]]]] {2 6}
+
+# --- permutations and samples ---
+foreach m {1 2 10 1000 100003} {
+    check "randfill $m" [dl_tcllist [dl_sort [dl_randfill $m]]] \
+        [dl_tcllist [dl_fromto 0 $m]]
+}
+dl_set s [dl_shuffle [dl_slist a b c d e f]]
+check "shuffle strings" [dl_tcllist [dl_sort s]] {a b c d e f}
+foreach {m k} {10 10  10 1  1000 999  100000000 50000  5 0} {
+    dl_set c [dl_randchoose $m $k]
+    set k2 [expr {$k ? $k : 0}]
+    check "randchoose $m $k" [list [dl_length [dl_unique c]] \
+                                   [expr {$k ? [dl_min c] >= 0 && [dl_max c] < $m : 1}]] \
+        [list $k2 1]
+}
+check "randchoose all" [dl_tcllist [dl_sort [dl_randchoose 50 50]]] \
+    [dl_tcllist [dl_fromto 0 50]]
+check "randchoose too many" [catch {dl_randchoose 5 6} msg] 1
+
+# every element equally likely in each position of a small permutation
+dl_srand 8
+set counts [lrepeat 4 0]
+for {set r 0} {$r < 20000} {incr r} {
+    set p [lindex [dl_tcllist [dl_randfill 4]] 0]
+    lset counts $p [expr {[lindex $counts $p] + 1}]
+}
+check "randfill first place" [expr {[tcl::mathfunc::max {*}$counts] -
+                                    [tcl::mathfunc::min {*}$counts] < 450}] 1
+set counts [lrepeat 10 0]
+for {set r 0} {$r < 20000} {incr r} {
+    foreach p [dl_tcllist [dl_randchoose 10 3]] {
+        lset counts $p [expr {[lindex $counts $p] + 1}]
+    }
+}
+check "randchoose coverage" [expr {[tcl::mathfunc::max {*}$counts] -
+                                   [tcl::mathfunc::min {*}$counts] < 450}] 1
+
+# --- errors ---
+check "srand stream" [catch {dl_srand 1 -1} msg] 1
+check "srand seed" [catch {dl_srand x} msg] 1
+check "srand usage" [catch {dl_srand 1 2 3} msg] 1
+
+# --- timing (informational) ---
+foreach cmd {{dl_urand 1000000} {dl_zrand 1000000} {dl_irand 1000000 100}
+             {dl_randfill 1000000} {dl_randchoose 100000000 100000}} {
+    puts [format "     %-32s %8.0f us" $cmd \
+              [lindex [time {dl_return [{*}$cmd]} 5] 0]]
+}
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,170 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_sdf.tcl
+#   dl_sdf, dl_sdfs, dl_deepSdfs and dl_sdfAligned against a Tcl
+#   reference (the normalized gaussian of sdfMakeKernel added around
+#   each spike's ms bin), for sparse trials (kernel added spike by
+#   spike) and dense trials with wide kernels (binned and convolved by
+#   FFT), int and float spike times, and resolutions above 1 ms.  Also
+#   checks that dl_parzenAligned matches dl_parzens and that threads
+#   do not change any result.
+#
+#   Usage:  dlsh test_dl_sdf.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# largest difference between two lists, relative to the largest value
+proc reldiff {a b} {
+    if {[llength $a] != [llength $b]} { return "lengths [llength $a] [llength $b]" }
+    set d 0.0
+    set m 1e-30
+    foreach x $a y $b {
+        set d [expr {max($d, abs($x - $y))}]
+        set m [expr {max($m, abs($y))}]
+    }
+    return [expr {$d/$m < 1e-5}]
+}
+
+# reference sdf of one trial
+proc ref_sdf {spikes start stop ksd nsd resol} {
+    set ks [expr {int($nsd*$ksd + 0.5)}]
+    if {!($ks & 1)} { incr ks }
+    set sum 0.0
+    for {set i 0} {$i < $ks} {incr i} {
+        lappend k [expr {exp(-double($i*$i)/($ksd*$ksd))}]
+        set sum [expr {$sum + [lindex $k end]}]
+    }
+    set k [lmap v $k {expr {$v/(2.0*$sum)}}]
+    set n [expr {int($stop - $start + 1)}]
+    set out [lrepeat $n 0.0]
+    foreach x $spikes {
+        set s [expr {int($x - $start)}]
+        for {set t [expr {max(0, $s-$ks+1)}]} {$t < min($n, $s+$ks)} {incr t} {
+            lset out $t [expr {[lindex $out $t] + [lindex $k [expr {abs($t-$s)}]]}]
+        }
+    }
+    set res {}
+    for {set t 0} {$t < $n} {incr t $resol} { lappend res [lindex $out $t] }
+    return $res
+}
+
+# --- inputs: sorted spike times, sparse and dense ---
+# seeded, and on a quarter ms grid so float and double agree on each
+# spike's ms bin (the reference works in doubles)
+dl_srand 1515
+proc spikes {n dur} {
+    dl_return [dl_sort [dl_div [dl_int [dl_mult [dl_urand $n] [expr {$dur*4}]]] 4.0]]
+}
+dl_set sparse [dl_llist]
+foreach n {0 1 5 20 40 3 12 60} { dl_append sparse [spikes $n 1200] }
+dl_set dense [dl_llist [spikes 1500 1000] [spikes 3000 1000] [spikes 10 1000]]
+dl_set isparse [dl_int sparse]
+
+foreach {l start stop ksd nsd resol} {
+    sparse -50 1100 20 2.5 1
+    sparse 100.5 700.5 10 3 3
+    sparse 0 1000 1 0 1
+    isparse -50 1100 20 2.5 2
+    dense 0 1000 40 4 1
+    dense -200 1200 15 3 5
+} {
+    set got [dl_tcllist [dl_sdfs $l [dl_flist $start] [dl_flist $stop] \
+                             $ksd $nsd $resol]]
+    set i 0
+    foreach trial [dl_tcllist $l] g $got {
+        check "$l $start $stop $ksd $nsd $resol trial $i" \
+            [reldiff $g [ref_sdf $trial $start $stop $ksd $nsd $resol]] 1
+        incr i
+    }
+}
+
+# points out of reach of every spike stay exactly zero on the FFT path
+dl_set gap [dl_llist [dl_concat [spikes 3000 400] [dl_add [spikes 3000 400] 1600]]]
+set g [dl_tcllist [dl_sdf gap 0 2000 20 4 1]]
+check "fft zeros" [lsort -unique [lrange $g 600 1400]] 0.0
+check "fft nonzero" [expr {[lindex $g 300] > 0 && [lindex $g 1700] > 0}] 1
+check "no negatives" [expr {[dl_min [dl_sdf gap 0 2000 20 4 1]] >= 0}] 1
+
+# --- per trial windows, single lists, averaging and nesting ---
+dl_set starts [dl_int [dl_mult [dl_urand 8] 300]]
+set want {}
+foreach trial [dl_tcllist sparse] s [dl_tcllist starts] {
+    lappend want [ref_sdf $trial $s [expr {$s+500}] 20 2.5 1]
+}
+set got [dl_tcllist [dl_sdfs sparse starts [dl_add starts 500] 20 2.5 1]]
+check "per trial windows" [expr {[llength $got] == 8}] 1
+foreach g $got w $want { check "per trial window" [reldiff $g $w] 1 }
+check "dl_sdf" [reldiff [dl_tcllist [dl_sdf [dl_get sparse 4] -10 400 5 3 1]] \
+                    [ref_sdf [dl_tcllist [dl_get sparse 4]] -10 400 5 3 1]] 1
+check "dl_sdf average" \
+    [dl_tcllist [dl_sdf sparse 0 600 10 3 2]] \
+    [dl_tcllist [dl_div [dl_sums [dl_transpose \
+        [dl_sdfs sparse [dl_ilist 0] [dl_ilist 600] 10 3 2]]] 8.0]]
+check "deep shape" \
+    [dl_tcllist [dl_lengths [dl_deepSdfs [dl_llist sparse [dl_llist dense]] \
+                                 [dl_ilist 0] [dl_ilist 99] 10 3 1]]] {8 1}
+check "deep values" \
+    [dl_tcllist [dl_get [dl_deepSdf [dl_llist sparse] 0 99 10 3 1] 0]] \
+    [dl_tcllist [dl_sdfs sparse [dl_ilist 0] [dl_ilist 99] 10 3 1]]
+check "empty window" [dl_tcllist [dl_sdf [dl_flist 1 2] 10 5 10 3 1]] {}
+
+# --- aligned ---
+dl_set aligns [dl_add [dl_mult [dl_urand 8] 400] 200]
+check "sdfAligned" \
+    [dl_tcllist [dl_sdfAligned sparse aligns -100 300 20 2.5 1]] \
+    [dl_tcllist [dl_sdfs sparse [dl_sub aligns 100] [dl_add aligns 300] 20 2.5 1]]
+check "sdfAligned one align" \
+    [dl_tcllist [dl_sdfAligned sparse [dl_ilist 500] -100 300 20 2.5 2]] \
+    [dl_tcllist [dl_sdfs sparse [dl_ilist 400] [dl_ilist 800] 20 2.5 2]]
+check "parzenAligned" \
+    [dl_tcllist [dl_parzenAligned sparse [dl_int aligns] -100 300 20 2.5 1]] \
+    [dl_tcllist [dl_parzens sparse [dl_sub [dl_int aligns] 100] \
+                     [dl_add [dl_int aligns] 300] 20 2.5 1]]
+
+# --- threads ---
+dl_set many [dl_llist]
+for {set i 0} {$i < 200} {incr i} {
+    dl_append many [spikes [expr {$i % 2 ? 40 : 2000}] 1500]
+}
+proc tresults {} {
+    list [dl_tcllist [dl_sdfs many [dl_ilist 0] [dl_ilist 1500] 20 3 1]] \
+        [dl_tcllist [dl_deepSdfs [dl_llist many] [dl_ilist 0] [dl_ilist 700] 60 3 2]] \
+        [dl_tcllist [dl_parzens many [dl_ilist 0] [dl_ilist 1500] 20 3 5]]
+}
+dl_threads 1
+set want [tresults]
+foreach t {2 4} {
+    dl_threads $t 0
+    check "$t threads identical" [expr {[tresults] eq $want}] 1
+}
+dl_threads 1
+
+# --- errors ---
+check "usage" [catch {dl_sdfAligned sparse aligns -100 300 20 2.5} msg] 1
+check "bad aligns" [catch {dl_sdfAligned sparse [dl_ilist 1 2] -100 300 20 2.5 1} msg] 1
+check "bad resolution" [catch {dl_sdfs sparse [dl_ilist 0] [dl_ilist 9] 20 2.5 0} msg] 1
+check "bad list" [catch {dl_sdf [dl_slist a b] 0 100 20 2.5 1} msg] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
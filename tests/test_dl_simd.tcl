@@ -0,0 +1,156 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_simd.tcl
+#   Correctness test for the vector arithmetic / relation / math kernels.
+#   Every operation is run with dl_simd scalar and again with each vector
+#   level the cpu supports, and the results must be bit for bit the same
+#   (compared through dg_toString), including NaN, inf, -0, zero divisors,
+#   integer wrap around and lengths that are not a multiple of the vector
+#   width.  The fast math exp / log / sin approximations are checked
+#   against libm within a tolerance.
+#
+#   Usage:  dlsh test_dl_simd.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# --- inputs: 37 values, so every vector width leaves a tail ---
+dl_setMatherr 0
+dl_set nan [dl_log [dl_flist -1]]
+dl_set f [dl_concat [dl_flist 1.5 -2.25 0 -0.0 3e38 -3e38 1e-40 7 7 -7 \
+                        0.1 0.2 100 -100 1e39 -1e39 2 4 8 16 -0.5 0.5] \
+              nan [dl_mult [dl_series 0 13] 0.37]]
+dl_set i [dl_concat [dl_ilist 0 1 -1 2147483647 -2147483648 7 7 -7 \
+                         65536 -65536 3 0 5] [dl_series -11 12]]
+dl_set s [dl_short [dl_concat [dl_ilist 0 1 -1 32767 -32768 7 7 -7 \
+                                   300 -300 3 0 5] [dl_series -11 12]]]
+dl_set c [dl_char [dl_concat [dl_ilist 0 1 127 128 255 7 7 9 \
+                                  100 200 3 0 5] [dl_series 0 23]]]
+check "input lengths" [list [dl_length f] [dl_length i] [dl_length s] \
+                           [dl_length c]] {37 37 37 37}
+dl_set fr [dl_reverse f]
+dl_set ir [dl_reverse i]
+dl_set sr [dl_reverse s]
+dl_set cr [dl_reverse c]
+dl_set f1 [dl_flist 2.5]
+dl_set f0 [dl_flist 0]
+dl_set i1 [dl_ilist -3]
+dl_set i0 [dl_ilist 0]
+dl_set s1 [dl_short [dl_ilist 300]]
+dl_set c1 [dl_char [dl_ilist 200]]
+
+set pairs {
+    {f fr} {f i} {i f} {f s} {s f} {i ir} {s sr} {c cr}
+    {f f1} {f1 f} {f f0} {f0 f} {f i1} {i1 f} {i i1} {i1 i} {i i0} {i0 i}
+    {s s1} {s1 s} {c c1} {c1 c} {s f1} {f1 s} {i f0}
+}
+set arith {add sub mult div min max}
+set relations {eq noteq lt lte gt gte and or eqIndex ltIndex gteIndex orIndex}
+
+# serialize every result so lists can be compared bit for bit
+proc bytes {l} {
+    set g [dg_create simdcmp]
+    dl_set $g:r $l
+    dg_toString $g buf
+    dg_delete $g
+    return [binary encode hex $buf]
+}
+
+proc results {} {
+    set r {}
+    foreach p $::pairs {
+        lassign $p a b
+        foreach op [concat $::arith $::relations] {
+            if {[catch {dl_$op $a $b} l]} { set v error } else { set v [bytes $l] }
+            dict set r "$op $a $b" $v
+        }
+    }
+    foreach op {sqrt abs exp log sin} {
+        dict set r "$op f" [bytes [dl_$op f]]
+    }
+    return $r
+}
+
+check "scalar level" [dl_simd scalar] scalar
+set want [results]
+check "bad level" [catch {dl_simd mmx}] 1
+
+set best [dl_simd best]
+puts "     (best level on this cpu: $best)"
+set levels {}
+foreach level {sse2 avx2} {
+    lappend levels $level
+    if {$level eq $best} break
+}
+if {$best eq "scalar"} { set levels {} }
+
+foreach level $levels {
+    check "set $level" [dl_simd $level] $level
+    set got [results]
+    set bad {}
+    dict for {k v} $want {
+        if {[dict get $got $k] ne $v} { lappend bad $k }
+    }
+    check "$level identical to scalar" $bad {}
+}
+
+# --- spot checks of the values themselves ---
+dl_simd best
+check "int wrap" [dl_tcllist [dl_add [dl_ilist 2147483647 1 2 3 4] 1]] \
+    {-2147483648 2 3 4 5}
+check "div by zero" [dl_tcllist [dl_div [dl_flist 1 2 3 4 5] \
+                                     [dl_flist 1 0 2 0 4]]] \
+    {1.0 0.0 1.5 0.0 1.25}
+check "short mult" [dl_tcllist [dl_mult [dl_short [dl_ilist 200 -3 4 5 6]] \
+                                    [dl_short [dl_ilist 200 3 4 5 6]]]] \
+    {-25536 -9 16 25 36}
+check "mixed relation" [dl_tcllist [dl_lt [dl_ilist 1 2 3 4 5] 2.5]] \
+    {1 1 0 0 0}
+check "nan relations" [dl_tcllist [dl_concat [dl_eq nan nan] \
+                                       [dl_noteq nan nan] [dl_and nan 1]]] \
+    {0 1 1}
+
+# --- fast math approximations ---
+proc maxerr {a b rel} {
+    set d [dl_abs [dl_sub $a $b]]
+    if {$rel} { set d [dl_div $d [dl_add [dl_abs $b] 1e-30]] }
+    return [dl_max $d]
+}
+dl_set x [dl_series -80 80 0.37]
+dl_set lx [dl_exp [dl_series -60 60 0.53]]
+dl_set sx [dl_series -100 100 0.11]
+dl_set sp [dl_concat [dl_flist 0 0 0 0 1e-10 200 -200] nan]
+set exact [list [dl_exp x] [dl_log lx] [dl_sin sx]]
+set spexact [list [bytes [dl_exp sp]] [bytes [dl_log sp]] [bytes [dl_sin sp]]]
+check "fast math off" [dl_setFastMath 1] 0
+lassign $exact ee le se
+check "fast exp" [expr {[maxerr [dl_exp x] $ee 1] < 1e-6}] 1
+check "fast log" [expr {[maxerr [dl_log lx] $le 0] < 1e-6}] 1
+check "fast sin" [expr {[maxerr [dl_sin sx] $se 0] < 1e-6}] 1
+check "fast math specials" \
+    [list [bytes [dl_exp sp]] [bytes [dl_log sp]] [bytes [dl_sin sp]]] $spexact
+dl_setFastMath 0
+check "exact again" [bytes [dl_exp x]] [bytes $ee]
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,122 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_sort.tcl
+#   dl_sort, dl_sortIndices, dl_unique, dl_rank and dl_recode on int,
+#   short, char and float lists, checked against Tcl's lsort (a stable
+#   merge sort), including extreme ints, negative chars, -0, inf and
+#   NaN, lists of lists and copy on write lists.  Large lists must sort
+#   to the same bytes with the parallel merge path (dl_threads > 1) as
+#   without it.
+#
+#   Usage:  dlsh test_dl_sort.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+proc bytes {l} {
+    set g [dg_create sortcmp]
+    dl_set $g:r $l
+    dg_toString $g buf
+    dg_delete $g
+    return [binary encode hex $buf]
+}
+
+# --- inputs: many ties, both signs ---
+set n 2000
+dl_set i [dl_int [dl_mult [dl_sub [dl_urand $n] 0.5] 200]]
+dl_set wide [dl_concat [dl_ilist 2147483647 -2147483648 2000000000 \
+                            -2000000000 0 -1 1] i]
+dl_set s [dl_short [dl_mult [dl_sub [dl_urand $n] 0.5] 60000]]
+dl_set c [dl_char [dl_mult [dl_sub [dl_urand $n] 0.5] 250]]
+dl_set f [dl_div [dl_int [dl_mult [dl_sub [dl_urand $n] 0.5] 2000]] 8.0]
+
+foreach {l mode} {i -integer wide -integer s -integer c -integer f -real} {
+    set tl [dl_tcllist $l]
+    check "sort $l" [dl_tcllist [dl_sort $l]] [lsort $mode $tl]
+    check "sortIndices $l" [dl_tcllist [dl_sortIndices $l]] \
+        [lsort -indices $mode $tl]
+    check "unique $l" [dl_tcllist [dl_unique $l]] [lsort -unique $mode $tl]
+    set u [lsort -unique $mode $tl]
+    set want {}
+    foreach v $tl { lappend want [lsearch -exact $u $v] }
+    check "recode $l" [dl_tcllist [dl_recode $l]] $want
+    set want {}
+    unset -nocomplain seen
+    foreach v $tl {
+        if {![info exists seen($v)]} { set seen($v) 0 }
+        lappend want $seen($v)
+        incr seen($v)
+    }
+    check "rank $l" [dl_tcllist [dl_rank $l]] $want
+}
+
+# --- special values ---
+dl_set nan [dl_log [dl_flist -1]]
+dl_set sp [dl_concat [dl_flist 3 -0.0 inf 0 -inf -2] nan [dl_flist 1 -0.0]]
+check "specials" [dl_tcllist [dl_sort sp]] \
+    [list -Inf -2.0 -0.0 0.0 -0.0 1.0 3.0 Inf [dl_tcllist nan]]
+check "specials indices" [dl_tcllist [dl_sortIndices sp]] {4 5 1 3 8 7 0 2 6}
+check "char order" [dl_tcllist [dl_sort [dl_char [dl_ilist 5 -128 127 0 -1]]]] \
+    [lsort -integer [dl_tcllist [dl_char [dl_ilist 5 -128 127 0 -1]]]]
+check "empty" [dl_length [dl_sort [dl_ilist]]] 0
+check "empty indices" [dl_length [dl_sortIndices [dl_flist]]] 0
+check "one" [dl_tcllist [dl_sortIndices [dl_flist 2]]] 0
+check "strings" [dl_tcllist [dl_sort [dl_slist b c a]]] {a b c}
+
+# --- lists of lists, copies ---
+dl_set ll [dl_llist [dl_ilist 3 1 2] [dl_ilist] [dl_ilist 9 -9]]
+check "lists" [dl_tcllist [dl_sort ll]] {{1 2 3} {} {-9 9}}
+check "list indices" [dl_tcllist [dl_sortIndices ll]] {{1 2 0} {} {1 0}}
+check "bsort" [dl_tcllist [dl_bsort ll]] {{1 2 3} {} {-9 9}}
+dl_set cp i
+dl_set sorted [dl_sort cp]
+check "copy untouched" [dl_tcllist cp] [dl_tcllist i]
+
+# --- parallel merge path ---
+set big 300000
+dl_set bi [dl_int [dl_mult [dl_sub [dl_urand $big] 0.5] 1e9]]
+dl_set bs [dl_short [dl_mult [dl_sub [dl_urand $big] 0.5] 60000]]
+dl_set bf [dl_concat [dl_mult [dl_sub [dl_urand $big] 0.5] 1e6] nan \
+               [dl_flist -0.0 0 -0.0]]
+dl_set bt [dl_int [dl_mult [dl_urand $big] 10]]
+check "big sort" [dl_tcllist [dl_sort bi]] [lsort -integer [dl_tcllist bi]]
+check "big ties" [dl_tcllist [dl_sortIndices bt]] \
+    [lsort -indices -integer [dl_tcllist bt]]
+proc results {} {
+    set r {}
+    foreach l {bi bs bf bt} {
+        lappend r [bytes [dl_sort $l]] [bytes [dl_sortIndices $l]] \
+            [bytes [dl_unique $l]]
+    }
+    return $r
+}
+dl_threads 1
+set want [results]
+foreach t {2 3 4 7} {
+    dl_threads $t 0
+    check "$t threads identical" [expr {[results] eq $want}] 1
+}
+dl_threads 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
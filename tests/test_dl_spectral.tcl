@@ -0,0 +1,326 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_spectral.tcl
+#   dl_fft, dl_cfft and dl_ifft against a Tcl DFT (power of two and
+#   other sizes, padding and lists of lists), dl_dpss (unit energy,
+#   orthogonal, concentrated in the band), dl_mtspectrum,
+#   dl_mtspecgram and dl_mtcoherence (peak of a sinusoid, coherence of
+#   a signal with itself, results matching dl_mtfft), dl_chi2inv and
+#   dl_tinv against tabled values, and dl_specerr and dl_coherr
+#   against the formulas they replace.  Also checks that threads do
+#   not change any result.
+#
+#   Usage:  dlsh test_dl_spectral.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# largest difference between two lists, relative to the largest value
+proc reldiff {a b {tol 1e-5}} {
+    if {[llength $a] != [llength $b]} { return "lengths [llength $a] [llength $b]" }
+    set d 0.0
+    set m 1e-30
+    foreach x $a y $b {
+        set d [expr {max($d, abs($x - $y))}]
+        set m [expr {max($m, abs($y))}]
+    }
+    return [expr {$d/$m < $tol}]
+}
+
+proc near {x y {tol 1e-5}} { expr {abs($x - $y) <= $tol*max(1.0, abs($y))} }
+
+# reference DFT of re + i im (sign -1 forward, +1 inverse)
+proc ref_dft {re im sign} {
+    set n [llength $re]
+    set pi 3.14159265358979323846
+    set outr {}
+    set outi {}
+    for {set k 0} {$k < $n} {incr k} {
+        set sr 0.0
+        set si 0.0
+        for {set t 0} {$t < $n} {incr t} {
+            set a [expr {$sign*2.0*$pi*$k*$t/$n}]
+            set x [lindex $re $t]
+            set y [lindex $im $t]
+            set sr [expr {$sr + $x*cos($a) - $y*sin($a)}]
+            set si [expr {$si + $x*sin($a) + $y*cos($a)}]
+        }
+        lappend outr $sr
+        lappend outi $si
+    }
+    list $outr $outi
+}
+
+# |J|^2 of each trial and taper, as a list of per frequency lists
+proc powers {J} {
+    set out {}
+    foreach trial $J {
+        foreach taper $trial {
+            lassign $taper re im
+            lappend out [lmap a $re b $im {expr {$a*$a + $b*$b}}]
+        }
+    }
+    return $out
+}
+
+# mean over tapers of the |J|^2 of one trial
+proc ref_power {trial} {
+    set rows [powers [list $trial]]
+    set out {}
+    for {set f 0} {$f < [llength [lindex $rows 0]]} {incr f} {
+        set sum 0.0
+        foreach r $rows { set sum [expr {$sum + [lindex $r $f]}] }
+        lappend out [expr {$sum/[llength $rows]}]
+    }
+    return $out
+}
+
+# --- FFT ---
+foreach n {1 2 8 12 7 64 100 37} {
+    set re [dl_tcllist [dl_zrand $n]]
+    set im [dl_tcllist [dl_zrand $n]]
+    set zeros [lrepeat $n 0.0]
+    lassign [ref_dft $re $zeros -1] wr wi
+    lassign [dl_tcllist [dl_fft [dl_flist {*}$re]]] gr gi
+    check "fft $n real" [reldiff $gr $wr] 1
+    check "fft $n imag" [reldiff [concat $gi 1] [concat $wi 1]] 1
+    lassign [ref_dft $re $im -1] wr wi
+    lassign [dl_tcllist [dl_cfft [dl_flist {*}$re] [dl_flist {*}$im]]] gr gi
+    check "cfft $n" [reldiff [concat $gr $gi] [concat $wr $wi]] 1
+    lassign [dl_tcllist [dl_ifft [dl_flist {*}$gr] [dl_flist {*}$gi]]] br bi
+    check "ifft $n" [reldiff [concat $br $bi] [concat $re $im]] 1
+    lassign [dl_tcllist [dl_ifft [dl_flist {*}$re] [dl_zeros $n.]]] gr gi
+    lassign [ref_dft $re $zeros 1] wr wi
+    check "ifft $n real" [reldiff [concat $gr $gi] \
+                              [lmap v [concat $wr $wi] {expr {$v/$n}}]] 1
+}
+lassign [ref_dft {1 2 3 0 0 0} {0 0 0 0 0 0} -1] wr wi
+lassign [dl_tcllist [dl_fft [dl_ilist 1 2 3] 6]] gr gi
+check "fft padded" [reldiff [concat $gr $gi] [concat $wr $wi]] 1
+lassign [dl_tcllist [dl_fft [dl_ilist 1 2 3 0 0 0 9 9] 6]] gr gi
+check "fft cut" [reldiff [concat $gr $gi] [concat $wr $wi]] 1
+dl_set trials [dl_llist [dl_zrand 16] [dl_zrand 20] [dl_zrand 5]]
+check "fft lists" [dl_tcllist [dl_fft trials]] \
+    [list [dl_tcllist [dl_fft trials:0]] [dl_tcllist [dl_fft trials:1]] \
+         [dl_tcllist [dl_fft trials:2]]]
+
+# --- DPSS ---
+set pi 3.14159265358979323846
+foreach {n nw k} {64 3 5 100 4 7 31 2.5 3} {
+    set tapers [dl_tcllist [dl_dpss $n $nw $k]]
+    check "dpss $n $nw count" [llength $tapers] $k
+    set w [expr {double($nw)/$n}]
+    for {set i 0} {$i < $k} {incr i} {
+        set a [lindex $tapers $i]
+        for {set j $i} {$j < $k} {incr j} {
+            set b [lindex $tapers $j]
+            set dot 0.0
+            foreach x $a y $b { set dot [expr {$dot + $x*$y}] }
+            check "dpss $n $nw $i.$j" [near $dot [expr {$i == $j}] 1e-5] 1
+        }
+        # concentration in the band |f| < w
+        set lambda 0.0
+        for {set s 0} {$s < $n} {incr s} {
+            for {set t 0} {$t < $n} {incr t} {
+                set d [expr {$s-$t}]
+                set kern [expr {$d ? sin(2*$pi*$w*$d)/($pi*$d) : 2*$w}]
+                set lambda [expr {$lambda + [lindex $a $s]*[lindex $a $t]*$kern}]
+            }
+        }
+        if {$i < 2*$nw - 2} {
+            check "dpss $n $nw $i concentration" [expr {$lambda > 0.99}] 1
+        }
+        if {$i > 0} {
+            check "dpss $n $nw $i decreasing" [expr {$lambda < $last}] 1
+        }
+        set last $lambda
+        set sum 0.0
+        foreach x $a { set sum [expr {$sum + $x}] }
+        if {!($i & 1)} { check "dpss $n $nw $i sign" [expr {$sum > 0}] 1 }
+    }
+}
+check "dpss cached" [dl_tcllist [dl_dpss 64 3 5]] [dl_tcllist [dl_dpss 64 3 5]]
+
+# --- multitaper estimates ---
+set fs 1000.0
+proc sinusoids {ntrials n freq} {
+    dl_local out [dl_llist]
+    for {set i 0} {$i < $ntrials} {incr i} {
+        dl_append $out [dl_add [dl_sin [dl_mult [dl_fromto 0 $n] \
+                                         [expr {2*3.14159265358979*$freq/$::fs}]]] \
+                            [dl_mult [dl_zrand $n] 0.5]]
+    }
+    dl_return $out
+}
+dl_set x [sinusoids 8 200 125]
+dl_set y [sinusoids 8 200 125]
+dl_set s [dl_mtspectrum x 3 5 0 $fs]
+check "spectrum freqs" [dl_length s:2] 129
+check "spectrum step" [near [dl_get s:2 1] [expr {$fs/256}]] 1
+dl_set mean [dl_meanList s:0]
+check "spectrum peak" [dl_get s:2 [dl_maxIndex mean]] 125.0
+check "spectrum J" [dl_tcllist s:1] [dl_tcllist [dl_mtfft x 3 5 0 $fs]]
+check "spectrum power" [reldiff [dl_tcllist s:0:3] [ref_power [dl_tcllist s:1:3]]] 1
+check "spectrum no pad" [dl_length [dl_get [dl_mtspectrum x 3 5 -1 $fs] 2]] 101
+
+# point data: spike counts have their mean removed and are not scaled
+dl_set counts [dl_llist]
+for {set i 0} {$i < 6} {incr i} { dl_append counts [dl_int [dl_gt [dl_urand 100] 0.9]] }
+set J0 [dl_tcllist [dl_get [dl_get [dl_mtfft counts 3 5 -1 $fs 1] 2] 1]]
+set taper [dl_tcllist [dl_get [dl_dpss 100 3 5] 1]]
+set m [dl_mean counts:2]
+set tx {}
+foreach v [dl_tcllist counts:2] t $taper { lappend tx [expr {($v-$m)*$t*sqrt($fs)}] }
+lassign [ref_dft $tx [lrepeat 100 0.0] -1] wr wi
+check "mtfft point" [reldiff [concat {*}$J0] [concat [lrange $wr 0 50] [lrange $wi 0 50]]] 1
+
+# transform of the first taper by hand
+set J0 [dl_tcllist [dl_get [dl_get [dl_mtfft x 3 5 -1 $fs] 0] 0]]
+set taper [dl_tcllist [dl_get [dl_dpss 200 3 5] 0]]
+set tx {}
+foreach v [dl_tcllist x:0] t $taper { lappend tx [expr {$v*$t*sqrt($fs)/$fs}] }
+lassign [ref_dft $tx [lrepeat 200 0.0] -1] wr wi
+check "mtfft taper" [reldiff [concat {*}$J0] [concat [lrange $wr 0 100] [lrange $wi 0 100]]] 1
+
+dl_set g [dl_mtspecgram x 100 25 3 5 0 $fs]
+check "specgram shape" [dl_tcllist [dl_lengths g:0]] [lrepeat 8 5]
+check "specgram window" [reldiff [dl_tcllist g:0:2:3] \
+    [dl_tcllist [dl_get [dl_get [dl_mtspectrum [dl_llist [dl_choose x:2 [dl_fromto 75 175]]] \
+                                      3 5 0 $fs] 0] 0]]] 1
+
+dl_set c [dl_mtcoherence x x 3 5 0 $fs]
+check "self coherence" [expr {[dl_min c:0] > 0.9999 && [dl_max c:0] < 1.0001}] 1
+dl_set c [dl_mtcoherence x y 3 5 0 $fs]
+check "coherence shape" [dl_tcllist [dl_lengths c]] {8 8 8 8 8 8 8 8 129}
+check "coherence S1" [dl_tcllist c:4] [dl_tcllist s:0]
+check "coherence J1" [dl_tcllist c:6] [dl_tcllist s:1]
+check "coherence mag" [reldiff [dl_tcllist c:0:1] \
+    [dl_tcllist [dl_div [dl_sqrt [dl_add [dl_mult c:2:1 c:2:1] [dl_mult c:3:1 c:3:1]]] \
+                     [dl_sqrt [dl_mult c:4:1 c:5:1]]]]] 1
+check "coherence peak" [expr {[dl_get [dl_meanList c:0] 32] > 0.9}] 1
+
+# --- quantiles ---
+foreach {p df want} {0.95 1 3.841459 0.05 10 3.940299 0.975 100 129.561197 0.5 2 1.386294} {
+    check "chi2inv $p $df" [near [dl_get [dl_chi2inv $p $df] 0] $want] 1
+}
+foreach {p df want} {0.975 10 2.228139 0.5 3 0.0 0.05 4 -2.131847 0.995 1 63.656741} {
+    check "tinv $p $df" [near [dl_get [dl_tinv $p $df] 0] $want 1e-4] 1
+}
+check "quantile lists" [dl_length [dl_chi2inv [dl_flist .1 .5 .9] 4]] 3
+
+# --- confidence limits ---
+proc ref_jackknife {S J p} {
+    set rows [powers $J]
+    set n [llength $rows]
+    set nf [llength $S]
+    set tcrit [dl_get [dl_tinv [expr {1-$p/2.0}] [expr {$n-1}]] 0]
+    set lo {}
+    set hi {}
+    for {set f 0} {$f < $nf} {incr f} {
+        set tot 0.0
+        foreach r $rows { set tot [expr {$tot + [lindex $r $f]}] }
+        set logs {}
+        foreach r $rows { lappend logs [expr {log(($tot - [lindex $r $f])/($n-1))}] }
+        set m 0.0
+        foreach v $logs { set m [expr {$m + $v/$n}] }
+        set var 0.0
+        foreach v $logs { set var [expr {$var + ($v-$m)*($v-$m)/$n}] }
+        set conf [expr {sqrt($var)*sqrt($n-1)*$tcrit}]
+        set s [lindex $S $f]
+        lappend lo [expr {$s*exp(-$conf)}]
+        lappend hi [expr {$s*exp($conf)}]
+    }
+    list $lo $hi
+}
+
+dl_set xs [sinusoids 3 64 125]
+dl_set s3 [dl_mtspectrum xs 2 3 0 $fs]
+dl_set S [dl_llist [dl_meanList s3:0]]
+set e [dl_tcllist [dl_specerr S [dl_llist s3:1] 0.05 2]]
+lassign [ref_jackknife [dl_tcllist S:0] [dl_tcllist s3:1] 0.05] lo hi
+check "specerr jackknife lo" [reldiff [lindex $e 0 0] $lo 1e-4] 1
+check "specerr jackknife hi" [reldiff [lindex $e 1 0] $hi 1e-4] 1
+set e [dl_tcllist [dl_specerr S [dl_llist s3:1] 0.05 1]]
+set dof 18.0
+set ql [dl_get [dl_chi2inv 0.975 $dof] 0]
+set qu [dl_get [dl_chi2inv 0.025 $dof] 0]
+check "specerr chi2 lo" [reldiff [lindex $e 0 0] \
+    [lmap v [dl_tcllist S:0] {expr {$v*$dof/$ql}}]] 1
+check "specerr chi2 hi" [reldiff [lindex $e 1 0] \
+    [lmap v [dl_tcllist S:0] {expr {$v*$dof/$qu}}]] 1
+set dof [expr {floor(1.0/(1.0/18 + 1.0/(2*20)))}]
+set ql [dl_get [dl_chi2inv 0.975 $dof] 0]
+set e [dl_tcllist [dl_specerr S [dl_llist s3:1] 0.05 1 [dl_ilist 20]]]
+check "specerr numspks" [reldiff [lindex $e 0 0] \
+    [lmap v [dl_tcllist S:0] {expr {$v*$dof/$ql}}]] 1
+
+dl_set ys [sinusoids 3 64 125]
+dl_set c3 [dl_mtcoherence xs ys 2 3 0 $fs]
+dl_set C [dl_llist [dl_meanList c3:0]]
+set e [dl_tcllist [dl_coherr C [dl_llist c3:6] [dl_llist c3:7] 0.05 1]]
+check "coherr conf" [near [lindex $e 0 0] [expr {sqrt(1-pow(0.05, 1.0/(18/2.0-1)))}]] 1
+check "coherr asymptotic limits" [lindex $e 1] {{{specify jackknife}} {{specify jackknife}}}
+check "coherr phistd" [reldiff [lindex $e 2 0] \
+    [lmap v [dl_tcllist C:0] {expr {sqrt(2.0/18*(1.0/($v*$v)-1))}}]] 1
+set e [dl_tcllist [dl_coherr C [dl_llist c3:6] [dl_llist c3:7] 0.05 2]]
+set within 1
+foreach l [lindex $e 1 0 0] v [dl_tcllist C:0] u [lindex $e 1 1 0] {
+    if {!($l <= $v + 1e-6 && $v <= $u + 1e-6)} { set within 0 }
+}
+check "coherr jackknife brackets" $within 1
+check "coherr jackknife phistd" [expr {[llength [lindex $e 2 0]] == 33}] 1
+
+# --- threads ---
+dl_set many [sinusoids 64 300 60]
+dl_set many2 [sinusoids 64 300 60]
+proc tresults {} {
+    list [dl_tcllist [dl_mtspectrum many 3 5 1 $::fs]] \
+        [dl_tcllist [dl_mtspecgram many 128 64 3 5 0 $::fs]] \
+        [dl_tcllist [dl_mtcoherence many many2 3 5 0 $::fs]] \
+        [dl_tcllist [dl_fft many]]
+}
+dl_threads 1
+set want [tresults]
+foreach t {2 4} {
+    dl_threads $t 0
+    check "$t threads identical" [expr {[tresults] eq $want}] 1
+}
+dl_threads 1
+
+# --- errors ---
+check "fft usage" [catch {dl_fft} msg] 1
+check "fft nfft" [catch {dl_fft [dl_flist 1 2] 0} msg] 1
+check "cfft lengths" [catch {dl_cfft [dl_flist 1 2] [dl_flist 1]} msg] 1
+check "fft strings" [catch {dl_fft [dl_slist a b]} msg] 1
+check "dpss tapers" [catch {dl_dpss 16 2 17} msg] 1
+check "dpss nw" [catch {dl_dpss 16 9 2} msg] 1
+check "mt lengths" [catch {dl_mtspectrum trials 3 5 0 $fs} msg] 1
+check "mt rate" [catch {dl_mtspectrum x 3 5 0 0} msg] 1
+check "specgram window" [catch {dl_mtspecgram x 300 10 3 5 0 $fs} msg] 1
+check "coherence trials" [catch {dl_mtcoherence x xs 3 5 0 $fs} msg] 1
+check "specerr method" [catch {dl_specerr S [dl_llist s3:1] 0.05 3} msg] 1
+check "specerr shape" [catch {dl_specerr S [dl_llist s:1] 0.05 2} msg] 1
+check "tinv strings" [catch {dl_tinv [dl_slist a] 3} msg] 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
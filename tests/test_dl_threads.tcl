@@ -0,0 +1,122 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_threads.tcl
+#   Per sublist reductions (dl_means, dl_stds, dl_sums, dl_maxs ...)
+#   must give bit for bit the same lists (compared through dg_toString)
+#   whatever dl_threads is set to, for uneven, empty, integer and nested
+#   sublists.  Also checks the dl_threads arguments and prints the time
+#   taken by dl_means / dl_stds on 4000 trials at 1, 2, 4 ... threads up
+#   to the number of processors, to show the scaling on this machine.
+#
+#   Usage:  dlsh test_dl_threads.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+proc bytes {l} {
+    set g [dg_create thrcmp]
+    dl_set $g:r $l
+    dg_toString $g buf
+    dg_delete $g
+    return [binary encode hex $buf]
+}
+
+# --- inputs: 3000 trials of uneven length, some empty ---
+proc trials {lens} {
+    dl_local l [dl_llist]
+    foreach n [dl_tcllist $lens] { dl_append $l [dl_urand $n] }
+    dl_return $l
+}
+dl_set lens [dl_int [dl_mult [dl_urand 3000] 60]]
+dl_set trials [dl_mult [dl_sub [trials lens] 0.5] 100.0]
+dl_set itrials [dl_int [dl_mult trials 10]]
+dl_set strials [dl_short itrials]
+dl_set btrials [dl_gt trials 40]
+dl_set nested [dl_llist trials itrials trials]
+check "some empty" [expr {[dl_sum [dl_eq lens 0]] > 0}] 1
+
+set ops {means stds vars hmeans hstds hvars sums prods mins maxs anys alls}
+set inputs {trials itrials strials btrials nested}
+
+proc results {} {
+    set r {}
+    foreach op $::ops {
+        foreach in $::inputs {
+            if {[catch {dl_$op $in} l]} { set v error } else { set v [bytes $l] }
+            dict set r "$op $in" $v
+        }
+    }
+    return $r
+}
+
+# --- arguments ---
+check "default" [dl_threads] 1
+check "bad count" [catch {dl_threads -1}] 1
+check "bad minsize" [catch {dl_threads 2 x}] 1
+check "usage" [catch {dl_threads 1 2 3}] 1
+check "all processors" [expr {[dl_threads 0] >= 1}] 1
+set ncpu [dl_threads 0]
+
+# --- same results for any number of threads ---
+dl_threads 1
+set want [results]
+foreach n {2 3 4 8 32} {
+    # minsize 0: always hand out the work, even on one processor
+    check "set $n" [dl_threads $n 0] $n
+    set got [results]
+    set bad {}
+    dict for {k v} $want {
+        if {[dict get $got $k] ne $v} { lappend bad $k }
+    }
+    check "$n threads identical" $bad {}
+}
+check "values" [dl_tcllist [dl_sums [dl_llist [dl_ilist 1 2 3] [dl_ilist] \
+                                         [dl_ilist 4]]]] {6 0 4}
+check "empty list" [dl_length [dl_means [dl_llist]]] 0
+
+# --- repeated use of the pool from a loop ---
+dl_set small [dl_llist [dl_flist 1 2] [dl_flist 3 5]]
+set ok 1
+for {set k 0} {$k < 2000} {incr k} {
+    if {[dl_tcllist [dl_means small]] ne {1.5 4.0}} { set ok 0; break }
+}
+check "repeated" $ok 1
+
+# --- scaling (informational) ---
+dl_set blens [dl_add [dl_int [dl_mult [dl_urand 4000] 2000]] 1]
+dl_set big [trials blens]
+dl_threads 1
+set base [lindex [time {dl_means big; dl_stds big} 5] 0]
+puts "     ([dl_sum blens] elements in 4000 trials, $ncpu processors)"
+set n 1
+while {$n <= $ncpu && $n <= 32} {
+    dl_threads $n 65536
+    set us [lindex [time {dl_means big; dl_stds big} 5] 0]
+    puts [format "     %2d threads: %8.0f us  (x%.2f)" $n $us \
+              [expr {double($base)/$us}]]
+    set n [expr {$n * 2}]
+}
+dl_threads 1
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -0,0 +1,139 @@
+#!/usr/bin/env dlsh
+#
+# test_dl_unique_hash.tcl
+#   Hashed dl_unique, dl_uniqueOrdered, dl_valueCounts, dl_oneof and
+#   dl_countOccurences against Tcl references, on int, short, char,
+#   float, string and dictionary string lists, both below and above the
+#   lengths at which they switch from sorting and pairwise compares to
+#   hashing.  dl_unique keeps every NaN (as sorting does); the ordered
+#   uniques and counts treat NaN as one value.
+#
+#   Usage:  dlsh test_dl_unique_hash.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# reference: values in order of first appearance, and how often each occurs
+proc ref_ordered {l} {
+    set out {}
+    foreach v $l {
+        if {![info exists n($v)]} { set n($v) 0; lappend out $v }
+        incr n($v)
+    }
+    return $out
+}
+
+proc ref_counts {l mode} {
+    foreach v $l { incr n($v) }
+    set u [lsort -unique $mode $l]
+    return [list $u [lmap v $u {set n($v)}]]
+}
+
+proc ref_oneof {l cands} {
+    foreach c $cands { set in($c) 1 }
+    return [lmap v $l {info exists in($v)}]
+}
+
+# --- inputs ---
+set words {}
+for {set i 0} {$i < 300} {incr i} { lappend words w[expr {$i * 7919 % 1000}] }
+foreach n {10 5000} {
+    dl_set i$n [dl_int [dl_mult [dl_sub [dl_urand $n] 0.5] 60]]
+    dl_set h$n [dl_int [dl_mult [dl_urand $n] 1e6]]
+    dl_set s$n [dl_short [dl_mult [dl_sub [dl_urand $n] 0.5] 100]]
+    dl_set c$n [dl_char [dl_mult [dl_sub [dl_urand $n] 0.5] 250]]
+    dl_set f$n [dl_div [dl_int [dl_mult [dl_urand $n] 40]] 4.0]
+    dl_set w$n [dl_slist]
+    foreach k [dl_tcllist [dl_int [dl_mult [dl_urand $n] 300]]] {
+        dl_append w$n [lindex $words $k]
+    }
+    dl_set d$n w$n
+    dl_dictEncode d$n
+
+    foreach {l mode} [list i$n -integer h$n -integer s$n -integer \
+                          c$n -integer f$n -real w$n -ascii d$n -ascii] {
+        set tl [dl_tcllist $l]
+        check "unique $l" [dl_tcllist [dl_unique $l]] [lsort -unique $mode $tl]
+        check "uniqueOrdered $l" [dl_tcllist [dl_uniqueOrdered $l]] \
+            [ref_ordered $tl]
+        check "valueCounts $l" [dl_tcllist [dl_valueCounts $l]] \
+            [ref_counts $tl $mode]
+    }
+}
+
+# --- NaN, -0 and lists of lists ---
+dl_set nan [dl_log [dl_flist -1]]
+set tnan [dl_tcllist nan]
+dl_set sp [dl_concat [dl_repeat [dl_flist 2 -0.0 0 1] 10] nan nan [dl_flist 1]]
+check "unique nan" [dl_tcllist [dl_unique sp]] [list -0.0 1.0 2.0 $tnan $tnan]
+check "uniqueOrdered nan" [dl_tcllist [dl_uniqueOrdered sp]] \
+    [list 2.0 -0.0 1.0 $tnan]
+check "valueCounts nan" [dl_tcllist [dl_valueCounts sp]] \
+    [list [list -0.0 1.0 2.0 $tnan] {20 11 10 2}]
+dl_set ll [dl_llist [dl_ilist 3 1 3] [dl_ilist] [dl_slist b a b]]
+check "uniqueOrdered lists" [dl_tcllist [dl_uniqueOrdered ll]] {{3 1} {} {b a}}
+check "valueCounts lists" [dl_tcllist [dl_valueCounts ll]] \
+    {{{1 3} {1 2}} {{} {}} {{a b} {1 2}}}
+check "valueCounts empty" [dl_tcllist [dl_valueCounts [dl_ilist]]] {{} {}}
+
+# --- dl_oneof ---
+set big 20000
+dl_set ids [dl_int [dl_mult [dl_urand $big] 200]]
+dl_set fids [dl_div [dl_int [dl_mult [dl_urand $big] 200]] 2.0]
+foreach k {3 40} {
+    dl_set cands [dl_int [dl_mult [dl_urand $k] 200]]
+    set tc [dl_tcllist cands]
+    check "oneof $k" [dl_tcllist [dl_oneof ids cands]] \
+        [ref_oneof [dl_tcllist ids] $tc]
+    check "oneof float/int $k" [dl_tcllist [dl_oneof fids cands]] \
+        [ref_oneof [lmap v [dl_tcllist fids] {
+            expr {$v == int($v) ? int($v) : $v}}] $tc]
+    check "oneof int/float $k" [dl_tcllist [dl_oneof ids [dl_float cands]]] \
+        [ref_oneof [dl_tcllist ids] $tc]
+    set tw [lrange $words 0 $k]
+    dl_set wc [dl_slist {*}$tw]
+    check "oneof strings $k" [dl_tcllist [dl_oneof w5000 wc]] \
+        [ref_oneof [dl_tcllist w5000] $tw]
+    check "oneof dict $k" [dl_tcllist [dl_oneof d5000 wc]] \
+        [ref_oneof [dl_tcllist w5000] $tw]
+}
+dl_set fc [dl_concat [dl_flist 1.5 2.5] nan [dl_float [dl_fromto 10 30]]]
+check "oneof nan" [dl_tcllist [dl_oneof [dl_concat nan [dl_flist 1.5 3 12]] fc]] \
+    {0 1 0 1}
+
+# --- dl_countOccurences ---
+dl_set pat [dl_concat [dl_ilist 5 5 -1 1000] [dl_fromto 0 20]]
+set tp [dl_tcllist pat]
+set tl [dl_tcllist ids]
+foreach v $tl { incr occ($v) }
+check "countOccurences" [dl_tcllist [dl_countOccurences ids pat]] \
+    [lmap v $tp {expr {[info exists occ($v)] ? $occ($v) : 0}}]
+check "countOccurences strings" \
+    [dl_tcllist [dl_countOccurences [dl_slist a b a c a b] [dl_slist a z b c a]]] \
+    {3 0 2 1 3}
+check "countOccurences short" \
+    [dl_tcllist [dl_countOccurences [dl_ilist 1 2 3 1 5] [dl_ilist 1 9 1 5]]] \
+    {2 0 2 1}
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
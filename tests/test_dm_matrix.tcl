@@ -0,0 +1,171 @@
+#!/usr/bin/env dlsh
+#
+# test_dm_matrix.tcl
+#   dm_mult, dm_transpose, dm_rowSums / dm_colSums, dm_rowMeans /
+#   dm_colMeans and dm_centerRows / dm_centerCols against a Tcl
+#   reference that rounds as the C loops do (float products added in
+#   double), bit for bit, for shapes that leave partial blocks, partial
+#   vectors and single rows or columns.  Products must not depend on
+#   dl_simd or dl_threads.  Also prints the time dm_mult and the single
+#   pass functions take on 512 x 512 matrices (and 2048 x 2048 when
+#   DLSH_BENCH is set in the environment).
+#
+#   Usage:  dlsh test_dm_matrix.tcl   (exits non-zero on any failure)
+
+# --- dlsh bootstrap ---
+if {[catch {package require dlsh}]} {
+    foreach path {/usr/local/dlsh/dlsh.zip /usr/local/lib/dlsh.zip} {
+        if {[file exists $path]} {
+            catch {zipfs mount $path /dlsh}
+            set base [file join [zipfs root] dlsh]
+            set ::auto_path [linsert $::auto_path 0 ${base}/lib]
+            break
+        }
+    }
+    package require dlsh
+}
+
+set ::fail 0
+proc check {label got want} {
+    if {$got eq $want} {
+        puts "OK   $label"
+    } else {
+        puts "FAIL $label -> got {$got} want {$want}"
+        incr ::fail
+    }
+}
+
+# values of a list, printed at full float precision
+proc vals {l} {
+    dl_tcllist $l
+}
+
+# round to float, as storing into a DF_FLOAT list does
+proc f32 {x} {
+    binary scan [binary format f $x] f y
+    return $y
+}
+
+proc fmatrix {rows} {
+    set m [dl_llist]
+    foreach r $rows { dl_append $m [dl_flist {*}$r] }
+    dl_return $m
+}
+
+# --- Tcl references ---
+proc ref_mult {a b} {
+    set bt [dl_tcllist [dl_transpose $b]]
+    set out {}
+    foreach row [dl_tcllist $a] {
+        set r {}
+        foreach col $bt {
+            set sum 0.0
+            foreach x $row y $col { set sum [expr {$sum + [f32 [expr {$x*$y}]]}] }
+            lappend r $sum
+        }
+        lappend out $r
+    }
+    dl_return [fmatrix $out]
+}
+
+proc ref_sums {m mean} {
+    set out {}
+    foreach row [dl_tcllist $m] {
+        set sum 0.0
+        foreach x $row { set sum [expr {$sum + $x}] }
+        lappend out [expr {$mean ? $sum/[llength $row] : $sum}]
+    }
+    dl_return [dl_flist {*}$out]
+}
+
+proc ref_center {m v} {
+    set out {}
+    foreach row [dl_tcllist $m] c [dl_tcllist $v] {
+        lappend out [lmap x $row {f32 [expr {$x - $c}]}]
+    }
+    dl_return [fmatrix $out]
+}
+
+proc randm {rows cols} {
+    dl_return [dm_zrand $rows $cols]
+}
+
+# --- products, transposes, sums and centering by shape ---
+foreach {r k c} {1 1 1  3 5 7  4 8 8  9 1 13  17 33 9  65 70 3
+                 2 300 261  70 9 1  1 257 17} {
+    dl_set A [randm $r $k]
+    dl_set B [randm $k $c]
+    check "mult ${r}x$k * ${k}x$c" [vals [dm_mult A B]] [vals [ref_mult A B]]
+    check "transpose ${r}x$k" [vals [dm_transpose A]] [vals [dl_transpose A]]
+    check "rowSums ${r}x$k" [vals [dm_rowSums A]] [vals [ref_sums A 0]]
+    check "colSums ${r}x$k" [vals [dm_colSums A]] \
+        [vals [ref_sums [dl_transpose A] 0]]
+    check "rowMeans ${r}x$k" [vals [dm_rowMeans A]] [vals [ref_sums A 1]]
+    check "colMeans ${r}x$k" [vals [dm_colMeans A]] \
+        [vals [ref_sums [dl_transpose A] 1]]
+    check "centerRows ${r}x$k" [vals [dm_centerRows A]] \
+        [vals [ref_center A [dm_rowMeans A]]]
+    check "centerCols ${r}x$k" [vals [dm_centerCols A]] \
+        [vals [dl_transpose [ref_center [dl_transpose A] [dm_colMeans A]]]]
+}
+
+dl_set A [randm 6 4]
+check "mult vector" [vals [dm_mult A [dl_flist 1 2 3 4]]] \
+    [vals [dl_mult A [dl_llist [dl_flist 1 2 3 4]]]]
+check "identity" [vals [dm_mult A [dm_identity 4]]] [vals A]
+check "center by vector" [vals [dm_centerCols A [dl_flist 1 2 3 4]]] \
+    [vals [dl_sub A [dl_llist [dl_flist 1 2 3 4]]]]
+check "center by int vector" [vals [dm_centerRows A [dl_ilist 1 2 3 4 5 6]]] \
+    [vals [dm_centerRows A [dl_flist 1 2 3 4 5 6]]]
+
+# --- vector levels and threads ---
+dl_set A [randm 150 300]
+dl_set B [randm 300 140]
+set level [dl_simd]
+set want [vals [dm_mult A B]]
+foreach l {scalar sse2 avx2} {
+    if {[catch {dl_simd $l}]} continue
+    check "mult $l" [vals [dm_mult A B]] $want
+}
+dl_simd $level
+dl_threads 1
+set want [list [vals [dm_mult A B]] [vals [dm_transpose A]] \
+              [vals [dm_colSums A]] [vals [dm_rowMeans A]] \
+              [vals [dm_centerCols A]]]
+foreach t {2 4} {
+    dl_threads $t 0
+    check "$t threads identical" \
+        [list [vals [dm_mult A B]] [vals [dm_transpose A]] \
+             [vals [dm_colSums A]] [vals [dm_rowMeans A]] \
+             [vals [dm_centerCols A]]] $want
+}
+dl_threads 1
+
+# --- errors ---
+check "inner dims" [catch {dm_mult [randm 3 4] [randm 3 4]}] 1
+check "vector length" [catch {dm_mult [randm 3 4] [dl_flist 1 2 3]}] 1
+check "center length" [catch {dm_centerRows [randm 3 4] [dl_flist 1 2]}] 1
+check "not a matrix" [catch {dm_transpose [dl_llist [dl_flist 1] [dl_flist 1 2]]}] 1
+
+# --- timing (informational) ---
+set sizes 512
+if {[info exists ::env(DLSH_BENCH)]} { lappend sizes 2048 }
+set ncpu [dl_threads 0]
+foreach n $sizes {
+    dl_set A [dm_urand $n $n]
+    dl_set B [dm_urand $n $n]
+    puts "     $n x $n, $ncpu processors"
+    foreach {label cmd} {
+        dm_mult      {dm_mult A B}
+        dm_transpose {dm_transpose A}
+        dm_colSums   {dm_colSums A}
+        dm_rowMeans  {dm_rowMeans A}
+        dm_centerCols {dm_centerCols A}
+    } {
+        set us [lindex [time {dl_return [{*}$cmd]} 3] 0]
+        puts [format "     %-13s %10.0f us" $label $us]
+    }
+}
+
+if {$::fail} { puts "=== $::fail FAILURE(S) ==="; exit 1 }
+puts "=== ALL PASS ==="
@@ -35,30 +35,18 @@ namespace eval ::helpmtspec { } {
 	set samp_freq $::mtspec::Args(samp_freq)
 	set fmin [lindex $::mtspec::Args(fpass) 0]
 	set fmax [expr min($samp_freq/2.,[lindex $::mtspec::Args(fpass) 1])]
-	set pretime [expr $::mtspec::Args(pretime)/1000.]
-	set posttime [expr $::mtspec::Args(posttime)/1000.]
 	set nw $::mtspec::Args(nw)
 	set ntapers $::mtspec::Args(ntapers)
 	set pad $::mtspec::Args(pad)
-	set nfft [::helpmtspec::computeNFFT [expr round(($posttime-$pretime)*$samp_freq)] $pad]
-
-	if {$flag == "continuous"} {
-	    dl_local J [::fftw::mtfftC $dynlist $nw $ntapers $pad $samp_freq]
-	} elseif {$flag == "point"} {
-	    dl_local J [::fftw::mtfftPb $dynlist $nw $ntapers $pad $samp_freq]
-	}
 
-	dl_local S [dl_means [dl_deepUnpack [dl_add \
-						 [dl_mult [dl_choose $J [dl_llist [dl_llist 0]]] \
-						      [dl_choose $J [dl_llist [dl_llist 0]]]] \
-						 [dl_mult [dl_choose $J [dl_llist [dl_llist 1]]] \
-						      [dl_choose $J [dl_llist [dl_llist 1]]]]]]]
+	dl_local data [dl_mtspectrum $dynlist $nw $ntapers $pad $samp_freq \
+			   [expr {$flag == "point"}]]
 
-	dl_local freqs [dl_series 0 $samp_freq [expr $samp_freq/$nfft.]]
+	dl_local freqs $data:2
 	dl_local fpass [dl_and [dl_gte $freqs $fmin] [dl_lte $freqs $fmax]]
 	dl_local freqs [dl_select $freqs $fpass]
-	dl_local S [dl_select $S [dl_llist $fpass]]
-	dl_local J [dl_select $J [dl_llist [dl_llist [dl_llist $fpass]]]]
+	dl_local S [dl_select $data:0 [dl_llist $fpass]]
+	dl_local J [dl_select $data:1 [dl_llist [dl_llist [dl_llist $fpass]]]]
 	dl_return [dl_llist $S $J $freqs]
     }
 
@@ -69,65 +57,25 @@ namespace eval ::helpmtspec { } {
 	set samp_freq $::mtspec::Args(samp_freq)
 	set fmin [lindex $::mtspec::Args(fpass) 0]
 	set fmax [expr min($samp_freq/2.,[lindex $::mtspec::Args(fpass) 1])]
-	set pretime [expr $::mtspec::Args(pretime)/1000.]
-	set posttime [expr $::mtspec::Args(posttime)/1000.]
 	set nw $::mtspec::Args(nw)
 	set ntapers $::mtspec::Args(ntapers)
 	set pad $::mtspec::Args(pad)
-	set nfft [::helpmtspec::computeNFFT [expr round(($posttime-$pretime)*$samp_freq)] $pad]
 
-	if {$flag1 == "continuous"} {
-	    dl_local J1 [::fftw::mtfftC $dynlist1 $nw $ntapers $pad $samp_freq]
-	} elseif {$flag1 == "point"} {
-	    dl_local J1 [::fftw::mtfftPb $dynlist1 $nw $ntapers $pad $samp_freq]
-	}
-
-	if {$flag2 == "continuous"} {
-	    dl_local J2 [::fftw::mtfftC $dynlist2 $nw $ntapers $pad $samp_freq]
-	} elseif {$flag2 == "point"} {
-	    dl_local J2 [::fftw::mtfftPb $dynlist2 $nw $ntapers $pad $samp_freq]
-	}
+	# cohmag cohphase S12r S12i S1 S2 J1 J2 freqs
+	dl_local data [dl_mtcoherence $dynlist1 $dynlist2 $nw $ntapers $pad \
+			   $samp_freq [expr {$flag1 == "point"}] \
+			   [expr {$flag2 == "point"}]]
 
-	dl_local S12r [dl_means [dl_deepUnpack [dl_add \
-						 [dl_mult [dl_choose $J1 [dl_llist [dl_llist 0]]] \
-						      [dl_choose $J2 [dl_llist [dl_llist 0]]]] \
-						 [dl_mult [dl_choose $J1 [dl_llist [dl_llist 1]]] \
-						      [dl_choose $J2 [dl_llist [dl_llist 1]]]]]]]
-	dl_local S12i [dl_means [dl_deepUnpack [dl_sub \
-						 [dl_mult [dl_choose $J1 [dl_llist [dl_llist 0]]] \
-						      [dl_choose $J2 [dl_llist [dl_llist 1]]]] \
-						 [dl_mult [dl_choose $J1 [dl_llist [dl_llist 1]]] \
-						      [dl_choose $J2 [dl_llist [dl_llist 0]]]]]]]
-	dl_local S1 [dl_means [dl_deepUnpack [dl_add \
-						   [dl_mult [dl_choose $J1 [dl_llist [dl_llist 0]]] \
-							[dl_choose $J1 [dl_llist [dl_llist 0]]]] \
-						   [dl_mult [dl_choose $J1 [dl_llist [dl_llist 1]]] \
-							[dl_choose $J1 [dl_llist [dl_llist 1]]]]]]]
-	dl_local S2 [dl_means [dl_deepUnpack [dl_add \
-						 [dl_mult [dl_choose $J2 [dl_llist [dl_llist 0]]] \
-						      [dl_choose $J2 [dl_llist [dl_llist 0]]]] \
-						 [dl_mult [dl_choose $J2 [dl_llist [dl_llist 1]]] \
-						      [dl_choose $J2 [dl_llist [dl_llist 1]]]]]]]
-
-	dl_local C12r [dl_div $S12r [dl_sqrt [dl_mult $S1 $S2]]]
-	dl_local C12i [dl_div $S12i [dl_sqrt [dl_mult $S1 $S2]]]
-	dl_local cohmag [dl_sqrt [dl_add [dl_mult $C12r $C12r] [dl_mult $C12i $C12i]]]
-	dl_local cohphase [dl_atan [dl_div $C12i $C12r]]
-
-	dl_local freqs [dl_series 0 $samp_freq [expr $samp_freq/$nfft.]]
+	dl_local freqs $data:8
 	dl_local fpass [dl_and [dl_gte $freqs $fmin] [dl_lte $freqs $fmax]]
-	dl_local freqs [dl_select $freqs $fpass]
-
-	dl_local cohmag [dl_select $cohmag [dl_llist $fpass]]
-	dl_local cohphase [dl_select $cohphase [dl_llist $fpass]]
-	dl_local S12r [dl_select $S12r [dl_llist $fpass]]
-	dl_local S12i [dl_select $S12i [dl_llist $fpass]]
-	dl_local S1 [dl_select $S1 [dl_llist $fpass]]
-	dl_local S2 [dl_select $S2 [dl_llist $fpass]]
-	dl_local J1 [dl_select $J1 [dl_llist [dl_llist [dl_llist $fpass]]]]
-	dl_local J2 [dl_select $J2 [dl_llist [dl_llist [dl_llist $fpass]]]]
-
-	dl_return [dl_llist $cohmag $cohphase $S12r $S12i $S1 $S2 $J1 $J2 $freqs]
+	dl_local out [dl_llist]
+	for {set i 0} {$i < 6} {incr i} {
+	    dl_append $out [dl_select $data:$i [dl_llist $fpass]]
+	}
+	dl_append $out [dl_select $data:6 [dl_llist [dl_llist [dl_llist $fpass]]]]
+	dl_append $out [dl_select $data:7 [dl_llist [dl_llist [dl_llist $fpass]]]]
+	dl_append $out [dl_select $freqs $fpass]
+	dl_return $out
     }
 
     proc mtspecgram { dynlist stepsize winsize flag} {
@@ -148,49 +96,23 @@ namespace eval ::helpmtspec { } {
 	set nSamp [expr int(($posttime-$pretime)*$samp_freq)]
 	set nSampWin [expr int($winsize*$samp_freq)]
 	set nSampStep [expr int($stepsize*$samp_freq)] 
-	dl_local allSamps [dl_fromto 0 $nSamp]
 	dl_local sampWinStart [dl_series 0 [expr $nSamp-$nSampWin] $nSampStep]
-	set nWins [dl_length $sampWinStart]
-	
+
 	#times correspond to the centers of the windows
 	dl_local times [dl_mult [dl_add [dl_div $sampWinStart [expr double($samp_freq)]] \
 				     $pretime [expr $winsize/2.]] 1000]	
 
-	#Split up the eeg signal into overlapping windows for the spectrogram; also do this in batches of trials to ease
-	# memory demands
-	set ncomp [expr [dl_length $dynlist] / 100]
-	dl_local S [dl_llist]
-	for {set i 0} {$i <= $ncomp} {incr i} {
-	    dl_pushTemps
-	    if {$i == $ncomp} {
-		if ([expr [dl_length $dynlist]%100==0]) break
-		dl_local tempDynlist [dl_choose $dynlist [dl_fromto [expr $i*100] [dl_length $dynlist]]]
-	    } else {
-		dl_local tempDynlist [dl_choose $dynlist [dl_fromto [expr $i*100] [expr ($i+1)*100]]]
-	    }
-
-	    dl_local windowIndices [dl_fromto $sampWinStart [dl_add $sampWinStart $nSampWin]]
-	    dl_local windowedData [dl_choose $tempDynlist [dl_llist $windowIndices]]
-	    
-	    #Do the mtFFT
-	    if {$flag == "continuous"} {
-		dl_local J [::fftw::mtfftC $windowedData $nw $ntapers $pad $samp_freq]
-	    } elseif {$flag == "point"} {
-		dl_local J [::fftw::mtfftPb $windowedData $nw $ntapers $pad $samp_freq]
-	    }
-
-	    dl_local S [dl_combine $S [dl_hmeans [dl_deepUnpack [dl_add \
-						      [dl_mult [dl_choose $J [dl_llist [dl_llist [dl_llist 0]]]] \
-							   [dl_choose $J [dl_llist [dl_llist [dl_llist 0]]]]] \
-						      [dl_mult [dl_choose $J [dl_llist [dl_llist [dl_llist 1]]]] \
-							   [dl_choose $J [dl_llist [dl_llist [dl_llist 1]]]]]]]]]
-	    dl_popTemps
+	#windows only cover the first nSamp samples of each trial
+	if {[dl_max [dl_lengths $dynlist]] > $nSamp} {
+	    dl_local dynlist [dl_choose $dynlist [dl_llist [dl_fromto 0 $nSamp]]]
 	}
-	set nfft [::helpmtspec::computeNFFT $nSampWin $pad]
-	dl_local freqs [dl_series 0 $samp_freq [expr $samp_freq/$nfft.]]
+	dl_local data [dl_mtspecgram $dynlist $nSampWin $nSampStep $nw $ntapers \
+			   $pad $samp_freq [expr {$flag == "point"}]]
+
+	dl_local freqs $data:1
 	dl_local fpass [dl_and [dl_gte $freqs $fmin] [dl_lte $freqs $fmax]]
 	dl_local freqs [dl_select $freqs $fpass]
-	dl_local S [dl_select $S [dl_llist [dl_llist $fpass]]]
+	dl_local S [dl_select $data:0 [dl_llist [dl_llist $fpass]]]
 	dl_return [dl_llist $S $freqs $times]
     }
 
@@ -206,152 +128,30 @@ namespace eval ::helpmtspec { } {
     proc specerror {mean_spectra ind_mtfft ntrials p type {numspks ""}} {
 	
 	# type = 1 for asymptotic, 2 for jacknife
-
-	set pp [expr 1-$p/2.]
-	set qq [expr 1-$pp]
-
-	if {$type == 1} {
-	    dl_local dfs [dl_mult $ntrials $::mtspec::Args(ntapers) 2]
-	    if {$numspks != ""} {
-		dl_local dfs [dl_float [dl_floor [dl_div 1. [dl_add [dl_div 1. $dfs] [dl_div 1. [dl_mult 2 $numspks]]]]]]
-	    }
-	    dl_local Qp [dcdf::chi2inv [dl_repeat $pp [dl_length $dfs]] $dfs]
-	    dl_local Qq [dcdf::chi2inv [dl_repeat $qq [dl_length $dfs]] $dfs]
-	    dl_local Serrl [dl_div [dl_mult $mean_spectra $dfs] $Qp]
-	    dl_local Serru [dl_div [dl_mult $mean_spectra $dfs] $Qq]
-	} elseif {$type == 2} {
-	    set ncond [dl_length $ntrials]
-	    dl_local Serrl [dl_llist]
-	    dl_local Serru [dl_llist]
-	    for {set i 0} {$i < $ncond} {incr i} {
-		dl_local cur_mtfft [dl_collapse $ind_mtfft:$i]
-		set n [dl_length $cur_mtfft]
-		dl_local tcrit [dcdf::tinv $p [expr $n-1].]
-		dl_local Sj [dl_llist]
-		for {set j 0} {$j < $n} {incr j} {
-		    dl_pushTemps
-		    dl_local select_notj [dl_noteq [dl_fromto 0 $n] $j]
-		    dl_local J_notj [dl_select $cur_mtfft $select_notj]
-		    dl_local S_notj [dl_meanList [dl_unpack [dl_add \
-								 [dl_mult [dl_choose $J_notj [dl_llist  0]] \
-								      [dl_choose $J_notj [dl_llist 0]]] \
-								 [dl_mult [dl_choose $J_notj [dl_llist 1]] \
-								      [dl_choose $J_notj [dl_llist 1]]]]]]
-		    dl_append $Sj $S_notj
-		    dl_popTemps
-		}
-		dl_local sdlogSj [dl_sqrt [dl_mult [dl_vars [dl_log [dl_transpose $Sj]]] [expr ($n.-1)/$n.]]];
-		dl_local sigma [dl_mult $sdlogSj [expr sqrt($n-1)]]
-		dl_local conf [dl_mult $sigma $tcrit]
-		dl_append $Serrl [dl_mult $mean_spectra:$i [dl_exp [dl_mult $conf -1]]]
-		dl_append $Serru [dl_mult $mean_spectra:$i [dl_exp $conf]]
-	    }
-	} else { 
+	if {$type != 1 && $type != 2} {
 	    error "Invalid method for confidence bar calculation"
 	}
-
-	dl_return [dl_llist $Serrl $Serru]
+	if {$numspks != ""} {
+	    dl_return [dl_specerr $mean_spectra $ind_mtfft $p $type $numspks]
+	}
+	dl_return [dl_specerr $mean_spectra $ind_mtfft $p $type]
     }
 
     proc coherror {mean_cohmag ind_mtfft1 ind_mtfft2 ntrials p type {numspks1 ""} {numspks2 ""}} {
 	
 	# type = 1 for asymptotic, 2 for jacknife
-
-	set nfft [dl_tcllist [dl_lengths $mean_cohmag]:0]
-
-	set pp [expr 1-$p/2.]
-	set qq [expr 1-$p]
-
-	# compute confidence level at the specified pvalue for coherence magnitude
-	dl_local dfs [dl_mult $ntrials $::mtspec::Args(ntapers) 2]
-	dl_local dfs1 $dfs; dl_local dfs2 $dfs;
-	if {$numspks1 != ""} {
-	    dl_local dfs1 [dl_float [dl_floor [dl_div [dl_mult 2 $numspks1 $dfs1] [dl_add [dl_mult 2 $numspks1] $dfs]]]]
-	}
-	if {$numspks2 != ""} {
-	    dl_local dfs2 [dl_float [dl_floor [dl_div [dl_mult 2 $numspks2 $dfs2] [dl_add [dl_mult 2 $numspks2] $dfs]]]]
-	}
-	dl_local dfs [dl_min $dfs1 $dfs2]
-	dl_local df [dl_div 1. [dl_sub [dl_div $dfs 2.] 1.]]
-	dl_local confC [dl_sqrt [dl_sub 1. [dl_pow $p $df]]]; #this value determines at what value magnitudes are stat. sig. > 0
-
-	# theoretical phase standard deviation
-	if {$type == 1} {
-	    dl_local phistd [dl_float [dl_reshape [dl_zeros [expr [dl_length $mean_cohmag]*$nfft]] - $nfft]]
-	    dl_local dfs [dl_reshape [dl_repeat $dfs $nfft] - $nfft]
-	    dl_local idx [dl_gte [dl_abs [dl_sub $mean_cohmag 1]] [expr 1.e-16]]
-	    dl_local temp [dl_sqrt [dl_mult [dl_div 2. [dl_select $dfs $idx]] \
-					[dl_sub [dl_div 1. [dl_pow [dl_select $mean_cohmag $idx] 2]] 1]]]
-	    dl_local phistd [dl_replace $phistd $idx [dl_select $temp $idx]]
-	    dl_return [dl_llist $confC [dl_llist [dl_slist "specify jackknife"] \
-					    [dl_slist "specify jackknife"]] $phistd]
-	} elseif {$type == 2} {; # jacknife confidence bars for magnitude and jacknife phase standard deviation
-	    set ncond [dl_length $ntrials]
-	    dl_local Cerrl [dl_llist]
-	    dl_local Cerru [dl_llist]
-	    dl_local phistd [dl_llist]
-	    for {set i 0} {$i < $ncond} {incr i} {
-		dl_local cur_mtfft1 [dl_collapse $ind_mtfft1:$i]
-		dl_local cur_mtfft2 [dl_collapse $ind_mtfft2:$i]
-		set n [dl_length $cur_mtfft1]
-		dl_local tcrit [dcdf::tinv $pp [expr [dl_tcllist $dfs:$i]-1]]
-		dl_local atanhCj [dl_llist]
-		dl_local phasefactorrj [dl_llist]
-		dl_local phasefactorij [dl_llist]
-		for {set j 0} {$j < $n} {incr j} {
-		    dl_pushTemps
-		    dl_local select_notj [dl_noteq [dl_fromto 0 $n] $j]
-		    dl_local J1_notj [dl_select $cur_mtfft1 $select_notj]
-		    dl_local J2_notj [dl_select $cur_mtfft2 $select_notj]
-		    dl_local S12r_notj [dl_meanList [dl_unpack [dl_add \
-								 [dl_mult [dl_choose $J1_notj [dl_llist  0]] \
-								      [dl_choose $J2_notj [dl_llist 0]]] \
-								 [dl_mult [dl_choose $J1_notj [dl_llist 1]] \
-								      [dl_choose $J2_notj [dl_llist 1]]]]]]
-		    dl_local S12i_notj [dl_meanList [dl_unpack [dl_sub \
-								 [dl_mult [dl_choose $J1_notj [dl_llist  0]] \
-								      [dl_choose $J2_notj [dl_llist 1]]] \
-								 [dl_mult [dl_choose $J1_notj [dl_llist 1]] \
-								      [dl_choose $J2_notj [dl_llist 0]]]]]]
-		    dl_local S1_notj [dl_meanList [dl_unpack [dl_add \
-								 [dl_mult [dl_choose $J1_notj [dl_llist  0]] \
-								      [dl_choose $J1_notj [dl_llist 0]]] \
-								 [dl_mult [dl_choose $J1_notj [dl_llist 1]] \
-								      [dl_choose $J1_notj [dl_llist 1]]]]]]
-		    dl_local S2_notj [dl_meanList [dl_unpack [dl_add \
-								 [dl_mult [dl_choose $J2_notj [dl_llist  0]] \
-								      [dl_choose $J2_notj [dl_llist 0]]] \
-								 [dl_mult [dl_choose $J2_notj [dl_llist 1]] \
-								      [dl_choose $J2_notj [dl_llist 1]]]]]]
-		    dl_local C12r_notj [dl_div $S12r_notj [dl_sqrt [dl_mult $S1_notj $S2_notj]]]
-		    dl_local C12i_notj [dl_div $S12i_notj [dl_sqrt [dl_mult $S1_notj $S2_notj]]]
-		    dl_local cohmag_notj [dl_sqrt [dl_add [dl_mult $C12r_notj $C12r_notj] [dl_mult $C12i_notj $C12i_notj]]]
-		    dl_local cohphase_notj [dl_atan [dl_div $C12i_notj $C12r_notj]]
-		    dl_append $atanhCj [dl_mult .5 [expr sqrt(2*$n-1)] \
-					    [dl_log [dl_div [dl_add 1 $cohmag_notj] [dl_sub 1 $cohmag_notj]]]]
-		    dl_append $phasefactorrj [dl_div $C12r_notj $cohmag_notj]
-		    dl_append $phasefactorij [dl_div $C12i_notj $cohmag_notj]
-		    dl_popTemps
-		}
-		dl_local atanhC [dl_mult .5 [expr sqrt(2*$n-1)] \
-				     [dl_log [dl_div [dl_add 1 $mean_cohmag:$i] [dl_sub 1 $mean_cohmag:$i]]]]
-		dl_local sigma12 [dl_mult [dl_sqrt [dl_mult [dl_vars [dl_transpose $atanhCj]] [expr ($n.-1)/$n.]]] \
-				      [expr sqrt($n-1)]]
-		dl_local Cl [dl_sub $atanhC [dl_mult $tcrit $sigma12]]
-		dl_local Cu [dl_add $atanhC [dl_mult $tcrit $sigma12]]
-		dl_append $Cerrl [dl_tanh [dl_div $Cl [expr sqrt(2*$n-1)]]]
-		dl_append $Cerru [dl_tanh [dl_div $Cu [expr sqrt(2*$n-1)]]]
-
-		dl_local mphasefactorr [dl_meanList $phasefactorrj]
-		dl_local mphasefactori [dl_meanList $phasefactorij]
-		dl_local phasefactormag [dl_sqrt [dl_add [dl_mult $mphasefactorr $mphasefactorr] \
-						      [dl_mult $mphasefactori $mphasefactori]]]
-		dl_append $phistd [dl_mult [expr 2*$n-2] [dl_sub 1 $phasefactormag]]
-	    }
-	    dl_return [dl_llist $confC [dl_llist $Cerrl $Cerru] $phistd]
-	} else { 
+	if {$type != 1 && $type != 2} {
 	    error "Invalid method for statistics calculation"
 	}
+	set args [list $mean_cohmag $ind_mtfft1 $ind_mtfft2 $p $type]
+	if {$numspks1 != ""} {
+	    lappend args $numspks1
+	    if {$numspks2 != ""} { lappend args $numspks2 }
+	} elseif {$numspks2 != ""} {
+	    # the correction is the same for either signal
+	    lappend args $numspks2
+	}
+	dl_return [dl_coherr {*}$args]
     }
 
     ###############################################################################
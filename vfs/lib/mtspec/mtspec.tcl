@@ -838,8 +838,9 @@ namespace eval ::mtspec { } {
 	} {
 	    eval dl_local w \[[lindex $winFunc 1]\]
 	    dl_local wpad [dl_combine $w [dl_repeat 0. $nzeros]]
-	    dl_local X [fftw::1d $wpad]
+	    dl_local X [dl_fft $wpad]
 	    dl_local S [dl_add [dl_mult $X:0 $X:0] [dl_mult $X:1 $X:1]]
+	    dl_local S [dl_choose $S [dl_fromto 0 [expr $npad/2+1]]]; #non-negative frequencies
 	    dl_local S [dl_div [dl_add $S .0000000001] [dl_max $S]]; #normalize to max power, prevent -inf
 	    dl_local fs [dl_series 0 .5 [expr 1/$npad.]]
 
@@ -869,13 +870,14 @@ namespace eval ::mtspec { } {
 	    incr i
 	}
 
-	dl_local w [fftw::dpss $n $nw $ntapers]
+	dl_local w [dl_dpss $n $nw $ntapers]
 	dl_local w [dl_div $w [dl_max $w:0]]
 	dl_local wpad [dl_combineLists $w [dl_repeat [dl_llist [dl_repeat 0. $nzeros]] $ntapers]]
-	dl_local X [fftw::1d $wpad]
+	dl_local X [dl_fft $wpad]
 	dl_local Xr [dl_choose $X [dl_llist 0]]
 	dl_local Xi [dl_choose $X [dl_llist 1]]
 	dl_local S [dl_unpack [dl_add [dl_mult $Xr $Xr] [dl_mult $Xi $Xi]]]
+	dl_local S [dl_choose $S [dl_llist [dl_fromto 0 [expr $npad/2+1]]]]
 	dl_local S [dl_div [dl_add $S .0000000001] [dl_maxs $S]]; #normalize to max power, prevent -inf
 	dl_local fs [dl_series 0 .5 [expr 1/$npad.]]
 
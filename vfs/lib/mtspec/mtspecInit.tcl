@@ -1,4 +1,4 @@
 package provide mtspec 1.4
 
-package require fftw;     # to perform the multitapered FFT
-package require dcdflib;  # for inverse chi-square 
+# the multitaper FFTs, tapers and inverse chi-square and t distributions
+# are dlsh commands (dl_mtspectrum, dl_dpss, dl_chi2inv, ...)
@@ -16,9 +16,9 @@
 #   (interleaved if multi-channel). Generators produce mono. There is no
 #   clipping stage: keep -amp <= 1.0 (writers truncate to 16-bit).
 #
-#   Sizing note: read/write go through Tcl lists (dl_tcllist / binary),
-#   which is instant at stimulus scale (a 1 s 48 kHz mono file is 48k
-#   samples) but not intended for minutes-long recordings.
+#   Samples move between dl lists and the file's bytes with
+#   dl_toBytes / dl_fromBytes, so long recordings read and write
+#   without going through Tcl lists.
 #
 # EXAMPLES
 #   package require wav
@@ -126,8 +126,8 @@ namespace eval wav {
         set rate [dict get $o -rate]
         set nchan [dict get $o -channels]
 
-        set vals [dl_tcllist [dl_short [dl_mult $samples 32767.0]]]
-        set data [binary format s* $vals]
+        set data [dl_toBytes [dl_short [dl_mult $samples 32767.0]] \
+                      -byteorder little]
         set nbytes [string length $data]
 
         set byterate [expr {$rate * $nchan * 2}]
@@ -220,11 +220,10 @@ namespace eval wav {
         close $f
 
         if { $fmt == 1 && $bits == 16 } {
-            binary scan $data s* vals
-            dl_return [dl_flist {*}[lmap v $vals {expr {$v / 32768.0}}]]
+            dl_return [dl_div [dl_fromBytes short $data -byteorder little] \
+                           32768.0]
         } elseif { $fmt == 3 && $bits == 32 } {
-            binary scan $data r* vals
-            dl_return [dl_flist {*}$vals]
+            dl_return [dl_fromBytes float $data -byteorder little]
         } else {
             error "wav: \"$path\": unsupported format (fmt $fmt, $bits bits);\
                    only 16-bit PCM and 32-bit float are readable"